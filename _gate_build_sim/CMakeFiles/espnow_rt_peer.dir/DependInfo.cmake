@@ -0,0 +1,19 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/shared/components/espnow_rt/espnow_rt.c" "CMakeFiles/espnow_rt_peer.dir/root/repo/shared/components/espnow_rt/espnow_rt.c.o" "gcc" "CMakeFiles/espnow_rt_peer.dir/root/repo/shared/components/espnow_rt/espnow_rt.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
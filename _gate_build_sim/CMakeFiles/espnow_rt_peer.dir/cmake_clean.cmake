@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/espnow_rt_peer.dir/root/repo/shared/components/espnow_rt/espnow_rt.c.o"
+  "CMakeFiles/espnow_rt_peer.dir/root/repo/shared/components/espnow_rt/espnow_rt.c.o.d"
+  "espnow_rt_peer.pdb"
+  "espnow_rt_peer.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/espnow_rt_peer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
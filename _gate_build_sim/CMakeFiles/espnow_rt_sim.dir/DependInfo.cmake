@@ -0,0 +1,24 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tools/mesh_sim/espnow_rt_sim.c" "CMakeFiles/espnow_rt_sim.dir/espnow_rt_sim.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/espnow_rt_sim.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_espnow.c" "CMakeFiles/espnow_rt_sim.dir/sim_espnow.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/sim_espnow.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_idf.c" "CMakeFiles/espnow_rt_sim.dir/sim_idf.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/sim_idf.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_json.c" "CMakeFiles/espnow_rt_sim.dir/sim_json.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/sim_json.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_mesh.c" "CMakeFiles/espnow_rt_sim.dir/sim_mesh.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/sim_mesh.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_rtos.c" "CMakeFiles/espnow_rt_sim.dir/sim_rtos.c.o" "gcc" "CMakeFiles/espnow_rt_sim.dir/sim_rtos.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/espnow_rt_sim.dir/espnow_rt_sim.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/espnow_rt_sim.c.o.d"
+  "CMakeFiles/espnow_rt_sim.dir/sim_espnow.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/sim_espnow.c.o.d"
+  "CMakeFiles/espnow_rt_sim.dir/sim_idf.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/sim_idf.c.o.d"
+  "CMakeFiles/espnow_rt_sim.dir/sim_json.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/sim_json.c.o.d"
+  "CMakeFiles/espnow_rt_sim.dir/sim_mesh.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/sim_mesh.c.o.d"
+  "CMakeFiles/espnow_rt_sim.dir/sim_rtos.c.o"
+  "CMakeFiles/espnow_rt_sim.dir/sim_rtos.c.o.d"
+  "espnow_rt_sim"
+  "espnow_rt_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/espnow_rt_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
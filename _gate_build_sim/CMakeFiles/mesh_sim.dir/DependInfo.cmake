@@ -0,0 +1,38 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tools/mesh_sim/mesh_sim.c" "CMakeFiles/mesh_sim.dir/mesh_sim.c.o" "gcc" "CMakeFiles/mesh_sim.dir/mesh_sim.c.o.d"
+  "/root/repo/gateway_mesh/main/cmd_latency.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/cmd_latency.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/cmd_latency.c.o.d"
+  "/root/repo/gateway_mesh/main/commissioning.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/commissioning.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/commissioning.c.o.d"
+  "/root/repo/gateway_mesh/main/fleet_ota.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/fleet_ota.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/fleet_ota.c.o.d"
+  "/root/repo/gateway_mesh/main/mesh_network.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_network.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_network.c.o.d"
+  "/root/repo/gateway_mesh/main/mesh_optimizer.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_optimizer.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_optimizer.c.o.d"
+  "/root/repo/gateway_mesh/main/mesh_router.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_router.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_router.c.o.d"
+  "/root/repo/gateway_mesh/main/mesh_topology.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_topology.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_topology.c.o.d"
+  "/root/repo/gateway_mesh/main/mqtt_handler.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mqtt_handler.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mqtt_handler.c.o.d"
+  "/root/repo/gateway_mesh/main/node_manager.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_manager.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_manager.c.o.d"
+  "/root/repo/gateway_mesh/main/node_ota.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_ota.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_ota.c.o.d"
+  "/root/repo/gateway_mesh/main/nvs_storage.c" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/nvs_storage.c.o" "gcc" "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/nvs_storage.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_fw.c" "CMakeFiles/mesh_sim.dir/sim_fw.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_fw.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_idf.c" "CMakeFiles/mesh_sim.dir/sim_idf.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_idf.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_json.c" "CMakeFiles/mesh_sim.dir/sim_json.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_json.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_mesh.c" "CMakeFiles/mesh_sim.dir/sim_mesh.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_mesh.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_mqtt.c" "CMakeFiles/mesh_sim.dir/sim_mqtt.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_mqtt.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_nvs.c" "CMakeFiles/mesh_sim.dir/sim_nvs.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_nvs.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_rtos.c" "CMakeFiles/mesh_sim.dir/sim_rtos.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_rtos.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_stubs.c" "CMakeFiles/mesh_sim.dir/sim_stubs.c.o" "gcc" "CMakeFiles/mesh_sim.dir/sim_stubs.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,49 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mesh_sim.dir/mesh_sim.c.o"
+  "CMakeFiles/mesh_sim.dir/mesh_sim.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/cmd_latency.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/cmd_latency.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/commissioning.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/commissioning.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/fleet_ota.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/fleet_ota.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_network.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_network.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_optimizer.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_optimizer.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_router.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_router.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_topology.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mesh_topology.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mqtt_handler.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/mqtt_handler.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_manager.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_manager.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_ota.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/node_ota.c.o.d"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/nvs_storage.c.o"
+  "CMakeFiles/mesh_sim.dir/root/repo/gateway_mesh/main/nvs_storage.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_fw.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_fw.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_idf.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_idf.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_json.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_json.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_mesh.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_mesh.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_mqtt.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_mqtt.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_nvs.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_nvs.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_rtos.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_rtos.c.o.d"
+  "CMakeFiles/mesh_sim.dir/sim_stubs.c.o"
+  "CMakeFiles/mesh_sim.dir/sim_stubs.c.o.d"
+  "mesh_sim"
+  "mesh_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mesh_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/tools/mesh_sim/node/sim_node_hw.c" "CMakeFiles/mesh_sim_node.dir/node/sim_node_hw.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/node/sim_node_hw.c.o.d"
+  "/root/repo/node_mesh/main/commissioning.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/commissioning.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/commissioning.c.o.d"
+  "/root/repo/node_mesh/main/device_relay.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/device_relay.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/device_relay.c.o.d"
+  "/root/repo/node_mesh/main/main.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/main.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/main.c.o.d"
+  "/root/repo/node_mesh/main/mesh_node.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/mesh_node.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/mesh_node.c.o.d"
+  "/root/repo/node_mesh/main/nvs_storage.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/nvs_storage.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/nvs_storage.c.o.d"
+  "/root/repo/node_mesh/main/ota_receiver.c" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/ota_receiver.c.o" "gcc" "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/ota_receiver.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,23 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mesh_sim_node.dir/node/sim_node_hw.c.o"
+  "CMakeFiles/mesh_sim_node.dir/node/sim_node_hw.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/commissioning.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/commissioning.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/device_relay.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/device_relay.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/main.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/main.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/mesh_node.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/mesh_node.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/nvs_storage.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/nvs_storage.c.o.d"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/ota_receiver.c.o"
+  "CMakeFiles/mesh_sim_node.dir/root/repo/node_mesh/main/ota_receiver.c.o.d"
+  "mesh_sim_node.pdb"
+  "mesh_sim_node.so"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mesh_sim_node.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,25 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/gateway_mesh/main/webserver.c" "CMakeFiles/webserver_load_sim.dir/root/repo/gateway_mesh/main/webserver.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/root/repo/gateway_mesh/main/webserver.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_httpd.c" "CMakeFiles/webserver_load_sim.dir/sim_httpd.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/sim_httpd.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_idf.c" "CMakeFiles/webserver_load_sim.dir/sim_idf.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/sim_idf.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_json.c" "CMakeFiles/webserver_load_sim.dir/sim_json.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/sim_json.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_mesh.c" "CMakeFiles/webserver_load_sim.dir/sim_mesh.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/sim_mesh.c.o.d"
+  "/root/repo/tools/mesh_sim/sim_rtos.c" "CMakeFiles/webserver_load_sim.dir/sim_rtos.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/sim_rtos.c.o.d"
+  "/root/repo/tools/mesh_sim/webserver_load_sim.c" "CMakeFiles/webserver_load_sim.dir/webserver_load_sim.c.o" "gcc" "CMakeFiles/webserver_load_sim.dir/webserver_load_sim.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
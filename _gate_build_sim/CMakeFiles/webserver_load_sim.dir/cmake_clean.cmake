@@ -0,0 +1,23 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/webserver_load_sim.dir/root/repo/gateway_mesh/main/webserver.c.o"
+  "CMakeFiles/webserver_load_sim.dir/root/repo/gateway_mesh/main/webserver.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/sim_httpd.c.o"
+  "CMakeFiles/webserver_load_sim.dir/sim_httpd.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/sim_idf.c.o"
+  "CMakeFiles/webserver_load_sim.dir/sim_idf.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/sim_json.c.o"
+  "CMakeFiles/webserver_load_sim.dir/sim_json.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/sim_mesh.c.o"
+  "CMakeFiles/webserver_load_sim.dir/sim_mesh.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/sim_rtos.c.o"
+  "CMakeFiles/webserver_load_sim.dir/sim_rtos.c.o.d"
+  "CMakeFiles/webserver_load_sim.dir/webserver_load_sim.c.o"
+  "CMakeFiles/webserver_load_sim.dir/webserver_load_sim.c.o.d"
+  "webserver_load_sim"
+  "webserver_load_sim.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/webserver_load_sim.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
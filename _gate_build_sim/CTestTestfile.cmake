@@ -0,0 +1,26 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/tools/mesh_sim
+# Build directory: /root/repo/_gate_build_sim
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(mesh_sim_50 "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "50" "--seed" "1" "--duration-s" "20" "--uncommissioned" "3")
+set_tests_properties(mesh_sim_50 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;184;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(mesh_sim_300 "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "300" "--seed" "2" "--duration-s" "10" "--scenario" "heartbeat,command,ota")
+set_tests_properties(mesh_sim_300 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;185;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(mesh_sim_300_churn "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "300" "--seed" "3" "--duration-s" "30" "--uncommissioned" "5" "--scenario" "churn,scan")
+set_tests_properties(mesh_sim_300_churn PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;186;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(mesh_sim_fleet "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "50" "--seed" "1" "--topology" "bfs" "--scenario" "fleet")
+set_tests_properties(mesh_sim_fleet PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;187;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(mesh_sim_restore "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "50" "--seed" "1" "--scenario" "restore")
+set_tests_properties(mesh_sim_restore PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;188;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(mesh_sim_house "/root/repo/_gate_build_sim/mesh_sim" "--nodes" "50" "--seed" "1" "--topology" "house" "--scenario" "optimize")
+set_tests_properties(mesh_sim_house PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;189;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(espnow_rt_loss_10 "/root/repo/_gate_build_sim/espnow_rt_sim" "--seed" "1" "--loss" "0.1")
+set_tests_properties(espnow_rt_loss_10 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;190;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(espnow_rt_loss_30 "/root/repo/_gate_build_sim/espnow_rt_sim" "--seed" "2" "--loss" "0.3")
+set_tests_properties(espnow_rt_loss_30 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;191;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(webserver_load "/root/repo/_gate_build_sim/webserver_load_sim" "--seed" "1")
+set_tests_properties(webserver_load PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;192;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
+add_test(webserver_load_8 "/root/repo/_gate_build_sim/webserver_load_sim" "--seed" "2" "--dashboards" "8" "--burst" "6" "--backend-ms" "200")
+set_tests_properties(webserver_load_8 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/tools/mesh_sim/CMakeLists.txt;193;add_test;/root/repo/tools/mesh_sim/CMakeLists.txt;0;")
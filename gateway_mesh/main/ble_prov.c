@@ -18,6 +18,10 @@
 #include "esp_mac.h"
 #include "esp_system.h"
 #include "esp_netif.h"
+#include "esp_heap_caps.h"
+#if CONFIG_BT_ENABLED
+#include "esp_bt.h"
+#endif
 
 #include "wifi_provisioning/manager.h"
 #include "wifi_provisioning/scheme_ble.h"
@@ -27,6 +31,8 @@ static const char *TAG = "BLE_PROV";
 #define WIFI_MAX_RETRY   3
 #define WIFI_CONNECT_TIMEOUT_MS  10000
 
+static bool s_bt_mem_released = false;
+
 // ============================================================================
 // Event handler for provisioning
 // ============================================================================
@@ -147,6 +153,49 @@ bool ble_prov_needed(bool eth_connected)
     return true;
 }
 
+size_t ble_prov_release_bt_memory(void)
+{
+#if CONFIG_BT_ENABLED
+    if (s_bt_mem_released) {
+        return 0;
+    }
+
+    // Only an untouched controller can give its memory back
+    if (esp_bt_controller_get_status() != ESP_BT_CONTROLLER_STATUS_IDLE) {
+        ESP_LOGW(TAG, "BT controller in use - memory not released");
+        return 0;
+    }
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest_before = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    esp_err_t err = esp_bt_mem_release(ESP_BT_MODE_BTDM);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to release BT memory: %s", esp_err_to_name(err));
+        return 0;
+    }
+    s_bt_mem_released = true;
+
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest_after = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    ESP_LOGI(TAG, "BT memory released (BLE provisioning not needed)");
+    ESP_LOGI(TAG, "  Free heap:     %u -> %u bytes (+%u)",
+             (unsigned)free_before, (unsigned)free_after, (unsigned)(free_after - free_before));
+    ESP_LOGI(TAG, "  Largest block: %u -> %u bytes",
+             (unsigned)largest_before, (unsigned)largest_after);
+
+    return free_after - free_before;
+#else
+    return 0;
+#endif
+}
+
+bool ble_prov_bt_memory_released(void)
+{
+    return s_bt_mem_released;
+}
+
 esp_err_t ble_prov_start(void)
 {
     ESP_LOGI(TAG, "╔═══════════════════════════════════════════════════╗");
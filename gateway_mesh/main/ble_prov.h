@@ -14,6 +14,7 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,6 +34,21 @@ esp_err_t ble_prov_start(void);
  */
 bool ble_prov_needed(bool eth_connected);
 
+/**
+ * Release Bluetooth controller/host memory to the heap (irreversible until reboot).
+ * Call at boot once BLE provisioning is known not to be needed.
+ * Logs free heap and largest free block before and after.
+ * @return Bytes returned to the heap (0 if BT is disabled or already released)
+ */
+size_t ble_prov_release_bt_memory(void);
+
+/**
+ * Check if Bluetooth memory was released this boot.
+ * Modules use this to size buffers from the reclaimed heap.
+ * @return true if released
+ */
+bool ble_prov_bt_memory_released(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,149 @@
+/**
+ * OmniaPi Gateway Mesh - Boot Profile Implementation
+ */
+
+#include "boot_profile.h"
+#include "webserver.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "BOOT";
+
+// ============================================================================
+// Internal State
+// ============================================================================
+static const char *s_phase_names[BOOT_PHASE_COUNT] = {
+    "nvs_ready", "netif_ready", "eth_started", "eth_link", "mesh_started",
+    "router", "webserver", "mqtt_started", "mqtt_connected", "tasks",
+    "controllable",
+};
+
+static SemaphoreHandle_t s_mutex = NULL;
+static int32_t s_phase_ms[BOOT_PHASE_COUNT];
+static uint32_t s_reached = 0;
+static uint32_t s_controllable_mask = 0;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t boot_profile_init(void)
+{
+    if (s_mutex != NULL) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        s_phase_ms[i] = -1;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Record controllable if every required phase is in (caller holds s_mutex)
+ * @return true if it was recorded now
+ */
+static bool check_controllable(int32_t now_ms)
+{
+    if (s_controllable_mask == 0 || (s_reached & BOOT_PHASE_BIT(BOOT_PHASE_CONTROLLABLE)) ||
+        (s_reached & s_controllable_mask) != s_controllable_mask) {
+        return false;
+    }
+    s_phase_ms[BOOT_PHASE_CONTROLLABLE] = now_ms;
+    s_reached |= BOOT_PHASE_BIT(BOOT_PHASE_CONTROLLABLE);
+    return true;
+}
+
+static void report_controllable(int32_t now_ms)
+{
+    if (now_ms > CONFIG_GATEWAY_BOOT_TARGET_MS) {
+        ESP_LOGW(TAG, "Controllable after %ld ms - over the %d ms target",
+                 (long)now_ms, CONFIG_GATEWAY_BOOT_TARGET_MS);
+    } else {
+        ESP_LOGI(TAG, "Controllable after %ld ms (target %d ms)",
+                 (long)now_ms, CONFIG_GATEWAY_BOOT_TARGET_MS);
+    }
+    webserver_log("[BOOT] Controllable after %ld ms (target %d ms)",
+                  (long)now_ms, CONFIG_GATEWAY_BOOT_TARGET_MS);
+}
+
+void boot_profile_require(uint32_t mask)
+{
+    if (s_mutex == NULL) return;
+
+    int32_t now_ms = (int32_t)(esp_timer_get_time() / 1000);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_controllable_mask = mask & ~BOOT_PHASE_BIT(BOOT_PHASE_CONTROLLABLE);
+    bool controllable = check_controllable(now_ms);
+    xSemaphoreGive(s_mutex);
+
+    if (controllable) report_controllable(now_ms);
+}
+
+void boot_profile_mark(boot_phase_t phase)
+{
+    if (s_mutex == NULL || phase >= BOOT_PHASE_CONTROLLABLE) return;
+
+    int32_t now_ms = (int32_t)(esp_timer_get_time() / 1000);
+    bool controllable = false;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!(s_reached & BOOT_PHASE_BIT(phase))) {
+        s_phase_ms[phase] = now_ms;
+        s_reached |= BOOT_PHASE_BIT(phase);
+        ESP_LOGI(TAG, "%s at %ld ms", s_phase_names[phase], (long)now_ms);
+        controllable = check_controllable(now_ms);
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (controllable) report_controllable(now_ms);
+}
+
+int32_t boot_profile_get_ms(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT) return -1;
+    return s_phase_ms[phase];
+}
+
+cJSON* boot_profile_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON *phases = cJSON_CreateObject();
+
+    if (s_mutex != NULL) xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (s_phase_ms[i] >= 0) {
+            cJSON_AddNumberToObject(phases, s_phase_names[i], s_phase_ms[i]);
+        } else {
+            cJSON_AddNullToObject(phases, s_phase_names[i]);
+        }
+    }
+
+    int32_t controllable_ms = s_phase_ms[BOOT_PHASE_CONTROLLABLE];
+    cJSON *waiting = cJSON_CreateArray();
+    for (int i = 0; i < BOOT_PHASE_CONTROLLABLE; i++) {
+        if ((s_controllable_mask & BOOT_PHASE_BIT(i)) && !(s_reached & BOOT_PHASE_BIT(i))) {
+            cJSON_AddItemToArray(waiting, cJSON_CreateString(s_phase_names[i]));
+        }
+    }
+
+    if (s_mutex != NULL) xSemaphoreGive(s_mutex);
+
+    cJSON_AddItemToObject(json, "phases_ms", phases);
+    cJSON_AddItemToObject(json, "waiting_for", waiting);
+    cJSON_AddNumberToObject(json, "target_ms", CONFIG_GATEWAY_BOOT_TARGET_MS);
+    if (controllable_ms >= 0) {
+        cJSON_AddNumberToObject(json, "controllable_ms", controllable_ms);
+        cJSON_AddBoolToObject(json, "within_target", controllable_ms <= CONFIG_GATEWAY_BOOT_TARGET_MS);
+    } else {
+        cJSON_AddNullToObject(json, "controllable_ms");
+    }
+    cJSON_AddNumberToObject(json, "uptime_ms", (double)(esp_timer_get_time() / 1000));
+
+    return json;
+}
@@ -0,0 +1,75 @@
+/**
+ * OmniaPi Gateway Mesh - Boot Profile
+ *
+ * Records when each boot phase is first reached (ms since the app started)
+ * and when the gateway became controllable: every phase passed to
+ * boot_profile_require() reached. The result is compared against
+ * CONFIG_GATEWAY_BOOT_TARGET_MS and served by GET /api/boot, so a release
+ * check can read it from a freshly booted gateway.
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BOOT_PHASE_NVS_READY = 0,   // NVS and stored config loaded
+    BOOT_PHASE_NETIF_READY,     // TCP/IP stack and event loop up
+    BOOT_PHASE_ETH_STARTED,     // Ethernet driver started (or failed)
+    BOOT_PHASE_ETH_LINK,        // Ethernet got an IP
+    BOOT_PHASE_MESH_STARTED,    // Mesh root started
+    BOOT_PHASE_ROUTER,          // Router reached over WiFi
+    BOOT_PHASE_WEBSERVER,       // HTTP server accepting requests
+    BOOT_PHASE_MQTT_STARTED,    // MQTT client started (connecting)
+    BOOT_PHASE_MQTT_CONNECTED,  // Broker session up
+    BOOT_PHASE_TASKS,           // Gateway loop running
+    BOOT_PHASE_CONTROLLABLE,    // All required phases reached
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+#define BOOT_PHASE_BIT(p)       (1UL << (p))
+
+/**
+ * Initialize the profile (first thing in app_main)
+ * @return ESP_OK on success
+ */
+esp_err_t boot_profile_init(void);
+
+/**
+ * Set the phases that together mean controllable, once the boot mode
+ * (provisioning or normal) is known. Phases already reached count.
+ * @param mask  BOOT_PHASE_BIT()s
+ */
+void boot_profile_require(uint32_t mask);
+
+/**
+ * Record that a phase was reached (later calls for the same phase, e.g.
+ * reconnects, are ignored). Safe from any task.
+ */
+void boot_profile_mark(boot_phase_t phase);
+
+/**
+ * Time a phase was reached
+ * @return ms since app start, or -1 if not reached yet
+ */
+int32_t boot_profile_get_ms(boot_phase_t phase);
+
+/**
+ * Report: phase times, controllable time, target and verdict
+ * @return cJSON object (caller must free)
+ */
+cJSON* boot_profile_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_PROFILE_H
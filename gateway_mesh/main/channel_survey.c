@@ -0,0 +1,501 @@
+/**
+ * OmniaPi Gateway Mesh - Channel Survey Implementation
+ *
+ * Score per channel (lower is better):
+ *  - every foreign AP within CHANNEL_SURVEY_OVERLAP channels adds
+ *    (rssi + 100) / 10, scaled down linearly with channel distance
+ *  - frames overheard per 100 ms of dwell / 10 (own mesh excluded)
+ *  - noise floor above -95 dBm, in dB
+ * The root leaves its channel for one dwell at a time, like the Web UI
+ * WiFi scan, so mesh traffic is only delayed, not dropped.
+ */
+
+#include "channel_survey.h"
+#include "mesh_topology.h"
+#include "wifi_manager.h"
+#include "fleet_ota.h"
+#include "node_ota.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_mesh.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CH_SURVEY";
+
+#define SURVEY_MAX_APS      64
+#define OWN_MACS_MAX        (TOPOLOGY_MAX_NODES * 2 + 2)
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    uint8_t  channel;
+    int8_t   rssi;
+} survey_ap_t;
+
+typedef struct {
+    bool     valid;
+    uint8_t  from;
+    uint8_t  to;
+    int64_t  at_ms;
+    const char *result;                 // "switched", "kept", "locked_to_router", "busy", "failed"
+    channel_link_metrics_t before;
+    channel_link_metrics_t after;
+    bool     after_valid;
+} channel_switch_t;
+
+static uint8_t s_channel = CONFIG_MESH_CHANNEL;
+static channel_survey_entry_t s_entries[CHANNEL_SURVEY_MAX];
+static int s_entry_count = 0;
+static int64_t s_last_survey_ms = 0;
+static bool s_running = false;
+static bool s_migrate = false;
+static channel_switch_t s_switch = {0};
+static SemaphoreHandle_t s_mutex = NULL;
+
+// Promiscuous counters, written from the WiFi task during a survey
+static volatile uint32_t s_frames[CHANNEL_SURVEY_MAX + 1];
+static volatile int8_t s_noise[CHANNEL_SURVEY_MAX + 1];
+
+// Sorted MACs of our own mesh, excluded from the counts
+static uint8_t s_own_macs[OWN_MACS_MAX][6];
+static int s_own_count = 0;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static int mac_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, 6);
+}
+
+static bool is_own_mac(const uint8_t *mac)
+{
+    return bsearch(mac, s_own_macs, s_own_count, 6, mac_cmp) != NULL;
+}
+
+static void add_own_mac(const uint8_t *mac, bool with_ap)
+{
+    if (s_own_count < OWN_MACS_MAX) {
+        memcpy(s_own_macs[s_own_count++], mac, 6);
+    }
+    if (with_ap && s_own_count < OWN_MACS_MAX) {
+        memcpy(s_own_macs[s_own_count], mac, 6);
+        s_own_macs[s_own_count++][5]++;   // softAP = station MAC + 1
+    }
+}
+
+static void load_own_macs(void)
+{
+    s_own_count = 0;
+
+    uint8_t mac[6];
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+    add_own_mac(mac, false);
+    esp_wifi_get_mac(WIFI_IF_AP, mac);
+    add_own_mac(mac, false);
+
+    mesh_topology_node_t *nodes = malloc(sizeof(mesh_topology_node_t) * TOPOLOGY_MAX_NODES);
+    if (nodes != NULL) {
+        int count = mesh_topology_get_all(nodes, TOPOLOGY_MAX_NODES);
+        for (int i = 0; i < count; i++) {
+            add_own_mac(nodes[i].mac, true);
+        }
+        free(nodes);
+    }
+    qsort(s_own_macs, s_own_count, 6, mac_cmp);
+}
+
+static void promisc_cb(void *buf, wifi_promiscuous_pkt_type_t type)
+{
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    uint8_t ch = pkt->rx_ctrl.channel;
+    if (ch == 0 || ch > CHANNEL_SURVEY_MAX) {
+        return;
+    }
+    // Transmitter address (addr2) of management and data frames
+    if (type != WIFI_PKT_CTRL && pkt->rx_ctrl.sig_len >= 16 && is_own_mac(pkt->payload + 10)) {
+        return;
+    }
+    s_frames[ch]++;
+    int8_t nf = pkt->rx_ctrl.noise_floor;
+    if (s_noise[ch] == 0 || nf < s_noise[ch]) {
+        s_noise[ch] = nf;
+    }
+}
+
+/**
+ * Fleet-wide link health from the topology map
+ */
+static void measure_links(channel_link_metrics_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    mesh_topology_node_t *nodes = malloc(sizeof(mesh_topology_node_t) * TOPOLOGY_MAX_NODES);
+    if (nodes == NULL) {
+        return;
+    }
+    int count = mesh_topology_get_all(nodes, TOPOLOGY_MAX_NODES);
+
+    float send_ok = 0;
+    float rtt = 0;
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (nodes[i].samples < TOPOLOGY_MIN_SAMPLES || nodes[i].rtt_ms <= 0) continue;
+        send_ok += nodes[i].send_ok;
+        rtt += nodes[i].rtt_ms;
+        n++;
+    }
+    free(nodes);
+
+    if (n > 0) {
+        out->retry_rate = 1.0f - send_ok / n;
+        out->rtt_ms = rtt / n;
+        out->nodes = n;
+    }
+}
+
+static bool maintenance_busy(void)
+{
+    return fleet_ota_is_active() || node_ota_is_active();
+}
+
+// ============================================================================
+// Survey
+// ============================================================================
+
+static int survey_channels(channel_survey_entry_t *entries, survey_ap_t *aps, int *ap_count)
+{
+    wifi_country_t country;
+    uint8_t first = 1;
+    uint8_t last = 13;
+    if (esp_wifi_get_country(&country) == ESP_OK && country.nchan > 0) {
+        first = country.schan;
+        last = country.schan + country.nchan - 1;
+    }
+    if (last > CHANNEL_SURVEY_MAX) last = CHANNEL_SURVEY_MAX;
+
+    load_own_macs();
+    memset((void *)s_frames, 0, sizeof(s_frames));
+    memset((void *)s_noise, 0, sizeof(s_noise));
+
+    wifi_promiscuous_filter_t filter = {
+        .filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA | WIFI_PROMIS_FILTER_MASK_CTRL,
+    };
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(promisc_cb);
+    esp_wifi_set_promiscuous(true);
+
+    wifi_ap_record_t *records = malloc(sizeof(wifi_ap_record_t) * 16);
+    int count = 0;
+    *ap_count = 0;
+
+    for (uint8_t ch = first; ch <= last && records != NULL; ch++) {
+        wifi_scan_config_t scan_config = {
+            .channel = ch,
+            .show_hidden = true,
+            .scan_type = WIFI_SCAN_TYPE_PASSIVE,
+            .scan_time.passive = CHANNEL_SURVEY_DWELL_MS,
+        };
+        esp_err_t err = esp_wifi_scan_start(&scan_config, true);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Scan of channel %d failed: %s", ch, esp_err_to_name(err));
+            continue;
+        }
+
+        uint16_t n = 16;
+        esp_wifi_scan_get_ap_records(&n, records);
+
+        channel_survey_entry_t *e = &entries[count++];
+        memset(e, 0, sizeof(*e));
+        e->channel = ch;
+        for (int i = 0; i < n; i++) {
+            if (is_own_mac(records[i].bssid)) continue;
+            e->ap_count++;
+            if (e->strongest_rssi == 0 || records[i].rssi > e->strongest_rssi) {
+                e->strongest_rssi = records[i].rssi;
+            }
+            if (*ap_count < SURVEY_MAX_APS) {
+                aps[*ap_count].channel = records[i].primary;
+                aps[*ap_count].rssi = records[i].rssi;
+                (*ap_count)++;
+            }
+        }
+    }
+
+    esp_wifi_set_promiscuous(false);
+    free(records);
+
+    for (int i = 0; i < count; i++) {
+        entries[i].frames = s_frames[entries[i].channel];
+        entries[i].noise_floor = s_noise[entries[i].channel];
+    }
+    return count;
+}
+
+static void score_channels(channel_survey_entry_t *entries, int count, const survey_ap_t *aps, int ap_count)
+{
+    for (int i = 0; i < count; i++) {
+        channel_survey_entry_t *e = &entries[i];
+        float score = 0;
+
+        for (int a = 0; a < ap_count; a++) {
+            int dist = abs((int)aps[a].channel - (int)e->channel);
+            if (dist > CHANNEL_SURVEY_OVERLAP) continue;
+            float strength = (aps[a].rssi + 100) / 10.0f;
+            if (strength < 0) strength = 0;
+            score += strength * (1.0f - (float)dist / (CHANNEL_SURVEY_OVERLAP + 1));
+        }
+
+        score += (float)e->frames * 100 / CHANNEL_SURVEY_DWELL_MS / 10.0f;
+        if (e->noise_floor != 0 && e->noise_floor > -95) {
+            score += e->noise_floor + 95;
+        }
+        e->score = score;
+    }
+}
+
+static void decide(const channel_survey_entry_t *entries, int count)
+{
+    const channel_survey_entry_t *cur = NULL;
+    const channel_survey_entry_t *best = NULL;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].channel == s_channel) cur = &entries[i];
+        if (best == NULL || entries[i].score < best->score) best = &entries[i];
+    }
+    if (cur == NULL || best == NULL) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Channel %d score %.1f, best %d score %.1f",
+             cur->channel, cur->score, best->channel, best->score);
+
+    if (best == cur || best->score > cur->score * CHANNEL_SWITCH_RATIO ||
+        cur->score - best->score < CHANNEL_SWITCH_MIN_DELTA) {
+        return;
+    }
+
+    memset(&s_switch, 0, sizeof(s_switch));
+    s_switch.valid = true;
+    s_switch.from = cur->channel;
+    s_switch.to = best->channel;
+    s_switch.at_ms = now_ms();
+
+    if (wifi_manager_is_connected()) {
+        // Root STA follows the router's channel
+        s_switch.result = "locked_to_router";
+        return;
+    }
+    if (maintenance_busy()) {
+        s_switch.result = "busy";
+        return;
+    }
+
+    measure_links(&s_switch.before);
+    esp_err_t ret = esp_mesh_switch_channel(NULL, best->channel, CHANNEL_SWITCH_CSA_COUNT);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Channel switch failed: %s", esp_err_to_name(ret));
+        s_switch.result = "failed";
+        return;
+    }
+
+    ESP_LOGI(TAG, "Mesh moving from channel %d to %d", cur->channel, best->channel);
+    s_channel = best->channel;
+
+    // Stored with the rest of the config, so the next mesh start uses it
+    config_begin();
+    config_set_mesh(NULL, s_channel);
+    if (config_commit() != ESP_OK) {
+        ESP_LOGW(TAG, "Channel %d not saved, next boot starts on %d",
+                 s_channel, config_get_mesh()->channel);
+    }
+    s_switch.result = "switched";
+}
+
+static void survey_task(void *pvParameters)
+{
+    channel_survey_entry_t *entries = calloc(CHANNEL_SURVEY_MAX, sizeof(channel_survey_entry_t));
+    survey_ap_t *aps = calloc(SURVEY_MAX_APS, sizeof(survey_ap_t));
+
+    if (entries != NULL && aps != NULL) {
+        int64_t start = now_ms();
+        int ap_count = 0;
+        int count = survey_channels(entries, aps, &ap_count);
+        score_channels(entries, count, aps, ap_count);
+        ESP_LOGI(TAG, "Survey of %d channels took %lld ms (%d APs)",
+                 count, (long long)(now_ms() - start), ap_count);
+
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        memcpy(s_entries, entries, sizeof(channel_survey_entry_t) * count);
+        s_entry_count = count;
+        if (s_migrate) {
+            decide(entries, count);
+        }
+        xSemaphoreGive(s_mutex);
+    } else {
+        ESP_LOGE(TAG, "Survey: out of memory");
+    }
+    free(entries);
+    free(aps);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_last_survey_ms = now_ms();
+    s_running = false;
+    xSemaphoreGive(s_mutex);
+
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t channel_survey_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    const config_mesh_t *mesh = config_get_mesh();
+    if (mesh->channel >= 1 && mesh->channel <= CHANNEL_SURVEY_MAX) {
+        s_channel = mesh->channel;
+    }
+    s_last_survey_ms = now_ms();  // First scheduled survey one interval after boot
+
+    ESP_LOGI(TAG, "Mesh channel %d%s", s_channel,
+             s_channel != CONFIG_MESH_CHANNEL ? " (stored)" : "");
+    return ESP_OK;
+}
+
+uint8_t channel_survey_get_channel(void)
+{
+    return s_channel;
+}
+
+esp_err_t channel_survey_start(bool migrate)
+{
+    if (s_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_running) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_running = true;
+    s_migrate = migrate;
+    xSemaphoreGive(s_mutex);
+
+    if (xTaskCreate(survey_task, "ch_survey", 4096, NULL, 3, NULL) != pdPASS) {
+        s_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Channel survey started%s", migrate ? " (may migrate)" : "");
+    return ESP_OK;
+}
+
+void channel_survey_tick(void)
+{
+    if (s_mutex == NULL) return;
+    int64_t now = now_ms();
+
+    bool measure = false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_switch.valid && strcmp(s_switch.result, "switched") == 0 && !s_switch.after_valid &&
+        now - s_switch.at_ms >= CHANNEL_SETTLE_MS) {
+        measure = true;
+    }
+    bool due = !s_running && CONFIG_GATEWAY_CHANNEL_SURVEY_INTERVAL_H > 0 &&
+               now - s_last_survey_ms >= (int64_t)CONFIG_GATEWAY_CHANNEL_SURVEY_INTERVAL_H * 3600 * 1000;
+    xSemaphoreGive(s_mutex);
+
+    if (measure) {
+        channel_link_metrics_t after;
+        measure_links(&after);
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        s_switch.after = after;
+        s_switch.after_valid = true;
+        xSemaphoreGive(s_mutex);
+        ESP_LOGI(TAG, "After switch to %d: retry %.3f -> %.3f, RTT %.0f -> %.0f ms",
+                 s_switch.to, s_switch.before.retry_rate, after.retry_rate,
+                 s_switch.before.rtt_ms, after.rtt_ms);
+    }
+
+    // Scheduled surveys wait for a quiet mesh
+    if (due && !maintenance_busy()) {
+        channel_survey_start(true);
+    }
+}
+
+static cJSON* metrics_json(const channel_link_metrics_t *m)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "retry_rate", m->retry_rate);
+    cJSON_AddNumberToObject(json, "rtt_ms", m->rtt_ms);
+    cJSON_AddNumberToObject(json, "nodes", m->nodes);
+    return json;
+}
+
+cJSON* channel_survey_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (s_mutex == NULL) return json;
+
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&primary, &second);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    cJSON_AddNumberToObject(json, "channel", s_channel);
+    cJSON_AddNumberToObject(json, "radio_channel", primary);
+    cJSON_AddBoolToObject(json, "surveying", s_running);
+    cJSON_AddNumberToObject(json, "interval_h", CONFIG_GATEWAY_CHANNEL_SURVEY_INTERVAL_H);
+
+    cJSON *survey = cJSON_CreateArray();
+    for (int i = 0; i < s_entry_count; i++) {
+        const channel_survey_entry_t *e = &s_entries[i];
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "channel", e->channel);
+        cJSON_AddNumberToObject(entry, "aps", e->ap_count);
+        cJSON_AddNumberToObject(entry, "strongest_rssi", e->strongest_rssi);
+        cJSON_AddNumberToObject(entry, "noise_floor", e->noise_floor);
+        cJSON_AddNumberToObject(entry, "frames", e->frames);
+        cJSON_AddNumberToObject(entry, "score", e->score);
+        cJSON_AddItemToArray(survey, entry);
+    }
+    cJSON_AddItemToObject(json, "survey", survey);
+
+    if (s_switch.valid) {
+        cJSON *sw = cJSON_CreateObject();
+        cJSON_AddNumberToObject(sw, "from", s_switch.from);
+        cJSON_AddNumberToObject(sw, "to", s_switch.to);
+        cJSON_AddStringToObject(sw, "result", s_switch.result);
+        cJSON_AddNumberToObject(sw, "age_s", (double)(now_ms() - s_switch.at_ms) / 1000);
+        if (strcmp(s_switch.result, "switched") == 0) {
+            cJSON_AddItemToObject(sw, "before", metrics_json(&s_switch.before));
+            if (s_switch.after_valid) {
+                cJSON_AddItemToObject(sw, "after", metrics_json(&s_switch.after));
+            }
+        }
+        cJSON_AddItemToObject(json, "last_switch", sw);
+    }
+
+    xSemaphoreGive(s_mutex);
+    return json;
+}
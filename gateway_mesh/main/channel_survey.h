@@ -0,0 +1,90 @@
+/**
+ * OmniaPi Gateway Mesh - Channel Survey
+ *
+ * Measures every allowed 2.4 GHz channel (beaconing APs weighted by
+ * overlap and signal, plus frames overheard while dwelling on it) and
+ * moves the mesh to a clearly better channel with a channel switch
+ * announcement, so nodes follow without rejoining.
+ */
+
+#ifndef CHANNEL_SURVEY_H
+#define CHANNEL_SURVEY_H
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define CHANNEL_SURVEY_MAX          14
+#define CHANNEL_SURVEY_DWELL_MS     120     // Passive listen per channel
+#define CHANNEL_SURVEY_OVERLAP      4       // Channels either side an AP interferes with
+#define CHANNEL_SWITCH_RATIO        0.7f    // Best channel must score below 70% of current
+#define CHANNEL_SWITCH_MIN_DELTA    5.0f    // ...and by at least this much
+#define CHANNEL_SWITCH_CSA_COUNT    15      // Beacons carrying the switch announcement
+#define CHANNEL_SETTLE_MS           600000  // Link metrics re-measured this long after a switch
+
+// ============================================================================
+// Results
+// ============================================================================
+typedef struct {
+    uint8_t  channel;
+    uint8_t  ap_count;                  // APs beaconing on this channel
+    int8_t   strongest_rssi;            // Strongest of those (0 if none)
+    int8_t   noise_floor;               // Lowest reported noise floor (dBm, 0 if unknown)
+    uint32_t frames;                    // Frames overheard during the dwell
+    float    score;                     // Interference estimate, lower is better
+} channel_survey_entry_t;
+
+typedef struct {
+    float    retry_rate;                // 1 - mean node-reported send success
+    float    rtt_ms;                    // Mean heartbeat round trip
+    uint8_t  nodes;                     // Nodes averaged
+} channel_link_metrics_t;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize (starts from the configured mesh channel, config_get_mesh())
+ * @return ESP_OK on success
+ */
+esp_err_t channel_survey_init(void);
+
+/**
+ * Channel the mesh is on (configured, or chosen by a migration since)
+ * @return Channel number
+ */
+uint8_t channel_survey_get_channel(void);
+
+/**
+ * Start a survey in the background
+ * @param migrate  Switch channel if a clearly better one is found
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if a survey is running
+ */
+esp_err_t channel_survey_start(bool migrate);
+
+/**
+ * Periodic housekeeping: scheduled surveys and post-switch measurement
+ * (call from the heartbeat task)
+ */
+void channel_survey_tick(void);
+
+/**
+ * Build status JSON (GET /api/mesh/channel)
+ * @return cJSON object, caller must cJSON_Delete
+ */
+cJSON* channel_survey_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHANNEL_SURVEY_H
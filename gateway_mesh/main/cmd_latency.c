@@ -0,0 +1,250 @@
+/**
+ * OmniaPi Gateway Mesh - Command Latency Recorder Implementation
+ *
+ * Each context keeps a ring of the latest samples (ms); percentiles are
+ * computed on request from a sorted copy, so recording costs nothing but
+ * a store.
+ */
+
+#include "cmd_latency.h"
+#include "node_ota.h"
+#include "fleet_ota.h"
+#include "commissioning.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_app_desc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "CMD_LATENCY";
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint8_t  context;
+    int64_t  start_us;
+} pending_cmd_t;
+
+typedef struct {
+    uint16_t ms[CMD_LATENCY_SAMPLES];
+    uint32_t count;                     // Samples recorded (ring holds the latest)
+    uint32_t lost;
+} latency_ring_t;
+
+static const char *s_context_names[CMD_LATENCY_CONTEXTS] = {
+    "single", "burst", "ota", "scan",
+};
+
+static SemaphoreHandle_t s_mutex = NULL;
+static pending_cmd_t s_pending[CMD_LATENCY_MAX_PENDING];
+static latency_ring_t s_rings[CMD_LATENCY_CONTEXTS];
+static int64_t s_window_start_us = 0;
+static uint32_t s_overflow = 0;         // Commands not tracked (pending table full)
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int find_pending(const uint8_t *mac)
+{
+    for (int i = 0; i < CMD_LATENCY_MAX_PENDING; i++) {
+        if (s_pending[i].used && memcmp(s_pending[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Count timed out commands as lost (caller holds the mutex)
+ */
+static int expire_pending(int64_t now_us)
+{
+    int outstanding = 0;
+    for (int i = 0; i < CMD_LATENCY_MAX_PENDING; i++) {
+        pending_cmd_t *p = &s_pending[i];
+        if (!p->used) continue;
+        if (now_us - p->start_us > (int64_t)CMD_LATENCY_TIMEOUT_MS * 1000) {
+            s_rings[p->context].lost++;
+            p->used = false;
+        } else {
+            outstanding++;
+        }
+    }
+    return outstanding;
+}
+
+static int compare_u16(const void *a, const void *b)
+{
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static uint16_t percentile(const uint16_t *sorted, int n, int pct)
+{
+    // Nearest rank
+    int rank = (pct * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t cmd_latency_init(void)
+{
+    if (s_mutex != NULL) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == NULL) return ESP_ERR_NO_MEM;
+
+    s_window_start_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+void cmd_latency_start(const uint8_t *mac)
+{
+    if (s_mutex == NULL || mac == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int64_t now = esp_timer_get_time();
+    int outstanding = expire_pending(now);
+
+    // A second command to the same node restarts its clock
+    int idx = find_pending(mac);
+    if (idx >= 0) {
+        outstanding--;
+    } else {
+        for (int i = 0; i < CMD_LATENCY_MAX_PENDING; i++) {
+            if (!s_pending[i].used) {
+                idx = i;
+                break;
+            }
+        }
+    }
+
+    if (idx < 0) {
+        s_overflow++;
+    } else {
+        cmd_latency_context_t context = CMD_LATENCY_SINGLE;
+        if (node_ota_is_active() || fleet_ota_is_active()) {
+            context = CMD_LATENCY_OTA;
+        } else if (commissioning_is_scanning()) {
+            context = CMD_LATENCY_SCAN;
+        } else if (outstanding > 0) {
+            context = CMD_LATENCY_BURST;
+        }
+
+        pending_cmd_t *p = &s_pending[idx];
+        p->used = true;
+        memcpy(p->mac, mac, 6);
+        p->context = context;
+        p->start_us = now;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void cmd_latency_cancel(const uint8_t *mac)
+{
+    if (s_mutex == NULL || mac == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_pending(mac);
+    if (idx >= 0) {
+        s_pending[idx].used = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void cmd_latency_finish(const uint8_t *mac)
+{
+    if (s_mutex == NULL || mac == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_pending(mac);
+    if (idx >= 0) {
+        pending_cmd_t *p = &s_pending[idx];
+        int64_t ms = (esp_timer_get_time() - p->start_us) / 1000;
+        latency_ring_t *ring = &s_rings[p->context];
+
+        if (ms > CMD_LATENCY_TIMEOUT_MS) {
+            ring->lost++;
+        } else {
+            ring->ms[ring->count % CMD_LATENCY_SAMPLES] = (uint16_t)ms;
+            ring->count++;
+            ESP_LOGD(TAG, "Command latency %lld ms (%s)", ms, s_context_names[p->context]);
+        }
+        p->used = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void cmd_latency_reset(void)
+{
+    if (s_mutex == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    memset(s_pending, 0, sizeof(s_pending));
+    memset(s_rings, 0, sizeof(s_rings));
+    s_overflow = 0;
+    s_window_start_us = esp_timer_get_time();
+
+    xSemaphoreGive(s_mutex);
+    ESP_LOGI(TAG, "Latency window reset");
+}
+
+cJSON* cmd_latency_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    const esp_app_desc_t *desc = esp_app_get_description();
+    cJSON_AddStringToObject(json, "firmware", desc->version);
+
+    if (s_mutex == NULL || xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return json;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int outstanding = expire_pending(now);
+    uint32_t window_ms = (uint32_t)((now - s_window_start_us) / 1000);
+    uint32_t completed = 0;
+
+    // Sort a copy of one ring at a time (static: too big for the httpd stack)
+    static uint16_t sorted[CMD_LATENCY_SAMPLES];
+    cJSON *contexts = cJSON_CreateObject();
+    for (int c = 0; c < CMD_LATENCY_CONTEXTS; c++) {
+        latency_ring_t *ring = &s_rings[c];
+        int n = ring->count < CMD_LATENCY_SAMPLES ? (int)ring->count : CMD_LATENCY_SAMPLES;
+        completed += ring->count;
+
+        cJSON *ctx = cJSON_CreateObject();
+        cJSON_AddNumberToObject(ctx, "samples", ring->count);
+        cJSON_AddNumberToObject(ctx, "lost", ring->lost);
+        if (n > 0) {
+            memcpy(sorted, ring->ms, n * sizeof(uint16_t));
+            qsort(sorted, n, sizeof(uint16_t), compare_u16);
+            cJSON_AddNumberToObject(ctx, "p50_ms", percentile(sorted, n, 50));
+            cJSON_AddNumberToObject(ctx, "p95_ms", percentile(sorted, n, 95));
+            cJSON_AddNumberToObject(ctx, "p99_ms", percentile(sorted, n, 99));
+            cJSON_AddNumberToObject(ctx, "max_ms", sorted[n - 1]);
+        }
+        cJSON_AddItemToObject(contexts, s_context_names[c], ctx);
+    }
+
+    cJSON_AddNumberToObject(json, "window_ms", window_ms);
+    cJSON_AddNumberToObject(json, "completed", completed);
+    cJSON_AddNumberToObject(json, "per_sec", window_ms ? completed * 1000.0 / window_ms : 0);
+    cJSON_AddNumberToObject(json, "outstanding", outstanding);
+    cJSON_AddNumberToObject(json, "untracked", s_overflow);
+    cJSON_AddItemToObject(json, "contexts", contexts);
+
+    xSemaphoreGive(s_mutex);
+    return json;
+}
@@ -0,0 +1,76 @@
+/**
+ * OmniaPi Gateway Mesh - Command Latency Recorder
+ *
+ * Measures the MQTT command path end to end inside the gateway: from a
+ * cmd/relay message arriving to the node's .../state publish going out.
+ * Samples are kept per context (single command, burst with others still
+ * outstanding, during node OTA, during a scan) and reported as
+ * p50/p95/p99 plus throughput, as JSON, so runs against different firmware
+ * versions can be compared by a script.
+ */
+
+#ifndef CMD_LATENCY_H
+#define CMD_LATENCY_H
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define CMD_LATENCY_MAX_PENDING     32      // Commands awaiting their state publish
+#define CMD_LATENCY_SAMPLES         256     // Latest samples kept per context
+#define CMD_LATENCY_TIMEOUT_MS      5000    // Unanswered after this = lost
+
+typedef enum {
+    CMD_LATENCY_SINGLE = 0,     // Nothing else outstanding
+    CMD_LATENCY_BURST,          // Other commands still outstanding (scenes)
+    CMD_LATENCY_OTA,            // Node or fleet OTA running
+    CMD_LATENCY_SCAN,           // Commissioning scan running
+    CMD_LATENCY_CONTEXTS
+} cmd_latency_context_t;
+
+/**
+ * Initialize the recorder
+ * @return ESP_OK on success
+ */
+esp_err_t cmd_latency_init(void);
+
+/**
+ * A command for mac was received and is about to be sent
+ */
+void cmd_latency_start(const uint8_t *mac);
+
+/**
+ * The command for mac could not be sent (no sample)
+ */
+void cmd_latency_cancel(const uint8_t *mac);
+
+/**
+ * The node's state was published: close its outstanding command
+ */
+void cmd_latency_finish(const uint8_t *mac);
+
+/**
+ * Drop all samples and start a new measurement window
+ */
+void cmd_latency_reset(void);
+
+/**
+ * Report: per context samples, lost, p50/p95/p99/max (ms), plus
+ * commands/s over the window and the firmware version
+ * @return cJSON object (caller must free)
+ */
+cJSON* cmd_latency_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CMD_LATENCY_H
@@ -1,5 +1,10 @@
 /**
  * OmniaPi Gateway - Configuration Manager Implementation
+ *
+ * Everything provisioned is kept as one versioned, CRC-checked blob in two
+ * NVS slots. A write always goes to the slot not holding the current
+ * config, with a higher generation, so a power cut mid-write leaves the
+ * previous config intact. Boot picks the newest valid slot.
  */
 
 #include "config_manager.h"
@@ -7,13 +12,52 @@
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_wifi.h"
+#include "esp_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
 
 static const char *TAG = "CONFIG_MGR";
 
 // ============================================================================
-// NVS Keys
+// Config Blob
+// ============================================================================
+#define CONFIG_BLOB_MAGIC       0x4746434F  // "OCFG"
+#define CONFIG_BLOB_VERSION     1
+
+#define NVS_KEY_BLOB_A          "cfg_a"
+#define NVS_KEY_BLOB_B          "cfg_b"
+
+#define CONFIG_BLOB_WIFI        0x01    // WiFi STA provisioned
+#define CONFIG_BLOB_MQTT        0x02    // MQTT provisioned
+#define CONFIG_BLOB_MESH_PASS   0x04    // Mesh AP password set
+
+/**
+ * Persisted image of the configuration (both slots use this layout)
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;              // sizeof(config_blob_t)
+    uint32_t generation;        // Incremented on every write
+    uint8_t  flags;             // CONFIG_BLOB_*
+    uint8_t  mesh_channel;      // 0 = Kconfig default
+    char     wifi_ssid[33];
+    char     wifi_pass[65];
+    char     mqtt_uri[128];
+    char     mqtt_user[33];
+    char     mqtt_pass[65];
+    char     mqtt_client[33];   // Empty = derived from gateway ID
+    char     mesh_pass[65];
+    char     provision_code[7];
+    uint32_t crc;               // Over all bytes before this field
+} config_blob_t;
+
+// ============================================================================
+// Legacy NVS Keys (one key per setting, migrated into the blob once)
 // ============================================================================
 #define NVS_KEY_WIFI_SSID       "wifi_ssid"
 #define NVS_KEY_WIFI_PASS       "wifi_pass"
@@ -35,6 +79,15 @@ static config_mqtt_t s_mqtt = {0};
 static config_mesh_t s_mesh = {0};
 static provision_state_t s_provision_state = PROVISION_STATE_UNCONFIGURED;
 
+// Persisted image, current slot and open transaction
+static config_blob_t s_stored = {0};
+static int s_slot = -1;                 // Slot holding s_stored (-1 = none)
+static int s_txn_depth = 0;
+static bool s_txn_dirty = false;
+static config_blob_t s_txn_snapshot;    // s_stored at the outermost config_begin()
+static SemaphoreHandle_t s_lock = NULL; // Recursive: held from config_begin() to config_commit()
+static config_store_stats_t s_stats = {0};
+
 // Gateway identifiers
 static char s_gateway_id[13] = {0};     // 12 hex chars + null
 static char s_hostname[20] = {0};       // "omniapi-XXXX" + null
@@ -44,6 +97,161 @@ static uint8_t s_mac[6] = {0};
 // Private Functions
 // ============================================================================
 
+static void copy_str(char *dst, const char *src, size_t size)
+{
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static uint32_t blob_crc(const config_blob_t *blob)
+{
+    return esp_crc32_le(0, (const uint8_t *)blob, offsetof(config_blob_t, crc));
+}
+
+/**
+ * Read one slot; ESP_OK only if it holds a complete blob of this version
+ */
+static esp_err_t read_slot(const char *key, config_blob_t *blob)
+{
+    size_t len = sizeof(*blob);
+    esp_err_t err = nvs_storage_load_blob(key, blob, &len);
+    if (err != ESP_OK) return err;
+
+    if (len != sizeof(*blob) || blob->magic != CONFIG_BLOB_MAGIC ||
+        blob->version != CONFIG_BLOB_VERSION || blob->size != sizeof(*blob)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (blob_crc(blob) != blob->crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Load the newest valid slot into s_stored
+ */
+static esp_err_t load_blob(void)
+{
+    static config_blob_t slots[2];
+    esp_err_t err_a = read_slot(NVS_KEY_BLOB_A, &slots[0]);
+    esp_err_t err_b = read_slot(NVS_KEY_BLOB_B, &slots[1]);
+
+    if (err_a != ESP_OK && err_a != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Config slot A unusable: %s", esp_err_to_name(err_a));
+    }
+    if (err_b != ESP_OK && err_b != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Config slot B unusable: %s", esp_err_to_name(err_b));
+    }
+
+    if (err_a == ESP_OK && err_b == ESP_OK) {
+        // Wrap-safe: the slot written last has the higher generation
+        s_slot = ((int32_t)(slots[1].generation - slots[0].generation) > 0) ? 1 : 0;
+    } else if (err_a == ESP_OK) {
+        s_slot = 0;
+    } else if (err_b == ESP_OK) {
+        s_slot = 1;
+    } else {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_stored = slots[s_slot];
+    return ESP_OK;
+}
+
+/**
+ * Setters run from httpd, the MQTT task and BLE provisioning; a
+ * transaction keeps the others out until it commits
+ */
+static void config_lock(void)
+{
+    if (s_lock != NULL) {
+        xSemaphoreTakeRecursive(s_lock, portMAX_DELAY);
+    }
+}
+
+static void config_unlock(void)
+{
+    if (s_lock != NULL) {
+        xSemaphoreGiveRecursive(s_lock);
+    }
+}
+
+/**
+ * Write s_stored to the other slot (one NVS commit)
+ */
+static esp_err_t write_blob(void)
+{
+    int slot = (s_slot == 0) ? 1 : 0;
+
+    s_stored.magic = CONFIG_BLOB_MAGIC;
+    s_stored.version = CONFIG_BLOB_VERSION;
+    s_stored.size = sizeof(s_stored);
+    s_stored.generation++;
+    s_stored.crc = blob_crc(&s_stored);
+
+    esp_err_t err = nvs_storage_save_blob(slot ? NVS_KEY_BLOB_B : NVS_KEY_BLOB_A,
+                                          &s_stored, sizeof(s_stored));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write config slot %c: %s", slot ? 'B' : 'A', esp_err_to_name(err));
+        s_stored.generation--;
+        return err;
+    }
+
+    s_slot = slot;
+    s_stats.commits++;
+    ESP_LOGI(TAG, "Config generation %lu written to slot %c",
+             (unsigned long)s_stored.generation, slot ? 'B' : 'A');
+    return ESP_OK;
+}
+
+/**
+ * Persist s_stored now, or at config_commit() if a transaction is open
+ */
+static esp_err_t save_config(void)
+{
+    if (s_txn_depth > 0) {
+        s_txn_dirty = true;
+        return ESP_OK;
+    }
+    return write_blob();
+}
+
+/**
+ * Build the blob from the per-setting keys written by older firmware
+ * (left in place so a downgrade still boots configured)
+ */
+static void migrate_legacy_keys(void)
+{
+    memset(&s_stored, 0, sizeof(s_stored));
+
+    if (nvs_storage_load_string(NVS_KEY_WIFI_SSID, s_stored.wifi_ssid, sizeof(s_stored.wifi_ssid)) == ESP_OK &&
+        strlen(s_stored.wifi_ssid) > 0) {
+        s_stored.flags |= CONFIG_BLOB_WIFI;
+        nvs_storage_load_string(NVS_KEY_WIFI_PASS, s_stored.wifi_pass, sizeof(s_stored.wifi_pass));
+    }
+
+    if (nvs_storage_load_string(NVS_KEY_MQTT_URI, s_stored.mqtt_uri, sizeof(s_stored.mqtt_uri)) == ESP_OK &&
+        strlen(s_stored.mqtt_uri) > 0) {
+        s_stored.flags |= CONFIG_BLOB_MQTT;
+        nvs_storage_load_string(NVS_KEY_MQTT_USER, s_stored.mqtt_user, sizeof(s_stored.mqtt_user));
+        nvs_storage_load_string(NVS_KEY_MQTT_PASS, s_stored.mqtt_pass, sizeof(s_stored.mqtt_pass));
+        nvs_storage_load_string(NVS_KEY_MQTT_CLIENT, s_stored.mqtt_client, sizeof(s_stored.mqtt_client));
+    }
+
+    if (nvs_storage_load_string(NVS_KEY_MESH_PASS, s_stored.mesh_pass, sizeof(s_stored.mesh_pass)) == ESP_OK &&
+        strlen(s_stored.mesh_pass) > 0) {
+        s_stored.flags |= CONFIG_BLOB_MESH_PASS;
+    }
+
+    nvs_storage_load_string(NVS_KEY_PROVISION_CODE, s_stored.provision_code, sizeof(s_stored.provision_code));
+
+    if (s_stored.flags != 0 || strlen(s_stored.provision_code) > 0) {
+        ESP_LOGI(TAG, "Migrating per-key configuration to config blob");
+        s_stats.migrated = true;
+        write_blob();
+    }
+}
+
 static void generate_gateway_identifiers(void)
 {
     // Get MAC address
@@ -62,22 +270,9 @@ static void generate_gateway_identifiers(void)
 
 static void load_wifi_sta_config(void)
 {
-    char ssid[33] = {0};
-    char pass[65] = {0};
-
-    // Try to load from NVS
-    esp_err_t err_ssid = nvs_storage_load_string(NVS_KEY_WIFI_SSID, ssid, sizeof(ssid));
-    esp_err_t err_pass = nvs_storage_load_string(NVS_KEY_WIFI_PASS, pass, sizeof(pass));
-
-    if (err_ssid == ESP_OK && strlen(ssid) > 0) {
-        // Use NVS values
-        strncpy(s_wifi_sta.ssid, ssid, sizeof(s_wifi_sta.ssid) - 1);
-        s_wifi_sta.ssid[sizeof(s_wifi_sta.ssid) - 1] = '\0';
-
-        if (err_pass == ESP_OK) {
-            strncpy(s_wifi_sta.password, pass, sizeof(s_wifi_sta.password) - 1);
-            s_wifi_sta.password[sizeof(s_wifi_sta.password) - 1] = '\0';
-        }
+    if (s_stored.flags & CONFIG_BLOB_WIFI) {
+        copy_str(s_wifi_sta.ssid, s_stored.wifi_ssid, sizeof(s_wifi_sta.ssid));
+        copy_str(s_wifi_sta.password, s_stored.wifi_pass, sizeof(s_wifi_sta.password));
         s_wifi_sta.configured = true;
         ESP_LOGI(TAG, "WiFi STA loaded from NVS: SSID=%s", s_wifi_sta.ssid);
     } else {
@@ -116,32 +311,11 @@ static void load_wifi_ap_config(void)
 
 static void load_mqtt_config(void)
 {
-    char uri[128] = {0};
-    char user[33] = {0};
-    char pass[65] = {0};
-    char client[33] = {0};
-
-    // Try to load from NVS
-    esp_err_t err_uri = nvs_storage_load_string(NVS_KEY_MQTT_URI, uri, sizeof(uri));
-
-    if (err_uri == ESP_OK && strlen(uri) > 0) {
-        // Use NVS values
-        strncpy(s_mqtt.broker_uri, uri, sizeof(s_mqtt.broker_uri) - 1);
-        s_mqtt.broker_uri[sizeof(s_mqtt.broker_uri) - 1] = '\0';
-
-        if (nvs_storage_load_string(NVS_KEY_MQTT_USER, user, sizeof(user)) == ESP_OK) {
-            strncpy(s_mqtt.username, user, sizeof(s_mqtt.username) - 1);
-            s_mqtt.username[sizeof(s_mqtt.username) - 1] = '\0';
-        }
-        if (nvs_storage_load_string(NVS_KEY_MQTT_PASS, pass, sizeof(pass)) == ESP_OK) {
-            strncpy(s_mqtt.password, pass, sizeof(s_mqtt.password) - 1);
-            s_mqtt.password[sizeof(s_mqtt.password) - 1] = '\0';
-        }
-        if (nvs_storage_load_string(NVS_KEY_MQTT_CLIENT, client, sizeof(client)) == ESP_OK) {
-            strncpy(s_mqtt.client_id, client, sizeof(s_mqtt.client_id) - 1);
-            s_mqtt.client_id[sizeof(s_mqtt.client_id) - 1] = '\0';
-        }
-
+    if (s_stored.flags & CONFIG_BLOB_MQTT) {
+        copy_str(s_mqtt.broker_uri, s_stored.mqtt_uri, sizeof(s_mqtt.broker_uri));
+        copy_str(s_mqtt.username, s_stored.mqtt_user, sizeof(s_mqtt.username));
+        copy_str(s_mqtt.password, s_stored.mqtt_pass, sizeof(s_mqtt.password));
+        copy_str(s_mqtt.client_id, s_stored.mqtt_client, sizeof(s_mqtt.client_id));
         s_mqtt.configured = true;
         ESP_LOGI(TAG, "MQTT loaded from NVS: URI=%s", s_mqtt.broker_uri);
     } else {
@@ -174,12 +348,8 @@ static void load_mqtt_config(void)
 
 static void load_mesh_config(void)
 {
-    char pass[65] = {0};
-
-    // Try to load from NVS
-    if (nvs_storage_load_string(NVS_KEY_MESH_PASS, pass, sizeof(pass)) == ESP_OK && strlen(pass) > 0) {
-        strncpy(s_mesh.ap_password, pass, sizeof(s_mesh.ap_password) - 1);
-        s_mesh.ap_password[sizeof(s_mesh.ap_password) - 1] = '\0';
+    if (s_stored.flags & CONFIG_BLOB_MESH_PASS) {
+        copy_str(s_mesh.ap_password, s_stored.mesh_pass, sizeof(s_mesh.ap_password));
         ESP_LOGI(TAG, "Mesh password loaded from NVS");
     } else {
 #ifdef CONFIG_MESH_AP_PASSWD
@@ -192,13 +362,15 @@ static void load_mesh_config(void)
         ESP_LOGI(TAG, "Mesh password using Kconfig defaults");
     }
 
-    // Channel - try NVS first
-    // For now, always use Kconfig
+    if (s_stored.mesh_channel >= 1 && s_stored.mesh_channel <= 14) {
+        s_mesh.channel = s_stored.mesh_channel;
+    } else {
 #ifdef CONFIG_MESH_CHANNEL
-    s_mesh.channel = CONFIG_MESH_CHANNEL;
+        s_mesh.channel = CONFIG_MESH_CHANNEL;
 #else
-    s_mesh.channel = 6;
+        s_mesh.channel = 6;
 #endif
+    }
 
 #ifdef CONFIG_MESH_MAX_LAYER
     s_mesh.max_layer = CONFIG_MESH_MAX_LAYER;
@@ -235,9 +407,27 @@ esp_err_t config_manager_init(void)
 {
     ESP_LOGI(TAG, "Initializing configuration manager...");
 
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateRecursiveMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     // Generate gateway identifiers from MAC
     generate_gateway_identifiers();
 
+    // Read the stored config once; everything below works from s_stored
+    int64_t start = esp_timer_get_time();
+    if (load_blob() == ESP_OK) {
+        ESP_LOGI(TAG, "Config generation %lu loaded from slot %c",
+                 (unsigned long)s_stored.generation, s_slot ? 'B' : 'A');
+    } else {
+        migrate_legacy_keys();
+    }
+    s_stats.load_us = (uint32_t)(esp_timer_get_time() - start);
+    ESP_LOGI(TAG, "Config load took %lu us", (unsigned long)s_stats.load_us);
+
     // Load all configurations
     load_wifi_ap_config();   // AP config first (uses MAC)
     load_wifi_sta_config();
@@ -308,34 +498,27 @@ esp_err_t config_set_wifi_sta(const char *ssid, const char *password)
 
     ESP_LOGI(TAG, "Setting WiFi STA: SSID=%s", ssid);
 
-    // Save to NVS
-    esp_err_t err = nvs_storage_save_string(NVS_KEY_WIFI_SSID, ssid);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save WiFi SSID: %s", esp_err_to_name(err));
-        return err;
-    }
-
+    config_lock();
+    config_blob_t prev = s_stored;
+    copy_str(s_stored.wifi_ssid, ssid, sizeof(s_stored.wifi_ssid));
     if (password != NULL) {
-        err = nvs_storage_save_string(NVS_KEY_WIFI_PASS, password);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to save WiFi password: %s", esp_err_to_name(err));
-            return err;
-        }
+        copy_str(s_stored.wifi_pass, password, sizeof(s_stored.wifi_pass));
     }
+    s_stored.flags |= CONFIG_BLOB_WIFI;
 
-    // Update runtime config
-    strncpy(s_wifi_sta.ssid, ssid, sizeof(s_wifi_sta.ssid) - 1);
-    s_wifi_sta.ssid[sizeof(s_wifi_sta.ssid) - 1] = '\0';
-
-    if (password != NULL) {
-        strncpy(s_wifi_sta.password, password, sizeof(s_wifi_sta.password) - 1);
-        s_wifi_sta.password[sizeof(s_wifi_sta.password) - 1] = '\0';
+    esp_err_t err = save_config();
+    if (err != ESP_OK) {
+        s_stored = prev;
+        config_unlock();
+        return err;
     }
 
-    s_wifi_sta.configured = true;
+    // Update runtime config
+    load_wifi_sta_config();
 
     // Update provision state
     determine_provision_state();
+    config_unlock();
 
     ESP_LOGI(TAG, "WiFi STA configuration saved");
     return ESP_OK;
@@ -350,39 +533,31 @@ esp_err_t config_set_mqtt(const char *broker_uri, const char *username, const ch
 
     ESP_LOGI(TAG, "Setting MQTT: URI=%s", broker_uri);
 
-    // Save to NVS
-    esp_err_t err = nvs_storage_save_string(NVS_KEY_MQTT_URI, broker_uri);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save MQTT URI: %s", esp_err_to_name(err));
-        return err;
+    // NULL keeps the stored username/password
+    config_lock();
+    config_blob_t prev = s_stored;
+    copy_str(s_stored.mqtt_uri, broker_uri, sizeof(s_stored.mqtt_uri));
+    if (username != NULL) {
+        copy_str(s_stored.mqtt_user, username, sizeof(s_stored.mqtt_user));
     }
-
-    if (username != NULL && strlen(username) > 0) {
-        nvs_storage_save_string(NVS_KEY_MQTT_USER, username);
+    if (password != NULL) {
+        copy_str(s_stored.mqtt_pass, password, sizeof(s_stored.mqtt_pass));
     }
+    s_stored.flags |= CONFIG_BLOB_MQTT;
 
-    if (password != NULL && strlen(password) > 0) {
-        nvs_storage_save_string(NVS_KEY_MQTT_PASS, password);
+    esp_err_t err = save_config();
+    if (err != ESP_OK) {
+        s_stored = prev;
+        config_unlock();
+        return err;
     }
 
     // Update runtime config
-    strncpy(s_mqtt.broker_uri, broker_uri, sizeof(s_mqtt.broker_uri) - 1);
-    s_mqtt.broker_uri[sizeof(s_mqtt.broker_uri) - 1] = '\0';
-
-    if (username != NULL) {
-        strncpy(s_mqtt.username, username, sizeof(s_mqtt.username) - 1);
-        s_mqtt.username[sizeof(s_mqtt.username) - 1] = '\0';
-    }
-
-    if (password != NULL) {
-        strncpy(s_mqtt.password, password, sizeof(s_mqtt.password) - 1);
-        s_mqtt.password[sizeof(s_mqtt.password) - 1] = '\0';
-    }
-
-    s_mqtt.configured = true;
+    load_mqtt_config();
 
     // Update provision state
     determine_provision_state();
+    config_unlock();
 
     ESP_LOGI(TAG, "MQTT configuration saved");
     return ESP_OK;
@@ -392,26 +567,76 @@ esp_err_t config_set_mesh(const char *ap_password, uint8_t channel)
 {
     ESP_LOGI(TAG, "Setting Mesh: channel=%d", channel);
 
+    config_lock();
+    config_blob_t prev = s_stored;
     if (ap_password != NULL && strlen(ap_password) > 0) {
-        esp_err_t err = nvs_storage_save_string(NVS_KEY_MESH_PASS, ap_password);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to save mesh password: %s", esp_err_to_name(err));
-            return err;
-        }
-
-        strncpy(s_mesh.ap_password, ap_password, sizeof(s_mesh.ap_password) - 1);
-        s_mesh.ap_password[sizeof(s_mesh.ap_password) - 1] = '\0';
+        copy_str(s_stored.mesh_pass, ap_password, sizeof(s_stored.mesh_pass));
+        s_stored.flags |= CONFIG_BLOB_MESH_PASS;
     }
-
     if (channel >= 1 && channel <= 14) {
-        s_mesh.channel = channel;
-        // TODO: Save channel to NVS if needed
+        s_stored.mesh_channel = channel;
     }
 
+    esp_err_t err = save_config();
+    if (err != ESP_OK) {
+        s_stored = prev;
+        config_unlock();
+        return err;
+    }
+
+    load_mesh_config();
+    config_unlock();
+
     ESP_LOGI(TAG, "Mesh configuration saved");
     return ESP_OK;
 }
 
+// ============================================================================
+// Public Functions - Transactions
+// ============================================================================
+
+void config_begin(void)
+{
+    config_lock();
+    if (s_txn_depth++ == 0) {
+        s_txn_snapshot = s_stored;
+    }
+}
+
+esp_err_t config_commit(void)
+{
+    if (s_txn_depth == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (--s_txn_depth > 0 || !s_txn_dirty) {
+        config_unlock();
+        return ESP_OK;
+    }
+
+    s_txn_dirty = false;
+    esp_err_t err = write_blob();
+    if (err != ESP_OK) {
+        // Nothing of the transaction was stored: drop it from the runtime config too
+        s_stored = s_txn_snapshot;
+        load_wifi_sta_config();
+        load_mqtt_config();
+        load_mesh_config();
+        determine_provision_state();
+    }
+    config_unlock();
+    return err;
+}
+
+void config_get_store_stats(config_store_stats_t *stats)
+{
+    if (stats == NULL) return;
+    config_lock();
+    *stats = s_stats;
+    stats->generation = s_stored.generation;
+    stats->slot = s_slot;
+    config_unlock();
+}
+
 // ============================================================================
 // Public Functions - Provision Code
 // ============================================================================
@@ -425,11 +650,18 @@ esp_err_t config_set_provision_code(const char *code)
 
     ESP_LOGI(TAG, "Setting provision code: %s", code);
 
-    esp_err_t err = nvs_storage_save_string(NVS_KEY_PROVISION_CODE, code);
+    config_lock();
+    config_blob_t prev = s_stored;
+    copy_str(s_stored.provision_code, code, sizeof(s_stored.provision_code));
+
+    esp_err_t err = save_config();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to save provision code: %s", esp_err_to_name(err));
+        s_stored = prev;
+        config_unlock();
         return err;
     }
+    config_unlock();
 
     ESP_LOGI(TAG, "Provision code saved to NVS");
     return ESP_OK;
@@ -441,18 +673,34 @@ esp_err_t config_get_provision_code(char *buf, size_t buf_size)
         return ESP_ERR_INVALID_ARG;
     }
 
-    esp_err_t err = nvs_storage_load_string(NVS_KEY_PROVISION_CODE, buf, buf_size);
-    if (err != ESP_OK || strlen(buf) == 0) {
-        return ESP_ERR_NOT_FOUND;
+    config_lock();
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (strlen(s_stored.provision_code) > 0) {
+        copy_str(buf, s_stored.provision_code, buf_size);
+        err = ESP_OK;
     }
-
-    return ESP_OK;
+    config_unlock();
+    return err;
 }
 
 esp_err_t config_clear_provision_code(void)
 {
+    config_lock();
+    if (strlen(s_stored.provision_code) == 0) {
+        config_unlock();
+        return ESP_OK;
+    }
+
     ESP_LOGI(TAG, "Clearing provision code from NVS");
-    return nvs_storage_erase(NVS_KEY_PROVISION_CODE);
+    config_blob_t prev = s_stored;
+    memset(s_stored.provision_code, 0, sizeof(s_stored.provision_code));
+
+    esp_err_t err = save_config();
+    if (err != ESP_OK) {
+        s_stored = prev;
+    }
+    config_unlock();
+    return err;
 }
 
 // ============================================================================
@@ -463,8 +711,12 @@ esp_err_t config_factory_reset(void)
 {
     ESP_LOGW(TAG, "Performing factory reset - clearing all NVS configuration");
 
-    // Erase entire omniapi namespace
+    // Erase entire omniapi namespace (both config slots and legacy keys)
+    config_lock();
     nvs_storage_erase_all();
+    memset(&s_stored, 0, sizeof(s_stored));
+    s_slot = -1;
+    config_unlock();
 
     // Also clear WiFi stack's own NVS cache (set by esp_wifi_set_config)
     esp_wifi_restore();
@@ -483,6 +735,8 @@ void config_print_current(void)
     ESP_LOGI(TAG, "Gateway ID: %s", s_gateway_id);
     ESP_LOGI(TAG, "Hostname: %s", s_hostname);
     ESP_LOGI(TAG, "Provision State: %d", s_provision_state);
+    ESP_LOGI(TAG, "Config Generation: %lu (slot %c)", (unsigned long)s_stored.generation,
+             s_slot < 0 ? '-' : (s_slot ? 'B' : 'A'));
     ESP_LOGI(TAG, "--- WiFi STA ---");
     ESP_LOGI(TAG, "  SSID: %s", s_wifi_sta.ssid);
     ESP_LOGI(TAG, "  Password: %s", s_wifi_sta.configured ? "****" : "(default)");
@@ -3,6 +3,11 @@
  *
  * Manages gateway configuration with NVS persistence.
  * Falls back to Kconfig defaults if NVS is empty.
+ *
+ * The stored config is a single CRC-checked blob written alternately to
+ * two slots, so an interrupted write never loses the previous config.
+ * Each setter is one write; wrap several in config_begin()/config_commit()
+ * to store them together.
  */
 
 #ifndef CONFIG_MANAGER_H
@@ -68,6 +73,17 @@ typedef enum {
     PROVISION_STATE_CONFIGURED,         // Fully configured
 } provision_state_t;
 
+/**
+ * Config store statistics
+ */
+typedef struct {
+    uint32_t load_us;       // Time to read the stored config at boot
+    uint32_t commits;       // Blob writes since boot
+    uint32_t generation;    // Generation of the current config
+    int8_t slot;            // Slot holding it (0 = A, 1 = B, -1 = none)
+    bool migrated;          // Built from per-key NVS settings at this boot
+} config_store_stats_t;
+
 // ============================================================================
 // Initialization
 // ============================================================================
@@ -142,6 +158,29 @@ esp_err_t config_set_mqtt(const char *broker_uri, const char *username, const ch
  */
 esp_err_t config_set_mesh(const char *ap_password, uint8_t channel);
 
+// ============================================================================
+// Transactions
+// ============================================================================
+
+/**
+ * Start a transaction: setters update the runtime config and are stored
+ * together by config_commit() (nests). Setters from other tasks wait
+ * until it commits.
+ */
+void config_begin(void);
+
+/**
+ * End a transaction, writing the config once if anything changed. If the
+ * write fails, stored and runtime config go back to config_begin().
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if none is open
+ */
+esp_err_t config_commit(void);
+
+/**
+ * Get config store statistics (load time, writes)
+ */
+void config_get_store_stats(config_store_stats_t *stats);
+
 // ============================================================================
 // Provision Code (for backend association)
 // ============================================================================
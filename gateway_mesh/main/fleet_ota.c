@@ -0,0 +1,775 @@
+/**
+ * OmniaPi Gateway Mesh - Fleet OTA Rollout
+ *
+ * Scheduler on top of node_ota's staged-image sessions:
+ *  - canary nodes first, optionally holding for confirmation
+ *  - a node starts only once no node below it in the topology map is pending
+ *    or transferring, so parents reboot after their subtree has the image;
+ *    while any path is unknown this falls back to a per-layer barrier
+ *    (deepest layer first)
+ *  - parallel sessions grow while aggregate throughput keeps improving and
+ *    shrink when chunk resends show the links are saturated
+ *  - a node counts as updated once it rejoins reporting the target version
+ */
+
+#include "fleet_ota.h"
+#include "mesh_network.h"
+#include "mesh_topology.h"
+#include "mqtt_handler.h"
+#include "webserver.h"
+#include "omniapi_protocol.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "FLEET_OTA";
+
+#define LAYER_UNKNOWN_RANK  0xFF    // Unknown layer is scheduled as the deepest
+
+// ============================================================================
+// Internal State
+// ============================================================================
+
+static fleet_ota_status_t s_fleet = {0};
+static SemaphoreHandle_t s_mutex = NULL;
+
+static int64_t s_last_tick = 0;
+static int64_t s_last_report = 0;
+static bool s_report_pending = false;
+
+// Throughput probing
+static uint16_t s_last_chunk[FLEET_OTA_MAX_TARGETS];
+static uint32_t s_last_retries[FLEET_OTA_MAX_TARGETS];
+static int64_t s_window_start = 0;
+static uint32_t s_window_chunks = 0;
+static uint32_t s_window_retries = 0;
+static uint32_t s_best_throughput = 0;
+static bool s_concurrency_settled = false;
+static uint8_t s_barrier_layer = 0;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static const char *state_name(fleet_ota_state_t state)
+{
+    switch (state) {
+        case FLEET_OTA_STATE_IDLE:        return "idle";
+        case FLEET_OTA_STATE_CANARY:      return "canary";
+        case FLEET_OTA_STATE_CANARY_HOLD: return "canary_hold";
+        case FLEET_OTA_STATE_ROLLOUT:     return "rollout";
+        case FLEET_OTA_STATE_COMPLETE:    return "complete";
+        case FLEET_OTA_STATE_FAILED:      return "failed";
+        case FLEET_OTA_STATE_ABORTED:     return "aborted";
+        default:                          return "unknown";
+    }
+}
+
+static const char *target_state_name(fleet_target_state_t state)
+{
+    switch (state) {
+        case FLEET_TARGET_PENDING:   return "pending";
+        case FLEET_TARGET_UPDATING:  return "updating";
+        case FLEET_TARGET_VERIFYING: return "verifying";
+        case FLEET_TARGET_DONE:      return "done";
+        case FLEET_TARGET_FAILED:    return "failed";
+        case FLEET_TARGET_SKIPPED:   return "skipped";
+        default:                     return "unknown";
+    }
+}
+
+static uint8_t layer_rank(uint8_t layer)
+{
+    return (layer == 0) ? LAYER_UNKNOWN_RANK : layer;
+}
+
+static void set_target_state(fleet_target_t *t, fleet_target_state_t state)
+{
+    t->state = state;
+    t->state_since = now_ms();
+    if (state == FLEET_TARGET_DONE || state == FLEET_TARGET_FAILED) {
+        t->finished_at = t->state_since;
+    }
+    s_report_pending = true;
+}
+
+static void refresh_layer(fleet_target_t *t)
+{
+    const node_info_t *node = node_manager_get_node(t->mac);
+    if (node != NULL && node->mesh_layer != 0) {
+        t->layer = node->mesh_layer;
+    }
+}
+
+// Targets taking part in the current stage
+static bool in_stage(const fleet_target_t *t)
+{
+    return s_fleet.state != FLEET_OTA_STATE_CANARY || t->canary;
+}
+
+static void finish_rollout(fleet_ota_state_t state)
+{
+    s_fleet.state = state;
+    s_fleet.end_time = now_ms();
+    s_report_pending = true;
+
+    ESP_LOGI(TAG, "Rollout %s: %u done, %u failed, %u skipped of %u, total time %lld ms",
+             state_name(state), s_fleet.done, s_fleet.failed, s_fleet.skipped,
+             s_fleet.target_count, s_fleet.end_time - s_fleet.start_time);
+    webserver_log("[FLEET] Rollout %s: %u/%u updated in %lld s",
+                  state_name(state), s_fleet.done, s_fleet.target_count,
+                  (s_fleet.end_time - s_fleet.start_time) / 1000);
+}
+
+// ============================================================================
+// Status Reporting
+// ============================================================================
+
+cJSON* fleet_ota_status_json(bool with_nodes)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (json == NULL) {
+        return NULL;
+    }
+
+    cJSON_AddStringToObject(json, "type", "fleet_ota");
+    cJSON_AddStringToObject(json, "state", state_name(s_fleet.state));
+    cJSON_AddBoolToObject(json, "active", fleet_ota_is_active());
+    if (s_fleet.state == FLEET_OTA_STATE_IDLE) {
+        return json;
+    }
+
+    int updating = 0;
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        if (s_fleet.targets[i].state == FLEET_TARGET_UPDATING) {
+            updating++;
+        }
+    }
+
+    int64_t end = fleet_ota_is_active() ? now_ms() : s_fleet.end_time;
+
+    cJSON_AddStringToObject(json, "version", s_fleet.config.version);
+    cJSON_AddNumberToObject(json, "total", s_fleet.target_count);
+    cJSON_AddNumberToObject(json, "done", s_fleet.done);
+    cJSON_AddNumberToObject(json, "failed", s_fleet.failed);
+    cJSON_AddNumberToObject(json, "skipped", s_fleet.skipped);
+    cJSON_AddNumberToObject(json, "updating", updating);
+    cJSON_AddNumberToObject(json, "concurrency", s_fleet.concurrency);
+    cJSON_AddNumberToObject(json, "max_concurrency", s_fleet.config.max_concurrency);
+    cJSON_AddNumberToObject(json, "throughput_bps", s_fleet.throughput);
+    cJSON_AddNumberToObject(json, "image_size", s_fleet.image_size);
+    cJSON_AddNumberToObject(json, "elapsed_ms", (double)(end - s_fleet.start_time));
+
+    if (with_nodes) {
+        cJSON *nodes = cJSON_CreateArray();
+        for (int i = 0; i < s_fleet.target_count; i++) {
+            const fleet_target_t *t = &s_fleet.targets[i];
+            char mac_str[18];
+            snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(t->mac));
+
+            cJSON *node = cJSON_CreateObject();
+            cJSON_AddStringToObject(node, "mac", mac_str);
+            cJSON_AddNumberToObject(node, "layer", t->layer);
+            cJSON_AddStringToObject(node, "state", target_state_name(t->state));
+            cJSON_AddNumberToObject(node, "progress", t->progress);
+            cJSON_AddNumberToObject(node, "attempts", t->attempts);
+            cJSON_AddBoolToObject(node, "canary", t->canary);
+            cJSON_AddItemToArray(nodes, node);
+        }
+        cJSON_AddItemToObject(json, "nodes", nodes);
+    }
+
+    return json;
+}
+
+static void publish_status(void)
+{
+    cJSON *json = fleet_ota_status_json(true);
+    if (json == NULL) {
+        return;
+    }
+
+    char *json_str = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    if (json_str == NULL) {
+        return;
+    }
+
+    mqtt_publish(MQTT_TOPIC_FLEET_OTA_STATUS, json_str, 0, false);
+    webserver_ws_broadcast(json_str);
+    cJSON_free(json_str);
+
+    s_last_report = now_ms();
+    s_report_pending = false;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t fleet_ota_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    memset(&s_fleet, 0, sizeof(s_fleet));
+    ESP_LOGI(TAG, "Fleet OTA initialized");
+    return ESP_OK;
+}
+
+static int find_target(const uint8_t *mac)
+{
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        if (memcmp(s_fleet.targets[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void add_target(const uint8_t *mac)
+{
+    if (find_target(mac) >= 0) {
+        return;
+    }
+    if (s_fleet.target_count >= FLEET_OTA_MAX_TARGETS) {
+        return;
+    }
+
+    fleet_target_t *t = &s_fleet.targets[s_fleet.target_count++];
+    memset(t, 0, sizeof(*t));
+    memcpy(t->mac, mac, 6);
+    refresh_layer(t);
+    t->state = FLEET_TARGET_PENDING;
+    t->state_since = now_ms();
+
+    const node_info_t *node = node_manager_get_node(mac);
+    if (node != NULL && strcmp(node->firmware_version, s_fleet.config.version) == 0) {
+        t->state = FLEET_TARGET_SKIPPED;
+        s_fleet.skipped++;
+    }
+}
+
+esp_err_t fleet_ota_start(const fleet_ota_config_t *config, const uint8_t macs[][6], uint8_t count)
+{
+    if (config == NULL || config->version[0] == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (fleet_ota_is_active() || node_ota_is_active() || node_ota_active_sessions() > 0) {
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "OTA already in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t image_size = 0;
+    if (node_ota_verify_staged(&image_size) != ESP_OK) {
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "No valid node image staged");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    memset(&s_fleet, 0, sizeof(s_fleet));
+    s_fleet.config = *config;
+    s_fleet.config.version[sizeof(s_fleet.config.version) - 1] = '\0';
+    if (s_fleet.config.max_concurrency == 0 || s_fleet.config.max_concurrency > NODE_OTA_MAX_SESSIONS) {
+        s_fleet.config.max_concurrency = NODE_OTA_MAX_SESSIONS;
+    }
+    s_fleet.image_size = image_size;
+
+    // Collect targets
+    if (macs != NULL && count > 0) {
+        for (int i = 0; i < count; i++) {
+            add_target(macs[i]);
+        }
+    } else {
+        int node_count = 0;
+        node_info_t *nodes = node_manager_get_all(&node_count);
+        for (int i = 0; i < node_count; i++) {
+            if (!nodes[i].commissioned) {
+                continue;
+            }
+            if (config->device_type != 0 && nodes[i].device_type != config->device_type) {
+                continue;
+            }
+            add_target(nodes[i].mac);
+        }
+    }
+
+    if (s_fleet.target_count == s_fleet.skipped) {
+        uint8_t total = s_fleet.target_count;
+        memset(&s_fleet, 0, sizeof(s_fleet));
+        xSemaphoreGive(s_mutex);
+        ESP_LOGW(TAG, "No node needs version %s (%u already up to date)", config->version, total);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Deepest layer first (insertion sort, stable for equal layers)
+    for (int i = 1; i < s_fleet.target_count; i++) {
+        fleet_target_t tmp = s_fleet.targets[i];
+        int j = i - 1;
+        while (j >= 0 && layer_rank(s_fleet.targets[j].layer) < layer_rank(tmp.layer)) {
+            s_fleet.targets[j + 1] = s_fleet.targets[j];
+            j--;
+        }
+        s_fleet.targets[j + 1] = tmp;
+    }
+
+    // Canaries: the first pending nodes in schedule order (leaves, so a bad image strands no subtree)
+    uint8_t canaries = 0;
+    for (int i = 0; i < s_fleet.target_count && canaries < config->canary_count; i++) {
+        if (s_fleet.targets[i].state == FLEET_TARGET_PENDING) {
+            s_fleet.targets[i].canary = true;
+            canaries++;
+        }
+    }
+
+    memset(s_last_chunk, 0, sizeof(s_last_chunk));
+    memset(s_last_retries, 0, sizeof(s_last_retries));
+    s_window_start = now_ms();
+    s_window_chunks = 0;
+    s_window_retries = 0;
+    s_best_throughput = 0;
+    s_concurrency_settled = false;
+    s_barrier_layer = 0;
+
+    s_fleet.concurrency = 1;
+    s_fleet.start_time = now_ms();
+    s_fleet.state = (canaries > 0) ? FLEET_OTA_STATE_CANARY : FLEET_OTA_STATE_ROLLOUT;
+    s_report_pending = true;
+
+    ESP_LOGI(TAG, "Rollout of %s started: %u targets (%u skipped), %u canaries, max %u parallel, image %u bytes",
+             s_fleet.config.version, s_fleet.target_count, s_fleet.skipped, canaries,
+             s_fleet.config.max_concurrency, (unsigned)image_size);
+    webserver_log("[FLEET] Rollout of %s to %u nodes started",
+                  s_fleet.config.version, s_fleet.target_count - s_fleet.skipped);
+
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+esp_err_t fleet_ota_continue(void)
+{
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (s_fleet.state != FLEET_OTA_STATE_CANARY_HOLD) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Canaries confirmed, continuing rollout");
+    s_fleet.state = FLEET_OTA_STATE_ROLLOUT;
+    s_report_pending = true;
+
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+esp_err_t fleet_ota_abort(void)
+{
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (!fleet_ota_is_active()) {
+        xSemaphoreGive(s_mutex);
+        return ESP_OK;
+    }
+
+    ESP_LOGW(TAG, "Aborting rollout");
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        fleet_target_t *t = &s_fleet.targets[i];
+        if (t->state == FLEET_TARGET_UPDATING) {
+            node_ota_release_session(t->mac);
+            set_target_state(t, FLEET_TARGET_FAILED);
+            s_fleet.failed++;
+        }
+    }
+    finish_rollout(FLEET_OTA_STATE_ABORTED);
+    publish_status();
+
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+bool fleet_ota_is_active(void)
+{
+    return s_fleet.state == FLEET_OTA_STATE_CANARY ||
+           s_fleet.state == FLEET_OTA_STATE_CANARY_HOLD ||
+           s_fleet.state == FLEET_OTA_STATE_ROLLOUT;
+}
+
+const fleet_ota_status_t* fleet_ota_get_status(void)
+{
+    return &s_fleet;
+}
+
+// ============================================================================
+// Scheduler
+// ============================================================================
+
+static void retry_or_fail(fleet_target_t *t, const char *reason)
+{
+    if (t->attempts < FLEET_OTA_MAX_ATTEMPTS) {
+        ESP_LOGW(TAG, "Node " MACSTR " %s, retrying (%u/%u)",
+                 MAC2STR(t->mac), reason, t->attempts, FLEET_OTA_MAX_ATTEMPTS);
+        set_target_state(t, FLEET_TARGET_PENDING);
+    } else {
+        ESP_LOGE(TAG, "Node " MACSTR " %s, giving up", MAC2STR(t->mac), reason);
+        webserver_log("[FLEET] Node " MACSTR " failed: %s", MAC2STR(t->mac), reason);
+        set_target_state(t, FLEET_TARGET_FAILED);
+        s_fleet.failed++;
+    }
+}
+
+static void poll_updating(fleet_target_t *t, int idx)
+{
+    node_ota_session_info_t info;
+    if (node_ota_get_session_info(t->mac, &info) != ESP_OK) {
+        retry_or_fail(t, "lost its transfer session");
+        return;
+    }
+
+    // Feed the throughput window
+    if (info.current_chunk > s_last_chunk[idx]) {
+        s_window_chunks += info.current_chunk - s_last_chunk[idx];
+    }
+    s_last_chunk[idx] = info.current_chunk;
+    if (info.chunk_retries > s_last_retries[idx]) {
+        s_window_retries += info.chunk_retries - s_last_retries[idx];
+    }
+    s_last_retries[idx] = info.chunk_retries;
+
+    if (info.total_chunks > 0) {
+        t->progress = (info.current_chunk * 100) / info.total_chunks;
+    }
+
+    if (info.running) {
+        return;
+    }
+
+    node_ota_release_session(t->mac);
+    if (info.state == NODE_OTA_STATE_COMPLETE) {
+        ESP_LOGI(TAG, "Node " MACSTR " transferred in %lld ms (resumed at chunk %u), verifying",
+                 MAC2STR(t->mac), now_ms() - info.start_time_ms, info.resume_chunk);
+        t->progress = 100;
+        set_target_state(t, FLEET_TARGET_VERIFYING);
+    } else {
+        retry_or_fail(t, "transfer failed");
+    }
+}
+
+static void poll_verifying(fleet_target_t *t)
+{
+    const node_info_t *node = node_manager_get_node(t->mac);
+    if (node != NULL && node->status != NODE_STATUS_OFFLINE &&
+        strcmp(node->firmware_version, s_fleet.config.version) == 0) {
+        ESP_LOGI(TAG, "Node " MACSTR " running %s", MAC2STR(t->mac), s_fleet.config.version);
+        refresh_layer(t);
+        set_target_state(t, FLEET_TARGET_DONE);
+        s_fleet.done++;
+        return;
+    }
+
+    if (now_ms() - t->state_since > FLEET_OTA_VERIFY_TIMEOUT_MS) {
+        retry_or_fail(t, "did not rejoin with the new version");
+    }
+}
+
+static void adjust_concurrency(int updating, bool backlog)
+{
+    int64_t now = now_ms();
+    int64_t window = now - s_window_start;
+    if (window < FLEET_OTA_PROBE_MS) {
+        return;
+    }
+
+    uint32_t chunks = s_window_chunks;
+    uint32_t retries = s_window_retries;
+    s_window_start = now;
+    s_window_chunks = 0;
+    s_window_retries = 0;
+
+    if (chunks == 0) {
+        return;
+    }
+
+    s_fleet.throughput = (uint32_t)(((uint64_t)chunks * NODE_OTA_CHUNK_SIZE * 1000) / window);
+
+    // Only a window that ran at the limit says anything about the limit
+    if (updating < s_fleet.concurrency || !backlog) {
+        return;
+    }
+
+    uint8_t before = s_fleet.concurrency;
+    if (retries * 20 > chunks) {
+        // More than 5% resends: links are saturated
+        if (s_fleet.concurrency > 1) {
+            s_fleet.concurrency--;
+        }
+        s_concurrency_settled = true;
+    } else if (!s_concurrency_settled) {
+        if (s_best_throughput == 0 || s_fleet.throughput > s_best_throughput + s_best_throughput / 10) {
+            s_best_throughput = s_fleet.throughput;
+            if (s_fleet.concurrency < s_fleet.config.max_concurrency) {
+                s_fleet.concurrency++;
+            }
+        } else {
+            // Last step did not pay off
+            if (s_fleet.concurrency > 1) {
+                s_fleet.concurrency--;
+            }
+            s_concurrency_settled = true;
+        }
+    }
+
+    if (s_fleet.concurrency != before) {
+        ESP_LOGI(TAG, "Concurrency %u -> %u (%lu B/s, %lu resends in window)",
+                 before, s_fleet.concurrency, (unsigned long)s_fleet.throughput,
+                 (unsigned long)retries);
+        s_report_pending = true;
+    }
+}
+
+/**
+ * Mark the targets that are ancestors of a pending or transferring target
+ * @param blocked  Output, indexed like s_fleet.targets
+ * @return false if some active target's path is unknown (use the layer barrier)
+ */
+static bool mark_ancestors(bool *blocked)
+{
+    uint8_t path[TOPOLOGY_MAX_DEPTH][6];
+
+    memset(blocked, 0, sizeof(bool) * s_fleet.target_count);
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        const fleet_target_t *t = &s_fleet.targets[i];
+        if (!in_stage(t)) {
+            continue;
+        }
+        if (t->state != FLEET_TARGET_UPDATING &&
+            !(t->state == FLEET_TARGET_PENDING && mesh_network_is_node_reachable(t->mac))) {
+            continue;
+        }
+
+        int hops = mesh_topology_get_path(t->mac, path, TOPOLOGY_MAX_DEPTH);
+        if (hops < 0) {
+            return false;
+        }
+        for (int h = 0; h < hops; h++) {
+            int idx = find_target(path[h]);
+            if (idx >= 0) {
+                blocked[idx] = true;
+            }
+        }
+    }
+    return true;
+}
+
+static void schedule(void)
+{
+    int updating = 0;
+    int verifying = 0;
+    int pending = 0;
+    uint8_t barrier = 0;
+
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        fleet_target_t *t = &s_fleet.targets[i];
+        switch (t->state) {
+            case FLEET_TARGET_UPDATING:
+                poll_updating(t, i);
+                break;
+            case FLEET_TARGET_VERIFYING:
+                poll_verifying(t);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Deepest layer that still has work in flight or queued
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        fleet_target_t *t = &s_fleet.targets[i];
+        if (!in_stage(t)) {
+            continue;
+        }
+        if (t->state == FLEET_TARGET_UPDATING) {
+            updating++;
+        } else if (t->state == FLEET_TARGET_VERIFYING) {
+            verifying++;
+            continue;
+        } else if (t->state == FLEET_TARGET_PENDING) {
+            refresh_layer(t);
+            if (!mesh_network_is_node_reachable(t->mac)) {
+                continue;
+            }
+            pending++;
+        } else {
+            continue;
+        }
+        if (layer_rank(t->layer) > barrier) {
+            barrier = layer_rank(t->layer);
+        }
+    }
+
+    if (barrier != s_barrier_layer && barrier != 0) {
+        // Different hop count, different link capacity: probe again
+        if (s_barrier_layer != 0) {
+            ESP_LOGI(TAG, "Layer %u done, moving to layer %u", s_barrier_layer, barrier);
+        }
+        s_barrier_layer = barrier;
+        s_concurrency_settled = false;
+        s_best_throughput = 0;
+    }
+
+    if (s_fleet.state != FLEET_OTA_STATE_CANARY_HOLD) {
+        adjust_concurrency(updating, pending > 0);
+    }
+
+    // Start transfers on nodes with no active subtree, or on the barrier layer
+    // when the topology is incomplete (no new canaries once one has failed)
+    bool can_start = s_fleet.state == FLEET_OTA_STATE_ROLLOUT ||
+                     (s_fleet.state == FLEET_OTA_STATE_CANARY && s_fleet.failed == 0);
+    if (can_start) {
+        bool blocked[FLEET_OTA_MAX_TARGETS];
+        bool by_subtree = mark_ancestors(blocked);
+
+        for (int i = 0; i < s_fleet.target_count && updating < s_fleet.concurrency; i++) {
+            fleet_target_t *t = &s_fleet.targets[i];
+            if (!in_stage(t) || t->state != FLEET_TARGET_PENDING ||
+                (by_subtree ? blocked[i] : layer_rank(t->layer) != barrier) ||
+                !mesh_network_is_node_reachable(t->mac)) {
+                continue;
+            }
+
+            esp_err_t ret = node_ota_push_staged(t->mac);
+            if (ret == ESP_ERR_NO_MEM) {
+                break;  // All sessions busy (released ones free up next tick)
+            }
+            t->attempts++;
+            if (ret != ESP_OK) {
+                retry_or_fail(t, "could not start transfer");
+                continue;
+            }
+
+            ESP_LOGI(TAG, "Updating " MACSTR " (layer %u, attempt %u)",
+                     MAC2STR(t->mac), t->layer, t->attempts);
+            s_last_chunk[i] = 0;
+            s_last_retries[i] = 0;
+            t->progress = 0;
+            set_target_state(t, FLEET_TARGET_UPDATING);
+            updating++;
+        }
+    }
+
+    // Unreachable nodes cannot block the rollout once nothing else is going on
+    if (updating == 0 && verifying == 0 && pending == 0) {
+        for (int i = 0; i < s_fleet.target_count; i++) {
+            fleet_target_t *t = &s_fleet.targets[i];
+            if (in_stage(t) && t->state == FLEET_TARGET_PENDING) {
+                ESP_LOGW(TAG, "Node " MACSTR " unreachable", MAC2STR(t->mac));
+                set_target_state(t, FLEET_TARGET_FAILED);
+                s_fleet.failed++;
+            }
+        }
+    }
+}
+
+static void check_stage_complete(void)
+{
+    bool canary_failed = false;
+    bool stage_busy = false;
+    bool in_flight = false;
+
+    for (int i = 0; i < s_fleet.target_count; i++) {
+        const fleet_target_t *t = &s_fleet.targets[i];
+        if (!in_stage(t)) {
+            continue;
+        }
+        if (t->state == FLEET_TARGET_PENDING ||
+            t->state == FLEET_TARGET_UPDATING ||
+            t->state == FLEET_TARGET_VERIFYING) {
+            stage_busy = true;
+        }
+        if (t->state == FLEET_TARGET_UPDATING || t->state == FLEET_TARGET_VERIFYING) {
+            in_flight = true;
+        }
+        if (t->canary && t->state == FLEET_TARGET_FAILED) {
+            canary_failed = true;
+        }
+    }
+
+    if (s_fleet.state == FLEET_OTA_STATE_CANARY) {
+        if (canary_failed) {
+            // Stop before the image reaches anything else; let running canaries finish
+            if (!in_flight) {
+                ESP_LOGE(TAG, "Canary failed, rollout stopped");
+                finish_rollout(FLEET_OTA_STATE_FAILED);
+            }
+            return;
+        }
+        if (!stage_busy) {
+            int64_t elapsed = now_ms() - s_fleet.start_time;
+            if (s_fleet.config.pause_after_canary) {
+                ESP_LOGI(TAG, "Canaries updated in %lld ms, waiting for confirmation", elapsed);
+                s_fleet.state = FLEET_OTA_STATE_CANARY_HOLD;
+            } else {
+                ESP_LOGI(TAG, "Canaries updated in %lld ms, rolling out", elapsed);
+                s_fleet.state = FLEET_OTA_STATE_ROLLOUT;
+            }
+            s_report_pending = true;
+        }
+        return;
+    }
+
+    if (s_fleet.state == FLEET_OTA_STATE_ROLLOUT && !stage_busy) {
+        finish_rollout(s_fleet.failed > 0 ? FLEET_OTA_STATE_FAILED : FLEET_OTA_STATE_COMPLETE);
+    }
+}
+
+void fleet_ota_process(void)
+{
+    if (!fleet_ota_is_active() && !s_report_pending) {
+        return;
+    }
+
+    int64_t now = now_ms();
+    if (now - s_last_tick < FLEET_OTA_TICK_MS) {
+        return;
+    }
+    s_last_tick = now;
+
+    if (xSemaphoreTake(s_mutex, 0) != pdTRUE) {
+        return;
+    }
+
+    if (s_fleet.state == FLEET_OTA_STATE_CANARY ||
+        s_fleet.state == FLEET_OTA_STATE_ROLLOUT) {
+        schedule();
+        check_stage_complete();
+    }
+
+    if (s_report_pending || (fleet_ota_is_active() && now - s_last_report >= FLEET_OTA_REPORT_MS)) {
+        publish_status();
+    }
+
+    xSemaphoreGive(s_mutex);
+}
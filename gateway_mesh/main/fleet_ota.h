@@ -0,0 +1,149 @@
+/**
+ * OmniaPi Gateway Mesh - Fleet OTA Rollout
+ *
+ * Pushes the staged node image to a set of nodes: canary stage first, then
+ * the rest of the fleet, deepest mesh layer first so a parent never reboots
+ * while a child is still receiving through it.
+ */
+
+#ifndef FLEET_OTA_H
+#define FLEET_OTA_H
+
+#include "esp_err.h"
+#include "node_ota.h"
+#include "node_manager.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define FLEET_OTA_MAX_TARGETS       MAX_NODES
+#define FLEET_OTA_MAX_ATTEMPTS      3       // Transfers per node before giving up
+#define FLEET_OTA_VERIFY_TIMEOUT_MS 180000  // Node must rejoin with the new version within 3 min
+#define FLEET_OTA_TICK_MS           1000    // Scheduler period
+#define FLEET_OTA_PROBE_MS          15000   // Concurrency adjustment window
+#define FLEET_OTA_REPORT_MS         5000    // Periodic status publish while running
+
+// ============================================================================
+// Rollout State
+// ============================================================================
+typedef enum {
+    FLEET_OTA_STATE_IDLE = 0,
+    FLEET_OTA_STATE_CANARY,             // Updating canary nodes only
+    FLEET_OTA_STATE_CANARY_HOLD,        // Canaries OK, waiting for fleet_ota_continue()
+    FLEET_OTA_STATE_ROLLOUT,            // Updating remaining nodes
+    FLEET_OTA_STATE_COMPLETE,           // Every target updated (or skipped)
+    FLEET_OTA_STATE_FAILED,             // Canary failed or some targets failed
+    FLEET_OTA_STATE_ABORTED             // Aborted by user
+} fleet_ota_state_t;
+
+typedef enum {
+    FLEET_TARGET_PENDING = 0,
+    FLEET_TARGET_UPDATING,              // Transfer session running
+    FLEET_TARGET_VERIFYING,             // Transfer done, waiting for rejoin with new version
+    FLEET_TARGET_DONE,
+    FLEET_TARGET_FAILED,
+    FLEET_TARGET_SKIPPED                // Already running the target version
+} fleet_target_state_t;
+
+typedef struct {
+    uint8_t  mac[6];
+    uint8_t  layer;                     // Mesh layer at last check (0 = unknown)
+    fleet_target_state_t state;
+    uint8_t  progress;                  // Transfer progress 0-100
+    uint8_t  attempts;                  // Transfers started
+    bool     canary;
+    int64_t  state_since;               // Timestamp of last state change (ms)
+    int64_t  finished_at;               // DONE/FAILED timestamp (ms)
+} fleet_target_t;
+
+typedef struct {
+    char     version[16];               // Target version "x.y.z"
+    uint8_t  device_type;               // Only nodes of this type (0 = any)
+    uint8_t  canary_count;              // Nodes updated before the rest (0 = no canary stage)
+    uint8_t  max_concurrency;           // Upper bound for parallel transfers (1..NODE_OTA_MAX_SESSIONS)
+    bool     pause_after_canary;        // Wait for fleet_ota_continue() after canaries
+} fleet_ota_config_t;
+
+typedef struct {
+    fleet_ota_state_t state;
+    fleet_ota_config_t config;
+    fleet_target_t targets[FLEET_OTA_MAX_TARGETS];
+    uint8_t  target_count;
+    uint8_t  done;
+    uint8_t  failed;
+    uint8_t  skipped;
+    uint8_t  concurrency;               // Current parallel transfer limit
+    uint32_t throughput;                // Last measured rate (bytes/s, all sessions)
+    size_t   image_size;
+    int64_t  start_time;
+    int64_t  end_time;
+} fleet_ota_status_t;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize fleet OTA
+ * @return ESP_OK on success
+ */
+esp_err_t fleet_ota_init(void);
+
+/**
+ * Start a rollout of the staged image (see node_ota_flash_begin with NULL target)
+ * @param config       Rollout parameters
+ * @param macs         Target nodes (NULL = all known nodes matching device_type)
+ * @param count        Number of entries in macs
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a rollout or transfer is running,
+ *         ESP_ERR_NOT_FOUND if no image is staged or no node needs the update
+ */
+esp_err_t fleet_ota_start(const fleet_ota_config_t *config, const uint8_t macs[][6], uint8_t count);
+
+/**
+ * Proceed from the canary hold to the full rollout
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not holding
+ */
+esp_err_t fleet_ota_continue(void);
+
+/**
+ * Abort the rollout (running transfers are aborted)
+ * @return ESP_OK on success
+ */
+esp_err_t fleet_ota_abort(void);
+
+/**
+ * Drive the rollout (call periodically, self-throttles to FLEET_OTA_TICK_MS)
+ */
+void fleet_ota_process(void);
+
+/**
+ * Check if a rollout is running (canary, hold or rollout stage)
+ * @return true if active
+ */
+bool fleet_ota_is_active(void);
+
+/**
+ * Get rollout status
+ * @return Pointer to status (read-only)
+ */
+const fleet_ota_status_t* fleet_ota_get_status(void);
+
+/**
+ * Build rollout status JSON (same document published over MQTT/WebSocket)
+ * @param with_nodes  Include per-node entries
+ * @return cJSON object, caller must cJSON_Delete
+ */
+cJSON* fleet_ota_status_json(bool with_nodes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLEET_OTA_H
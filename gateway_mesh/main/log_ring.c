@@ -0,0 +1,525 @@
+/**
+ * OmniaPi Gateway Mesh - Log Ring Implementation
+ *
+ * Multi-producer ring without locks: a writer claims a sequence number with
+ * one atomic add and publishes the slot by storing seq + 1 in its commit
+ * word. Readers copy a slot and re-check the commit word (seqlock style), so
+ * a record overwritten while being read is dropped instead of torn.
+ */
+
+#include "log_ring.h"
+#include "nvs_storage.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_app_desc.h"
+#include "esp_memory_utils.h"
+#include "sdkconfig.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "LOG_RING";
+
+#define LOG_RING_MAGIC      0x4C4F4752  // "LOGR"
+
+// ============================================================================
+// Record Layout
+// ============================================================================
+typedef struct {
+    _Atomic uint32_t commit;            // seq + 1 once complete, 0 while written
+    uint32_t ts_ms;
+    const char *format;
+    uint8_t  len;                       // Bytes used in args
+    uint8_t  truncated;
+    uint8_t  args[LOG_RING_ARGS_MAX];
+} log_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t app_tag;                   // Format pointers are only valid for this image
+    log_record_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+// In RTC memory the records survive a panic or watchdog reset. The head
+// counter stays in DRAM (atomic RMW needs internal SRAM); after a reset it
+// is recovered from the commit words.
+#if CONFIG_GATEWAY_LOG_POSTMORTEM
+static RTC_NOINIT_ATTR log_ring_t s_ring;
+#else
+static log_ring_t s_ring;
+#endif
+static _Atomic uint32_t s_head = 0;
+
+// Capture cost (plain adds: diagnostics only)
+static _Atomic uint32_t s_calls = 0;
+static uint32_t s_truncated = 0;
+static uint64_t s_total_cycles = 0;
+static uint32_t s_max_cycles = 0;
+
+typedef enum {
+    ARG_NONE = 0,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_PTR,
+    ARG_DOUBLE,
+    ARG_STR
+} arg_kind_t;
+
+// ============================================================================
+// Format Parsing
+// ============================================================================
+
+/**
+ * Parse a conversion after '%'
+ * @param p      First char after '%'
+ * @param kind   Argument type consumed by the conversion
+ * @param stars  Number of '*' width/precision int arguments before it
+ * @return Pointer past the conversion character
+ */
+static const char *parse_spec(const char *p, arg_kind_t *kind, int *stars)
+{
+    *stars = 0;
+    while (*p && strchr("-+ #0", *p)) p++;
+    if (*p == '*') {
+        (*stars)++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            (*stars)++;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') p++;
+        }
+    }
+
+    int size = 0;       // 0 int, 1 long, 2 long long, 3 size_t
+    switch (*p) {
+        case 'h': p++; if (*p == 'h') p++; break;
+        case 'l': p++; size = 1; if (*p == 'l') { p++; size = 2; } break;
+        case 'j': p++; size = 2; break;
+        case 'z': case 't': p++; size = 3; break;
+        default: break;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            *kind = (size == 0) ? ARG_INT : (size == 1) ? ARG_LONG :
+                    (size == 2) ? ARG_LLONG : ARG_SIZE;
+            break;
+        case 's':
+            *kind = ARG_STR;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            *kind = ARG_DOUBLE;
+            break;
+        case 'p':
+            *kind = ARG_PTR;
+            break;
+        default:
+            *kind = ARG_NONE;
+            break;
+    }
+    if (*p) p++;
+    return p;
+}
+
+static bool put_arg(log_record_t *rec, const void *value, size_t size)
+{
+    if (rec->len + size > LOG_RING_ARGS_MAX) {
+        return false;
+    }
+    memcpy(&rec->args[rec->len], value, size);
+    rec->len += size;
+    return true;
+}
+
+static bool get_arg(const log_record_t *rec, size_t *pos, void *value, size_t size)
+{
+    if (*pos + size > rec->len) {
+        return false;
+    }
+    memcpy(value, &rec->args[*pos], size);
+    *pos += size;
+    return true;
+}
+
+#define PUT_ARG(type) do { \
+        type v_ = va_arg(args, type); \
+        if (!put_arg(rec, &v_, sizeof(v_))) goto full; \
+    } while (0)
+
+static void marshal_args(log_record_t *rec, const char *format, va_list args)
+{
+    rec->len = 0;
+    rec->truncated = 0;
+
+    for (const char *p = format; *p; ) {
+        if (*p++ != '%') continue;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        arg_kind_t kind;
+        int stars;
+        p = parse_spec(p, &kind, &stars);
+        for (int i = 0; i < stars; i++) {
+            PUT_ARG(int);
+        }
+
+        switch (kind) {
+            case ARG_INT:    PUT_ARG(int); break;
+            case ARG_LONG:   PUT_ARG(long); break;
+            case ARG_LLONG:  PUT_ARG(long long); break;
+            case ARG_SIZE:   PUT_ARG(size_t); break;
+            case ARG_PTR:    PUT_ARG(void *); break;
+            case ARG_DOUBLE: PUT_ARG(double); break;
+            case ARG_STR: {
+                const char *s = va_arg(args, const char *);
+                if (s == NULL) s = "(null)";
+                size_t room = LOG_RING_ARGS_MAX - rec->len;
+                if (room < 2) goto full;
+                size_t n = strnlen(s, LOG_RING_STR_MAX);
+                if (n > room - 1) n = room - 1;
+                rec->args[rec->len++] = (uint8_t)n;
+                memcpy(&rec->args[rec->len], s, n);
+                rec->len += n;
+                break;
+            }
+            default:
+                goto full;  // Unknown conversion: can't know what to consume
+        }
+    }
+    return;
+
+full:
+    rec->truncated = 1;
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+#define EMIT(value) do { \
+        int n_ = (stars == 0) ? snprintf(out + pos, size - pos, spec, value) : \
+                 (stars == 1) ? snprintf(out + pos, size - pos, spec, star[0], value) : \
+                 snprintf(out + pos, size - pos, spec, star[0], star[1], value); \
+        if (n_ > 0) pos += n_; \
+        if (pos >= size) pos = size - 1; \
+    } while (0)
+
+#define GET_EMIT(type) do { \
+        type v_; \
+        if (!get_arg(rec, &rd, &v_, sizeof(v_))) goto truncated; \
+        EMIT(v_); \
+    } while (0)
+
+static void render_record(const log_record_t *rec, char *out, size_t size)
+{
+    size_t pos = 0;
+    size_t rd = 0;
+    const char *p = rec->format;
+
+    while (*p && pos < size - 1) {
+        if (*p != '%') {
+            out[pos++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[pos++] = '%';
+            p += 2;
+            continue;
+        }
+
+        const char *spec_start = p;
+        arg_kind_t kind;
+        int stars;
+        p = parse_spec(p + 1, &kind, &stars);
+
+        char spec[16];
+        size_t spec_len = p - spec_start;
+        if (spec_len >= sizeof(spec)) goto truncated;
+        memcpy(spec, spec_start, spec_len);
+        spec[spec_len] = '\0';
+
+        int star[2] = {0, 0};
+        for (int i = 0; i < stars; i++) {
+            if (!get_arg(rec, &rd, &star[i], sizeof(int))) goto truncated;
+        }
+
+        switch (kind) {
+            case ARG_INT:    GET_EMIT(int); break;
+            case ARG_LONG:   GET_EMIT(long); break;
+            case ARG_LLONG:  GET_EMIT(long long); break;
+            case ARG_SIZE:   GET_EMIT(size_t); break;
+            case ARG_PTR:    GET_EMIT(void *); break;
+            case ARG_DOUBLE: GET_EMIT(double); break;
+            case ARG_STR: {
+                uint8_t n;
+                char str[LOG_RING_STR_MAX + 1];
+                if (!get_arg(rec, &rd, &n, 1) || n > LOG_RING_STR_MAX ||
+                    !get_arg(rec, &rd, str, n)) {
+                    goto truncated;
+                }
+                str[n] = '\0';
+                EMIT(str);
+                break;
+            }
+            default:
+                goto truncated;
+        }
+    }
+    out[pos] = '\0';
+    return;
+
+truncated:
+    out[pos] = '\0';
+    if (pos + 4 < size) {
+        strcat(out, "...");
+    }
+}
+
+// ============================================================================
+// Capture
+// ============================================================================
+
+void log_ring_vwrite(const char *format, va_list args)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    uint32_t seq = atomic_fetch_add(&s_head, 1);
+    log_record_t *rec = &s_ring.records[seq & (LOG_RING_SIZE - 1)];
+
+    atomic_store_explicit(&rec->commit, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    rec->ts_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    rec->format = format;
+    marshal_args(rec, format, args);
+
+    atomic_store_explicit(&rec->commit, seq + 1, memory_order_release);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    atomic_fetch_add(&s_calls, 1);
+    s_total_cycles += cycles;
+    if (cycles > s_max_cycles) s_max_cycles = cycles;
+    if (rec->truncated) s_truncated++;
+}
+
+uint32_t log_ring_head(void)
+{
+    return atomic_load(&s_head);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+typedef enum {
+    READ_OK,
+    READ_PENDING,       // Writer still filling the slot
+    READ_LOST           // Overwritten by a newer record
+} read_result_t;
+
+static read_result_t read_record(uint32_t seq, log_entry_t *entry)
+{
+    const log_record_t *slot = &s_ring.records[seq & (LOG_RING_SIZE - 1)];
+    log_record_t copy;
+
+    uint32_t c1 = atomic_load_explicit(&slot->commit, memory_order_acquire);
+    if (c1 == 0) return READ_PENDING;
+    if (c1 != seq + 1) return READ_LOST;
+
+    memcpy(&copy, slot, sizeof(copy));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->commit, memory_order_relaxed) != c1) {
+        return READ_LOST;
+    }
+
+    entry->timestamp = copy.ts_ms / 1000;
+    render_record(&copy, entry->message, sizeof(entry->message));
+    return READ_OK;
+}
+
+int log_ring_read(uint32_t *cursor, log_entry_t *entries, int max, uint32_t *skipped)
+{
+    uint32_t head = atomic_load(&s_head);
+    int count = 0;
+
+    if (head - *cursor > LOG_RING_SIZE) {
+        if (skipped) *skipped += head - LOG_RING_SIZE - *cursor;
+        *cursor = head - LOG_RING_SIZE;
+    }
+
+    while (*cursor != head && count < max) {
+        read_result_t r = read_record(*cursor, &entries[count]);
+        if (r == READ_PENDING) {
+            break;
+        }
+        if (r == READ_OK) {
+            count++;
+        } else if (skipped) {
+            (*skipped)++;
+        }
+        (*cursor)++;
+    }
+    return count;
+}
+
+int log_ring_read_last(log_entry_t *entries, int max)
+{
+    uint32_t head = atomic_load(&s_head);
+    uint32_t n = (max < LOG_RING_SIZE) ? max : LOG_RING_SIZE;
+    uint32_t cursor = (head > n) ? head - n : 0;
+    return log_ring_read(&cursor, entries, max, NULL);
+}
+
+void log_ring_get_stats(log_ring_stats_t *stats)
+{
+    uint32_t calls = atomic_load(&s_calls);
+    stats->calls = calls;
+    stats->truncated = s_truncated;
+    stats->avg_cycles = calls ? (uint32_t)(s_total_cycles / calls) : 0;
+    stats->max_cycles = s_max_cycles;
+}
+
+// ============================================================================
+// Post-mortem
+// ============================================================================
+
+static uint32_t app_tag(void)
+{
+    const esp_app_desc_t *desc = esp_app_get_description();
+    uint32_t tag;
+    memcpy(&tag, desc->app_elf_sha256, sizeof(tag));
+    return tag;
+}
+
+#if CONFIG_GATEWAY_LOG_POSTMORTEM
+static bool reset_was_crash(void)
+{
+    switch (esp_reset_reason()) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Format the previous boot's newest records as "ts\tmsg\n" lines into NVS
+ */
+static void save_postmortem(void)
+{
+    char *text = malloc(LOG_RING_PM_BYTES);
+    if (text == NULL) return;
+
+    uint32_t head = 0;
+    for (int i = 0; i < LOG_RING_SIZE; i++) {
+        uint32_t commit = atomic_load(&s_ring.records[i].commit);
+        if (commit > head) head = commit;
+    }
+    uint32_t first = (head > LOG_RING_SIZE) ? head - LOG_RING_SIZE : 0;
+    size_t used = 0;
+    int saved = 0;
+    log_entry_t entry;
+
+    // Newest records matter most: skip the oldest until the rest fits
+    for (uint32_t seq = first; seq != head; seq++) {
+        const log_record_t *slot = &s_ring.records[seq & (LOG_RING_SIZE - 1)];
+        if (atomic_load(&slot->commit) != seq + 1 || !esp_ptr_in_drom(slot->format)) {
+            continue;
+        }
+        if (read_record(seq, &entry) != READ_OK) {
+            continue;
+        }
+        char line[LOG_LINE_MAX + 16];
+        int len = snprintf(line, sizeof(line), "%lu\t%s\n",
+                           (unsigned long)entry.timestamp, entry.message);
+        if (len <= 0 || len >= LOG_RING_PM_BYTES) continue;
+        if (used + len >= LOG_RING_PM_BYTES) {
+            char *cut = memchr(text, '\n', used);
+            while (cut && used + len >= LOG_RING_PM_BYTES) {
+                size_t drop = cut - text + 1;
+                memmove(text, cut + 1, used - drop);
+                used -= drop;
+                saved--;
+                cut = memchr(text, '\n', used);
+            }
+        }
+        memcpy(text + used, line, len);
+        used += len;
+        saved++;
+    }
+
+    if (saved > 0) {
+        text[used] = '\0';
+        esp_err_t ret = nvs_storage_save_blob(LOG_RING_PM_KEY, text, used + 1);
+        ESP_LOGW(TAG, "Saved %d log records from crashed boot (%s)",
+                 saved, esp_err_to_name(ret));
+    }
+    free(text);
+}
+#endif
+
+int log_ring_read_postmortem(log_entry_t *entries, int max)
+{
+    char *text = malloc(LOG_RING_PM_BYTES);
+    if (text == NULL) return 0;
+
+    size_t len = LOG_RING_PM_BYTES;
+    int count = 0;
+    if (nvs_storage_load_blob(LOG_RING_PM_KEY, text, &len) == ESP_OK && len > 0) {
+        text[len - 1] = '\0';
+        char *save = NULL;
+        for (char *line = strtok_r(text, "\n", &save); line && count < max;
+             line = strtok_r(NULL, "\n", &save)) {
+            char *tab = strchr(line, '\t');
+            if (tab == NULL) continue;
+            *tab = '\0';
+            entries[count].timestamp = strtoul(line, NULL, 10);
+            strncpy(entries[count].message, tab + 1, LOG_LINE_MAX - 1);
+            entries[count].message[LOG_LINE_MAX - 1] = '\0';
+            count++;
+        }
+    }
+    free(text);
+    return count;
+}
+
+// ============================================================================
+// Init
+// ============================================================================
+
+void log_ring_init(void)
+{
+    uint32_t tag = app_tag();
+
+#if CONFIG_GATEWAY_LOG_POSTMORTEM
+    if (s_ring.magic == LOG_RING_MAGIC && s_ring.app_tag == tag && reset_was_crash()) {
+        save_postmortem();
+    }
+#endif
+
+    memset(s_ring.records, 0, sizeof(s_ring.records));
+    atomic_store(&s_head, 0);
+    s_ring.app_tag = tag;
+    s_ring.magic = LOG_RING_MAGIC;
+
+    ESP_LOGI(TAG, "Log ring ready (%d records x %u bytes)",
+             LOG_RING_SIZE, (unsigned)sizeof(log_record_t));
+}
@@ -0,0 +1,103 @@
+/**
+ * OmniaPi Gateway Mesh - Log Ring
+ *
+ * Web UI log records are captured in binary form (format string pointer,
+ * raw arguments, timestamp) into a lock-free ring. Text is only produced
+ * when records are read, so logging costs the caller a few hundred cycles.
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "esp_err.h"
+#include "webserver.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define LOG_RING_SIZE           64      // Records kept (power of 2)
+#define LOG_RING_ARGS_MAX       50      // Marshalled argument bytes per record
+#define LOG_RING_STR_MAX        40      // Longest %s argument copied into a record
+#define LOG_RING_PM_BYTES       2048    // Post-mortem text saved to NVS after a crash
+#define LOG_RING_PM_KEY         "log_pm"
+
+// ============================================================================
+// Capture Statistics
+// ============================================================================
+typedef struct {
+    uint32_t calls;                     // Records written since boot
+    uint32_t truncated;                 // Records whose arguments didn't fit
+    uint32_t avg_cycles;                // Mean CPU cycles per capture
+    uint32_t max_cycles;                // Worst capture
+} log_ring_stats_t;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize the ring. With CONFIG_GATEWAY_LOG_POSTMORTEM the ring lives in
+ * RTC memory; records left by a crashed boot are saved to NVS first.
+ * Call after nvs_storage_init().
+ */
+void log_ring_init(void);
+
+/**
+ * Capture a record. The format string must be a literal (only its pointer is
+ * stored); %s arguments are copied (up to LOG_RING_STR_MAX chars).
+ * Safe from any task, never blocks.
+ * @param format  Printf-style format string
+ * @param args    Arguments
+ */
+void log_ring_vwrite(const char *format, va_list args);
+
+/**
+ * Sequence number the next record will get
+ * @return Head sequence
+ */
+uint32_t log_ring_head(void);
+
+/**
+ * Format records starting at a cursor (for streaming readers)
+ * @param cursor   In: next sequence to read, out: advanced past returned records
+ * @param entries  Output entries
+ * @param max      Size of entries
+ * @param skipped  Incremented by records overwritten before they were read (may be NULL)
+ * @return Number of entries written
+ */
+int log_ring_read(uint32_t *cursor, log_entry_t *entries, int max, uint32_t *skipped);
+
+/**
+ * Format the newest records, oldest first
+ * @param entries  Output entries
+ * @param max      Size of entries
+ * @return Number of entries written
+ */
+int log_ring_read_last(log_entry_t *entries, int max);
+
+/**
+ * Load the records saved after the last crash
+ * @param entries  Output entries
+ * @param max      Size of entries
+ * @return Number of entries written (0 if none saved)
+ */
+int log_ring_read_postmortem(log_entry_t *entries, int max);
+
+/**
+ * Get capture cost statistics (approximate under concurrent writers)
+ * @param stats  Output
+ */
+void log_ring_get_stats(log_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_RING_H
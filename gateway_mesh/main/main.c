@@ -24,22 +24,32 @@
 #include "nvs_flash.h"
 #include "esp_mac.h"
 #include "esp_ota_ops.h"
+#include "esp_heap_caps.h"
 
 #include "lwip/sockets.h"
 #include "driver/gpio.h"
 
 #include "omniapi_protocol.h"
 #include "mesh_network.h"
+#include "mesh_fastpath.h"
+#include "mesh_router.h"
 #include "eth_manager.h"
 #include "wifi_manager.h"
 #include "mqtt_handler.h"
 #include "node_manager.h"
+#include "mesh_topology.h"
+#include "mesh_optimizer.h"
+#include "cmd_latency.h"
+#include "boot_profile.h"
+#include "channel_survey.h"
 #include "nvs_storage.h"
 #include "config_manager.h"
 #include "commissioning.h"
 #include "ota_manager.h"
 #include "node_ota.h"
+#include "fleet_ota.h"
 #include "webserver.h"
+#include "log_ring.h"
 #include "web_api.h"
 #include "status_led.h"
 #include "ble_prov.h"
@@ -61,6 +71,11 @@ static EventGroupHandle_t s_gateway_events = NULL;
 #define EVENT_MQTT_CONNECTED    BIT2
 #define EVENT_MESH_STARTED      BIT3
 #define EVENT_MESH_ROOT         BIT4
+#define EVENT_ETH_READY         BIT5    // Ethernet bring-up finished (ok or failed)
+
+// Longest wait for boot steps that run in parallel with app_main
+#define ETH_LINK_WAIT_MS        3000    // Unconfigured boot: decides BLE vs SoftAP
+#define ETH_READY_WAIT_MS       5000
 
 // ============================================================================
 // Global State
@@ -88,178 +103,12 @@ static void heartbeat_task(void *pvParameters);
 static void status_task(void *pvParameters);
 static esp_err_t init_nvs(void);
 static esp_err_t init_network(void);
+static void start_ethernet(void);
+static void eth_start_task(void *pvParameters);
+static void webserver_start_task(void *pvParameters);
 static esp_err_t start_provisioning_ap(void);
 static void captive_dns_task(void *pvParameters);
 static void print_banner(void);
-static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t len);
-
-// ============================================================================
-// Mesh Message Router
-// ============================================================================
-
-/**
- * Handle incoming mesh messages and route to appropriate handlers
- */
-static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t len)
-{
-    if (len < sizeof(omniapi_header_t)) {
-        ESP_LOGW(TAG, "Message too short: %d bytes", (int)len);
-        return;
-    }
-
-    const omniapi_message_t *msg = (const omniapi_message_t *)data;
-
-    // Validate magic
-    if (msg->header.magic != OMNIAPI_MAGIC) {
-        ESP_LOGW(TAG, "Invalid magic: 0x%04X", msg->header.magic);
-        return;
-    }
-
-    // Validate length
-    if (len < OMNIAPI_MSG_SIZE(msg->header.payload_len)) {
-        ESP_LOGW(TAG, "Payload truncated");
-        return;
-    }
-
-    ESP_LOGD(TAG, "RX from %02X:%02X:%02X:%02X:%02X:%02X msg_type=0x%02X",
-             src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
-             msg->header.msg_type);
-
-    // Route message based on type
-    switch (msg->header.msg_type) {
-        // Ignore messages that gateway sends (mesh echo)
-        case MSG_HEARTBEAT:
-            // Gateway sends these, ignore if echoed back
-            break;
-
-        // Node status messages
-        case MSG_HEARTBEAT_ACK:
-            node_manager_update_info(src_mac, (const payload_heartbeat_ack_t *)msg->payload);
-            break;
-
-        case MSG_NODE_ANNOUNCE: {
-            const payload_node_announce_t *announce = (const payload_node_announce_t *)msg->payload;
-            ESP_LOGI(TAG, "Node announce: type=%d, commissioned=%d, FW=0x%08lX",
-                     announce->device_type, announce->commissioned,
-                     (unsigned long)announce->firmware_version);
-
-            if (announce->commissioned) {
-                // Commissioned node: add to node_manager for normal operation
-                node_manager_add_node(src_mac);
-                // Update with announce data (device_type, firmware_version, commissioned)
-                node_manager_update_from_announce(src_mac, announce);
-                s_state.mesh_nodes_count = node_manager_get_count();
-                // Publish to MQTT
-                if (s_state.mqtt_connected) {
-                    mqtt_publish_node_connected(src_mac);
-                }
-            } else {
-                // Uncommissioned node: add to discovered list (scan results)
-                // This handles the case where node connects AFTER scan_request was sent
-                ESP_LOGI(TAG, "Uncommissioned node detected - adding to discovered list");
-                commissioning_add_discovered_node(
-                    announce->mac,
-                    announce->device_type,
-                    announce->firmware_version,
-                    announce->commissioned
-                );
-            }
-            break;
-        }
-
-        // Commissioning messages
-        case MSG_SCAN_REQUEST:
-            // Ignore - gateway sends these, shouldn't receive them
-            ESP_LOGD(TAG, "Ignoring scan request (gateway is sender)");
-            break;
-
-        case MSG_SCAN_RESPONSE:
-            ESP_LOGI(TAG, "=== SCAN RESPONSE RECEIVED ===");
-            commissioning_handle_scan_response(src_mac, msg);
-            break;
-
-        case MSG_COMMISSION_ACK:
-            commissioning_handle_commission_ack(src_mac, msg);
-            break;
-
-        case MSG_DECOMMISSION_ACK:
-            commissioning_handle_decommission_ack(src_mac, msg);
-            break;
-
-        // OTA messages from nodes (pull-mode - node requests chunks)
-        case MSG_OTA_REQUEST:
-            ota_manager_handle_request(src_mac, (const payload_ota_request_t *)msg->payload);
-            break;
-
-        case MSG_OTA_COMPLETE:
-            // Handle both pull-mode and push-mode OTA complete
-            ota_manager_handle_complete(src_mac, (const payload_ota_complete_t *)msg->payload);
-            node_ota_handle_complete(src_mac, (const payload_ota_complete_t *)msg->payload);
-            break;
-
-        case MSG_OTA_FAILED:
-            // Handle both pull-mode and push-mode OTA failed
-            ota_manager_handle_failed(src_mac, (const payload_ota_failed_t *)msg->payload);
-            node_ota_handle_failed(src_mac, (const payload_ota_failed_t *)msg->payload);
-            break;
-
-        // Push-mode OTA messages (gateway pushes to specific node)
-        case MSG_OTA_ACK:
-            node_ota_handle_ack(src_mac, (const payload_ota_ack_t *)msg->payload);
-            break;
-
-        // Relay/LED status updates
-        case MSG_RELAY_STATUS: {
-            const payload_relay_status_t *status = (const payload_relay_status_t *)msg->payload;
-            ESP_LOGI(TAG, "Relay status from %02X:%02X:%02X:%02X:%02X:%02X: ch=%d state=%d",
-                     src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
-                     status->channel, status->state);
-
-            // Update relay state in node_manager
-            node_info_t *relay_node = node_manager_get_node(src_mac);
-            if (relay_node) {
-                if (status->channel == 0) {
-                    relay_node->relay1 = status->state ? 1 : 0;
-                } else if (status->channel == 1) {
-                    relay_node->relay2 = status->state ? 1 : 0;
-                }
-
-                // Build JSON with known relay states and forward to MQTT
-                char state_json[96];
-                if (relay_node->relay1 >= 0 && relay_node->relay2 >= 0) {
-                    snprintf(state_json, sizeof(state_json),
-                             "{\"relay1\":%d,\"relay2\":%d}",
-                             relay_node->relay1, relay_node->relay2);
-                } else if (relay_node->relay1 >= 0) {
-                    snprintf(state_json, sizeof(state_json),
-                             "{\"relay1\":%d}", relay_node->relay1);
-                } else if (relay_node->relay2 >= 0) {
-                    snprintf(state_json, sizeof(state_json),
-                             "{\"relay2\":%d}", relay_node->relay2);
-                } else {
-                    break;  // No known state to publish
-                }
-
-                if (s_state.mqtt_connected) {
-                    mqtt_publish_node_state(src_mac, state_json);
-                }
-            }
-            break;
-        }
-
-        case MSG_LED_STATUS: {
-            const payload_led_status_t *status = (const payload_led_status_t *)msg->payload;
-            ESP_LOGI(TAG, "LED status: on=%d r=%d g=%d b=%d brightness=%d",
-                     status->on, status->r, status->g, status->b, status->brightness);
-            // TODO: Forward to MQTT
-            break;
-        }
-
-        default:
-            ESP_LOGW(TAG, "Unknown message type: 0x%02X", msg->header.msg_type);
-            break;
-    }
-}
 
 // ============================================================================
 // Route Priority Management
@@ -297,13 +146,16 @@ void on_network_connected(bool is_ethernet)
     if (is_ethernet) {
         s_state.eth_connected = true;
         xEventGroupSetBits(s_gateway_events, EVENT_ETH_CONNECTED);
+        boot_profile_mark(BOOT_PHASE_ETH_LINK);
         ESP_LOGI(TAG, "Ethernet connected");
     } else {
         s_state.wifi_connected = true;
         xEventGroupSetBits(s_gateway_events, EVENT_WIFI_CONNECTED);
+        boot_profile_mark(BOOT_PHASE_ROUTER);
         ESP_LOGI(TAG, "WiFi connected");
     }
     update_default_route();
+    mqtt_handler_on_uplink();
 }
 
 void on_network_disconnected(bool is_ethernet)
@@ -327,6 +179,7 @@ void on_mqtt_connected(void)
 {
     s_state.mqtt_connected = true;
     xEventGroupSetBits(s_gateway_events, EVENT_MQTT_CONNECTED);
+    boot_profile_mark(BOOT_PHASE_MQTT_CONNECTED);
     ESP_LOGI(TAG, "MQTT connected");
 
     // Publish gateway online status
@@ -367,7 +220,9 @@ void on_router_state_changed(bool connected)
     if (connected) {
         s_state.wifi_connected = true;
         xEventGroupSetBits(s_gateway_events, EVENT_WIFI_CONNECTED);
+        boot_profile_mark(BOOT_PHASE_ROUTER);
         ESP_LOGI(TAG, "WiFi router connected - external network available via WiFi");
+        mqtt_handler_on_uplink();
     } else {
         s_state.wifi_connected = false;
         xEventGroupClearBits(s_gateway_events, EVENT_WIFI_CONNECTED);
@@ -397,7 +252,7 @@ void on_mesh_child_connected(const uint8_t *mac)
 
     // Notify MQTT
     if (s_state.mqtt_connected) {
-        mqtt_publish_node_connected(mac);
+        mqtt_queue_node_online(mac);
     }
 }
 
@@ -472,6 +327,16 @@ static void print_banner(void)
     ESP_LOGI(TAG, "");
 }
 
+static void print_heap_report(const char *stage)
+{
+    ESP_LOGI(TAG, "Heap [%s]: free=%u, min_free=%u, largest_block=%u, internal=%u",
+             stage,
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+}
+
 static esp_err_t init_nvs(void)
 {
     ESP_LOGI(TAG, "Initializing NVS...");
@@ -486,6 +351,7 @@ static esp_err_t init_nvs(void)
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "NVS initialized");
         nvs_storage_init();
+        log_ring_init();
 
         // Initialize configuration manager (loads from NVS with Kconfig fallback)
         config_manager_init();
@@ -502,7 +368,23 @@ static esp_err_t init_network(void)
     // Initialize TCP/IP stack
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+    boot_profile_mark(BOOT_PHASE_NETIF_READY);
+
+    // Ethernet driver/PHY bring-up runs alongside WiFi/mesh init;
+    // EVENT_ETH_READY is set when it is done, the link comes up in background
+    if (xTaskCreate(eth_start_task, "eth_start", 4096, NULL, 5, NULL) != pdPASS) {
+        start_ethernet();
+    }
 
+    // WiFi/mesh will be initialized by mesh_network_init() after this
+    return ESP_OK;
+}
+
+/**
+ * Bring up Ethernet (init + start) and set EVENT_ETH_READY
+ */
+static void start_ethernet(void)
+{
     // Always initialize Ethernet (non-blocking, connects in background)
     esp_err_t eth_ret = eth_manager_init();
     if (eth_ret == ESP_OK) {
@@ -521,8 +403,29 @@ static esp_err_t init_network(void)
         ESP_LOGE(TAG, "Ethernet init FAILED: %s - WiFi only mode", s_eth_fail_reason);
     }
 
-    // WiFi/mesh will be initialized by mesh_network_init() after this
-    return ESP_OK;
+    boot_profile_mark(BOOT_PHASE_ETH_STARTED);
+    xEventGroupSetBits(s_gateway_events, EVENT_ETH_READY);
+}
+
+static void eth_start_task(void *pvParameters)
+{
+    start_ethernet();
+    vTaskDelete(NULL);
+}
+
+/**
+ * Start the Web UI server while app_main continues with MQTT
+ */
+static void webserver_start_task(void *pvParameters)
+{
+    esp_err_t web_err = webserver_start();
+    if (web_err != ESP_OK) {
+        ESP_LOGE(TAG, "Webserver failed to start: %s", esp_err_to_name(web_err));
+    } else {
+        boot_profile_mark(BOOT_PHASE_WEBSERVER);
+        ESP_LOGI(TAG, "Web UI available at http://omniapi-gateway/ or via IP");
+    }
+    vTaskDelete(NULL);
 }
 
 // ============================================================================
@@ -679,8 +582,12 @@ void app_main(void)
         esp_restart();
     }
 
+    // Boot phase timestamps (what counts as controllable is set once the mode is known)
+    boot_profile_init();
+
     // Initialize NVS
     ESP_ERROR_CHECK(init_nvs());
+    boot_profile_mark(BOOT_PHASE_NVS_READY);
 
     // Mark OTA partition as valid early to prevent rollback during complex init
     // If we got this far (banner + NVS OK), the firmware image is valid
@@ -691,28 +598,27 @@ void app_main(void)
     // Check provisioning state
     // ================================================================
     provision_state_t prov_state = config_get_provision_state();
+    print_heap_report("boot");
 
     if (prov_state == PROVISION_STATE_UNCONFIGURED) {
         ESP_LOGW(TAG, "Gateway NOT configured - checking connectivity options...");
         status_led_set(STATUS_LED_SEARCHING);
 
+        // Provisioning is usable once the setup page can be served
+        boot_profile_require(BOOT_PHASE_BIT(BOOT_PHASE_WEBSERVER));
+
         // Init TCP/IP stack for Ethernet check
         ESP_ERROR_CHECK(esp_netif_init());
         ESP_ERROR_CHECK(esp_event_loop_create_default());
+        boot_profile_mark(BOOT_PHASE_NETIF_READY);
 
-        // Quick Ethernet check: try init + brief wait for link
-        esp_err_t eth_check = eth_manager_init();
+        // Quick Ethernet check: returns as soon as the link is up
+        start_ethernet();
         bool eth_link = false;
-        if (eth_check == ESP_OK) {
-            eth_manager_start();
-            // Wait up to 3 seconds for Ethernet link
-            for (int i = 0; i < 30; i++) {
-                vTaskDelay(pdMS_TO_TICKS(100));
-                if (s_state.eth_connected) {
-                    eth_link = true;
-                    break;
-                }
-            }
+        if (s_eth_init_ok) {
+            EventBits_t bits = xEventGroupWaitBits(s_gateway_events, EVENT_ETH_CONNECTED,
+                                                   pdFALSE, pdTRUE, pdMS_TO_TICKS(ETH_LINK_WAIT_MS));
+            eth_link = (bits & EVENT_ETH_CONNECTED) != 0;
         }
 
         if (ble_prov_needed(eth_link)) {
@@ -725,6 +631,10 @@ void app_main(void)
         // Ethernet available or WiFi creds exist → SoftAP provisioning for MQTT config
         ESP_LOGW(TAG, "Starting SoftAP provisioning for MQTT configuration...");
 
+        // BLE is not used on this boot: give its memory to WiFi/httpd
+        ble_prov_release_bt_memory();
+        print_heap_report("bt released");
+
         // Start SoftAP for provisioning
         ESP_ERROR_CHECK(start_provisioning_ap());
 
@@ -733,9 +643,13 @@ void app_main(void)
         if (web_err != ESP_OK) {
             ESP_LOGE(TAG, "Webserver failed to start: %s", esp_err_to_name(web_err));
         } else {
+            boot_profile_mark(BOOT_PHASE_WEBSERVER);
             ESP_LOGI(TAG, "Provisioning API available at http://192.168.4.1");
         }
 
+        // Warm the WiFi scan cache so the setup page lists networks immediately
+        wifi_manager_scan_request(false);
+
         // Start captive portal DNS server (redirects all domains to 192.168.4.1)
         xTaskCreate(captive_dns_task, "captive_dns", 3072, NULL, 5, NULL);
 
@@ -755,11 +669,31 @@ void app_main(void)
     }
     status_led_set(STATUS_LED_SEARCHING);
 
+    // Configured gateways never start BLE provisioning: reclaim its memory before
+    // WiFi/mesh, MQTT and httpd size their buffers (see ble_prov_bt_memory_released)
+    ble_prov_release_bt_memory();
+    print_heap_report("bt released");
+
+    // Controllable = nodes reachable from the loop and commands arriving:
+    // over MQTT when it is configured, otherwise over the Web API
+    uint32_t controllable = BOOT_PHASE_BIT(BOOT_PHASE_MESH_STARTED) | BOOT_PHASE_BIT(BOOT_PHASE_TASKS);
+    controllable |= (prov_state == PROVISION_STATE_CONFIGURED) ? BOOT_PHASE_BIT(BOOT_PHASE_MQTT_CONNECTED)
+                                                               : BOOT_PHASE_BIT(BOOT_PHASE_WEBSERVER);
+    boot_profile_require(controllable);
+
     // Initialize network (Ethernet + WiFi dual connectivity)
     ESP_ERROR_CHECK(init_network());
 
-    // Initialize node manager
+    // Initialize the modules MQTT and the Web API dispatch to, before either
+    // can deliver a request
     ESP_ERROR_CHECK(node_manager_init());
+    ESP_ERROR_CHECK(mesh_topology_init());
+    ESP_ERROR_CHECK(mesh_optimizer_init());
+    ESP_ERROR_CHECK(channel_survey_init());
+    ESP_ERROR_CHECK(cmd_latency_init());
+    ESP_ERROR_CHECK(commissioning_init());
+    ESP_ERROR_CHECK(ota_manager_init());
+    ESP_ERROR_CHECK(fleet_ota_init());
 
     // Initialize mesh network as Fixed Root (also initializes WiFi)
     ESP_ERROR_CHECK(mesh_network_init());
@@ -771,7 +705,7 @@ void app_main(void)
              s_state.gateway_mac[3], s_state.gateway_mac[4], s_state.gateway_mac[5]);
 
     // Set mesh callbacks
-    mesh_network_set_rx_cb(mesh_rx_handler);
+    mesh_network_set_rx_cb(mesh_router_handle_rx);
     mesh_network_set_child_connected_cb(on_mesh_child_connected);
     mesh_network_set_child_disconnected_cb(on_mesh_child_disconnected);
     mesh_network_set_router_cb(on_router_state_changed);
@@ -782,8 +716,16 @@ void app_main(void)
     // Since we're Fixed Root, set state directly after successful start
     s_state.mesh_started = true;
     s_state.is_mesh_root = true;
+    boot_profile_mark(BOOT_PHASE_MESH_STARTED);
     ESP_LOGI(TAG, "Mesh state set: started=true, is_root=true");
 
+    // Initialize node OTA manager (push-mode OTA to mesh nodes)
+    // After mesh start: it resumes a transfer interrupted by a reboot
+    ESP_ERROR_CHECK(node_ota_init());
+
+    // Start Web UI server alongside MQTT bring-up
+    xTaskCreate(webserver_start_task, "web_start", 4096, NULL, 5, NULL);
+
     // Initialize and start MQTT (after network is ready)
     // Non-fatal: gateway continues without MQTT if init fails (e.g. empty URI)
     esp_err_t mqtt_err = mqtt_handler_init();
@@ -791,38 +733,30 @@ void app_main(void)
         mqtt_err = mqtt_handler_start();
         if (mqtt_err != ESP_OK) {
             ESP_LOGE(TAG, "MQTT start failed: %s - continuing without MQTT", esp_err_to_name(mqtt_err));
+        } else {
+            boot_profile_mark(BOOT_PHASE_MQTT_STARTED);
         }
     } else {
         ESP_LOGE(TAG, "MQTT init failed: %s - continuing without MQTT", esp_err_to_name(mqtt_err));
     }
 
-    // Initialize commissioning handler
-    ESP_ERROR_CHECK(commissioning_init());
-
-    // Initialize OTA manager
-    ESP_ERROR_CHECK(ota_manager_init());
-
-    // Initialize node OTA manager (push-mode OTA to mesh nodes)
-    ESP_ERROR_CHECK(node_ota_init());
-
-    // Start Web UI server
-    esp_err_t web_err = webserver_start();
-    if (web_err != ESP_OK) {
-        ESP_LOGE(TAG, "Webserver failed to start: %s", esp_err_to_name(web_err));
-    } else {
-        ESP_LOGI(TAG, "Web UI available at http://omniapi-gateway/ or via IP");
-    }
-
     // Create main tasks
     xTaskCreate(gateway_task, "gateway_task", 4096, NULL, 5, NULL);
     xTaskCreate(heartbeat_task, "heartbeat_task", 4096, NULL, 4, NULL);
     xTaskCreate(status_task, "status_task", 4096, NULL, 3, NULL);
     xTaskCreate(factory_reset_task, "factory_reset", 2048, NULL, 2, NULL);
 
+    // Ethernet bring-up has had the whole sequence to finish; only report
+    // once it has (the link itself may still come later)
+    if (!(xEventGroupWaitBits(s_gateway_events, EVENT_ETH_READY, pdFALSE, pdTRUE,
+                              pdMS_TO_TICKS(ETH_READY_WAIT_MS)) & EVENT_ETH_READY)) {
+        ESP_LOGW(TAG, "Ethernet bring-up still running after %d ms", ETH_READY_WAIT_MS);
+    }
+
     ESP_LOGI(TAG, "Gateway initialization complete");
     ESP_LOGI(TAG, "  Ethernet: %s (netif=%p)", s_eth_init_ok ? "INIT OK" : "INIT FAILED", eth_manager_get_netif());
     ESP_LOGI(TAG, "  WiFi/Mesh: started, STA netif=%p", mesh_network_get_sta_netif());
-    ESP_LOGI(TAG, "Free heap: %lu bytes", esp_get_free_heap_size());
+    print_heap_report("init complete");
 
     // All initialized - set LED to connected
     status_led_set(STATUS_LED_CONNECTED);
@@ -838,6 +772,7 @@ void app_main(void)
 static void gateway_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Gateway task started");
+    boot_profile_mark(BOOT_PHASE_TASKS);
 
     while (1) {
         // Process incoming mesh messages
@@ -852,7 +787,11 @@ static void gateway_task(void *pvParameters)
         // Check node OTA timeout
         node_ota_check_timeout();
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Drive fleet OTA rollout
+        fleet_ota_process();
+
+        // ESP-NOW frames wake the loop early; mesh frames wait for the next pass
+        mesh_fastpath_wait(pdMS_TO_TICKS(10));
     }
 }
 
@@ -869,7 +808,10 @@ static void heartbeat_task(void *pvParameters)
     while (1) {
         // Send heartbeat to all mesh nodes
         if (s_state.mesh_started && s_state.is_mesh_root) {
+            mesh_topology_on_heartbeat_sent();
             mesh_network_broadcast_heartbeat();
+            mesh_optimizer_tick();
+            channel_survey_tick();
         }
 
         // Check for offline nodes
@@ -888,6 +830,7 @@ static void status_task(void *pvParameters)
 
     while (1) {
         s_state.uptime_sec += 30;
+        s_state.mesh_nodes_count = node_manager_get_count();
 
         ESP_LOGI(TAG, "=== Gateway Status ===");
         ESP_LOGI(TAG, "  Uptime: %lu sec", s_state.uptime_sec);
@@ -0,0 +1,421 @@
+/**
+ * OmniaPi Gateway Mesh - ESP-NOW Fast Path Implementation
+ *
+ * Frames are the usual omniapi messages, unchanged. Peers are encrypted
+ * with keys derived from the mesh ID and password, so only nodes that
+ * could join the mesh can use (or spoof) the fast path.
+ *
+ * One frame per child is in flight at a time: the copy kept for the mesh
+ * fallback is only valid until its send callback, and a duplicated toggle
+ * would undo itself. Anything sent while a frame is in flight goes by mesh.
+ */
+
+#include "mesh_fastpath.h"
+#include "omniapi_protocol.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "mbedtls/sha256.h"
+#include <string.h>
+
+static const char *TAG = "FASTPATH";
+
+#define FALLBACK_QUEUE_SIZE     4
+#define IN_FLIGHT_TIMEOUT_US    (200 * 1000)    // Send callback never came
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    uint8_t  mac[6];
+    uint16_t len;
+    uint8_t  data[MESH_FASTPATH_MAX_FRAME];
+} fastpath_frame_t;
+
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    bool     in_flight;
+    int64_t  sent_us;
+    uint16_t frame_len;
+    uint8_t  frame[MESH_FASTPATH_MAX_FRAME];
+    bool     cmd_pending;               // Awaiting a status reply
+    bool     cmd_fast;
+    int64_t  cmd_sent_us;
+} fastpath_peer_t;
+
+typedef struct {
+    uint32_t samples;
+    float    sum_ms;
+    float    min_ms;
+    float    max_ms;
+} rtt_stats_t;
+
+static fastpath_peer_t s_peers[MESH_FASTPATH_MAX_PEERS];
+static SemaphoreHandle_t s_mutex = NULL;
+static QueueHandle_t s_rx_queue = NULL;
+static QueueHandle_t s_fallback_queue = NULL;
+static SemaphoreHandle_t s_wake = NULL;
+static uint8_t s_lmk[16];
+static bool s_keyed = false;
+#ifdef CONFIG_MESH_ESPNOW_FASTPATH
+static bool s_enabled = true;
+#else
+static bool s_enabled = false;
+#endif
+
+// Statistics
+static uint32_t s_tx = 0;
+static uint32_t s_tx_failed = 0;
+static uint32_t s_busy = 0;
+static uint32_t s_rx = 0;
+static uint32_t s_rx_dropped = 0;
+static rtt_stats_t s_rtt_fast = {0};
+static rtt_stats_t s_rtt_mesh = {0};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int find_peer(const uint8_t *mac)
+{
+    for (int i = 0; i < MESH_FASTPATH_MAX_PEERS; i++) {
+        if (s_peers[i].used && memcmp(s_peers[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void rtt_add(rtt_stats_t *stats, float ms)
+{
+    if (stats->samples == 0 || ms < stats->min_ms) stats->min_ms = ms;
+    if (ms > stats->max_ms) stats->max_ms = ms;
+    stats->sum_ms += ms;
+    stats->samples++;
+}
+
+static cJSON* rtt_json(const rtt_stats_t *stats)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "samples", stats->samples);
+    cJSON_AddNumberToObject(json, "avg_ms", stats->samples ? stats->sum_ms / stats->samples : 0);
+    cJSON_AddNumberToObject(json, "min_ms", stats->min_ms);
+    cJSON_AddNumberToObject(json, "max_ms", stats->max_ms);
+    return json;
+}
+
+// ============================================================================
+// ESP-NOW Callbacks (WiFi task)
+// ============================================================================
+
+static void fastpath_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (len < (int)sizeof(omniapi_header_t) || len > MESH_FASTPATH_MAX_FRAME) return;
+
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    bool known = find_peer(info->src_addr) >= 0;
+    xSemaphoreGive(s_mutex);
+    if (!known) return;
+
+    fastpath_frame_t frame;
+    memcpy(frame.mac, info->src_addr, 6);
+    frame.len = (uint16_t)len;
+    memcpy(frame.data, data, len);
+
+    if (xQueueSend(s_rx_queue, &frame, 0) == pdTRUE) {
+        s_rx++;
+        xSemaphoreGive(s_wake);
+    } else {
+        s_rx_dropped++;
+    }
+}
+
+static void fastpath_send_cb(const wifi_tx_info_t *tx_info, esp_now_send_status_t status)
+{
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_peer(tx_info->des_addr);
+    if (idx >= 0 && s_peers[idx].in_flight) {
+        fastpath_peer_t *p = &s_peers[idx];
+        if (status != ESP_NOW_SEND_SUCCESS) {
+            // Hand the frame back to the gateway task for the mesh
+            fastpath_frame_t frame;
+            memcpy(frame.mac, p->mac, 6);
+            frame.len = p->frame_len;
+            memcpy(frame.data, p->frame, p->frame_len);
+            xQueueSend(s_fallback_queue, &frame, 0);
+            xSemaphoreGive(s_wake);
+            s_tx_failed++;
+        }
+        p->in_flight = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t mesh_fastpath_init(void)
+{
+    if (s_mutex != NULL) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutex();
+    s_wake = xSemaphoreCreateBinary();
+    s_rx_queue = xQueueCreate(MESH_FASTPATH_RX_QUEUE, sizeof(fastpath_frame_t));
+    s_fallback_queue = xQueueCreate(FALLBACK_QUEUE_SIZE, sizeof(fastpath_frame_t));
+    if (s_mutex == NULL || s_wake == NULL || s_rx_queue == NULL || s_fallback_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate fast path");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = esp_now_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_now_init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    esp_now_register_recv_cb(fastpath_recv_cb);
+    esp_now_register_send_cb(fastpath_send_cb);
+
+    ESP_LOGI(TAG, "ESP-NOW fast path ready (%s)", s_enabled ? "enabled" : "disabled");
+    return ESP_OK;
+}
+
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password)
+{
+    if (s_mutex == NULL) return;
+
+    // PMK || LMK = SHA-256("omniapi-fastpath" || mesh ID || password)
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, (const uint8_t *)"omniapi-fastpath", 16);
+    mbedtls_sha256_update(&sha, mesh_id, 6);
+    if (password) {
+        mbedtls_sha256_update(&sha, (const uint8_t *)password, strlen(password));
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < MESH_FASTPATH_MAX_PEERS; i++) {
+        if (s_peers[i].used) {
+            esp_now_del_peer(s_peers[i].mac);
+        }
+    }
+    memset(s_peers, 0, sizeof(s_peers));
+    esp_now_set_pmk(digest);
+    memcpy(s_lmk, digest + 16, sizeof(s_lmk));
+    s_keyed = true;
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_fastpath_add_peer(const uint8_t *mac)
+{
+    if (s_mutex == NULL || !s_keyed || mac == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    if (find_peer(mac) < 0) {
+        int slot = -1;
+        for (int i = 0; i < MESH_FASTPATH_MAX_PEERS; i++) {
+            if (!s_peers[i].used) {
+                slot = i;
+                break;
+            }
+        }
+
+        esp_now_peer_info_t peer = {0};
+        memcpy(peer.peer_addr, mac, 6);
+        peer.channel = 0;                   // Current (mesh) channel
+        peer.ifidx = WIFI_IF_AP;            // Children are associated to our softAP
+        peer.encrypt = true;
+        memcpy(peer.lmk, s_lmk, sizeof(s_lmk));
+
+        esp_err_t ret = (slot < 0) ? ESP_ERR_NO_MEM : esp_now_add_peer(&peer);
+        if (ret == ESP_OK) {
+            memset(&s_peers[slot], 0, sizeof(s_peers[slot]));
+            s_peers[slot].used = true;
+            memcpy(s_peers[slot].mac, mac, 6);
+            ESP_LOGI(TAG, "Peer %02X:%02X:%02X:%02X:%02X:%02X added",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+        } else {
+            ESP_LOGW(TAG, "Peer %02X:%02X:%02X:%02X:%02X:%02X stays on mesh: %s",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], esp_err_to_name(ret));
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_fastpath_remove_peer(const uint8_t *mac)
+{
+    if (s_mutex == NULL || mac == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_peer(mac);
+    if (idx >= 0) {
+        esp_now_del_peer(mac);
+        s_peers[idx].used = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+bool mesh_fastpath_is_fast_type(uint8_t msg_type)
+{
+    return msg_type == MSG_RELAY_CMD || msg_type == MSG_LED_CMD || msg_type == MSG_DIMMER_CMD;
+}
+
+esp_err_t mesh_fastpath_send(const uint8_t *mac, const uint8_t *data, size_t len)
+{
+    if (s_mutex == NULL || !s_enabled) return ESP_ERR_INVALID_STATE;
+    if (len > MESH_FASTPATH_MAX_FRAME) return ESP_ERR_INVALID_SIZE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    int64_t now = esp_timer_get_time();
+    int idx = find_peer(mac);
+    if (idx < 0) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    fastpath_peer_t *p = &s_peers[idx];
+    if (p->in_flight && now - p->sent_us < IN_FLIGHT_TIMEOUT_US) {
+        s_busy++;
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    memcpy(p->frame, data, len);
+    p->frame_len = (uint16_t)len;
+    p->in_flight = true;
+    p->sent_us = now;
+    xSemaphoreGive(s_mutex);
+
+    // Not under the mutex: the send callback needs it
+    esp_err_t ret = esp_now_send(mac, data, len);
+    if (ret == ESP_OK) {
+        s_tx++;
+    } else if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        idx = find_peer(mac);
+        if (idx >= 0) s_peers[idx].in_flight = false;
+        xSemaphoreGive(s_mutex);
+    }
+    return ret;
+}
+
+bool mesh_fastpath_recv(uint8_t *src_mac, uint8_t *buf, size_t *len)
+{
+    if (s_rx_queue == NULL) return false;
+
+    fastpath_frame_t frame;
+    if (xQueueReceive(s_rx_queue, &frame, 0) != pdTRUE) return false;
+
+    memcpy(src_mac, frame.mac, 6);
+    memcpy(buf, frame.data, frame.len);
+    *len = frame.len;
+    return true;
+}
+
+bool mesh_fastpath_take_fallback(uint8_t *dest_mac, uint8_t *buf, size_t *len)
+{
+    if (s_fallback_queue == NULL) return false;
+
+    fastpath_frame_t frame;
+    if (xQueueReceive(s_fallback_queue, &frame, 0) != pdTRUE) return false;
+
+    memcpy(dest_mac, frame.mac, 6);
+    memcpy(buf, frame.data, frame.len);
+    *len = frame.len;
+    return true;
+}
+
+void mesh_fastpath_wait(TickType_t ticks)
+{
+    if (s_wake == NULL) {
+        vTaskDelay(ticks);
+        return;
+    }
+    xSemaphoreTake(s_wake, ticks);
+}
+
+void mesh_fastpath_note_command(const uint8_t *mac, bool fast)
+{
+    if (s_mutex == NULL || xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_peer(mac);
+    if (idx >= 0) {
+        s_peers[idx].cmd_pending = true;
+        s_peers[idx].cmd_fast = fast;
+        s_peers[idx].cmd_sent_us = esp_timer_get_time();
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_fastpath_note_reply(const uint8_t *mac)
+{
+    if (s_mutex == NULL || xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int idx = find_peer(mac);
+    if (idx >= 0 && s_peers[idx].cmd_pending) {
+        fastpath_peer_t *p = &s_peers[idx];
+        p->cmd_pending = false;
+        float ms = (float)(esp_timer_get_time() - p->cmd_sent_us) / 1000.0f;
+        if (ms <= MESH_FASTPATH_RTT_TIMEOUT_MS) {
+            rtt_add(p->cmd_fast ? &s_rtt_fast : &s_rtt_mesh, ms);
+            ESP_LOGD(TAG, "Command RTT %.1f ms (%s)", ms, p->cmd_fast ? "espnow" : "mesh");
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_fastpath_set_enabled(bool enabled)
+{
+    if (enabled != s_enabled) {
+        ESP_LOGI(TAG, "Fast path %s", enabled ? "enabled" : "disabled");
+    }
+    s_enabled = enabled;
+}
+
+bool mesh_fastpath_is_enabled(void)
+{
+    return s_enabled;
+}
+
+cJSON* mesh_fastpath_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "enabled", s_enabled);
+
+    cJSON *peers = cJSON_CreateArray();
+    cJSON *rtt = cJSON_CreateObject();
+    if (s_mutex != NULL && xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (int i = 0; i < MESH_FASTPATH_MAX_PEERS; i++) {
+            if (!s_peers[i].used) continue;
+            char mac_str[18];
+            const uint8_t *m = s_peers[i].mac;
+            snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
+                     m[0], m[1], m[2], m[3], m[4], m[5]);
+            cJSON_AddItemToArray(peers, cJSON_CreateString(mac_str));
+        }
+        cJSON_AddItemToObject(rtt, "espnow", rtt_json(&s_rtt_fast));
+        cJSON_AddItemToObject(rtt, "mesh", rtt_json(&s_rtt_mesh));
+        xSemaphoreGive(s_mutex);
+    }
+    cJSON_AddItemToObject(json, "peers", peers);
+
+    cJSON_AddNumberToObject(json, "tx", s_tx);
+    cJSON_AddNumberToObject(json, "tx_fallback", s_tx_failed);
+    cJSON_AddNumberToObject(json, "tx_busy", s_busy);
+    cJSON_AddNumberToObject(json, "rx", s_rx);
+    cJSON_AddNumberToObject(json, "rx_dropped", s_rx_dropped);
+    cJSON_AddItemToObject(json, "rtt", rtt);
+
+    return json;
+}
@@ -0,0 +1,117 @@
+/**
+ * OmniaPi Gateway Mesh - ESP-NOW Fast Path
+ *
+ * Direct children of the root are one radio hop away, yet commands to
+ * them still go through the mesh stack's queueing and forwarding. Each
+ * direct child is also registered as an encrypted ESP-NOW peer on the
+ * mesh channel, and latency-critical control frames (relay/LED/dimmer
+ * commands) are sent over ESP-NOW, falling back to the mesh if delivery fails.
+ * Nodes answer over the path the command arrived on.
+ *
+ * Command->status round trips to direct children are measured per path.
+ */
+
+#ifndef MESH_FASTPATH_H
+#define MESH_FASTPATH_H
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define MESH_FASTPATH_MAX_PEERS     6       // Within ESP-NOW's encrypted peer limit
+#define MESH_FASTPATH_MAX_FRAME     250     // ESP_NOW_MAX_DATA_LEN
+#define MESH_FASTPATH_RX_QUEUE      8
+#define MESH_FASTPATH_RTT_TIMEOUT_MS 2000   // Unanswered commands aren't sampled
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize ESP-NOW alongside the mesh (WiFi must be started)
+ * @return ESP_OK on success
+ */
+esp_err_t mesh_fastpath_init(void);
+
+/**
+ * Derive the ESP-NOW keys for a mesh and drop all peers (call on mesh start)
+ * @param mesh_id   Mesh ID
+ * @param password  Mesh AP password
+ */
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password);
+
+/**
+ * Register / forget a direct child
+ */
+void mesh_fastpath_add_peer(const uint8_t *mac);
+void mesh_fastpath_remove_peer(const uint8_t *mac);
+
+/**
+ * Whether a message type should take the fast path
+ */
+bool mesh_fastpath_is_fast_type(uint8_t msg_type);
+
+/**
+ * Send a frame to a direct child over ESP-NOW.
+ * If delivery fails on air the frame is handed back through
+ * mesh_fastpath_take_fallback() for the caller to resend over the mesh.
+ *
+ * @return ESP_OK if sent, ESP_ERR_NOT_FOUND if not a direct child,
+ *         ESP_ERR_INVALID_STATE if disabled or a frame is already in flight
+ */
+esp_err_t mesh_fastpath_send(const uint8_t *mac, const uint8_t *data, size_t len);
+
+/**
+ * Take a frame received over ESP-NOW (non-blocking)
+ * @param src_mac  Sender (node STA MAC, same as its mesh address)
+ * @param buf      At least MESH_FASTPATH_MAX_FRAME bytes
+ * @param len      Frame length
+ * @return true if a frame was taken
+ */
+bool mesh_fastpath_recv(uint8_t *src_mac, uint8_t *buf, size_t *len);
+
+/**
+ * Take a frame whose ESP-NOW delivery failed (non-blocking)
+ * @return true if a frame was taken
+ */
+bool mesh_fastpath_take_fallback(uint8_t *dest_mac, uint8_t *buf, size_t *len);
+
+/**
+ * Block until ESP-NOW traffic arrives or the timeout expires
+ */
+void mesh_fastpath_wait(TickType_t ticks);
+
+/**
+ * RTT bookkeeping: a command was sent to mac (over either path) /
+ * a status reply came back from mac
+ */
+void mesh_fastpath_note_command(const uint8_t *mac, bool fast);
+void mesh_fastpath_note_reply(const uint8_t *mac);
+
+/**
+ * Enable/disable at runtime (to compare both paths on the same nodes)
+ */
+void mesh_fastpath_set_enabled(bool enabled);
+bool mesh_fastpath_is_enabled(void);
+
+/**
+ * Build status JSON (GET /api/mesh/fastpath)
+ * @return cJSON object, caller must cJSON_Delete
+ */
+cJSON* mesh_fastpath_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_FASTPATH_H
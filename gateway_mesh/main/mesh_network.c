@@ -7,6 +7,10 @@
 #include "mesh_network.h"
 #include "omniapi_protocol.h"
 #include "config_manager.h"
+#include "ble_prov.h"
+#include "mesh_optimizer.h"
+#include "mesh_fastpath.h"
+#include "node_manager.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -18,6 +22,7 @@
 #include "esp_mesh.h"
 #include "esp_mesh_internal.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 
 static const char *TAG = "MESH_NET";
 
@@ -29,6 +34,15 @@ static const uint8_t MESH_ID[6] = MESH_ID_DEFAULT;
 #define RX_BUFFER_SIZE      1500
 #define TX_BUFFER_SIZE      1460
 #define RX_QUEUE_SIZE       16
+#define RX_BATCH_MAX        16      // Mesh frames drained per gateway loop pass
+
+// Mesh/WiFi buffering; the larger values are used when BT memory was reclaimed at boot
+#define MESH_XON_QSIZE              128
+#define MESH_XON_QSIZE_LARGE        192
+#define WIFI_DYNAMIC_BUF_NUM_LARGE  64
+
+// Devices the mesh admits, root included: one per node table slot (IDF default is 300)
+#define MESH_CAPACITY               (MAX_NODES + 1)
 
 // ============================================================================
 // State
@@ -49,6 +63,10 @@ static mesh_stats_t s_stats = {0};
 // Sequence number for messages
 static uint8_t s_seq_num = 0;
 
+// Current heartbeat round (ACKs are matched by sequence number)
+static uint8_t s_hb_seq = 0;
+static int64_t s_hb_sent_us = 0;
+
 // ============================================================================
 // Callbacks
 // ============================================================================
@@ -98,6 +116,7 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "<MESH_EVENT_CHILD_CONNECTED> aid:%d, %02X:%02X:%02X:%02X:%02X:%02X",
                      child->aid, child->mac[0], child->mac[1], child->mac[2],
                      child->mac[3], child->mac[4], child->mac[5]);
+            mesh_fastpath_add_peer(child->mac);
             if (s_child_connected_cb) s_child_connected_cb(child->mac);
             break;
         }
@@ -107,6 +126,7 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "<MESH_EVENT_CHILD_DISCONNECTED> aid:%d, %02X:%02X:%02X:%02X:%02X:%02X",
                      child->aid, child->mac[0], child->mac[1], child->mac[2],
                      child->mac[3], child->mac[4], child->mac[5]);
+            mesh_fastpath_remove_peer(child->mac);
             if (s_child_disconnected_cb) s_child_disconnected_cb(child->mac);
             break;
         }
@@ -255,6 +275,17 @@ esp_err_t mesh_network_init(void)
 
     // Initialize WiFi
     wifi_init_config_t wifi_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    if (ble_prov_bt_memory_released()) {
+        // Dynamic buffers are only allocated under load, so this raises the burst ceiling
+        if (wifi_cfg.dynamic_rx_buf_num < WIFI_DYNAMIC_BUF_NUM_LARGE) {
+            wifi_cfg.dynamic_rx_buf_num = WIFI_DYNAMIC_BUF_NUM_LARGE;
+        }
+        if (wifi_cfg.dynamic_tx_buf_num < WIFI_DYNAMIC_BUF_NUM_LARGE) {
+            wifi_cfg.dynamic_tx_buf_num = WIFI_DYNAMIC_BUF_NUM_LARGE;
+        }
+        ESP_LOGI(TAG, "WiFi dynamic buffers: rx=%d tx=%d",
+                 wifi_cfg.dynamic_rx_buf_num, wifi_cfg.dynamic_tx_buf_num);
+    }
     ESP_ERROR_CHECK(esp_wifi_init(&wifi_cfg));
 
     // Register IP event handler (all IP events for reconnect handling)
@@ -265,6 +296,9 @@ esp_err_t mesh_network_init(void)
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_FLASH));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    // ESP-NOW beside the mesh for direct children (mesh still works without it)
+    mesh_fastpath_init();
+
     // Initialize mesh
     ESP_ERROR_CHECK(esp_mesh_init());
 
@@ -290,13 +324,17 @@ esp_err_t mesh_network_start(void)
     ESP_ERROR_CHECK(esp_mesh_set_topology(MESH_TOPO_TREE));
 
     // Set max layer
-    ESP_ERROR_CHECK(esp_mesh_set_max_layer(CONFIG_MESH_MAX_LAYER));
+    ESP_ERROR_CHECK(esp_mesh_set_max_layer(mesh_optimizer_get_max_layer()));
+
+    // Admit no more nodes than the node table tracks (root included)
+    ESP_ERROR_CHECK(esp_mesh_set_capacity_num(MESH_CAPACITY));
 
     // Set vote percentage (we're fixed root, but just in case)
     ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(1));
 
     // Set XON queue size
-    ESP_ERROR_CHECK(esp_mesh_set_xon_qsize(128));
+    ESP_ERROR_CHECK(esp_mesh_set_xon_qsize(ble_prov_bt_memory_released() ? MESH_XON_QSIZE_LARGE
+                                                                         : MESH_XON_QSIZE));
 
     // Disable mesh PS (Power Save) for better latency
     ESP_ERROR_CHECK(esp_mesh_disable_ps());
@@ -309,7 +347,7 @@ esp_err_t mesh_network_start(void)
     memcpy(&cfg.mesh_id, MESH_ID, 6);
 
     // Router configuration (for external network access)
-    cfg.channel = CONFIG_MESH_CHANNEL;
+    cfg.channel = config_get_mesh()->channel;
 
     // Use config_manager for WiFi credentials (NVS or defaults)
     const config_wifi_sta_t *wifi_sta = config_get_wifi_sta();
@@ -328,6 +366,9 @@ esp_err_t mesh_network_start(void)
     cfg.mesh_ap.nonmesh_max_connection = CONFIG_MESH_NON_MESH_AP_CONNECTIONS;
 #ifdef CONFIG_MESH_AP_PASSWD
     memcpy(&cfg.mesh_ap.password, CONFIG_MESH_AP_PASSWD, strlen(CONFIG_MESH_AP_PASSWD));
+    mesh_fastpath_set_mesh(MESH_ID, CONFIG_MESH_AP_PASSWD);
+#else
+    mesh_fastpath_set_mesh(MESH_ID, NULL);
 #endif
 
     ESP_ERROR_CHECK(esp_mesh_set_config(&cfg));
@@ -343,8 +384,8 @@ esp_err_t mesh_network_start(void)
     ESP_LOGI(TAG, "Mesh started as FIXED ROOT");
     ESP_LOGI(TAG, "  Mesh ID: %02X:%02X:%02X:%02X:%02X:%02X",
              MESH_ID[0], MESH_ID[1], MESH_ID[2], MESH_ID[3], MESH_ID[4], MESH_ID[5]);
-    ESP_LOGI(TAG, "  Channel: %d", CONFIG_MESH_CHANNEL);
-    ESP_LOGI(TAG, "  Max Layer: %d", CONFIG_MESH_MAX_LAYER);
+    ESP_LOGI(TAG, "  Channel: %d", config_get_mesh()->channel);
+    ESP_LOGI(TAG, "  Max Layer: %d", mesh_optimizer_get_max_layer());
     ESP_LOGI(TAG, "  Max Connections: %d", CONFIG_MESH_AP_CONNECTIONS);
 
     return ESP_OK;
@@ -423,9 +464,11 @@ esp_err_t mesh_network_start_with_id(const uint8_t mesh_id[6], const char *passw
     // 4. Configure mesh topology
     ESP_LOGI(TAG, "Step 4: Configuring mesh topology...");
     ESP_ERROR_CHECK(esp_mesh_set_topology(MESH_TOPO_TREE));
-    ESP_ERROR_CHECK(esp_mesh_set_max_layer(CONFIG_MESH_MAX_LAYER));
+    ESP_ERROR_CHECK(esp_mesh_set_max_layer(mesh_optimizer_get_max_layer()));
+    ESP_ERROR_CHECK(esp_mesh_set_capacity_num(MESH_CAPACITY));
     ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(1));
-    ESP_ERROR_CHECK(esp_mesh_set_xon_qsize(128));
+    ESP_ERROR_CHECK(esp_mesh_set_xon_qsize(ble_prov_bt_memory_released() ? MESH_XON_QSIZE_LARGE
+                                                                         : MESH_XON_QSIZE));
     ESP_ERROR_CHECK(esp_mesh_disable_ps());
     ESP_ERROR_CHECK(esp_mesh_set_ap_assoc_expire(10));
 
@@ -435,7 +478,7 @@ esp_err_t mesh_network_start_with_id(const uint8_t mesh_id[6], const char *passw
     memcpy(&cfg.mesh_id, mesh_id, 6);
 
     // Router configuration - use config_manager
-    cfg.channel = CONFIG_MESH_CHANNEL;
+    cfg.channel = config_get_mesh()->channel;
     const config_wifi_sta_t *wifi_cfg = config_get_wifi_sta();
     if (wifi_cfg && strlen(wifi_cfg->ssid) > 0) {
         cfg.router.ssid_len = strlen(wifi_cfg->ssid);
@@ -457,6 +500,7 @@ esp_err_t mesh_network_start_with_id(const uint8_t mesh_id[6], const char *passw
         ESP_LOGE(TAG, "esp_mesh_set_config failed: %s", esp_err_to_name(ret));
         return ret;
     }
+    mesh_fastpath_set_mesh(mesh_id, password);
 
     // 6. Fixed root configuration
     ESP_LOGI(TAG, "Step 6: Setting as FIXED ROOT...");
@@ -479,16 +523,8 @@ esp_err_t mesh_network_start_with_id(const uint8_t mesh_id[6], const char *passw
 // Messaging
 // ============================================================================
 
-esp_err_t mesh_network_send(const uint8_t *dest_mac, const uint8_t *data, size_t len)
+static esp_err_t mesh_send_p2p(const uint8_t *dest_mac, const uint8_t *data, size_t len)
 {
-    if (!s_mesh_started || !s_is_root) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    if (dest_mac == NULL || data == NULL || len == 0 || len > TX_BUFFER_SIZE) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
     mesh_addr_t dest;
     memcpy(dest.addr, dest_mac, 6);
 
@@ -518,12 +554,39 @@ esp_err_t mesh_network_send(const uint8_t *dest_mac, const uint8_t *data, size_t
     return ret;
 }
 
-esp_err_t mesh_network_broadcast(const uint8_t *data, size_t len)
+esp_err_t mesh_network_send(const uint8_t *dest_mac, const uint8_t *data, size_t len)
 {
     if (!s_mesh_started || !s_is_root) {
         return ESP_ERR_INVALID_STATE;
     }
 
+    if (dest_mac == NULL || data == NULL || len == 0 || len > TX_BUFFER_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Control frames to a direct child skip the mesh stack
+    const omniapi_header_t *header = (const omniapi_header_t *)data;
+    if (len >= sizeof(omniapi_header_t) && mesh_fastpath_is_fast_type(header->msg_type)) {
+        bool fast = mesh_fastpath_send(dest_mac, data, len) == ESP_OK;
+        // Dimmer status only comes back after the fade, so it's no RTT sample
+        if (header->msg_type != MSG_DIMMER_CMD) {
+            mesh_fastpath_note_command(dest_mac, fast);
+        }
+        if (fast) {
+            s_stats.tx_count++;
+            return ESP_OK;
+        }
+    }
+
+    return mesh_send_p2p(dest_mac, data, len);
+}
+
+/**
+ * Send to every node in the routing table
+ * @return Nodes the frame was handed to, -1 if the table could not be read
+ */
+static int broadcast_to_table(const uint8_t *data, size_t len)
+{
     // Get routing table
     mesh_addr_t route_table[MESH_MAX_ROUTING_TABLE];
     int table_size = 0;
@@ -531,7 +594,7 @@ esp_err_t mesh_network_broadcast(const uint8_t *data, size_t len)
     esp_err_t ret = esp_mesh_get_routing_table(route_table, MESH_MAX_ROUTING_TABLE * 6, &table_size);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get routing table: %s", esp_err_to_name(ret));
-        return ret;
+        return -1;
     }
 
     ESP_LOGD(TAG, "Broadcasting to %d nodes", table_size);
@@ -555,44 +618,120 @@ esp_err_t mesh_network_broadcast(const uint8_t *data, size_t len)
     }
 
     ESP_LOGD(TAG, "Broadcast complete: %d/%d success", success, table_size);
-    return (success > 0) ? ESP_OK : ESP_FAIL;
+    return success;
+}
+
+esp_err_t mesh_network_broadcast(const uint8_t *data, size_t len)
+{
+    if (!s_mesh_started || !s_is_root) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return (broadcast_to_table(data, len) > 0) ? ESP_OK : ESP_FAIL;
 }
 
 void mesh_network_broadcast_heartbeat(void)
 {
+    if (!s_mesh_started || !s_is_root) {
+        return;
+    }
+
     omniapi_message_t msg;
-    OMNIAPI_INIT_HEADER(&msg.header, MSG_HEARTBEAT, s_seq_num++, 0);
+    uint8_t seq = s_seq_num++;
+    OMNIAPI_INIT_HEADER(&msg.header, MSG_HEARTBEAT, seq, 0);
+
+    // Close the previous round before the new one starts counting
+    if (s_stats.hb_sent > 0) {
+        ESP_LOGD(TAG, "Heartbeat round: %lu/%lu ACKs, last after %lu ms",
+                 (unsigned long)s_stats.hb_acked, (unsigned long)s_stats.hb_sent,
+                 (unsigned long)s_stats.hb_last_ack_ms);
+    }
+    s_hb_seq = seq;
+    s_hb_sent_us = esp_timer_get_time();
+    s_stats.hb_acked = 0;
+    s_stats.hb_last_ack_ms = 0;
 
-    mesh_network_broadcast((uint8_t *)&msg, OMNIAPI_MSG_SIZE(0));
+    int sent = broadcast_to_table((uint8_t *)&msg, OMNIAPI_MSG_SIZE(0));
+    s_stats.hb_sent = sent > 0 ? sent : 0;
+}
+
+static void deliver_rx(const uint8_t *from, const uint8_t *data, size_t len)
+{
+    s_stats.rx_count++;
+
+    ESP_LOGD(TAG, "RX from %02X:%02X:%02X:%02X:%02X:%02X len=%d",
+             from[0], from[1], from[2], from[3], from[4], from[5], (int)len);
+
+    // Closes the command round trip for the fast path comparison
+    const omniapi_header_t *header = (const omniapi_header_t *)data;
+    if (len >= sizeof(omniapi_header_t) &&
+        (header->msg_type == MSG_RELAY_STATUS || header->msg_type == MSG_LED_STATUS)) {
+        mesh_fastpath_note_reply(from);
+    }
+
+    // How long the ACK burst after a heartbeat takes to come in
+    if (len >= sizeof(omniapi_header_t) &&
+        header->msg_type == MSG_HEARTBEAT_ACK && header->seq == s_hb_seq) {
+        s_stats.hb_acked++;
+        s_stats.hb_last_ack_ms = (uint32_t)((esp_timer_get_time() - s_hb_sent_us) / 1000);
+    }
+
+    // Call application callback
+    if (s_rx_cb) {
+        s_rx_cb(from, data, len);
+    }
 }
 
 void mesh_network_process_rx(void)
 {
     if (!s_mesh_started) return;
 
-    mesh_addr_t from;
-    mesh_data_t data;
-    int flag = 0;
+    uint8_t peer[6];
+    size_t fast_len = 0;
+
+    // ESP-NOW frames that didn't make it go out over the mesh instead
+    while (mesh_fastpath_take_fallback(peer, s_rx_buffer, &fast_len)) {
+        mesh_send_p2p(peer, s_rx_buffer, fast_len);
+    }
+
+    // Frames from direct children over ESP-NOW
+    while (mesh_fastpath_recv(peer, s_rx_buffer, &fast_len)) {
+        deliver_rx(peer, s_rx_buffer, fast_len);
+    }
 
-    data.data = s_rx_buffer;
-    data.size = RX_BUFFER_SIZE;
+    // Backlog waiting in the mesh stack before this pass
+    mesh_rx_pending_t pending;
+    if (esp_mesh_get_rx_pending(&pending) == ESP_OK && (uint32_t)pending.toSelf > s_stats.rx_backlog_max) {
+        s_stats.rx_backlog_max = pending.toSelf;
+    }
 
-    // Non-blocking receive
-    esp_err_t ret = esp_mesh_recv(&from, &data, 0, &flag, NULL, 0);
+    // Drain a batch per pass: one frame per 10 ms loop caps the gateway at
+    // 100 frames/s, which a heartbeat ACK burst from a large mesh exceeds
+    uint32_t batch = 0;
+    while (batch < RX_BATCH_MAX) {
+        mesh_addr_t from;
+        mesh_data_t data;
+        int flag = 0;
 
-    if (ret == ESP_OK && data.size > 0) {
-        s_stats.rx_count++;
+        data.data = s_rx_buffer;
+        data.size = RX_BUFFER_SIZE;
 
-        ESP_LOGD(TAG, "RX from %02X:%02X:%02X:%02X:%02X:%02X len=%d",
-                 from.addr[0], from.addr[1], from.addr[2], from.addr[3],
-                 from.addr[4], from.addr[5], (int)data.size);
+        // Non-blocking receive
+        esp_err_t ret = esp_mesh_recv(&from, &data, 0, &flag, NULL, 0);
 
-        // Call application callback
-        if (s_rx_cb) {
-            s_rx_cb(from.addr, data.data, data.size);
+        if (ret == ESP_OK && data.size > 0) {
+            deliver_rx(from.addr, data.data, data.size);
+            batch++;
+        } else {
+            if (ret != ESP_ERR_MESH_TIMEOUT && ret != ESP_OK) {
+                s_stats.rx_errors++;
+            }
+            break;
         }
-    } else if (ret != ESP_ERR_MESH_TIMEOUT && ret != ESP_OK) {
-        s_stats.rx_errors++;
+    }
+
+    if (batch > s_stats.rx_batch_max) {
+        s_stats.rx_batch_max = batch;
     }
 }
 
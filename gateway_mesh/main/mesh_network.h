@@ -183,6 +183,11 @@ typedef struct {
     uint32_t rx_errors;
     uint32_t routing_table_size;
     int8_t   parent_rssi;
+    uint32_t rx_batch_max;      // Most mesh frames drained in one pass
+    uint32_t rx_backlog_max;    // Deepest mesh stack RX queue seen
+    uint32_t hb_sent;           // Nodes sent the current heartbeat
+    uint32_t hb_acked;          // ACKs received for it so far
+    uint32_t hb_last_ack_ms;    // Time from heartbeat to the latest ACK
 } mesh_stats_t;
 
 void mesh_network_get_stats(mesh_stats_t *stats);
@@ -0,0 +1,547 @@
+/**
+ * OmniaPi Gateway Mesh - Topology Optimizer Implementation
+ *
+ * A move is only proposed for nodes with settled link estimates, one at a
+ * time, and a node that moved is left alone for a cooldown, so the mesh
+ * converges instead of flapping. The new link's cost is not known before
+ * the move; the node's current link ETX stands in for it. Whether the node
+ * hears the new parent at all is not known either, and a node that cannot
+ * reach it is left without a parent until it gives up and scans, so a
+ * failed move keeps the node still for longer.
+ */
+
+#include "mesh_optimizer.h"
+#include "mesh_topology.h"
+#include "mesh_network.h"
+#include "nvs_storage.h"
+#include "omniapi_protocol.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "MESH_OPT";
+
+#define CAND_ROOT           (-1)
+#define CAND_NONE           (-2)
+#define MAX_PARAM_SENDS     4       // CONFIG_KEY_MESH_PARAMS messages per evaluation
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    int64_t  last_move_ms;
+    int64_t  failed_until_ms;           // Last move failed: no other until then
+    uint8_t  sent_max_layer;            // Params last sent (0 = never)
+    uint8_t  sent_connections;
+} opt_node_t;
+
+typedef struct {
+    bool     active;
+    uint8_t  mac[6];
+    uint8_t  parent_mac[6];             // STA MAC of the new parent (zero MAC = root)
+    int64_t  started_ms;
+} opt_move_t;
+
+typedef struct {
+    uint8_t  mac[6];
+    uint8_t  key;
+    uint8_t  len;
+    uint8_t  value[sizeof(config_mesh_parent_t)];
+} opt_send_t;
+
+static opt_node_t s_nodes[TOPOLOGY_MAX_NODES];
+static opt_move_t s_move = {0};
+static mesh_optimizer_stats_t s_stats = {0};
+static bool s_baseline_set = false;
+static int64_t s_last_eval = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+// Evaluation scratch (heartbeat task only)
+static mesh_topology_node_t s_snap[TOPOLOGY_MAX_NODES];
+static int8_t s_parent[TOPOLOGY_MAX_NODES];
+static uint8_t s_children[TOPOLOGY_MAX_NODES];
+
+static const uint8_t s_zero_mac[6] = {0};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static opt_node_t *node_state(const uint8_t *mac)
+{
+    opt_node_t *free_slot = NULL;
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_nodes[i].used && memcmp(s_nodes[i].mac, mac, 6) == 0) {
+            return &s_nodes[i];
+        }
+        if (!s_nodes[i].used && free_slot == NULL) {
+            free_slot = &s_nodes[i];
+        }
+    }
+    if (free_slot != NULL) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->used = true;
+        memcpy(free_slot->mac, mac, 6);
+    }
+    return free_slot;
+}
+
+static int snap_index(const uint8_t *mac, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (memcmp(s_snap[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Layers needed to hold count nodes if every parent filled its softAP
+ */
+static uint8_t capacity_layers(int count)
+{
+    uint8_t layers = 1;
+    int width = 1;
+    int reach = 0;
+    while (reach < count && layers < CONFIG_MESH_MAX_LAYER) {
+        width *= CONFIG_MESH_AP_CONNECTIONS;
+        reach += width;
+        layers++;
+    }
+    return layers;
+}
+
+static uint8_t node_capacity(int idx)
+{
+    if (idx == CAND_ROOT) {
+        return CONFIG_MESH_AP_CONNECTIONS;
+    }
+    const opt_node_t *st = node_state(s_snap[idx].mac);
+    return (st != NULL && st->sent_connections != 0) ? st->sent_connections : CONFIG_MESH_AP_CONNECTIONS;
+}
+
+static bool is_descendant(int idx, int ancestor)
+{
+    for (int depth = 0; depth < TOPOLOGY_MAX_DEPTH && idx >= 0; depth++) {
+        idx = s_parent[idx];
+        if (idx == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Could x hear q? The gateway has no neighbour RSSI, so only parents close
+ * to x in the tree are tried: its ancestors (the root included) and the
+ * siblings of its parent
+ */
+static bool is_near(int x, int q)
+{
+    int p = s_parent[x];
+    if (q != CAND_ROOT && s_parent[p] != CAND_NONE && s_parent[q] == s_parent[p]) {
+        return true;
+    }
+    for (int depth = 0; depth < TOPOLOGY_MAX_DEPTH && p >= 0; depth++) {
+        p = s_parent[p];
+        if (p == q) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void send_config(const opt_send_t *send)
+{
+    omniapi_message_t msg;
+    OMNIAPI_INIT_HEADER(&msg.header, MSG_CONFIG_SET, 0, sizeof(payload_config_set_t));
+
+    payload_config_set_t *cfg = (payload_config_set_t *)msg.payload;
+    memcpy(cfg->mac, send->mac, 6);
+    cfg->config_key = send->key;
+    cfg->value_len = send->len;
+    memset(cfg->value, 0, sizeof(cfg->value));
+    memcpy(cfg->value, send->value, send->len);
+
+    esp_err_t ret = mesh_network_send(send->mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_config_set_t)));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Config key %d to " MACSTR " failed: %s",
+                 send->key, MAC2STR(send->mac), esp_err_to_name(ret));
+    }
+}
+
+// ============================================================================
+// Evaluation Steps
+// ============================================================================
+
+static void build_tree(int count)
+{
+    // Forget nodes that left the map
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_nodes[i].used && snap_index(s_nodes[i].mac, count) < 0 &&
+            !(s_move.active && memcmp(s_move.mac, s_nodes[i].mac, 6) == 0)) {
+            s_nodes[i].used = false;
+        }
+    }
+
+    memset(s_children, 0, sizeof(s_children));
+    for (int i = 0; i < count; i++) {
+        if (!s_snap[i].parent_known) {
+            s_parent[i] = CAND_NONE;
+        } else if (s_snap[i].parent_is_root) {
+            s_parent[i] = CAND_ROOT;
+        } else {
+            s_parent[i] = snap_index(s_snap[i].parent_mac, count);
+            if (s_parent[i] < 0) {
+                s_parent[i] = CAND_NONE;
+            }
+        }
+        if (s_parent[i] >= 0) {
+            s_children[s_parent[i]]++;
+        }
+    }
+}
+
+static void update_hop_stats(int count)
+{
+    int nodes = 0;
+    int hops = 0;
+    uint8_t max_hops = 0;
+    for (int i = 0; i < count; i++) {
+        if (s_snap[i].layer < 2) continue;
+        uint8_t h = s_snap[i].layer - 1;
+        hops += h;
+        nodes++;
+        if (h > max_hops) max_hops = h;
+    }
+
+    s_stats.avg_hops = nodes ? (float)hops / nodes : 0;
+    s_stats.max_hops = max_hops;
+    if (!s_baseline_set && nodes > 0) {
+        s_stats.baseline_avg_hops = s_stats.avg_hops;
+        s_stats.baseline_max_hops = max_hops;
+        s_baseline_set = true;
+    }
+}
+
+static void check_pending_move(int count, int64_t now)
+{
+    if (!s_move.active) return;
+
+    int idx = snap_index(s_move.mac, count);
+    bool to_root = memcmp(s_move.parent_mac, s_zero_mac, 6) == 0;
+    bool moved = idx >= 0 &&
+                 (to_root ? s_snap[idx].parent_is_root
+                          : (s_snap[idx].parent_known && !s_snap[idx].parent_is_root &&
+                             memcmp(s_snap[idx].parent_mac, s_move.parent_mac, 6) == 0));
+
+    opt_node_t *st = node_state(s_move.mac);
+    if (moved) {
+        ESP_LOGI(TAG, "Node " MACSTR " moved", MAC2STR(s_move.mac));
+        s_stats.moves_ok++;
+    } else if (now - s_move.started_ms > OPTIMIZER_SWITCH_TIMEOUT_MS) {
+        ESP_LOGW(TAG, "Node " MACSTR " did not move", MAC2STR(s_move.mac));
+        s_stats.moves_failed++;
+        if (st != NULL) {
+            st->failed_until_ms = now + OPTIMIZER_FAIL_BACKOFF_MS;
+        }
+    } else {
+        return;
+    }
+
+    if (st != NULL) {
+        st->last_move_ms = now;
+    }
+    s_move.active = false;
+}
+
+/**
+ * Find the single most valuable parent move
+ * @return true if one was found (written to send and s_move)
+ */
+static bool pick_move(int count, int64_t now, opt_send_t *send)
+{
+    int root_children = 0;
+    for (int i = 0; i < count; i++) {
+        if (s_parent[i] == CAND_ROOT) root_children++;
+    }
+
+    float best_gain = -1;
+    int best_node = -1;
+    int best_parent = CAND_NONE;
+
+    for (int x = 0; x < count; x++) {
+        const mesh_topology_node_t *node = &s_snap[x];
+        int p = s_parent[x];
+        if (p < 0 || node->samples < TOPOLOGY_MIN_SAMPLES || node->path_etx <= 0) {
+            continue;  // Already under the root, or not settled
+        }
+
+        opt_node_t *st = node_state(node->mac);
+        if (st == NULL || (st->last_move_ms != 0 && now - st->last_move_ms < OPTIMIZER_NODE_COOLDOWN_MS) ||
+            now < st->failed_until_ms) {
+            continue;
+        }
+
+        float cur = node->path_etx;
+        float link = (node->link_etx < 1.0f) ? 1.0f : node->link_etx;
+        uint8_t parent_layer = node->layer - 1;
+        bool parent_full = s_children[p] >= node_capacity(p);
+
+        for (int q = CAND_ROOT; q < count; q++) {
+            if (q == x || q == p || !is_near(x, q)) continue;
+
+            uint8_t q_layer = 1;
+            float q_cost = 0;
+            uint8_t q_children = root_children;
+            if (q >= 0) {
+                if (s_snap[q].samples < TOPOLOGY_MIN_SAMPLES || s_snap[q].path_etx <= 0 ||
+                    is_descendant(q, x)) {
+                    continue;
+                }
+                q_layer = s_snap[q].layer;
+                q_cost = s_snap[q].path_etx;
+                q_children = s_children[q];
+            }
+            if (q_children >= node_capacity(q)) {
+                continue;
+            }
+
+            float est = q_cost + link;
+            float gain = cur - est;
+            if (q_layer < parent_layer) {
+                // Shallower parent: must clearly beat the current path
+                if (gain < OPTIMIZER_MIN_GAIN_ETX || est > cur * OPTIMIZER_MIN_GAIN_RATIO) continue;
+            } else if (q_layer == parent_layer && parent_full && q_children + 1 < s_children[p]) {
+                // Sibling of a full parent: rebalance if no worse
+                if (gain < 0) continue;
+            } else {
+                continue;
+            }
+
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_node = x;
+                best_parent = q;
+            }
+        }
+    }
+
+    if (best_node < 0) {
+        return false;
+    }
+
+    const mesh_topology_node_t *node = &s_snap[best_node];
+    config_mesh_parent_t value;
+    if (best_parent == CAND_ROOT) {
+        esp_wifi_get_mac(WIFI_IF_AP, value.parent_bssid);
+        value.parent_layer = 1;
+        memset(s_move.parent_mac, 0, 6);
+    } else {
+        // ESP32 mesh softAP MAC = station MAC + 1
+        memcpy(value.parent_bssid, s_snap[best_parent].mac, 6);
+        value.parent_bssid[5]++;
+        value.parent_layer = s_snap[best_parent].layer;
+        memcpy(s_move.parent_mac, s_snap[best_parent].mac, 6);
+    }
+
+    memcpy(s_move.mac, node->mac, 6);
+    s_move.started_ms = now;
+    s_move.active = true;
+    s_stats.moves_sent++;
+
+    memcpy(send->mac, node->mac, 6);
+    send->key = CONFIG_KEY_MESH_PARENT;
+    send->len = sizeof(value);
+    memcpy(send->value, &value, sizeof(value));
+
+    ESP_LOGI(TAG, "Moving " MACSTR " (layer %u, path ETX %.2f) under layer %u parent, est. gain %.2f",
+             MAC2STR(node->mac), node->layer, node->path_etx, value.parent_layer, best_gain);
+    return true;
+}
+
+/**
+ * Depth cap and per-node relay capacity
+ * @return Number of CONFIG_KEY_MESH_PARAMS messages queued in sends
+ */
+static int tune_params(int count, opt_send_t *sends, int max_sends)
+{
+    uint8_t deepest = 1;
+    for (int i = 0; i < count; i++) {
+        if (s_snap[i].samples < TOPOLOGY_MIN_SAMPLES) {
+            return 0;  // Wait until the whole mesh has settled
+        }
+        if (s_snap[i].layer > deepest) deepest = s_snap[i].layer;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Never below the deepest node, so nobody is stranded at the next start
+    uint8_t needed = capacity_layers(count);
+    uint8_t max_layer = ((deepest > needed) ? deepest : needed) + OPTIMIZER_LAYER_MARGIN;
+    if (max_layer < 2) max_layer = 2;
+    if (max_layer > CONFIG_MESH_MAX_LAYER) max_layer = CONFIG_MESH_MAX_LAYER;
+
+    if (max_layer != s_stats.max_layer) {
+        ESP_LOGI(TAG, "Mesh depth cap %u -> %u (deepest node at layer %u)",
+                 s_stats.max_layer, max_layer, deepest);
+        s_stats.max_layer = max_layer;
+        nvs_storage_save_blob(OPTIMIZER_NVS_KEY, &max_layer, sizeof(max_layer));
+    }
+
+    int queued = 0;
+    for (int i = 0; i < count && queued < max_sends; i++) {
+        opt_node_t *st = node_state(s_snap[i].mac);
+        if (st == NULL) continue;
+
+        // Weak uplinks make poor relays, but keep room for current children
+        uint8_t connections = CONFIG_MESH_AP_CONNECTIONS;
+        if (s_snap[i].link_etx > OPTIMIZER_WEAK_UPLINK_ETX) {
+            connections = (s_children[i] > OPTIMIZER_WEAK_CONNECTIONS) ? s_children[i] : OPTIMIZER_WEAK_CONNECTIONS;
+        }
+        if (st->sent_max_layer == max_layer && st->sent_connections == connections) {
+            continue;
+        }
+
+        config_mesh_params_t value = {
+            .max_layer = max_layer,
+            .max_connection = connections,
+        };
+        memcpy(sends[queued].mac, s_snap[i].mac, 6);
+        sends[queued].key = CONFIG_KEY_MESH_PARAMS;
+        sends[queued].len = sizeof(value);
+        memcpy(sends[queued].value, &value, sizeof(value));
+        queued++;
+
+        st->sent_max_layer = max_layer;
+        st->sent_connections = connections;
+    }
+    return queued;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t mesh_optimizer_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    memset(s_nodes, 0, sizeof(s_nodes));
+    memset(&s_move, 0, sizeof(s_move));
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    uint8_t max_layer = 0;
+    size_t len = sizeof(max_layer);
+    if (nvs_storage_load_blob(OPTIMIZER_NVS_KEY, &max_layer, &len) != ESP_OK ||
+        max_layer < 2 || max_layer > CONFIG_MESH_MAX_LAYER) {
+        max_layer = CONFIG_MESH_MAX_LAYER;
+    }
+    s_stats.max_layer = max_layer;
+
+    ESP_LOGI(TAG, "Mesh optimizer initialized (max layer %u)", max_layer);
+    return ESP_OK;
+}
+
+void mesh_optimizer_tick(void)
+{
+    int64_t now = now_ms();
+    if (s_mutex == NULL || now - s_last_eval < OPTIMIZER_PERIOD_MS) {
+        return;
+    }
+    s_last_eval = now;
+
+    int count = mesh_topology_get_all(s_snap, TOPOLOGY_MAX_NODES);
+
+    opt_send_t sends[MAX_PARAM_SENDS + 1];
+    int send_count = 0;
+
+    if (!xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+
+    s_stats.evaluations++;
+    build_tree(count);
+    update_hop_stats(count);
+    check_pending_move(count, now);
+
+#ifdef CONFIG_GATEWAY_MESH_OPTIMIZER
+    if (!s_move.active && pick_move(count, now, &sends[send_count])) {
+        send_count++;
+    }
+    send_count += tune_params(count, &sends[send_count], MAX_PARAM_SENDS);
+#endif
+
+    xSemaphoreGive(s_mutex);
+
+    for (int i = 0; i < send_count; i++) {
+        send_config(&sends[i]);
+    }
+}
+
+uint8_t mesh_optimizer_get_max_layer(void)
+{
+    return s_stats.max_layer ? s_stats.max_layer : CONFIG_MESH_MAX_LAYER;
+}
+
+void mesh_optimizer_get_stats(mesh_optimizer_stats_t *stats)
+{
+    if (stats == NULL) return;
+    memset(stats, 0, sizeof(*stats));
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
+
+cJSON* mesh_optimizer_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) {
+        return json;
+    }
+
+#ifdef CONFIG_GATEWAY_MESH_OPTIMIZER
+    cJSON_AddBoolToObject(json, "enabled", true);
+#else
+    cJSON_AddBoolToObject(json, "enabled", false);
+#endif
+    cJSON_AddNumberToObject(json, "evaluations", s_stats.evaluations);
+    cJSON_AddNumberToObject(json, "max_layer", s_stats.max_layer);
+
+    cJSON *hops = cJSON_CreateObject();
+    cJSON_AddNumberToObject(hops, "avg", s_stats.avg_hops);
+    cJSON_AddNumberToObject(hops, "max", s_stats.max_hops);
+    cJSON_AddNumberToObject(hops, "baseline_avg", s_stats.baseline_avg_hops);
+    cJSON_AddNumberToObject(hops, "baseline_max", s_stats.baseline_max_hops);
+    cJSON_AddItemToObject(json, "hops", hops);
+
+    cJSON *moves = cJSON_CreateObject();
+    cJSON_AddNumberToObject(moves, "sent", s_stats.moves_sent);
+    cJSON_AddNumberToObject(moves, "ok", s_stats.moves_ok);
+    cJSON_AddNumberToObject(moves, "failed", s_stats.moves_failed);
+    if (s_move.active) {
+        char mac_str[18];
+        snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(s_move.mac));
+        cJSON_AddStringToObject(moves, "pending", mac_str);
+    }
+    cJSON_AddItemToObject(json, "moves", moves);
+
+    xSemaphoreGive(s_mutex);
+    return json;
+}
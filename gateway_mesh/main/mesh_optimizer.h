@@ -0,0 +1,90 @@
+/**
+ * OmniaPi Gateway Mesh - Topology Optimizer
+ *
+ * Periodically reviews the topology map and:
+ *  - moves single nodes to a shallower or less loaded parent when the
+ *    estimated path cost gain clears a hysteresis margin
+ *  - caps the mesh depth just above what the network actually needs and
+ *    lowers the relay capacity of nodes with a poor uplink
+ */
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define OPTIMIZER_PERIOD_MS         60000   // Evaluation period
+#define OPTIMIZER_MIN_GAIN_ETX      0.5f    // Path ETX a move must save (hysteresis)
+#define OPTIMIZER_MIN_GAIN_RATIO    0.8f    // ...and new cost below this share of the old
+#define OPTIMIZER_SWITCH_TIMEOUT_MS 30000   // Move counted as failed if not seen by then
+#define OPTIMIZER_NODE_COOLDOWN_MS  600000  // Minimum time between moves of one node
+#define OPTIMIZER_FAIL_BACKOFF_MS   1800000 // Don't move a node again for this long after a failed move
+#define OPTIMIZER_LAYER_MARGIN      1       // Layers allowed beyond the deepest node
+#define OPTIMIZER_WEAK_UPLINK_ETX   2.0f    // Nodes above this link ETX relay for fewer children
+#define OPTIMIZER_WEAK_CONNECTIONS  2       // Their softAP capacity
+#define OPTIMIZER_NVS_KEY           "mesh_max_layer"
+
+// ============================================================================
+// Statistics
+// ============================================================================
+typedef struct {
+    uint32_t evaluations;
+    uint32_t moves_sent;
+    uint32_t moves_ok;
+    uint32_t moves_failed;
+    float    avg_hops;                  // Current average hops to the root
+    uint8_t  max_hops;
+    float    baseline_avg_hops;         // At the first evaluation, before any move
+    uint8_t  baseline_max_hops;
+    uint8_t  max_layer;                 // Mesh depth cap in effect for the next start
+} mesh_optimizer_stats_t;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize optimizer
+ * @return ESP_OK on success
+ */
+esp_err_t mesh_optimizer_init(void);
+
+/**
+ * Run an evaluation if OPTIMIZER_PERIOD_MS has elapsed (call from the
+ * heartbeat task, after mesh_topology_on_heartbeat_sent)
+ */
+void mesh_optimizer_tick(void);
+
+/**
+ * Mesh depth cap to configure at mesh start (NVS, else CONFIG_MESH_MAX_LAYER)
+ * @return Max layer
+ */
+uint8_t mesh_optimizer_get_max_layer(void);
+
+/**
+ * Get statistics
+ * @param stats Output
+ */
+void mesh_optimizer_get_stats(mesh_optimizer_stats_t *stats);
+
+/**
+ * Build status JSON (GET /api/mesh/optimizer)
+ * @return cJSON object, caller must cJSON_Delete
+ */
+cJSON* mesh_optimizer_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_OPTIMIZER_H
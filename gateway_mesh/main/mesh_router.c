@@ -0,0 +1,251 @@
+/**
+ * OmniaPi Gateway Mesh - Mesh Message Router Implementation
+ */
+
+#include "mesh_router.h"
+#include "omniapi_protocol.h"
+#include "mesh_topology.h"
+#include "node_manager.h"
+#include "commissioning.h"
+#include "ota_manager.h"
+#include "node_ota.h"
+#include "mqtt_handler.h"
+#include "cmd_latency.h"
+#include "esp_log.h"
+#include <stdio.h>
+
+static const char *TAG = "MESH_ROUTER";
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * Forward a relay node's known channel states to MQTT
+ */
+static void publish_relay_state(const uint8_t *mac)
+{
+    node_info_t *node = node_manager_get_node(mac);
+    if (node == NULL) return;
+
+    char state_json[96];
+    if (node->relay1 >= 0 && node->relay2 >= 0) {
+        snprintf(state_json, sizeof(state_json),
+                 "{\"relay1\":%d,\"relay2\":%d}", node->relay1, node->relay2);
+    } else if (node->relay1 >= 0) {
+        snprintf(state_json, sizeof(state_json), "{\"relay1\":%d}", node->relay1);
+    } else if (node->relay2 >= 0) {
+        snprintf(state_json, sizeof(state_json), "{\"relay2\":%d}", node->relay2);
+    } else {
+        return;  // No known state to publish
+    }
+    if (mqtt_publish_node_state(mac, state_json) == ESP_OK) {
+        cmd_latency_finish(mac);
+    }
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+void mesh_router_handle_rx(const uint8_t *src_mac, const uint8_t *data, size_t len)
+{
+    if (len < sizeof(omniapi_header_t)) {
+        ESP_LOGW(TAG, "Message too short: %d bytes", (int)len);
+        return;
+    }
+
+    const omniapi_message_t *msg = (const omniapi_message_t *)data;
+
+    // Validate magic
+    if (msg->header.magic != OMNIAPI_MAGIC) {
+        ESP_LOGW(TAG, "Invalid magic: 0x%04X", msg->header.magic);
+        return;
+    }
+
+    // Validate length
+    if (len < OMNIAPI_MSG_SIZE(msg->header.payload_len)) {
+        ESP_LOGW(TAG, "Payload truncated");
+        return;
+    }
+
+    ESP_LOGD(TAG, "RX from %02X:%02X:%02X:%02X:%02X:%02X msg_type=0x%02X",
+             src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
+             msg->header.msg_type);
+
+    mesh_topology_on_frame(src_mac);
+
+    // Route message based on type
+    switch (msg->header.msg_type) {
+        // Ignore messages that gateway sends (mesh echo)
+        case MSG_HEARTBEAT:
+            // Gateway sends these, ignore if echoed back
+            break;
+
+        // Node status messages
+        case MSG_HEARTBEAT_ACK:
+            if (node_manager_update_info(src_mac, (const payload_heartbeat_ack_t *)msg->payload,
+                                         msg->header.payload_len) == ESP_ERR_NOT_FOUND) {
+                // Announced while the table was full (churn): adopt it now
+                if (node_manager_add_node(src_mac) == ESP_OK) {
+                    node_manager_update_info(src_mac, (const payload_heartbeat_ack_t *)msg->payload,
+                                             msg->header.payload_len);
+                    if (mqtt_handler_is_connected()) {
+                        mqtt_queue_node_online(src_mac);
+                    }
+                }
+            }
+            mesh_topology_on_heartbeat_ack(src_mac, (const payload_heartbeat_ack_t *)msg->payload,
+                                           msg->header.payload_len);
+            break;
+
+        case MSG_NODE_ANNOUNCE: {
+            const payload_node_announce_t *announce = (const payload_node_announce_t *)msg->payload;
+            ESP_LOGI(TAG, "Node announce: type=%d, commissioned=%d, FW=0x%08lX",
+                     announce->device_type, announce->commissioned,
+                     (unsigned long)announce->firmware_version);
+
+            if (announce->commissioned) {
+                // Commissioned node: add to node_manager for normal operation.
+                // A node already online with an unchanged digest needs nothing.
+                uint8_t changes = node_manager_handle_announce(src_mac, announce,
+                                                               msg->header.payload_len);
+                if (mqtt_handler_is_connected()) {
+                    if (changes & NODE_ANNOUNCE_ONLINE) {
+                        mqtt_queue_node_online(src_mac);
+                    }
+                    if (changes & NODE_ANNOUNCE_STATE) {
+                        publish_relay_state(src_mac);
+                    }
+                }
+            } else {
+                // Uncommissioned node: add to discovered list (scan results)
+                // This handles the case where node connects AFTER scan_request was sent
+                ESP_LOGI(TAG, "Uncommissioned node detected - adding to discovered list");
+                commissioning_add_discovered_node(
+                    announce->mac,
+                    announce->device_type,
+                    announce->firmware_version,
+                    announce->commissioned
+                );
+            }
+            break;
+        }
+
+        // Commissioning messages
+        case MSG_SCAN_REQUEST:
+            // Ignore - gateway sends these, shouldn't receive them
+            ESP_LOGD(TAG, "Ignoring scan request (gateway is sender)");
+            break;
+
+        case MSG_SCAN_RESPONSE:
+            ESP_LOGI(TAG, "=== SCAN RESPONSE RECEIVED ===");
+            commissioning_handle_scan_response(src_mac, msg);
+            break;
+
+        case MSG_COMMISSION_ACK:
+            commissioning_handle_commission_ack(src_mac, msg);
+            break;
+
+        case MSG_DECOMMISSION_ACK:
+            commissioning_handle_decommission_ack(src_mac, msg);
+            break;
+
+        // OTA messages from nodes (pull-mode - node requests chunks)
+        case MSG_OTA_REQUEST:
+            ota_manager_handle_request(src_mac, (const payload_ota_request_t *)msg->payload);
+            break;
+
+        case MSG_OTA_COMPLETE:
+            // Handle both pull-mode and push-mode OTA complete
+            ota_manager_handle_complete(src_mac, (const payload_ota_complete_t *)msg->payload);
+            node_ota_handle_complete(src_mac, (const payload_ota_complete_t *)msg->payload);
+            break;
+
+        case MSG_OTA_FAILED:
+            // Handle both pull-mode and push-mode OTA failed
+            ota_manager_handle_failed(src_mac, (const payload_ota_failed_t *)msg->payload);
+            node_ota_handle_failed(src_mac, (const payload_ota_failed_t *)msg->payload);
+            break;
+
+        // Push-mode OTA messages (gateway pushes to specific node)
+        case MSG_OTA_ACK:
+            node_ota_handle_ack(src_mac, (const payload_ota_ack_t *)msg->payload);
+            break;
+
+        // Relay/LED status updates
+        case MSG_RELAY_STATUS: {
+            const payload_relay_status_t *status = (const payload_relay_status_t *)msg->payload;
+            ESP_LOGI(TAG, "Relay status from %02X:%02X:%02X:%02X:%02X:%02X: ch=%d state=%d",
+                     src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
+                     status->channel, status->state);
+
+            // Update relay state in node_manager
+            node_info_t *relay_node = node_manager_get_node(src_mac);
+            if (relay_node) {
+                if (status->channel == 0) {
+                    relay_node->relay1 = status->state ? 1 : 0;
+                } else if (status->channel == 1) {
+                    relay_node->relay2 = status->state ? 1 : 0;
+                }
+                // Keep the digest current so the next announce compares against it
+                if (status->channel < 8) {
+                    if (status->state) {
+                        relay_node->state_mask |= (uint8_t)(1 << status->channel);
+                    } else {
+                        relay_node->state_mask &= (uint8_t)~(1 << status->channel);
+                    }
+                }
+
+                if (mqtt_handler_is_connected()) {
+                    publish_relay_state(src_mac);
+                }
+            }
+            break;
+        }
+
+        case MSG_LED_STATUS: {
+            const payload_led_status_t *status = (const payload_led_status_t *)msg->payload;
+            ESP_LOGI(TAG, "LED status: on=%d r=%d g=%d b=%d brightness=%d",
+                     status->on, status->r, status->g, status->b, status->brightness);
+            // TODO: Forward to MQTT
+            break;
+        }
+
+        // Sent once per command, when the node's fade has finished
+        case MSG_DIMMER_STATUS: {
+            const payload_dimmer_status_t *status = (const payload_dimmer_status_t *)msg->payload;
+            ESP_LOGI(TAG, "Dimmer status from %02X:%02X:%02X:%02X:%02X:%02X: %d/%d/%d/%d (%d ch)",
+                     src_mac[0], src_mac[1], src_mac[2], src_mac[3], src_mac[4], src_mac[5],
+                     status->level[0], status->level[1], status->level[2], status->level[3],
+                     status->channel_count);
+
+            uint8_t count = status->channel_count;
+            if (count > DIMMER_MAX_CHANNELS) count = DIMMER_MAX_CHANNELS;
+
+            node_info_t *dimmer_node = node_manager_get_node(src_mac);
+            if (dimmer_node) {
+                dimmer_node->state_mask = 0;
+                for (int i = 0; i < count; i++) {
+                    if (status->level[i] > 0) dimmer_node->state_mask |= (uint8_t)(1 << i);
+                }
+            }
+
+            if (mqtt_handler_is_connected()) {
+                char state_json[64];
+                int n = snprintf(state_json, sizeof(state_json), "{\"level\":[");
+                for (int i = 0; i < count; i++) {
+                    n += snprintf(state_json + n, sizeof(state_json) - n, "%s%d",
+                                  i ? "," : "", status->level[i]);
+                }
+                snprintf(state_json + n, sizeof(state_json) - n, "]}");
+                mqtt_publish_node_state(src_mac, state_json);
+            }
+            break;
+        }
+
+        default:
+            ESP_LOGW(TAG, "Unknown message type: 0x%02X", msg->header.msg_type);
+            break;
+    }
+}
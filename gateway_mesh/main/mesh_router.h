@@ -0,0 +1,33 @@
+/**
+ * OmniaPi Gateway Mesh - Mesh Message Router
+ *
+ * Validates frames received from the mesh and hands each message type to
+ * the module that owns it (node manager, topology, commissioning, OTA,
+ * MQTT state publishing). Kept out of main.c so it can be linked without
+ * the rest of the application, e.g. by the host simulator in
+ * tools/mesh_sim.
+ */
+
+#ifndef MESH_ROUTER_H
+#define MESH_ROUTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Route one received mesh frame (mesh_network rx callback)
+ * @param src_mac  Sending node
+ * @param data     Frame (omniapi_message_t)
+ * @param len      Frame length
+ */
+void mesh_router_handle_rx(const uint8_t *src_mac, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_ROUTER_H
@@ -0,0 +1,559 @@
+/**
+ * OmniaPi Gateway Mesh - Topology Map Implementation
+ *
+ * Link cost model (per node, for the link to its parent):
+ *  - delivery:  EWMA of heartbeat round trips answered (gateway <-> node)
+ *  - per hop:   delivery / parent's delivery isolates this hop's share
+ *  - send_ok:   node-reported esp_mesh_send success ratio towards root
+ *  - link ETX = 1 / (hop delivery * send_ok); until enough heartbeats have
+ *    been seen, an RSSI-based prior stands in for the hop delivery
+ * A node's path ETX is the sum of link ETX up to the root, so a change on
+ * one link is picked up by every node below it without touching them.
+ */
+
+#include "mesh_topology.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_mac.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "TOPOLOGY";
+
+#define PARENT_ROOT         (-1)
+#define PARENT_UNKNOWN      (-2)
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    bool     used;
+    uint8_t  mac[6];
+    uint8_t  parent_bssid[6];           // As reported (softAP MAC of the parent)
+    int8_t   parent;                    // Entry index, PARENT_ROOT or PARENT_UNKNOWN
+    uint8_t  layer;
+    int8_t   rssi;
+    float    delivery;
+    float    send_ok;
+    float    link_etx;
+    float    rtt_ms;
+    uint32_t frames;
+    uint32_t parent_changes;
+    uint32_t samples;
+    uint32_t joined_epoch;
+    uint32_t acked_epoch;
+    uint32_t last_rx_ms;
+} topo_entry_t;
+
+static topo_entry_t s_entries[TOPOLOGY_MAX_NODES];
+static uint32_t s_epoch = 1;
+static uint32_t s_epoch_start_ms = 0;
+static uint8_t s_root_ap_mac[6] = {0};
+static uint8_t s_root_sta_mac[6] = {0};
+static SemaphoreHandle_t s_mutex = NULL;
+
+static uint32_t s_updates = 0;
+static uint64_t s_update_cycles = 0;
+static uint32_t s_max_update_cycles = 0;
+
+static const uint8_t s_zero_mac[6] = {0};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static int find_entry(const uint8_t *mac)
+{
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used && memcmp(s_entries[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * True if bssid is the softAP of the device whose station MAC is sta
+ * (ESP32 derives the softAP MAC as station MAC + 1)
+ */
+static bool is_ap_of(const uint8_t *sta, const uint8_t *bssid)
+{
+    return memcmp(sta, bssid, 6) == 0 ||
+           (memcmp(sta, bssid, 5) == 0 && (uint8_t)(sta[5] + 1) == bssid[5]);
+}
+
+static bool is_root_bssid(const uint8_t *bssid)
+{
+    if (memcmp(s_root_ap_mac, s_zero_mac, 6) == 0) {
+        esp_wifi_get_mac(WIFI_IF_AP, s_root_ap_mac);
+        esp_wifi_get_mac(WIFI_IF_STA, s_root_sta_mac);
+    }
+    return memcmp(bssid, s_root_ap_mac, 6) == 0 || is_ap_of(s_root_sta_mac, bssid);
+}
+
+static void resolve_parent(topo_entry_t *e)
+{
+    e->parent = PARENT_UNKNOWN;
+
+    if (memcmp(e->parent_bssid, s_zero_mac, 6) == 0) {
+        // No link report (older firmware): layer 2 hangs off the root
+        if (e->layer == 2) {
+            e->parent = PARENT_ROOT;
+        }
+        return;
+    }
+    if (is_root_bssid(e->parent_bssid)) {
+        e->parent = PARENT_ROOT;
+        return;
+    }
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used && &s_entries[i] != e && is_ap_of(s_entries[i].mac, e->parent_bssid)) {
+            e->parent = i;
+            return;
+        }
+    }
+}
+
+static float rssi_prior(int8_t rssi)
+{
+    if (rssi == 0 || rssi >= -65) return 1.0f;
+    if (rssi <= -90) return 0.3f;
+    return 1.0f - 0.7f * (float)(-65 - rssi) / 25.0f;
+}
+
+static void update_link(topo_entry_t *e)
+{
+    float hop;
+    if (e->samples >= TOPOLOGY_MIN_SAMPLES) {
+        float upstream = 1.0f;
+        if (e->parent >= 0 && s_entries[e->parent].samples >= TOPOLOGY_MIN_SAMPLES) {
+            upstream = s_entries[e->parent].delivery;
+        }
+        hop = (upstream > 0.05f) ? e->delivery / upstream : e->delivery;
+        if (hop > 1.0f) hop = 1.0f;
+    } else {
+        hop = rssi_prior(e->rssi);
+    }
+
+    float d = hop * e->send_ok;
+    e->link_etx = (d * TOPOLOGY_ETX_MAX > 1.0f) ? 1.0f / d : TOPOLOGY_ETX_MAX;
+}
+
+/**
+ * Path cost up to the root
+ * @param hops  Number of links (may be NULL)
+ * @return Sum of link ETX, 0 if the chain is broken or too long
+ */
+static float path_etx(int idx, int *hops)
+{
+    float cost = 0;
+    for (int depth = 0; depth < TOPOLOGY_MAX_DEPTH; depth++) {
+        const topo_entry_t *e = &s_entries[idx];
+        cost += e->link_etx;
+        if (e->parent == PARENT_ROOT) {
+            if (hops) *hops = depth + 1;
+            return cost;
+        }
+        if (e->parent == PARENT_UNKNOWN) {
+            return 0;
+        }
+        idx = e->parent;
+    }
+    return 0;
+}
+
+static void free_entry(int idx)
+{
+    s_entries[idx].used = false;
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used && s_entries[i].parent == idx) {
+            s_entries[i].parent = PARENT_UNKNOWN;
+        }
+    }
+}
+
+/**
+ * Free slot, else the one of the node heard from longest ago, provided it
+ * has missed the current heartbeat (nodes gone in churn would otherwise
+ * hold their slot for TOPOLOGY_STALE_MS)
+ */
+static int alloc_entry(void)
+{
+    int oldest = -1;
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (!s_entries[i].used) return i;
+        if (oldest < 0 || (int32_t)(s_entries[i].last_rx_ms - s_entries[oldest].last_rx_ms) < 0) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0 || (int32_t)(s_entries[oldest].last_rx_ms - s_epoch_start_ms) >= 0) {
+        return -1;
+    }
+    ESP_LOGI(TAG, "Map full, dropping " MACSTR, MAC2STR(s_entries[oldest].mac));
+    free_entry(oldest);
+    return oldest;
+}
+
+static void record_update_cost(uint32_t start)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    s_updates++;
+    s_update_cycles += cycles;
+    if (cycles > s_max_update_cycles) s_max_update_cycles = cycles;
+}
+
+// ============================================================================
+// Init
+// ============================================================================
+
+esp_err_t mesh_topology_init(void)
+{
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memset(s_entries, 0, sizeof(s_entries));
+    ESP_LOGI(TAG, "Topology map initialized (%d nodes)", TOPOLOGY_MAX_NODES);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Updates
+// ============================================================================
+
+void mesh_topology_on_frame(const uint8_t *mac)
+{
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+    int idx = find_entry(mac);
+    if (idx >= 0) {
+        s_entries[idx].frames++;
+        s_entries[idx].last_rx_ms = now_ms();
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_topology_on_heartbeat_sent(void)
+{
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t now = now_ms();
+
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        topo_entry_t *e = &s_entries[i];
+        if (!e->used) continue;
+
+        if (now - e->last_rx_ms > TOPOLOGY_STALE_MS) {
+            ESP_LOGI(TAG, "Dropping stale node " MACSTR, MAC2STR(e->mac));
+            free_entry(i);
+            continue;
+        }
+
+        // One sample per heartbeat the node has been around for
+        if (e->joined_epoch < s_epoch) {
+            float sample = (e->acked_epoch == s_epoch) ? 1.0f : 0.0f;
+            e->delivery += TOPOLOGY_EWMA_WEIGHT * (sample - e->delivery);
+            e->samples++;
+        }
+        if (e->parent == PARENT_UNKNOWN) {
+            resolve_parent(e);  // Parent may have shown up since
+        }
+    }
+    // Parents first would be nicer, but one heartbeat of lag is fine
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used) {
+            update_link(&s_entries[i]);
+        }
+    }
+    s_epoch++;
+    s_epoch_start_ms = now;
+
+    record_update_cost(start);
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_topology_on_heartbeat_ack(const uint8_t *mac, const payload_heartbeat_ack_t *ack, size_t payload_len)
+{
+    if (mac == NULL || ack == NULL) return;
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    int idx = find_entry(mac);
+    if (idx < 0) {
+        idx = alloc_entry();
+        if (idx < 0) {
+            xSemaphoreGive(s_mutex);
+            return;
+        }
+        topo_entry_t *e = &s_entries[idx];
+        memset(e, 0, sizeof(*e));
+        e->used = true;
+        memcpy(e->mac, mac, 6);
+        e->parent = PARENT_UNKNOWN;
+        e->delivery = 1.0f;
+        e->send_ok = 1.0f;
+        e->joined_epoch = s_epoch;
+
+        // Orphans waiting for this node as their parent
+        for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+            if (s_entries[i].used && s_entries[i].parent == PARENT_UNKNOWN &&
+                is_ap_of(mac, s_entries[i].parent_bssid)) {
+                s_entries[i].parent = idx;
+            }
+        }
+    }
+
+    topo_entry_t *e = &s_entries[idx];
+    bool relink = (e->layer != ack->mesh_layer);
+    if (e->acked_epoch != s_epoch && s_epoch_start_ms != 0) {
+        float rtt = (float)(now_ms() - s_epoch_start_ms);
+        e->rtt_ms = (e->rtt_ms == 0) ? rtt : e->rtt_ms + TOPOLOGY_EWMA_WEIGHT * (rtt - e->rtt_ms);
+    }
+    e->acked_epoch = s_epoch;
+    e->layer = ack->mesh_layer;
+    e->rssi = ack->rssi;
+    e->frames++;
+    e->last_rx_ms = now_ms();
+
+    if (HEARTBEAT_ACK_HAS_LINK(payload_len)) {
+        if (memcmp(e->parent_bssid, ack->parent_mac, 6) != 0) {
+            memcpy(e->parent_bssid, ack->parent_mac, 6);
+            relink = true;
+        }
+        uint16_t tx = ack->link_tx;
+        uint16_t fail = ack->link_fail;
+        if (tx > 0 && fail <= tx) {
+            float sample = (float)(tx - fail) / tx;
+            e->send_ok += TOPOLOGY_EWMA_WEIGHT * (sample - e->send_ok);
+        }
+        e->parent_changes += ack->parent_changes;
+    }
+    if (relink || e->parent == PARENT_UNKNOWN) {
+        resolve_parent(e);
+    }
+    update_link(e);
+
+    record_update_cost(start);
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_topology_remove(const uint8_t *mac)
+{
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+    int idx = find_entry(mac);
+    if (idx >= 0) {
+        free_entry(idx);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+static void fill_snapshot(int idx, mesh_topology_node_t *out)
+{
+    const topo_entry_t *e = &s_entries[idx];
+    memset(out, 0, sizeof(*out));
+    memcpy(out->mac, e->mac, 6);
+    out->parent_known = (e->parent != PARENT_UNKNOWN);
+    out->parent_is_root = (e->parent == PARENT_ROOT);
+    if (e->parent >= 0) {
+        memcpy(out->parent_mac, s_entries[e->parent].mac, 6);
+    }
+    out->layer = e->layer;
+    out->rssi = e->rssi;
+    out->delivery = e->delivery;
+    out->send_ok = e->send_ok;
+    out->link_etx = e->link_etx;
+    out->path_etx = path_etx(idx, NULL);
+    out->rtt_ms = e->rtt_ms;
+    out->frames = e->frames;
+    out->parent_changes = e->parent_changes;
+    out->samples = e->samples;
+    out->last_rx_ms = e->last_rx_ms;
+}
+
+esp_err_t mesh_topology_get_node(const uint8_t *mac, mesh_topology_node_t *out)
+{
+    if (mac == NULL || out == NULL) return ESP_ERR_INVALID_ARG;
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return ESP_ERR_TIMEOUT;
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    int idx = find_entry(mac);
+    if (idx >= 0) {
+        fill_snapshot(idx, out);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+int mesh_topology_get_all(mesh_topology_node_t *out, int max)
+{
+    if (out == NULL) return 0;
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return 0;
+
+    int count = 0;
+    for (int i = 0; i < TOPOLOGY_MAX_NODES && count < max; i++) {
+        if (s_entries[i].used) {
+            fill_snapshot(i, &out[count++]);
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+int mesh_topology_get_path(const uint8_t *mac, uint8_t path[][6], int max)
+{
+    if (mac == NULL) return -1;
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return -1;
+
+    int count = -1;
+    int idx = find_entry(mac);
+    if (idx >= 0) {
+        int n = 0;
+        for (int depth = 0; depth < TOPOLOGY_MAX_DEPTH; depth++) {
+            int parent = s_entries[idx].parent;
+            if (parent == PARENT_ROOT) {
+                count = n;
+                break;
+            }
+            if (parent == PARENT_UNKNOWN || n >= max) {
+                break;
+            }
+            memcpy(path[n++], s_entries[parent].mac, 6);
+            idx = parent;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return count;
+}
+
+uint32_t mesh_topology_scale_timeout(const uint8_t *mac, uint32_t base_ms)
+{
+    if (mac == NULL) return base_ms;
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return base_ms;
+
+    float scale = 1.0f;
+    int idx = find_entry(mac);
+    if (idx >= 0) {
+        int hops = 0;
+        float cost = path_etx(idx, &hops);
+        if (cost > 0 && hops > 0) {
+            scale = cost / hops;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (scale < 1.0f) scale = 1.0f;
+    if (scale > TOPOLOGY_TIMEOUT_SCALE_MAX) scale = TOPOLOGY_TIMEOUT_SCALE_MAX;
+    return (uint32_t)(base_ms * scale);
+}
+
+void mesh_topology_get_stats(mesh_topology_stats_t *stats)
+{
+    if (stats == NULL) return;
+    memset(stats, 0, sizeof(*stats));
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) return;
+
+    stats->updates = s_updates;
+    stats->avg_update_cycles = s_updates ? (uint32_t)(s_update_cycles / s_updates) : 0;
+    stats->max_update_cycles = s_max_update_cycles;
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used) stats->node_count++;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+
+static void add_mac_string(cJSON *obj, const char *key, const uint8_t *mac)
+{
+    char mac_str[18];
+    snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(mac));
+    cJSON_AddStringToObject(obj, key, mac_str);
+}
+
+static cJSON* node_json(int idx, int depth);
+
+static cJSON* children_json(int parent, int depth)
+{
+    cJSON *children = cJSON_CreateArray();
+    if (depth >= TOPOLOGY_MAX_DEPTH) {
+        return children;
+    }
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (s_entries[i].used && s_entries[i].parent == parent) {
+            cJSON_AddItemToArray(children, node_json(i, depth + 1));
+        }
+    }
+    return children;
+}
+
+static cJSON* node_json(int idx, int depth)
+{
+    const topo_entry_t *e = &s_entries[idx];
+    cJSON *node = cJSON_CreateObject();
+
+    add_mac_string(node, "mac", e->mac);
+    cJSON_AddNumberToObject(node, "layer", e->layer);
+    cJSON_AddNumberToObject(node, "rssi", e->rssi);
+    cJSON_AddNumberToObject(node, "delivery", e->delivery);
+    cJSON_AddNumberToObject(node, "send_ok", e->send_ok);
+    cJSON_AddNumberToObject(node, "link_etx", e->link_etx);
+    cJSON_AddNumberToObject(node, "path_etx", path_etx(idx, NULL));
+    cJSON_AddNumberToObject(node, "rtt_ms", e->rtt_ms);
+    cJSON_AddNumberToObject(node, "samples", e->samples);
+    cJSON_AddNumberToObject(node, "frames", e->frames);
+    cJSON_AddNumberToObject(node, "parent_changes", e->parent_changes);
+    if (e->parent == PARENT_UNKNOWN && memcmp(e->parent_bssid, s_zero_mac, 6) != 0) {
+        add_mac_string(node, "parent_bssid", e->parent_bssid);
+    }
+    cJSON_AddItemToObject(node, "children", children_json(idx, depth));
+    return node;
+}
+
+cJSON* mesh_topology_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    if (s_mutex == NULL || !xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100))) {
+        return json;
+    }
+
+    is_root_bssid(s_zero_mac);  // Make sure the root MACs are loaded
+    add_mac_string(json, "root", s_root_sta_mac);
+
+    int count = 0;
+    cJSON *unattached = cJSON_CreateArray();
+    for (int i = 0; i < TOPOLOGY_MAX_NODES; i++) {
+        if (!s_entries[i].used) continue;
+        count++;
+        if (s_entries[i].parent == PARENT_UNKNOWN) {
+            cJSON_AddItemToArray(unattached, node_json(i, 0));
+        }
+    }
+    cJSON_AddNumberToObject(json, "count", count);
+    cJSON_AddItemToObject(json, "tree", children_json(PARENT_ROOT, 0));
+    cJSON_AddItemToObject(json, "unattached", unattached);
+
+    cJSON *stats = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stats, "updates", s_updates);
+    cJSON_AddNumberToObject(stats, "avg_update_cycles", s_updates ? (double)s_update_cycles / s_updates : 0);
+    cJSON_AddNumberToObject(stats, "max_update_cycles", s_max_update_cycles);
+    cJSON_AddItemToObject(json, "stats", stats);
+
+    xSemaphoreGive(s_mutex);
+    return json;
+}
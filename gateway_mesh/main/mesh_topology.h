@@ -0,0 +1,150 @@
+/**
+ * OmniaPi Gateway Mesh - Topology Map
+ *
+ * Live parent/child tree of the mesh built from the parent link reports in
+ * heartbeat ACKs, with an ETX-style cost per link (expected transmissions,
+ * 1.0 = perfect link) updated from ordinary traffic.
+ */
+
+#ifndef MESH_TOPOLOGY_H
+#define MESH_TOPOLOGY_H
+
+#include "esp_err.h"
+#include "omniapi_protocol.h"
+#include "node_manager.h"
+#include "cJSON.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define TOPOLOGY_MAX_NODES      MAX_NODES
+#define TOPOLOGY_MAX_DEPTH      10      // Longest parent chain followed (cycle guard)
+#define TOPOLOGY_EWMA_WEIGHT    0.125f  // Weight of a new delivery sample
+#define TOPOLOGY_MIN_SAMPLES    4       // Heartbeats before measured delivery replaces the RSSI prior
+#define TOPOLOGY_ETX_MAX        10.0f   // Cost of an unusable link
+#define TOPOLOGY_TIMEOUT_SCALE_MAX 3    // Upper bound for mesh_topology_scale_timeout()
+#define TOPOLOGY_STALE_MS       120000  // Forget nodes silent for this long
+
+// ============================================================================
+// Node Snapshot
+// ============================================================================
+typedef struct {
+    uint8_t  mac[6];
+    uint8_t  parent_mac[6];             // Parent node STA MAC (valid if parent_known && !parent_is_root)
+    bool     parent_known;
+    bool     parent_is_root;
+    uint8_t  layer;                     // Mesh layer reported by the node (root = 1)
+    int8_t   rssi;                      // Parent link RSSI
+    float    delivery;                  // Heartbeat round-trip delivery ratio (EWMA, end to end)
+    float    send_ok;                   // Node-reported send success ratio towards root (EWMA)
+    float    link_etx;                  // Cost of the link to the parent
+    float    path_etx;                  // Sum of link costs up to the root (0 if path unknown)
+    float    rtt_ms;                    // Heartbeat round trip (EWMA, 0 until measured)
+    uint32_t frames;                    // Frames received from the node
+    uint32_t parent_changes;            // Parent switches reported
+    uint32_t samples;                   // Heartbeat delivery samples taken
+    uint32_t last_rx_ms;
+} mesh_topology_node_t;
+
+typedef struct {
+    uint32_t updates;                   // Incremental updates applied
+    uint32_t avg_update_cycles;         // Mean CPU cycles per update
+    uint32_t max_update_cycles;
+    uint8_t  node_count;
+} mesh_topology_stats_t;
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize topology map
+ * @return ESP_OK on success
+ */
+esp_err_t mesh_topology_init(void);
+
+/**
+ * Record a frame received from a node (any message type)
+ * @param mac Node MAC
+ */
+void mesh_topology_on_frame(const uint8_t *mac);
+
+/**
+ * Start a heartbeat epoch: nodes that did not answer the previous heartbeat
+ * get a failed delivery sample (call right before the heartbeat broadcast,
+ * the ACKs are timed from here)
+ */
+void mesh_topology_on_heartbeat_sent(void);
+
+/**
+ * Update a node from its heartbeat ACK
+ * @param mac          Node MAC
+ * @param ack          Heartbeat ACK payload
+ * @param payload_len  Payload length (older nodes send no link report)
+ */
+void mesh_topology_on_heartbeat_ack(const uint8_t *mac, const payload_heartbeat_ack_t *ack, size_t payload_len);
+
+/**
+ * Forget a node (decommissioned)
+ * @param mac Node MAC
+ */
+void mesh_topology_remove(const uint8_t *mac);
+
+/**
+ * Get a node snapshot
+ * @param mac   Node MAC
+ * @param out   Output snapshot
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND
+ */
+esp_err_t mesh_topology_get_node(const uint8_t *mac, mesh_topology_node_t *out);
+
+/**
+ * Snapshot every node in the map
+ * @param out  Output snapshots
+ * @param max  Size of out
+ * @return Number of snapshots written
+ */
+int mesh_topology_get_all(mesh_topology_node_t *out, int max);
+
+/**
+ * Get the ancestors of a node, nearest first (the root is not included)
+ * @param mac    Node MAC
+ * @param path   Output ancestor MACs
+ * @param max    Size of path
+ * @return Number of ancestors, or -1 if the chain to the root is not known
+ */
+int mesh_topology_get_path(const uint8_t *mac, uint8_t path[][6], int max);
+
+/**
+ * Scale a per-hop-agnostic timeout by how much worse than ideal the node's
+ * path is (path ETX / hop count), between 1x and TOPOLOGY_TIMEOUT_SCALE_MAX
+ * @param mac      Node MAC
+ * @param base_ms  Timeout for a clean path
+ * @return Scaled timeout (base_ms if the path is unknown)
+ */
+uint32_t mesh_topology_scale_timeout(const uint8_t *mac, uint32_t base_ms);
+
+/**
+ * Get update statistics
+ * @param stats Output
+ */
+void mesh_topology_get_stats(mesh_topology_stats_t *stats);
+
+/**
+ * Build the topology tree as JSON (GET /api/mesh/topology)
+ * @return cJSON object, caller must cJSON_Delete
+ */
+cJSON* mesh_topology_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_TOPOLOGY_H
@@ -6,13 +6,19 @@
  */
 
 #include "mqtt_handler.h"
+#include "mqtt_tls.h"
 #include "commissioning.h"
 #include "ota_manager.h"
+#include "fleet_ota.h"
 #include "omniapi_protocol.h"
 #include "config_manager.h"
 #include "eth_manager.h"
 #include "node_manager.h"
 #include "mesh_network.h"
+#include "cmd_latency.h"
+#include "ble_prov.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_timer.h"
@@ -26,16 +32,29 @@
 
 static const char *TAG = "MQTT_HDL";
 
+// Client buffers; fleet OTA status documents outgrow the default with many nodes
+#define MQTT_BUFFER_SIZE            1024    // esp-mqtt default
+#define MQTT_BUFFER_SIZE_LARGE      6144    // With BT memory reclaimed at boot
+
 // ============================================================================
 // State
 // ============================================================================
 static esp_mqtt_client_handle_t s_client = NULL;
 static bool s_connected = false;
 static bool s_mqtt_suspended = false;  // Block reconnect during mesh switch
+static int64_t s_down_us = 0;          // Link lost (or resumed) at, 0 = up / not counting
+static mqtt_link_stats_t s_link_stats = {0};
+static uint64_t s_reconnect_total_ms = 0;
 static char s_lwt_message[64] = {0};
 static char s_mac_str[18] = "00:00:00:00:00:00";
 static char s_mac_topic[13] = "000000000000"; // MAC without colons, used in per-gateway MQTT topics
 
+// Node online reports waiting for the batch timer
+static uint8_t s_online_pending[MAX_NODES][6];
+static int s_online_count = 0;
+static SemaphoreHandle_t s_online_mutex = NULL;
+static esp_timer_handle_t s_online_timer = NULL;
+
 // Callbacks from main.c
 extern void on_mqtt_connected(void);
 extern void on_mqtt_disconnected(void);
@@ -51,10 +70,12 @@ static void handle_credentials_command(const char *data, int data_len);
 static void handle_identify_command(const char *data, int data_len);
 static void handle_ota_start_command(const char *data, int data_len);
 static void handle_ota_abort_command(const char *data, int data_len);
+static void handle_fleet_ota_start_command(const char *data, int data_len);
 static void handle_relay_command(const char *data, int data_len);
 static void handle_delete_node_command(const char *data, int data_len);
 static void handle_factory_reset_command(void);
 static bool parse_mac_address(const char *mac_str, uint8_t *mac_out);
+static void online_batch_cb(void *arg);
 
 typedef struct {
     batch_node_t nodes[MAX_BATCH_NODES];
@@ -82,6 +103,18 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT Connected");
             s_connected = true;
+            if (s_down_us != 0) {
+                uint32_t ms = (uint32_t)((esp_timer_get_time() - s_down_us) / 1000);
+                s_down_us = 0;
+                s_link_stats.reconnects++;
+                s_reconnect_total_ms += ms;
+                s_link_stats.last_reconnect_ms = ms;
+                s_link_stats.avg_reconnect_ms = (uint32_t)(s_reconnect_total_ms / s_link_stats.reconnects);
+                if (ms > s_link_stats.max_reconnect_ms) {
+                    s_link_stats.max_reconnect_ms = ms;
+                }
+                ESP_LOGI(TAG, "MQTT back after %lu ms", (unsigned long)ms);
+            }
             on_mqtt_connected();
 
             // Subscribe to per-gateway topics (MAC-specific: only THIS gateway receives these)
@@ -110,6 +143,9 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             ESP_LOGW(TAG, "MQTT Disconnected (suspended=%d)", s_mqtt_suspended);
             s_connected = false;
             if (!s_mqtt_suspended) {
+                if (s_down_us == 0) {
+                    s_down_us = esp_timer_get_time();
+                }
                 on_mqtt_disconnected();
             }
             break;
@@ -160,6 +196,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             else if (strcmp(topic, MQTT_TOPIC_OTA_ABORT) == 0) {
                 handle_ota_abort_command(event->data, event->data_len);
             }
+            else if (strcmp(topic, MQTT_TOPIC_FLEET_OTA_START) == 0) {
+                handle_fleet_ota_start_command(event->data, event->data_len);
+            }
+            else if (strcmp(topic, MQTT_TOPIC_FLEET_OTA_CONTINUE) == 0) {
+                fleet_ota_continue();
+            }
+            else if (strcmp(topic, MQTT_TOPIC_FLEET_OTA_ABORT) == 0) {
+                fleet_ota_abort();
+            }
             else if (strcmp(topic, MQTT_TOPIC_CMD "/reboot") == 0) {
                 ESP_LOGW(TAG, "Reboot command received! Restarting in 1 second...");
                 mqtt_publish_gateway_status(false);
@@ -230,6 +275,8 @@ esp_err_t mqtt_handler_init(void)
         .credentials.client_id = mqtt_config->client_id,
         .session.keepalive = 60,
         .network.reconnect_timeout_ms = 5000,
+        .buffer.size = ble_prov_bt_memory_released() ? MQTT_BUFFER_SIZE_LARGE : MQTT_BUFFER_SIZE,
+        .buffer.out_size = ble_prov_bt_memory_released() ? MQTT_BUFFER_SIZE_LARGE : MQTT_BUFFER_SIZE,
         // Last Will and Testament (same topic as status)
         .session.last_will = {
             .topic = MQTT_TOPIC_STATUS,
@@ -240,6 +287,29 @@ esp_err_t mqtt_handler_init(void)
         },
     };
 
+    if (s_online_timer == NULL) {
+        s_online_mutex = xSemaphoreCreateMutex();
+        const esp_timer_create_args_t online_args = {
+            .callback = online_batch_cb,
+            .name = "mqtt_online",
+        };
+        if (s_online_mutex == NULL || esp_timer_create(&online_args, &s_online_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create online batch timer");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // mqtts:// goes through our TLS transport so reconnects can resume the session
+    if (strncmp(mqtt_config->broker_uri, "mqtts://", 8) == 0) {
+        esp_transport_handle_t tls = mqtt_tls_transport_create();
+        if (tls == NULL) {
+            ESP_LOGE(TAG, "Failed to create TLS transport");
+            return ESP_ERR_NO_MEM;
+        }
+        mqtt_cfg.network.transport = tls;
+        s_link_stats.tls = true;
+    }
+
     s_client = esp_mqtt_client_init(&mqtt_cfg);
     if (s_client == NULL) {
         ESP_LOGE(TAG, "Failed to create MQTT client");
@@ -281,6 +351,7 @@ esp_err_t mqtt_handler_suspend(void)
     ESP_LOGW(TAG, "MQTT SUSPENDED - disconnecting for mesh switch");
     s_mqtt_suspended = true;
     s_connected = false;
+    s_down_us = 0;  // Time spent suspended is not reconnect time
     esp_mqtt_client_disconnect(s_client);
     return ESP_OK;
 }
@@ -289,6 +360,7 @@ esp_err_t mqtt_handler_resume(void)
 {
     if (s_client == NULL) return ESP_ERR_INVALID_STATE;
     s_mqtt_suspended = false;
+    s_down_us = esp_timer_get_time();
     // Stop completely to reset stale transport/socket after mesh switch
     esp_mqtt_client_stop(s_client);
     vTaskDelay(pdMS_TO_TICKS(500));
@@ -298,6 +370,24 @@ esp_err_t mqtt_handler_resume(void)
     return ESP_OK;
 }
 
+void mqtt_handler_on_uplink(void)
+{
+    if (s_client == NULL || s_connected || s_mqtt_suspended) return;
+
+    // Connect now instead of at the end of reconnect_timeout_ms
+    if (esp_mqtt_client_reconnect(s_client) == ESP_OK) {
+        s_link_stats.uplink_kicks++;
+        ESP_LOGI(TAG, "Uplink up - reconnecting MQTT now");
+    }
+}
+
+void mqtt_handler_get_link_stats(mqtt_link_stats_t *stats)
+{
+    if (stats == NULL) return;
+    *stats = s_link_stats;
+    mqtt_tls_get_stats(&stats->handshake);
+}
+
 // ============================================================================
 // Command Handlers
 // ============================================================================
@@ -654,7 +744,12 @@ static void handle_relay_command(const char *data, int data_len)
     payload->channel = channel;
     payload->action = action;
 
+    // Closed by the node's state publish (see cmd_latency.h)
+    cmd_latency_start(mac);
     esp_err_t ret = mesh_network_send(mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_relay_cmd_t)));
+    if (ret != ESP_OK) {
+        cmd_latency_cancel(mac);
+    }
 
     ESP_LOGI(TAG, "Relay command sent to %s: ch=%d action=%s result=%s",
              mac_json->valuestring, channel, action_str, esp_err_to_name(ret));
@@ -814,6 +909,78 @@ esp_err_t mqtt_publish_node_connected(const uint8_t *mac)
     return (msg_id >= 0) ? ESP_OK : ESP_FAIL;
 }
 
+esp_err_t mqtt_queue_node_online(const uint8_t *mac)
+{
+    if (!s_connected || mac == NULL) return ESP_ERR_INVALID_STATE;
+    if (s_online_timer == NULL) return mqtt_publish_node_connected(mac);
+
+    if (xSemaphoreTake(s_online_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_OK;
+    bool queued = false;
+    for (int i = 0; i < s_online_count; i++) {
+        if (memcmp(s_online_pending[i], mac, 6) == 0) {
+            queued = true;
+            break;
+        }
+    }
+    if (!queued) {
+        if (s_online_count < MAX_NODES) {
+            memcpy(s_online_pending[s_online_count++], mac, 6);
+        } else {
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+    // Window opens with the first report and is not extended by later ones
+    if (s_online_count == 1 && !esp_timer_is_active(s_online_timer)) {
+        esp_timer_start_once(s_online_timer, MQTT_ONLINE_BATCH_MS * 1000ULL);
+    }
+
+    xSemaphoreGive(s_online_mutex);
+    return ret;
+}
+
+static void online_batch_cb(void *arg)
+{
+    static uint8_t batch[MAX_NODES][6];
+    int count = 0;
+
+    if (xSemaphoreTake(s_online_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        count = s_online_count;
+        memcpy(batch, s_online_pending, count * 6);
+        s_online_count = 0;
+        xSemaphoreGive(s_online_mutex);
+    }
+    if (count == 0 || !s_connected) return;
+
+    if (count == 1) {
+        mqtt_publish_node_connected(batch[0]);
+        return;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *nodes = cJSON_CreateArray();
+    for (int i = 0; i < count; i++) {
+        char mac_str[13];
+        snprintf(mac_str, sizeof(mac_str), "%02X%02X%02X%02X%02X%02X",
+                 batch[i][0], batch[i][1], batch[i][2],
+                 batch[i][3], batch[i][4], batch[i][5]);
+        cJSON_AddItemToArray(nodes, cJSON_CreateString(mac_str));
+    }
+    cJSON_AddItemToObject(root, "nodes", nodes);
+    cJSON_AddNumberToObject(root, "count", count);
+
+    char *payload = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (payload == NULL) return;
+
+    esp_mqtt_client_publish(s_client, MQTT_TOPIC_NODES_ONLINE, payload, 0, 1, 0);
+    ESP_LOGI(TAG, "Published %d nodes back online", count);
+    cJSON_free(payload);
+}
+
 esp_err_t mqtt_publish_node_disconnected(const uint8_t *mac)
 {
     if (!s_connected || mac == NULL) return ESP_ERR_INVALID_STATE;
@@ -1080,6 +1247,60 @@ static void handle_ota_abort_command(const char *data, int data_len)
     ota_manager_abort();
 }
 
+// Rollout of the image staged via POST /api/fleet/ota/upload
+static void handle_fleet_ota_start_command(const char *data, int data_len)
+{
+    ESP_LOGI(TAG, "Fleet OTA start command received");
+
+    cJSON *json = cJSON_ParseWithLength(data, data_len);
+    if (json == NULL) {
+        ESP_LOGE(TAG, "Failed to parse fleet OTA start JSON");
+        return;
+    }
+
+    cJSON *version_json = cJSON_GetObjectItem(json, "version");
+    if (!version_json || !cJSON_IsString(version_json)) {
+        ESP_LOGE(TAG, "Missing version in fleet OTA start command");
+        cJSON_Delete(json);
+        return;
+    }
+
+    fleet_ota_config_t config = {0};
+    strncpy(config.version, version_json->valuestring, sizeof(config.version) - 1);
+
+    cJSON *item = cJSON_GetObjectItem(json, "device_type");
+    if (item && cJSON_IsNumber(item)) config.device_type = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(json, "canary");
+    if (item && cJSON_IsNumber(item)) config.canary_count = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(json, "max_concurrency");
+    if (item && cJSON_IsNumber(item)) config.max_concurrency = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(json, "pause_after_canary");
+    if (item && cJSON_IsBool(item)) config.pause_after_canary = cJSON_IsTrue(item);
+
+    // Optional: target MACs (default: all commissioned nodes of device_type)
+    static uint8_t target_macs[FLEET_OTA_MAX_TARGETS][6];
+    uint8_t target_count = 0;
+
+    cJSON *targets_json = cJSON_GetObjectItem(json, "targets");
+    if (targets_json && cJSON_IsArray(targets_json)) {
+        int array_size = cJSON_GetArraySize(targets_json);
+        for (int i = 0; i < array_size && target_count < FLEET_OTA_MAX_TARGETS; i++) {
+            cJSON *mac_item = cJSON_GetArrayItem(targets_json, i);
+            if (mac_item && cJSON_IsString(mac_item) &&
+                parse_mac_address(mac_item->valuestring, target_macs[target_count])) {
+                target_count++;
+            }
+        }
+    }
+
+    esp_err_t ret = fleet_ota_start(&config, (target_count > 0) ? target_macs : NULL, target_count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start fleet OTA: %s", esp_err_to_name(ret));
+    }
+
+    cJSON_Delete(json);
+}
+
 // ============================================================================
 // Publishing Functions - OTA
 // ============================================================================
@@ -11,9 +11,26 @@
 #include "esp_err.h"
 #include "omniapi_protocol.h"
 #include "commissioning.h"
+#include "mqtt_tls.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+#define MQTT_ONLINE_BATCH_MS        1000    // Node online reports collected per message
+
+/**
+ * Broker link statistics. Reconnect time runs from the link loss (or
+ * resume after a scan) to the broker session being back.
+ */
+typedef struct {
+    bool tls;                       // mqtts:// broker
+    uint32_t reconnects;
+    uint32_t last_reconnect_ms;
+    uint32_t avg_reconnect_ms;
+    uint32_t max_reconnect_ms;
+    uint32_t uplink_kicks;          // Reconnects started early by an uplink coming back
+    mqtt_tls_stats_t handshake;     // Handshakes (when tls)
+} mqtt_link_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -65,6 +82,17 @@ esp_err_t mqtt_handler_suspend(void);
  */
 esp_err_t mqtt_handler_resume(void);
 
+/**
+ * An uplink (Ethernet or router) came up: reconnect right away if the
+ * broker link is down, instead of waiting out the reconnect timeout
+ */
+void mqtt_handler_on_uplink(void);
+
+/**
+ * Get broker link statistics (reconnect times, TLS handshakes)
+ */
+void mqtt_handler_get_link_stats(mqtt_link_stats_t *stats);
+
 // ============================================================================
 // Generic Publishing
 // ============================================================================
@@ -97,6 +125,16 @@ esp_err_t mqtt_publish_gateway_status(bool online);
  */
 esp_err_t mqtt_publish_node_connected(const uint8_t *mac);
 
+/**
+ * Queue a node online report. Reports arriving within MQTT_ONLINE_BATCH_MS
+ * are published together on MQTT_TOPIC_NODES_ONLINE (a lone report goes out
+ * as mqtt_publish_node_connected), so a whole installation powering up
+ * costs one message instead of one per node.
+ * @param mac Node MAC address (6 bytes)
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_queue_node_online(const uint8_t *mac);
+
 /**
  * Publish node disconnected event
  * @param mac Node MAC address (6 bytes)
@@ -0,0 +1,257 @@
+/**
+ * OmniaPi Gateway Mesh - MQTT TLS Transport Implementation
+ *
+ * Mirrors the esp_transport_ssl read/write/poll semantics that esp-mqtt
+ * expects; the only difference is the client session handed to esp-tls.
+ */
+
+#include "mqtt_tls.h"
+#include "esp_tls.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "MQTT_TLS";
+
+// ============================================================================
+// State
+// ============================================================================
+typedef struct {
+    esp_tls_t *tls;
+    int sockfd;
+} mqtt_tls_ctx_t;
+
+// Only esp-mqtt's task connects, so the cache needs no lock
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+static esp_tls_client_session_t *s_session = NULL;
+#endif
+static mqtt_tls_stats_t s_stats = {0};
+static uint64_t s_full_total_ms = 0;
+static uint64_t s_resumed_total_ms = 0;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int poll_socket(int sockfd, int timeout_ms, bool for_write)
+{
+    fd_set fds;
+    fd_set errfds;
+    FD_ZERO(&fds);
+    FD_ZERO(&errfds);
+    FD_SET(sockfd, &fds);
+    FD_SET(sockfd, &errfds);
+
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(sockfd + 1, for_write ? NULL : &fds, for_write ? &fds : NULL,
+                     &errfds, timeout_ms < 0 ? NULL : &tv);
+    if (ret > 0 && FD_ISSET(sockfd, &errfds)) {
+        return -1;
+    }
+    return ret;
+}
+
+static void close_ctx(mqtt_tls_ctx_t *ctx)
+{
+    if (ctx->tls != NULL) {
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+    }
+    ctx->sockfd = -1;
+}
+
+// ============================================================================
+// Transport Functions
+// ============================================================================
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    close_ctx(ctx);
+
+    esp_tls_cfg_t cfg = {
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = timeout_ms,
+    };
+    bool resuming = false;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    cfg.client_session = s_session;
+    resuming = (s_session != NULL);
+#endif
+
+    ctx->tls = esp_tls_init();
+    if (ctx->tls == NULL) {
+        return -1;
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (esp_tls_conn_new_sync(host, strlen(host), port, &cfg, ctx->tls) != 1) {
+        s_stats.failed++;
+        ESP_LOGW(TAG, "TLS connect to %s:%d failed%s", host, port,
+                 resuming ? " (dropping cached session)" : "");
+        close_ctx(ctx);
+        if (resuming) {
+            // A rejected or expired session must not block the next attempt
+            mqtt_tls_forget_session();
+        }
+        return -1;
+    }
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    s_stats.last_ms = ms;
+    if (resuming) {
+        s_stats.resumed++;
+        s_resumed_total_ms += ms;
+        s_stats.resumed_avg_ms = (uint32_t)(s_resumed_total_ms / s_stats.resumed);
+    } else {
+        s_stats.full++;
+        s_full_total_ms += ms;
+        s_stats.full_avg_ms = (uint32_t)(s_full_total_ms / s_stats.full);
+    }
+    ESP_LOGI(TAG, "TLS %s handshake with %s:%d in %lu ms",
+             resuming ? "resumed" : "full", host, port, (unsigned long)ms);
+
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // Keep the newest session for the next connect
+    esp_tls_client_session_t *session = esp_tls_get_client_session(ctx->tls);
+    if (session != NULL) {
+        if (s_session != NULL) {
+            esp_tls_free_client_session(s_session);
+        }
+        s_session = session;
+    }
+#endif
+
+    esp_tls_get_conn_sockfd(ctx->tls, &ctx->sockfd);
+    return 0;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) return -1;
+
+    // Records already decrypted by mbedTLS never show up on the socket
+    if (esp_tls_get_bytes_avail(ctx->tls) > 0) {
+        return 1;
+    }
+    return poll_socket(ctx->sockfd, timeout_ms, false);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) return -1;
+    return poll_socket(ctx->sockfd, timeout_ms, true);
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) return -1;
+
+    int poll = 1;
+    if (esp_tls_get_bytes_avail(ctx->tls) <= 0) {
+        poll = poll_socket(ctx->sockfd, timeout_ms, false);
+        if (poll == 0) {
+            return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+        }
+        if (poll < 0) {
+            return -1;
+        }
+    }
+
+    ssize_t ret = esp_tls_conn_read(ctx->tls, buffer, len);
+    if (ret < 0) {
+        if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) {
+            return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+        }
+        return -1;
+    }
+    if (ret == 0 && poll > 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    return (int)ret;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) return -1;
+
+    int poll = poll_socket(ctx->sockfd, timeout_ms, true);
+    if (poll <= 0) {
+        return poll;
+    }
+
+    ssize_t ret = esp_tls_conn_write(ctx->tls, buffer, len);
+    return ret < 0 ? -1 : (int)ret;
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    close_ctx(esp_transport_get_context_data(t));
+    return 0;
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    mqtt_tls_ctx_t *ctx = esp_transport_get_context_data(t);
+    close_ctx(ctx);
+    free(ctx);
+    return 0;
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_transport_handle_t mqtt_tls_transport_create(void)
+{
+    mqtt_tls_ctx_t *ctx = calloc(1, sizeof(mqtt_tls_ctx_t));
+    if (ctx == NULL) return NULL;
+    ctx->sockfd = -1;
+
+    esp_transport_handle_t t = esp_transport_init();
+    if (t == NULL) {
+        free(ctx);
+        return NULL;
+    }
+
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+                           tls_poll_read, tls_poll_write, tls_destroy);
+    esp_transport_set_default_port(t, MQTT_TLS_DEFAULT_PORT);
+
+#ifndef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    ESP_LOGW(TAG, "CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS off - every reconnect is a full handshake");
+#endif
+    return t;
+}
+
+void mqtt_tls_forget_session(void)
+{
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    if (s_session != NULL) {
+        esp_tls_free_client_session(s_session);
+        s_session = NULL;
+    }
+#endif
+}
+
+void mqtt_tls_get_stats(mqtt_tls_stats_t *stats)
+{
+    if (stats == NULL) return;
+    *stats = s_stats;
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    stats->session_cached = (s_session != NULL);
+#else
+    stats->session_cached = false;
+#endif
+}
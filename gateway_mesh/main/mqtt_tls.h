@@ -0,0 +1,62 @@
+/**
+ * OmniaPi Gateway Mesh - MQTT TLS Transport
+ *
+ * esp-tls based transport for mqtts:// brokers that keeps the TLS session
+ * (ticket) of the last successful handshake and offers it on the next
+ * connect, so reconnects after a link flap or a scan's suspend/resume do
+ * an abbreviated handshake instead of the full certificate exchange and
+ * key agreement. The server certificate is checked against the ESP-IDF
+ * certificate bundle.
+ *
+ * Resumption needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS; without it every
+ * connect is a full handshake.
+ */
+
+#ifndef MQTT_TLS_H
+#define MQTT_TLS_H
+
+#include "esp_err.h"
+#include "esp_transport.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_TLS_DEFAULT_PORT       8883
+
+/**
+ * Handshake statistics (times include the TCP connect)
+ */
+typedef struct {
+    uint32_t full;                  // Handshakes without a cached session
+    uint32_t resumed;               // Handshakes offering a cached session
+    uint32_t failed;
+    uint32_t full_avg_ms;
+    uint32_t resumed_avg_ms;
+    uint32_t last_ms;
+    bool session_cached;
+} mqtt_tls_stats_t;
+
+/**
+ * Create the transport (pass as network.transport to esp-mqtt)
+ * @return Transport handle, NULL on out of memory
+ */
+esp_transport_handle_t mqtt_tls_transport_create(void);
+
+/**
+ * Drop the cached session (next connect does a full handshake)
+ */
+void mqtt_tls_forget_session(void);
+
+/**
+ * Get handshake statistics
+ */
+void mqtt_tls_get_stats(mqtt_tls_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_TLS_H
@@ -3,15 +3,24 @@
  */
 
 #include "node_manager.h"
+#include "mesh_topology.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
 
 static const char *TAG = "NODE_MGR";
 
+// Counted in uint8_t by mesh_topology_stats_t and the fleet OTA plan
+_Static_assert(MAX_NODES <= 255, "MAX_NODES must fit in uint8_t");
+
 static node_info_t s_nodes[MAX_NODES];
 static int s_node_count = 0;
 
+// Announce handling (power-restore storms)
+static uint32_t s_announces = 0;
+static uint32_t s_digest_matches = 0;
+static uint32_t s_last_online_ms = 0;
+
 static int find_node_index(const uint8_t *mac)
 {
     for (int i = 0; i < s_node_count; i++) {
@@ -22,6 +31,18 @@ static int find_node_index(const uint8_t *mac)
     return -1;
 }
 
+static int find_oldest_offline(void)
+{
+    int oldest = -1;
+    for (int i = 0; i < s_node_count; i++) {
+        if (s_nodes[i].status != NODE_STATUS_ONLINE &&
+            (oldest < 0 || s_nodes[i].last_seen < s_nodes[oldest].last_seen)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
 esp_err_t node_manager_init(void)
 {
     ESP_LOGI(TAG, "Node manager initialized");
@@ -38,23 +59,39 @@ esp_err_t node_manager_add_node(const uint8_t *mac)
     if (idx >= 0) {
         // Node exists, update last_seen
         s_nodes[idx].last_seen = esp_timer_get_time() / 1000;
+        if (s_nodes[idx].status != NODE_STATUS_ONLINE) {
+            s_last_online_ms = s_nodes[idx].last_seen;
+        }
         s_nodes[idx].status = NODE_STATUS_ONLINE;
         return ESP_OK;
     }
 
-    if (s_node_count >= MAX_NODES) {
-        ESP_LOGE(TAG, "Max nodes reached!");
-        return ESP_ERR_NO_MEM;
+    node_info_t *node;
+    if (s_node_count < MAX_NODES) {
+        node = &s_nodes[s_node_count++];
+    } else {
+        // Full: the node offline the longest makes room (mesh churn, scans)
+        int oldest = find_oldest_offline();
+        if (oldest < 0) {
+            ESP_LOGE(TAG, "Max nodes reached!");
+            return ESP_ERR_NO_MEM;
+        }
+        node = &s_nodes[oldest];
+        ESP_LOGW(TAG, "Node table full, dropping offline %02X:%02X:%02X:%02X:%02X:%02X",
+                 node->mac[0], node->mac[1], node->mac[2], node->mac[3], node->mac[4], node->mac[5]);
+        mesh_topology_remove(node->mac);
     }
 
-    node_info_t *node = &s_nodes[s_node_count];
+    memset(node, 0, sizeof(*node));
     memcpy(node->mac, mac, 6);
     node->status = NODE_STATUS_ONLINE;
     node->last_seen = esp_timer_get_time() / 1000;
     node->device_type = DEVICE_TYPE_UNKNOWN;
     node->relay1 = -1;  // unknown
     node->relay2 = -1;  // unknown
-    s_node_count++;
+    node->boot_reported = false;
+    node->digest_valid = false;
+    s_last_online_ms = node->last_seen;
 
     ESP_LOGI(TAG, "Node added: %02X:%02X:%02X:%02X:%02X:%02X (total: %d)",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], s_node_count);
@@ -72,6 +109,7 @@ esp_err_t node_manager_remove_node(const uint8_t *mac)
         s_nodes[i] = s_nodes[i + 1];
     }
     s_node_count--;
+    mesh_topology_remove(mac);
 
     ESP_LOGI(TAG, "Node removed (total: %d)", s_node_count);
     return ESP_OK;
@@ -89,10 +127,11 @@ esp_err_t node_manager_set_offline(const uint8_t *mac)
 void node_manager_check_timeouts(void)
 {
     uint32_t now = esp_timer_get_time() / 1000;
-    uint32_t timeout = CONFIG_GATEWAY_NODE_TIMEOUT_MS;
 
     for (int i = 0; i < s_node_count; i++) {
         if (s_nodes[i].status == NODE_STATUS_ONLINE) {
+            // Lossy multi-hop paths get proportionally more slack
+            uint32_t timeout = mesh_topology_scale_timeout(s_nodes[i].mac, CONFIG_GATEWAY_NODE_TIMEOUT_MS);
             if ((now - s_nodes[i].last_seen) > timeout) {
                 ESP_LOGW(TAG, "Node timeout: %02X:%02X:%02X:%02X:%02X:%02X",
                          s_nodes[i].mac[0], s_nodes[i].mac[1], s_nodes[i].mac[2],
@@ -120,7 +159,8 @@ node_info_t* node_manager_get_all(int *count)
     return s_nodes;
 }
 
-esp_err_t node_manager_update_info(const uint8_t *mac, const payload_heartbeat_ack_t *info)
+esp_err_t node_manager_update_info(const uint8_t *mac, const payload_heartbeat_ack_t *info,
+                                   uint16_t payload_len)
 {
     if (mac == NULL || info == NULL) return ESP_ERR_INVALID_ARG;
 
@@ -143,19 +183,47 @@ esp_err_t node_manager_update_info(const uint8_t *mac, const payload_heartbeat_a
              (unsigned long)((info->firmware_version >> 8) & 0xFF),
              (unsigned long)(info->firmware_version & 0xFF));
 
+    // Older node firmware sends a shorter ACK without the boot report
+    node->boot_reported = HEARTBEAT_ACK_HAS_BOOT(payload_len);
+    if (node->boot_reported) {
+        node->rejoin_mode = info->rejoin_mode;
+        node->boot_connect_ms = info->boot_connect_ms;
+        node->boot_first_cmd_ms = info->boot_first_cmd_ms;
+    }
+
     return ESP_OK;
 }
 
-esp_err_t node_manager_update_from_announce(const uint8_t *mac, const payload_node_announce_t *announce)
+uint8_t node_manager_handle_announce(const uint8_t *mac, const payload_node_announce_t *announce,
+                                     uint16_t payload_len)
 {
-    if (mac == NULL || announce == NULL) return ESP_ERR_INVALID_ARG;
+    if (mac == NULL || announce == NULL) return 0;
 
+    uint8_t changes = 0;
     int idx = find_node_index(mac);
-    if (idx < 0) return ESP_ERR_NOT_FOUND;
+    if (idx < 0 || s_nodes[idx].status != NODE_STATUS_ONLINE) {
+        changes |= NODE_ANNOUNCE_ONLINE;
+    }
+    if (node_manager_add_node(mac) != ESP_OK) return 0;
+    idx = find_node_index(mac);
+    s_announces++;
 
     node_info_t *node = &s_nodes[idx];
+    bool has_digest = ANNOUNCE_HAS_DIGEST(payload_len);
+
+    // Node came back exactly as we last saw it: nothing to re-parse or re-publish
+    if (has_digest && node->digest_valid &&
+        node->device_type == announce->device_type &&
+        node->firmware_raw == announce->firmware_version &&
+        node->config_hash == announce->config_hash &&
+        node->state_mask == announce->state_mask) {
+        s_digest_matches++;
+        return changes;
+    }
+
     node->device_type = announce->device_type;
     node->commissioned = announce->commissioned ? true : false;
+    node->firmware_raw = announce->firmware_version;
 
     // Parse firmware version from packed uint32_t
     snprintf(node->firmware_version, sizeof(node->firmware_version),
@@ -163,12 +231,38 @@ esp_err_t node_manager_update_from_announce(const uint8_t *mac, const payload_no
              (unsigned long)((announce->firmware_version >> 16) & 0xFF),
              (unsigned long)((announce->firmware_version >> 8) & 0xFF),
              (unsigned long)(announce->firmware_version & 0xFF));
+    changes |= NODE_ANNOUNCE_INFO;
+
+    if (has_digest) {
+        if (!node->digest_valid || node->state_mask != announce->state_mask) {
+            changes |= NODE_ANNOUNCE_STATE;
+        }
+        node->digest_valid = true;
+        node->state_mask = announce->state_mask;
+        node->config_hash = announce->config_hash;
+
+        // Relay states come with the digest, no need to ask the node
+        if (announce->device_type == DEVICE_TYPE_RELAY) {
+            node->relay1 = (announce->state_mask & 0x01) ? 1 : 0;
+            node->relay2 = announce->capabilities >= 2 ? ((announce->state_mask & 0x02) ? 1 : 0) : -1;
+        }
+    } else {
+        node->digest_valid = false;
+    }
 
     ESP_LOGI(TAG, "Node updated from announce: %02X:%02X:%02X:%02X:%02X:%02X type=%d fw=%s commissioned=%d",
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
              node->device_type, node->firmware_version, node->commissioned);
 
-    return ESP_OK;
+    return changes;
+}
+
+void node_manager_get_announce_stats(uint32_t *announces, uint32_t *digest_matches,
+                                     uint32_t *last_online_ms)
+{
+    if (announces) *announces = s_announces;
+    if (digest_matches) *digest_matches = s_digest_matches;
+    if (last_online_ms) *last_online_ms = s_last_online_ms;
 }
 
 int node_manager_clear_all(void)
@@ -14,6 +14,12 @@
 extern "C" {
 #endif
 
+/*
+ * Nodes one gateway serves. The mesh is capped to match (mesh_network.c),
+ * and the node table, topology map and fleet OTA are sized from it. The
+ * gateway has no PSRAM, so a larger plant needs a second gateway. When the
+ * table is full the node offline the longest gives way to a new one.
+ */
 #define MAX_NODES 50
 
 typedef struct {
@@ -27,8 +33,21 @@ typedef struct {
     bool    commissioned;
     int8_t  relay1;    // -1=unknown, 0=off, 1=on
     int8_t  relay2;    // -1=unknown, 0=off, 1=on
+    bool    boot_reported;      // Node firmware sends the boot fields below
+    uint8_t rejoin_mode;        // REJOIN_SCAN / REJOIN_FAST / REJOIN_FAST_FAILED
+    uint32_t boot_connect_ms;   // Node boot to mesh parent connection
+    uint32_t boot_first_cmd_ms; // Node boot to first device command (0 = none yet)
+    bool    digest_valid;       // State digest below came with the last announce
+    uint8_t state_mask;         // Relay bitmask / LED on, kept current by status messages
+    uint32_t config_hash;       // Node runtime config hash
+    uint32_t firmware_raw;      // Packed firmware version (major<<16 | minor<<8 | patch)
 } node_info_t;
 
+// node_manager_handle_announce() result bits
+#define NODE_ANNOUNCE_ONLINE    0x01    // Node is new or was offline
+#define NODE_ANNOUNCE_INFO      0x02    // Type, firmware or config differ from last time
+#define NODE_ANNOUNCE_STATE     0x04    // Device state differs (or was unknown)
+
 esp_err_t node_manager_init(void);
 esp_err_t node_manager_add_node(const uint8_t *mac);
 esp_err_t node_manager_remove_node(const uint8_t *mac);
@@ -39,8 +58,28 @@ int node_manager_get_count(void);
 node_info_t* node_manager_get_node(const uint8_t *mac);
 node_info_t* node_manager_get_all(int *count);
 
-esp_err_t node_manager_update_info(const uint8_t *mac, const payload_heartbeat_ack_t *info);
-esp_err_t node_manager_update_from_announce(const uint8_t *mac, const payload_node_announce_t *announce);
+esp_err_t node_manager_update_info(const uint8_t *mac, const payload_heartbeat_ack_t *info,
+                                   uint16_t payload_len);
+
+/**
+ * Add or refresh a commissioned node from its announce. A node that is
+ * already online and announces the same state digest is left untouched.
+ * @param mac          Node MAC
+ * @param announce     Announce payload
+ * @param payload_len  Received payload length (older nodes send no digest)
+ * @return NODE_ANNOUNCE_* bits, 0 if nothing changed
+ */
+uint8_t node_manager_handle_announce(const uint8_t *mac, const payload_node_announce_t *announce,
+                                     uint16_t payload_len);
+
+/**
+ * Get announce counters
+ * @param announces       Announces handled (may be NULL)
+ * @param digest_matches  Of which skipped on a matching digest (may be NULL)
+ * @param last_online_ms  Gateway uptime when a node last came online (may be NULL)
+ */
+void node_manager_get_announce_stats(uint32_t *announces, uint32_t *digest_matches,
+                                     uint32_t *last_online_ms);
 
 /**
  * Clear all nodes from memory (factory reset)
@@ -3,12 +3,15 @@
  *
  * Handles push-mode OTA updates to mesh nodes
  * Gateway uploads firmware via web UI, then pushes chunks to target node
+ * Up to NODE_OTA_MAX_SESSIONS nodes can receive the staged image in parallel
  */
 
 #include "node_ota.h"
 #include "mesh_network.h"
+#include "mesh_topology.h"
 #include "mqtt_handler.h"
 #include "webserver.h"
+#include "nvs_storage.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_timer.h"
@@ -18,10 +21,13 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "mbedtls/sha256.h"
 #include <string.h>
 
 static const char *TAG = "NODE_OTA";
 
+#define NVS_KEY_OTA_JOB     "node_ota_job"
+
 // ============================================================================
 // Internal State
 // ============================================================================
@@ -32,44 +38,106 @@ typedef struct {
     uint8_t *firmware_data;      // For buffered mode
     size_t firmware_size;
     uint32_t firmware_crc;
+    uint8_t image_id[OTA_IMAGE_ID_LEN];  // Resume key sent in OTA_BEGIN (zero = not resumable)
     uint16_t total_chunks;
     uint16_t current_chunk;
+    uint16_t resume_chunk;       // First chunk the node still needed at READY
     uint8_t retry_count;
+    uint32_t chunk_retries;      // Chunk resends over the whole transfer
     int64_t last_activity;
-    SemaphoreHandle_t mutex;
+    int64_t start_time;
     // Streaming mode
     bool streaming_mode;
     bool node_ready;             // Node has ACKed OTA_BEGIN
     bool chunk_acked;            // Current chunk ACKed
     size_t bytes_written;        // Bytes written so far (for CRC calc)
     uint32_t running_crc;        // Running CRC calculation
+    // Flash-based mode
+    TaskHandle_t task;           // Background sender task (NULL in RAM/streaming mode)
+    bool persist_job;            // Keep job in NVS so a gateway reboot resumes it
+    bool resume_after_boot;      // Job restored from NVS, staging not yet re-verified
+    bool held;                   // Result owned by caller until node_ota_release_session()
 } node_ota_ctx_t;
 
-static node_ota_ctx_t s_ota_ctx = {
-    .state = NODE_OTA_STATE_IDLE,
-    .firmware_data = NULL,
-    .firmware_size = 0,
-    .current_chunk = 0,
-    .retry_count = 0,
-    .mutex = NULL,
-    .streaming_mode = false,
-    .node_ready = false,
-    .chunk_acked = false
-};
+static node_ota_ctx_t s_sessions[NODE_OTA_MAX_SESSIONS];
+static node_ota_ctx_t *s_primary = &s_sessions[0];  // Session driven by the single-target API
+static SemaphoreHandle_t s_mutex = NULL;
 
 // ============================================================================
 // Forward Declarations
 // ============================================================================
 
-static esp_err_t send_ota_begin(void);
-static esp_err_t send_ota_chunk(uint16_t chunk_index);
-static esp_err_t send_ota_end(void);
-static esp_err_t send_ota_abort_msg(void);
-static void cleanup_ota(void);
-static void report_ota_status(const char *status, int progress);
+static esp_err_t send_ota_begin(node_ota_ctx_t *ctx);
+static esp_err_t send_ota_chunk(node_ota_ctx_t *ctx, uint16_t chunk_index);
+static esp_err_t send_ota_end(node_ota_ctx_t *ctx);
+static esp_err_t send_ota_abort_msg(node_ota_ctx_t *ctx);
+static void cleanup_ota(node_ota_ctx_t *ctx);
+static void report_ota_status(node_ota_ctx_t *ctx, const char *status, int progress);
+static void compute_image_id(const uint8_t digest[32], uint8_t *image_id);
+static void resume_pending_job(void);
+
+// ============================================================================
+// Session Table
+// ============================================================================
+
+static bool session_busy(const node_ota_ctx_t *ctx)
+{
+    return ctx->state == NODE_OTA_STATE_STARTING ||
+           ctx->state == NODE_OTA_STATE_SENDING ||
+           ctx->state == NODE_OTA_STATE_FINISHING ||
+           ctx->task != NULL;
+}
+
+// Session currently talking to this node (or the primary one, for late messages)
+static node_ota_ctx_t *find_session(const uint8_t *mac)
+{
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        if (session_busy(&s_sessions[i]) && memcmp(s_sessions[i].target_mac, mac, 6) == 0) {
+            return &s_sessions[i];
+        }
+    }
+    if (memcmp(s_primary->target_mac, mac, 6) == 0) {
+        return s_primary;
+    }
+    return NULL;
+}
 
-// Flash-based OTA task handle (declared here for use in node_ota_handle_ack)
-static TaskHandle_t s_ota_task_handle = NULL;
+// Claim a free slot for a new transfer; caller holds s_mutex
+static node_ota_ctx_t *session_alloc(const uint8_t *mac)
+{
+    node_ota_ctx_t *free_slot = NULL;
+
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        node_ota_ctx_t *ctx = &s_sessions[i];
+        if (session_busy(ctx)) {
+            if (memcmp(ctx->target_mac, mac, 6) == 0) {
+                return NULL;  // Node already updating
+            }
+            continue;
+        }
+        if (ctx->held) {
+            continue;
+        }
+        // Prefer the slot that last served this node so its status stays in one place
+        if (free_slot == NULL || memcmp(ctx->target_mac, mac, 6) == 0) {
+            free_slot = ctx;
+        }
+    }
+
+    if (free_slot != NULL) {
+        cleanup_ota(free_slot);
+        free_slot->state = NODE_OTA_STATE_IDLE;
+        free_slot->persist_job = false;
+        free_slot->resume_after_boot = false;
+        free_slot->held = false;
+        free_slot->resume_chunk = 0;
+        free_slot->chunk_retries = 0;
+        memcpy(free_slot->target_mac, mac, 6);
+        free_slot->start_time = esp_timer_get_time() / 1000;
+        free_slot->last_activity = free_slot->start_time;
+    }
+    return free_slot;
+}
 
 // ============================================================================
 // Public Functions
@@ -77,19 +145,21 @@ static TaskHandle_t s_ota_task_handle = NULL;
 
 esp_err_t node_ota_init(void)
 {
-    if (s_ota_ctx.mutex == NULL) {
-        s_ota_ctx.mutex = xSemaphoreCreateMutex();
-        if (s_ota_ctx.mutex == NULL) {
+    if (s_mutex == NULL) {
+        s_mutex = xSemaphoreCreateMutex();
+        if (s_mutex == NULL) {
             ESP_LOGE(TAG, "Failed to create mutex");
             return ESP_ERR_NO_MEM;
         }
     }
 
-    s_ota_ctx.state = NODE_OTA_STATE_IDLE;
-    s_ota_ctx.firmware_data = NULL;
-    s_ota_ctx.firmware_size = 0;
+    memset(s_sessions, 0, sizeof(s_sessions));
+    s_primary = &s_sessions[0];
+
+    ESP_LOGI(TAG, "Node OTA manager initialized (%d sessions)", NODE_OTA_MAX_SESSIONS);
 
-    ESP_LOGI(TAG, "Node OTA manager initialized");
+    // Pick up a transfer interrupted by a gateway reboot
+    resume_pending_job();
     return ESP_OK;
 }
 
@@ -100,56 +170,66 @@ esp_err_t node_ota_start(const uint8_t *target_mac, const uint8_t *firmware, siz
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take mutex");
         return ESP_ERR_TIMEOUT;
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_IDLE) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    if (session_busy(s_primary)) {
+        xSemaphoreGive(s_mutex);
         ESP_LOGE(TAG, "OTA already in progress");
         return ESP_ERR_INVALID_STATE;
     }
 
+    node_ota_ctx_t *ctx = session_alloc(target_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "No free OTA session");
+        return ESP_ERR_INVALID_STATE;
+    }
+
     // Allocate memory for firmware
-    s_ota_ctx.firmware_data = malloc(size);
-    if (s_ota_ctx.firmware_data == NULL) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    ctx->firmware_data = malloc(size);
+    if (ctx->firmware_data == NULL) {
+        xSemaphoreGive(s_mutex);
         ESP_LOGE(TAG, "Failed to allocate firmware buffer (%u bytes)", (unsigned)size);
         return ESP_ERR_NO_MEM;
     }
 
     // Copy firmware data
-    memcpy(s_ota_ctx.firmware_data, firmware, size);
-    s_ota_ctx.firmware_size = size;
-    memcpy(s_ota_ctx.target_mac, target_mac, 6);
+    memcpy(ctx->firmware_data, firmware, size);
+    ctx->firmware_size = size;
 
-    // Calculate CRC32
-    s_ota_ctx.firmware_crc = esp_crc32_le(0, firmware, size);
+    // Calculate CRC32 and resume key
+    ctx->firmware_crc = esp_crc32_le(0, firmware, size);
+    uint8_t digest[32];
+    mbedtls_sha256(firmware, size, digest, 0);
+    compute_image_id(digest, ctx->image_id);
 
     // Calculate total chunks
-    s_ota_ctx.total_chunks = (size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
-    s_ota_ctx.current_chunk = 0;
-    s_ota_ctx.retry_count = 0;
-    s_ota_ctx.last_activity = esp_timer_get_time() / 1000;
+    ctx->total_chunks = (size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
+    ctx->current_chunk = 0;
+    ctx->retry_count = 0;
 
     ESP_LOGI(TAG, "Starting OTA to node " MACSTR ", size=%u, chunks=%u, crc=0x%08lx",
-             MAC2STR(target_mac), (unsigned)size, s_ota_ctx.total_chunks,
-             (unsigned long)s_ota_ctx.firmware_crc);
+             MAC2STR(target_mac), (unsigned)size, ctx->total_chunks,
+             (unsigned long)ctx->firmware_crc);
 
     // Send OTA_BEGIN
-    s_ota_ctx.state = NODE_OTA_STATE_STARTING;
-    esp_err_t ret = send_ota_begin();
+    s_primary = ctx;
+    ctx->state = NODE_OTA_STATE_STARTING;
+    esp_err_t ret = send_ota_begin(ctx);
 
     if (ret != ESP_OK) {
-        cleanup_ota();
-        xSemaphoreGive(s_ota_ctx.mutex);
+        cleanup_ota(ctx);
+        ctx->state = NODE_OTA_STATE_IDLE;
+        xSemaphoreGive(s_mutex);
         return ret;
     }
 
-    report_ota_status("starting", 0);
+    report_ota_status(ctx, "starting", 0);
 
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
     return ESP_OK;
 }
 
@@ -159,69 +239,90 @@ void node_ota_handle_ack(const uint8_t *src_mac, const payload_ota_ack_t *ack)
         return;
     }
 
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
         return;
     }
 
-    // Verify it's from our target node
-    if (memcmp(src_mac, s_ota_ctx.target_mac, 6) != 0) {
+    // Route to the session for this node
+    node_ota_ctx_t *ctx = find_session(src_mac);
+    if (ctx == NULL) {
         ESP_LOGW(TAG, "ACK from unexpected node " MACSTR, MAC2STR(src_mac));
-        xSemaphoreGive(s_ota_ctx.mutex);
+        xSemaphoreGive(s_mutex);
         return;
     }
 
-    s_ota_ctx.last_activity = esp_timer_get_time() / 1000;
-    s_ota_ctx.retry_count = 0;
+    ctx->last_activity = esp_timer_get_time() / 1000;
+    ctx->retry_count = 0;
 
-    ESP_LOGD(TAG, "Received ACK: chunk=%u, status=%u", ack->chunk_index, ack->status);
+    ESP_LOGD(TAG, "Received ACK from " MACSTR ": chunk=%u, status=%u",
+             MAC2STR(src_mac), ack->chunk_index, ack->status);
 
     switch (ack->status) {
         case OTA_ACK_READY:
-            // Node is ready, start sending chunks
-            if (s_ota_ctx.state == NODE_OTA_STATE_STARTING) {
-                ESP_LOGI(TAG, "Node ready, starting chunk transfer");
-                s_ota_ctx.state = NODE_OTA_STATE_SENDING;
-                s_ota_ctx.current_chunk = 0;
-                s_ota_ctx.node_ready = true;
-
-                if (!s_ota_ctx.streaming_mode && s_ota_task_handle == NULL) {
+            // Node is ready, start sending chunks from the first one it still needs
+            if (ctx->state == NODE_OTA_STATE_STARTING) {
+                uint16_t resume_chunk = 0;
+                if (!ctx->streaming_mode && ack->chunk_index <= ctx->total_chunks) {
+                    resume_chunk = ack->chunk_index;
+                }
+                if (resume_chunk > 0) {
+                    ESP_LOGI(TAG, "Node ready, resuming at chunk %u/%u",
+                             resume_chunk, ctx->total_chunks);
+                } else {
+                    ESP_LOGI(TAG, "Node ready, starting chunk transfer");
+                }
+                ctx->state = NODE_OTA_STATE_SENDING;
+                ctx->current_chunk = resume_chunk;
+                ctx->resume_chunk = resume_chunk;
+                ctx->node_ready = true;
+
+                int progress = (resume_chunk * 100) / ctx->total_chunks;
+                if (!ctx->streaming_mode && ctx->task == NULL) {
                     // Buffered RAM mode only: send first chunk automatically
-                    // Flash-based mode (s_ota_task_handle != NULL) handles chunks in background task
-                    send_ota_chunk(0);
+                    // Flash-based mode (ctx->task != NULL) handles chunks in background task
+                    if (resume_chunk >= ctx->total_chunks) {
+                        ctx->state = NODE_OTA_STATE_FINISHING;
+                        send_ota_end(ctx);
+                        report_ota_status(ctx, "finalizing", 100);
+                        break;
+                    }
+                    send_ota_chunk(ctx, resume_chunk);
                 }
-                report_ota_status("sending", 0);
+                report_ota_status(ctx, "sending", progress);
             }
             break;
 
         case OTA_ACK_OK:
             // Chunk received successfully
-            if (s_ota_ctx.state == NODE_OTA_STATE_SENDING) {
-                s_ota_ctx.current_chunk = ack->chunk_index + 1;
-                s_ota_ctx.chunk_acked = true;
-                int progress = (s_ota_ctx.current_chunk * 100) / s_ota_ctx.total_chunks;
+            if (ctx->state == NODE_OTA_STATE_SENDING) {
+                ctx->current_chunk = ack->chunk_index + 1;
+                ctx->chunk_acked = true;
+                int progress = (ctx->current_chunk * 100) / ctx->total_chunks;
 
-                if (s_ota_ctx.streaming_mode || s_ota_task_handle != NULL) {
+                if (ctx->streaming_mode || ctx->task != NULL) {
                     // Streaming mode or flash-based mode: just signal ACK
-                    // Caller/background task handles next chunk
-                    if (s_ota_ctx.current_chunk % 10 == 0) {
-                        ESP_LOGI(TAG, "Progress: %d/%d chunks (%d%%)",
-                                 s_ota_ctx.current_chunk, s_ota_ctx.total_chunks, progress);
+                    // Caller/background task handles next chunk (and its own progress reports)
+                    if (ctx->streaming_mode) {
+                        if (ctx->current_chunk % 10 == 0) {
+                            ESP_LOGI(TAG, "Progress: %d/%d chunks (%d%%)",
+                                     ctx->current_chunk, ctx->total_chunks, progress);
+                        }
+                        report_ota_status(ctx, "sending", progress);
                     }
-                    report_ota_status("sending", progress);
                 } else {
                     // Buffered RAM mode: send next chunk or finish
-                    if (s_ota_ctx.current_chunk >= s_ota_ctx.total_chunks) {
+                    if (ctx->current_chunk >= ctx->total_chunks) {
                         ESP_LOGI(TAG, "All chunks sent, finalizing...");
-                        s_ota_ctx.state = NODE_OTA_STATE_FINISHING;
-                        send_ota_end();
-                        report_ota_status("finalizing", 100);
+                        ctx->state = NODE_OTA_STATE_FINISHING;
+                        send_ota_end(ctx);
+                        report_ota_status(ctx, "finalizing", 100);
                     } else {
-                        if (s_ota_ctx.current_chunk % 10 == 0) {
+                        if (ctx->current_chunk % 10 == 0) {
                             ESP_LOGI(TAG, "Progress: %d/%d chunks (%d%%)",
-                                     s_ota_ctx.current_chunk, s_ota_ctx.total_chunks, progress);
+                                     ctx->current_chunk, ctx->total_chunks, progress);
                         }
-                        send_ota_chunk(s_ota_ctx.current_chunk);
-                        report_ota_status("sending", progress);
+                        send_ota_chunk(ctx, ctx->current_chunk);
+                        report_ota_status(ctx, "sending", progress);
                     }
                 }
             }
@@ -230,17 +331,18 @@ void node_ota_handle_ack(const uint8_t *src_mac, const payload_ota_ack_t *ack)
         case OTA_ACK_CRC_ERROR:
             // CRC error, retry chunk
             ESP_LOGW(TAG, "CRC error on chunk %u, retrying", ack->chunk_index);
-            s_ota_ctx.retry_count++;
-            if (s_ota_ctx.retry_count >= NODE_OTA_MAX_RETRIES) {
+            ctx->retry_count++;
+            ctx->chunk_retries++;
+            if (ctx->retry_count >= NODE_OTA_MAX_RETRIES) {
                 ESP_LOGE(TAG, "Max retries exceeded");
-                s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-                send_ota_abort_msg();
-                report_ota_status("failed", -1);
-                cleanup_ota();
-            } else if (s_ota_task_handle == NULL && !s_ota_ctx.streaming_mode) {
+                ctx->state = NODE_OTA_STATE_FAILED;
+                send_ota_abort_msg(ctx);
+                report_ota_status(ctx, "failed", -1);
+                cleanup_ota(ctx);
+            } else if (ctx->task == NULL && !ctx->streaming_mode) {
                 // Buffered RAM mode only: retry chunk directly
                 // Flash-based mode handles retries in background task (timeout will trigger retry)
-                send_ota_chunk(ack->chunk_index);
+                send_ota_chunk(ctx, ack->chunk_index);
             }
             break;
 
@@ -248,9 +350,9 @@ void node_ota_handle_ack(const uint8_t *src_mac, const payload_ota_ack_t *ack)
         case OTA_ACK_ABORT:
             // Fatal error
             ESP_LOGE(TAG, "Node reported error: %u", ack->status);
-            s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-            report_ota_status("failed", -1);
-            cleanup_ota();
+            ctx->state = NODE_OTA_STATE_FAILED;
+            report_ota_status(ctx, "failed", -1);
+            cleanup_ota(ctx);
             break;
 
         default:
@@ -258,7 +360,7 @@ void node_ota_handle_ack(const uint8_t *src_mac, const payload_ota_ack_t *ack)
             break;
     }
 
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
 }
 
 void node_ota_handle_complete(const uint8_t *src_mac, const payload_ota_complete_t *complete)
@@ -267,12 +369,13 @@ void node_ota_handle_complete(const uint8_t *src_mac, const payload_ota_complete
         return;
     }
 
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
         return;
     }
 
-    if (memcmp(src_mac, s_ota_ctx.target_mac, 6) != 0) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    node_ota_ctx_t *ctx = find_session(src_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
         return;
     }
 
@@ -282,11 +385,11 @@ void node_ota_handle_complete(const uint8_t *src_mac, const payload_ota_complete
              (unsigned long)(complete->new_version >> 8) & 0xFF,
              (unsigned long)complete->new_version & 0xFF);
 
-    s_ota_ctx.state = NODE_OTA_STATE_COMPLETE;
-    report_ota_status("complete", 100);
-    cleanup_ota();
+    ctx->state = NODE_OTA_STATE_COMPLETE;
+    report_ota_status(ctx, "complete", 100);
+    cleanup_ota(ctx);
 
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
 }
 
 void node_ota_handle_failed(const uint8_t *src_mac, const payload_ota_failed_t *failed)
@@ -295,89 +398,102 @@ void node_ota_handle_failed(const uint8_t *src_mac, const payload_ota_failed_t *
         return;
     }
 
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
         return;
     }
 
-    if (memcmp(src_mac, s_ota_ctx.target_mac, 6) != 0) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    node_ota_ctx_t *ctx = find_session(src_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
         return;
     }
 
     ESP_LOGE(TAG, "Node " MACSTR " reported OTA failed: code=%u, msg=%.*s",
              MAC2STR(src_mac), failed->error_code, 32, failed->error_msg);
 
-    s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-    report_ota_status("failed", -1);
-    cleanup_ota();
+    ctx->state = NODE_OTA_STATE_FAILED;
+    report_ota_status(ctx, "failed", -1);
+    cleanup_ota(ctx);
 
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
+}
+
+static void abort_session(node_ota_ctx_t *ctx)
+{
+    ESP_LOGI(TAG, "Aborting OTA to node " MACSTR, MAC2STR(ctx->target_mac));
+
+    send_ota_abort_msg(ctx);
+    ctx->state = NODE_OTA_STATE_ABORTED;
+    report_ota_status(ctx, "aborted", -1);
+    cleanup_ota(ctx);
 }
 
 esp_err_t node_ota_abort(void)
 {
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
 
-    if (s_ota_ctx.state == NODE_OTA_STATE_IDLE) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    if (s_primary->state == NODE_OTA_STATE_IDLE) {
+        xSemaphoreGive(s_mutex);
         return ESP_OK;
     }
 
-    ESP_LOGI(TAG, "Aborting OTA to node " MACSTR, MAC2STR(s_ota_ctx.target_mac));
+    abort_session(s_primary);
 
-    send_ota_abort_msg();
-    s_ota_ctx.state = NODE_OTA_STATE_ABORTED;
-    report_ota_status("aborted", -1);
-    cleanup_ota();
-
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
     return ESP_OK;
 }
 
 void node_ota_check_timeout(void)
 {
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return;
-    }
-
-    if (s_ota_ctx.state == NODE_OTA_STATE_IDLE ||
-        s_ota_ctx.state == NODE_OTA_STATE_COMPLETE ||
-        s_ota_ctx.state == NODE_OTA_STATE_FAILED ||
-        s_ota_ctx.state == NODE_OTA_STATE_ABORTED) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
         return;
     }
 
     int64_t now = esp_timer_get_time() / 1000;
-    int64_t elapsed = now - s_ota_ctx.last_activity;
 
-    if (elapsed > NODE_OTA_TIMEOUT_MS) {
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        node_ota_ctx_t *ctx = &s_sessions[i];
+
+        // Flash-based sessions handle their own timeouts in the background task
+        if (ctx->task != NULL ||
+            ctx->state == NODE_OTA_STATE_IDLE ||
+            ctx->state == NODE_OTA_STATE_COMPLETE ||
+            ctx->state == NODE_OTA_STATE_FAILED ||
+            ctx->state == NODE_OTA_STATE_ABORTED) {
+            continue;
+        }
+
+        int64_t elapsed = now - ctx->last_activity;
+        if (elapsed <= NODE_OTA_TIMEOUT_MS) {
+            continue;
+        }
+
         ESP_LOGE(TAG, "OTA timeout after %lld ms", elapsed);
 
-        s_ota_ctx.retry_count++;
-        if (s_ota_ctx.retry_count >= NODE_OTA_MAX_RETRIES) {
+        ctx->retry_count++;
+        if (ctx->retry_count >= NODE_OTA_MAX_RETRIES) {
             ESP_LOGE(TAG, "Max retries exceeded, aborting");
-            s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-            send_ota_abort_msg();
-            report_ota_status("timeout", -1);
-            cleanup_ota();
+            ctx->state = NODE_OTA_STATE_FAILED;
+            send_ota_abort_msg(ctx);
+            report_ota_status(ctx, "timeout", -1);
+            cleanup_ota(ctx);
         } else {
             // Retry current operation
-            s_ota_ctx.last_activity = now;
-            switch (s_ota_ctx.state) {
+            ctx->last_activity = now;
+            switch (ctx->state) {
                 case NODE_OTA_STATE_STARTING:
                     ESP_LOGI(TAG, "Retrying OTA_BEGIN");
-                    send_ota_begin();
+                    send_ota_begin(ctx);
                     break;
                 case NODE_OTA_STATE_SENDING:
-                    ESP_LOGI(TAG, "Retrying chunk %u", s_ota_ctx.current_chunk);
-                    send_ota_chunk(s_ota_ctx.current_chunk);
+                    ESP_LOGI(TAG, "Retrying chunk %u", ctx->current_chunk);
+                    send_ota_chunk(ctx, ctx->current_chunk);
                     break;
                 case NODE_OTA_STATE_FINISHING:
                     ESP_LOGI(TAG, "Retrying OTA_END");
-                    send_ota_end();
+                    send_ota_end(ctx);
                     break;
                 default:
                     break;
@@ -385,31 +501,31 @@ void node_ota_check_timeout(void)
         }
     }
 
-    xSemaphoreGive(s_ota_ctx.mutex);
+    xSemaphoreGive(s_mutex);
 }
 
 node_ota_state_t node_ota_get_state(void)
 {
-    return s_ota_ctx.state;
+    return s_primary->state;
 }
 
 int node_ota_get_progress(void)
 {
-    if (s_ota_ctx.state == NODE_OTA_STATE_IDLE) {
+    if (s_primary->state == NODE_OTA_STATE_IDLE) {
         return 0;
     }
-    if (s_ota_ctx.state == NODE_OTA_STATE_COMPLETE) {
+    if (s_primary->state == NODE_OTA_STATE_COMPLETE) {
         return 100;
     }
-    if (s_ota_ctx.total_chunks == 0) {
+    if (s_primary->total_chunks == 0) {
         return 0;
     }
-    return (s_ota_ctx.current_chunk * 100) / s_ota_ctx.total_chunks;
+    return (s_primary->current_chunk * 100) / s_primary->total_chunks;
 }
 
 bool node_ota_is_active(void)
 {
-    node_ota_state_t state = s_ota_ctx.state;
+    node_ota_state_t state = s_primary->state;
     return (state == NODE_OTA_STATE_STARTING ||
             state == NODE_OTA_STATE_SENDING ||
             state == NODE_OTA_STATE_FINISHING);
@@ -425,10 +541,46 @@ esp_err_t node_ota_get_target_mac(uint8_t *mac)
         return ESP_ERR_INVALID_STATE;
     }
 
-    memcpy(mac, s_ota_ctx.target_mac, 6);
+    memcpy(mac, s_primary->target_mac, 6);
     return ESP_OK;
 }
 
+int node_ota_active_sessions(void)
+{
+    int count = 0;
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        if (session_busy(&s_sessions[i])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+esp_err_t node_ota_get_session_info(const uint8_t *mac, node_ota_session_info_t *info)
+{
+    if (mac == NULL || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        const node_ota_ctx_t *ctx = &s_sessions[i];
+        if (memcmp(ctx->target_mac, mac, 6) != 0 ||
+            (ctx->state == NODE_OTA_STATE_IDLE && ctx->task == NULL)) {
+            continue;
+        }
+        info->state = ctx->state;
+        info->total_chunks = ctx->total_chunks;
+        info->current_chunk = (ctx->state == NODE_OTA_STATE_COMPLETE) ? ctx->total_chunks
+                                                                      : ctx->current_chunk;
+        info->resume_chunk = ctx->resume_chunk;
+        info->chunk_retries = ctx->chunk_retries;
+        info->start_time_ms = ctx->start_time;
+        info->running = session_busy(ctx);
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
 // ============================================================================
 // Streaming Mode Functions
 // ============================================================================
@@ -440,56 +592,58 @@ esp_err_t node_ota_start_stream(const uint8_t *target_mac, size_t total_size)
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take mutex");
         return ESP_ERR_TIMEOUT;
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_IDLE) {
-        xSemaphoreGive(s_ota_ctx.mutex);
+    node_ota_ctx_t *ctx = session_busy(s_primary) ? NULL : session_alloc(target_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
         ESP_LOGE(TAG, "OTA already in progress");
         return ESP_ERR_INVALID_STATE;
     }
 
     // Initialize streaming mode
-    s_ota_ctx.streaming_mode = true;
-    s_ota_ctx.firmware_data = NULL;  // No buffer in streaming mode
-    s_ota_ctx.firmware_size = total_size;
-    memcpy(s_ota_ctx.target_mac, target_mac, 6);
-
-    // We'll calculate CRC as we stream
-    s_ota_ctx.running_crc = 0;
-    s_ota_ctx.bytes_written = 0;
-    s_ota_ctx.firmware_crc = 0;  // Will be set after all data received
-
-    s_ota_ctx.total_chunks = (total_size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
-    s_ota_ctx.current_chunk = 0;
-    s_ota_ctx.retry_count = 0;
-    s_ota_ctx.node_ready = false;
-    s_ota_ctx.chunk_acked = false;
-    s_ota_ctx.last_activity = esp_timer_get_time() / 1000;
+    ctx->streaming_mode = true;
+    ctx->firmware_data = NULL;  // No buffer in streaming mode
+    ctx->firmware_size = total_size;
+
+    // We'll calculate CRC as we stream; the image hash is unknown up front, so not resumable
+    memset(ctx->image_id, 0, sizeof(ctx->image_id));
+    ctx->running_crc = 0;
+    ctx->bytes_written = 0;
+    ctx->firmware_crc = 0;  // Will be set after all data received
+
+    ctx->total_chunks = (total_size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
+    ctx->current_chunk = 0;
+    ctx->retry_count = 0;
+    ctx->node_ready = false;
+    ctx->chunk_acked = false;
 
     ESP_LOGI(TAG, "Starting STREAMING OTA to " MACSTR ", size=%u, chunks=%u",
-             MAC2STR(target_mac), (unsigned)total_size, s_ota_ctx.total_chunks);
+             MAC2STR(target_mac), (unsigned)total_size, ctx->total_chunks);
 
     // Send OTA_BEGIN (with CRC=0, node will ignore CRC check in streaming mode)
-    s_ota_ctx.state = NODE_OTA_STATE_STARTING;
-    esp_err_t ret = send_ota_begin();
+    s_primary = ctx;
+    ctx->state = NODE_OTA_STATE_STARTING;
+    esp_err_t ret = send_ota_begin(ctx);
 
     if (ret != ESP_OK) {
-        s_ota_ctx.state = NODE_OTA_STATE_IDLE;
-        s_ota_ctx.streaming_mode = false;
-        xSemaphoreGive(s_ota_ctx.mutex);
+        ctx->state = NODE_OTA_STATE_IDLE;
+        ctx->streaming_mode = false;
+        xSemaphoreGive(s_mutex);
         return ret;
     }
 
-    report_ota_status("starting", 0);
-    xSemaphoreGive(s_ota_ctx.mutex);
+    report_ota_status(ctx, "starting", 0);
+    xSemaphoreGive(s_mutex);
     return ESP_OK;
 }
 
 esp_err_t node_ota_wait_ack(uint32_t timeout_ms)
 {
+    node_ota_ctx_t *ctx = s_primary;
     int64_t start = esp_timer_get_time() / 1000;
 
     while (1) {
@@ -500,18 +654,18 @@ esp_err_t node_ota_wait_ack(uint32_t timeout_ms)
         }
 
         // Check if we got ACK
-        if (s_ota_ctx.state == NODE_OTA_STATE_SENDING && s_ota_ctx.node_ready) {
+        if (ctx->state == NODE_OTA_STATE_SENDING && ctx->node_ready) {
             // Node is ready after OTA_BEGIN
             return ESP_OK;
         }
 
-        if (s_ota_ctx.chunk_acked) {
-            s_ota_ctx.chunk_acked = false;
+        if (ctx->chunk_acked) {
+            ctx->chunk_acked = false;
             return ESP_OK;
         }
 
-        if (s_ota_ctx.state == NODE_OTA_STATE_FAILED ||
-            s_ota_ctx.state == NODE_OTA_STATE_ABORTED) {
+        if (ctx->state == NODE_OTA_STATE_FAILED ||
+            ctx->state == NODE_OTA_STATE_ABORTED) {
             return ESP_FAIL;
         }
 
@@ -521,34 +675,36 @@ esp_err_t node_ota_wait_ack(uint32_t timeout_ms)
 
 bool node_ota_node_ready(void)
 {
-    return s_ota_ctx.node_ready && s_ota_ctx.state == NODE_OTA_STATE_SENDING;
+    return s_primary->node_ready && s_primary->state == NODE_OTA_STATE_SENDING;
 }
 
 esp_err_t node_ota_write_chunk(const uint8_t *data, size_t len, bool is_last)
 {
+    node_ota_ctx_t *ctx = s_primary;
+
     if (data == NULL || len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (!s_ota_ctx.streaming_mode) {
+    if (!ctx->streaming_mode) {
         ESP_LOGE(TAG, "Not in streaming mode");
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_SENDING) {
-        ESP_LOGE(TAG, "Invalid state for write: %d", s_ota_ctx.state);
+    if (ctx->state != NODE_OTA_STATE_SENDING) {
+        ESP_LOGE(TAG, "Invalid state for write: %d", ctx->state);
         return ESP_ERR_INVALID_STATE;
     }
 
     // Update running CRC
-    s_ota_ctx.running_crc = esp_crc32_le(s_ota_ctx.running_crc, data, len);
-    s_ota_ctx.bytes_written += len;
+    ctx->running_crc = esp_crc32_le(ctx->running_crc, data, len);
+    ctx->bytes_written += len;
 
     // Build and send chunk message
     omniapi_message_t msg;
-    size_t offset = (size_t)s_ota_ctx.current_chunk * NODE_OTA_CHUNK_SIZE;
+    size_t offset = (size_t)ctx->current_chunk * NODE_OTA_CHUNK_SIZE;
 
-    OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_DATA, s_ota_ctx.current_chunk & 0xFF,
+    OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_DATA, ctx->current_chunk & 0xFF,
                         sizeof(payload_ota_data_t) - OTA_CHUNK_SIZE + len);
 
     payload_ota_data_t *payload = (payload_ota_data_t *)msg.payload;
@@ -558,12 +714,12 @@ esp_err_t node_ota_write_chunk(const uint8_t *data, size_t len, bool is_last)
     memcpy(payload->data, data, len);
 
     ESP_LOGD(TAG, "Streaming chunk %u: offset=%u, len=%u, last=%d",
-             s_ota_ctx.current_chunk, (unsigned)offset, (unsigned)len, is_last);
+             ctx->current_chunk, (unsigned)offset, (unsigned)len, is_last);
 
-    s_ota_ctx.chunk_acked = false;
-    s_ota_ctx.last_activity = esp_timer_get_time() / 1000;
+    ctx->chunk_acked = false;
+    ctx->last_activity = esp_timer_get_time() / 1000;
 
-    esp_err_t ret = mesh_network_send(s_ota_ctx.target_mac, (uint8_t *)&msg,
+    esp_err_t ret = mesh_network_send(ctx->target_mac, (uint8_t *)&msg,
                                        OMNIAPI_MSG_SIZE(sizeof(payload_ota_data_t) - OTA_CHUNK_SIZE + len));
 
     if (ret != ESP_OK) {
@@ -573,8 +729,8 @@ esp_err_t node_ota_write_chunk(const uint8_t *data, size_t len, bool is_last)
 
     // If last chunk, set final CRC
     if (is_last) {
-        s_ota_ctx.firmware_crc = s_ota_ctx.running_crc;
-        ESP_LOGI(TAG, "All chunks streamed, final CRC=0x%08lx", (unsigned long)s_ota_ctx.firmware_crc);
+        ctx->firmware_crc = ctx->running_crc;
+        ESP_LOGI(TAG, "All chunks streamed, final CRC=0x%08lx", (unsigned long)ctx->firmware_crc);
     }
 
     return ESP_OK;
@@ -582,24 +738,26 @@ esp_err_t node_ota_write_chunk(const uint8_t *data, size_t len, bool is_last)
 
 esp_err_t node_ota_finish_stream(void)
 {
-    if (!s_ota_ctx.streaming_mode) {
+    node_ota_ctx_t *ctx = s_primary;
+
+    if (!ctx->streaming_mode) {
         ESP_LOGE(TAG, "Not in streaming mode");
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_SENDING) {
-        ESP_LOGE(TAG, "Invalid state for finish: %d", s_ota_ctx.state);
+    if (ctx->state != NODE_OTA_STATE_SENDING) {
+        ESP_LOGE(TAG, "Invalid state for finish: %d", ctx->state);
         return ESP_ERR_INVALID_STATE;
     }
 
     ESP_LOGI(TAG, "Finishing streaming OTA, total bytes=%u, CRC=0x%08lx",
-             (unsigned)s_ota_ctx.bytes_written, (unsigned long)s_ota_ctx.firmware_crc);
+             (unsigned)ctx->bytes_written, (unsigned long)ctx->firmware_crc);
 
-    s_ota_ctx.state = NODE_OTA_STATE_FINISHING;
-    esp_err_t ret = send_ota_end();
+    ctx->state = NODE_OTA_STATE_FINISHING;
+    esp_err_t ret = send_ota_end(ctx);
 
     if (ret == ESP_OK) {
-        report_ota_status("finalizing", 100);
+        report_ota_status(ctx, "finalizing", 100);
     }
 
     return ret;
@@ -609,23 +767,24 @@ esp_err_t node_ota_finish_stream(void)
 // Internal Functions
 // ============================================================================
 
-static esp_err_t send_ota_begin(void)
+static esp_err_t send_ota_begin(node_ota_ctx_t *ctx)
 {
     omniapi_message_t msg;
     OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_BEGIN, 0, sizeof(payload_ota_begin_t));
 
     payload_ota_begin_t *payload = (payload_ota_begin_t *)msg.payload;
-    memcpy(payload->target_mac, s_ota_ctx.target_mac, 6);
-    payload->total_size = s_ota_ctx.firmware_size;
+    memcpy(payload->target_mac, ctx->target_mac, 6);
+    payload->total_size = ctx->firmware_size;
     payload->chunk_size = NODE_OTA_CHUNK_SIZE;
-    payload->total_chunks = s_ota_ctx.total_chunks;
-    payload->firmware_crc = s_ota_ctx.firmware_crc;
+    payload->total_chunks = ctx->total_chunks;
+    payload->firmware_crc = ctx->firmware_crc;
+    memcpy(payload->image_id, ctx->image_id, OTA_IMAGE_ID_LEN);
 
     ESP_LOGI(TAG, "Sending OTA_BEGIN to " MACSTR ": size=%u, chunks=%u",
-             MAC2STR(s_ota_ctx.target_mac), (unsigned)s_ota_ctx.firmware_size,
-             s_ota_ctx.total_chunks);
+             MAC2STR(ctx->target_mac), (unsigned)ctx->firmware_size,
+             ctx->total_chunks);
 
-    return mesh_network_send(s_ota_ctx.target_mac, (uint8_t *)&msg,
+    return mesh_network_send(ctx->target_mac, (uint8_t *)&msg,
                             OMNIAPI_MSG_SIZE(sizeof(payload_ota_begin_t)));
 }
 
@@ -633,9 +792,9 @@ static esp_err_t send_ota_begin(void)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Warray-bounds"
 
-static esp_err_t send_ota_chunk(uint16_t chunk_index)
+static esp_err_t send_ota_chunk(node_ota_ctx_t *ctx, uint16_t chunk_index)
 {
-    if (chunk_index >= s_ota_ctx.total_chunks) {
+    if (chunk_index >= ctx->total_chunks || ctx->firmware_data == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -643,7 +802,7 @@ static esp_err_t send_ota_chunk(uint16_t chunk_index)
 
     // Calculate chunk offset and size
     size_t offset = (size_t)chunk_index * NODE_OTA_CHUNK_SIZE;
-    size_t remaining = s_ota_ctx.firmware_size - offset;
+    size_t remaining = ctx->firmware_size - offset;
     uint16_t chunk_len = (remaining > NODE_OTA_CHUNK_SIZE) ? NODE_OTA_CHUNK_SIZE : remaining;
 
     // Build message
@@ -653,35 +812,35 @@ static esp_err_t send_ota_chunk(uint16_t chunk_index)
     payload_ota_data_t *payload = (payload_ota_data_t *)msg.payload;
     payload->offset = offset;
     payload->length = chunk_len;
-    payload->last_chunk = (chunk_index == s_ota_ctx.total_chunks - 1) ? 1 : 0;
-    memcpy(payload->data, s_ota_ctx.firmware_data + offset, chunk_len);
+    payload->last_chunk = (chunk_index == ctx->total_chunks - 1) ? 1 : 0;
+    memcpy(payload->data, ctx->firmware_data + offset, chunk_len);
 
     ESP_LOGD(TAG, "Sending chunk %u/%u: offset=%u, len=%u",
-             chunk_index + 1, s_ota_ctx.total_chunks, (unsigned)offset, chunk_len);
+             chunk_index + 1, ctx->total_chunks, (unsigned)offset, chunk_len);
 
-    return mesh_network_send(s_ota_ctx.target_mac, (uint8_t *)&msg,
+    return mesh_network_send(ctx->target_mac, (uint8_t *)&msg,
                             OMNIAPI_MSG_SIZE(sizeof(payload_ota_data_t) - OTA_CHUNK_SIZE + chunk_len));
 }
 
 #pragma GCC diagnostic pop
 
-static esp_err_t send_ota_end(void)
+static esp_err_t send_ota_end(node_ota_ctx_t *ctx)
 {
     omniapi_message_t msg;
     OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_END, 0, sizeof(payload_ota_end_t));
 
     payload_ota_end_t *payload = (payload_ota_end_t *)msg.payload;
-    memcpy(payload->target_mac, s_ota_ctx.target_mac, 6);
-    payload->total_chunks = s_ota_ctx.total_chunks;
-    payload->firmware_crc = s_ota_ctx.firmware_crc;
+    memcpy(payload->target_mac, ctx->target_mac, 6);
+    payload->total_chunks = ctx->total_chunks;
+    payload->firmware_crc = ctx->firmware_crc;
 
-    ESP_LOGI(TAG, "Sending OTA_END to " MACSTR, MAC2STR(s_ota_ctx.target_mac));
+    ESP_LOGI(TAG, "Sending OTA_END to " MACSTR, MAC2STR(ctx->target_mac));
 
-    return mesh_network_send(s_ota_ctx.target_mac, (uint8_t *)&msg,
+    return mesh_network_send(ctx->target_mac, (uint8_t *)&msg,
                             OMNIAPI_MSG_SIZE(sizeof(payload_ota_end_t)));
 }
 
-static esp_err_t send_ota_abort_msg(void)
+static esp_err_t send_ota_abort_msg(node_ota_ctx_t *ctx)
 {
     omniapi_message_t msg;
     OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_ABORT, 0, sizeof(payload_ota_abort_t));
@@ -689,36 +848,34 @@ static esp_err_t send_ota_abort_msg(void)
     payload_ota_abort_t *payload = (payload_ota_abort_t *)msg.payload;
     payload->device_type = 0; // Target specific node via MAC
 
-    ESP_LOGI(TAG, "Sending OTA_ABORT to " MACSTR, MAC2STR(s_ota_ctx.target_mac));
+    ESP_LOGI(TAG, "Sending OTA_ABORT to " MACSTR, MAC2STR(ctx->target_mac));
 
-    return mesh_network_send(s_ota_ctx.target_mac, (uint8_t *)&msg,
+    return mesh_network_send(ctx->target_mac, (uint8_t *)&msg,
                             OMNIAPI_MSG_SIZE(sizeof(payload_ota_abort_t)));
 }
 
-static void cleanup_ota(void)
+static void cleanup_ota(node_ota_ctx_t *ctx)
 {
-    if (s_ota_ctx.firmware_data != NULL) {
-        free(s_ota_ctx.firmware_data);
-        s_ota_ctx.firmware_data = NULL;
-    }
-    s_ota_ctx.firmware_size = 0;
-    s_ota_ctx.total_chunks = 0;
-    s_ota_ctx.current_chunk = 0;
-    s_ota_ctx.retry_count = 0;
-    s_ota_ctx.streaming_mode = false;
-    s_ota_ctx.node_ready = false;
-    s_ota_ctx.chunk_acked = false;
-    s_ota_ctx.bytes_written = 0;
-    s_ota_ctx.running_crc = 0;
+    if (ctx->firmware_data != NULL) {
+        free(ctx->firmware_data);
+        ctx->firmware_data = NULL;
+    }
+    // total_chunks/current_chunk are kept for status reporting
+    ctx->retry_count = 0;
+    ctx->streaming_mode = false;
+    ctx->node_ready = false;
+    ctx->chunk_acked = false;
+    ctx->bytes_written = 0;
+    ctx->running_crc = 0;
 
     // Keep state as is (COMPLETE, FAILED, ABORTED) for status reporting
-    // Will be reset to IDLE on next node_ota_start()
+    // Will be reset to IDLE when the session slot is reused
 }
 
-static void report_ota_status(const char *status, int progress)
+static void report_ota_status(node_ota_ctx_t *ctx, const char *status, int progress)
 {
     char mac_str[18];
-    snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(s_ota_ctx.target_mac));
+    snprintf(mac_str, sizeof(mac_str), MACSTR, MAC2STR(ctx->target_mac));
 
     char json[256];
     snprintf(json, sizeof(json),
@@ -730,33 +887,85 @@ static void report_ota_status(const char *status, int progress)
     ESP_LOGI(TAG, "OTA status: node=%s, status=%s, progress=%d", mac_str, status, progress);
 }
 
+static void compute_image_id(const uint8_t digest[32], uint8_t *image_id)
+{
+    memcpy(image_id, digest, OTA_IMAGE_ID_LEN);
+
+    // All-zero means "not resumable" on the wire; never emit it for a real image
+    for (int i = 0; i < OTA_IMAGE_ID_LEN; i++) {
+        if (image_id[i] != 0) {
+            return;
+        }
+    }
+    image_id[OTA_IMAGE_ID_LEN - 1] = 1;
+}
+
 // ============================================================================
 // Flash-Based Async OTA Implementation
 // ============================================================================
 
-// Flash staging state
+// Flash staging state (HTTP upload in progress)
 typedef struct {
     bool active;
+    bool has_target;             // false = stage only (fleet rollout)
     const esp_partition_t *staging_partition;
     uint8_t target_mac[6];
     size_t total_size;
     size_t bytes_written;
     uint32_t crc;
+    mbedtls_sha256_context sha;
 } flash_staging_t;
 
+// Completed image in the staging partition, shared by all flash-based sessions
+typedef struct {
+    bool ready;
+    const esp_partition_t *partition;
+    size_t size;
+    uint32_t crc;
+    uint8_t image_id[OTA_IMAGE_ID_LEN];
+} staged_image_t;
+
+// Staged transfer persisted in NVS so a gateway reboot does not restart the node from chunk 0
+typedef struct __attribute__((packed)) {
+    uint8_t target_mac[6];
+    uint32_t total_size;
+    uint32_t firmware_crc;
+    uint8_t image_id[OTA_IMAGE_ID_LEN];
+} node_ota_job_t;
+
 static flash_staging_t s_flash_staging = {0};
+static staged_image_t s_staged = {0};
 static uint32_t s_last_erased_sector = 0xFFFFFFFF;
 
 // Forward declaration
 static void node_ota_background_task(void *param);
 
+static void flash_staging_abort(void)
+{
+    if (s_flash_staging.active) {
+        mbedtls_sha256_free(&s_flash_staging.sha);
+    }
+    s_flash_staging.active = false;
+}
+
+static bool any_sender_task_running(void)
+{
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        if (s_sessions[i].task != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
 esp_err_t node_ota_flash_begin(const uint8_t *target_mac, size_t total_size)
 {
-    if (target_mac == NULL || total_size == 0) {
+    if (total_size == 0) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (s_flash_staging.active || node_ota_is_active()) {
+    // The staging partition is read by every running sender task
+    if (s_flash_staging.active || node_ota_is_active() || any_sender_task_running()) {
         ESP_LOGE(TAG, "OTA already in progress");
         return ESP_ERR_INVALID_STATE;
     }
@@ -780,19 +989,34 @@ esp_err_t node_ota_flash_begin(const uint8_t *target_mac, size_t total_size)
     ESP_LOGI(TAG, "Preparing staging partition %s for %lu bytes (erase during write)",
              staging->label, (unsigned long)total_size);
 
+    // A new upload overwrites the staging area, so any staged image or persisted job is stale
+    s_staged.ready = false;
+    nvs_storage_erase(NVS_KEY_OTA_JOB);
+
     // Reset sector tracker
     s_last_erased_sector = 0xFFFFFFFF;
 
     // Initialize staging state - NO upfront erase, will erase progressively
     s_flash_staging.staging_partition = staging;
-    memcpy(s_flash_staging.target_mac, target_mac, 6);
+    s_flash_staging.has_target = (target_mac != NULL);
+    if (target_mac != NULL) {
+        memcpy(s_flash_staging.target_mac, target_mac, 6);
+    } else {
+        memset(s_flash_staging.target_mac, 0, 6);
+    }
     s_flash_staging.total_size = total_size;
     s_flash_staging.bytes_written = 0;
     s_flash_staging.crc = 0;
+    mbedtls_sha256_init(&s_flash_staging.sha);
+    mbedtls_sha256_starts(&s_flash_staging.sha, 0);
     s_flash_staging.active = true;
 
-    ESP_LOGI(TAG, "Flash staging ready for " MACSTR ", size=%u",
-             MAC2STR(target_mac), (unsigned)total_size);
+    if (target_mac != NULL) {
+        ESP_LOGI(TAG, "Flash staging ready for " MACSTR ", size=%u",
+                 MAC2STR(target_mac), (unsigned)total_size);
+    } else {
+        ESP_LOGI(TAG, "Flash staging ready (stage only), size=%u", (unsigned)total_size);
+    }
 
     return ESP_OK;
 }
@@ -826,7 +1050,7 @@ esp_err_t node_ota_flash_write(const uint8_t *data, size_t len)
             );
             if (ret != ESP_OK) {
                 ESP_LOGE(TAG, "Failed to erase sector %u: %s", (unsigned)sector, esp_err_to_name(ret));
-                s_flash_staging.active = false;
+                flash_staging_abort();
                 return ret;
             }
             s_last_erased_sector = sector;
@@ -839,17 +1063,47 @@ esp_err_t node_ota_flash_write(const uint8_t *data, size_t len)
                                          data, len);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Flash write failed: %s", esp_err_to_name(ret));
-        s_flash_staging.active = false;
+        flash_staging_abort();
         return ret;
     }
 
-    // Update CRC
+    // Update CRC and image hash
     s_flash_staging.crc = esp_crc32_le(s_flash_staging.crc, data, len);
+    mbedtls_sha256_update(&s_flash_staging.sha, data, len);
     s_flash_staging.bytes_written += len;
 
     return ESP_OK;
 }
 
+/**
+ * Start a background sender for the staged image; caller holds s_mutex
+ */
+static esp_err_t start_staged_session(node_ota_ctx_t *ctx)
+{
+    ctx->firmware_size = s_staged.size;
+    ctx->firmware_crc = s_staged.crc;
+    memcpy(ctx->image_id, s_staged.image_id, OTA_IMAGE_ID_LEN);
+    ctx->total_chunks = (s_staged.size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
+
+    BaseType_t result = xTaskCreate(
+        node_ota_background_task,
+        "node_ota_task",
+        4096,
+        ctx,
+        5,  // Priority
+        &ctx->task
+    );
+
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create OTA background task");
+        ctx->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "OTA background task started for " MACSTR, MAC2STR(ctx->target_mac));
+    return ESP_OK;
+}
+
 esp_err_t node_ota_flash_finish(void)
 {
     if (!s_flash_staging.active) {
@@ -860,44 +1114,204 @@ esp_err_t node_ota_flash_finish(void)
         ESP_LOGE(TAG, "Incomplete upload: %u/%u bytes",
                  (unsigned)s_flash_staging.bytes_written,
                  (unsigned)s_flash_staging.total_size);
-        s_flash_staging.active = false;
+        flash_staging_abort();
         return ESP_ERR_INVALID_SIZE;
     }
 
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&s_flash_staging.sha, digest);
+    mbedtls_sha256_free(&s_flash_staging.sha);
+
     ESP_LOGI(TAG, "Flash staging complete: %u bytes, CRC=0x%08lx",
              (unsigned)s_flash_staging.bytes_written,
              (unsigned long)s_flash_staging.crc);
 
-    // Mark staging as done (but keep data for background task)
+    // Mark staging as done (but keep data for background tasks)
     s_flash_staging.active = false;
+    s_staged.partition = s_flash_staging.staging_partition;
+    s_staged.size = s_flash_staging.total_size;
+    s_staged.crc = s_flash_staging.crc;
+    compute_image_id(digest, s_staged.image_id);
+    s_staged.ready = true;
+
+    if (!s_flash_staging.has_target) {
+        // Stage only: sessions are started later via node_ota_push_staged()
+        return ESP_OK;
+    }
+
+    // Persist the job so the transfer survives a gateway reboot
+    node_ota_job_t job;
+    memcpy(job.target_mac, s_flash_staging.target_mac, 6);
+    job.total_size = s_staged.size;
+    job.firmware_crc = s_staged.crc;
+    memcpy(job.image_id, s_staged.image_id, OTA_IMAGE_ID_LEN);
+    if (nvs_storage_save_blob(NVS_KEY_OTA_JOB, &job, sizeof(job)) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to persist OTA job, transfer will not survive a reboot");
+    }
 
     // Start background task to send OTA to node
-    if (s_ota_task_handle != NULL) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    node_ota_ctx_t *ctx = session_alloc(s_flash_staging.target_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
         ESP_LOGW(TAG, "OTA task already running");
         return ESP_ERR_INVALID_STATE;
     }
 
-    BaseType_t result = xTaskCreate(
-        node_ota_background_task,
-        "node_ota_task",
-        4096,
-        NULL,
-        5,  // Priority
-        &s_ota_task_handle
-    );
+    ctx->persist_job = true;
+    s_primary = ctx;
+    esp_err_t ret = start_staged_session(ctx);
 
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create OTA background task");
-        return ESP_ERR_NO_MEM;
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+bool node_ota_flash_staging_active(void)
+{
+    return s_flash_staging.active;
+}
+
+esp_err_t node_ota_flash_get_progress(uint8_t *target_mac, size_t *written, size_t *total)
+{
+    if (!s_flash_staging.active) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    ESP_LOGI(TAG, "OTA background task started");
+    if (target_mac) memcpy(target_mac, s_flash_staging.target_mac, 6);
+    if (written) *written = s_flash_staging.bytes_written;
+    if (total) *total = s_flash_staging.total_size;
     return ESP_OK;
 }
 
-bool node_ota_flash_staging_active(void)
+void node_ota_flash_cancel(void)
 {
-    return s_flash_staging.active;
+    if (s_flash_staging.active) {
+        ESP_LOGI(TAG, "Flash staging cancelled at %u/%u bytes",
+                 (unsigned)s_flash_staging.bytes_written,
+                 (unsigned)s_flash_staging.total_size);
+    }
+    flash_staging_abort();
+}
+
+static bool staging_crc_matches(const esp_partition_t *partition, size_t size, uint32_t expected)
+{
+    uint8_t buf[256];
+    uint32_t crc = 0;
+    for (size_t offset = 0; offset < size; offset += sizeof(buf)) {
+        size_t len = size - offset;
+        if (len > sizeof(buf)) len = sizeof(buf);
+        if (esp_partition_read(partition, offset, buf, len) != ESP_OK) {
+            return false;
+        }
+        crc = esp_crc32_le(crc, buf, len);
+    }
+    return crc == expected;
+}
+
+esp_err_t node_ota_verify_staged(size_t *size)
+{
+    if (!s_staged.ready || s_flash_staging.active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Gateway self-OTA writes the same partition, so re-check before trusting it
+    if (!staging_crc_matches(s_staged.partition, s_staged.size, s_staged.crc)) {
+        ESP_LOGW(TAG, "Staged image no longer matches its CRC");
+        s_staged.ready = false;
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (size) *size = s_staged.size;
+    return ESP_OK;
+}
+
+esp_err_t node_ota_push_staged(const uint8_t *target_mac)
+{
+    if (target_mac == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_staged.ready || s_flash_staging.active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    node_ota_ctx_t *ctx = session_alloc(target_mac);
+    if (ctx == NULL) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ctx->held = true;
+    esp_err_t ret = start_staged_session(ctx);
+    if (ret != ESP_OK) {
+        ctx->held = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+void node_ota_release_session(const uint8_t *target_mac)
+{
+    if (target_mac == NULL || xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return;
+    }
+
+    for (int i = 0; i < NODE_OTA_MAX_SESSIONS; i++) {
+        node_ota_ctx_t *ctx = &s_sessions[i];
+        if (ctx->held && memcmp(ctx->target_mac, target_mac, 6) == 0) {
+            if (session_busy(ctx) && ctx->state != NODE_OTA_STATE_ABORTED) {
+                abort_session(ctx);
+            }
+            ctx->held = false;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+/**
+ * Restart a staged transfer that was interrupted by a gateway reboot.
+ * The background task re-checks the staging partition against the persisted CRC.
+ */
+static void resume_pending_job(void)
+{
+    node_ota_job_t job;
+    size_t len = sizeof(job);
+    if (nvs_storage_load_blob(NVS_KEY_OTA_JOB, &job, &len) != ESP_OK || len != sizeof(job)) {
+        return;
+    }
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *staging = esp_ota_get_next_update_partition(running);
+    if (staging == NULL || job.total_size == 0 || job.total_size > staging->size) {
+        nvs_storage_erase(NVS_KEY_OTA_JOB);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Resuming node OTA to " MACSTR " after reboot (%lu bytes)",
+             MAC2STR(job.target_mac), (unsigned long)job.total_size);
+
+    s_staged.partition = staging;
+    s_staged.size = job.total_size;
+    s_staged.crc = job.firmware_crc;
+    memcpy(s_staged.image_id, job.image_id, OTA_IMAGE_ID_LEN);
+    s_staged.ready = false;  // Until the background task has verified the CRC
+
+    node_ota_ctx_t *ctx = session_alloc(job.target_mac);
+    ctx->persist_job = true;
+    ctx->resume_after_boot = true;
+    s_primary = ctx;
+    if (start_staged_session(ctx) != ESP_OK) {
+        ctx->resume_after_boot = false;
+    }
 }
 
 /**
@@ -905,14 +1319,40 @@ bool node_ota_flash_staging_active(void)
  */
 static void node_ota_background_task(void *param)
 {
+    node_ota_ctx_t *ctx = (node_ota_ctx_t *)param;
+
     ESP_LOGI(TAG, "=== OTA Background Task Started ===");
     webserver_log("[OTA] Background task started");
 
     uint8_t target_mac[6];
-    memcpy(target_mac, s_flash_staging.target_mac, 6);
-    size_t total_size = s_flash_staging.total_size;
-    uint32_t firmware_crc = s_flash_staging.crc;
-    const esp_partition_t *partition = s_flash_staging.staging_partition;
+    memcpy(target_mac, ctx->target_mac, 6);
+    size_t total_size = ctx->firmware_size;
+    uint32_t firmware_crc = ctx->firmware_crc;
+    const esp_partition_t *partition = s_staged.partition;
+    int64_t transfer_start = esp_timer_get_time() / 1000;
+    uint16_t first_chunk = 0;
+
+    // After a gateway reboot the mesh needs time to re-form before the node is reachable
+    if (ctx->resume_after_boot) {
+        if (!staging_crc_matches(partition, total_size, firmware_crc)) {
+            ESP_LOGW(TAG, "Staged node firmware no longer valid, dropping pending OTA");
+            nvs_storage_erase(NVS_KEY_OTA_JOB);
+            goto task_exit;
+        }
+        s_staged.ready = true;
+        while (!mesh_network_is_node_reachable(target_mac)) {
+            if ((esp_timer_get_time() / 1000) - transfer_start > NODE_OTA_RESUME_WAIT_MS) {
+                ESP_LOGW(TAG, "Node " MACSTR " not reachable after reboot, dropping pending OTA",
+                         MAC2STR(target_mac));
+                nvs_storage_erase(NVS_KEY_OTA_JOB);
+                goto task_exit;
+            }
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+        webserver_log("[OTA] Resuming transfer to " MACSTR " after gateway reboot",
+                      MAC2STR(target_mac));
+        transfer_start = esp_timer_get_time() / 1000;
+    }
 
     // Check if node is in routing table
     bool node_found = mesh_network_is_node_reachable(target_mac);
@@ -927,42 +1367,31 @@ static void node_ota_background_task(void *param)
     }
 
     // Initialize OTA context
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
         ESP_LOGE(TAG, "Failed to take mutex");
         webserver_log("[OTA] ERROR: Failed to acquire mutex");
         goto task_exit;
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_IDLE) {
-        ESP_LOGE(TAG, "OTA already in progress");
-        webserver_log("[OTA] ERROR: OTA already in progress");
-        xSemaphoreGive(s_ota_ctx.mutex);
-        goto task_exit;
-    }
-
     // Setup context
-    memcpy(s_ota_ctx.target_mac, target_mac, 6);
-    s_ota_ctx.firmware_size = total_size;
-    s_ota_ctx.firmware_crc = firmware_crc;
-    s_ota_ctx.total_chunks = (total_size + NODE_OTA_CHUNK_SIZE - 1) / NODE_OTA_CHUNK_SIZE;
-    s_ota_ctx.current_chunk = 0;
-    s_ota_ctx.retry_count = 0;
-    s_ota_ctx.streaming_mode = false;
-    s_ota_ctx.node_ready = false;
-    s_ota_ctx.chunk_acked = false;
-    s_ota_ctx.last_activity = esp_timer_get_time() / 1000;
+    ctx->current_chunk = 0;
+    ctx->retry_count = 0;
+    ctx->streaming_mode = false;
+    ctx->node_ready = false;
+    ctx->chunk_acked = false;
+    ctx->last_activity = esp_timer_get_time() / 1000;
 
     ESP_LOGI(TAG, "Starting OTA to " MACSTR ": size=%u, chunks=%u, CRC=0x%08lx",
              MAC2STR(target_mac), (unsigned)total_size,
-             s_ota_ctx.total_chunks, (unsigned long)firmware_crc);
+             ctx->total_chunks, (unsigned long)firmware_crc);
     webserver_log("[OTA] Starting to " MACSTR ", %u bytes, %u chunks",
-                  MAC2STR(target_mac), (unsigned)total_size, s_ota_ctx.total_chunks);
+                  MAC2STR(target_mac), (unsigned)total_size, ctx->total_chunks);
 
     // Send OTA_BEGIN
-    s_ota_ctx.state = NODE_OTA_STATE_STARTING;
-    xSemaphoreGive(s_ota_ctx.mutex);
+    ctx->state = NODE_OTA_STATE_STARTING;
+    xSemaphoreGive(s_mutex);
 
-    report_ota_status("starting", 0);
+    report_ota_status(ctx, "starting", 0);
 
     // Build and send OTA_BEGIN message
     omniapi_message_t msg;
@@ -972,8 +1401,9 @@ static void node_ota_background_task(void *param)
     memcpy(begin->target_mac, target_mac, 6);
     begin->total_size = total_size;
     begin->chunk_size = NODE_OTA_CHUNK_SIZE;
-    begin->total_chunks = s_ota_ctx.total_chunks;
+    begin->total_chunks = ctx->total_chunks;
     begin->firmware_crc = firmware_crc;
+    memcpy(begin->image_id, ctx->image_id, OTA_IMAGE_ID_LEN);
 
     ESP_LOGI(TAG, "Sending OTA_BEGIN to " MACSTR " (msg_type=0x%02X, payload_len=%u)",
              MAC2STR(target_mac), msg.header.msg_type, msg.header.payload_len);
@@ -983,8 +1413,8 @@ static void node_ota_background_task(void *param)
     if (send_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send OTA_BEGIN: %s", esp_err_to_name(send_ret));
         webserver_log("[OTA] ERROR: Failed to send OTA_BEGIN: %s", esp_err_to_name(send_ret));
-        s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-        report_ota_status("failed", -1);
+        ctx->state = NODE_OTA_STATE_FAILED;
+        report_ota_status(ctx, "failed", -1);
         goto task_exit;
     }
     ESP_LOGI(TAG, "OTA_BEGIN sent successfully, waiting for node ACK...");
@@ -992,7 +1422,7 @@ static void node_ota_background_task(void *param)
 
     // Wait for node ready (OTA_ACK with READY status)
     int64_t wait_start = esp_timer_get_time() / 1000;
-    while (!s_ota_ctx.node_ready && s_ota_ctx.state == NODE_OTA_STATE_STARTING) {
+    while (!ctx->node_ready && ctx->state == NODE_OTA_STATE_STARTING) {
         vTaskDelay(pdMS_TO_TICKS(100));
 
         int64_t elapsed = (esp_timer_get_time() / 1000) - wait_start;
@@ -1005,25 +1435,32 @@ static void node_ota_background_task(void *param)
         if (elapsed > 30000) {  // 30s timeout
             ESP_LOGE(TAG, "Node not ready timeout after 30s");
             webserver_log("[OTA] ERROR: Node did not respond to OTA_BEGIN (30s timeout)");
-            s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-            report_ota_status("failed", -1);
+            ctx->state = NODE_OTA_STATE_FAILED;
+            report_ota_status(ctx, "failed", -1);
             goto task_exit;
         }
     }
 
-    if (s_ota_ctx.state != NODE_OTA_STATE_SENDING) {
-        ESP_LOGE(TAG, "Failed to start OTA, state=%d", s_ota_ctx.state);
+    if (ctx->state != NODE_OTA_STATE_SENDING) {
+        ESP_LOGE(TAG, "Failed to start OTA, state=%d", ctx->state);
         goto task_exit;
     }
 
-    ESP_LOGI(TAG, "Node ready, sending %u chunks...", s_ota_ctx.total_chunks);
-    report_ota_status("sending", 0);
+    // The READY ACK carries the first chunk the node still needs
+    first_chunk = ctx->current_chunk;
+    if (first_chunk > 0) {
+        ESP_LOGI(TAG, "Node has %u/%u chunks, resuming", first_chunk, ctx->total_chunks);
+        webserver_log("[OTA] Resuming at chunk %u/%u", first_chunk, ctx->total_chunks);
+    } else {
+        ESP_LOGI(TAG, "Node ready, sending %u chunks...", ctx->total_chunks);
+    }
+    report_ota_status(ctx, "sending", (first_chunk * 100) / ctx->total_chunks);
 
     // Read buffer for chunks
     uint8_t chunk_buf[NODE_OTA_CHUNK_SIZE];
 
-    // Send all chunks
-    for (uint16_t i = 0; i < s_ota_ctx.total_chunks; i++) {
+    // Send remaining chunks
+    for (uint16_t i = first_chunk; i < ctx->total_chunks; i++) {
         size_t offset = (size_t)i * NODE_OTA_CHUNK_SIZE;
         size_t remaining = total_size - offset;
         size_t chunk_len = (remaining > NODE_OTA_CHUNK_SIZE) ? NODE_OTA_CHUNK_SIZE : remaining;
@@ -1033,8 +1470,8 @@ static void node_ota_background_task(void *param)
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Flash read failed at offset %u: %s",
                      (unsigned)offset, esp_err_to_name(ret));
-            s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-            report_ota_status("failed", -1);
+            ctx->state = NODE_OTA_STATE_FAILED;
+            report_ota_status(ctx, "failed", -1);
             goto task_exit;
         }
 
@@ -1045,12 +1482,14 @@ static void node_ota_background_task(void *param)
         payload_ota_data_t *data = (payload_ota_data_t *)msg.payload;
         data->offset = offset;
         data->length = chunk_len;
-        data->last_chunk = (i == s_ota_ctx.total_chunks - 1) ? 1 : 0;
+        data->last_chunk = (i == ctx->total_chunks - 1) ? 1 : 0;
         memcpy(data->data, chunk_buf, chunk_len);
 
         // Send with retry
         int retries = 0;
-        s_ota_ctx.chunk_acked = false;
+        ctx->chunk_acked = false;
+
+        uint32_t chunk_timeout = mesh_topology_scale_timeout(target_mac, NODE_OTA_CHUNK_TIMEOUT_MS);
 
         while (retries < NODE_OTA_MAX_RETRIES) {
             mesh_network_send(target_mac, (uint8_t *)&msg,
@@ -1058,56 +1497,58 @@ static void node_ota_background_task(void *param)
 
             // Wait for ACK (fast polling)
             wait_start = esp_timer_get_time() / 1000;
-            while (!s_ota_ctx.chunk_acked) {
+            while (!ctx->chunk_acked) {
                 vTaskDelay(pdMS_TO_TICKS(5));  // Fast 5ms polling
 
                 int64_t elapsed = (esp_timer_get_time() / 1000) - wait_start;
-                if (elapsed > 5000) {  // 5s per chunk timeout
+                if (elapsed > chunk_timeout) {
                     break;
                 }
 
-                if (s_ota_ctx.state == NODE_OTA_STATE_FAILED) {
+                if (ctx->state == NODE_OTA_STATE_FAILED ||
+                    ctx->state == NODE_OTA_STATE_ABORTED) {
                     goto task_exit;
                 }
             }
 
-            if (s_ota_ctx.chunk_acked) {
+            if (ctx->chunk_acked) {
                 break;
             }
 
             retries++;
+            ctx->chunk_retries++;
             ESP_LOGW(TAG, "Chunk %u ACK timeout, retry %d/%d", i, retries, NODE_OTA_MAX_RETRIES);
         }
 
-        if (!s_ota_ctx.chunk_acked) {
+        if (!ctx->chunk_acked) {
             ESP_LOGE(TAG, "Chunk %u failed after %d retries", i, NODE_OTA_MAX_RETRIES);
-            s_ota_ctx.state = NODE_OTA_STATE_FAILED;
-            report_ota_status("failed", -1);
+            ctx->state = NODE_OTA_STATE_FAILED;
+            report_ota_status(ctx, "failed", -1);
             goto task_exit;
         }
 
-        s_ota_ctx.current_chunk = i + 1;
+        ctx->current_chunk = i + 1;
 
         // Report progress
-        int progress = ((i + 1) * 100) / s_ota_ctx.total_chunks;
-        if ((i + 1) % 50 == 0 || i == s_ota_ctx.total_chunks - 1) {
-            ESP_LOGI(TAG, "Progress: %u/%u chunks (%d%%)", i + 1, s_ota_ctx.total_chunks, progress);
-            report_ota_status("sending", progress);
+        int progress = ((i + 1) * 100) / ctx->total_chunks;
+        if ((i + 1) % 50 == 0 || i == ctx->total_chunks - 1) {
+            ESP_LOGI(TAG, "Progress: %u/%u chunks (%d%%)", i + 1, ctx->total_chunks, progress);
+            report_ota_status(ctx, "sending", progress);
         }
 
         // No delay - ACK-based flow control is sufficient
     }
 
     ESP_LOGI(TAG, "All chunks sent, sending OTA_END");
-    s_ota_ctx.state = NODE_OTA_STATE_FINISHING;
-    report_ota_status("finishing", 100);
+    ctx->state = NODE_OTA_STATE_FINISHING;
+    report_ota_status(ctx, "finishing", 100);
 
     // Send OTA_END
     OMNIAPI_INIT_HEADER(&msg.header, MSG_OTA_END, 0, sizeof(payload_ota_end_t));
 
     payload_ota_end_t *end = (payload_ota_end_t *)msg.payload;
     memcpy(end->target_mac, target_mac, 6);
-    end->total_chunks = s_ota_ctx.total_chunks;
+    end->total_chunks = ctx->total_chunks;
     end->firmware_crc = firmware_crc;
 
     mesh_network_send(target_mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_ota_end_t)));
@@ -1117,26 +1558,45 @@ static void node_ota_background_task(void *param)
     vTaskDelay(pdMS_TO_TICKS(5000));
 
     // Check final state
-    if (s_ota_ctx.state == NODE_OTA_STATE_COMPLETE) {
+    if (ctx->state == NODE_OTA_STATE_COMPLETE) {
         ESP_LOGI(TAG, "=== OTA COMPLETE ===");
-    } else if (s_ota_ctx.state == NODE_OTA_STATE_FINISHING) {
+    } else if (ctx->state == NODE_OTA_STATE_FINISHING) {
         // Node didn't respond with COMPLETE, but might have rebooted
         ESP_LOGI(TAG, "OTA finished, node may have rebooted");
-        s_ota_ctx.state = NODE_OTA_STATE_COMPLETE;
-        report_ota_status("complete", 100);
+        ctx->state = NODE_OTA_STATE_COMPLETE;
+        report_ota_status(ctx, "complete", 100);
     }
 
+    ESP_LOGI(TAG, "Transfer time: %lld ms (resumed at chunk %u/%u)",
+             (esp_timer_get_time() / 1000) - transfer_start, first_chunk, ctx->total_chunks);
+    webserver_log("[OTA] Transfer time %lld ms, resumed at chunk %u",
+                  (esp_timer_get_time() / 1000) - transfer_start, first_chunk);
+
 task_exit:
     ESP_LOGI(TAG, "OTA background task exiting");
 
+    // The job is done one way or another; a retry needs a fresh upload
+    if (ctx->persist_job &&
+        (ctx->state == NODE_OTA_STATE_COMPLETE ||
+         ctx->state == NODE_OTA_STATE_FAILED ||
+         ctx->state == NODE_OTA_STATE_ABORTED)) {
+        nvs_storage_erase(NVS_KEY_OTA_JOB);
+    }
+
     // Cleanup
-    if (xSemaphoreTake(s_ota_ctx.mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        if (s_ota_ctx.state != NODE_OTA_STATE_COMPLETE) {
-            s_ota_ctx.state = NODE_OTA_STATE_IDLE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        // Session never got going (e.g. resume dropped) - leave nothing behind
+        if (ctx->state == NODE_OTA_STATE_IDLE ||
+            ctx->state == NODE_OTA_STATE_STARTING ||
+            ctx->state == NODE_OTA_STATE_SENDING) {
+            ctx->state = ctx->held ? NODE_OTA_STATE_FAILED : NODE_OTA_STATE_IDLE;
         }
-        xSemaphoreGive(s_ota_ctx.mutex);
+        ctx->resume_after_boot = false;
+        ctx->task = NULL;
+        xSemaphoreGive(s_mutex);
+    } else {
+        ctx->task = NULL;
     }
 
-    s_ota_task_handle = NULL;
     vTaskDelete(NULL);
 }
@@ -22,7 +22,10 @@ extern "C" {
 // ============================================================================
 #define NODE_OTA_CHUNK_SIZE         180     // Chunk size (must match OTA_CHUNK_SIZE in protocol)
 #define NODE_OTA_TIMEOUT_MS         60000   // Timeout waiting for ACK (60s)
+#define NODE_OTA_CHUNK_TIMEOUT_MS   5000    // Chunk ACK timeout on a clean path (scaled by path ETX)
 #define NODE_OTA_MAX_RETRIES        3       // Max retries per chunk
+#define NODE_OTA_RESUME_WAIT_MS     120000  // Wait for target to rejoin before resuming after reboot
+#define NODE_OTA_MAX_SESSIONS       4       // Parallel transfers of the staged image
 
 // ============================================================================
 // OTA State
@@ -37,6 +40,17 @@ typedef enum {
     NODE_OTA_STATE_ABORTED          // OTA aborted
 } node_ota_state_t;
 
+// Per-node transfer snapshot (see node_ota_get_session_info)
+typedef struct {
+    node_ota_state_t state;
+    uint16_t total_chunks;
+    uint16_t current_chunk;         // Chunks the node has acknowledged
+    uint16_t resume_chunk;          // First chunk requested at READY (>0 = resumed)
+    uint32_t chunk_retries;         // Chunk resends so far
+    int64_t start_time_ms;
+    bool running;                   // Transfer still in progress
+} node_ota_session_info_t;
+
 // ============================================================================
 // Public Functions
 // ============================================================================
@@ -149,6 +163,20 @@ bool node_ota_is_active(void);
  */
 esp_err_t node_ota_get_target_mac(uint8_t *mac);
 
+/**
+ * Count transfers currently running (all sessions)
+ * @return Number of busy sessions
+ */
+int node_ota_active_sessions(void);
+
+/**
+ * Get transfer details for a node
+ * @param mac   Node MAC address
+ * @param info  Output snapshot
+ * @return ESP_OK if a session for the node exists, ESP_ERR_NOT_FOUND otherwise
+ */
+esp_err_t node_ota_get_session_info(const uint8_t *mac, node_ota_session_info_t *info);
+
 // ============================================================================
 // Async Flash-Based OTA (firmware buffered on gateway flash)
 // ============================================================================
@@ -156,7 +184,7 @@ esp_err_t node_ota_get_target_mac(uint8_t *mac);
 /**
  * Prepare flash storage for node firmware upload
  * Uses the gateway's inactive OTA partition as staging area
- * @param target_mac  Target node MAC address
+ * @param target_mac  Target node MAC address, or NULL to stage only (see node_ota_push_staged)
  * @param total_size  Total firmware size
  * @return ESP_OK on success
  */
@@ -183,6 +211,41 @@ esp_err_t node_ota_flash_finish(void);
  */
 bool node_ota_flash_staging_active(void);
 
+/**
+ * Get flash staging progress (for resuming an interrupted upload)
+ * @param target_mac  Buffer for target MAC (6 bytes, may be NULL)
+ * @param written     Bytes staged so far (may be NULL)
+ * @param total       Expected total size (may be NULL)
+ * @return ESP_OK if staging active, ESP_ERR_INVALID_STATE otherwise
+ */
+esp_err_t node_ota_flash_get_progress(uint8_t *target_mac, size_t *written, size_t *total);
+
+/**
+ * Cancel flash staging (abandoned upload)
+ */
+void node_ota_flash_cancel(void);
+
+/**
+ * Re-check the staged image against its CRC
+ * @param size  Staged image size (may be NULL)
+ * @return ESP_OK if a valid image is staged
+ */
+esp_err_t node_ota_verify_staged(size_t *size);
+
+/**
+ * Push the staged image to a node in its own session (runs in background)
+ * The session result is kept until node_ota_release_session() is called.
+ * @param target_mac  Target node MAC address
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all sessions are busy
+ */
+esp_err_t node_ota_push_staged(const uint8_t *target_mac);
+
+/**
+ * Release a session started with node_ota_push_staged (aborts it if still running)
+ * @param target_mac  Target node MAC address
+ */
+void node_ota_release_session(const uint8_t *target_mac);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +55,10 @@ extern "C" {
 #define MSG_RELAY_STATUS            0x21    // Node -> Gateway: relay status
 #define MSG_LED_CMD                 0x22    // Gateway -> Node: LED command
 #define MSG_LED_STATUS              0x23    // Node -> Gateway: LED status
+#define MSG_DIMMER_CMD              0x24    // Gateway -> Node: dimmer fade
+#define MSG_DIMMER_STATUS           0x25    // Node -> Gateway: dimmer levels (fade finished)
+#define MSG_LED_PALETTE             0x26    // Gateway -> Node: LED palette upload/select
+#define MSG_LED_SCRIPT              0x27    // Gateway -> Node: LED effect program upload/select
 
 // Sensor Messages (0x30 - 0x3F)
 #define MSG_SENSOR_DATA             0x30    // Node -> Gateway: sensor reading
@@ -97,6 +102,9 @@ extern "C" {
 #define LED_ACTION_SET_BRIGHTNESS   0x03
 #define LED_ACTION_EFFECT           0x04
 
+#define DIMMER_CURVE_LINEAR         0x00    // Duty ramps linearly (one hardware fade)
+#define DIMMER_CURVE_PERCEPTUAL     0x01    // Perceived brightness ramps linearly
+
 // ============================================================================
 // Device Types
 // ============================================================================
@@ -129,6 +137,27 @@ extern "C" {
 #define LED_EFFECT_RAINBOW          0x03
 #define LED_EFFECT_CHASE            0x04
 #define LED_EFFECT_FLASH            0x05
+#define LED_EFFECT_SPARKLE          0x06
+#define LED_EFFECT_FIRE             0x07
+#define LED_EFFECT_PALETTE          0x08    // Palette scrolling along the strip
+#define LED_EFFECT_GRADIENT         0x09    // Palette stretched over the strip
+#define LED_EFFECT_SCRIPT           0x0A    // Uploaded effect program
+
+// LED palette encoding: [header][entries], header = count (1-16) | GRADIENT
+// Palette entries are [r g b], gradient stops [pos r g b] (pos ascending)
+#define LED_PALETTE_ENTRIES_MAX     16
+#define LED_PALETTE_HDR_GRADIENT    0x80
+#define LED_PALETTE_DATA_MAX        (1 + LED_PALETTE_ENTRIES_MAX * 4)
+#define LED_PALETTE_BANK_SLOTS      8       // Palettes the node keeps in NVS (ids 0-7)
+#define LED_PALETTE_FLAG_STORE      0x01    // Save in bank slot palette_id
+#define LED_PALETTE_FLAG_SELECT     0x02    // Use it now
+
+// LED effect program: [version][frame_len][pixel_len][code] (bytecode,
+// see shared/components/led_render/include/led_script.h)
+#define LED_SCRIPT_DATA_MAX         163
+#define LED_SCRIPT_BANK_SLOTS       4       // Programs the node keeps in NVS (ids 0-3)
+#define LED_SCRIPT_FLAG_STORE       0x01    // Save in bank slot script_id
+#define LED_SCRIPT_FLAG_SELECT      0x02    // Run it now
 
 // ============================================================================
 // Protocol Structures
@@ -234,8 +263,13 @@ typedef struct __attribute__((packed)) {
     uint8_t  capabilities;      // Device-specific capabilities
     uint32_t firmware_version;  // Firmware version
     uint8_t  commissioned;      // 0=not commissioned, 1=commissioned
+    // State digest (absent from older nodes, see ANNOUNCE_HAS_DIGEST)
+    uint8_t  state_mask;        // Relay bitmask (bit n = channel n), LED strip: bit 0 = on
+    uint32_t config_hash;       // FNV-1a over the node's runtime config
 } payload_node_announce_t;
 
+#define ANNOUNCE_HAS_DIGEST(payload_len) ((payload_len) >= sizeof(payload_node_announce_t))
+
 /**
  * Heartbeat ACK payload (Node -> Gateway)
  */
@@ -247,8 +281,26 @@ typedef struct __attribute__((packed)) {
     int8_t   rssi;              // WiFi RSSI
     uint32_t firmware_version;  // Firmware version (major<<16 | minor<<8 | patch)
     uint32_t uptime;            // Uptime in seconds
+    // Parent link report (absent from older nodes, see HEARTBEAT_ACK_HAS_LINK)
+    uint8_t  parent_mac[6];     // Parent BSSID (softAP MAC; gateway's for layer 2)
+    uint16_t link_tx;           // Frames sent towards root since previous ACK
+    uint16_t link_fail;         // Of which esp_mesh_send failed
+    uint8_t  parent_changes;    // Parent switches since previous ACK (saturating)
+    // Boot report (absent from older nodes, see HEARTBEAT_ACK_HAS_BOOT)
+    uint8_t  rejoin_mode;       // REJOIN_* (how the node joined after boot)
+    uint32_t boot_connect_ms;   // Boot to first parent connection
+    uint32_t boot_first_cmd_ms; // Boot to first device command (0 = none yet)
 } payload_heartbeat_ack_t;
 
+#define HEARTBEAT_ACK_HAS_LINK(payload_len) \
+    ((payload_len) >= offsetof(payload_heartbeat_ack_t, parent_changes) + sizeof(uint8_t))
+#define HEARTBEAT_ACK_HAS_BOOT(payload_len) ((payload_len) >= sizeof(payload_heartbeat_ack_t))
+
+// Rejoin modes
+#define REJOIN_SCAN             0x00    // Self-organised scan (no usable cache)
+#define REJOIN_FAST             0x01    // Associated directly to the cached parent
+#define REJOIN_FAST_FAILED      0x02    // Cached parent unreachable, fell back to scan
+
 /**
  * Relay Command payload (Gateway -> Node)
  */
@@ -290,12 +342,54 @@ typedef struct __attribute__((packed)) {
     uint8_t effect_id;          // Current effect
 } payload_led_status_t;
 
+/**
+ * LED Palette payload (Gateway -> Node)
+ * Without data the node selects palette_id from its bank.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  palette_id;        // Bank slot (0-7)
+    uint8_t  flags;             // LED_PALETTE_FLAG_*
+    uint8_t  data[LED_PALETTE_DATA_MAX];    // Encoded palette (variable length)
+} payload_led_palette_t;
+
+/**
+ * LED Script payload (Gateway -> Node)
+ * Without data the node runs script_id from its bank.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  script_id;         // Bank slot (0-3)
+    uint8_t  flags;             // LED_SCRIPT_FLAG_*
+    uint8_t  data[LED_SCRIPT_DATA_MAX];     // Program (variable length)
+} payload_led_script_t;
+
+#define DIMMER_MAX_CHANNELS         4       // e.g. single, CCT (warm/cold), RGBW
+
+/**
+ * Dimmer Command payload (Gateway -> Node)
+ * The whole ramp runs on the node; no further commands are needed.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  channel_mask;      // Bit per channel to change
+    uint8_t  level[DIMMER_MAX_CHANNELS];    // Target level per channel (0-255)
+    uint16_t transition_ms;     // Fade time (0 = immediate)
+    uint8_t  curve;             // DIMMER_CURVE_*
+} payload_dimmer_cmd_t;
+
+/**
+ * Dimmer Status payload (Node -> Gateway), sent once the fade has finished
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  channel_count;     // Channels fitted
+    uint8_t  level[DIMMER_MAX_CHANNELS];    // Current level per channel
+} payload_dimmer_status_t;
+
 // ============================================================================
 // OTA Structures
 // ============================================================================
 
 #define OTA_CHUNK_SIZE              180     // Max chunk payload size (must fit in OMNIAPI_MAX_PAYLOAD)
 #define OTA_BLOCK_SIZE              4096    // Logical block size for node requests
+#define OTA_IMAGE_ID_LEN            8       // Truncated SHA256 of the image (push-mode resume key)
 
 /**
  * OTA Available payload (Gateway -> Nodes broadcast)
@@ -371,16 +465,20 @@ typedef struct __attribute__((packed)) {
     uint16_t chunk_size;        // Size of each chunk (typically 1024)
     uint16_t total_chunks;      // Total number of chunks
     uint32_t firmware_crc;      // CRC32 of entire firmware
+    uint8_t  image_id[OTA_IMAGE_ID_LEN]; // SHA256 prefix of the image (all zero = not resumable)
 } payload_ota_begin_t;
 
+// Size of payload_ota_begin_t as sent by gateways without resume support (no image_id)
+#define OTA_BEGIN_LEGACY_SIZE       (sizeof(payload_ota_begin_t) - OTA_IMAGE_ID_LEN)
+
 /**
  * OTA ACK payload (Node -> Gateway)
  * Node acknowledges receipt of a chunk
  */
 typedef struct __attribute__((packed)) {
     uint8_t  mac[6];            // Node MAC
-    uint16_t chunk_index;       // Chunk index that was received
-    uint8_t  status;            // 0=OK, 1=CRC_ERROR, 2=WRITE_ERROR, 3=ABORT
+    uint16_t chunk_index;       // Chunk index that was received (READY: first chunk still needed)
+    uint8_t  status;            // 0=OK, 1=CRC_ERROR, 2=WRITE_ERROR, 3=ABORT, 4=READY
 } payload_ota_ack_t;
 
 /**
@@ -410,6 +508,8 @@ typedef struct __attribute__((packed)) {
 
 // Config keys
 #define CONFIG_KEY_RELAY_MODE   0x01    // Relay control mode
+#define CONFIG_KEY_MESH_PARAMS  0x02    // config_mesh_params_t, applied on next mesh start
+#define CONFIG_KEY_MESH_PARENT  0x03    // config_mesh_parent_t, switch parent now
 
 /**
  * Config Set payload (Gateway -> Node)
@@ -422,6 +522,24 @@ typedef struct __attribute__((packed)) {
     uint8_t  value[32];         // Configuration value
 } payload_config_set_t;
 
+/**
+ * CONFIG_KEY_MESH_PARAMS value: mesh shape limits chosen by the gateway
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  max_layer;         // esp_mesh_set_max_layer()
+    uint8_t  max_connection;    // Children this node accepts on its mesh softAP
+} config_mesh_params_t;
+
+/**
+ * CONFIG_KEY_MESH_PARENT value: parent the gateway wants this node under.
+ * The node falls back to self-organised parent selection if it cannot
+ * associate within a few seconds.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  parent_bssid[6];   // Mesh softAP MAC of the new parent
+    uint8_t  parent_layer;      // Layer of the new parent (root = 1)
+} config_mesh_parent_t;
+
 /**
  * Config ACK payload (Node -> Gateway)
  * Confirms configuration was applied
@@ -482,6 +600,7 @@ typedef struct __attribute__((packed)) {
 #define MQTT_TOPIC_PREFIX           "omniapi"
 #define MQTT_TOPIC_GATEWAY          "omniapi/gateway"
 #define MQTT_TOPIC_NODES            "omniapi/gateway/nodes"
+#define MQTT_TOPIC_NODES_ONLINE     "omniapi/gateway/nodes/online"
 #define MQTT_TOPIC_CMD              "omniapi/gateway/cmd"
 #define MQTT_TOPIC_STATUS           "omniapi/gateway/status"
 #define MQTT_TOPIC_SCAN             "omniapi/gateway/scan"
@@ -490,6 +609,10 @@ typedef struct __attribute__((packed)) {
 #define MQTT_TOPIC_OTA_PROGRESS     "omniapi/gateway/ota/progress"
 #define MQTT_TOPIC_OTA_COMPLETE     "omniapi/gateway/ota/complete"
 #define MQTT_TOPIC_OTA_ABORT        "omniapi/gateway/ota/abort"
+#define MQTT_TOPIC_FLEET_OTA_START  "omniapi/gateway/ota/fleet/start"
+#define MQTT_TOPIC_FLEET_OTA_CONTINUE "omniapi/gateway/ota/fleet/continue"
+#define MQTT_TOPIC_FLEET_OTA_ABORT  "omniapi/gateway/ota/fleet/abort"
+#define MQTT_TOPIC_FLEET_OTA_STATUS "omniapi/gateway/ota/fleet/status"
 
 // ============================================================================
 // OTA Error Codes
@@ -4,14 +4,23 @@
 
 #include "web_api.h"
 #include "webserver.h"
+#include "log_ring.h"
 #include "node_manager.h"
 #include "commissioning.h"
 #include "ota_manager.h"
 #include "node_ota.h"
+#include "fleet_ota.h"
 #include "mesh_network.h"
+#include "mesh_topology.h"
+#include "mesh_optimizer.h"
+#include "channel_survey.h"
+#include "mesh_fastpath.h"
 #include "mqtt_handler.h"
+#include "cmd_latency.h"
+#include "boot_profile.h"
 #include "config_manager.h"
 #include "eth_manager.h"
+#include "wifi_manager.h"
 #include "omniapi_protocol.h"
 #include "esp_log.h"
 #include "esp_system.h"
@@ -19,6 +28,7 @@
 #include "esp_wifi.h"
 #include "esp_netif.h"
 #include "esp_mac.h"
+#include "esp_random.h"
 #include "cJSON.h"
 #include "nvs_flash.h"
 #include <string.h>
@@ -61,7 +71,7 @@ static void set_cors_headers(httpd_req_t *req)
 {
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type, Content-Range, X-Upload-Session");
 }
 
 // ============================================================================
@@ -85,6 +95,33 @@ static esp_err_t send_json_response(httpd_req_t *req, cJSON *json)
     return ret;
 }
 
+// ============================================================================
+// Helper: Path parameters (filled by the router, see api_router)
+// ============================================================================
+#define API_MAX_PARAMS      2
+#define API_PARAM_NAME_MAX  12
+#define API_PARAM_VALUE_MAX 32
+
+typedef struct {
+    int count;
+    struct {
+        char name[API_PARAM_NAME_MAX];
+        char value[API_PARAM_VALUE_MAX];
+    } p[API_MAX_PARAMS];
+} api_params_t;
+
+static const char* api_path_param(httpd_req_t *req, const char *name)
+{
+    const api_params_t *params = (const api_params_t *)req->user_ctx;
+    if (params == NULL) return NULL;
+    for (int i = 0; i < params->count; i++) {
+        if (strcmp(params->p[i].name, name) == 0) {
+            return params->p[i].value;
+        }
+    }
+    return NULL;
+}
+
 // ============================================================================
 // Helper: Parse JSON body
 // ============================================================================
@@ -112,6 +149,101 @@ static cJSON* parse_json_body(httpd_req_t *req)
     return json;
 }
 
+// ============================================================================
+// Helper: Resumable upload sessions (Content-Range)
+// ============================================================================
+#define UPLOAD_SESSION_ID_LEN       16
+#define UPLOAD_SESSION_IDLE_MS      (10 * 60 * 1000)    // Abandoned sessions can be replaced
+
+typedef struct {
+    bool active;
+    char id[UPLOAD_SESSION_ID_LEN + 1];
+    size_t total;
+    int64_t last_activity;
+} upload_session_t;
+
+static upload_session_t s_gateway_upload = {0};
+static upload_session_t s_node_upload = {0};
+
+// Parse "Content-Range: bytes <start>-<end>/<total>". Returns false if absent or malformed
+static bool parse_content_range(httpd_req_t *req, size_t *start, size_t *end, size_t *total)
+{
+    char value[64];
+    if (httpd_req_get_hdr_value_str(req, "Content-Range", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+
+    unsigned long s_start, s_end, s_total;
+    if (sscanf(value, "bytes %lu-%lu/%lu", &s_start, &s_end, &s_total) != 3 ||
+        s_start > s_end || s_end >= s_total) {
+        return false;
+    }
+
+    *start = s_start;
+    *end = s_end;
+    *total = s_total;
+    return true;
+}
+
+static void upload_session_open(upload_session_t *session, size_t total)
+{
+    for (int i = 0; i < UPLOAD_SESSION_ID_LEN; i += 8) {
+        snprintf(&session->id[i], 9, "%08lx", (unsigned long)esp_random());
+    }
+    session->total = total;
+    session->last_activity = esp_timer_get_time() / 1000;
+    session->active = true;
+}
+
+static bool upload_session_matches(httpd_req_t *req, const upload_session_t *session)
+{
+    char id[UPLOAD_SESSION_ID_LEN + 1];
+    if (!session->active ||
+        httpd_req_get_hdr_value_str(req, "X-Upload-Session", id, sizeof(id)) != ESP_OK) {
+        return false;
+    }
+    return strcmp(id, session->id) == 0;
+}
+
+// An idle session may be taken over by a new upload; an active one belongs to its client
+static bool upload_session_replaceable(httpd_req_t *req, const upload_session_t *session)
+{
+    if (!session->active) {
+        return false;
+    }
+    int64_t idle = (esp_timer_get_time() / 1000) - session->last_activity;
+    return idle > UPLOAD_SESSION_IDLE_MS || upload_session_matches(req, session);
+}
+
+// Reply with the offset the client must resume from
+static esp_err_t send_upload_offset(httpd_req_t *req, const upload_session_t *session,
+                                    size_t received, bool mismatch)
+{
+    if (mismatch) {
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", !mismatch);
+    cJSON_AddBoolToObject(json, "complete", false);
+    cJSON_AddStringToObject(json, "session", session->id);
+    cJSON_AddNumberToObject(json, "received", received);
+    cJSON_AddNumberToObject(json, "total", session->total);
+    return send_json_response(req, json);
+}
+
+static void add_upload_session_json(cJSON *parent, const upload_session_t *session, size_t received)
+{
+    if (!session->active) {
+        return;
+    }
+    cJSON *upload = cJSON_CreateObject();
+    cJSON_AddStringToObject(upload, "session", session->id);
+    cJSON_AddNumberToObject(upload, "received", received);
+    cJSON_AddNumberToObject(upload, "total", session->total);
+    cJSON_AddItemToObject(parent, "upload", upload);
+}
+
 // ============================================================================
 // GET /api/status - Gateway status
 // ============================================================================
@@ -137,6 +269,14 @@ static esp_err_t api_status_handler(httpd_req_t *req)
     return send_json_response(req, json);
 }
 
+// ============================================================================
+// GET /api/boot - Boot phase times and boot-to-controllable verdict
+// ============================================================================
+static esp_err_t api_boot_handler(httpd_req_t *req)
+{
+    return send_json_response(req, boot_profile_json());
+}
+
 // ============================================================================
 // GET /api/network - Network info
 // ============================================================================
@@ -190,6 +330,26 @@ static esp_err_t api_network_handler(httpd_req_t *req)
     cJSON_AddStringToObject(mqtt, "broker", mqtt_cfg->broker_uri);
     cJSON_AddBoolToObject(mqtt, "connected", mqtt_handler_is_connected());
     cJSON_AddBoolToObject(mqtt, "configured", mqtt_cfg->configured);
+
+    mqtt_link_stats_t link;
+    mqtt_handler_get_link_stats(&link);
+    cJSON_AddBoolToObject(mqtt, "tls", link.tls);
+    cJSON_AddNumberToObject(mqtt, "reconnects", link.reconnects);
+    cJSON_AddNumberToObject(mqtt, "last_reconnect_ms", link.last_reconnect_ms);
+    cJSON_AddNumberToObject(mqtt, "avg_reconnect_ms", link.avg_reconnect_ms);
+    cJSON_AddNumberToObject(mqtt, "max_reconnect_ms", link.max_reconnect_ms);
+    cJSON_AddNumberToObject(mqtt, "uplink_kicks", link.uplink_kicks);
+    if (link.tls) {
+        cJSON *hs = cJSON_CreateObject();
+        cJSON_AddNumberToObject(hs, "full", link.handshake.full);
+        cJSON_AddNumberToObject(hs, "resumed", link.handshake.resumed);
+        cJSON_AddNumberToObject(hs, "failed", link.handshake.failed);
+        cJSON_AddNumberToObject(hs, "full_avg_ms", link.handshake.full_avg_ms);
+        cJSON_AddNumberToObject(hs, "resumed_avg_ms", link.handshake.resumed_avg_ms);
+        cJSON_AddNumberToObject(hs, "last_ms", link.handshake.last_ms);
+        cJSON_AddBoolToObject(hs, "session_cached", link.handshake.session_cached);
+        cJSON_AddItemToObject(mqtt, "handshake", hs);
+    }
     cJSON_AddItemToObject(json, "mqtt", mqtt);
 
     return send_json_response(req, json);
@@ -210,7 +370,7 @@ static esp_err_t api_mesh_handler(httpd_req_t *req)
              mesh_id[4], mesh_id[5]);
 
     cJSON_AddStringToObject(json, "mesh_id", id_str);
-    cJSON_AddNumberToObject(json, "channel", CONFIG_MESH_CHANNEL);
+    cJSON_AddNumberToObject(json, "channel", channel_survey_get_channel());
     cJSON_AddNumberToObject(json, "layer", mesh_network_get_layer());
     cJSON_AddBoolToObject(json, "is_root", mesh_network_is_root());
     cJSON_AddBoolToObject(json, "started", mesh_network_is_started());
@@ -223,14 +383,146 @@ static esp_err_t api_mesh_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(stats_json, "rx_count", stats.rx_count);
     cJSON_AddNumberToObject(stats_json, "tx_errors", stats.tx_errors);
     cJSON_AddNumberToObject(stats_json, "rx_errors", stats.rx_errors);
+    cJSON_AddNumberToObject(stats_json, "rx_batch_max", stats.rx_batch_max);
+    cJSON_AddNumberToObject(stats_json, "rx_backlog_max", stats.rx_backlog_max);
+    cJSON *hb_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(hb_json, "sent", stats.hb_sent);
+    cJSON_AddNumberToObject(hb_json, "acked", stats.hb_acked);
+    cJSON_AddNumberToObject(hb_json, "last_ack_ms", stats.hb_last_ack_ms);
+    cJSON_AddItemToObject(stats_json, "heartbeat", hb_json);
     cJSON_AddItemToObject(json, "stats", stats_json);
 
     return send_json_response(req, json);
 }
 
+// ============================================================================
+// GET /api/mesh/channel - Channel survey results and last migration
+// ============================================================================
+static esp_err_t api_mesh_channel_handler(httpd_req_t *req)
+{
+    return send_json_response(req, channel_survey_json());
+}
+
+// ============================================================================
+// POST /api/mesh/channel/survey - Survey channels {"migrate": bool}
+// ============================================================================
+static esp_err_t api_mesh_channel_survey_handler(httpd_req_t *req)
+{
+    bool migrate = false;
+    cJSON *body = parse_json_body(req);
+    if (body) {
+        migrate = cJSON_IsTrue(cJSON_GetObjectItem(body, "migrate"));
+        cJSON_Delete(body);
+    }
+
+    esp_err_t ret = channel_survey_start(migrate);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", ret == ESP_OK);
+    if (ret == ESP_OK) {
+        webserver_log("Channel survey started%s", migrate ? " (migration allowed)" : "");
+    } else {
+        cJSON_AddStringToObject(json, "error", ret == ESP_ERR_INVALID_STATE ? "Survey already running"
+                                                                           : "Failed to start survey");
+    }
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// GET /api/mesh/fastpath - ESP-NOW fast path peers and command RTT per path
+// ============================================================================
+static esp_err_t api_mesh_fastpath_handler(httpd_req_t *req)
+{
+    return send_json_response(req, mesh_fastpath_json());
+}
+
+// ============================================================================
+// POST /api/mesh/fastpath - Enable/disable the fast path {"enabled": bool}
+// ============================================================================
+static esp_err_t api_mesh_fastpath_set_handler(httpd_req_t *req)
+{
+    cJSON *body = parse_json_body(req);
+    cJSON *enabled = body ? cJSON_GetObjectItem(body, "enabled") : NULL;
+    if (!cJSON_IsBool(enabled)) {
+        cJSON_Delete(body);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing enabled field");
+        return ESP_FAIL;
+    }
+
+    mesh_fastpath_set_enabled(cJSON_IsTrue(enabled));
+    webserver_log("ESP-NOW fast path %s", cJSON_IsTrue(enabled) ? "enabled" : "disabled");
+    cJSON_Delete(body);
+
+    return send_json_response(req, mesh_fastpath_json());
+}
+
+// ============================================================================
+// GET /api/mesh/optimizer - Topology optimizer status
+// ============================================================================
+static esp_err_t api_mesh_optimizer_handler(httpd_req_t *req)
+{
+    return send_json_response(req, mesh_optimizer_json());
+}
+
+// ============================================================================
+// GET /api/mesh/topology - Parent/child tree with link costs
+// ============================================================================
+static esp_err_t api_mesh_topology_handler(httpd_req_t *req)
+{
+    return send_json_response(req, mesh_topology_json());
+}
+
 // ============================================================================
 // GET /api/nodes - List all nodes
 // ============================================================================
+static cJSON* node_to_json(const node_info_t *info)
+{
+    cJSON *node = cJSON_CreateObject();
+
+    char mac_str[18];
+    snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
+             info->mac[0], info->mac[1], info->mac[2],
+             info->mac[3], info->mac[4], info->mac[5]);
+
+    cJSON_AddStringToObject(node, "mac", mac_str);
+    cJSON_AddStringToObject(node, "name", mac_str);  // Use MAC as name (no name field in node_info_t)
+    cJSON_AddNumberToObject(node, "device_type", info->device_type);
+
+    const char *type_str = "Unknown";
+    switch (info->device_type) {
+        case DEVICE_TYPE_RELAY: type_str = "Relay"; break;
+        case DEVICE_TYPE_LED_STRIP: type_str = "LED"; break;
+        case DEVICE_TYPE_DIMMER: type_str = "Dimmer"; break;
+        case DEVICE_TYPE_SENSOR: type_str = "Sensor"; break;
+    }
+    cJSON_AddStringToObject(node, "type_name", type_str);
+
+    cJSON_AddNumberToObject(node, "status", info->status);
+    cJSON_AddBoolToObject(node, "online", info->status == NODE_STATUS_ONLINE);
+    cJSON_AddNumberToObject(node, "rssi", info->rssi);
+    cJSON_AddNumberToObject(node, "mesh_layer", info->mesh_layer);
+    cJSON_AddStringToObject(node, "firmware", info->firmware_version);
+
+    uint32_t now = esp_timer_get_time() / 1000;
+    uint32_t last_seen_ago = (now > info->last_seen) ? (now - info->last_seen) / 1000 : 0;
+    cJSON_AddNumberToObject(node, "last_seen_sec", last_seen_ago);
+
+    if (info->boot_reported) {
+        static const char *const rejoin_names[] = { "scan", "fast", "fast_failed" };
+        cJSON *boot = cJSON_AddObjectToObject(node, "boot");
+        cJSON_AddStringToObject(boot, "rejoin",
+                                info->rejoin_mode <= REJOIN_FAST_FAILED ?
+                                rejoin_names[info->rejoin_mode] : "unknown");
+        cJSON_AddNumberToObject(boot, "connect_ms", info->boot_connect_ms);
+        if (info->boot_first_cmd_ms != 0) {
+            cJSON_AddNumberToObject(boot, "first_cmd_ms", info->boot_first_cmd_ms);
+        }
+    }
+
+    return node;
+}
+
 static esp_err_t api_nodes_handler(httpd_req_t *req)
 {
     cJSON *json = cJSON_CreateObject();
@@ -239,45 +531,67 @@ static esp_err_t api_nodes_handler(httpd_req_t *req)
     int count;
     node_info_t *nodes = node_manager_get_all(&count);
 
-    for (int i = 0; i < count; i++) {
-        cJSON *node = cJSON_CreateObject();
+    // Boot-to-connected summary, split by how the nodes rejoined
+    uint32_t fast_sum = 0, scan_sum = 0;
+    int fast_count = 0, scan_count = 0;
 
-        char mac_str[18];
-        snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
-                 nodes[i].mac[0], nodes[i].mac[1], nodes[i].mac[2],
-                 nodes[i].mac[3], nodes[i].mac[4], nodes[i].mac[5]);
-
-        cJSON_AddStringToObject(node, "mac", mac_str);
-        cJSON_AddStringToObject(node, "name", mac_str);  // Use MAC as name (no name field in node_info_t)
-        cJSON_AddNumberToObject(node, "device_type", nodes[i].device_type);
-
-        const char *type_str = "Unknown";
-        switch (nodes[i].device_type) {
-            case DEVICE_TYPE_RELAY: type_str = "Relay"; break;
-            case DEVICE_TYPE_LED_STRIP: type_str = "LED"; break;
-            case DEVICE_TYPE_SENSOR: type_str = "Sensor"; break;
+    for (int i = 0; i < count; i++) {
+        cJSON_AddItemToArray(nodes_array, node_to_json(&nodes[i]));
+        if (!nodes[i].boot_reported || nodes[i].boot_connect_ms == 0) continue;
+        if (nodes[i].rejoin_mode == REJOIN_FAST) {
+            fast_sum += nodes[i].boot_connect_ms;
+            fast_count++;
+        } else {
+            scan_sum += nodes[i].boot_connect_ms;
+            scan_count++;
         }
-        cJSON_AddStringToObject(node, "type_name", type_str);
-
-        cJSON_AddNumberToObject(node, "status", nodes[i].status);
-        cJSON_AddBoolToObject(node, "online", nodes[i].status == NODE_STATUS_ONLINE);
-        cJSON_AddNumberToObject(node, "rssi", nodes[i].rssi);
-        cJSON_AddNumberToObject(node, "mesh_layer", nodes[i].mesh_layer);
-        cJSON_AddStringToObject(node, "firmware", nodes[i].firmware_version);
-
-        uint32_t now = esp_timer_get_time() / 1000;
-        uint32_t last_seen_ago = (now > nodes[i].last_seen) ? (now - nodes[i].last_seen) / 1000 : 0;
-        cJSON_AddNumberToObject(node, "last_seen_sec", last_seen_ago);
-
-        cJSON_AddItemToArray(nodes_array, node);
     }
 
     cJSON_AddItemToObject(json, "nodes", nodes_array);
     cJSON_AddNumberToObject(json, "count", count);
 
+    cJSON *boot = cJSON_AddObjectToObject(json, "boot");
+    cJSON_AddNumberToObject(boot, "fast_nodes", fast_count);
+    cJSON_AddNumberToObject(boot, "fast_avg_connect_ms", fast_count ? fast_sum / fast_count : 0);
+    cJSON_AddNumberToObject(boot, "scan_nodes", scan_count);
+    cJSON_AddNumberToObject(boot, "scan_avg_connect_ms", scan_count ? scan_sum / scan_count : 0);
+
+    // Power-restore storm: announces handled vs skipped on an unchanged digest,
+    // and when the last node came back (gateway uptime)
+    uint32_t announces, digest_matches, last_online_ms;
+    node_manager_get_announce_stats(&announces, &digest_matches, &last_online_ms);
+    cJSON_AddNumberToObject(boot, "announces", announces);
+    cJSON_AddNumberToObject(boot, "digest_matches", digest_matches);
+    cJSON_AddNumberToObject(boot, "last_online_ms", last_online_ms);
+
     return send_json_response(req, json);
 }
 
+// ============================================================================
+// GET /api/nodes/{mac} - Single node
+// ============================================================================
+static esp_err_t api_node_get_handler(httpd_req_t *req)
+{
+    const char *mac_str = api_path_param(req, "mac");
+    uint8_t mac[6];
+    if (mac_str == NULL ||
+        sscanf(mac_str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+        set_cors_headers(req);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid MAC");
+        return ESP_OK;
+    }
+
+    node_info_t *info = node_manager_get_node(mac);
+    if (info == NULL) {
+        set_cors_headers(req);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Node not found");
+        return ESP_OK;
+    }
+
+    return send_json_response(req, node_to_json(info));
+}
+
 // ============================================================================
 // POST /api/scan - Start node scan
 // ============================================================================
@@ -507,6 +821,122 @@ static esp_err_t api_command_handler(httpd_req_t *req)
         payload->action = LED_ACTION_OFF;
         ret = mesh_network_send(mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_led_cmd_t)));
     }
+    else if (strcmp(cmd, "dim") == 0) {
+        // "level": 0-255 for every channel, or an array with one per channel
+        OMNIAPI_INIT_HEADER(&msg.header, MSG_DIMMER_CMD, 0, sizeof(payload_dimmer_cmd_t));
+        payload_dimmer_cmd_t *payload = (payload_dimmer_cmd_t *)msg.payload;
+        memset(payload, 0, sizeof(payload_dimmer_cmd_t));
+
+        cJSON *level = cJSON_GetObjectItem(body, "level");
+        cJSON *transition = cJSON_GetObjectItem(body, "transition_ms");
+        cJSON *curve = cJSON_GetObjectItem(body, "curve");
+
+        if (cJSON_IsNumber(level)) {
+            payload->channel_mask = 0xFF;
+            memset(payload->level, (uint8_t)level->valueint, DIMMER_MAX_CHANNELS);
+        } else if (cJSON_IsArray(level)) {
+            int count = cJSON_GetArraySize(level);
+            for (int i = 0; i < count && i < DIMMER_MAX_CHANNELS; i++) {
+                cJSON *item = cJSON_GetArrayItem(level, i);
+                if (cJSON_IsNumber(item)) {
+                    payload->channel_mask |= (uint8_t)(1 << i);
+                    payload->level[i] = (uint8_t)item->valueint;
+                }
+            }
+        }
+        uint16_t transition_ms = cJSON_IsNumber(transition) ? (uint16_t)transition->valueint : 0;
+        payload->transition_ms = transition_ms;
+        payload->curve = (cJSON_IsString(curve) && strcmp(curve->valuestring, "linear") == 0)
+                         ? DIMMER_CURVE_LINEAR : DIMMER_CURVE_PERCEPTUAL;
+
+        if (payload->channel_mask != 0) {
+            ret = mesh_network_send(mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_dimmer_cmd_t)));
+        }
+    }
+    else if (strcmp(cmd, "led_palette") == 0) {
+        // "colors": [[r,g,b],...] or "stops": [[pos,r,g,b],...], up to 16 entries;
+        // neither selects palette "id" from the node's bank
+        payload_led_palette_t *payload = (payload_led_palette_t *)msg.payload;
+        memset(payload, 0, sizeof(payload_led_palette_t));
+
+        cJSON *id = cJSON_GetObjectItem(body, "id");
+        cJSON *colors = cJSON_GetObjectItem(body, "colors");
+        cJSON *stops = cJSON_GetObjectItem(body, "stops");
+        cJSON *store = cJSON_GetObjectItem(body, "store");
+        cJSON *select = cJSON_GetObjectItem(body, "select");
+
+        payload->palette_id = cJSON_IsNumber(id) ? (uint8_t)id->valueint : 0;
+        payload->flags = LED_PALETTE_FLAG_STORE | LED_PALETTE_FLAG_SELECT;
+        if (cJSON_IsFalse(store)) payload->flags &= ~LED_PALETTE_FLAG_STORE;
+        if (cJSON_IsFalse(select)) payload->flags &= ~LED_PALETTE_FLAG_SELECT;
+
+        bool gradient = cJSON_IsArray(stops);
+        cJSON *entries = gradient ? stops : colors;
+        int entry_len = gradient ? 4 : 3;
+        int count = cJSON_IsArray(entries) ? cJSON_GetArraySize(entries) : 0;
+        bool valid = payload->palette_id < LED_PALETTE_BANK_SLOTS && count <= LED_PALETTE_ENTRIES_MAX;
+
+        for (int i = 0; valid && i < count; i++) {
+            cJSON *entry = cJSON_GetArrayItem(entries, i);
+            if (!cJSON_IsArray(entry) || cJSON_GetArraySize(entry) != entry_len) {
+                valid = false;
+                break;
+            }
+            for (int j = 0; j < entry_len; j++) {
+                cJSON *value = cJSON_GetArrayItem(entry, j);
+                payload->data[1 + i * entry_len + j] = cJSON_IsNumber(value) ? (uint8_t)value->valueint : 0;
+            }
+        }
+
+        size_t data_len = 0;
+        if (count > 0) {
+            payload->data[0] = (uint8_t)count | (gradient ? LED_PALETTE_HDR_GRADIENT : 0);
+            data_len = 1 + count * entry_len;
+        }
+
+        if (valid) {
+            size_t payload_len = offsetof(payload_led_palette_t, data) + data_len;
+            OMNIAPI_INIT_HEADER(&msg.header, MSG_LED_PALETTE, 0, payload_len);
+            ret = mesh_network_send(mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(payload_len));
+        }
+    }
+    else if (strcmp(cmd, "led_script") == 0) {
+        // "code": compiled program as a hex string; none runs script "id"
+        // from the node's bank
+        payload_led_script_t *payload = (payload_led_script_t *)msg.payload;
+        memset(payload, 0, sizeof(payload_led_script_t));
+
+        cJSON *id = cJSON_GetObjectItem(body, "id");
+        cJSON *code = cJSON_GetObjectItem(body, "code");
+        cJSON *store = cJSON_GetObjectItem(body, "store");
+        cJSON *select = cJSON_GetObjectItem(body, "select");
+
+        payload->script_id = cJSON_IsNumber(id) ? (uint8_t)id->valueint : 0;
+        payload->flags = LED_SCRIPT_FLAG_STORE | LED_SCRIPT_FLAG_SELECT;
+        if (cJSON_IsFalse(store)) payload->flags &= ~LED_SCRIPT_FLAG_STORE;
+        if (cJSON_IsFalse(select)) payload->flags &= ~LED_SCRIPT_FLAG_SELECT;
+
+        const char *hex = cJSON_IsString(code) ? code->valuestring : "";
+        size_t hex_len = strlen(hex);
+        bool valid = payload->script_id < LED_SCRIPT_BANK_SLOTS &&
+                     hex_len % 2 == 0 && hex_len / 2 <= LED_SCRIPT_DATA_MAX;
+
+        size_t data_len = 0;
+        while (valid && data_len < hex_len / 2) {
+            unsigned int byte;
+            if (sscanf(&hex[data_len * 2], "%2x", &byte) != 1) {
+                valid = false;
+                break;
+            }
+            payload->data[data_len++] = (uint8_t)byte;
+        }
+
+        if (valid) {
+            size_t payload_len = offsetof(payload_led_script_t, data) + data_len;
+            OMNIAPI_INIT_HEADER(&msg.header, MSG_LED_SCRIPT, 0, payload_len);
+            ret = mesh_network_send(mac, (uint8_t *)&msg, OMNIAPI_MSG_SIZE(payload_len));
+        }
+    }
     else if (strcmp(cmd, "identify") == 0) {
         ret = commissioning_identify_node(mac);
     }
@@ -525,16 +955,46 @@ static esp_err_t api_command_handler(httpd_req_t *req)
     return send_json_response(req, response);
 }
 
+// ============================================================================
+// GET /api/latency - MQTT command latency percentiles per context
+// ============================================================================
+static esp_err_t api_latency_handler(httpd_req_t *req)
+{
+    return send_json_response(req, cmd_latency_json());
+}
+
+// ============================================================================
+// POST /api/latency/reset - Start a new measurement window
+// ============================================================================
+static esp_err_t api_latency_reset_handler(httpd_req_t *req)
+{
+    cmd_latency_reset();
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", true);
+    return send_json_response(req, json);
+}
+
 // ============================================================================
 // GET /api/logs - Get log entries
+// ?previous=1 returns the records saved after the last crash
 // ============================================================================
 static esp_err_t api_logs_handler(httpd_req_t *req)
 {
+    bool previous = false;
+    char query[32];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "previous", value, sizeof(value)) == ESP_OK) {
+        previous = (strcmp(value, "1") == 0 || strcmp(value, "true") == 0);
+    }
+
     cJSON *json = cJSON_CreateObject();
     cJSON *logs_array = cJSON_CreateArray();
 
     log_entry_t entries[50];
-    int count = webserver_get_logs(entries, 50);
+    int count = previous ? log_ring_read_postmortem(entries, 50)
+                         : webserver_get_logs(entries, 50);
 
     for (int i = 0; i < count; i++) {
         cJSON *entry = cJSON_CreateObject();
@@ -546,11 +1006,65 @@ static esp_err_t api_logs_handler(httpd_req_t *req)
     cJSON_AddItemToObject(json, "logs", logs_array);
     cJSON_AddNumberToObject(json, "count", count);
 
+    // Capture cost on the caller's thread and streaming counters
+    log_ring_stats_t ring_stats;
+    uint32_t streamed, skipped;
+    log_ring_get_stats(&ring_stats);
+    webserver_get_log_stream_stats(&streamed, &skipped);
+    cJSON *stats = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stats, "calls", ring_stats.calls);
+    cJSON_AddNumberToObject(stats, "truncated", ring_stats.truncated);
+    cJSON_AddNumberToObject(stats, "avg_cycles", ring_stats.avg_cycles);
+    cJSON_AddNumberToObject(stats, "max_cycles", ring_stats.max_cycles);
+    cJSON_AddNumberToObject(stats, "avg_us", (double)ring_stats.avg_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    cJSON_AddNumberToObject(stats, "streamed", streamed);
+    cJSON_AddNumberToObject(stats, "skipped", skipped);
+    cJSON_AddItemToObject(json, "stats", stats);
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// GET /api/connections - HTTP/WebSocket socket usage
+// ============================================================================
+static esp_err_t api_connections_handler(httpd_req_t *req)
+{
+    webserver_conn_stats_t stats;
+    webserver_conn_info_t conns[WEBSERVER_MAX_SOCKETS];
+    int count = webserver_get_conn_stats(&stats, conns, WEBSERVER_MAX_SOCKETS);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "open", stats.open);
+    cJSON_AddNumberToObject(json, "websockets", stats.websockets);
+    cJSON_AddNumberToObject(json, "max_sockets", stats.max_sockets);
+    cJSON_AddNumberToObject(json, "ws_budget", stats.ws_budget);
+    cJSON_AddNumberToObject(json, "accepted", stats.accepted);
+    cJSON_AddNumberToObject(json, "requests", stats.requests);
+    cJSON_AddNumberToObject(json, "reused", stats.reused);
+    cJSON_AddNumberToObject(json, "idle_closed", stats.idle_closed);
+    cJSON_AddNumberToObject(json, "evicted", stats.evicted);
+    cJSON_AddNumberToObject(json, "ws_rejected", stats.ws_rejected);
+    cJSON_AddNumberToObject(json, "avg_lifetime_ms", stats.avg_lifetime_ms);
+
+    cJSON *sockets = cJSON_CreateArray();
+    for (int i = 0; i < count; i++) {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "fd", conns[i].fd);
+        cJSON_AddStringToObject(entry, "type", conns[i].websocket ? "ws" : "http");
+        cJSON_AddBoolToObject(entry, "busy", conns[i].busy);
+        cJSON_AddNumberToObject(entry, "requests", conns[i].requests);
+        cJSON_AddNumberToObject(entry, "age_ms", conns[i].age_ms);
+        cJSON_AddNumberToObject(entry, "idle_ms", conns[i].idle_ms);
+        cJSON_AddItemToArray(sockets, entry);
+    }
+    cJSON_AddItemToObject(json, "sockets", sockets);
+
     return send_json_response(req, json);
 }
 
 // ============================================================================
 // POST /api/ota/upload - Upload firmware for gateway OTA
+// Optional Content-Range: bytes S-E/T + X-Upload-Session to upload in resumable parts
 // ============================================================================
 static esp_err_t api_ota_upload_handler(httpd_req_t *req)
 {
@@ -566,29 +1080,65 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // Maximum firmware size check (2MB)
-    if (req->content_len > 2 * 1024 * 1024) {
-        ESP_LOGE(TAG, "Firmware too large: %d bytes", req->content_len);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware too large (max 2MB)");
+    size_t range_start = 0, range_end = 0, total_size = req->content_len;
+    bool ranged = parse_content_range(req, &range_start, &range_end, &total_size);
+    if (ranged && range_end - range_start + 1 != req->content_len) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content-Range does not match body");
         return ESP_FAIL;
     }
 
-    // Check if OTA already in progress
-    if (ota_gateway_is_active()) {
-        ESP_LOGE(TAG, "OTA already in progress");
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "OTA already in progress");
+    // Maximum firmware size check (2MB)
+    if (total_size > 2 * 1024 * 1024) {
+        ESP_LOGE(TAG, "Firmware too large: %u bytes", (unsigned)total_size);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware too large (max 2MB)");
         return ESP_FAIL;
     }
 
-    // Start OTA
-    esp_err_t ret = ota_gateway_begin(req->content_len);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start OTA: %s", esp_err_to_name(ret));
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA");
-        return ESP_FAIL;
-    }
+    esp_err_t ret;
+    if (ranged && range_start > 0) {
+        // Continuation of an existing session
+        if (!upload_session_matches(req, &s_gateway_upload) || !ota_gateway_is_active()) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown upload session");
+            return ESP_FAIL;
+        }
+        uint32_t written;
+        ota_gateway_get_progress(&written, NULL, NULL);
+        if (range_start != written || total_size != s_gateway_upload.total) {
+            return send_upload_offset(req, &s_gateway_upload, written, true);
+        }
+    } else {
+        // Check if OTA already in progress
+        if (ota_gateway_is_active()) {
+            if (!upload_session_replaceable(req, &s_gateway_upload)) {
+                ESP_LOGE(TAG, "OTA already in progress");
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "OTA already in progress");
+                return ESP_FAIL;
+            }
+            ESP_LOGW(TAG, "Replacing abandoned upload session %s", s_gateway_upload.id);
+            ota_gateway_abort();
+        }
+        s_gateway_upload.active = false;
+
+        // Node transfers read their image from the same inactive partition
+        if (fleet_ota_is_active() || node_ota_active_sessions() > 0) {
+            ESP_LOGE(TAG, "Node OTA in progress, gateway OTA refused");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Node OTA in progress");
+            return ESP_FAIL;
+        }
+
+        // Start OTA
+        ret = ota_gateway_begin(total_size);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start OTA: %s", esp_err_to_name(ret));
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start OTA");
+            return ESP_FAIL;
+        }
+        if (ranged) {
+            upload_session_open(&s_gateway_upload, total_size);
+        }
 
-    webserver_log("Gateway OTA upload started (%d bytes)", req->content_len);
+        webserver_log("Gateway OTA upload started (%u bytes)", (unsigned)total_size);
+    }
 
     // Read and write firmware data in chunks
     static uint8_t ota_buf[4096];
@@ -605,7 +1155,14 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
                 continue;
             }
             ESP_LOGE(TAG, "Error receiving data: %d", received);
-            ota_gateway_abort();
+            if (s_gateway_upload.active) {
+                // Keep what was written; client resumes from /api/ota/status offset
+                s_gateway_upload.last_activity = esp_timer_get_time() / 1000;
+                webserver_log("Gateway OTA upload interrupted, session %s resumable",
+                              s_gateway_upload.id);
+            } else {
+                ota_gateway_abort();
+            }
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Error receiving data");
             return ESP_FAIL;
         }
@@ -614,6 +1171,7 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
         ret = ota_gateway_write(ota_buf, received);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to write OTA data: %s", esp_err_to_name(ret));
+            s_gateway_upload.active = false;
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write firmware");
             return ESP_FAIL;
         }
@@ -631,6 +1189,15 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
 
     ESP_LOGI(TAG, "OTA upload complete: %d bytes received", received_total);
 
+    uint32_t written;
+    ota_gateway_get_progress(&written, NULL, NULL);
+    if (s_gateway_upload.active && written < s_gateway_upload.total) {
+        // More parts to come
+        s_gateway_upload.last_activity = esp_timer_get_time() / 1000;
+        return send_upload_offset(req, &s_gateway_upload, written, false);
+    }
+    s_gateway_upload.active = false;
+
     // Finalize OTA
     ret = ota_gateway_end();
     if (ret != ESP_OK) {
@@ -646,8 +1213,9 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
     // Send success response
     cJSON *json = cJSON_CreateObject();
     cJSON_AddBoolToObject(json, "success", true);
+    cJSON_AddBoolToObject(json, "complete", true);
     cJSON_AddStringToObject(json, "message", "Firmware uploaded successfully. Rebooting in 3 seconds...");
-    cJSON_AddNumberToObject(json, "bytes_written", received_total);
+    cJSON_AddNumberToObject(json, "bytes_written", written);
 
     esp_err_t resp_ret = send_json_response(req, json);
 
@@ -659,85 +1227,88 @@ static esp_err_t api_ota_upload_handler(httpd_req_t *req)
 }
 
 // ============================================================================
-// POST /api/node/ota - Upload firmware for specific node OTA (async flash-based)
-// Query params: mac=XX:XX:XX:XX:XX:XX
-// Firmware is buffered to flash, then sent to node in background task
+// Helper: Receive node firmware into the staging partition
+// Handles Content-Range continuation like the gateway upload. target_mac NULL
+// stages the image for a fleet rollout. Returns true once the whole image is
+// staged; otherwise a response was already sent and *resp_ret is the result.
 // ============================================================================
-static esp_err_t api_node_ota_handler(httpd_req_t *req)
+static bool receive_staged_upload(httpd_req_t *req, const uint8_t *target_mac,
+                                  size_t *staged_out, esp_err_t *resp_ret)
 {
-    set_cors_headers(req);
-
-    ESP_LOGI(TAG, "=== NODE OTA UPLOAD REQUEST (ASYNC) ===");
-    ESP_LOGI(TAG, "Content-Length: %d bytes", req->content_len);
-
-    // Parse MAC from query string
-    char query[64] = {0};
-    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
-        ESP_LOGE(TAG, "Missing query parameters");
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing mac parameter");
-        return ESP_FAIL;
-    }
-
-    char mac_str[32] = {0};
-    if (httpd_query_key_value(query, "mac", mac_str, sizeof(mac_str)) != ESP_OK) {
-        ESP_LOGE(TAG, "Missing mac parameter");
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing mac parameter");
-        return ESP_FAIL;
-    }
-
-    // URL decode the MAC (handles %3A -> :)
-    url_decode(mac_str);
-    ESP_LOGI(TAG, "MAC after decode: %s", mac_str);
-
-    // Parse MAC address
-    uint8_t target_mac[6];
-    int vals[6];
-    if (sscanf(mac_str, "%02x:%02x:%02x:%02x:%02x:%02x",
-               &vals[0], &vals[1], &vals[2], &vals[3], &vals[4], &vals[5]) != 6) {
-        // Try alternate format without colons
-        if (sscanf(mac_str, "%02x%02x%02x%02x%02x%02x",
-                   &vals[0], &vals[1], &vals[2], &vals[3], &vals[4], &vals[5]) != 6) {
-            ESP_LOGE(TAG, "Invalid MAC format: %s", mac_str);
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid MAC format");
-            return ESP_FAIL;
-        }
-    }
-    for (int i = 0; i < 6; i++) {
-        target_mac[i] = (uint8_t)vals[i];
-    }
+    static const uint8_t no_target[6] = {0};
+    const uint8_t *session_mac = target_mac ? target_mac : no_target;
 
-    ESP_LOGI(TAG, "Target node: " MACSTR, MAC2STR(target_mac));
+    *resp_ret = ESP_FAIL;
 
     // Check content length
     if (req->content_len <= 0) {
         ESP_LOGE(TAG, "No content in request");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No firmware data");
-        return ESP_FAIL;
+        return false;
     }
 
-    // Maximum firmware size check (1.5MB for nodes)
-    if (req->content_len > 1536 * 1024) {
-        ESP_LOGE(TAG, "Firmware too large: %d bytes", req->content_len);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware too large (max 1.5MB)");
-        return ESP_FAIL;
+    size_t range_start = 0, range_end = 0, total_size = req->content_len;
+    bool ranged = parse_content_range(req, &range_start, &range_end, &total_size);
+    if (ranged && range_end - range_start + 1 != req->content_len) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content-Range does not match body");
+        return false;
     }
 
-    // Check if node OTA already in progress
-    if (node_ota_is_active() || node_ota_flash_staging_active()) {
-        ESP_LOGE(TAG, "Node OTA already in progress");
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Node OTA already in progress");
-        return ESP_FAIL;
-    }
+    // Maximum firmware size check (1.5MB for nodes)
+    if (total_size > 1536 * 1024) {
+        ESP_LOGE(TAG, "Firmware too large: %u bytes", (unsigned)total_size);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Firmware too large (max 1.5MB)");
+        return false;
+    }
+
+    esp_err_t ret;
+    if (ranged && range_start > 0) {
+        // Continuation of an existing session (appends to the staged partition)
+        uint8_t staged_mac[6];
+        size_t staged = 0;
+        if (!upload_session_matches(req, &s_node_upload) ||
+            node_ota_flash_get_progress(staged_mac, &staged, NULL) != ESP_OK ||
+            memcmp(staged_mac, session_mac, 6) != 0) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown upload session");
+            return false;
+        }
+        if (range_start != staged || total_size != s_node_upload.total) {
+            *resp_ret = send_upload_offset(req, &s_node_upload, staged, true);
+            return false;
+        }
+    } else {
+        // An abandoned upload must not block the staging area forever
+        if (node_ota_flash_staging_active() && upload_session_replaceable(req, &s_node_upload)) {
+            ESP_LOGW(TAG, "Replacing abandoned upload session %s", s_node_upload.id);
+            node_ota_flash_cancel();
+        }
+        s_node_upload.active = false;
+
+        // The staging partition is shared: no new image while any transfer reads it
+        if (node_ota_is_active() || node_ota_flash_staging_active() ||
+            node_ota_active_sessions() > 0 || fleet_ota_is_active()) {
+            ESP_LOGE(TAG, "Node OTA already in progress");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Node OTA already in progress");
+            return false;
+        }
 
-    webserver_log("Node OTA upload started for " MACSTR " (%d bytes)",
-                  MAC2STR(target_mac), req->content_len);
+        if (target_mac != NULL) {
+            webserver_log("Node OTA upload started for " MACSTR " (%u bytes)",
+                          MAC2STR(target_mac), (unsigned)total_size);
+        } else {
+            webserver_log("Fleet OTA image upload started (%u bytes)", (unsigned)total_size);
+        }
 
-    // Start flash staging (writes to gateway's inactive OTA partition)
-    esp_err_t ret = node_ota_flash_begin(target_mac, req->content_len);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to begin flash staging: %s", esp_err_to_name(ret));
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to prepare flash storage");
-        return ESP_FAIL;
+        // Start flash staging (writes to gateway's inactive OTA partition)
+        ret = node_ota_flash_begin(target_mac, total_size);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to begin flash staging: %s", esp_err_to_name(ret));
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to prepare flash storage");
+            return false;
+        }
+        if (ranged) {
+            upload_session_open(&s_node_upload, total_size);
+        }
     }
 
     // Receive firmware and write to flash
@@ -746,7 +1317,7 @@ static esp_err_t api_node_ota_handler(httpd_req_t *req)
     if (upload_buf == NULL) {
         ESP_LOGE(TAG, "Failed to allocate upload buffer");
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
-        return ESP_FAIL;
+        return false;
     }
 
     int remaining = req->content_len;
@@ -762,8 +1333,15 @@ static esp_err_t api_node_ota_handler(httpd_req_t *req)
             }
             ESP_LOGE(TAG, "Error receiving data: %d", received);
             free(upload_buf);
+            if (s_node_upload.active) {
+                // Keep what was staged; client resumes from /api/node/ota/status offset
+                s_node_upload.last_activity = esp_timer_get_time() / 1000;
+                webserver_log("Node OTA upload interrupted, session %s resumable", s_node_upload.id);
+            } else {
+                node_ota_flash_cancel();
+            }
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Error receiving data");
-            return ESP_FAIL;
+            return false;
         }
 
         // Write to flash
@@ -771,8 +1349,10 @@ static esp_err_t api_node_ota_handler(httpd_req_t *req)
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to write to flash: %s", esp_err_to_name(ret));
             free(upload_buf);
+            node_ota_flash_cancel();
+            s_node_upload.active = false;
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Flash write failed");
-            return ESP_FAIL;
+            return false;
         }
 
         remaining -= received;
@@ -790,6 +1370,76 @@ static esp_err_t api_node_ota_handler(httpd_req_t *req)
 
     ESP_LOGI(TAG, "Upload complete: %d bytes received", received_total);
 
+    size_t staged = 0;
+    node_ota_flash_get_progress(NULL, &staged, NULL);
+    if (s_node_upload.active && staged < s_node_upload.total) {
+        // More parts to come
+        s_node_upload.last_activity = esp_timer_get_time() / 1000;
+        *resp_ret = send_upload_offset(req, &s_node_upload, staged, false);
+        return false;
+    }
+    s_node_upload.active = false;
+
+    *staged_out = staged;
+    return true;
+}
+
+// ============================================================================
+// POST /api/node/ota - Upload firmware for specific node OTA (async flash-based)
+// Query params: mac=XX:XX:XX:XX:XX:XX
+// Firmware is buffered to flash, then sent to node in background task
+// ============================================================================
+static esp_err_t api_node_ota_handler(httpd_req_t *req)
+{
+    set_cors_headers(req);
+
+    ESP_LOGI(TAG, "=== NODE OTA UPLOAD REQUEST (ASYNC) ===");
+    ESP_LOGI(TAG, "Content-Length: %d bytes", req->content_len);
+
+    // Parse MAC from query string
+    char query[64] = {0};
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        ESP_LOGE(TAG, "Missing query parameters");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing mac parameter");
+        return ESP_FAIL;
+    }
+
+    char mac_str[32] = {0};
+    if (httpd_query_key_value(query, "mac", mac_str, sizeof(mac_str)) != ESP_OK) {
+        ESP_LOGE(TAG, "Missing mac parameter");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing mac parameter");
+        return ESP_FAIL;
+    }
+
+    // URL decode the MAC (handles %3A -> :)
+    url_decode(mac_str);
+    ESP_LOGI(TAG, "MAC after decode: %s", mac_str);
+
+    // Parse MAC address
+    uint8_t target_mac[6];
+    int vals[6];
+    if (sscanf(mac_str, "%02x:%02x:%02x:%02x:%02x:%02x",
+               &vals[0], &vals[1], &vals[2], &vals[3], &vals[4], &vals[5]) != 6) {
+        // Try alternate format without colons
+        if (sscanf(mac_str, "%02x%02x%02x%02x%02x%02x",
+                   &vals[0], &vals[1], &vals[2], &vals[3], &vals[4], &vals[5]) != 6) {
+            ESP_LOGE(TAG, "Invalid MAC format: %s", mac_str);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid MAC format");
+            return ESP_FAIL;
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        target_mac[i] = (uint8_t)vals[i];
+    }
+
+    ESP_LOGI(TAG, "Target node: " MACSTR, MAC2STR(target_mac));
+
+    size_t staged = 0;
+    esp_err_t ret;
+    if (!receive_staged_upload(req, target_mac, &staged, &ret)) {
+        return ret;
+    }
+
     // Finish staging and start background OTA task
     ret = node_ota_flash_finish();
     if (ret != ESP_OK) {
@@ -804,8 +1454,9 @@ static esp_err_t api_node_ota_handler(httpd_req_t *req)
     cJSON *json = cJSON_CreateObject();
     cJSON_AddBoolToObject(json, "success", true);
     cJSON_AddStringToObject(json, "message", "Firmware uploaded. OTA transfer started in background.");
+    cJSON_AddBoolToObject(json, "complete", true);
     cJSON_AddStringToObject(json, "target_mac", mac_str);
-    cJSON_AddNumberToObject(json, "firmware_size", received_total);
+    cJSON_AddNumberToObject(json, "firmware_size", staged);
     cJSON_AddStringToObject(json, "note", "Monitor progress via /api/node/ota/status or MQTT");
 
     return send_json_response(req, json);
@@ -849,6 +1500,10 @@ static esp_err_t api_node_ota_status_handler(httpd_req_t *req)
     }
     cJSON_AddStringToObject(json, "state_desc", state_desc);
 
+    size_t staged = 0;
+    node_ota_flash_get_progress(NULL, &staged, NULL);
+    add_upload_session_json(json, &s_node_upload, staged);
+
     return send_json_response(req, json);
 }
 
@@ -873,6 +1528,162 @@ static esp_err_t api_node_ota_abort_handler(httpd_req_t *req)
     return send_json_response(req, json);
 }
 
+// ============================================================================
+// POST /api/fleet/ota/upload - Stage node firmware for a fleet rollout
+// Same resumable Content-Range protocol as /api/node/ota, no target node
+// ============================================================================
+static esp_err_t api_fleet_ota_upload_handler(httpd_req_t *req)
+{
+    set_cors_headers(req);
+
+    ESP_LOGI(TAG, "=== FLEET OTA UPLOAD REQUEST ===");
+    ESP_LOGI(TAG, "Content-Length: %d bytes", req->content_len);
+
+    size_t staged = 0;
+    esp_err_t ret;
+    if (!receive_staged_upload(req, NULL, &staged, &ret)) {
+        return ret;
+    }
+
+    ret = node_ota_flash_finish();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to finish staging: %s", esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to stage firmware");
+        return ESP_FAIL;
+    }
+
+    webserver_log("Fleet OTA image staged (%u bytes)", (unsigned)staged);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", true);
+    cJSON_AddBoolToObject(json, "complete", true);
+    cJSON_AddNumberToObject(json, "firmware_size", staged);
+    cJSON_AddStringToObject(json, "note", "Start the rollout via /api/fleet/ota/start");
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// POST /api/fleet/ota/start - Start rollout of the staged image
+// Body: {"version":"x.y.z", "canary":2, "max_concurrency":4,
+//        "pause_after_canary":true, "device_type":1, "targets":["XX:..."]}
+// ============================================================================
+static esp_err_t api_fleet_ota_start_handler(httpd_req_t *req)
+{
+    cJSON *body = parse_json_body(req);
+    if (body == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *version = cJSON_GetObjectItem(body, "version");
+    if (!cJSON_IsString(version)) {
+        cJSON_Delete(body);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing version");
+        return ESP_FAIL;
+    }
+
+    fleet_ota_config_t config = {0};
+    strncpy(config.version, version->valuestring, sizeof(config.version) - 1);
+
+    cJSON *item = cJSON_GetObjectItem(body, "device_type");
+    if (cJSON_IsNumber(item)) config.device_type = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(body, "canary");
+    if (cJSON_IsNumber(item)) config.canary_count = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(body, "max_concurrency");
+    if (cJSON_IsNumber(item)) config.max_concurrency = (uint8_t)item->valueint;
+    item = cJSON_GetObjectItem(body, "pause_after_canary");
+    if (cJSON_IsBool(item)) config.pause_after_canary = cJSON_IsTrue(item);
+
+    static uint8_t targets[FLEET_OTA_MAX_TARGETS][6];
+    uint8_t target_count = 0;
+    cJSON *targets_json = cJSON_GetObjectItem(body, "targets");
+    if (cJSON_IsArray(targets_json)) {
+        cJSON *mac_item;
+        cJSON_ArrayForEach(mac_item, targets_json) {
+            int vals[6];
+            if (target_count >= FLEET_OTA_MAX_TARGETS || !cJSON_IsString(mac_item) ||
+                sscanf(mac_item->valuestring, "%02x:%02x:%02x:%02x:%02x:%02x",
+                       &vals[0], &vals[1], &vals[2], &vals[3], &vals[4], &vals[5]) != 6) {
+                continue;
+            }
+            for (int i = 0; i < 6; i++) {
+                targets[target_count][i] = (uint8_t)vals[i];
+            }
+            target_count++;
+        }
+    }
+    cJSON_Delete(body);
+
+    esp_err_t ret = fleet_ota_start(&config, (target_count > 0) ? targets : NULL, target_count);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", ret == ESP_OK);
+    if (ret == ESP_OK) {
+        cJSON_AddStringToObject(json, "message", "Rollout started");
+    } else if (ret == ESP_ERR_NOT_FOUND) {
+        cJSON_AddStringToObject(json, "error", "No staged image or no node needs this version");
+    } else if (ret == ESP_ERR_INVALID_STATE) {
+        cJSON_AddStringToObject(json, "error", "OTA already in progress");
+    } else {
+        cJSON_AddStringToObject(json, "error", esp_err_to_name(ret));
+    }
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// POST /api/fleet/ota/continue - Continue after canary stage
+// ============================================================================
+static esp_err_t api_fleet_ota_continue_handler(httpd_req_t *req)
+{
+    esp_err_t ret = fleet_ota_continue();
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", ret == ESP_OK);
+    if (ret != ESP_OK) {
+        cJSON_AddStringToObject(json, "error", "Rollout is not waiting for confirmation");
+    }
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// POST /api/fleet/ota/abort - Abort rollout
+// ============================================================================
+static esp_err_t api_fleet_ota_abort_handler(httpd_req_t *req)
+{
+    esp_err_t ret = fleet_ota_abort();
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "success", ret == ESP_OK);
+    if (ret == ESP_OK) {
+        webserver_log("Fleet OTA aborted");
+    } else {
+        cJSON_AddStringToObject(json, "error", "Failed to abort");
+    }
+
+    return send_json_response(req, json);
+}
+
+// ============================================================================
+// GET /api/fleet/ota/status - Rollout status with per-node state
+// ============================================================================
+static esp_err_t api_fleet_ota_status_handler(httpd_req_t *req)
+{
+    cJSON *json = fleet_ota_status_json(true);
+    if (json == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    size_t staged = 0;
+    node_ota_flash_get_progress(NULL, &staged, NULL);
+    add_upload_session_json(json, &s_node_upload, staged);
+
+    return send_json_response(req, json);
+}
+
 // ============================================================================
 // GET /api/ota/status - OTA status
 // ============================================================================
@@ -908,6 +1719,7 @@ static esp_err_t api_ota_status_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(gateway_ota, "written_bytes", written);
     cJSON_AddNumberToObject(gateway_ota, "total_bytes", total_bytes);
     cJSON_AddNumberToObject(gateway_ota, "progress", progress);
+    add_upload_session_json(gateway_ota, &s_gateway_upload, written);
     cJSON_AddItemToObject(json, "gateway_ota", gateway_ota);
 
     // Current firmware version
@@ -959,76 +1771,114 @@ static esp_err_t api_factory_reset_handler(httpd_req_t *req)
 }
 
 // ============================================================================
-// GET /api/wifi/scan - Scan available WiFi networks
+// GET /api/wifi/scan - Available WiFi networks (cached, see wifi_manager)
+// Query params: refresh=1 forces a new radio scan,
+//               wait=<ms> long-polls for results newer than the cache
 // ============================================================================
+#define WIFI_SCAN_MAX_WAIT_MS       5000    // httpd is single-threaded: keep long-polls short
+
+static uint32_t s_scan_handler_calls = 0;
+static uint32_t s_scan_handler_total_ms = 0;
+static uint32_t s_scan_handler_max_ms = 0;
+
 static esp_err_t api_wifi_scan_handler(httpd_req_t *req)
 {
     set_cors_headers(req);
 
-    ESP_LOGI(TAG, "WiFi scan requested");
+    int64_t start = esp_timer_get_time();
+
+    bool force = false;
+    uint32_t wait_ms = 0;
+    char query[48] = {0};
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char value[8];
+        if (httpd_query_key_value(query, "refresh", value, sizeof(value)) == ESP_OK) {
+            force = (strcmp(value, "1") == 0 || strcmp(value, "true") == 0);
+        }
+        if (httpd_query_key_value(query, "wait", value, sizeof(value)) == ESP_OK) {
+            wait_ms = strtoul(value, NULL, 10);
+        }
+    }
 
-    // Start scan (blocking)
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,
-        .show_hidden = false,
-        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
-        .scan_time.active.min = 100,
-        .scan_time.active.max = 300,
-    };
+    wifi_scan_info_t info;
+    wifi_manager_scan_get_results(NULL, 0, &info);
+    uint32_t seen_generation = info.generation;
 
-    esp_err_t err = esp_wifi_scan_start(&scan_config, true);
+    esp_err_t err = wifi_manager_scan_request(force);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(err));
         cJSON *json = cJSON_CreateObject();
         cJSON_AddBoolToObject(json, "success", false);
         cJSON_AddStringToObject(json, "error", esp_err_to_name(err));
         return send_json_response(req, json);
     }
 
-    uint16_t ap_count = 0;
-    esp_wifi_scan_get_ap_num(&ap_count);
-    if (ap_count > 20) ap_count = 20;  // Limit results
+    // Never scanned yet: wait for the first results like the old blocking call did
+    if (seen_generation == 0 && wait_ms == 0) {
+        wait_ms = WIFI_SCAN_MAX_WAIT_MS;
+    }
+    if (wait_ms > WIFI_SCAN_MAX_WAIT_MS) {
+        wait_ms = WIFI_SCAN_MAX_WAIT_MS;
+    }
+    if (wait_ms > 0) {
+        wifi_manager_scan_wait(seen_generation, wait_ms);
+    }
 
-    wifi_ap_record_t *ap_list = malloc(sizeof(wifi_ap_record_t) * ap_count);
-    if (!ap_list) {
+    wifi_scan_entry_t *results = malloc(sizeof(wifi_scan_entry_t) * WIFI_SCAN_MAX_RESULTS);
+    if (!results) {
         cJSON *json = cJSON_CreateObject();
         cJSON_AddBoolToObject(json, "success", false);
         cJSON_AddStringToObject(json, "error", "Out of memory");
         return send_json_response(req, json);
     }
-
-    esp_wifi_scan_get_ap_records(&ap_count, ap_list);
+    int count = wifi_manager_scan_get_results(results, WIFI_SCAN_MAX_RESULTS, &info);
 
     cJSON *json = cJSON_CreateObject();
-    cJSON_AddBoolToObject(json, "success", true);
-    cJSON_AddNumberToObject(json, "count", ap_count);
+    bool have_results = info.timestamp_ms != 0;
+    cJSON_AddBoolToObject(json, "success", have_results);
+    if (!have_results) {
+        cJSON_AddStringToObject(json, "error",
+                                info.last_error != ESP_OK ? esp_err_to_name(info.last_error)
+                                                          : "Scan in progress");
+    }
+    cJSON_AddNumberToObject(json, "count", count);
+    cJSON_AddNumberToObject(json, "age_ms",
+                            have_results ? (double)((esp_timer_get_time() / 1000) - info.timestamp_ms) : -1);
+    cJSON_AddBoolToObject(json, "scanning", info.scanning);
     cJSON *networks = cJSON_AddArrayToObject(json, "networks");
 
-    // Track unique SSIDs
-    for (int i = 0; i < ap_count; i++) {
-        if (strlen((char *)ap_list[i].ssid) == 0) continue;
-
-        // Skip duplicates
-        bool duplicate = false;
-        for (int j = 0; j < i; j++) {
-            if (strcmp((char *)ap_list[i].ssid, (char *)ap_list[j].ssid) == 0) {
-                duplicate = true;
-                break;
-            }
-        }
-        if (duplicate) continue;
-
+    for (int i = 0; i < count; i++) {
         cJSON *net = cJSON_CreateObject();
-        cJSON_AddStringToObject(net, "ssid", (char *)ap_list[i].ssid);
-        cJSON_AddNumberToObject(net, "rssi", ap_list[i].rssi);
-        cJSON_AddNumberToObject(net, "channel", ap_list[i].primary);
-        cJSON_AddBoolToObject(net, "secure", ap_list[i].authmode != WIFI_AUTH_OPEN);
+        cJSON_AddStringToObject(net, "ssid", results[i].ssid);
+        cJSON_AddNumberToObject(net, "rssi", results[i].rssi);
+        cJSON_AddNumberToObject(net, "channel", results[i].channel);
+        cJSON_AddBoolToObject(net, "secure", results[i].secure);
         cJSON_AddItemToArray(networks, net);
     }
+    free(results);
+
+    // Handler latency and radio usage for this boot (= provisioning session in AP mode)
+    uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    s_scan_handler_calls++;
+    s_scan_handler_total_ms += latency_ms;
+    if (latency_ms > s_scan_handler_max_ms) {
+        s_scan_handler_max_ms = latency_ms;
+    }
+
+    cJSON *stats = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stats, "latency_ms", latency_ms);
+    cJSON_AddNumberToObject(stats, "avg_latency_ms", s_scan_handler_total_ms / s_scan_handler_calls);
+    cJSON_AddNumberToObject(stats, "max_latency_ms", s_scan_handler_max_ms);
+    cJSON_AddNumberToObject(stats, "requests", info.requests);
+    cJSON_AddNumberToObject(stats, "coalesced", info.coalesced);
+    cJSON_AddNumberToObject(stats, "radio_scans", info.radio_scans);
+    cJSON_AddNumberToObject(stats, "last_scan_ms", info.last_duration_ms);
+    cJSON_AddItemToObject(json, "stats", stats);
+
+    ESP_LOGI(TAG, "WiFi scan served in %lu ms (%d networks, age %lld ms, %lu radio scans for %lu requests)",
+             (unsigned long)latency_ms, count,
+             have_results ? (esp_timer_get_time() / 1000) - info.timestamp_ms : -1LL,
+             (unsigned long)info.radio_scans, (unsigned long)info.requests);
 
-    free(ap_list);
     return send_json_response(req, json);
 }
 
@@ -1074,6 +1924,16 @@ static esp_err_t api_provision_status_handler(httpd_req_t *req)
     cJSON_AddStringToObject(mqtt_obj, "client_id", mqtt->client_id);
     cJSON_AddBoolToObject(mqtt_obj, "configured", mqtt->configured);
 
+    // Config store: boot load time and writes since boot
+    config_store_stats_t store;
+    config_get_store_stats(&store);
+    cJSON *store_obj = cJSON_AddObjectToObject(json, "store");
+    cJSON_AddNumberToObject(store_obj, "load_us", store.load_us);
+    cJSON_AddNumberToObject(store_obj, "commits", store.commits);
+    cJSON_AddNumberToObject(store_obj, "generation", store.generation);
+    cJSON_AddStringToObject(store_obj, "slot", store.slot < 0 ? "none" : (store.slot ? "B" : "A"));
+    cJSON_AddBoolToObject(store_obj, "migrated", store.migrated);
+
     return send_json_response(req, json);
 }
 
@@ -1109,7 +1969,8 @@ static esp_err_t api_provision_wifi_handler(httpd_req_t *req)
     ESP_LOGI(TAG, "Provisioning WiFi: SSID=%s, provision_code=%s", ssid, provision_code ? provision_code : "(none)");
     webserver_log("[PROVISION] Setting WiFi: %s", ssid);
 
-    // Save WiFi credentials
+    // Save WiFi credentials and code in one config write
+    config_begin();
     esp_err_t err = config_set_wifi_sta(ssid, password);
 
     // Save provision code if provided (will be sent with first MQTT status)
@@ -1122,6 +1983,10 @@ static esp_err_t api_provision_wifi_handler(httpd_req_t *req)
             ESP_LOGW(TAG, "Failed to save provision code: %s", esp_err_to_name(code_err));
         }
     }
+    esp_err_t commit_err = config_commit();
+    if (err == ESP_OK) {
+        err = commit_err;
+    }
 
     cJSON_Delete(body);
 
@@ -1207,6 +2072,9 @@ static esp_err_t api_provision_all_handler(httpd_req_t *req)
     bool wifi_ok = false;
     bool mqtt_ok = false;
 
+    // WiFi and MQTT are stored together at config_commit()
+    config_begin();
+
     // WiFi config
     cJSON *wifi_obj = cJSON_GetObjectItem(body, "wifi");
     if (wifi_obj && cJSON_IsObject(wifi_obj)) {
@@ -1238,6 +2106,9 @@ static esp_err_t api_provision_all_handler(httpd_req_t *req)
     }
 
     cJSON_Delete(body);
+    if (config_commit() != ESP_OK) {
+        wifi_ok = mqtt_ok = false;
+    }
     webserver_log("[PROVISION] Complete setup - WiFi:%s, MQTT:%s",
                   wifi_ok ? "OK" : "SKIP", mqtt_ok ? "OK" : "SKIP");
 
@@ -1386,6 +2257,275 @@ static esp_err_t api_options_handler(httpd_req_t *req)
     return httpd_resp_send(req, NULL, 0);
 }
 
+// ============================================================================
+// Route table
+// ============================================================================
+typedef esp_err_t (*api_handler_t)(httpd_req_t *req);
+
+typedef struct {
+    const char *path;
+    httpd_method_t method;
+    api_handler_t handler;
+} api_route_t;
+
+static esp_err_t api_routes_handler(httpd_req_t *req);
+
+// Fixed paths, sorted by strcmp(path) then method (checked at registration)
+// so lookup is a binary search
+static const api_route_t s_routes[] = {
+    {"/api/boot",               HTTP_GET,  api_boot_handler},
+    {"/api/command",            HTTP_POST, api_command_handler},
+    {"/api/commission",         HTTP_POST, api_commission_handler},
+    {"/api/connections",        HTTP_GET,  api_connections_handler},
+    {"/api/decommission",       HTTP_POST, api_decommission_handler},
+    {"/api/factory-reset",      HTTP_POST, api_factory_reset_handler},
+    {"/api/fleet/ota/abort",    HTTP_POST, api_fleet_ota_abort_handler},
+    {"/api/fleet/ota/continue", HTTP_POST, api_fleet_ota_continue_handler},
+    {"/api/fleet/ota/start",    HTTP_POST, api_fleet_ota_start_handler},
+    {"/api/fleet/ota/status",   HTTP_GET,  api_fleet_ota_status_handler},
+    {"/api/fleet/ota/upload",   HTTP_POST, api_fleet_ota_upload_handler},
+    {"/api/latency",            HTTP_GET,  api_latency_handler},
+    {"/api/latency/reset",      HTTP_POST, api_latency_reset_handler},
+    {"/api/logs",               HTTP_GET,  api_logs_handler},
+    {"/api/mesh",               HTTP_GET,  api_mesh_handler},
+    {"/api/mesh/channel",       HTTP_GET,  api_mesh_channel_handler},
+    {"/api/mesh/channel/survey", HTTP_POST, api_mesh_channel_survey_handler},
+    {"/api/mesh/fastpath",      HTTP_GET,  api_mesh_fastpath_handler},
+    {"/api/mesh/fastpath",      HTTP_POST, api_mesh_fastpath_set_handler},
+    {"/api/mesh/optimizer",     HTTP_GET,  api_mesh_optimizer_handler},
+    {"/api/mesh/topology",      HTTP_GET,  api_mesh_topology_handler},
+    {"/api/network",            HTTP_GET,  api_network_handler},
+    {"/api/node/config",        HTTP_POST, api_node_config_handler},
+    {"/api/node/ota",           HTTP_POST, api_node_ota_handler},
+    {"/api/node/ota/abort",     HTTP_POST, api_node_ota_abort_handler},
+    {"/api/node/ota/status",    HTTP_GET,  api_node_ota_status_handler},
+    {"/api/nodes",              HTTP_GET,  api_nodes_handler},
+    {"/api/ota/status",         HTTP_GET,  api_ota_status_handler},
+    {"/api/ota/upload",         HTTP_POST, api_ota_upload_handler},
+    {"/api/provision/all",      HTTP_POST, api_provision_all_handler},
+    {"/api/provision/mqtt",     HTTP_POST, api_provision_mqtt_handler},
+    {"/api/provision/status",   HTTP_GET,  api_provision_status_handler},
+    {"/api/provision/wifi",     HTTP_POST, api_provision_wifi_handler},
+    {"/api/reboot",             HTTP_POST, api_reboot_handler},
+    {"/api/routes",             HTTP_GET,  api_routes_handler},
+    {"/api/scan",               HTTP_POST, api_scan_handler},
+    {"/api/scan/results",       HTTP_GET,  api_scan_results_handler},
+    {"/api/scan/stop",          HTTP_POST, api_scan_stop_handler},
+    {"/api/status",             HTTP_GET,  api_status_handler},
+    {"/api/wifi/scan",          HTTP_GET,  api_wifi_scan_handler},
+};
+#define API_ROUTE_COUNT         (sizeof(s_routes) / sizeof(s_routes[0]))
+
+// Paths with "{name}" segments, matched in order after the fixed table misses
+static const api_route_t s_param_routes[] = {
+    {"/api/nodes/{mac}",        HTTP_GET,  api_node_get_handler},
+};
+#define API_PARAM_ROUTE_COUNT   (sizeof(s_param_routes) / sizeof(s_param_routes[0]))
+
+// Non-API paths kept as plain httpd handlers
+static const api_route_t s_captive_routes[] = {
+    // Captive portal detection endpoints (trigger "Sign in to network")
+    {"/generate_204",           HTTP_GET,  api_captive_generate204_handler},
+    {"/gen_204",                HTTP_GET,  api_captive_generate204_handler},
+    {"/hotspot-detect.html",    HTTP_GET,  api_captive_apple_handler},
+    {"/connecttest.txt",        HTTP_GET,  api_captive_windows_handler},
+    {"/redirect",               HTTP_GET,  api_captive_redirect_handler},
+    {"/canonical.html",         HTTP_GET,  api_captive_redirect_handler},
+    {"/success.txt",            HTTP_GET,  api_captive_redirect_handler},
+};
+
+// Per-route stats, indexed like s_routes followed by s_param_routes.
+// Only touched from the httpd task, so no locking.
+static const uint16_t s_latency_bounds_ms[API_LATENCY_BUCKETS - 1] = {5, 20, 50, 200, 1000};
+static api_route_stats_t s_route_stats[API_ROUTE_COUNT + API_PARAM_ROUTE_COUNT];
+static uint32_t s_unrouted = 0;
+
+static const char* method_name(int method)
+{
+    switch (method) {
+        case HTTP_GET:     return "GET";
+        case HTTP_POST:    return "POST";
+        case HTTP_OPTIONS: return "OPTIONS";
+        default:           return "?";
+    }
+}
+
+static int route_cmp(const char *path, int method, const api_route_t *route)
+{
+    int c = strcmp(path, route->path);
+    if (c != 0) return c;
+    return method - (int)route->method;
+}
+
+/**
+ * Match a "{name}" pattern segment by segment, capturing params
+ */
+static bool route_match_params(const char *pattern, const char *path, api_params_t *params)
+{
+    params->count = 0;
+    while (*pattern && *path) {
+        if (*pattern == '{') {
+            const char *name_end = strchr(pattern, '}');
+            size_t value_len = strcspn(path, "/");
+            if (name_end == NULL || value_len == 0 || params->count >= API_MAX_PARAMS ||
+                value_len >= API_PARAM_VALUE_MAX ||
+                (size_t)(name_end - pattern - 1) >= API_PARAM_NAME_MAX) {
+                return false;
+            }
+            int n = params->count++;
+            memcpy(params->p[n].name, pattern + 1, name_end - pattern - 1);
+            params->p[n].name[name_end - pattern - 1] = '\0';
+            memcpy(params->p[n].value, path, value_len);
+            params->p[n].value[value_len] = '\0';
+            url_decode(params->p[n].value);
+            pattern = name_end + 1;
+            path += value_len;
+        } else if (*pattern++ != *path++) {
+            return false;
+        }
+    }
+    return *pattern == '\0' && *path == '\0';
+}
+
+/**
+ * Find the route for path + method
+ * @param path_known  Set if the path exists with another method (405 vs 404)
+ * @return Index into s_route_stats, -1 if no route
+ */
+static int route_lookup(const char *path, int method, api_params_t *params, bool *path_known)
+{
+    *path_known = false;
+
+    int lo = 0, hi = API_ROUTE_COUNT;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (route_cmp(path, method, &s_routes[mid]) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < API_ROUTE_COUNT && route_cmp(path, method, &s_routes[lo]) == 0) {
+        return lo;
+    }
+    if ((lo < API_ROUTE_COUNT && strcmp(path, s_routes[lo].path) == 0) ||
+        (lo > 0 && strcmp(path, s_routes[lo - 1].path) == 0)) {
+        *path_known = true;
+        return -1;
+    }
+
+    for (int i = 0; i < API_PARAM_ROUTE_COUNT; i++) {
+        if (route_match_params(s_param_routes[i].path, path, params)) {
+            if ((int)s_param_routes[i].method == method) {
+                return API_ROUTE_COUNT + i;
+            }
+            *path_known = true;
+        }
+    }
+    return -1;
+}
+
+static void route_record(int idx, int64_t elapsed_us, esp_err_t ret)
+{
+    api_route_stats_t *st = &s_route_stats[idx];
+    uint32_t ms = (uint32_t)(elapsed_us / 1000);
+
+    st->count++;
+    if (ret != ESP_OK) st->errors++;
+    st->total_us += elapsed_us;
+    if (ms > st->max_ms) st->max_ms = ms;
+
+    int b = 0;
+    while (b < API_LATENCY_BUCKETS - 1 && ms >= s_latency_bounds_ms[b]) b++;
+    st->hist[b]++;
+}
+
+// ============================================================================
+// /api/* dispatcher
+// ============================================================================
+static esp_err_t api_router(httpd_req_t *req)
+{
+    char path[API_PATH_MAX];
+    size_t len = strcspn(req->uri, "?");
+    if (len >= sizeof(path)) {
+        set_cors_headers(req);
+        httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, "URI too long");
+        return ESP_OK;
+    }
+    memcpy(path, req->uri, len);
+    path[len] = '\0';
+    if (len > 1 && path[len - 1] == '/') {
+        path[len - 1] = '\0';
+    }
+
+    // CORS preflight is the same for every endpoint
+    if (req->method == HTTP_OPTIONS) {
+        return api_options_handler(req);
+    }
+
+    api_params_t params = {0};
+    bool path_known;
+    int idx = route_lookup(path, req->method, &params, &path_known);
+    if (idx < 0) {
+        s_unrouted++;
+        set_cors_headers(req);
+        if (path_known) {
+            httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
+        } else {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown endpoint");
+        }
+        return ESP_OK;
+    }
+
+    const api_route_t *route = (idx < API_ROUTE_COUNT) ? &s_routes[idx]
+                                                      : &s_param_routes[idx - API_ROUTE_COUNT];
+    req->user_ctx = &params;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = route->handler(req);
+    route_record(idx, esp_timer_get_time() - start, ret);
+    return ret;
+}
+
+// ============================================================================
+// GET /api/routes - Per-route request counts and latency histograms
+// ============================================================================
+static esp_err_t api_routes_handler(httpd_req_t *req)
+{
+    cJSON *json = cJSON_CreateObject();
+
+    cJSON *bounds = cJSON_CreateArray();
+    for (int b = 0; b < API_LATENCY_BUCKETS - 1; b++) {
+        cJSON_AddItemToArray(bounds, cJSON_CreateNumber(s_latency_bounds_ms[b]));
+    }
+    cJSON_AddItemToObject(json, "bucket_bounds_ms", bounds);
+    cJSON_AddNumberToObject(json, "unrouted", s_unrouted);
+
+    cJSON *routes = cJSON_CreateArray();
+    for (int i = 0; i < API_ROUTE_COUNT + API_PARAM_ROUTE_COUNT; i++) {
+        const api_route_t *route = (i < API_ROUTE_COUNT) ? &s_routes[i]
+                                                        : &s_param_routes[i - API_ROUTE_COUNT];
+        const api_route_stats_t *st = &s_route_stats[i];
+
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "path", route->path);
+        cJSON_AddStringToObject(entry, "method", method_name(route->method));
+        cJSON_AddNumberToObject(entry, "count", st->count);
+        cJSON_AddNumberToObject(entry, "errors", st->errors);
+        cJSON_AddNumberToObject(entry, "avg_ms", st->count ? (double)st->total_us / st->count / 1000.0 : 0);
+        cJSON_AddNumberToObject(entry, "max_ms", st->max_ms);
+        cJSON *hist = cJSON_CreateArray();
+        for (int b = 0; b < API_LATENCY_BUCKETS; b++) {
+            cJSON_AddItemToArray(hist, cJSON_CreateNumber(st->hist[b]));
+        }
+        cJSON_AddItemToObject(entry, "hist", hist);
+        cJSON_AddItemToArray(routes, entry);
+    }
+    cJSON_AddItemToObject(json, "routes", routes);
+
+    return send_json_response(req, json);
+}
+
 // ============================================================================
 // Register all handlers
 // ============================================================================
@@ -1393,65 +2533,36 @@ esp_err_t web_api_register_handlers(httpd_handle_t server)
 {
     ESP_LOGI(TAG, "Registering API handlers");
 
-    // Define all API endpoints
-    static const struct {
-        const char *uri;
-        httpd_method_t method;
-        esp_err_t (*handler)(httpd_req_t *);
-    } endpoints[] = {
-        {"/api/status",        HTTP_GET,  api_status_handler},
-        {"/api/network",       HTTP_GET,  api_network_handler},
-        {"/api/mesh",          HTTP_GET,  api_mesh_handler},
-        {"/api/nodes",         HTTP_GET,  api_nodes_handler},
-        {"/api/scan",          HTTP_POST, api_scan_handler},
-        {"/api/scan/stop",     HTTP_POST, api_scan_stop_handler},
-        {"/api/scan/results",  HTTP_GET,  api_scan_results_handler},
-        {"/api/commission",    HTTP_POST, api_commission_handler},
-        {"/api/decommission",  HTTP_POST, api_decommission_handler},
-        {"/api/command",       HTTP_POST, api_command_handler},
-        {"/api/logs",          HTTP_GET,  api_logs_handler},
-        {"/api/ota/status",    HTTP_GET,  api_ota_status_handler},
-        {"/api/ota/upload",    HTTP_POST, api_ota_upload_handler},
-        {"/api/node/ota",      HTTP_POST, api_node_ota_handler},
-        {"/api/node/ota/status", HTTP_GET, api_node_ota_status_handler},
-        {"/api/node/ota/abort", HTTP_POST, api_node_ota_abort_handler},
-        {"/api/node/config",   HTTP_POST, api_node_config_handler},
-        {"/api/reboot",        HTTP_POST, api_reboot_handler},
-        {"/api/factory-reset", HTTP_POST, api_factory_reset_handler},
-        // WiFi scan
-        {"/api/wifi/scan",        HTTP_GET,  api_wifi_scan_handler},
-        // Provisioning endpoints
-        {"/api/provision/status", HTTP_GET,  api_provision_status_handler},
-        {"/api/provision/wifi",   HTTP_POST, api_provision_wifi_handler},
-        {"/api/provision/mqtt",   HTTP_POST, api_provision_mqtt_handler},
-        {"/api/provision/all",    HTTP_POST, api_provision_all_handler},
-        // Captive portal detection endpoints (trigger "Sign in to network")
-        {"/generate_204",         HTTP_GET,  api_captive_generate204_handler},
-        {"/gen_204",              HTTP_GET,  api_captive_generate204_handler},
-        {"/hotspot-detect.html",  HTTP_GET,  api_captive_apple_handler},
-        {"/connecttest.txt",      HTTP_GET,  api_captive_windows_handler},
-        {"/redirect",             HTTP_GET,  api_captive_redirect_handler},
-        {"/canonical.html",       HTTP_GET,  api_captive_redirect_handler},
-        {"/success.txt",          HTTP_GET,  api_captive_redirect_handler},
-    };
-
-    for (int i = 0; i < sizeof(endpoints) / sizeof(endpoints[0]); i++) {
+    for (int i = 1; i < API_ROUTE_COUNT; i++) {
+        if (route_cmp(s_routes[i].path, s_routes[i].method, &s_routes[i - 1]) <= 0) {
+            ESP_LOGE(TAG, "Route table not sorted at %s", s_routes[i].path);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    // One wildcard entry per method for the whole API (needs httpd_uri_match_wildcard);
+    // requests go through webserver_dispatch for per-socket tracking
+    static const httpd_method_t api_methods[] = { HTTP_GET, HTTP_POST, HTTP_OPTIONS };
+    for (int i = 0; i < sizeof(api_methods) / sizeof(api_methods[0]); i++) {
         httpd_uri_t uri = {
-            .uri = endpoints[i].uri,
-            .method = endpoints[i].method,
-            .handler = endpoints[i].handler
+            .uri = "/api/*",
+            .method = api_methods[i],
+            .handler = webserver_dispatch,
+            .user_ctx = (void *)api_router
         };
         httpd_register_uri_handler(server, &uri);
+    }
 
-        // Also register OPTIONS for CORS
-        httpd_uri_t options_uri = {
-            .uri = endpoints[i].uri,
-            .method = HTTP_OPTIONS,
-            .handler = api_options_handler
+    for (int i = 0; i < sizeof(s_captive_routes) / sizeof(s_captive_routes[0]); i++) {
+        httpd_uri_t uri = {
+            .uri = s_captive_routes[i].path,
+            .method = s_captive_routes[i].method,
+            .handler = webserver_dispatch,
+            .user_ctx = (void *)s_captive_routes[i].handler
         };
-        httpd_register_uri_handler(server, &options_uri);
+        httpd_register_uri_handler(server, &uri);
     }
 
-    ESP_LOGI(TAG, "Registered %d API endpoints", sizeof(endpoints) / sizeof(endpoints[0]));
+    ESP_LOGI(TAG, "Registered %d API routes", API_ROUTE_COUNT + API_PARAM_ROUTE_COUNT);
     return ESP_OK;
 }
@@ -9,11 +9,29 @@
 
 #include "esp_http_server.h"
 #include "esp_err.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// ============================================================================
+// Configuration
+// ============================================================================
+#define API_PATH_MAX            96      // Longest routable path (without query)
+#define API_LATENCY_BUCKETS     6       // <5, <20, <50, <200, <1000, >=1000 ms
+
+// ============================================================================
+// Route Statistics
+// ============================================================================
+typedef struct {
+    uint32_t count;
+    uint32_t errors;                    // Handler returned an error (socket closed)
+    uint64_t total_us;
+    uint32_t max_ms;
+    uint32_t hist[API_LATENCY_BUCKETS];
+} api_route_stats_t;
+
 /**
  * Register all API handlers with the HTTP server
  * @param server HTTP server handle
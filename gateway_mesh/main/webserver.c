@@ -4,15 +4,19 @@
 
 #include "webserver.h"
 #include "web_api.h"
+#include "log_ring.h"
 #include "config_manager.h"
+#include "ble_prov.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <unistd.h>
 
 static const char *TAG = "WEBSERVER";
 
@@ -25,24 +29,299 @@ static const char *TAG = "WEBSERVER";
 static httpd_handle_t s_server = NULL;
 static bool s_running = false;
 static TaskHandle_t s_ws_ping_task = NULL;
+static TaskHandle_t s_ws_log_task = NULL;
 
-// Log buffer (circular)
-static log_entry_t s_log_buffer[LOG_BUFFER_SIZE];
-static int s_log_head = 0;
-static int s_log_count = 0;
-static SemaphoreHandle_t s_log_mutex = NULL;
+// Log streaming (records come from log_ring, see ws_log_task)
+static uint32_t s_log_cursor = 0;
+static uint32_t s_log_streamed = 0;
+static uint32_t s_log_skipped = 0;
 
 // WebSocket clients
 static int s_ws_fds[WS_MAX_CLIENTS];
 static int s_ws_count = 0;
 static SemaphoreHandle_t s_ws_mutex = NULL;
 
+// Open sockets (filled by open_fn/close_fn)
+typedef struct {
+    int      fd;                        // -1 = free slot
+    bool     websocket;
+    bool     busy;
+    bool     closing;                   // Eviction or idle close requested
+    uint32_t requests;
+    int64_t  opened_at;
+    int64_t  last_active;
+} conn_slot_t;
+
+static conn_slot_t s_conns[WEBSERVER_MAX_SOCKETS];
+static webserver_conn_stats_t s_conn_stats;
+static uint64_t s_closed_lifetime_ms = 0;
+static uint32_t s_closed_count = 0;
+static SemaphoreHandle_t s_conn_mutex = NULL;
+
+// ============================================================================
+// Connection Manager
+// ============================================================================
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static conn_slot_t *conn_find(int fd)
+{
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd == fd) {
+            return &s_conns[i];
+        }
+    }
+    return NULL;
+}
+
+static void conn_reset_table(void)
+{
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        s_conns[i].fd = -1;
+    }
+}
+
+/**
+ * Pick the plain HTTP socket idle the longest: never a WebSocket, a socket
+ * with a handler running, one already closing, or one that has not served
+ * its first request yet (that request is on its way). Caller holds
+ * s_conn_mutex.
+ */
+static conn_slot_t *conn_pick_victim(int exclude_fd)
+{
+    conn_slot_t *victim = NULL;
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        conn_slot_t *c = &s_conns[i];
+        if (c->fd < 0 || c->fd == exclude_fd || c->websocket || c->busy || c->closing ||
+            c->requests == 0) {
+            continue;
+        }
+        if (victim == NULL || c->last_active < victim->last_active) {
+            victim = c;
+        }
+    }
+    return victim;
+}
+
+/**
+ * Keep one slot free for the next client: with the pool full, pick an idle
+ * socket to evict. Runs on accept and after every request, so a pool that
+ * filled up with sockets in use gets room as soon as one goes idle.
+ * Caller holds s_conn_mutex.
+ * @return fd to close, or -1
+ */
+static int conn_make_room(int exclude_fd)
+{
+    int open = 0;
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        if (s_conns[i].fd >= 0 && !s_conns[i].closing) {
+            open++;
+        }
+    }
+    if (open < WEBSERVER_MAX_SOCKETS) {
+        return -1;
+    }
+    conn_slot_t *victim = conn_pick_victim(exclude_fd);
+    if (victim == NULL) {
+        return -1;
+    }
+    victim->closing = true;
+    s_conn_stats.evicted++;
+    return victim->fd;
+}
+
+static esp_err_t conn_open_cb(httpd_handle_t hd, int sockfd)
+{
+    if (s_conn_mutex == NULL || !xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        return ESP_OK;
+    }
+
+    int64_t now = now_ms();
+    conn_slot_t *slot = conn_find(-1);
+    if (slot) {
+        slot->fd = sockfd;
+        slot->websocket = false;
+        slot->busy = false;
+        slot->closing = false;
+        slot->requests = 0;
+        slot->opened_at = now;
+        slot->last_active = now;
+    }
+    s_conn_stats.accepted++;
+    int victim_fd = conn_make_room(sockfd);
+    xSemaphoreGive(s_conn_mutex);
+
+    // httpd ignores a close asked for before a session served anything;
+    // count this one as used so the idle sweep can close a silent client
+    httpd_sess_update_lru_counter(hd, sockfd);
+
+    if (victim_fd >= 0) {
+        ESP_LOGD(TAG, "Socket pool full, evicting idle fd=%d", victim_fd);
+        httpd_sess_trigger_close(hd, victim_fd);
+    }
+    return ESP_OK;
+}
+
+static void ws_remove_client(int fd)
+{
+    if (s_ws_mutex && xSemaphoreTake(s_ws_mutex, pdMS_TO_TICKS(100))) {
+        for (int i = 0; i < s_ws_count; i++) {
+            if (s_ws_fds[i] == fd) {
+                for (int j = i; j < s_ws_count - 1; j++) {
+                    s_ws_fds[j] = s_ws_fds[j + 1];
+                }
+                s_ws_count--;
+                ESP_LOGI(TAG, "WebSocket client closed (fd=%d, total=%d)", fd, s_ws_count);
+                break;
+            }
+        }
+        xSemaphoreGive(s_ws_mutex);
+    }
+}
+
+static void conn_close_cb(httpd_handle_t hd, int sockfd)
+{
+    if (s_conn_mutex && xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        conn_slot_t *c = conn_find(sockfd);
+        if (c) {
+            s_closed_lifetime_ms += (uint64_t)(now_ms() - c->opened_at);
+            s_closed_count++;
+            c->fd = -1;
+        }
+        xSemaphoreGive(s_conn_mutex);
+    }
+
+    ws_remove_client(sockfd);
+
+    // With a close_fn installed httpd leaves closing the socket to us
+    close(sockfd);
+}
+
+static void conn_touch(int fd, bool websocket)
+{
+    if (s_conn_mutex && xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        conn_slot_t *c = conn_find(fd);
+        if (c) {
+            c->last_active = now_ms();
+            if (websocket) {
+                c->websocket = true;
+            }
+        }
+        xSemaphoreGive(s_conn_mutex);
+    }
+}
+
+esp_err_t webserver_dispatch(httpd_req_t *req)
+{
+    esp_err_t (*handler)(httpd_req_t *) = (esp_err_t (*)(httpd_req_t *))req->user_ctx;
+    int fd = httpd_req_to_sockfd(req);
+
+    if (s_conn_mutex && xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        conn_slot_t *c = conn_find(fd);
+        if (c) {
+            if (c->requests > 0) {
+                s_conn_stats.reused++;
+            }
+            c->requests++;
+            c->busy = true;
+            c->last_active = now_ms();
+        }
+        s_conn_stats.requests++;
+        xSemaphoreGive(s_conn_mutex);
+    }
+
+    esp_err_t ret = handler(req);
+
+    int victim_fd = -1;
+    if (s_conn_mutex && xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        conn_slot_t *c = conn_find(fd);
+        if (c) {
+            c->busy = false;
+            c->last_active = now_ms();
+        }
+        victim_fd = conn_make_room(-1);
+        xSemaphoreGive(s_conn_mutex);
+    }
+    if (victim_fd >= 0) {
+        ESP_LOGD(TAG, "Socket pool full, evicting idle fd=%d", victim_fd);
+        httpd_sess_trigger_close(s_server, victim_fd);
+    }
+    return ret;
+}
+
+/**
+ * Close keep-alive HTTP sockets nobody has used for WEBSERVER_IDLE_TIMEOUT_MS
+ */
+static void conn_sweep(void)
+{
+    int idle_fds[WEBSERVER_MAX_SOCKETS];
+    int idle_count = 0;
+
+    if (s_conn_mutex == NULL || !xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        return;
+    }
+    int64_t now = now_ms();
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        conn_slot_t *c = &s_conns[i];
+        if (c->fd < 0 || c->websocket || c->busy || c->closing) continue;
+        if (now - c->last_active > WEBSERVER_IDLE_TIMEOUT_MS) {
+            c->closing = true;
+            idle_fds[idle_count++] = c->fd;
+            s_conn_stats.idle_closed++;
+        }
+    }
+    xSemaphoreGive(s_conn_mutex);
+
+    for (int i = 0; i < idle_count; i++) {
+        ESP_LOGD(TAG, "Closing idle socket fd=%d", idle_fds[i]);
+        httpd_sess_trigger_close(s_server, idle_fds[i]);
+    }
+}
+
+int webserver_get_conn_stats(webserver_conn_stats_t *stats, webserver_conn_info_t *conns, int max_conns)
+{
+    if (stats == NULL) return 0;
+    memset(stats, 0, sizeof(*stats));
+    if (s_conn_mutex == NULL || !xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+        return 0;
+    }
+
+    *stats = s_conn_stats;
+    stats->max_sockets = WEBSERVER_MAX_SOCKETS;
+    stats->ws_budget = WS_MAX_CLIENTS;
+    stats->avg_lifetime_ms = s_closed_count ? (uint32_t)(s_closed_lifetime_ms / s_closed_count) : 0;
+
+    int64_t now = now_ms();
+    int n = 0;
+    for (int i = 0; i < WEBSERVER_MAX_SOCKETS; i++) {
+        conn_slot_t *c = &s_conns[i];
+        if (c->fd < 0) continue;
+        stats->open++;
+        if (c->websocket) stats->websockets++;
+        if (conns && n < max_conns) {
+            conns[n].fd = c->fd;
+            conns[n].websocket = c->websocket;
+            conns[n].busy = c->busy;
+            conns[n].requests = c->requests;
+            conns[n].age_ms = (uint32_t)(now - c->opened_at);
+            conns[n].idle_ms = (uint32_t)(now - c->last_active);
+            n++;
+        }
+    }
+    xSemaphoreGive(s_conn_mutex);
+    return n;
+}
+
 // ============================================================================
 // WebSocket Handler
 // ============================================================================
 
-static void ws_add_client(int fd)
+static bool ws_add_client(int fd)
 {
+    bool added = false;
     if (s_ws_mutex && xSemaphoreTake(s_ws_mutex, pdMS_TO_TICKS(100))) {
         bool found = false;
         for (int i = 0; i < s_ws_count; i++) {
@@ -51,12 +330,19 @@ static void ws_add_client(int fd)
                 break;
             }
         }
-        if (!found && s_ws_count < WS_MAX_CLIENTS) {
+        if (found) {
+            added = true;
+        } else if (s_ws_count < WS_MAX_CLIENTS) {
             s_ws_fds[s_ws_count++] = fd;
+            added = true;
             ESP_LOGI(TAG, "WebSocket client connected (fd=%d, total=%d)", fd, s_ws_count);
         }
         xSemaphoreGive(s_ws_mutex);
     }
+    if (added) {
+        conn_touch(fd, true);
+    }
+    return added;
 }
 
 static esp_err_t ws_handler(httpd_req_t *req)
@@ -65,8 +351,16 @@ static esp_err_t ws_handler(httpd_req_t *req)
 
     if (req->method == HTTP_GET) {
         ESP_LOGI(TAG, "WebSocket handshake (fd=%d)", fd);
-        // Register client immediately on handshake
-        ws_add_client(fd);
+        // Register client immediately on handshake; beyond the budget the
+        // socket is closed so it can't eat into the API pool
+        if (!ws_add_client(fd)) {
+            ESP_LOGW(TAG, "WebSocket budget exhausted (%d), rejecting fd=%d", WS_MAX_CLIENTS, fd);
+            if (s_conn_mutex && xSemaphoreTake(s_conn_mutex, pdMS_TO_TICKS(100))) {
+                s_conn_stats.ws_rejected++;
+                xSemaphoreGive(s_conn_mutex);
+            }
+            return ESP_FAIL;
+        }
         return ESP_OK;
     }
 
@@ -107,52 +401,22 @@ static esp_err_t ws_handler(httpd_req_t *req)
 
 void webserver_log(const char *format, ...)
 {
-    if (s_log_mutex == NULL) return;
-
-    char message[LOG_LINE_MAX];
     va_list args;
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_ring_vwrite(format, args);
     va_end(args);
-
-    if (xSemaphoreTake(s_log_mutex, pdMS_TO_TICKS(100))) {
-        log_entry_t *entry = &s_log_buffer[s_log_head];
-        entry->timestamp = (uint32_t)(esp_timer_get_time() / 1000000);
-        strncpy(entry->message, message, LOG_LINE_MAX - 1);
-        entry->message[LOG_LINE_MAX - 1] = '\0';
-
-        s_log_head = (s_log_head + 1) % LOG_BUFFER_SIZE;
-        if (s_log_count < LOG_BUFFER_SIZE) {
-            s_log_count++;
-        }
-
-        xSemaphoreGive(s_log_mutex);
-
-        // Broadcast to WebSocket clients
-        char json[256];
-        snprintf(json, sizeof(json), "{\"type\":\"log\",\"ts\":%lu,\"msg\":\"%s\"}",
-                 (unsigned long)entry->timestamp, message);
-        webserver_ws_broadcast(json);
-    }
 }
 
 int webserver_get_logs(log_entry_t *entries, int max_entries)
 {
-    if (s_log_mutex == NULL || entries == NULL) return 0;
-
-    int count = 0;
-    if (xSemaphoreTake(s_log_mutex, pdMS_TO_TICKS(100))) {
-        count = (s_log_count < max_entries) ? s_log_count : max_entries;
-        int start = (s_log_head - count + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-
-        for (int i = 0; i < count; i++) {
-            int idx = (start + i) % LOG_BUFFER_SIZE;
-            memcpy(&entries[i], &s_log_buffer[idx], sizeof(log_entry_t));
-        }
+    if (entries == NULL) return 0;
+    return log_ring_read_last(entries, max_entries);
+}
 
-        xSemaphoreGive(s_log_mutex);
-    }
-    return count;
+void webserver_get_log_stream_stats(uint32_t *streamed, uint32_t *skipped)
+{
+    if (streamed) *streamed = s_log_streamed;
+    if (skipped) *skipped = s_log_skipped;
 }
 
 void webserver_ws_broadcast(const char *message)
@@ -183,20 +447,28 @@ void webserver_ws_broadcast(const char *message)
 }
 
 // ============================================================================
-// WebSocket Ping Task (keep-alive)
+// WebSocket Ping Task (keep-alive, idle socket sweep)
 // ============================================================================
 
 static void ws_ping_task(void *arg)
 {
     ESP_LOGI(TAG, "WebSocket ping task started");
+    int64_t last_ping = now_ms();
 
     while (s_running) {
-        vTaskDelay(pdMS_TO_TICKS(WS_PING_INTERVAL_MS));
+        vTaskDelay(pdMS_TO_TICKS(WEBSERVER_SWEEP_MS));
 
         if (!s_running || s_server == NULL) {
             break;
         }
 
+        conn_sweep();
+
+        if (now_ms() - last_ping < WS_PING_INTERVAL_MS) {
+            continue;
+        }
+        last_ping = now_ms();
+
         // Send ping to all WebSocket clients
         if (s_ws_mutex && xSemaphoreTake(s_ws_mutex, pdMS_TO_TICKS(100))) {
             httpd_ws_frame_t ping_pkt = {
@@ -228,6 +500,69 @@ static void ws_ping_task(void *arg)
     vTaskDelete(NULL);
 }
 
+// ============================================================================
+// WebSocket Log Sender
+// ============================================================================
+
+/**
+ * Stream new log records to WebSocket clients, at most WS_LOG_MAX_PER_FLUSH
+ * per WS_LOG_FLUSH_MS. A single record keeps the old {"type":"log"} message;
+ * several go out as one {"type":"logs","entries":[...]} frame. Records the
+ * ring overwrote before they could be sent are reported as "skipped".
+ */
+static void ws_log_task(void *arg)
+{
+    log_entry_t entries[WS_LOG_MAX_PER_FLUSH];
+
+    s_log_cursor = log_ring_head();
+    while (s_running) {
+        vTaskDelay(pdMS_TO_TICKS(WS_LOG_FLUSH_MS));
+
+        if (s_ws_count == 0) {
+            // Nobody listening: don't replay history on the next connect
+            s_log_cursor = log_ring_head();
+            continue;
+        }
+
+        uint32_t skipped = 0;
+        int count = log_ring_read(&s_log_cursor, entries, WS_LOG_MAX_PER_FLUSH, &skipped);
+        s_log_skipped += skipped;
+        if (count == 0) {
+            continue;
+        }
+
+        cJSON *json = cJSON_CreateObject();
+        if (count == 1 && skipped == 0) {
+            cJSON_AddStringToObject(json, "type", "log");
+            cJSON_AddNumberToObject(json, "ts", entries[0].timestamp);
+            cJSON_AddStringToObject(json, "msg", entries[0].message);
+        } else {
+            cJSON_AddStringToObject(json, "type", "logs");
+            cJSON *list = cJSON_AddArrayToObject(json, "entries");
+            for (int i = 0; i < count; i++) {
+                cJSON *entry = cJSON_CreateObject();
+                cJSON_AddNumberToObject(entry, "ts", entries[i].timestamp);
+                cJSON_AddStringToObject(entry, "msg", entries[i].message);
+                cJSON_AddItemToArray(list, entry);
+            }
+            if (skipped) {
+                cJSON_AddNumberToObject(json, "skipped", skipped);
+            }
+        }
+
+        char *json_str = cJSON_PrintUnformatted(json);
+        cJSON_Delete(json);
+        if (json_str) {
+            webserver_ws_broadcast(json_str);
+            cJSON_free(json_str);
+            s_log_streamed += count;
+        }
+    }
+
+    s_ws_log_task = NULL;
+    vTaskDelete(NULL);
+}
+
 // ============================================================================
 // HTTP Handlers
 // ============================================================================
@@ -255,13 +590,6 @@ esp_err_t webserver_start(void)
     }
 
     // Create mutexes with error checking
-    if (s_log_mutex == NULL) {
-        s_log_mutex = xSemaphoreCreateMutex();
-        if (s_log_mutex == NULL) {
-            ESP_LOGE(TAG, "Failed to create log mutex");
-            return ESP_ERR_NO_MEM;
-        }
-    }
     if (s_ws_mutex == NULL) {
         s_ws_mutex = xSemaphoreCreateMutex();
         if (s_ws_mutex == NULL) {
@@ -269,13 +597,37 @@ esp_err_t webserver_start(void)
             return ESP_ERR_NO_MEM;
         }
     }
+    if (s_conn_mutex == NULL) {
+        s_conn_mutex = xSemaphoreCreateMutex();
+        if (s_conn_mutex == NULL) {
+            ESP_LOGE(TAG, "Failed to create connection mutex");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    conn_reset_table();
+    memset(&s_conn_stats, 0, sizeof(s_conn_stats));
+    s_closed_lifetime_ms = 0;
+    s_closed_count = 0;
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = WEBSERVER_PORT;
-    config.stack_size = WEBSERVER_STACK_SIZE;
-    config.max_uri_handlers = 67;  // 31 API + 31 OPTIONS + 2 static (root + ws) + headroom
-    config.max_open_sockets = 7;   // Increased for WebSocket + API calls (max 7 on ESP32)
-    config.lru_purge_enable = false;  // Disabled to prevent WebSocket disconnection
+    config.stack_size = ble_prov_bt_memory_released() ? WEBSERVER_STACK_SIZE_LARGE
+                                                      : WEBSERVER_STACK_SIZE;
+    config.max_uri_handlers = 16;  // /api/* (GET, POST, OPTIONS) + 7 captive + root + ws + headroom
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.max_open_sockets = WEBSERVER_MAX_SOCKETS;
+    // No httpd LRU purge: it goes by request order, not idleness, and would
+    // close a WebSocket or a socket whose request is in flight. conn_make_room
+    // keeps a slot free; with every socket in use new clients wait in the
+    // listen backlog.
+    config.lru_purge_enable = false;
+    config.open_fn = conn_open_cb;
+    config.close_fn = conn_close_cb;
+    // TCP keep-alive so half-open dashboard sockets are detected and freed
+    config.keep_alive_enable = true;
+    config.keep_alive_idle = 30;
+    config.keep_alive_interval = 5;
+    config.keep_alive_count = 3;
 
     ESP_LOGI(TAG, "Starting server on port %d", config.server_port);
 
@@ -289,7 +641,8 @@ esp_err_t webserver_start(void)
     httpd_uri_t root_uri = {
         .uri = "/",
         .method = HTTP_GET,
-        .handler = root_handler
+        .handler = webserver_dispatch,
+        .user_ctx = (void *)root_handler
     };
     httpd_register_uri_handler(s_server, &root_uri);
 
@@ -314,6 +667,9 @@ esp_err_t webserver_start(void)
     if (s_ws_ping_task == NULL) {
         xTaskCreate(ws_ping_task, "ws_ping", 2048, NULL, 3, &s_ws_ping_task);
     }
+    if (s_ws_log_task == NULL) {
+        xTaskCreate(ws_log_task, "ws_log", 4096, NULL, 2, &s_ws_log_task);
+    }
 
     return ESP_OK;
 }
@@ -335,6 +691,7 @@ esp_err_t webserver_stop(void)
     if (ret == ESP_OK) {
         s_server = NULL;
         s_ws_count = 0;
+        conn_reset_table();
         ESP_LOGI(TAG, "Web server stopped");
     }
     return ret;
@@ -21,9 +21,20 @@ extern "C" {
 #define WEBSERVER_PORT              80
 #define WEBSERVER_MAX_CLIENTS       4
 #define WEBSERVER_STACK_SIZE        8192
+#define WEBSERVER_STACK_SIZE_LARGE  12288   // With BT memory reclaimed at boot
 #define WS_MAX_CLIENTS              4
-#define LOG_BUFFER_SIZE             100
+#define WEBSERVER_MAX_SOCKETS       10      // httpd uses 3 more of CONFIG_LWIP_MAX_SOCKETS (16),
+                                            // MQTT + DNS + OTA download the other 3
+#define WEBSERVER_API_RESERVED      4       // Sockets WebSockets may never take
+#define WEBSERVER_IDLE_TIMEOUT_MS   30000   // Close keep-alive HTTP sockets idle this long
+#define WEBSERVER_SWEEP_MS          5000    // Idle sweep / maintenance period
+
+#if WS_MAX_CLIENTS > (WEBSERVER_MAX_SOCKETS - WEBSERVER_API_RESERVED)
+#error "WS_MAX_CLIENTS exceeds the WebSocket socket budget"
+#endif
 #define LOG_LINE_MAX                128
+#define WS_LOG_FLUSH_MS             200     // Log sender period
+#define WS_LOG_MAX_PER_FLUSH        8       // Records per flush (rate limit: 40/s)
 
 // ============================================================================
 // Log Entry Structure
@@ -33,6 +44,32 @@ typedef struct {
     char message[LOG_LINE_MAX];
 } log_entry_t;
 
+// ============================================================================
+// Connection Metrics
+// ============================================================================
+typedef struct {
+    int      fd;
+    bool     websocket;
+    bool     busy;                      // Request handler running on this socket
+    uint32_t requests;                  // Requests served (>1 = keep-alive reuse)
+    uint32_t age_ms;                    // Time since accept
+    uint32_t idle_ms;                   // Time since last request/frame
+} webserver_conn_info_t;
+
+typedef struct {
+    uint8_t  open;                      // Sockets currently open
+    uint8_t  websockets;                // Of which WebSocket clients
+    uint8_t  max_sockets;
+    uint8_t  ws_budget;
+    uint32_t accepted;                  // Sockets accepted since start
+    uint32_t requests;                  // HTTP requests dispatched
+    uint32_t reused;                    // Requests served on an already used socket
+    uint32_t idle_closed;               // Closed by the idle sweep
+    uint32_t evicted;                   // Closed to keep a free slot for new clients
+    uint32_t ws_rejected;               // WebSocket upgrades refused (budget exhausted)
+    uint32_t avg_lifetime_ms;           // Mean lifetime of closed sockets
+} webserver_conn_stats_t;
+
 // ============================================================================
 // Public Functions
 // ============================================================================
@@ -62,7 +99,9 @@ bool webserver_is_running(void);
 httpd_handle_t webserver_get_handle(void);
 
 /**
- * Add a log entry (will be sent to WebSocket clients)
+ * Add a log entry (streamed to WebSocket clients in the background)
+ * Only the format pointer and raw arguments are captured, so the format must
+ * be a string literal. See log_ring.h.
  * @param format Printf-style format string
  */
 void webserver_log(const char *format, ...);
@@ -81,6 +120,30 @@ void webserver_ws_broadcast(const char *message);
  */
 int webserver_get_logs(log_entry_t *entries, int max_entries);
 
+/**
+ * Get WebSocket log streaming counters
+ * @param streamed  Records sent to clients (may be NULL)
+ * @param skipped   Records overwritten before they could be sent (may be NULL)
+ */
+void webserver_get_log_stream_stats(uint32_t *streamed, uint32_t *skipped);
+
+/**
+ * Dispatch an API request to its handler with connection tracking
+ * Register with the real handler in user_ctx.
+ * @param req HTTP request
+ * @return Handler result
+ */
+esp_err_t webserver_dispatch(httpd_req_t *req);
+
+/**
+ * Get connection manager counters and per-socket details
+ * @param stats       Output counters
+ * @param conns       Output per-socket entries (may be NULL)
+ * @param max_conns   Size of conns
+ * @return Number of entries written to conns
+ */
+int webserver_get_conn_stats(webserver_conn_stats_t *stats, webserver_conn_info_t *conns, int max_conns);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,10 +7,26 @@
 #include "wifi_manager.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
 
 static const char *TAG = "WIFI_MGR";
 static bool s_initialized = false;
 
+// ============================================================================
+// Scan Cache State
+// ============================================================================
+static SemaphoreHandle_t s_scan_mutex = NULL;
+static TaskHandle_t s_scan_task = NULL;
+static wifi_scan_entry_t s_scan_results[WIFI_SCAN_MAX_RESULTS];
+static int s_scan_count = 0;
+static wifi_scan_info_t s_scan_info = {0};
+static int64_t s_last_request = 0;
+
 esp_err_t wifi_manager_init(void)
 {
     ESP_LOGI(TAG, "WiFi manager init (mesh handles WiFi)");
@@ -34,3 +50,189 @@ bool wifi_manager_is_connected(void)
     wifi_ap_record_t ap_info;
     return (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK);
 }
+
+// ============================================================================
+// Background Scan Service
+// ============================================================================
+
+static int64_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+// Radio scan, runs in the scan task only
+static void do_scan(void)
+{
+    wifi_scan_config_t scan_config = {
+        .ssid = NULL,
+        .bssid = NULL,
+        .channel = 0,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active.min = 100,
+        .scan_time.active.max = 300,
+    };
+
+    int64_t start = now_ms();
+    esp_err_t err = esp_wifi_scan_start(&scan_config, true);
+
+    uint16_t ap_count = 0;
+    wifi_ap_record_t *ap_list = NULL;
+    if (err == ESP_OK) {
+        esp_wifi_scan_get_ap_num(&ap_count);
+        if (ap_count > WIFI_SCAN_MAX_RESULTS) ap_count = WIFI_SCAN_MAX_RESULTS;  // Limit results
+        ap_list = malloc(sizeof(wifi_ap_record_t) * (ap_count ? ap_count : 1));
+        if (ap_list == NULL) {
+            err = ESP_ERR_NO_MEM;
+            esp_wifi_clear_ap_list();
+        } else {
+            esp_wifi_scan_get_ap_records(&ap_count, ap_list);
+        }
+    }
+
+    uint32_t duration = (uint32_t)(now_ms() - start);
+
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+    s_scan_info.radio_scans++;
+    s_scan_info.last_error = err;
+    s_scan_info.last_duration_ms = duration;
+    if (err == ESP_OK) {
+        // Unique SSIDs, strongest BSS wins
+        s_scan_count = 0;
+        for (int i = 0; i < ap_count; i++) {
+            const char *ssid = (const char *)ap_list[i].ssid;
+            if (strlen(ssid) == 0) continue;
+
+            int j;
+            for (j = 0; j < s_scan_count; j++) {
+                if (strcmp(s_scan_results[j].ssid, ssid) == 0) break;
+            }
+            if (j < s_scan_count) {
+                if (ap_list[i].rssi > s_scan_results[j].rssi) {
+                    s_scan_results[j].rssi = ap_list[i].rssi;
+                    s_scan_results[j].channel = ap_list[i].primary;
+                }
+                continue;
+            }
+
+            wifi_scan_entry_t *entry = &s_scan_results[s_scan_count++];
+            strlcpy(entry->ssid, ssid, sizeof(entry->ssid));
+            entry->rssi = ap_list[i].rssi;
+            entry->channel = ap_list[i].primary;
+            entry->secure = ap_list[i].authmode != WIFI_AUTH_OPEN;
+        }
+        s_scan_info.timestamp_ms = now_ms();
+    }
+    // Waiters watch the generation, so bump it on failure too
+    s_scan_info.generation++;
+    s_scan_info.scanning = false;
+    xSemaphoreGive(s_scan_mutex);
+
+    free(ap_list);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "WiFi scan #%lu: %d networks in %lu ms",
+                 (unsigned long)s_scan_info.radio_scans, s_scan_count, (unsigned long)duration);
+    } else {
+        ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void wifi_scan_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "WiFi scan service started");
+
+    while (1) {
+        // On-demand scans notify; otherwise wake up for the scheduled refresh
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WIFI_SCAN_REFRESH_MS));
+
+        if (!notified) {
+            xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+            bool in_use = (now_ms() - s_last_request) < WIFI_SCAN_IDLE_MS;
+            if (in_use) {
+                s_scan_info.scanning = true;
+            }
+            xSemaphoreGive(s_scan_mutex);
+
+            // Nobody is looking: leave the radio alone
+            if (!in_use) {
+                continue;
+            }
+        }
+
+        do_scan();
+    }
+}
+
+esp_err_t wifi_manager_scan_request(bool force)
+{
+    if (s_scan_mutex == NULL) {
+        s_scan_mutex = xSemaphoreCreateMutex();
+        if (s_scan_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+
+    if (s_scan_task == NULL) {
+        if (xTaskCreate(wifi_scan_task, "wifi_scan", 4096, NULL, 3, &s_scan_task) != pdPASS) {
+            s_scan_task = NULL;
+            xSemaphoreGive(s_scan_mutex);
+            ESP_LOGE(TAG, "Failed to create scan task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    int64_t now = now_ms();
+    s_last_request = now;
+    s_scan_info.requests++;
+
+    bool stale = s_scan_info.timestamp_ms == 0 ||
+                 (now - s_scan_info.timestamp_ms) > WIFI_SCAN_MAX_AGE_MS;
+
+    if (s_scan_info.scanning) {
+        s_scan_info.coalesced++;
+    } else if (force || stale) {
+        s_scan_info.scanning = true;
+        xTaskNotifyGive(s_scan_task);
+    }
+
+    xSemaphoreGive(s_scan_mutex);
+    return ESP_OK;
+}
+
+esp_err_t wifi_manager_scan_wait(uint32_t after_generation, uint32_t timeout_ms)
+{
+    int64_t start = now_ms();
+
+    while (s_scan_info.generation <= after_generation) {
+        if ((now_ms() - start) >= timeout_ms) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    return ESP_OK;
+}
+
+int wifi_manager_scan_get_results(wifi_scan_entry_t *out, int max, wifi_scan_info_t *info)
+{
+    if (s_scan_mutex == NULL) {
+        if (info) memset(info, 0, sizeof(*info));
+        return 0;
+    }
+
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+
+    int count = 0;
+    if (out != NULL) {
+        count = (s_scan_count < max) ? s_scan_count : max;
+        memcpy(out, s_scan_results, sizeof(wifi_scan_entry_t) * count);
+    }
+    if (info) {
+        *info = s_scan_info;
+    }
+
+    xSemaphoreGive(s_scan_mutex);
+    return count;
+}
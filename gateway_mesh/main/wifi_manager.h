@@ -7,17 +7,70 @@
 #define WIFI_MANAGER_H
 
 #include "esp_err.h"
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// ============================================================================
+// Scan Cache Configuration
+// ============================================================================
+#define WIFI_SCAN_MAX_RESULTS       20      // Unique SSIDs kept in cache
+#define WIFI_SCAN_MAX_AGE_MS        30000   // Older results trigger a background refresh
+#define WIFI_SCAN_REFRESH_MS        60000   // Scheduled refresh while clients are asking
+#define WIFI_SCAN_IDLE_MS           120000  // No scheduled refresh after this long without requests
+
+typedef struct {
+    char     ssid[33];
+    int8_t   rssi;
+    uint8_t  channel;
+    bool     secure;
+} wifi_scan_entry_t;
+
+typedef struct {
+    uint32_t generation;            // Incremented on every completed scan (0 = never scanned)
+    int64_t  timestamp_ms;          // When the cached results were taken
+    bool     scanning;              // Radio scan in progress
+    esp_err_t last_error;           // Result of the last radio scan
+    uint32_t last_duration_ms;      // Duration of the last radio scan
+    uint32_t radio_scans;           // Radio scans since boot
+    uint32_t requests;              // Scan requests since boot
+    uint32_t coalesced;             // Requests that joined a scan already in progress
+} wifi_scan_info_t;
+
 esp_err_t wifi_manager_init(void);
 esp_err_t wifi_manager_start(void);
 esp_err_t wifi_manager_stop(void);
 bool wifi_manager_is_connected(void);
 
+/**
+ * Request scan results (non-blocking)
+ * Starts the scan service on first use. A radio scan is started if the cache
+ * is empty or stale, or if force is set; concurrent requests share one scan.
+ * @param force  Scan even if cached results are fresh
+ * @return ESP_OK on success
+ */
+esp_err_t wifi_manager_scan_request(bool force);
+
+/**
+ * Wait for a scan newer than the given generation
+ * @param after_generation  Generation seen by the caller
+ * @param timeout_ms        Maximum wait
+ * @return ESP_OK if newer results are available, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t wifi_manager_scan_wait(uint32_t after_generation, uint32_t timeout_ms);
+
+/**
+ * Copy cached scan results
+ * @param out   Output array (may be NULL to query info only)
+ * @param max   Capacity of out
+ * @param info  Cache info and counters (may be NULL)
+ * @return Number of entries copied
+ */
+int wifi_manager_scan_get_results(wifi_scan_entry_t *out, int max, wifi_scan_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "espnow_ota.h"         // MSG_OTA_*
+#include "espnow_discovery.h"   // MSG_DISCOVERY*
 
 // ============================================
 // MESSAGE TYPES (compatible with Gateway)
@@ -17,19 +19,6 @@
 #define MSG_COMMAND_ACK     0x21
 #define MSG_STATE           0x22
 
-// Discovery messages (for channel scan)
-#define MSG_DISCOVERY       0x30
-#define MSG_DISCOVERY_ACK   0x31
-
-// OTA message types
-#define MSG_OTA_BEGIN       0x10
-#define MSG_OTA_READY       0x11
-#define MSG_OTA_DATA        0x12
-#define MSG_OTA_ACK         0x13
-#define MSG_OTA_END         0x14
-#define MSG_OTA_DONE        0x15
-#define MSG_OTA_ERROR       0x1F
-
 // ============================================
 // LED STRIP COMMAND TYPES (0x40-0x4F range)
 // ============================================
@@ -47,6 +36,16 @@
 #define LED_CMD_SET_SPEED   0x05    // Set effect speed: [0-255]
 #define LED_CMD_SET_NUM_LEDS 0x06   // Set number of LEDs: [low_byte, high_byte]
 #define LED_CMD_CUSTOM_EFFECT 0x07  // Custom 3-color rainbow: [r1,g1,b1,r2,g2,b2,r3,g3,b3]
+#define LED_CMD_PALETTE     0x08    // Palette: [id, flags, encoded...] (no data = select id)
+#define LED_CMD_SCRIPT      0x09    // Effect program: [id, flags, program...] (no data = select id)
+
+// LED_CMD_PALETTE flags
+#define LED_PALETTE_FLAG_STORE  0x01    // Save in bank slot id
+#define LED_PALETTE_FLAG_SELECT 0x02    // Use it now
+
+// LED_CMD_SCRIPT flags
+#define LED_SCRIPT_FLAG_STORE   0x01    // Save in bank slot id
+#define LED_SCRIPT_FLAG_SELECT  0x02    // Run it now
 
 // Effect IDs
 #define EFFECT_STATIC       0x00    // Solid color
@@ -55,7 +54,10 @@
 #define EFFECT_CHASE        0x03    // Chase/running light
 #define EFFECT_SPARKLE      0x04    // Random sparkle
 #define EFFECT_FIRE         0x05    // Fire simulation
-#define EFFECT_CUSTOM       0x06    // Custom 3-color rainbow
+#define EFFECT_CUSTOM       0x06    // Palette cycle (custom 3 colors or a palette)
+#define EFFECT_FLASH        0x07    // Whole strip on/off
+#define EFFECT_GRADIENT     0x08    // Palette stretched over the strip
+#define EFFECT_SCRIPT       0x09    // Uploaded effect program
 
 // Device type identifier
 #define DEVICE_TYPE_LED_STRIP  0x10
@@ -65,13 +67,15 @@
 // ============================================
 
 /**
- * Scan all WiFi channels (1-13) to find Gateway
+ * Find the Gateway: saved channel, then passive listen, then active probe
+ * of channels 1-13. Saves the channel if it changed and starts watching
+ * for the gateway moving.
  * @return Channel where Gateway was found, or 0 if not found
  */
 uint8_t espnow_channel_scan(void);
 
 /**
- * Initialize ESP-NOW on specific channel
+ * Initialize ESP-NOW on specific channel (no discovery)
  * @param wifi_channel Channel to use
  */
 void espnow_handler_init(uint8_t wifi_channel);
@@ -86,17 +90,6 @@ bool espnow_is_gateway_known(void);
  */
 uint32_t espnow_get_last_heartbeat_time(void);
 
-/**
- * Save channel to NVS
- */
-void espnow_save_channel(uint8_t channel);
-
-/**
- * Load channel from NVS
- * @return Saved channel, or 0 if not saved
- */
-uint8_t espnow_load_channel(void);
-
 /**
  * Send current LED state as ACK to Gateway
  */
@@ -1,5 +1,5 @@
 #include "led_controller.h"
-#include "effects.h"
+#include "led_render.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -21,6 +21,8 @@ static const char *TAG = "LED_CTRL";
 #define NVS_KEY_EFFECT "effect"
 #define NVS_KEY_SPEED "speed"
 #define NVS_KEY_NUM_LEDS "num_leds"
+#define NVS_KEY_PALETTE "palette"
+#define NVS_KEY_SCRIPT "script"
 
 // LED strip handle
 static led_strip_handle_t s_led_strip = NULL;
@@ -36,7 +38,9 @@ static led_state_t s_state = {
     .b = 255,
     .brightness = 255,
     .effect_id = 0,  // EFFECT_STATIC
-    .effect_speed = 128
+    .effect_speed = 128,
+    .palette_id = LED_PALETTE_NONE,
+    .script_id = LED_SCRIPT_NONE
 };
 
 // ============================================
@@ -82,6 +86,34 @@ static esp_err_t led_strip_create(void) {
     return ESP_OK;
 }
 
+// Render task output: push a changed frame to the strip
+static void led_flush(const uint8_t *rgb, uint16_t count) {
+    if (s_led_strip == NULL) return;
+
+    for (int i = 0; i < count; i++) {
+        led_strip_set_pixel(s_led_strip, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+    }
+    led_strip_refresh(s_led_strip);
+}
+
+// Push the saved state to the renderer
+static void led_apply_state(void) {
+    led_render_set_color(s_state.r, s_state.g, s_state.b);
+    led_render_set_brightness(s_state.brightness);
+    led_render_set_speed(s_state.effect_speed);
+    led_render_set_effect((effect_type_t)s_state.effect_id);
+}
+
+// Palette effects keep the palette, everything else switches to the cycle
+static void led_use_palette_effect(void) {
+    if (s_state.effect_id != EFFECT_TYPE_GRADIENT) {
+        s_state.effect_id = EFFECT_TYPE_CUSTOM;
+        led_render_set_effect(EFFECT_TYPE_CUSTOM);
+    }
+    s_state.power = true;  // Auto power on
+    led_render_set_power(true);
+}
+
 void led_controller_init(void) {
     // Load num_leds from NVS first (before creating strip)
     nvs_handle_t handle;
@@ -101,8 +133,14 @@ void led_controller_init(void) {
     // Create LED strip
     ESP_ERROR_CHECK(led_strip_create());
 
-    // Initialize effects system
-    effects_init();
+    // Start the renderer (frame clock, effects, dirty tracking)
+    led_render_config_t render_config = {
+        .max_leds = LED_STRIP_MAX_LEDS,
+        .num_leds = led_num_leds,
+        .frame_ms = LED_RENDER_FRAME_MS,
+        .flush = led_flush,
+    };
+    ESP_ERROR_CHECK(led_render_init(&render_config));
 
     // Load saved state from NVS
     led_load_state();
@@ -112,12 +150,16 @@ void led_controller_init(void) {
              s_state.brightness, s_state.effect_id, led_num_leds);
 
     // Apply loaded state
-    if (s_state.power) {
-        effects_set_color(s_state.r, s_state.g, s_state.b);
-        effects_set_brightness(s_state.brightness);
-        effects_set_type((effect_type_t)s_state.effect_id);
-        effects_set_speed(s_state.effect_speed);
+    if (s_state.palette_id != LED_PALETTE_NONE &&
+        led_render_select_palette(s_state.palette_id) != ESP_OK) {
+        s_state.palette_id = LED_PALETTE_NONE;
+    }
+    if (s_state.script_id != LED_SCRIPT_NONE &&
+        led_render_select_script(s_state.script_id) != ESP_OK) {
+        s_state.script_id = LED_SCRIPT_NONE;
     }
+    led_apply_state();
+    led_render_set_power(s_state.power);
 }
 
 // ============================================
@@ -126,16 +168,14 @@ void led_controller_init(void) {
 
 void led_set_power_on(void) {
     s_state.power = true;
-    effects_set_color(s_state.r, s_state.g, s_state.b);
-    effects_set_brightness(s_state.brightness);
-    effects_set_type((effect_type_t)s_state.effect_id);
+    led_apply_state();
+    led_render_set_power(true);
     ESP_LOGI(TAG, "LED Power ON");
 }
 
 void led_set_power_off(void) {
     s_state.power = false;
-    led_clear();
-    led_refresh();
+    led_render_set_power(false);
     ESP_LOGI(TAG, "LED Power OFF");
 }
 
@@ -149,9 +189,10 @@ void led_set_color(uint8_t r, uint8_t g, uint8_t b) {
     s_state.b = b;
     s_state.power = true;  // Auto power on
 
-    effects_set_color(r, g, b);
+    led_render_set_color(r, g, b);
     // Set to static effect when color is set directly
-    effects_set_type(EFFECT_TYPE_STATIC);
+    led_render_set_effect(EFFECT_TYPE_STATIC);
+    led_render_set_power(true);
     s_state.effect_id = 0;  // EFFECT_STATIC
 
     ESP_LOGI(TAG, "Color set: R=%d G=%d B=%d", r, g, b);
@@ -159,7 +200,7 @@ void led_set_color(uint8_t r, uint8_t g, uint8_t b) {
 
 void led_set_brightness(uint8_t brightness) {
     s_state.brightness = brightness;
-    effects_set_brightness(brightness);
+    led_render_set_brightness(brightness);
     ESP_LOGI(TAG, "Brightness set: %d", brightness);
 }
 
@@ -175,14 +216,14 @@ void led_set_effect(uint8_t effect_id) {
 
     s_state.effect_id = effect_id;
     s_state.power = true;  // Auto power on
-    effects_set_type((effect_type_t)effect_id);
-    effects_reset();  // Reset animation state
+    led_render_set_effect((effect_type_t)effect_id);  // Restarts the animation
+    led_render_set_power(true);
     ESP_LOGI(TAG, "Effect set: %d", effect_id);
 }
 
 void led_set_effect_speed(uint8_t speed) {
     s_state.effect_speed = speed;
-    effects_set_speed(speed);
+    led_render_set_speed(speed);
     ESP_LOGI(TAG, "Effect speed set: %d", speed);
 }
 
@@ -190,63 +231,110 @@ void led_set_custom_effect(uint8_t r1, uint8_t g1, uint8_t b1,
                            uint8_t r2, uint8_t g2, uint8_t b2,
                            uint8_t r3, uint8_t g3, uint8_t b3) {
     s_state.effect_id = EFFECT_TYPE_CUSTOM;
+    s_state.palette_id = LED_PALETTE_NONE;
     s_state.power = true;  // Auto power on
 
     // Set the custom colors
-    effects_set_custom_colors(r1, g1, b1, r2, g2, b2, r3, g3, b3);
+    led_render_set_custom_colors(r1, g1, b1, r2, g2, b2, r3, g3, b3);
 
     // Switch to custom effect
-    effects_set_type(EFFECT_TYPE_CUSTOM);
-    effects_reset();
+    led_render_set_effect(EFFECT_TYPE_CUSTOM);
+    led_render_set_power(true);
 
     ESP_LOGI(TAG, "Custom effect set: (%d,%d,%d) (%d,%d,%d) (%d,%d,%d)",
              r1, g1, b1, r2, g2, b2, r3, g3, b3);
 }
 
 // ============================================
-// STATE ACCESS
+// PALETTES
 // ============================================
 
-led_state_t* led_get_state(void) {
-    return &s_state;
+bool led_store_palette(uint8_t id, const uint8_t *encoded, size_t len) {
+    esp_err_t err = led_palette_bank_store(id, encoded, len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Palette %d not stored: %s", id, esp_err_to_name(err));
+        return false;
+    }
+    return true;
 }
 
-// ============================================
-// UPDATE (call in main loop)
-// ============================================
+bool led_set_palette(const uint8_t *encoded, size_t len, uint8_t bank_id) {
+    esp_err_t err = led_render_set_palette(encoded, len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid palette (%d bytes): %s", (int)len, esp_err_to_name(err));
+        return false;
+    }
 
-void led_update(void) {
-    if (!s_state.power) return;
+    s_state.palette_id = bank_id;
+    led_use_palette_effect();
+    ESP_LOGI(TAG, "Palette set: %d %s, bank=%d", encoded[0] & LED_PALETTE_COUNT_MASK,
+             (encoded[0] & LED_PALETTE_GRADIENT) ? "stops" : "entries", bank_id);
+    return true;
+}
 
-    if (effects_update()) {
-        led_refresh();
+bool led_select_palette(uint8_t id) {
+    if (led_render_select_palette(id) != ESP_OK) {
+        return false;
     }
+
+    s_state.palette_id = id;
+    led_use_palette_effect();
+    ESP_LOGI(TAG, "Palette selected: %d", id);
+    return true;
 }
 
 // ============================================
-// LOW-LEVEL LED FUNCTIONS
+// SCRIPTS
 // ============================================
 
-void led_set_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
-    if (index >= led_num_leds || s_led_strip == NULL) return;
+bool led_store_script(uint8_t id, const uint8_t *encoded, size_t len) {
+    esp_err_t err = led_render_check_script(encoded, len);
+    if (err == ESP_OK) {
+        err = led_script_bank_store(id, encoded, len);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Script %d not stored: %s", id, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
 
-    // Apply brightness
-    uint8_t bright = s_state.brightness;
-    r = (r * bright) / 255;
-    g = (g * bright) / 255;
-    b = (b * bright) / 255;
+bool led_set_script(const uint8_t *encoded, size_t len, uint8_t bank_id) {
+    esp_err_t err = led_render_set_script(encoded, len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Script rejected (%d bytes): %s", (int)len, esp_err_to_name(err));
+        return false;
+    }
 
-    led_strip_set_pixel(s_led_strip, index, r, g, b);
+    s_state.script_id = bank_id;
+    s_state.effect_id = EFFECT_TYPE_SCRIPT;
+    s_state.power = true;  // Auto power on
+    led_render_set_effect(EFFECT_TYPE_SCRIPT);
+    led_render_set_power(true);
+    ESP_LOGI(TAG, "Script set: %d bytes, bank=%d", (int)len, bank_id);
+    return true;
 }
 
-void led_refresh(void) {
-    if (s_led_strip == NULL) return;
-    led_strip_refresh(s_led_strip);
+bool led_select_script(uint8_t id) {
+    if (led_render_select_script(id) != ESP_OK) {
+        return false;
+    }
+
+    s_state.script_id = id;
+    s_state.effect_id = EFFECT_TYPE_SCRIPT;
+    s_state.power = true;  // Auto power on
+    led_render_set_effect(EFFECT_TYPE_SCRIPT);
+    led_render_set_power(true);
+    ESP_LOGI(TAG, "Script selected: %d", id);
+    return true;
 }
 
-void led_clear(void) {
-    if (s_led_strip == NULL) return;
-    led_strip_clear(s_led_strip);
+// ============================================
+// STATE ACCESS
+// ============================================
+
+led_state_t* led_get_state(void) {
+    return &s_state;
 }
 
 // ============================================
@@ -268,6 +356,8 @@ void led_save_state(void) {
     nvs_set_u8(handle, NVS_KEY_BRIGHTNESS, s_state.brightness);
     nvs_set_u8(handle, NVS_KEY_EFFECT, s_state.effect_id);
     nvs_set_u8(handle, NVS_KEY_SPEED, s_state.effect_speed);
+    nvs_set_u8(handle, NVS_KEY_PALETTE, s_state.palette_id);
+    nvs_set_u8(handle, NVS_KEY_SCRIPT, s_state.script_id);
 
     nvs_commit(handle);
     nvs_close(handle);
@@ -291,6 +381,8 @@ void led_load_state(void) {
     if (nvs_get_u8(handle, NVS_KEY_BRIGHTNESS, &val) == ESP_OK) s_state.brightness = val;
     if (nvs_get_u8(handle, NVS_KEY_EFFECT, &val) == ESP_OK) s_state.effect_id = val;
     if (nvs_get_u8(handle, NVS_KEY_SPEED, &val) == ESP_OK) s_state.effect_speed = val;
+    if (nvs_get_u8(handle, NVS_KEY_PALETTE, &val) == ESP_OK) s_state.palette_id = val;
+    if (nvs_get_u8(handle, NVS_KEY_SCRIPT, &val) == ESP_OK) s_state.script_id = val;
 
     nvs_close(handle);
 
@@ -314,27 +406,24 @@ bool led_set_num_leds(uint16_t num) {
 
     ESP_LOGI(TAG, "Setting num_leds: %d -> %d", led_num_leds, num);
 
-    // Save current power state
-    bool was_on = s_state.power;
-
-    // Turn off before reinitializing
-    if (was_on) {
-        led_set_power_off();
-    }
+    // Keep the render task off the strip while it is recreated
+    led_render_pause();
 
     // Update value
     led_num_leds = num;
 
     // Reinitialize strip with new number
     esp_err_t err = led_strip_create();
+
+    // Update renderer with new LED count (next frame is pushed in full)
+    led_render_set_num_leds(num);
+    led_render_resume();
+
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to reinitialize strip with %d LEDs", num);
         return false;
     }
 
-    // Update effects system with new LED count
-    effects_set_num_leds(num);
-
     // Save to NVS
     nvs_handle_t handle;
     if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
@@ -344,11 +433,6 @@ bool led_set_num_leds(uint16_t num) {
         ESP_LOGI(TAG, "num_leds saved to NVS: %d", num);
     }
 
-    // Restore power state
-    if (was_on) {
-        led_set_power_on();
-    }
-
     ESP_LOGI(TAG, "LED strip reconfigured: %d LEDs", num);
     return true;
 }
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // ============================================
 // LED STRIP CONFIGURATION
@@ -26,6 +27,8 @@ typedef struct {
     uint8_t brightness;     // Brightness (0-255)
     uint8_t effect_id;      // Current effect
     uint8_t effect_speed;   // Effect speed (0-255)
+    uint8_t palette_id;     // Bank palette in use (LED_PALETTE_NONE = none)
+    uint8_t script_id;      // Bank script in use (LED_SCRIPT_NONE = none)
 } led_state_t;
 
 // ============================================
@@ -33,7 +36,8 @@ typedef struct {
 // ============================================
 
 /**
- * Initialize LED strip (RMT driver)
+ * Initialize LED strip (RMT driver) and start the renderer
+ * Effects are animated by the render task; no main loop polling needed.
  */
 void led_controller_init(void);
 
@@ -81,40 +85,62 @@ void led_set_custom_effect(uint8_t r1, uint8_t g1, uint8_t b1,
                            uint8_t r3, uint8_t g3, uint8_t b3);
 
 /**
- * Get current LED state
+ * Save a palette in the NVS bank
+ * @param id Slot (0-7)
+ * @param encoded Compact palette encoding (see led_palette.h)
+ * @return true if stored
  */
-led_state_t* led_get_state(void);
+bool led_store_palette(uint8_t id, const uint8_t *encoded, size_t len);
 
 /**
- * Update LED strip (call in main loop for effects)
- * Should be called every ~20ms for smooth animations
+ * Use a palette for the palette effects
+ * Switches to the palette cycle unless the gradient effect is active.
+ * @param bank_id Bank slot it came from, restored at boot (LED_PALETTE_NONE = unsaved)
+ * @return true if applied
  */
-void led_update(void);
+bool led_set_palette(const uint8_t *encoded, size_t len, uint8_t bank_id);
 
 /**
- * Save current state to NVS
+ * Use a palette from the NVS bank
+ * @return true if the slot holds a palette
  */
-void led_save_state(void);
+bool led_select_palette(uint8_t id);
 
 /**
- * Load state from NVS
+ * Save an effect program in the NVS bank
+ * @param id Slot (0-3)
+ * @param encoded Program (see led_script.h)
+ * @return true if stored
  */
-void led_load_state(void);
+bool led_store_script(uint8_t id, const uint8_t *encoded, size_t len);
+
+/**
+ * Run an effect program (switches to the script effect)
+ * @param bank_id Bank slot it came from, restored at boot (LED_SCRIPT_NONE = unsaved)
+ * @return true if the program was accepted
+ */
+bool led_set_script(const uint8_t *encoded, size_t len, uint8_t bank_id);
 
 /**
- * Set a single LED color (internal use)
+ * Run an effect program from the NVS bank
+ * @return true if the slot holds a program
  */
-void led_set_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b);
+bool led_select_script(uint8_t id);
 
 /**
- * Refresh LED strip (push buffer to hardware)
+ * Get current LED state
  */
-void led_refresh(void);
+led_state_t* led_get_state(void);
 
 /**
- * Clear all LEDs (set to black)
+ * Save current state to NVS
  */
-void led_clear(void);
+void led_save_state(void);
+
+/**
+ * Load state from NVS
+ */
+void led_load_state(void);
 
 /**
  * Set number of LEDs and reinitialize strip
@@ -9,7 +9,6 @@
 
 #include "espnow_handler.h"
 #include "led_controller.h"
-#include "effects.h"
 
 static const char *TAG = "OMNIAPI_LED";
 
@@ -46,67 +45,30 @@ void app_main(void)
     led_set_power_off();
     ESP_LOGI(TAG, "=== TEST LED COMPLETATO ===");
 
-    // ========== CHANNEL SCAN LOGIC ==========
+    // ========== GATEWAY DISCOVERY ==========
+    // Saved channel first, then passive listen, then active probing
     uint8_t channel = 0;
 
-    // 1. Try to load saved channel from NVS
-    channel = espnow_load_channel();
+    // Yellow chase effect during scan (animated by the render task)
+    led_set_color(255, 200, 0);
+    led_set_effect(EFFECT_CHASE);
 
-    if (channel > 0 && channel <= 13) {
-        ESP_LOGI(TAG, "Using saved channel %d from NVS", channel);
-        espnow_handler_init(channel);
+    while (channel == 0) {
+        channel = espnow_channel_scan();
 
-        // Wait a bit and check if gateway responds
-        // Blue breathing effect while waiting
-        led_set_color(0, 0, 255);
-        led_set_effect(EFFECT_BREATHING);
-
-        for (int i = 0; i < 100; i++) {  // 2 seconds
-            led_update();
-            vTaskDelay(pdMS_TO_TICKS(20));
+        if (channel > 0) break;
 
-            if (espnow_is_gateway_known()) {
-                break;
-            }
-        }
+        ESP_LOGW(TAG, "Gateway not found, retrying in 5 seconds...");
 
-        if (!espnow_is_gateway_known()) {
-            ESP_LOGW(TAG, "Gateway not responding on saved channel, rescanning...");
-            channel = 0;  // Force rescan
-        }
-    }
+        // Red breathing while waiting to retry
+        led_set_color(255, 0, 0);
+        led_set_effect(EFFECT_BREATHING);
 
-    // 2. If no saved channel or gateway not found, scan all channels
-    if (channel == 0) {
-        ESP_LOGI(TAG, "Starting channel scan...");
+        vTaskDelay(pdMS_TO_TICKS(5000));
 
-        // Yellow chase effect during scan
+        // Back to yellow chase for next scan
         led_set_color(255, 200, 0);
         led_set_effect(EFFECT_CHASE);
-
-        // Scan with visual feedback
-        while (channel == 0) {
-            for (int scan_attempt = 0; scan_attempt < 2; scan_attempt++) {
-                channel = espnow_channel_scan();
-
-                if (channel > 0) break;
-
-                ESP_LOGW(TAG, "Gateway not found, retrying in 5 seconds...");
-
-                // Red breathing while waiting to retry
-                led_set_color(255, 0, 0);
-                led_set_effect(EFFECT_BREATHING);
-
-                for (int i = 0; i < 250; i++) {  // 5 seconds
-                    led_update();
-                    vTaskDelay(pdMS_TO_TICKS(20));
-                }
-
-                // Back to yellow chase for next scan
-                led_set_color(255, 200, 0);
-                led_set_effect(EFFECT_CHASE);
-            }
-        }
     }
 
     // ========== SUCCESS ==========
@@ -140,22 +102,14 @@ void app_main(void)
     // ========== MAIN LOOP ==========
     ESP_LOGI(TAG, "Entering main loop...");
 
-    uint32_t loop_count = 0;
-
     while (1) {
-        // Update LED effects (~50Hz for smooth animations)
-        led_update();
-
-        // Log heartbeat status periodically
-        if (++loop_count >= 1000) {  // Every ~20 seconds
-            loop_count = 0;
-            uint32_t last_hb = espnow_get_last_heartbeat_time();
-            uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            ESP_LOGI(TAG, "Status: Gateway=%s, LastHB=%lums ago",
-                     espnow_is_gateway_known() ? "OK" : "LOST",
-                     (unsigned long)(now - last_hb));
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(20));  // ~50Hz update rate
+        // LED effects run in the render task; just log heartbeat status
+        vTaskDelay(pdMS_TO_TICKS(20000));
+
+        uint32_t last_hb = espnow_get_last_heartbeat_time();
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        ESP_LOGI(TAG, "Status: Gateway=%s, LastHB=%lums ago",
+                 espnow_is_gateway_known() ? "OK" : "LOST",
+                 (unsigned long)(now - last_hb));
     }
 }
@@ -34,42 +34,20 @@ void app_main(void)
     // LED pattern: avvio (blink veloce)
     led_blink(3, 100);
 
-    // === CHANNEL SCAN LOGIC ===
-    uint8_t channel = 0;
+    // === GATEWAY DISCOVERY ===
+    // Saved channel first, then passive listen, then active probing
+    led_blink(10, 50);  // Fast blink during scan
+    uint8_t channel = espnow_channel_scan();
 
-    // 1. Try to load saved channel from NVS
-    channel = espnow_load_channel();
-
-    if (channel > 0 && channel <= 13) {
-        ESP_LOGI(TAG, "Using saved channel %d from NVS", channel);
-        espnow_handler_init(channel);
-
-        // Wait a bit and check if gateway responds
-        vTaskDelay(pdMS_TO_TICKS(2000));
-
-        if (!espnow_is_gateway_known()) {
-            ESP_LOGW(TAG, "Gateway not responding on saved channel, rescanning...");
-            channel = 0;  // Force rescan
-        }
-    }
-
-    // 2. If no saved channel or gateway not found, scan all channels
     if (channel == 0) {
-        ESP_LOGI(TAG, "Starting channel scan...");
-        led_blink(10, 50);  // Fast blink during scan
-
-        channel = espnow_channel_scan();
-
-        if (channel == 0) {
-            ESP_LOGE(TAG, "Gateway NOT FOUND on any channel!");
-            ESP_LOGI(TAG, "Will retry scan every 30 seconds...");
-
-            // Retry loop
-            while (channel == 0) {
-                led_blink(2, 500);  // Slow blink = searching
-                vTaskDelay(pdMS_TO_TICKS(30000));
-                channel = espnow_channel_scan();
-            }
+        ESP_LOGE(TAG, "Gateway NOT FOUND on any channel!");
+        ESP_LOGI(TAG, "Will retry scan every 30 seconds...");
+
+        // Retry loop
+        while (channel == 0) {
+            led_blink(2, 500);  // Slow blink = searching
+            vTaskDelay(pdMS_TO_TICKS(30000));
+            channel = espnow_channel_scan();
         }
     }
 
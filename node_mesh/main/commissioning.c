@@ -8,6 +8,7 @@
 #include "commissioning.h"
 #include "nvs_storage.h"
 #include "mesh_node.h"
+#include "ota_receiver.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_system.h"
@@ -138,11 +139,13 @@ void commissioning_handle_scan_request(const omniapi_message_t *msg)
     resp->device_type = DEVICE_TYPE_RELAY;
 #elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
     resp->device_type = DEVICE_TYPE_LED_STRIP;
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    resp->device_type = DEVICE_TYPE_DIMMER;
 #else
     resp->device_type = DEVICE_TYPE_SENSOR;
 #endif
 
-    resp->firmware_version = (1 << 16) | (1 << 8) | 2;  // v1.1.2
+    resp->firmware_version = ota_receiver_running_version();
     resp->commissioned = s_commissioned ? 1 : 0;
     resp->rssi = mesh_node_get_parent_rssi();
 
@@ -0,0 +1,407 @@
+/**
+ * OmniaPi Node Mesh - Dimmer Device Implementation (LEDC PWM)
+ *
+ * Levels map to duty through a gamma table. A linear curve is a single
+ * hardware fade between the two duties; a perceptual curve steps the level
+ * linearly in DIMMER_CURVE_SEGMENTS hardware fades, each timed against the
+ * command start so task latency doesn't accumulate.
+ */
+
+#include "device_dimmer.h"
+#include "omniapi_protocol.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "DIMMER";
+
+#ifdef CONFIG_NODE_DEVICE_TYPE_DIMMER
+#include "driver/ledc.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <string.h>
+
+#define DIMMER_SPEED_MODE       LEDC_LOW_SPEED_MODE
+#define DIMMER_TIMER            LEDC_TIMER_0
+#define DIMMER_DUTY_RES         LEDC_TIMER_13_BIT
+#define DIMMER_DUTY_MAX         ((1 << 13) - 1)
+#define DIMMER_GAMMA_VALUE      2.2f
+
+#define NOTIFY_CMD              (1 << 8)    // Bits 0-3: fade end per channel
+
+#ifndef CONFIG_DIMMER_CH2_GPIO
+#define CONFIG_DIMMER_CH2_GPIO 3
+#endif
+#ifndef CONFIG_DIMMER_CH3_GPIO
+#define CONFIG_DIMMER_CH3_GPIO 4
+#endif
+#ifndef CONFIG_DIMMER_CH4_GPIO
+#define CONFIG_DIMMER_CH4_GPIO 5
+#endif
+
+static const int dimmer_gpio[DIMMER_MAX_CHANNELS] = {
+    CONFIG_DIMMER_CH1_GPIO, CONFIG_DIMMER_CH2_GPIO,
+    CONFIG_DIMMER_CH3_GPIO, CONFIG_DIMMER_CH4_GPIO,
+};
+
+typedef struct {
+    uint8_t  channel_mask;
+    uint8_t  level[DIMMER_MAX_CHANNELS];
+    uint16_t transition_ms;
+    uint8_t  curve;
+} dimmer_cmd_t;
+
+typedef struct {
+    bool     active;
+    uint8_t  from;
+    uint8_t  to;
+    uint8_t  segment;           // Segment being faded (1-based)
+    uint8_t  segments;
+    int64_t  start_us;
+    int64_t  duration_us;
+    int64_t  seg_start_us;      // Fade-end events older than this are stale
+} fade_state_t;
+
+// ============================================================================
+// Internal State
+// ============================================================================
+static uint16_t s_lut[256];                 // Level -> duty
+static TaskHandle_t s_task = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static dimmer_cmd_t s_pending;
+static device_dimmer_done_cb_t s_done_cb = NULL;
+
+static fade_state_t s_fade[DIMMER_MAX_CHANNELS];
+static volatile int64_t s_end_us[DIMMER_MAX_CHANNELS];  // Set in the fade ISR
+static uint8_t s_level[DIMMER_MAX_CHANNELS];            // Reached levels
+static uint8_t s_last_on[DIMMER_MAX_CHANNELS];          // Restored by toggle
+
+// Current command, for the timing report
+static bool s_reporting = false;
+static int64_t s_cmd_start_us = 0;
+static uint16_t s_cmd_ms = 0;
+static uint32_t s_cmd_wakeups = 0;
+
+// Timing accuracy over all timed fades
+static uint32_t s_fade_count = 0;
+static uint64_t s_error_total_ms = 0;
+static uint32_t s_error_max_ms = 0;
+
+// ============================================================================
+// Level / Duty Mapping
+// ============================================================================
+
+static void build_lut(void)
+{
+    for (int i = 0; i < 256; i++) {
+#ifdef CONFIG_DIMMER_GAMMA
+        float x = powf(i / 255.0f, DIMMER_GAMMA_VALUE);
+#else
+        float x = i / 255.0f;
+#endif
+        s_lut[i] = (uint16_t)(x * DIMMER_DUTY_MAX + 0.5f);
+    }
+}
+
+/**
+ * Highest level whose duty doesn't exceed the given duty
+ */
+static uint8_t level_from_duty(uint32_t duty)
+{
+    int lo = 0, hi = 255;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (s_lut[mid] <= duty) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return (uint8_t)lo;
+}
+
+static uint8_t level_at(const fade_state_t *f, uint8_t segment)
+{
+    return (uint8_t)(f->from + ((int)f->to - f->from) * segment / f->segments);
+}
+
+// ============================================================================
+// Fade Sequencing (dimmer task)
+// ============================================================================
+
+static IRAM_ATTR bool fade_end_cb(const ledc_cb_param_t *param, void *user_arg)
+{
+    BaseType_t woken = pdFALSE;
+    if (param->event == LEDC_FADE_END_EVT && param->channel < DIMMER_MAX_CHANNELS) {
+        s_end_us[param->channel] = esp_timer_get_time();
+        xTaskNotifyFromISR(s_task, 1 << param->channel, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+/**
+ * Program the next segment that changes the duty, or finish the channel
+ */
+static void advance(int ch)
+{
+    fade_state_t *f = &s_fade[ch];
+    uint32_t duty_now = ledc_get_duty(DIMMER_SPEED_MODE, ch);
+
+    while (++f->segment <= f->segments) {
+        uint32_t duty = s_lut[level_at(f, f->segment)];
+        if (duty == duty_now) continue;     // Flat at the bottom of the curve
+
+        int64_t now = esp_timer_get_time();
+        int64_t end_us = f->start_us + f->duration_us * f->segment / f->segments;
+        int64_t ms = (end_us - now) / 1000;
+        if (ms < 1) ms = 1;
+
+        f->seg_start_us = now;
+        ledc_set_fade_with_time(DIMMER_SPEED_MODE, ch, duty, (int)ms);
+        ledc_fade_start(DIMMER_SPEED_MODE, ch, LEDC_FADE_NO_WAIT);
+        return;
+    }
+
+    f->active = false;
+    s_level[ch] = f->to;
+    if (f->to > 0) {
+        s_last_on[ch] = f->to;
+    }
+}
+
+static void finish_if_done(void)
+{
+    if (!s_reporting) return;
+    for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+        if (s_fade[ch].active) return;
+    }
+    s_reporting = false;
+
+    if (s_cmd_ms > 0) {
+        int64_t last_us = s_cmd_start_us;
+        for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+            if (s_end_us[ch] > last_us) last_us = s_end_us[ch];
+        }
+        uint32_t took_ms = (uint32_t)((last_us - s_cmd_start_us) / 1000);
+        uint32_t error_ms = took_ms > s_cmd_ms ? took_ms - s_cmd_ms : s_cmd_ms - took_ms;
+
+        s_fade_count++;
+        s_error_total_ms += error_ms;
+        if (error_ms > s_error_max_ms) s_error_max_ms = error_ms;
+
+        ESP_LOGI(TAG, "Fade done: %u ms requested, %lu ms taken, %lu wakeups "
+                 "(error avg %lu / max %lu ms over %lu fades)",
+                 s_cmd_ms, (unsigned long)took_ms, (unsigned long)s_cmd_wakeups,
+                 (unsigned long)(s_error_total_ms / s_fade_count),
+                 (unsigned long)s_error_max_ms, (unsigned long)s_fade_count);
+    }
+
+    if (s_done_cb) {
+        s_done_cb();
+    }
+}
+
+static void start_command(const dimmer_cmd_t *cmd)
+{
+    int64_t now = esp_timer_get_time();
+
+    s_reporting = true;
+    s_cmd_start_us = now;
+    s_cmd_ms = cmd->transition_ms;
+    s_cmd_wakeups = 0;
+
+    for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+        if (!(cmd->channel_mask & (1 << ch))) continue;
+
+        fade_state_t *f = &s_fade[ch];
+        ledc_fade_stop(DIMMER_SPEED_MODE, ch);
+
+        // Start from wherever an interrupted fade left the output
+        f->from = level_from_duty(ledc_get_duty(DIMMER_SPEED_MODE, ch));
+        f->to = cmd->level[ch];
+        f->start_us = now;
+        f->duration_us = (int64_t)cmd->transition_ms * 1000;
+        f->segment = 0;
+        f->segments = 1;
+#ifdef CONFIG_DIMMER_GAMMA
+        if (cmd->curve == DIMMER_CURVE_PERCEPTUAL) {
+            f->segments = DIMMER_CURVE_SEGMENTS;
+        }
+#endif
+        f->active = true;
+        s_end_us[ch] = now;
+
+        if (cmd->transition_ms == 0) {
+            ledc_set_duty(DIMMER_SPEED_MODE, ch, s_lut[f->to]);
+            ledc_update_duty(DIMMER_SPEED_MODE, ch);
+            f->segment = f->segments;
+        }
+        advance(ch);
+    }
+
+    finish_if_done();
+}
+
+static void dimmer_task(void *arg)
+{
+    while (1) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        if (bits & NOTIFY_CMD) {
+            dimmer_cmd_t cmd;
+            taskENTER_CRITICAL(&s_lock);
+            cmd = s_pending;
+            taskEXIT_CRITICAL(&s_lock);
+
+            // Fade ends delivered with it for the restarted channels are
+            // older than their new segments and get skipped below
+            start_command(&cmd);
+        }
+
+        if (!(bits & (NOTIFY_CMD - 1))) continue;
+        s_cmd_wakeups++;
+        for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+            if (!(bits & (1 << ch)) || !s_fade[ch].active) continue;
+            if (s_end_us[ch] < s_fade[ch].seg_start_us) continue;   // Stopped fade
+            advance(ch);
+        }
+        finish_if_done();
+    }
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t device_dimmer_init(void)
+{
+    if (s_task != NULL) return ESP_OK;
+
+    build_lut();
+    memset(s_fade, 0, sizeof(s_fade));
+    memset(s_level, 0, sizeof(s_level));
+    memset(s_last_on, 255, sizeof(s_last_on));
+
+    ledc_timer_config_t timer = {
+        .speed_mode = DIMMER_SPEED_MODE,
+        .duty_resolution = DIMMER_DUTY_RES,
+        .timer_num = DIMMER_TIMER,
+        .freq_hz = CONFIG_DIMMER_PWM_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t ret = ledc_timer_config(&timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Timer config failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = ledc_fade_func_install(0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Fade service install failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (xTaskCreate(dimmer_task, "dimmer", 3072, NULL, 6, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dimmer task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ledc_cbs_t cbs = {
+        .fade_cb = fade_end_cb,
+    };
+    for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+        ledc_channel_config_t channel = {
+            .gpio_num = dimmer_gpio[ch],
+            .speed_mode = DIMMER_SPEED_MODE,
+            .channel = ch,
+            .intr_type = LEDC_INTR_DISABLE,
+            .timer_sel = DIMMER_TIMER,
+            .duty = 0,
+            .hpoint = 0,
+        };
+        ret = ledc_channel_config(&channel);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Channel %d config failed: %s", ch, esp_err_to_name(ret));
+            return ret;
+        }
+        ledc_cb_register(DIMMER_SPEED_MODE, ch, &cbs, NULL);
+        ESP_LOGI(TAG, "Channel %d on GPIO%d", ch, dimmer_gpio[ch]);
+    }
+
+    ESP_LOGI(TAG, "Dimmer initialized: %d channels, %d Hz, gamma %s",
+             CONFIG_DIMMER_CHANNEL_COUNT, CONFIG_DIMMER_PWM_FREQ_HZ,
+#ifdef CONFIG_DIMMER_GAMMA
+             "on"
+#else
+             "off"
+#endif
+             );
+    return ESP_OK;
+}
+
+esp_err_t device_dimmer_set(uint8_t channel_mask, const uint8_t *levels,
+                            uint16_t transition_ms, uint8_t curve)
+{
+    if (s_task == NULL) return ESP_ERR_INVALID_STATE;
+    if (curve != DIMMER_CURVE_LINEAR && curve != DIMMER_CURVE_PERCEPTUAL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    channel_mask &= (1 << CONFIG_DIMMER_CHANNEL_COUNT) - 1;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_pending.channel_mask = channel_mask;
+    memcpy(s_pending.level, levels, DIMMER_MAX_CHANNELS);
+    s_pending.transition_ms = transition_ms;
+    s_pending.curve = curve;
+    taskEXIT_CRITICAL(&s_lock);
+
+    xTaskNotify(s_task, NOTIFY_CMD, eSetBits);
+    return ESP_OK;
+}
+
+esp_err_t device_dimmer_toggle(void)
+{
+    uint8_t levels[DIMMER_MAX_CHANNELS] = {0};
+    bool any_on = false;
+
+    for (int ch = 0; ch < CONFIG_DIMMER_CHANNEL_COUNT; ch++) {
+        if (s_level[ch] > 0) any_on = true;
+    }
+    if (!any_on) {
+        memcpy(levels, s_last_on, sizeof(levels));
+    }
+
+    return device_dimmer_set(0xFF, levels, DIMMER_TOGGLE_FADE_MS, DIMMER_CURVE_PERCEPTUAL);
+}
+
+void device_dimmer_get_levels(uint8_t *levels)
+{
+    memset(levels, 0, DIMMER_MAX_CHANNELS);
+    memcpy(levels, s_level, CONFIG_DIMMER_CHANNEL_COUNT);
+}
+
+uint8_t device_dimmer_get_channel_count(void)
+{
+    return CONFIG_DIMMER_CHANNEL_COUNT;
+}
+
+void device_dimmer_set_done_cb(device_dimmer_done_cb_t cb)
+{
+    s_done_cb = cb;
+}
+
+#else
+// Stub implementations when dimmer is not enabled
+esp_err_t device_dimmer_init(void) { return ESP_OK; }
+esp_err_t device_dimmer_set(uint8_t channel_mask, const uint8_t *levels,
+                            uint16_t transition_ms, uint8_t curve) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t device_dimmer_toggle(void) { return ESP_ERR_NOT_SUPPORTED; }
+void device_dimmer_get_levels(uint8_t *levels) {
+    for (int i = 0; i < DIMMER_MAX_CHANNELS; i++) levels[i] = 0;
+}
+uint8_t device_dimmer_get_channel_count(void) { return 0; }
+void device_dimmer_set_done_cb(device_dimmer_done_cb_t cb) {}
+#endif
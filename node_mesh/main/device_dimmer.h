@@ -0,0 +1,76 @@
+/**
+ * OmniaPi Node Mesh - Dimmer Device Driver (LEDC PWM)
+ *
+ * Fades run in the LEDC peripheral: one command carries the target level,
+ * transition time and curve for each channel, and the CPU only wakes at
+ * the end of each hardware fade segment. The done callback fires once all
+ * channels have reached their targets, so the gateway gets one status per
+ * command instead of a stream of intermediate levels.
+ */
+
+#ifndef DEVICE_DIMMER_H
+#define DEVICE_DIMMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define DIMMER_CURVE_SEGMENTS       8       // Hardware fades per perceptual ramp
+#define DIMMER_TOGGLE_FADE_MS       500     // Button toggle transition
+
+/**
+ * Called from the dimmer task once a command's fades have all finished
+ */
+typedef void (*device_dimmer_done_cb_t)(void);
+
+/**
+ * Initialize LEDC channels, fade service and the dimmer task
+ * @return ESP_OK on success
+ */
+esp_err_t device_dimmer_init(void);
+
+/**
+ * Start a fade (replaces any fade in progress on the selected channels)
+ * @param channel_mask  Bit per channel to change
+ * @param levels        Target level per channel (DIMMER_MAX_CHANNELS entries)
+ * @param transition_ms Fade time (0 = immediate)
+ * @param curve         DIMMER_CURVE_LINEAR or DIMMER_CURVE_PERCEPTUAL
+ * @return ESP_OK if queued
+ */
+esp_err_t device_dimmer_set(uint8_t channel_mask, const uint8_t *levels,
+                            uint16_t transition_ms, uint8_t curve);
+
+/**
+ * Fade all channels off, or back to their last non-zero levels
+ * @return ESP_OK if queued
+ */
+esp_err_t device_dimmer_toggle(void);
+
+/**
+ * Get the levels reached by the last finished fade
+ * @param levels  DIMMER_MAX_CHANNELS entries (unused channels are 0)
+ */
+void device_dimmer_get_levels(uint8_t *levels);
+
+/**
+ * Get number of channels fitted
+ */
+uint8_t device_dimmer_get_channel_count(void);
+
+/**
+ * Set the fade-finished callback
+ */
+void device_dimmer_set_done_cb(device_dimmer_done_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_DIMMER_H
@@ -3,12 +3,14 @@
  */
 
 #include "device_led.h"
+#include "omniapi_protocol.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #ifdef CONFIG_NODE_DEVICE_TYPE_LED
 #include "led_strip.h"
+#include "led_render.h"
 
 static const char *TAG = "LED_STRIP";
 
@@ -19,116 +21,43 @@ static led_strip_handle_t s_led_strip = NULL;
 static bool s_on = false;
 static uint8_t s_r = 255, s_g = 255, s_b = 255;
 static uint8_t s_brightness = 255;
-static led_effect_t s_effect = LED_EFFECT_NONE;
-static uint16_t s_effect_speed = 50;
+static uint8_t s_effect_id = LED_EFFECT_NONE;
 
-// Effect task handle
-static TaskHandle_t s_effect_task = NULL;
-
-// Apply brightness to color
-static uint8_t apply_brightness(uint8_t color)
+// Render task output: push a changed frame to the strip
+static void led_flush(const uint8_t *rgb, uint16_t count)
 {
-    return (uint8_t)(((uint16_t)color * s_brightness) / 255);
+    for (int i = 0; i < count; i++) {
+        led_strip_set_pixel(s_led_strip, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+    }
+    led_strip_refresh(s_led_strip);
 }
 
-// Effect task
-static void effect_task(void *arg)
+// Protocol effect ID -> shared effects library
+static effect_type_t effect_type_from_id(uint8_t effect_id)
 {
-    uint16_t step = 0;
-
-    while (1) {
-        if (!s_on || s_effect == LED_EFFECT_NONE) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-            continue;
-        }
-
-        switch (s_effect) {
-            case LED_EFFECT_RAINBOW: {
-                // Rainbow cycle effect
-                for (int i = 0; i < CONFIG_LED_STRIP_COUNT; i++) {
-                    uint16_t hue = (step + i * 360 / CONFIG_LED_STRIP_COUNT) % 360;
-
-                    // HSV to RGB conversion (simplified)
-                    uint8_t r, g, b;
-                    uint8_t region = hue / 60;
-                    uint8_t remainder = (hue - (region * 60)) * 255 / 60;
-
-                    switch (region) {
-                        case 0:  r = 255; g = remainder; b = 0; break;
-                        case 1:  r = 255 - remainder; g = 255; b = 0; break;
-                        case 2:  r = 0; g = 255; b = remainder; break;
-                        case 3:  r = 0; g = 255 - remainder; b = 255; break;
-                        case 4:  r = remainder; g = 0; b = 255; break;
-                        default: r = 255; g = 0; b = 255 - remainder; break;
-                    }
-
-                    led_strip_set_pixel(s_led_strip, i,
-                                        apply_brightness(r),
-                                        apply_brightness(g),
-                                        apply_brightness(b));
-                }
-                led_strip_refresh(s_led_strip);
-                step = (step + 5) % 360;
-                break;
-            }
-
-            case LED_EFFECT_BREATHE: {
-                // Breathing effect
-                uint8_t br = (step < 128) ? step * 2 : (255 - step) * 2;
-                for (int i = 0; i < CONFIG_LED_STRIP_COUNT; i++) {
-                    led_strip_set_pixel(s_led_strip, i,
-                                        (s_r * br) / 255,
-                                        (s_g * br) / 255,
-                                        (s_b * br) / 255);
-                }
-                led_strip_refresh(s_led_strip);
-                step = (step + 2) % 256;
-                break;
-            }
-
-            case LED_EFFECT_FLASH: {
-                // Flash effect
-                bool on = (step % 2) == 0;
-                for (int i = 0; i < CONFIG_LED_STRIP_COUNT; i++) {
-                    if (on) {
-                        led_strip_set_pixel(s_led_strip, i,
-                                            apply_brightness(s_r),
-                                            apply_brightness(s_g),
-                                            apply_brightness(s_b));
-                    } else {
-                        led_strip_set_pixel(s_led_strip, i, 0, 0, 0);
-                    }
-                }
-                led_strip_refresh(s_led_strip);
-                step++;
-                break;
-            }
-
-            case LED_EFFECT_CHASE: {
-                // Chase effect
-                for (int i = 0; i < CONFIG_LED_STRIP_COUNT; i++) {
-                    if (i == step % CONFIG_LED_STRIP_COUNT) {
-                        led_strip_set_pixel(s_led_strip, i,
-                                            apply_brightness(s_r),
-                                            apply_brightness(s_g),
-                                            apply_brightness(s_b));
-                    } else {
-                        led_strip_set_pixel(s_led_strip, i, 0, 0, 0);
-                    }
-                }
-                led_strip_refresh(s_led_strip);
-                step++;
-                break;
-            }
-
-            default:
-                break;
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(s_effect_speed));
+    switch (effect_id) {
+        case LED_EFFECT_BREATHE: return EFFECT_TYPE_BREATHING;
+        case LED_EFFECT_RAINBOW: return EFFECT_TYPE_RAINBOW;
+        case LED_EFFECT_CHASE:   return EFFECT_TYPE_CHASE;
+        case LED_EFFECT_FLASH:   return EFFECT_TYPE_FLASH;
+        case LED_EFFECT_SPARKLE: return EFFECT_TYPE_SPARKLE;
+        case LED_EFFECT_FIRE:    return EFFECT_TYPE_FIRE;
+        case LED_EFFECT_PALETTE: return EFFECT_TYPE_CUSTOM;
+        case LED_EFFECT_GRADIENT: return EFFECT_TYPE_GRADIENT;
+        case LED_EFFECT_SCRIPT:  return EFFECT_TYPE_SCRIPT;
+        default:                 return EFFECT_TYPE_STATIC;
     }
 }
 
+// Step time in ms (10-200) -> library speed (255 = 10 ms, 0 = 200 ms)
+static uint8_t speed_from_ms(uint16_t ms)
+{
+    if (ms == 0) return 128;
+    if (ms < 10) ms = 10;
+    if (ms > 200) ms = 200;
+    return (uint8_t)((200 - ms) * 255 / 190);
+}
+
 esp_err_t device_led_init(void)
 {
     ESP_LOGI(TAG, "Initializing LED strip: %d LEDs on GPIO%d",
@@ -156,8 +85,16 @@ esp_err_t device_led_init(void)
     // Clear all LEDs
     led_strip_clear(s_led_strip);
 
-    // Create effect task
-    xTaskCreate(effect_task, "led_effect", 2048, NULL, 5, &s_effect_task);
+    // Start the renderer (effects run on its frame clock)
+    led_render_config_t render_config = {
+        .max_leds = CONFIG_LED_STRIP_COUNT,
+        .num_leds = CONFIG_LED_STRIP_COUNT,
+        .frame_ms = LED_RENDER_FRAME_MS,
+        .flush = led_flush,
+    };
+    ESP_ERROR_CHECK(led_render_init(&render_config));
+    led_render_set_color(s_r, s_g, s_b);
+    led_render_set_brightness(s_brightness);
 
     ESP_LOGI(TAG, "LED strip initialized");
     return ESP_OK;
@@ -166,25 +103,14 @@ esp_err_t device_led_init(void)
 void device_led_on(void)
 {
     s_on = true;
-
-    if (s_effect == LED_EFFECT_NONE) {
-        // Static color
-        for (int i = 0; i < CONFIG_LED_STRIP_COUNT; i++) {
-            led_strip_set_pixel(s_led_strip, i,
-                                apply_brightness(s_r),
-                                apply_brightness(s_g),
-                                apply_brightness(s_b));
-        }
-        led_strip_refresh(s_led_strip);
-    }
-
+    led_render_set_power(true);
     ESP_LOGI(TAG, "LED ON (R=%d G=%d B=%d BR=%d)", s_r, s_g, s_b, s_brightness);
 }
 
 void device_led_off(void)
 {
     s_on = false;
-    led_strip_clear(s_led_strip);
+    led_render_set_power(false);
     ESP_LOGI(TAG, "LED OFF");
 }
 
@@ -193,35 +119,77 @@ void device_led_set_color(uint8_t r, uint8_t g, uint8_t b)
     s_r = r;
     s_g = g;
     s_b = b;
-
-    if (s_on && s_effect == LED_EFFECT_NONE) {
-        device_led_on();  // Refresh
-    }
-
+    led_render_set_color(r, g, b);
     ESP_LOGI(TAG, "Color set: R=%d G=%d B=%d", r, g, b);
 }
 
 void device_led_set_brightness(uint8_t brightness)
 {
     s_brightness = brightness;
+    led_render_set_brightness(brightness);
+    ESP_LOGI(TAG, "Brightness set: %d", brightness);
+}
 
-    if (s_on && s_effect == LED_EFFECT_NONE) {
-        device_led_on();  // Refresh
+void device_led_set_effect(uint8_t effect_id, uint16_t speed)
+{
+    s_effect_id = effect_id;
+    led_render_set_speed(speed_from_ms(speed));
+    led_render_set_effect(effect_type_from_id(effect_id));
+    ESP_LOGI(TAG, "Effect set: %d (speed=%d ms)", effect_id, speed);
+}
+
+esp_err_t device_led_set_palette(uint8_t palette_id, uint8_t flags, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+
+    if (data == NULL || len == 0) {
+        ret = led_render_select_palette(palette_id);
+    } else {
+        if (flags & LED_PALETTE_FLAG_STORE) {
+            ret = led_palette_bank_store(palette_id, data, len);
+            if (ret != ESP_OK) return ret;
+        }
+        if (!(flags & LED_PALETTE_FLAG_SELECT)) return ESP_OK;
+        ret = led_render_set_palette(data, len);
     }
+    if (ret != ESP_OK) return ret;
 
-    ESP_LOGI(TAG, "Brightness set: %d", brightness);
+    // Palette effects keep the palette, everything else switches to the cycle
+    if (s_effect_id != LED_EFFECT_GRADIENT) {
+        s_effect_id = LED_EFFECT_PALETTE;
+        led_render_set_effect(EFFECT_TYPE_CUSTOM);
+    }
+    ESP_LOGI(TAG, "Palette set: slot=%d flags=0x%02X len=%d", palette_id, flags, (int)len);
+    return ESP_OK;
 }
 
-void device_led_set_effect(led_effect_t effect, uint16_t speed)
+esp_err_t device_led_set_script(uint8_t script_id, uint8_t flags, const uint8_t *data, size_t len)
 {
-    s_effect = effect;
-    s_effect_speed = speed > 0 ? speed : 50;
+    esp_err_t ret;
+
+    if (data == NULL || len == 0) {
+        ret = led_render_select_script(script_id);
+    } else {
+        ret = led_render_check_script(data, len);
+        if (ret != ESP_OK) return ret;
+        if (flags & LED_SCRIPT_FLAG_STORE) {
+            ret = led_script_bank_store(script_id, data, len);
+            if (ret != ESP_OK) return ret;
+        }
+        if (!(flags & LED_SCRIPT_FLAG_SELECT)) return ESP_OK;
+        ret = led_render_set_script(data, len);
+    }
+    if (ret != ESP_OK) return ret;
 
-    ESP_LOGI(TAG, "Effect set: %d (speed=%d ms)", effect, s_effect_speed);
+    s_effect_id = LED_EFFECT_SCRIPT;
+    led_render_set_effect(EFFECT_TYPE_SCRIPT);
+    ESP_LOGI(TAG, "Script set: slot=%d flags=0x%02X len=%d", script_id, flags, (int)len);
+    return ESP_OK;
+}
 
-    if (effect == LED_EFFECT_NONE && s_on) {
-        device_led_on();  // Restore static color
-    }
+uint8_t device_led_get_effect(void)
+{
+    return s_effect_id;
 }
 
 void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *brightness)
@@ -233,23 +201,6 @@ void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t
     if (brightness) *brightness = s_brightness;
 }
 
-void device_led_set_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
-{
-    if (index < CONFIG_LED_STRIP_COUNT && s_led_strip) {
-        led_strip_set_pixel(s_led_strip, index,
-                            apply_brightness(r),
-                            apply_brightness(g),
-                            apply_brightness(b));
-    }
-}
-
-void device_led_refresh(void)
-{
-    if (s_led_strip) {
-        led_strip_refresh(s_led_strip);
-    }
-}
-
 #else
 // Stub implementations when LED is not enabled
 esp_err_t device_led_init(void) { return ESP_OK; }
@@ -257,7 +208,10 @@ void device_led_on(void) {}
 void device_led_off(void) {}
 void device_led_set_color(uint8_t r, uint8_t g, uint8_t b) {}
 void device_led_set_brightness(uint8_t brightness) {}
-void device_led_set_effect(led_effect_t effect, uint16_t speed) {}
+void device_led_set_effect(uint8_t effect_id, uint16_t speed) {}
+esp_err_t device_led_set_palette(uint8_t palette_id, uint8_t flags, const uint8_t *data, size_t len) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t device_led_set_script(uint8_t script_id, uint8_t flags, const uint8_t *data, size_t len) { return ESP_ERR_NOT_SUPPORTED; }
+uint8_t device_led_get_effect(void) { return 0; }
 void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *brightness) {
     if (on) *on = false;
     if (r) *r = 0;
@@ -265,6 +219,4 @@ void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t
     if (b) *b = 0;
     if (brightness) *brightness = 0;
 }
-void device_led_set_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b) {}
-void device_led_refresh(void) {}
 #endif
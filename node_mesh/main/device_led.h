@@ -1,5 +1,9 @@
 /**
  * OmniaPi Node Mesh - LED Strip Device Driver (WS2812B)
+ *
+ * Rendering (effects, frame clock, dirty tracking) is done by the shared
+ * led_render component; this driver owns the strip and maps the mesh
+ * protocol onto it.
  */
 
 #ifndef DEVICE_LED_H
@@ -7,21 +11,13 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// LED Effects
-typedef enum {
-    LED_EFFECT_NONE = 0,
-    LED_EFFECT_RAINBOW,
-    LED_EFFECT_BREATHE,
-    LED_EFFECT_FLASH,
-    LED_EFFECT_CHASE,
-} led_effect_t;
-
 /**
  * Initialize LED strip
  * @return ESP_OK on success
@@ -54,29 +50,42 @@ void device_led_set_brightness(uint8_t brightness);
 
 /**
  * Set LED effect
- * @param effect    Effect type
- * @param speed     Effect speed (ms per step)
+ * @param effect_id Effect ID (LED_EFFECT_*, NONE/SOLID = static color)
+ * @param speed     Effect speed (ms per step, 0 = default)
  */
-void device_led_set_effect(led_effect_t effect, uint16_t speed);
+void device_led_set_effect(uint8_t effect_id, uint16_t speed);
 
 /**
- * Get current LED state
+ * Store and/or select a palette for the palette effects
+ * Selecting switches to LED_EFFECT_PALETTE unless the gradient is active.
+ * @param palette_id Bank slot (0-7)
+ * @param flags      LED_PALETTE_FLAG_* (ignored without data)
+ * @param data       Encoded palette, NULL/0 = select palette_id from the bank
+ * @param len        Encoded length
+ * @return ESP_OK on success
  */
-void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *brightness);
+esp_err_t device_led_set_palette(uint8_t palette_id, uint8_t flags, const uint8_t *data, size_t len);
 
 /**
- * Set individual pixel color
- * @param index Pixel index
- * @param r Red (0-255)
- * @param g Green (0-255)
- * @param b Blue (0-255)
+ * Store and/or run an effect program
+ * Running it switches to LED_EFFECT_SCRIPT.
+ * @param script_id Bank slot (0-3)
+ * @param flags     LED_SCRIPT_FLAG_* (ignored without data)
+ * @param data      Program, NULL/0 = run script_id from the bank
+ * @param len       Program length
+ * @return ESP_OK on success
+ */
+esp_err_t device_led_set_script(uint8_t script_id, uint8_t flags, const uint8_t *data, size_t len);
+
+/**
+ * Get current effect ID (LED_EFFECT_*)
  */
-void device_led_set_pixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b);
+uint8_t device_led_get_effect(void);
 
 /**
- * Refresh/update the LED strip
+ * Get current LED state
  */
-void device_led_refresh(void);
+void device_led_get_state(bool *on, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *brightness);
 
 #ifdef __cplusplus
 }
@@ -18,6 +18,7 @@
 #include "esp_timer.h"
 
 #include "mesh_node.h"
+#include "mesh_fastpath.h"
 #include "commissioning.h"
 #include "nvs_storage.h"
 #include "button_handler.h"
@@ -33,11 +34,27 @@
 #include "device_led.h"
 #endif
 
+#ifdef CONFIG_NODE_DEVICE_TYPE_DIMMER
+#include "device_dimmer.h"
+#endif
+
 static const char *TAG = "NODE_MAIN";
 
 // Node MAC address
 static uint8_t s_node_mac[6] = {0};
 
+// Boot to first device command (ms, 0 until one arrives)
+static uint32_t s_boot_first_cmd_ms = 0;
+
+// Announce on reconnect, delayed by the per-node jitter
+static esp_timer_handle_t s_announce_timer = NULL;
+static bool s_announced = false;
+
+#ifdef CONFIG_NODE_DEVICE_TYPE_DIMMER
+// Sequence of the command whose fade is running (0 = local button)
+static uint16_t s_dimmer_seq = 0;
+#endif
+
 // ============================================================================
 // Command Handlers
 // ============================================================================
@@ -78,6 +95,20 @@ static void handle_relay_command(const omniapi_message_t *msg)
 #endif
 }
 
+#ifdef CONFIG_NODE_DEVICE_TYPE_LED
+static void send_led_status(uint8_t seq)
+{
+    omniapi_message_t response;
+    OMNIAPI_INIT_HEADER(&response.header, MSG_LED_STATUS, seq, sizeof(payload_led_status_t));
+
+    payload_led_status_t *status = (payload_led_status_t *)response.payload;
+    device_led_get_state(&status->on, &status->r, &status->g, &status->b, &status->brightness);
+    status->effect_id = device_led_get_effect();
+
+    mesh_node_send_to_root((uint8_t *)&response, OMNIAPI_MSG_SIZE(sizeof(payload_led_status_t)));
+}
+#endif
+
 static void handle_led_command(const omniapi_message_t *msg)
 {
 #ifdef CONFIG_NODE_DEVICE_TYPE_LED
@@ -108,16 +139,96 @@ static void handle_led_command(const omniapi_message_t *msg)
     }
 
     // Send status update back to gateway
+    send_led_status(msg->header.seq);
+#else
+    ESP_LOGW(TAG, "LED command received but device is not configured as LED");
+#endif
+}
+
+static void handle_led_palette(const omniapi_message_t *msg)
+{
+#ifdef CONFIG_NODE_DEVICE_TYPE_LED
+    const payload_led_palette_t *cmd = (const payload_led_palette_t *)msg->payload;
+    uint16_t payload_len = msg->header.payload_len;
+
+    if (payload_len < offsetof(payload_led_palette_t, data) ||
+        payload_len > sizeof(payload_led_palette_t)) {
+        ESP_LOGW(TAG, "LED palette: bad length %u", payload_len);
+        return;
+    }
+
+    size_t data_len = payload_len - offsetof(payload_led_palette_t, data);
+    esp_err_t ret = device_led_set_palette(cmd->palette_id, cmd->flags, cmd->data, data_len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "LED palette rejected: %s", esp_err_to_name(ret));
+    }
+
+    send_led_status(msg->header.seq);
+#else
+    ESP_LOGW(TAG, "LED palette received but device is not configured as LED");
+#endif
+}
+
+static void handle_led_script(const omniapi_message_t *msg)
+{
+#ifdef CONFIG_NODE_DEVICE_TYPE_LED
+    const payload_led_script_t *cmd = (const payload_led_script_t *)msg->payload;
+    uint16_t payload_len = msg->header.payload_len;
+
+    if (payload_len < offsetof(payload_led_script_t, data) ||
+        payload_len > sizeof(payload_led_script_t)) {
+        ESP_LOGW(TAG, "LED script: bad length %u", payload_len);
+        return;
+    }
+
+    size_t data_len = payload_len - offsetof(payload_led_script_t, data);
+    esp_err_t ret = device_led_set_script(cmd->script_id, cmd->flags, cmd->data, data_len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "LED script rejected: %s", esp_err_to_name(ret));
+    }
+
+    send_led_status(msg->header.seq);
+#else
+    ESP_LOGW(TAG, "LED script received but device is not configured as LED");
+#endif
+}
+
+#ifdef CONFIG_NODE_DEVICE_TYPE_DIMMER
+/**
+ * Dimmer fade finished: report the final levels once
+ */
+static void on_dimmer_done(void)
+{
     omniapi_message_t response;
-    OMNIAPI_INIT_HEADER(&response.header, MSG_LED_STATUS, msg->header.seq, sizeof(payload_led_status_t));
+    OMNIAPI_INIT_HEADER(&response.header, MSG_DIMMER_STATUS, s_dimmer_seq, sizeof(payload_dimmer_status_t));
 
-    payload_led_status_t *status = (payload_led_status_t *)response.payload;
-    device_led_get_state(&status->on, &status->r, &status->g, &status->b, &status->brightness);
-    status->effect_id = 0;
+    payload_dimmer_status_t *status = (payload_dimmer_status_t *)response.payload;
+    status->channel_count = device_dimmer_get_channel_count();
+    device_dimmer_get_levels(status->level);
 
-    mesh_node_send_to_root((uint8_t *)&response, OMNIAPI_MSG_SIZE(sizeof(payload_led_status_t)));
+    mesh_node_send_to_root((uint8_t *)&response, OMNIAPI_MSG_SIZE(sizeof(payload_dimmer_status_t)));
+}
+#endif
+
+static void handle_dimmer_command(const omniapi_message_t *msg)
+{
+#ifdef CONFIG_NODE_DEVICE_TYPE_DIMMER
+    const payload_dimmer_cmd_t *cmd = (const payload_dimmer_cmd_t *)msg->payload;
+    uint16_t transition_ms = cmd->transition_ms;
+
+    ESP_LOGI(TAG, "Dimmer command: mask=0x%02X levels=%d/%d/%d/%d transition=%u ms curve=%d",
+             cmd->channel_mask, cmd->level[0], cmd->level[1], cmd->level[2], cmd->level[3],
+             transition_ms, cmd->curve);
+
+    // Status goes out when the fade has finished (on_dimmer_done)
+    s_dimmer_seq = msg->header.seq;
+    esp_err_t ret = device_dimmer_set(cmd->channel_mask, cmd->level, transition_ms, cmd->curve);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Dimmer command rejected: %s", esp_err_to_name(ret));
+        on_dimmer_done();
+    }
 #else
-    ESP_LOGW(TAG, "LED command received but device is not configured as LED");
+    ESP_LOGW(TAG, "Dimmer command received but device is not configured as dimmer");
 #endif
 }
 
@@ -135,6 +246,8 @@ static void handle_heartbeat(const omniapi_message_t *msg)
     ack->device_type = DEVICE_TYPE_RELAY;
 #elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
     ack->device_type = DEVICE_TYPE_LED_STRIP;
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    ack->device_type = DEVICE_TYPE_DIMMER;
 #else
     ack->device_type = DEVICE_TYPE_SENSOR;
 #endif
@@ -142,9 +255,20 @@ static void handle_heartbeat(const omniapi_message_t *msg)
     ack->status = commissioning_is_commissioned() ? NODE_STATUS_ONLINE : NODE_STATUS_DISCOVERED;
     ack->mesh_layer = (uint8_t)mesh_node_get_layer();
     ack->rssi = mesh_node_get_parent_rssi();
-    ack->firmware_version = (1 << 16) | (1 << 8) | 2;  // v1.1.2
+    ack->firmware_version = ota_receiver_running_version();
     ack->uptime = esp_timer_get_time() / 1000000;  // seconds
 
+    // Packed struct: fill the 16-bit fields through locals
+    uint16_t link_tx, link_fail;
+    mesh_node_take_link_stats(ack->parent_mac, &link_tx, &link_fail, &ack->parent_changes);
+    ack->link_tx = link_tx;
+    ack->link_fail = link_fail;
+
+    uint32_t boot_connect_ms;
+    mesh_node_get_boot_report(&ack->rejoin_mode, &boot_connect_ms);
+    ack->boot_connect_ms = boot_connect_ms;
+    ack->boot_first_cmd_ms = s_boot_first_cmd_ms;
+
     mesh_node_send_to_root((uint8_t *)&response, OMNIAPI_MSG_SIZE(sizeof(payload_heartbeat_ack_t)));
 }
 
@@ -214,6 +338,30 @@ static void handle_config_set(const omniapi_message_t *msg)
 #endif
             break;
 
+        case CONFIG_KEY_MESH_PARAMS:
+            if (cfg->value_len >= sizeof(config_mesh_params_t)) {
+                const config_mesh_params_t *params = (const config_mesh_params_t *)cfg->value;
+                if (mesh_node_set_params(params->max_layer, params->max_connection) != ESP_OK) {
+                    status = 2;  // Invalid value
+                }
+            } else {
+                status = 2;
+            }
+            break;
+
+        case CONFIG_KEY_MESH_PARENT:
+            if (cfg->value_len >= sizeof(config_mesh_parent_t)) {
+                const config_mesh_parent_t *parent = (const config_mesh_parent_t *)cfg->value;
+                esp_err_t ret = mesh_node_switch_parent(parent->parent_bssid, parent->parent_layer);
+                if (ret != ESP_OK) {
+                    status = 1;
+                    ESP_LOGW(TAG, "Parent switch refused: %s", esp_err_to_name(ret));
+                }
+            } else {
+                status = 2;
+            }
+            break;
+
         default:
             ESP_LOGW(TAG, "Unknown config key: %d", cfg->config_key);
             status = 4;  // Unknown key
@@ -273,6 +421,13 @@ static void handle_config_get(const omniapi_message_t *msg)
 // Mesh Message Handler
 // ============================================================================
 
+static void note_first_command(void)
+{
+    if (s_boot_first_cmd_ms != 0) return;
+    s_boot_first_cmd_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    ESP_LOGI(TAG, "Boot to first command: %lu ms", (unsigned long)s_boot_first_cmd_ms);
+}
+
 static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t len)
 {
     if (len < sizeof(omniapi_header_t)) {
@@ -304,13 +459,28 @@ static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t
             break;
 
         case MSG_RELAY_CMD:
+            note_first_command();
             handle_relay_command(msg);
             break;
 
         case MSG_LED_CMD:
+            note_first_command();
             handle_led_command(msg);
             break;
 
+        case MSG_DIMMER_CMD:
+            note_first_command();
+            handle_dimmer_command(msg);
+            break;
+
+        case MSG_LED_PALETTE:
+            handle_led_palette(msg);
+            break;
+
+        case MSG_LED_SCRIPT:
+            handle_led_script(msg);
+            break;
+
         case MSG_SCAN_REQUEST:
             commissioning_handle_scan_request(msg);
             break;
@@ -349,7 +519,8 @@ static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t
 
         // Push-mode OTA (gateway pushes firmware to specific node)
         case MSG_OTA_BEGIN:
-            ota_receiver_handle_begin((const payload_ota_begin_t *)msg->payload);
+            ota_receiver_handle_begin((const payload_ota_begin_t *)msg->payload,
+                                      msg->header.payload_len);
             break;
 
         case MSG_OTA_END:
@@ -371,20 +542,46 @@ static void mesh_rx_handler(const uint8_t *src_mac, const uint8_t *data, size_t
 }
 
 // ============================================================================
-// Callbacks
+// Announce
 // ============================================================================
 
-static void on_mesh_connected(void)
+static uint32_t fnv1a(const void *data, size_t len, uint32_t hash)
 {
-    ESP_LOGI(TAG, "Connected to mesh network!");
-    status_led_set(STATUS_LED_CONNECTED);
-
-    // Check if we just completed an OTA update
-    if (ota_receiver_check_post_update()) {
-        ESP_LOGI(TAG, "Post-OTA update check completed");
+    const uint8_t *p = (const uint8_t *)data;
+    while (len--) {
+        hash ^= *p++;
+        hash *= 16777619u;
     }
+    return hash;
+}
+
+/**
+ * Fixed delay in [0, window) derived from the MAC, so nodes restarting
+ * together always spread out the same way
+ */
+static uint32_t rejoin_jitter_ms(uint32_t window_ms)
+{
+    if (window_ms == 0) return 0;
+    return fnv1a(s_node_mac, sizeof(s_node_mac), 2166136261u) % window_ms;
+}
+
+/**
+ * Hash of the runtime config the gateway can change
+ */
+static uint32_t runtime_config_hash(void)
+{
+    uint8_t mesh_params[2];
+    mesh_node_get_params(&mesh_params[0], &mesh_params[1]);
+    uint32_t hash = fnv1a(mesh_params, sizeof(mesh_params), 2166136261u);
+#ifdef CONFIG_NODE_DEVICE_TYPE_RELAY
+    uint8_t relay_mode = device_relay_get_mode();
+    hash = fnv1a(&relay_mode, sizeof(relay_mode), hash);
+#endif
+    return hash;
+}
 
-    // Send initial status to gateway
+static void send_announce(void)
+{
     omniapi_message_t msg;
     OMNIAPI_INIT_HEADER(&msg.header, MSG_NODE_ANNOUNCE, 0, sizeof(payload_node_announce_t));
 
@@ -397,17 +594,73 @@ static void on_mesh_connected(void)
 #elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
     announce->device_type = DEVICE_TYPE_LED_STRIP;
     announce->capabilities = CONFIG_LED_STRIP_COUNT;
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    announce->device_type = DEVICE_TYPE_DIMMER;
+    announce->capabilities = CONFIG_DIMMER_CHANNEL_COUNT;
 #else
     announce->device_type = DEVICE_TYPE_SENSOR;
     announce->capabilities = 0;
 #endif
 
-    announce->firmware_version = (1 << 16) | (1 << 8) | 2;  // v1.1.2
+    announce->firmware_version = ota_receiver_running_version();
     announce->commissioned = commissioning_is_commissioned() ? 1 : 0;
 
+    // Digest lets the gateway skip nodes whose state it already has
+#ifdef CONFIG_NODE_DEVICE_TYPE_RELAY
+    announce->state_mask = device_relay_get_all();
+#elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
+    bool led_on = false;
+    device_led_get_state(&led_on, NULL, NULL, NULL, NULL);
+    announce->state_mask = led_on ? 0x01 : 0x00;
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    uint8_t levels[DIMMER_MAX_CHANNELS];
+    device_dimmer_get_levels(levels);
+    announce->state_mask = 0;
+    for (int i = 0; i < DIMMER_MAX_CHANNELS; i++) {
+        if (levels[i] > 0) announce->state_mask |= (1 << i);
+    }
+#else
+    announce->state_mask = 0;
+#endif
+    announce->config_hash = runtime_config_hash();
+
     mesh_node_send_to_root((uint8_t *)&msg, OMNIAPI_MSG_SIZE(sizeof(payload_node_announce_t)));
 }
 
+static void announce_timer_cb(void *arg)
+{
+    if (mesh_node_is_connected()) {
+        send_announce();
+    }
+}
+
+// ============================================================================
+// Callbacks
+// ============================================================================
+
+static void on_mesh_connected(void)
+{
+    ESP_LOGI(TAG, "Connected to mesh network!");
+    status_led_set(STATUS_LED_CONNECTED);
+
+    // Check if we just completed an OTA update
+    if (ota_receiver_check_post_update()) {
+        ESP_LOGI(TAG, "Post-OTA update check completed");
+    }
+
+    // First connection after boot announces at once (a power-on already
+    // waited its jitter before starting the mesh). Reconnects usually hit
+    // the whole mesh together (gateway restart), so those are spread out.
+    uint32_t jitter_ms = rejoin_jitter_ms(CONFIG_NODE_REJOIN_JITTER_MS);
+    if (!s_announced || jitter_ms == 0 || s_announce_timer == NULL) {
+        s_announced = true;
+        send_announce();
+    } else {
+        esp_timer_stop(s_announce_timer);
+        esp_timer_start_once(s_announce_timer, (uint64_t)jitter_ms * 1000);
+    }
+}
+
 static void on_mesh_disconnected(void)
 {
     ESP_LOGW(TAG, "Disconnected from mesh network");
@@ -438,6 +691,10 @@ static void on_button_short_press(void)
     } else {
         device_led_off();
     }
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    // Status is sent by on_dimmer_done once the fade finishes
+    s_dimmer_seq = 0;
+    device_dimmer_toggle();
 #endif
 }
 
@@ -497,6 +754,10 @@ void app_main(void)
 #elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
     ESP_LOGI(TAG, "Device type: LED STRIP (%d LEDs)", CONFIG_LED_STRIP_COUNT);
     device_led_init();
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    ESP_LOGI(TAG, "Device type: DIMMER (%d channels)", CONFIG_DIMMER_CHANNEL_COUNT);
+    device_dimmer_set_done_cb(on_dimmer_done);
+    device_dimmer_init();
 #else
     ESP_LOGI(TAG, "Device type: SENSOR");
 #endif
@@ -512,7 +773,22 @@ void app_main(void)
     // Set LED to searching before starting mesh
     status_led_set(STATUS_LED_SEARCHING);
 
+    const esp_timer_create_args_t announce_args = {
+        .callback = announce_timer_cb,
+        .name = "announce",
+    };
+    esp_timer_create(&announce_args, &s_announce_timer);
+
     ESP_ERROR_CHECK(mesh_node_init());
+
+    // Power restored: every node boots at the same moment, stagger joining
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT) {
+        uint32_t jitter_ms = rejoin_jitter_ms(CONFIG_NODE_REJOIN_JITTER_MS);
+        ESP_LOGI(TAG, "Power-on, joining mesh in %lu ms", (unsigned long)jitter_ms);
+        vTaskDelay(pdMS_TO_TICKS(jitter_ms));
+    }
+
     ESP_ERROR_CHECK(mesh_node_start());
 
     // Main loop - process incoming messages
@@ -525,7 +801,7 @@ void app_main(void)
         // Check OTA timeout
         ota_receiver_check_timeout();
 
-        // Small delay to prevent tight loop
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Small delay to prevent tight loop; ESP-NOW frames end it early
+        mesh_fastpath_wait(pdMS_TO_TICKS(10));
     }
 }
@@ -0,0 +1,232 @@
+/**
+ * OmniaPi Node Mesh - ESP-NOW Fast Path Implementation
+ *
+ * Keys are derived from the mesh ID and password the same way as on the
+ * gateway. One frame is in flight at a time so the copy kept for the mesh
+ * fallback stays valid until its send callback.
+ */
+
+#include "mesh_fastpath.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "mbedtls/sha256.h"
+#include <string.h>
+
+static const char *TAG = "FASTPATH";
+
+#define IN_FLIGHT_TIMEOUT_US    (200 * 1000)    // Send callback never came
+
+// ============================================================================
+// Internal State
+// ============================================================================
+typedef struct {
+    uint16_t len;
+    uint8_t  data[MESH_FASTPATH_MAX_FRAME];
+} fastpath_frame_t;
+
+static SemaphoreHandle_t s_mutex = NULL;
+static QueueHandle_t s_rx_queue = NULL;
+static QueueHandle_t s_fallback_queue = NULL;
+static SemaphoreHandle_t s_wake = NULL;
+static uint8_t s_lmk[16];
+static bool s_keyed = false;
+
+// Root peer (valid while our parent is the root)
+static bool s_has_root = false;
+static uint8_t s_root_mac[6];
+static bool s_in_flight = false;
+static int64_t s_sent_us = 0;
+static fastpath_frame_t s_last_tx;
+
+// ============================================================================
+// ESP-NOW Callbacks (WiFi task)
+// ============================================================================
+
+static void fastpath_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (len <= 0 || len > MESH_FASTPATH_MAX_FRAME) return;
+    if (!s_has_root || memcmp(info->src_addr, s_root_mac, 6) != 0) return;
+
+    fastpath_frame_t frame;
+    frame.len = (uint16_t)len;
+    memcpy(frame.data, data, len);
+
+    if (xQueueSend(s_rx_queue, &frame, 0) == pdTRUE) {
+        xSemaphoreGive(s_wake);
+    } else {
+        ESP_LOGW(TAG, "RX queue full, frame dropped");
+    }
+}
+
+static void fastpath_send_cb(const wifi_tx_info_t *tx_info, esp_now_send_status_t status)
+{
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    if (s_in_flight && memcmp(tx_info->des_addr, s_root_mac, 6) == 0) {
+        if (status != ESP_NOW_SEND_SUCCESS) {
+            // Hand the frame back to the main loop for the mesh
+            xQueueSend(s_fallback_queue, &s_last_tx, 0);
+            xSemaphoreGive(s_wake);
+        }
+        s_in_flight = false;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t mesh_fastpath_init(void)
+{
+    if (s_mutex != NULL) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutex();
+    s_wake = xSemaphoreCreateBinary();
+    s_rx_queue = xQueueCreate(MESH_FASTPATH_RX_QUEUE, sizeof(fastpath_frame_t));
+    s_fallback_queue = xQueueCreate(2, sizeof(fastpath_frame_t));
+    if (s_mutex == NULL || s_wake == NULL || s_rx_queue == NULL || s_fallback_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate fast path");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = esp_now_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_now_init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    esp_now_register_recv_cb(fastpath_recv_cb);
+    esp_now_register_send_cb(fastpath_send_cb);
+    return ESP_OK;
+}
+
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password)
+{
+    if (s_mutex == NULL) return;
+
+    // PMK || LMK = SHA-256("omniapi-fastpath" || mesh ID || password)
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, (const uint8_t *)"omniapi-fastpath", 16);
+    mbedtls_sha256_update(&sha, mesh_id, 6);
+    if (password) {
+        mbedtls_sha256_update(&sha, (const uint8_t *)password, strlen(password));
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    mesh_fastpath_set_root(NULL);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_now_set_pmk(digest);
+    memcpy(s_lmk, digest + 16, sizeof(s_lmk));
+    s_keyed = true;
+    xSemaphoreGive(s_mutex);
+}
+
+void mesh_fastpath_set_root(const uint8_t *root_ap_mac)
+{
+    if (s_mutex == NULL) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    if (s_has_root && (root_ap_mac == NULL || memcmp(root_ap_mac, s_root_mac, 6) != 0)) {
+        esp_now_del_peer(s_root_mac);
+        s_has_root = false;
+        s_in_flight = false;
+        ESP_LOGI(TAG, "Root peer dropped");
+    }
+
+    if (root_ap_mac != NULL && !s_has_root && s_keyed) {
+        esp_now_peer_info_t peer = {0};
+        memcpy(peer.peer_addr, root_ap_mac, 6);
+        peer.channel = 0;                   // Current (mesh) channel
+        peer.ifidx = WIFI_IF_STA;           // Associated to the root's softAP
+        peer.encrypt = true;
+        memcpy(peer.lmk, s_lmk, sizeof(s_lmk));
+
+        esp_err_t ret = esp_now_add_peer(&peer);
+        if (ret == ESP_OK) {
+            memcpy(s_root_mac, root_ap_mac, 6);
+            s_has_root = true;
+            ESP_LOGI(TAG, "Root peer %02X:%02X:%02X:%02X:%02X:%02X added",
+                     root_ap_mac[0], root_ap_mac[1], root_ap_mac[2],
+                     root_ap_mac[3], root_ap_mac[4], root_ap_mac[5]);
+        } else {
+            ESP_LOGW(TAG, "Failed to add root peer: %s", esp_err_to_name(ret));
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+esp_err_t mesh_fastpath_send(const uint8_t *data, size_t len)
+{
+    if (s_mutex == NULL) return ESP_ERR_INVALID_STATE;
+    if (len > MESH_FASTPATH_MAX_FRAME) return ESP_ERR_INVALID_SIZE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    int64_t now = esp_timer_get_time();
+    if (!s_has_root) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (s_in_flight && now - s_sent_us < IN_FLIGHT_TIMEOUT_US) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t dest[6];
+    memcpy(dest, s_root_mac, 6);
+    memcpy(s_last_tx.data, data, len);
+    s_last_tx.len = (uint16_t)len;
+    s_in_flight = true;
+    s_sent_us = now;
+    xSemaphoreGive(s_mutex);
+
+    // Not under the mutex: the send callback needs it
+    esp_err_t ret = esp_now_send(dest, data, len);
+    if (ret != ESP_OK && xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        s_in_flight = false;
+        xSemaphoreGive(s_mutex);
+    }
+    return ret;
+}
+
+bool mesh_fastpath_recv(uint8_t *buf, size_t *len)
+{
+    if (s_rx_queue == NULL) return false;
+
+    fastpath_frame_t frame;
+    if (xQueueReceive(s_rx_queue, &frame, 0) != pdTRUE) return false;
+
+    memcpy(buf, frame.data, frame.len);
+    *len = frame.len;
+    return true;
+}
+
+bool mesh_fastpath_take_fallback(uint8_t *buf, size_t *len)
+{
+    if (s_fallback_queue == NULL) return false;
+
+    fastpath_frame_t frame;
+    if (xQueueReceive(s_fallback_queue, &frame, 0) != pdTRUE) return false;
+
+    memcpy(buf, frame.data, frame.len);
+    *len = frame.len;
+    return true;
+}
+
+void mesh_fastpath_wait(TickType_t ticks)
+{
+    if (s_wake == NULL) {
+        vTaskDelay(ticks);
+        return;
+    }
+    xSemaphoreTake(s_wake, ticks);
+}
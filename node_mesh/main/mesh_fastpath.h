@@ -0,0 +1,85 @@
+/**
+ * OmniaPi Node Mesh - ESP-NOW Fast Path
+ *
+ * A node whose parent is the root (layer 2) also registers the root as an
+ * encrypted ESP-NOW peer on the mesh channel. The gateway sends device
+ * commands to it that way, and status replies go back the same way,
+ * falling back to the mesh if delivery fails.
+ */
+
+#ifndef MESH_FASTPATH_H
+#define MESH_FASTPATH_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define MESH_FASTPATH_MAX_FRAME     250     // ESP_NOW_MAX_DATA_LEN
+#define MESH_FASTPATH_RX_QUEUE      4
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+/**
+ * Initialize ESP-NOW alongside the mesh (WiFi must be started)
+ * @return ESP_OK on success
+ */
+esp_err_t mesh_fastpath_init(void);
+
+/**
+ * Derive the ESP-NOW keys for a mesh and drop the peer (call on mesh start)
+ * @param mesh_id   Mesh ID
+ * @param password  Mesh AP password
+ */
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password);
+
+/**
+ * Set the root peer
+ * @param root_ap_mac  Parent BSSID when the parent is the root, NULL otherwise
+ */
+void mesh_fastpath_set_root(const uint8_t *root_ap_mac);
+
+/**
+ * Send a frame to the root over ESP-NOW.
+ * If delivery fails on air the frame is handed back through
+ * mesh_fastpath_take_fallback() for the caller to resend over the mesh.
+ *
+ * @return ESP_OK if sent, ESP_ERR_NOT_FOUND if the parent isn't the root,
+ *         ESP_ERR_INVALID_STATE if a frame is already in flight
+ */
+esp_err_t mesh_fastpath_send(const uint8_t *data, size_t len);
+
+/**
+ * Take a frame received from the root over ESP-NOW (non-blocking)
+ * @param buf  At least MESH_FASTPATH_MAX_FRAME bytes
+ * @param len  Frame length
+ * @return true if a frame was taken
+ */
+bool mesh_fastpath_recv(uint8_t *buf, size_t *len);
+
+/**
+ * Take a frame whose ESP-NOW delivery failed (non-blocking)
+ * @return true if a frame was taken
+ */
+bool mesh_fastpath_take_fallback(uint8_t *buf, size_t *len);
+
+/**
+ * Block until ESP-NOW traffic arrives or the timeout expires
+ */
+void mesh_fastpath_wait(TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_FASTPATH_H
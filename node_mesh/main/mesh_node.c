@@ -8,6 +8,8 @@
 #include "mesh_node.h"
 #include "commissioning.h"
 #include "omniapi_protocol.h"
+#include "nvs_storage.h"
+#include "mesh_fastpath.h"
 
 #include <string.h>
 #include "freertos/FreeRTOS.h"
@@ -18,6 +20,7 @@
 #include "esp_mesh.h"
 #include "esp_mesh_internal.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 
 static const char *TAG = "MESH_NODE";
 
@@ -32,6 +35,20 @@ static const char *MESH_PASSWORD_DISCOVERY_DEFAULT = MESH_PASSWORD_DISCOVERY;
 #define RX_BUFFER_SIZE      1500
 #define TX_BUFFER_SIZE      1460
 
+#define MESH_PARAMS_KEY         "mesh_params"
+#define MESH_CHANNEL_KEY        "mesh_channel"
+#define PARENT_SWITCH_TIMEOUT_US (8 * 1000 * 1000)  // Give up on a requested parent after 8s
+#define REJOIN_CACHE_KEY        "mesh_rejoin"
+#define REJOIN_TIMEOUT_US       (4 * 1000 * 1000)  // Fall back to a full scan after 4s
+
+// Where this node last sat in the mesh, reused to skip the scan at boot
+typedef struct {
+    uint8_t mesh_id[6];
+    uint8_t parent_bssid[6];
+    uint8_t root_mac[6];
+    uint8_t layer;
+} rejoin_cache_t;
+
 // ============================================================================
 // State
 // ============================================================================
@@ -44,8 +61,33 @@ static mesh_addr_t s_root_addr = {0};
 static int8_t s_parent_rssi = 0;
 static esp_netif_t *s_netif_sta = NULL;
 
+// Parent link counters, reset each time they are reported (heartbeat ACK)
+static uint16_t s_link_tx = 0;
+static uint16_t s_link_fail = 0;
+static uint8_t s_parent_changes = 0;
+
+// Mesh shape (gateway-tuned, see mesh_node_set_params)
+static uint8_t s_max_layer = CONFIG_MESH_MAX_LAYER;
+static uint8_t s_max_connection = CONFIG_MESH_AP_CONNECTIONS;
+
+// Channel announced by the gateway (CSA) or found by a full-channel search
+static uint8_t s_mesh_channel = CONFIG_MESH_CHANNEL;
+
+// Gateway-requested parent switch in progress
+static esp_timer_handle_t s_switch_timer = NULL;
+static bool s_switching = false;
+
+// Boot rejoin (cached parent) and boot latency report
+static rejoin_cache_t s_rejoin_cache = {0};
+static bool s_fast_rejoin = false;
+static uint8_t s_rejoin_mode = REJOIN_SCAN;
+static uint32_t s_boot_connect_ms = 0;
+
 static uint8_t s_rx_buffer[RX_BUFFER_SIZE];
 
+// Gateway's last command came over ESP-NOW, so replies go back that way
+static bool s_gateway_fast = false;
+
 // Current mesh credentials (discovery or production)
 static uint8_t s_current_mesh_id[6] = {0};
 static char s_current_mesh_password[33] = {0};
@@ -62,6 +104,118 @@ void mesh_node_set_connected_cb(void (*cb)(void)) { s_connected_cb = cb; }
 void mesh_node_set_disconnected_cb(void (*cb)(void)) { s_disconnected_cb = cb; }
 void mesh_node_set_rx_cb(mesh_node_rx_cb_t cb) { s_rx_cb = cb; }
 
+// ============================================================================
+// Channel
+// ============================================================================
+
+static void remember_channel(uint8_t channel)
+{
+    if (channel == 0 || channel == s_mesh_channel) return;
+    s_mesh_channel = channel;
+    nvs_storage_save_blob(MESH_CHANNEL_KEY, &channel, sizeof(channel));
+    ESP_LOGI(TAG, "Mesh channel is now %d", channel);
+}
+
+// ============================================================================
+// Parent Switch
+// ============================================================================
+
+/**
+ * Hand parent selection back to ESP-MESH (keeps the current parent if any)
+ */
+static void end_parent_switch(bool connected)
+{
+    if (!s_switching) return;
+    s_switching = false;
+    esp_timer_stop(s_switch_timer);
+    esp_mesh_set_self_organized(true, !connected);
+    if (s_fast_rejoin) {
+        s_fast_rejoin = false;
+        s_rejoin_mode = connected ? REJOIN_FAST : REJOIN_FAST_FAILED;
+        ESP_LOGI(TAG, "Fast rejoin %s", connected ? "done" : "timed out, scanning");
+        return;
+    }
+    ESP_LOGI(TAG, "Parent switch %s", connected ? "done" : "timed out, self-organizing");
+}
+
+static void switch_timeout_cb(void *arg)
+{
+    end_parent_switch(s_connected);
+}
+
+/**
+ * Associate with a given parent, self-organizing stays off until
+ * end_parent_switch (connected or timed out)
+ */
+static esp_err_t begin_manual_parent(const uint8_t *parent_bssid, uint8_t parent_layer,
+                                     uint64_t timeout_us)
+{
+    if (s_switch_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = switch_timeout_cb,
+            .name = "parent_switch",
+        };
+        esp_err_t ret = esp_timer_create(&args, &s_switch_timer);
+        if (ret != ESP_OK) return ret;
+    }
+
+    wifi_config_t parent = {0};
+    memcpy(parent.sta.bssid, parent_bssid, 6);
+    parent.sta.bssid_set = true;
+    parent.sta.channel = s_mesh_channel;
+    memcpy(parent.sta.password, s_current_mesh_password, strlen(s_current_mesh_password));
+
+    mesh_addr_t mesh_id;
+    memcpy(mesh_id.addr, s_current_mesh_id, 6);
+
+    esp_mesh_set_self_organized(false, false);
+    esp_err_t ret = esp_mesh_set_parent(&parent, &mesh_id, MESH_NODE, parent_layer + 1);
+    if (ret != ESP_OK) {
+        esp_mesh_set_self_organized(true, !s_connected);
+        return ret;
+    }
+    s_switching = true;
+    esp_timer_start_once(s_switch_timer, timeout_us);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Rejoin Cache
+// ============================================================================
+
+static void save_rejoin_cache(void)
+{
+    if (!s_is_production_mesh) return;
+
+    rejoin_cache_t cache;
+    memcpy(cache.mesh_id, s_current_mesh_id, 6);
+    memcpy(cache.parent_bssid, s_parent_addr.addr, 6);
+    memcpy(cache.root_mac, s_root_addr.addr, 6);
+    cache.layer = (s_mesh_layer > 0 && s_mesh_layer <= UINT8_MAX) ? s_mesh_layer : 0;
+
+    // Flash write only when the node actually moved
+    if (memcmp(&cache, &s_rejoin_cache, sizeof(cache)) == 0) return;
+    if (nvs_storage_save_blob(REJOIN_CACHE_KEY, &cache, sizeof(cache)) == ESP_OK) {
+        s_rejoin_cache = cache;
+    }
+}
+
+/**
+ * Load the cache for this mesh, false if there is nothing usable
+ */
+static bool load_rejoin_cache(void)
+{
+    size_t len = sizeof(s_rejoin_cache);
+    if (nvs_storage_load_blob(REJOIN_CACHE_KEY, &s_rejoin_cache, &len) != ESP_OK ||
+        len != sizeof(s_rejoin_cache)) {
+        memset(&s_rejoin_cache, 0, sizeof(s_rejoin_cache));
+        return false;
+    }
+    // Layer 1 is the gateway, anything below 2 or past the depth cap is stale
+    return memcmp(s_rejoin_cache.mesh_id, s_current_mesh_id, 6) == 0 &&
+           s_rejoin_cache.layer >= 2 && s_rejoin_cache.layer <= s_max_layer;
+}
+
 // ============================================================================
 // Event Handlers
 // ============================================================================
@@ -81,6 +235,22 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             break;
         }
 
+        case MESH_EVENT_CHANNEL_SWITCH: {
+            // Gateway announced a channel change, the mesh follows in place
+            mesh_event_channel_switch_t *sw = (mesh_event_channel_switch_t *)event_data;
+            ESP_LOGI(TAG, "<MESH_EVENT_CHANNEL_SWITCH> new channel:%d", sw->channel);
+            remember_channel(sw->channel);
+            break;
+        }
+
+        case MESH_EVENT_FIND_NETWORK: {
+            // Full-channel search found the mesh elsewhere (missed a switch)
+            mesh_event_find_network_t *find = (mesh_event_find_network_t *)event_data;
+            ESP_LOGI(TAG, "<MESH_EVENT_FIND_NETWORK> channel:%d", find->channel);
+            remember_channel(find->channel);
+            break;
+        }
+
         case MESH_EVENT_STOPPED: {
             ESP_LOGI(TAG, "<MESH_EVENT_STOPPED>");
             s_mesh_started = false;
@@ -122,6 +292,12 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
         case MESH_EVENT_PARENT_CONNECTED: {
             mesh_event_connected_t *connected = (mesh_event_connected_t *)event_data;
             s_mesh_layer = connected->self_layer;
+            static const uint8_t zero_mac[6] = {0};
+            if (memcmp(s_parent_addr.addr, zero_mac, 6) != 0 &&
+                memcmp(s_parent_addr.addr, connected->connected.bssid, 6) != 0 &&
+                s_parent_changes < UINT8_MAX) {
+                s_parent_changes++;
+            }
             memcpy(&s_parent_addr.addr, connected->connected.bssid, 6);
 
             ESP_LOGI(TAG, "<MESH_EVENT_PARENT_CONNECTED> layer:%d, parent:%02X:%02X:%02X:%02X:%02X:%02X (%s)",
@@ -131,6 +307,13 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
                      s_is_production_mesh ? "PRODUCTION" : "DISCOVERY");
 
             s_connected = true;
+            mesh_fastpath_set_root(s_mesh_layer == 2 ? s_parent_addr.addr : NULL);
+            if (s_boot_connect_ms == 0) {
+                s_boot_connect_ms = (uint32_t)(esp_timer_get_time() / 1000);
+                ESP_LOGI(TAG, "Boot to connected: %lu ms", (unsigned long)s_boot_connect_ms);
+            }
+            end_parent_switch(true);
+            save_rejoin_cache();
             if (s_connected_cb) s_connected_cb();
             break;
         }
@@ -140,6 +323,8 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGW(TAG, "<MESH_EVENT_PARENT_DISCONNECTED> reason:%d", disc->reason);
             s_connected = false;
             s_mesh_layer = -1;
+            s_gateway_fast = false;
+            mesh_fastpath_set_root(NULL);
             if (s_disconnected_cb) s_disconnected_cb();
             break;
         }
@@ -149,6 +334,7 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "<MESH_EVENT_LAYER_CHANGE> %d -> %d",
                      s_mesh_layer, layer->new_layer);
             s_mesh_layer = layer->new_layer;
+            mesh_fastpath_set_root(s_mesh_layer == 2 ? s_parent_addr.addr : NULL);
             break;
         }
 
@@ -158,6 +344,7 @@ static void mesh_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "<MESH_EVENT_ROOT_ADDRESS> root:%02X:%02X:%02X:%02X:%02X:%02X",
                      root->addr[0], root->addr[1], root->addr[2],
                      root->addr[3], root->addr[4], root->addr[5]);
+            if (s_connected) save_rejoin_cache();
             break;
         }
 
@@ -233,6 +420,9 @@ esp_err_t mesh_node_init(void)
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_FLASH));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    // ESP-NOW beside the mesh for when the parent is the root
+    mesh_fastpath_init();
+
     // Initialize mesh
     ESP_ERROR_CHECK(esp_mesh_init());
 
@@ -275,12 +465,20 @@ esp_err_t mesh_node_start(void)
     ESP_LOGI(TAG, "  Mesh ID: %02X:%02X:%02X:%02X:%02X:%02X",
              s_current_mesh_id[0], s_current_mesh_id[1], s_current_mesh_id[2],
              s_current_mesh_id[3], s_current_mesh_id[4], s_current_mesh_id[5]);
+    mesh_fastpath_set_mesh(s_current_mesh_id, s_current_mesh_password);
 
     // Configure mesh topology (tree)
     ESP_ERROR_CHECK(esp_mesh_set_topology(MESH_TOPO_TREE));
 
     // Set max layer
-    ESP_ERROR_CHECK(esp_mesh_set_max_layer(CONFIG_MESH_MAX_LAYER));
+    config_mesh_params_t params;
+    size_t params_len = sizeof(params);
+    if (nvs_storage_load_blob(MESH_PARAMS_KEY, &params, &params_len) == ESP_OK &&
+        params_len == sizeof(params)) {
+        s_max_layer = params.max_layer;
+        s_max_connection = params.max_connection;
+    }
+    ESP_ERROR_CHECK(esp_mesh_set_max_layer(s_max_layer));
 
     // Set vote percentage
     ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(1));
@@ -299,7 +497,15 @@ esp_err_t mesh_node_start(void)
     memcpy(&cfg.mesh_id, s_current_mesh_id, 6);
 
     // Channel (must match gateway)
-    cfg.channel = CONFIG_MESH_CHANNEL;
+    uint8_t channel = 0;
+    size_t channel_len = sizeof(channel);
+    if (nvs_storage_load_blob(MESH_CHANNEL_KEY, &channel, &channel_len) == ESP_OK &&
+        channel >= 1 && channel <= 14) {
+        s_mesh_channel = channel;
+    }
+    cfg.channel = s_mesh_channel;
+    // Search all channels if the mesh isn't found there (gateway moved while we were off)
+    cfg.allow_channel_switch = true;
 
     // Router configuration (required by ESP-MESH even for non-root nodes)
     memcpy((uint8_t *)&cfg.router.ssid, CONFIG_MESH_ROUTER_SSID, strlen(CONFIG_MESH_ROUTER_SSID));
@@ -308,7 +514,7 @@ esp_err_t mesh_node_start(void)
 
     // Mesh softAP configuration (for child nodes to connect)
     ESP_ERROR_CHECK(esp_mesh_set_ap_authmode(WIFI_AUTH_WPA2_PSK));
-    cfg.mesh_ap.max_connection = CONFIG_MESH_AP_CONNECTIONS;  // Allow child nodes for relay/multi-hop
+    cfg.mesh_ap.max_connection = s_max_connection;  // Allow child nodes for relay/multi-hop
     cfg.mesh_ap.nonmesh_max_connection = 0;  // No non-mesh connections on nodes
 
     // Set mesh password (discovery or production)
@@ -322,16 +528,38 @@ esp_err_t mesh_node_start(void)
     // NOTE: Do NOT set MESH_LEAF - it prevents relay/multi-hop!
     ESP_ERROR_CHECK(esp_mesh_fix_root(true));        // There IS a fixed root (gateway)
 
-    // Self-organized but NEVER try to become root
-    ESP_ERROR_CHECK(esp_mesh_set_self_organized(true, false));
+    // Known place in the production mesh: go straight back to the cached
+    // parent instead of scanning, and fall back to a scan if it is gone
+    bool fast_rejoin = s_is_production_mesh && load_rejoin_cache();
+    if (fast_rejoin) {
+        memcpy(s_root_addr.addr, s_rejoin_cache.root_mac, 6);
+        ESP_ERROR_CHECK(esp_mesh_set_self_organized(false, false));
+    } else {
+        // Self-organized but NEVER try to become root
+        ESP_ERROR_CHECK(esp_mesh_set_self_organized(true, false));
+    }
 
     // Start mesh
     ESP_ERROR_CHECK(esp_mesh_start());
 
+    if (fast_rejoin) {
+        const uint8_t *bssid = s_rejoin_cache.parent_bssid;
+        ESP_LOGI(TAG, "Fast rejoin via %02X:%02X:%02X:%02X:%02X:%02X (layer %d)",
+                 bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5],
+                 s_rejoin_cache.layer - 1);
+        s_fast_rejoin = true;
+        if (begin_manual_parent(bssid, s_rejoin_cache.layer - 1, REJOIN_TIMEOUT_US) != ESP_OK) {
+            s_fast_rejoin = false;
+            s_rejoin_mode = REJOIN_FAST_FAILED;
+            esp_mesh_set_self_organized(true, true);
+        }
+    }
+
     ESP_LOGI(TAG, "Mesh node started - searching for %s network...",
              s_is_production_mesh ? "PRODUCTION" : "DISCOVERY");
-    ESP_LOGI(TAG, "  Channel: %d", CONFIG_MESH_CHANNEL);
-    ESP_LOGI(TAG, "  Max Layer: %d", CONFIG_MESH_MAX_LAYER);
+    ESP_LOGI(TAG, "  Channel: %d", s_mesh_channel);
+    ESP_LOGI(TAG, "  Max Layer: %d", s_max_layer);
+    ESP_LOGI(TAG, "  Max Connections: %d", s_max_connection);
 
     return ESP_OK;
 }
@@ -340,24 +568,61 @@ esp_err_t mesh_node_stop(void)
 {
     ESP_LOGI(TAG, "Stopping mesh node...");
     s_connected = false;
+    if (s_switching) {
+        s_switching = false;
+        s_fast_rejoin = false;
+        esp_timer_stop(s_switch_timer);
+    }
     return esp_mesh_stop();
 }
 
-// ============================================================================
-// Messaging
-// ============================================================================
-
-esp_err_t mesh_node_send_to_root(const uint8_t *data, size_t len)
+esp_err_t mesh_node_set_params(uint8_t max_layer, uint8_t max_connection)
 {
-    if (!s_mesh_started || !s_connected) {
-        ESP_LOGW(TAG, "Not connected to mesh");
-        return ESP_ERR_INVALID_STATE;
+    if (max_layer < 2 || max_layer > 25 || max_connection < 1 || max_connection > 10) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (max_layer == s_max_layer && max_connection == s_max_connection) {
+        return ESP_OK;
     }
 
-    if (data == NULL || len == 0 || len > TX_BUFFER_SIZE) {
+    config_mesh_params_t params = {
+        .max_layer = max_layer,
+        .max_connection = max_connection,
+    };
+    esp_err_t ret = nvs_storage_save_blob(MESH_PARAMS_KEY, &params, sizeof(params));
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Mesh params saved: max_layer=%d max_connection=%d (next mesh start)",
+                 max_layer, max_connection);
+    }
+    return ret;
+}
+
+esp_err_t mesh_node_switch_parent(const uint8_t *parent_bssid, uint8_t parent_layer)
+{
+    if (parent_bssid == NULL || parent_layer < 1 || parent_layer >= s_max_layer) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (!s_mesh_started || !s_connected || s_switching) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (memcmp(parent_bssid, s_parent_addr.addr, 6) == 0) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Switching parent to %02X:%02X:%02X:%02X:%02X:%02X (layer %d)",
+             parent_bssid[0], parent_bssid[1], parent_bssid[2],
+             parent_bssid[3], parent_bssid[4], parent_bssid[5], parent_layer);
 
+    // Manual parent selection until associated (or timed out)
+    return begin_manual_parent(parent_bssid, parent_layer, PARENT_SWITCH_TIMEOUT_US);
+}
+
+// ============================================================================
+// Messaging
+// ============================================================================
+
+static esp_err_t mesh_send_to_root(const uint8_t *data, size_t len)
+{
     mesh_data_t mesh_data = {
         .data = (uint8_t *)data,
         .size = len,
@@ -368,17 +633,66 @@ esp_err_t mesh_node_send_to_root(const uint8_t *data, size_t len)
     // Send to root (NULL destination = root)
     esp_err_t ret = esp_mesh_send(NULL, &mesh_data, MESH_DATA_TODS, NULL, 0);
 
+    if (s_link_tx < UINT16_MAX) s_link_tx++;
     if (ret != ESP_OK) {
+        if (s_link_fail < UINT16_MAX) s_link_fail++;
         ESP_LOGW(TAG, "Send to root failed: %s", esp_err_to_name(ret));
     }
 
     return ret;
 }
 
+static bool is_fast_command(uint8_t msg_type)
+{
+    return msg_type == MSG_RELAY_CMD || msg_type == MSG_LED_CMD || msg_type == MSG_DIMMER_CMD;
+}
+
+esp_err_t mesh_node_send_to_root(const uint8_t *data, size_t len)
+{
+    if (!s_mesh_started || !s_connected) {
+        ESP_LOGW(TAG, "Not connected to mesh");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (data == NULL || len == 0 || len > TX_BUFFER_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Status replies follow the path the gateway's commands take
+    const omniapi_header_t *header = (const omniapi_header_t *)data;
+    if (s_gateway_fast && len >= sizeof(omniapi_header_t) &&
+        (header->msg_type == MSG_RELAY_STATUS || header->msg_type == MSG_LED_STATUS ||
+         header->msg_type == MSG_DIMMER_STATUS) &&
+        mesh_fastpath_send(data, len) == ESP_OK) {
+        return ESP_OK;
+    }
+
+    return mesh_send_to_root(data, len);
+}
+
 void mesh_node_process_rx(void)
 {
     if (!s_mesh_started) return;
 
+    size_t fast_len = 0;
+
+    // ESP-NOW frames that didn't make it go out over the mesh instead
+    while (mesh_fastpath_take_fallback(s_rx_buffer, &fast_len)) {
+        if (s_connected) mesh_send_to_root(s_rx_buffer, fast_len);
+    }
+
+    // Commands from the root over ESP-NOW
+    while (mesh_fastpath_recv(s_rx_buffer, &fast_len)) {
+        const omniapi_header_t *header = (const omniapi_header_t *)s_rx_buffer;
+        if (fast_len >= sizeof(omniapi_header_t) && is_fast_command(header->msg_type)) {
+            s_gateway_fast = true;
+        }
+        ESP_LOGD(TAG, "RX over ESP-NOW len=%d", (int)fast_len);
+        if (s_rx_cb) {
+            s_rx_cb(s_root_addr.addr, s_rx_buffer, fast_len);
+        }
+    }
+
     mesh_addr_t from;
     mesh_data_t data;
     int flag = 0;
@@ -394,6 +708,11 @@ void mesh_node_process_rx(void)
                  from.addr[0], from.addr[1], from.addr[2], from.addr[3],
                  from.addr[4], from.addr[5], (int)data.size, flag);
 
+        const omniapi_header_t *header = (const omniapi_header_t *)data.data;
+        if (data.size >= sizeof(omniapi_header_t) && is_fast_command(header->msg_type)) {
+            s_gateway_fast = false;
+        }
+
         // Call application callback
         if (s_rx_cb) {
             s_rx_cb(from.addr, data.data, data.size);
@@ -424,6 +743,29 @@ int8_t mesh_node_get_parent_rssi(void)
     return s_parent_rssi;
 }
 
+void mesh_node_take_link_stats(uint8_t *parent_mac, uint16_t *tx, uint16_t *fail, uint8_t *parent_changes)
+{
+    if (parent_mac) memcpy(parent_mac, s_parent_addr.addr, 6);
+    if (tx) *tx = s_link_tx;
+    if (fail) *fail = s_link_fail;
+    if (parent_changes) *parent_changes = s_parent_changes;
+    s_link_tx = 0;
+    s_link_fail = 0;
+    s_parent_changes = 0;
+}
+
+void mesh_node_get_params(uint8_t *max_layer, uint8_t *max_connection)
+{
+    if (max_layer) *max_layer = s_max_layer;
+    if (max_connection) *max_connection = s_max_connection;
+}
+
+void mesh_node_get_boot_report(uint8_t *rejoin_mode, uint32_t *boot_connect_ms)
+{
+    if (rejoin_mode) *rejoin_mode = s_rejoin_mode;
+    if (boot_connect_ms) *boot_connect_ms = s_boot_connect_ms;
+}
+
 void mesh_node_get_root_mac(uint8_t *mac)
 {
     if (mac) {
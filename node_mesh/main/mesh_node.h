@@ -66,6 +66,23 @@ esp_err_t mesh_node_start(void);
  */
 esp_err_t mesh_node_stop(void);
 
+/**
+ * Save mesh shape limits sent by the gateway (applied on next mesh start)
+ * @param max_layer       Maximum mesh layer (2..25)
+ * @param max_connection  Children accepted on the mesh softAP (1..10)
+ * @return ESP_OK on success
+ */
+esp_err_t mesh_node_set_params(uint8_t max_layer, uint8_t max_connection);
+
+/**
+ * Move to another parent. Self-organised selection resumes once associated,
+ * or after a timeout if the parent cannot be reached.
+ * @param parent_bssid  Mesh softAP MAC of the new parent
+ * @param parent_layer  Layer of the new parent (root = 1)
+ * @return ESP_OK if the switch was started (or already on that parent)
+ */
+esp_err_t mesh_node_switch_parent(const uint8_t *parent_bssid, uint8_t parent_layer);
+
 // ============================================================================
 // Messaging
 // ============================================================================
@@ -103,6 +120,30 @@ int mesh_node_get_layer(void);
  */
 int8_t mesh_node_get_parent_rssi(void);
 
+/**
+ * Get parent link counters (frames sent towards root, send failures, parent
+ * switches) accumulated since the previous call, and reset them
+ * @param parent_mac      Parent BSSID (6 bytes, may be NULL)
+ * @param tx              Frames sent (may be NULL)
+ * @param fail            Send failures (may be NULL)
+ * @param parent_changes  Parent switches (may be NULL)
+ */
+void mesh_node_take_link_stats(uint8_t *parent_mac, uint16_t *tx, uint16_t *fail, uint8_t *parent_changes);
+
+/**
+ * Get the mesh shape in use (not a pending mesh_node_set_params)
+ * @param max_layer       Output (may be NULL)
+ * @param max_connection  Output (may be NULL)
+ */
+void mesh_node_get_params(uint8_t *max_layer, uint8_t *max_connection);
+
+/**
+ * Get how this boot joined the mesh
+ * @param rejoin_mode      REJOIN_SCAN / REJOIN_FAST / REJOIN_FAST_FAILED (may be NULL)
+ * @param boot_connect_ms  Boot to first parent connection, 0 if not yet (may be NULL)
+ */
+void mesh_node_get_boot_report(uint8_t *rejoin_mode, uint32_t *boot_connect_ms);
+
 /**
  * Get root MAC address
  */
@@ -10,6 +10,7 @@
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_ota_ops.h"
+#include "esp_partition.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 #include "esp_app_desc.h"
@@ -20,6 +21,7 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "OTA_RX";
 
@@ -29,6 +31,9 @@ static const char *TAG = "OTA_RX";
 #define NVS_NAMESPACE           "ota_state"
 #define NVS_KEY_PENDING         "pending"
 #define NVS_KEY_VERSION         "new_ver"
+#define NVS_KEY_RESUME          "resume"    // Push-mode resume checkpoint (header + bitmaps)
+
+#define FLASH_SECTOR_SIZE       4096
 
 // ============================================================================
 // OTA Mode
@@ -75,8 +80,30 @@ typedef struct {
 
     // CRC32 for push mode
     uint32_t computed_crc;
+
+    // Push-mode resume state (keyed by image id)
+    uint8_t  image_id[OTA_IMAGE_ID_LEN];
+    bool     resumable;             // Gateway sent an image id, checkpoints enabled
+    uint8_t *chunk_map;             // Received-chunk bitmap (1 bit per chunk)
+    uint8_t *sector_map;            // Erased-sector bitmap (1 bit per 4KB sector)
+    uint16_t chunks_received;       // Bits set in chunk_map
+    uint16_t chunks_since_checkpoint;
 } ota_receive_t;
 
+/**
+ * Resume checkpoint header, stored in NVS followed by chunk_map and sector_map.
+ * Only chunks whose flash write completed are ever marked, so a stale
+ * checkpoint can only under-report progress, never claim missing data.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t  image_id[OTA_IMAGE_ID_LEN];
+    uint32_t total_size;
+    uint32_t firmware_crc;
+    uint32_t partition_addr;
+    uint16_t chunk_size;
+    uint16_t total_chunks;
+} ota_resume_hdr_t;
+
 static ota_receive_t s_ota = {0};
 static uint8_t s_seq = 0;
 static uint8_t s_node_mac[6] = {0};
@@ -95,6 +122,8 @@ static void fail_ota(uint8_t error_code, const char *error_msg);
 static void cleanup_ota(void);
 static uint8_t get_device_type(void);
 static void send_ota_ack(uint16_t chunk_index, uint8_t status);
+static void resume_checkpoint(void);
+static void resume_discard(void);
 
 // ============================================================================
 // Initialization
@@ -123,6 +152,8 @@ static uint8_t get_device_type(void)
     return DEVICE_TYPE_RELAY;
 #elif defined(CONFIG_NODE_DEVICE_TYPE_LED)
     return DEVICE_TYPE_LED_STRIP;
+#elif defined(CONFIG_NODE_DEVICE_TYPE_DIMMER)
+    return DEVICE_TYPE_DIMMER;
 #else
     return DEVICE_TYPE_SENSOR;
 #endif
@@ -150,12 +181,7 @@ void ota_receiver_handle_available(const payload_ota_available_t *available)
     }
 
     // Check if we already have this version or newer
-    const esp_app_desc_t *app_desc = esp_app_get_description();
-    uint32_t current_version = 0;
-    int major, minor, patch;
-    if (sscanf(app_desc->version, "%d.%d.%d", &major, &minor, &patch) == 3) {
-        current_version = (major << 16) | (minor << 8) | patch;
-    }
+    uint32_t current_version = ota_receiver_running_version();
 
     if (available->firmware_version <= current_version) {
         ESP_LOGI(TAG, "Already have version %lu.%lu.%lu or newer",
@@ -197,6 +223,9 @@ void ota_receiver_handle_available(const payload_ota_available_t *available)
              (unsigned long)s_ota.update_partition->address,
              (unsigned long)s_ota.update_partition->size);
 
+    // Pull mode rewrites the partition through esp_ota_*, so any push checkpoint is void
+    resume_discard();
+
     // Begin OTA
     esp_err_t err = esp_ota_begin(s_ota.update_partition, s_ota.total_size, &s_ota.ota_handle);
     if (err != ESP_OK) {
@@ -279,15 +308,19 @@ static void complete_ota(void)
 {
     ESP_LOGI(TAG, "Completing OTA...");
 
-    // Finish OTA write
-    esp_err_t err = esp_ota_end(s_ota.ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
-        fail_ota(OTA_ERR_WRITE_FAILED, "OTA end failed");
-        return;
+    esp_err_t err;
+    if (s_ota.mode != OTA_MODE_PUSH) {
+        // Finish OTA write (push mode writes the partition directly, no OTA handle)
+        err = esp_ota_end(s_ota.ota_handle);
+        s_ota.ota_handle = 0;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+            fail_ota(OTA_ERR_WRITE_FAILED, "OTA end failed");
+            return;
+        }
     }
 
-    // Set boot partition
+    // Set boot partition (validates the image)
     err = esp_ota_set_boot_partition(s_ota.update_partition);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
@@ -300,9 +333,11 @@ static void complete_ota(void)
     if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
         nvs_set_u8(nvs, NVS_KEY_PENDING, 1);
         nvs_set_u32(nvs, NVS_KEY_VERSION, s_ota.firmware_version);
+        nvs_erase_key(nvs, NVS_KEY_RESUME);
         nvs_commit(nvs);
         nvs_close(nvs);
     }
+    s_ota.resumable = false;
 
     s_ota.state = OTA_RX_STATE_COMPLETE;
 
@@ -345,6 +380,18 @@ static void cleanup_ota(void)
 
     mbedtls_sha256_free(&s_ota.sha_ctx);
 
+    // Keep push-mode progress so a restarted transfer of the same image resumes
+    if (s_ota.mode == OTA_MODE_PUSH && s_ota.resumable && s_ota.chunks_since_checkpoint > 0) {
+        resume_checkpoint();
+    }
+    free(s_ota.chunk_map);
+    free(s_ota.sector_map);
+    s_ota.chunk_map = NULL;
+    s_ota.sector_map = NULL;
+    s_ota.chunks_received = 0;
+    s_ota.chunks_since_checkpoint = 0;
+    s_ota.resumable = false;
+
     s_ota.state = OTA_RX_STATE_IDLE;
     s_ota.received_size = 0;
     s_ota.next_offset = 0;
@@ -427,6 +474,16 @@ bool ota_receiver_is_active(void)
             s_ota.state == OTA_RX_STATE_VERIFYING);
 }
 
+uint32_t ota_receiver_running_version(void)
+{
+    const esp_app_desc_t *app_desc = esp_app_get_description();
+    int major, minor, patch;
+    if (sscanf(app_desc->version, "%d.%d.%d", &major, &minor, &patch) != 3) {
+        return 0;
+    }
+    return (major << 16) | (minor << 8) | patch;
+}
+
 void ota_receiver_abort(void)
 {
     if (s_ota.state != OTA_RX_STATE_IDLE) {
@@ -544,10 +601,216 @@ static bool verify_crc32(void)
     return false;
 }
 
+// ============================================================================
+// Push-Mode Resume (chunk bitmap checkpointed to NVS)
+// ============================================================================
+
+static inline bool bitmap_test(const uint8_t *map, uint32_t bit)
+{
+    return (map[bit / 8] >> (bit % 8)) & 1;
+}
+
+static inline void bitmap_set(uint8_t *map, uint32_t bit)
+{
+    map[bit / 8] |= (uint8_t)(1 << (bit % 8));
+}
+
+static size_t chunk_map_len(void)
+{
+    return (s_ota.total_chunks + 7) / 8;
+}
+
+static size_t sector_map_len(void)
+{
+    uint32_t sectors = (s_ota.total_size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    return (sectors + 7) / 8;
+}
+
+static uint16_t chunk_length(uint16_t chunk_index)
+{
+    uint32_t offset = (uint32_t)chunk_index * s_ota.chunk_size;
+    uint32_t remaining = s_ota.total_size - offset;
+    return (remaining > s_ota.chunk_size) ? s_ota.chunk_size : (uint16_t)remaining;
+}
+
+static uint16_t first_missing_chunk(void)
+{
+    for (uint16_t i = 0; i < s_ota.total_chunks; i++) {
+        if (!bitmap_test(s_ota.chunk_map, i)) {
+            return i;
+        }
+    }
+    return s_ota.total_chunks;
+}
+
+static void fill_resume_hdr(ota_resume_hdr_t *hdr)
+{
+    memcpy(hdr->image_id, s_ota.image_id, OTA_IMAGE_ID_LEN);
+    hdr->total_size = s_ota.total_size;
+    hdr->firmware_crc = s_ota.firmware_crc;
+    hdr->partition_addr = s_ota.update_partition->address;
+    hdr->chunk_size = s_ota.chunk_size;
+    hdr->total_chunks = s_ota.total_chunks;
+}
+
+/**
+ * Persist the chunk and sector bitmaps as a single blob.
+ * Called every OTA_RESUME_CHECKPOINT_CHUNKS chunks and when a session is
+ * torn down - not per chunk, to keep NVS wear and ACK latency low.
+ */
+static void resume_checkpoint(void)
+{
+    if (!s_ota.resumable || s_ota.chunk_map == NULL) return;
+
+    size_t cmap_len = chunk_map_len();
+    size_t smap_len = sector_map_len();
+    size_t len = sizeof(ota_resume_hdr_t) + cmap_len + smap_len;
+
+    uint8_t *blob = malloc(len);
+    if (blob == NULL) {
+        ESP_LOGW(TAG, "No memory for OTA checkpoint");
+        return;
+    }
+
+    ota_resume_hdr_t hdr;
+    fill_resume_hdr(&hdr);
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + sizeof(hdr), s_ota.chunk_map, cmap_len);
+    memcpy(blob + sizeof(hdr) + cmap_len, s_ota.sector_map, smap_len);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NVS_KEY_RESUME, blob, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    free(blob);
+
+    if (err == ESP_OK) {
+        s_ota.chunks_since_checkpoint = 0;
+        ESP_LOGD(TAG, "OTA checkpoint: %u/%u chunks", s_ota.chunks_received, s_ota.total_chunks);
+    } else {
+        ESP_LOGW(TAG, "OTA checkpoint failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void resume_discard(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        if (nvs_erase_key(nvs, NVS_KEY_RESUME) == ESP_OK) {
+            nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+}
+
+/**
+ * Restore bitmaps from a checkpoint of the same image into the current session
+ * @return true if progress was restored
+ */
+static bool resume_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+
+    size_t cmap_len = chunk_map_len();
+    size_t smap_len = sector_map_len();
+    size_t expected = sizeof(ota_resume_hdr_t) + cmap_len + smap_len;
+    size_t len = 0;
+    bool restored = false;
+
+    if (nvs_get_blob(nvs, NVS_KEY_RESUME, NULL, &len) == ESP_OK && len == expected) {
+        uint8_t *blob = malloc(len);
+        if (blob != NULL && nvs_get_blob(nvs, NVS_KEY_RESUME, blob, &len) == ESP_OK) {
+            ota_resume_hdr_t want;
+            fill_resume_hdr(&want);
+            if (memcmp(blob, &want, sizeof(want)) == 0) {
+                memcpy(s_ota.chunk_map, blob + sizeof(want), cmap_len);
+                memcpy(s_ota.sector_map, blob + sizeof(want) + cmap_len, smap_len);
+                restored = true;
+            }
+        }
+        free(blob);
+    }
+    nvs_close(nvs);
+
+    if (restored) {
+        s_ota.chunks_received = 0;
+        s_ota.received_size = 0;
+        for (uint16_t i = 0; i < s_ota.total_chunks; i++) {
+            if (bitmap_test(s_ota.chunk_map, i)) {
+                s_ota.chunks_received++;
+                s_ota.received_size += chunk_length(i);
+            }
+        }
+    }
+    return restored;
+}
+
+/**
+ * Write one chunk straight to the update partition, erasing each 4KB sector
+ * the first time it is touched. Bypasses esp_ota_write so that chunks can
+ * land in any order and survive a reboot.
+ */
+static esp_err_t write_push_chunk(uint32_t offset, const uint8_t *data, uint16_t len)
+{
+    uint32_t first_sector = offset / FLASH_SECTOR_SIZE;
+    uint32_t last_sector = (offset + len - 1) / FLASH_SECTOR_SIZE;
+
+    for (uint32_t sector = first_sector; sector <= last_sector; sector++) {
+        if (!bitmap_test(s_ota.sector_map, sector)) {
+            esp_err_t err = esp_partition_erase_range(s_ota.update_partition,
+                                                      sector * FLASH_SECTOR_SIZE,
+                                                      FLASH_SECTOR_SIZE);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Erase sector %lu failed: %s",
+                         (unsigned long)sector, esp_err_to_name(err));
+                return err;
+            }
+            bitmap_set(s_ota.sector_map, sector);
+        }
+    }
+
+    return esp_partition_write(s_ota.update_partition, offset, data, len);
+}
+
+/**
+ * CRC32 of the image as stored on flash (push mode, chunks may arrive out of order)
+ */
+static esp_err_t compute_partition_crc(uint32_t *crc_out)
+{
+    uint8_t *buf = malloc(1024);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t crc = 0;
+    esp_err_t err = ESP_OK;
+    for (uint32_t offset = 0; offset < s_ota.total_size; offset += 1024) {
+        uint32_t len = s_ota.total_size - offset;
+        if (len > 1024) len = 1024;
+        err = esp_partition_read(s_ota.update_partition, offset, buf, len);
+        if (err != ESP_OK) {
+            break;
+        }
+        crc = esp_crc32_le(crc, buf, len);
+    }
+
+    free(buf);
+    *crc_out = crc;
+    return err;
+}
+
 /**
  * Handle OTA BEGIN (push mode - gateway initiates)
  */
-void ota_receiver_handle_begin(const payload_ota_begin_t *begin)
+void ota_receiver_handle_begin(const payload_ota_begin_t *begin, uint16_t payload_len)
 {
     if (begin == NULL) return;
 
@@ -557,9 +820,28 @@ void ota_receiver_handle_begin(const payload_ota_begin_t *begin)
         return;
     }
 
-    ESP_LOGI(TAG, "OTA_BEGIN: size=%lu, chunks=%u, chunk_size=%u, crc=0x%08lx",
+    static const uint8_t no_image_id[OTA_IMAGE_ID_LEN] = {0};
+    bool has_image_id = payload_len >= sizeof(payload_ota_begin_t) &&
+                        memcmp(begin->image_id, no_image_id, OTA_IMAGE_ID_LEN) != 0;
+
+    ESP_LOGI(TAG, "OTA_BEGIN: size=%lu, chunks=%u, chunk_size=%u, crc=0x%08lx, resumable=%d",
              (unsigned long)begin->total_size, begin->total_chunks,
-             begin->chunk_size, (unsigned long)begin->firmware_crc);
+             begin->chunk_size, (unsigned long)begin->firmware_crc, has_image_id);
+
+    // Repeated BEGIN for the image we are already receiving (lost READY ACK or
+    // gateway restart): report where we are instead of starting over
+    if (s_ota.state == OTA_RX_STATE_RECEIVING && s_ota.mode == OTA_MODE_PUSH &&
+        has_image_id && s_ota.resumable &&
+        memcmp(s_ota.image_id, begin->image_id, OTA_IMAGE_ID_LEN) == 0 &&
+        s_ota.total_size == begin->total_size &&
+        s_ota.chunk_size == begin->chunk_size &&
+        s_ota.firmware_crc == begin->firmware_crc) {
+        uint16_t next_chunk = first_missing_chunk();
+        s_ota.last_chunk_time = esp_timer_get_time() / 1000;
+        ESP_LOGI(TAG, "OTA_BEGIN for active session, continuing at chunk %u", next_chunk);
+        send_ota_ack(next_chunk, OTA_ACK_READY);
+        return;
+    }
 
     // Check if OTA already in progress
     if (s_ota.state != OTA_RX_STATE_IDLE) {
@@ -580,6 +862,20 @@ void ota_receiver_handle_begin(const payload_ota_begin_t *begin)
     s_ota.retries = 0;
     s_ota.start_time = esp_timer_get_time() / 1000;
     s_ota.last_chunk_time = s_ota.start_time;
+    s_ota.ota_handle = 0;  // Push mode writes the partition directly
+    s_ota.chunks_received = 0;
+    s_ota.chunks_since_checkpoint = 0;
+    s_ota.resumable = has_image_id;
+    memcpy(s_ota.image_id, has_image_id ? begin->image_id : no_image_id, OTA_IMAGE_ID_LEN);
+
+    // Validate chunk layout (chunk index is derived from offset / chunk_size)
+    if (s_ota.chunk_size == 0 || s_ota.chunk_size > OTA_CHUNK_SIZE ||
+        s_ota.total_chunks != (s_ota.total_size + s_ota.chunk_size - 1) / s_ota.chunk_size) {
+        ESP_LOGE(TAG, "Invalid chunk layout: size=%lu, chunk_size=%u, chunks=%u",
+                 (unsigned long)s_ota.total_size, s_ota.chunk_size, s_ota.total_chunks);
+        send_ota_ack(0, OTA_ACK_ABORT);
+        return;
+    }
 
     // Get update partition
     s_ota.update_partition = esp_ota_get_next_update_partition(NULL);
@@ -603,19 +899,32 @@ void ota_receiver_handle_begin(const payload_ota_begin_t *begin)
         return;
     }
 
-    // Begin OTA
-    esp_err_t err = esp_ota_begin(s_ota.update_partition, s_ota.total_size, &s_ota.ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+    s_ota.chunk_map = calloc(1, chunk_map_len());
+    s_ota.sector_map = calloc(1, sector_map_len());
+    if (s_ota.chunk_map == NULL || s_ota.sector_map == NULL) {
+        ESP_LOGE(TAG, "No memory for OTA bitmaps");
+        free(s_ota.chunk_map);
+        free(s_ota.sector_map);
+        s_ota.chunk_map = NULL;
+        s_ota.sector_map = NULL;
         send_ota_ack(0, OTA_ACK_ABORT);
         return;
     }
 
+    // Resume from a checkpoint of the same image, otherwise drop any stale one
+    if (s_ota.resumable && resume_load()) {
+        ESP_LOGI(TAG, "Resuming OTA: %u/%u chunks already on flash",
+                 s_ota.chunks_received, s_ota.total_chunks);
+    } else {
+        resume_discard();
+    }
+
     s_ota.state = OTA_RX_STATE_RECEIVING;
 
-    // Send READY ACK
-    send_ota_ack(0, OTA_ACK_READY);
-    ESP_LOGI(TAG, "Ready to receive %u chunks", s_ota.total_chunks);
+    // Send READY ACK with the first chunk we still need
+    uint16_t next_chunk = first_missing_chunk();
+    send_ota_ack(next_chunk, OTA_ACK_READY);
+    ESP_LOGI(TAG, "Ready to receive %u chunks (starting at %u)", s_ota.total_chunks, next_chunk);
 }
 
 /**
@@ -639,34 +948,33 @@ void ota_receiver_handle_data(const payload_ota_data_t *data)
         ESP_LOGD(TAG, "OTA DATA (push): chunk=%u, offset=%lu, len=%u, last=%u",
                  chunk_index, (unsigned long)data->offset, data->length, data->last_chunk);
 
-        // Verify chunk index matches expected
-        if (data->offset != s_ota.received_size) {
-            ESP_LOGW(TAG, "Unexpected offset: got %lu, expected %lu",
-                     (unsigned long)data->offset, (unsigned long)s_ota.received_size);
-            // Could request retransmit, but for now just accept if it's a retry
-            if (data->offset < s_ota.received_size) {
-                // Duplicate chunk, ACK it anyway
-                send_ota_ack(chunk_index, OTA_ACK_OK);
-                return;
-            }
-            // Gap in data - this shouldn't happen in push mode
+        // Chunk must sit on the grid announced in OTA_BEGIN
+        if ((data->offset % s_ota.chunk_size) != 0 || chunk_index >= s_ota.total_chunks ||
+            data->length != chunk_length(chunk_index)) {
+            ESP_LOGW(TAG, "Invalid chunk: offset=%lu, len=%u",
+                     (unsigned long)data->offset, data->length);
             send_ota_ack(chunk_index, OTA_ACK_CRC_ERROR);
             return;
         }
 
+        // Already on flash (retransmit or resumed session), ACK without rewriting
+        if (bitmap_test(s_ota.chunk_map, chunk_index)) {
+            send_ota_ack(chunk_index, OTA_ACK_OK);
+            return;
+        }
+
         // Write data to OTA partition
-        esp_err_t err = esp_ota_write(s_ota.ota_handle, data->data, data->length);
+        esp_err_t err = write_push_chunk(data->offset, data->data, data->length);
         if (err != ESP_OK) {
-            ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
+            ESP_LOGE(TAG, "Partition write failed: %s", esp_err_to_name(err));
             send_ota_ack(chunk_index, OTA_ACK_WRITE_ERROR);
             fail_ota(OTA_ERR_WRITE_FAILED, "Write failed");
             return;
         }
 
-        // Update CRC32
-        s_ota.computed_crc = esp_crc32_le(s_ota.computed_crc, data->data, data->length);
-
         // Update progress
+        bitmap_set(s_ota.chunk_map, chunk_index);
+        s_ota.chunks_received++;
         s_ota.received_size += data->length;
         s_ota.expected_chunk = chunk_index + 1;
 
@@ -682,6 +990,11 @@ void ota_receiver_handle_data(const payload_ota_data_t *data)
         // Send ACK
         send_ota_ack(chunk_index, OTA_ACK_OK);
 
+        // Periodic checkpoint (after the ACK so the gateway isn't held up by NVS)
+        if (s_ota.resumable && ++s_ota.chunks_since_checkpoint >= OTA_RESUME_CHECKPOINT_CHUNKS) {
+            resume_checkpoint();
+        }
+
     } else {
         // Pull mode: existing behavior
         ESP_LOGD(TAG, "OTA DATA (pull): offset=%lu, len=%d, last=%d",
@@ -760,18 +1073,22 @@ void ota_receiver_handle_end(const payload_ota_end_t *end)
              end->total_chunks, (unsigned long)end->firmware_crc);
 
     // Verify all chunks received
-    if (s_ota.received_size != s_ota.total_size) {
-        ESP_LOGE(TAG, "Not all data received: %lu/%lu",
-                 (unsigned long)s_ota.received_size, (unsigned long)s_ota.total_size);
+    if (s_ota.chunks_received != s_ota.total_chunks) {
+        ESP_LOGE(TAG, "Not all data received: %u/%u chunks (first missing %u)",
+                 s_ota.chunks_received, s_ota.total_chunks, first_missing_chunk());
         fail_ota(OTA_ERR_DOWNLOAD_FAILED, "Incomplete data");
         return;
     }
 
-    // Verify CRC
+    // Verify CRC over the flash contents
     s_ota.state = OTA_RX_STATE_VERIFYING;
     ESP_LOGI(TAG, "Verifying CRC32...");
 
-    if (!verify_crc32()) {
+    esp_err_t err = compute_partition_crc(&s_ota.computed_crc);
+    if (err != ESP_OK || !verify_crc32()) {
+        // Flash contents are bad, a later resume must not trust them
+        s_ota.resumable = false;
+        resume_discard();
         fail_ota(OTA_ERR_SHA256_MISMATCH, "CRC mismatch");
         return;
     }
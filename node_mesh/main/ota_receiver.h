@@ -30,6 +30,7 @@ extern "C" {
 #define OTA_REQUEST_TIMEOUT_MS      5000    // Timeout waiting for chunk
 #define OTA_MAX_RETRIES             3       // Max retries per chunk
 #define OTA_TOTAL_TIMEOUT_MS        600000  // 10 minutes total timeout
+#define OTA_RESUME_CHECKPOINT_CHUNKS 128    // Persist push-mode chunk bitmap every N chunks (~23KB)
 
 // ============================================================================
 // OTA State
@@ -75,10 +76,13 @@ void ota_receiver_handle_abort(const payload_ota_abort_t *abort);
 
 /**
  * Handle OTA begin message from gateway (MSG_OTA_BEGIN)
- * Starts a push-mode OTA session where gateway sends chunks
- * @param begin OTA begin payload
+ * Starts a push-mode OTA session where gateway sends chunks.
+ * If the gateway sends an image id and a checkpoint for the same image exists,
+ * the session resumes and the READY ACK carries the first missing chunk.
+ * @param begin       OTA begin payload
+ * @param payload_len Payload length from header (older gateways omit image_id)
  */
-void ota_receiver_handle_begin(const payload_ota_begin_t *begin);
+void ota_receiver_handle_begin(const payload_ota_begin_t *begin, uint16_t payload_len);
 
 /**
  * Handle OTA end message from gateway (MSG_OTA_END)
@@ -107,6 +111,13 @@ int ota_receiver_get_progress(void);
  */
 bool ota_receiver_is_active(void);
 
+/**
+ * Version of the running image (its app description), as sent in
+ * announce, heartbeat ACK and scan response
+ * @return major<<16 | minor<<8 | patch, 0 if unparsable
+ */
+uint32_t ota_receiver_running_version(void);
+
 /**
  * Abort current OTA
  */
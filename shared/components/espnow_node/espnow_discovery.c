@@ -0,0 +1,244 @@
+#include "espnow_discovery.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_wifi.h"
+#include "esp_wifi_types.h"
+#include "esp_now.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+static const char *TAG = "ESPNOW_DISC";
+
+// NVS namespace and key
+#define NVS_NAMESPACE "espnow"
+#define NVS_KEY_CHANNEL "channel"
+
+static const uint8_t BROADCAST_MAC[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+static uint8_t s_gateway_mac[6];
+static bool s_gateway_known = false;
+static uint32_t s_last_heartbeat = 0;
+static uint8_t s_current_channel = 0;
+
+// Discovery state
+static volatile bool s_discovery_received = false;
+static volatile uint8_t s_discovered_channel = 0;
+static volatile uint8_t s_scan_channel = 0;     // Channel being tried
+
+// First sighting wins: DISCOVERY_ACK, heartbeat or an overheard frame
+static void mark_gateway_seen(uint8_t channel) {
+    if (!s_discovery_received) {
+        s_discovered_channel = channel;
+        s_discovery_received = true;
+    }
+}
+
+// ============== NVS Functions ==============
+
+void espnow_discovery_save_channel(uint8_t channel) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        nvs_set_u8(handle, NVS_KEY_CHANNEL, channel);
+        nvs_commit(handle);
+        nvs_close(handle);
+        ESP_LOGI(TAG, "Channel %d saved to NVS", channel);
+    }
+}
+
+uint8_t espnow_discovery_load_channel(void) {
+    nvs_handle_t handle;
+    uint8_t channel = 0;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        nvs_get_u8(handle, NVS_KEY_CHANNEL, &channel);
+        nvs_close(handle);
+        if (channel > 0 && channel <= 13) {
+            ESP_LOGI(TAG, "Channel %d loaded from NVS", channel);
+        } else {
+            channel = 0;
+        }
+    }
+    return channel;
+}
+
+// ============== Discovery ==============
+
+static void promiscuous_cb(void *buf, wifi_promiscuous_pkt_type_t type) {
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    if (pkt->rx_ctrl.sig_len < 16) return;
+
+    // Transmitter address; the gateway's softAP MAC is its STA MAC + 1
+    const uint8_t *ta = pkt->payload + 10;
+    if (memcmp(ta, s_gateway_mac, 5) == 0 &&
+        (ta[5] == s_gateway_mac[5] || ta[5] == (uint8_t)(s_gateway_mac[5] + 1))) {
+        mark_gateway_seen(s_scan_channel);
+    }
+}
+
+static bool wait_for_gateway(uint32_t timeout_ms) {
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        if (s_discovery_received) return true;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return s_discovery_received;
+}
+
+static void tune_to(uint8_t channel) {
+    s_scan_channel = channel;
+    s_discovery_received = false;
+    s_discovered_channel = 0;
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+}
+
+static bool try_channel(uint8_t channel) {
+    ESP_LOGI(TAG, "Trying channel %d...", channel);
+
+    tune_to(channel);
+    vTaskDelay(pdMS_TO_TICKS(ESPNOW_PROBE_SETTLE_MS));
+
+    // Send discovery broadcast
+    uint8_t msg[1] = {MSG_DISCOVERY};
+    esp_now_send(BROADCAST_MAC, msg, 1);
+
+    if (wait_for_gateway(ESPNOW_PROBE_WAIT_MS)) {
+        ESP_LOGI(TAG, "Gateway found on channel %d!", channel);
+        return true;
+    }
+    return false;
+}
+
+static uint8_t passive_sweep(void) {
+    wifi_promiscuous_filter_t filter = {
+        .filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA,
+    };
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(promiscuous_cb);
+    esp_wifi_set_promiscuous(true);
+
+    uint8_t found = 0;
+    for (int sweep = 0; sweep < ESPNOW_LISTEN_SWEEPS && found == 0; sweep++) {
+        for (uint8_t ch = 1; ch <= 13; ch++) {
+            tune_to(ch);
+            if (wait_for_gateway(ESPNOW_LISTEN_DWELL_MS)) {
+                found = s_discovered_channel;
+                break;
+            }
+        }
+    }
+
+    esp_wifi_set_promiscuous(false);
+    return found;
+}
+
+void espnow_discovery_set_channel(uint8_t channel) {
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    s_current_channel = channel;
+
+    esp_now_peer_info_t gw_peer = {0};
+    memcpy(gw_peer.peer_addr, s_gateway_mac, 6);
+    gw_peer.channel = channel;
+    gw_peer.ifidx = WIFI_IF_STA;
+    gw_peer.encrypt = false;
+    if (esp_now_is_peer_exist(s_gateway_mac)) {
+        esp_now_mod_peer(&gw_peer);
+    } else {
+        esp_now_add_peer(&gw_peer);
+    }
+
+    // NVS only when the gateway actually moved
+    if (espnow_discovery_load_channel() != channel) {
+        espnow_discovery_save_channel(channel);
+    }
+}
+
+uint8_t espnow_discovery_find(uint8_t saved) {
+    int64_t start = esp_timer_get_time();
+    const char *method = NULL;
+    uint8_t channel = 0;
+
+    if (saved > 0 && saved <= 13 && try_channel(saved)) {
+        channel = saved;
+        method = "saved channel";
+    }
+    if (channel == 0) {
+        channel = passive_sweep();
+        method = "passive listen";
+    }
+    for (uint8_t ch = 1; ch <= 13 && channel == 0; ch++) {
+        if (ch != saved && try_channel(ch)) {
+            channel = ch;
+            method = "active probe";
+        }
+    }
+
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    if (channel == 0) {
+        ESP_LOGW(TAG, "Gateway not found on any channel (%lu ms)", (unsigned long)elapsed_ms);
+        esp_wifi_set_channel(s_current_channel ? s_current_channel : 1, WIFI_SECOND_CHAN_NONE);
+        return 0;
+    }
+
+    ESP_LOGI(TAG, "Gateway on channel %d via %s in %lu ms",
+             channel, method, (unsigned long)elapsed_ms);
+    espnow_discovery_set_channel(channel);
+    return channel;
+}
+
+// ============== Gateway Watch ==============
+
+/**
+ * Rediscover when heartbeats stop (gateway moved channel or restarted)
+ */
+static void gateway_watch_task(void *arg) {
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        if (!s_gateway_known || now - s_last_heartbeat < ESPNOW_GATEWAY_LOST_MS) continue;
+
+        ESP_LOGW(TAG, "No heartbeat for %lu ms, looking for the gateway",
+                 (unsigned long)(now - s_last_heartbeat));
+        if (espnow_discovery_find(0) != 0) {
+            // Counts as alive until the first heartbeat on the new channel
+            s_last_heartbeat = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(ESPNOW_REDISCOVER_BACKOFF_MS));
+        }
+    }
+}
+
+void espnow_discovery_start_watch(void) {
+    static bool started = false;
+    if (started) return;
+    started = xTaskCreate(gateway_watch_task, "gw_watch", 3072, NULL, 4, NULL) == pdPASS;
+}
+
+// ============== Public API ==============
+
+void espnow_discovery_init(const uint8_t *gateway_mac) {
+    memcpy(s_gateway_mac, gateway_mac, sizeof(s_gateway_mac));
+}
+
+void espnow_discovery_heartbeat(void) {
+    s_gateway_known = true;
+    s_last_heartbeat = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mark_gateway_seen(s_scan_channel);
+}
+
+void espnow_discovery_gateway_seen(uint8_t channel) {
+    mark_gateway_seen(channel);
+    ESP_LOGI(TAG, "DISCOVERY_ACK received! Channel=%d", s_discovered_channel);
+}
+
+bool espnow_discovery_gateway_known(void) {
+    return s_gateway_known;
+}
+
+uint32_t espnow_discovery_last_heartbeat(void) {
+    return s_last_heartbeat;
+}
@@ -0,0 +1,338 @@
+#include "espnow_ota.h"
+#include "espnow_rt.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_now.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+
+static const char *TAG = "ESPNOW_OTA";
+
+#define OTA_CHUNK_MAX       (ESP_NOW_MAX_DATA_LEN - 5)
+
+typedef struct {
+    uint32_t chunk_num;
+    uint16_t len;
+    uint8_t data[OTA_CHUNK_MAX];
+} ota_chunk_t;
+
+typedef enum {
+    OTA_OP_BEGIN,
+    OTA_OP_DATA,
+    OTA_OP_END,
+} ota_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t buf;                    // Pool index (OTA_OP_DATA)
+} ota_item_t;
+
+static uint8_t s_gateway_mac[6];
+
+// Transfer state
+static esp_ota_handle_t s_ota_handle = 0;
+static const esp_partition_t *s_ota_partition = NULL;
+static uint32_t s_ota_total_size = 0;
+static uint32_t s_ota_received = 0;
+static volatile bool s_ota_in_progress = false;
+
+// Writer
+static ota_chunk_t s_ota_pool[ESPNOW_OTA_POOL_SIZE];
+static QueueHandle_t s_ota_free = NULL;     // Free pool indices
+static QueueHandle_t s_ota_items = NULL;    // Work for the writer, in arrival order
+static uint32_t s_ota_next_rx = 0;          // Next chunk to accept (WiFi task)
+static volatile uint32_t s_ota_written_next = 0;  // Next chunk to write (writer task)
+static uint32_t s_ota_start_ms = 0;
+static uint32_t s_ota_dropped = 0;          // No free buffer
+static uint32_t s_ota_duplicates = 0;       // Resent chunks
+static uint32_t s_ota_gaps = 0;             // Arrived ahead of a missing chunk
+
+// ============== Responses ==============
+
+static void send_ota_response(uint8_t msg_type, uint32_t chunk_num) {
+    uint8_t response[6] = {msg_type};
+    response[1] = chunk_num & 0xFF;
+    response[2] = (chunk_num >> 8) & 0xFF;
+    response[3] = (chunk_num >> 16) & 0xFF;
+    response[4] = (chunk_num >> 24) & 0xFF;
+
+    // READY/ACK: [type][chunk_num x4][credits]
+    if (msg_type == MSG_OTA_READY || msg_type == MSG_OTA_ACK) {
+        response[5] = s_ota_free ? (uint8_t)uxQueueMessagesWaiting(s_ota_free) : 0;
+        espnow_rt_send_plain(s_gateway_mac, response, 6);
+    } else {
+        espnow_rt_send_plain(s_gateway_mac, response, 5);
+    }
+}
+
+// ============== Writer Task ==============
+
+static void ota_fail(uint32_t chunk_num) {
+    if (s_ota_handle != 0) {
+        esp_ota_abort(s_ota_handle);
+        s_ota_handle = 0;
+    }
+    s_ota_in_progress = false;
+    send_ota_response(MSG_OTA_ERROR, chunk_num);
+}
+
+static void ota_do_begin(void) {
+    if (s_ota_handle != 0) {
+        esp_ota_abort(s_ota_handle);
+        s_ota_handle = 0;
+    }
+
+    s_ota_partition = esp_ota_get_next_update_partition(NULL);
+    if (s_ota_partition == NULL) {
+        ESP_LOGE(TAG, "No OTA partition");
+        ota_fail(0);
+        return;
+    }
+
+    esp_err_t err = esp_ota_begin(s_ota_partition, s_ota_total_size, &s_ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        s_ota_handle = 0;
+        ota_fail(0);
+        return;
+    }
+
+    s_ota_received = 0;
+    s_ota_written_next = 0;
+    s_ota_start_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    ESP_LOGI(TAG, "OTA started, partition: %s", s_ota_partition->label);
+    send_ota_response(MSG_OTA_READY, 0);
+}
+
+static void ota_do_write(const ota_chunk_t *chunk) {
+    if (!s_ota_in_progress) return;
+
+    esp_err_t err = esp_ota_write(s_ota_handle, chunk->data, chunk->len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_write failed");
+        ota_fail(chunk->chunk_num);
+        return;
+    }
+
+    s_ota_received += chunk->len;
+    s_ota_written_next = chunk->chunk_num + 1;
+
+    if (s_ota_total_size > 0) {
+        int progress = (s_ota_received * 100) / s_ota_total_size;
+        static int last_progress = -10;
+        if (progress < last_progress) last_progress = -10;  // New transfer
+        if (progress >= last_progress + 10) {
+            ESP_LOGI(TAG, "OTA: %d%%", progress);
+            last_progress = progress;
+        }
+    }
+}
+
+static void ota_do_end(void) {
+    if (!s_ota_in_progress) return;
+
+    uint32_t elapsed_ms = xTaskGetTickCount() * portTICK_PERIOD_MS - s_ota_start_ms;
+    ESP_LOGI(TAG, "OTA END, finalizing... %lu bytes in %lu ms (%lu B/s), dropped=%lu dup=%lu gap=%lu",
+             (unsigned long)s_ota_received, (unsigned long)elapsed_ms,
+             (unsigned long)(elapsed_ms ? (uint64_t)s_ota_received * 1000 / elapsed_ms : 0),
+             (unsigned long)s_ota_dropped, (unsigned long)s_ota_duplicates,
+             (unsigned long)s_ota_gaps);
+
+    esp_err_t err = esp_ota_end(s_ota_handle);
+    s_ota_handle = 0;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_end failed");
+        ota_fail(0);
+        return;
+    }
+
+    err = esp_ota_set_boot_partition(s_ota_partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed");
+        ota_fail(0);
+        return;
+    }
+
+    s_ota_in_progress = false;
+    ESP_LOGI(TAG, "OTA complete! Rebooting...");
+    send_ota_response(MSG_OTA_DONE, 0);
+
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
+}
+
+static void ota_writer_task(void *arg) {
+    ota_item_t item;
+
+    while (1) {
+        if (xQueueReceive(s_ota_items, &item, portMAX_DELAY) != pdTRUE) continue;
+
+        switch (item.op) {
+            case OTA_OP_BEGIN:
+                ota_do_begin();
+                break;
+            case OTA_OP_DATA: {
+                const ota_chunk_t *chunk = &s_ota_pool[item.buf];
+                uint32_t chunk_num = chunk->chunk_num;
+                ota_do_write(chunk);
+                // Buffer back first so the ACK counts it as a credit
+                xQueueSend(s_ota_free, &item.buf, 0);
+                if (s_ota_in_progress) {
+                    send_ota_response(MSG_OTA_ACK, chunk_num);
+                }
+                break;
+            }
+            case OTA_OP_END:
+                ota_do_end();
+                break;
+        }
+    }
+}
+
+static bool ota_writer_start(void) {
+    if (s_ota_items != NULL) return true;
+
+    s_ota_free = xQueueCreate(ESPNOW_OTA_POOL_SIZE, sizeof(uint8_t));
+    s_ota_items = xQueueCreate(ESPNOW_OTA_POOL_SIZE + 2, sizeof(ota_item_t));
+    if (s_ota_free == NULL || s_ota_items == NULL) {
+        ESP_LOGE(TAG, "OTA writer queues failed");
+        return false;
+    }
+    for (uint8_t i = 0; i < ESPNOW_OTA_POOL_SIZE; i++) {
+        xQueueSend(s_ota_free, &i, 0);
+    }
+
+    if (xTaskCreate(ota_writer_task, "ota_writer", ESPNOW_OTA_WRITER_STACK, NULL,
+                    ESPNOW_OTA_WRITER_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "OTA writer task failed");
+        return false;
+    }
+    return true;
+}
+
+// Drop work still queued from an earlier transfer (WiFi task)
+static void ota_flush_items(void) {
+    ota_item_t item;
+    while (xQueueReceive(s_ota_items, &item, 0) == pdTRUE) {
+        if (item.op == OTA_OP_DATA) {
+            xQueueSend(s_ota_free, &item.buf, 0);
+        }
+    }
+}
+
+// ============== Message Handlers (WiFi task) ==============
+
+static void handle_ota_begin(const uint8_t *data, int len) {
+    if (len < 5) {
+        ESP_LOGE(TAG, "OTA BEGIN: invalid length %d", len);
+        send_ota_response(MSG_OTA_ERROR, 0);
+        return;
+    }
+    if (!ota_writer_start()) {
+        send_ota_response(MSG_OTA_ERROR, 0);
+        return;
+    }
+
+    s_ota_total_size = data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24);
+    ESP_LOGI(TAG, "OTA BEGIN: size=%lu bytes", (unsigned long)s_ota_total_size);
+
+    ota_flush_items();
+
+    // Chunks are numbered from 0; the writer clears its counters on BEGIN
+    s_ota_next_rx = 0;
+    s_ota_written_next = 0;
+    s_ota_dropped = 0;
+    s_ota_duplicates = 0;
+    s_ota_gaps = 0;
+    s_ota_in_progress = true;
+
+    // Erase happens in the writer, READY is sent once it is done
+    ota_item_t item = { .op = OTA_OP_BEGIN };
+    if (xQueueSend(s_ota_items, &item, 0) != pdTRUE) {
+        s_ota_in_progress = false;
+        send_ota_response(MSG_OTA_ERROR, 0);
+    }
+}
+
+static void handle_ota_data(const uint8_t *data, int len) {
+    if (!s_ota_in_progress) return;
+    if (len < 6 || len - 5 > OTA_CHUNK_MAX) return;
+
+    uint32_t chunk_num = data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24);
+
+    // Chunks must be consecutive from 0
+    if (chunk_num < s_ota_next_rx) {
+        // Resend: ACK again if already on flash (our ACK was lost), else it is still queued
+        s_ota_duplicates++;
+        if (chunk_num < s_ota_written_next) {
+            send_ota_response(MSG_OTA_ACK, chunk_num);
+        }
+        return;
+    }
+    if (chunk_num > s_ota_next_rx) {
+        s_ota_gaps++;
+        return;
+    }
+
+    uint8_t buf;
+    if (xQueueReceive(s_ota_free, &buf, 0) != pdTRUE) {
+        // Sender ignored its credits
+        s_ota_dropped++;
+        return;
+    }
+
+    ota_chunk_t *chunk = &s_ota_pool[buf];
+    chunk->chunk_num = chunk_num;
+    chunk->len = len - 5;
+    memcpy(chunk->data, data + 5, chunk->len);
+
+    ota_item_t item = { .op = OTA_OP_DATA, .buf = buf };
+    if (xQueueSend(s_ota_items, &item, 0) != pdTRUE) {
+        xQueueSend(s_ota_free, &buf, 0);
+        s_ota_dropped++;
+        return;
+    }
+    s_ota_next_rx = chunk_num + 1;
+}
+
+static void handle_ota_end(void) {
+    if (!s_ota_in_progress) return;
+
+    // Queued behind the remaining chunks
+    ota_item_t item = { .op = OTA_OP_END };
+    if (xQueueSend(s_ota_items, &item, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "OTA END: writer busy, gateway will resend");
+    }
+}
+
+// ============== Public API ==============
+
+void espnow_ota_init(const uint8_t *gateway_mac) {
+    memcpy(s_gateway_mac, gateway_mac, sizeof(s_gateway_mac));
+}
+
+bool espnow_ota_handle_message(const uint8_t *data, int len) {
+    if (len < 1) return false;
+
+    switch (data[0]) {
+        case MSG_OTA_BEGIN:
+            handle_ota_begin(data, len);
+            return true;
+        case MSG_OTA_DATA:
+            handle_ota_data(data, len);
+            return true;
+        case MSG_OTA_END:
+            handle_ota_end();
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool espnow_ota_in_progress(void) {
+    return s_ota_in_progress;
+}
@@ -0,0 +1,92 @@
+/**
+ * OmniaPi ESP-NOW Gateway Discovery
+ *
+ * Finds the gateway's channel and follows it when it moves, shared by the
+ * node and LED strip firmwares. Cold boot and gateway moves both end up
+ * here. Cheapest first:
+ *  1. the channel saved in NVS, probed once
+ *  2. a passive sweep in promiscuous mode: any frame the gateway transmits
+ *     (its heartbeats, traffic to other nodes, its own WiFi) gives the
+ *     channel away without us sending anything
+ *  3. active probing of every channel with MSG_DISCOVERY
+ *
+ * The firmware owns WiFi/ESP-NOW init and the receive callback, and
+ * reports what it hears through espnow_discovery_heartbeat() and
+ * espnow_discovery_gateway_seen().
+ */
+
+#ifndef ESPNOW_DISCOVERY_H
+#define ESPNOW_DISCOVERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Discovery messages (compatible with Gateway)
+#define MSG_DISCOVERY       0x30
+#define MSG_DISCOVERY_ACK   0x31    // [MSG_DISCOVERY_ACK][channel]
+
+// Timing
+#define ESPNOW_PROBE_SETTLE_MS          20      // After a channel change, before probing
+#define ESPNOW_PROBE_WAIT_MS            300     // For MSG_DISCOVERY_ACK
+#define ESPNOW_LISTEN_DWELL_MS          120     // Passive listen per channel
+#define ESPNOW_LISTEN_SWEEPS            2
+#define ESPNOW_GATEWAY_LOST_MS          10000   // ~3 missed heartbeats
+#define ESPNOW_REDISCOVER_BACKOFF_MS    30000   // After a failed rediscovery
+
+/**
+ * Initialize (call after esp_now_init; probes need a broadcast peer)
+ * @param gateway_mac Gateway STA MAC (its softAP MAC is this + 1)
+ */
+void espnow_discovery_init(const uint8_t *gateway_mac);
+
+/**
+ * Run discovery phases from `saved` (0 = skip the saved channel). Tunes to
+ * the channel found, points the gateway peer at it and saves it if it
+ * changed.
+ * @return Channel, or 0 if the gateway wasn't found
+ */
+uint8_t espnow_discovery_find(uint8_t saved);
+
+/**
+ * Use a known channel for the gateway (no discovery)
+ */
+void espnow_discovery_set_channel(uint8_t channel);
+
+/**
+ * Start the task that rediscovers when heartbeats stop (once)
+ */
+void espnow_discovery_start_watch(void);
+
+/**
+ * A heartbeat from the gateway arrived
+ */
+void espnow_discovery_heartbeat(void);
+
+/**
+ * MSG_DISCOVERY_ACK arrived
+ * @param channel Channel the gateway reports
+ */
+void espnow_discovery_gateway_seen(uint8_t channel);
+
+/**
+ * Check if Gateway has been discovered
+ */
+bool espnow_discovery_gateway_known(void);
+
+/**
+ * Get last heartbeat timestamp (ms)
+ */
+uint32_t espnow_discovery_last_heartbeat(void);
+
+/**
+ * Save channel to NVS
+ */
+void espnow_discovery_save_channel(uint8_t channel);
+
+/**
+ * Load channel from NVS
+ * @return Saved channel, or 0 if not saved
+ */
+uint8_t espnow_discovery_load_channel(void);
+
+#endif // ESPNOW_DISCOVERY_H
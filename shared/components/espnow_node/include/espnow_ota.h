@@ -0,0 +1,58 @@
+/**
+ * OmniaPi ESP-NOW Node OTA Receiver
+ *
+ * Firmware updates from the gateway over plain ESP-NOW, shared by the node
+ * and LED strip firmwares.
+ *
+ * esp_now's receive callback runs in the WiFi task, so flash work there
+ * stalls the radio. Chunks are copied into a small buffer pool and a
+ * writer task does begin/write/end. Every READY/ACK carries the number of
+ * free buffers (credits) so the gateway can keep that many chunks in
+ * flight without overrunning the pool. Chunks must arrive in order: a
+ * repeated chunk is re-ACKed, anything past a gap is dropped for the
+ * gateway to resend.
+ *
+ *   BEGIN: [MSG_OTA_BEGIN][size x4]
+ *   DATA:  [MSG_OTA_DATA][chunk_num x4][data...]   (chunks numbered from 0)
+ *   END:   [MSG_OTA_END]
+ *   READY/ACK: [type][chunk_num x4][credits]
+ *   DONE/ERROR: [type][chunk_num x4]
+ */
+
+#ifndef ESPNOW_OTA_H
+#define ESPNOW_OTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// OTA message types (compatible with Gateway)
+#define MSG_OTA_BEGIN       0x10
+#define MSG_OTA_READY       0x11
+#define MSG_OTA_DATA        0x12
+#define MSG_OTA_ACK         0x13
+#define MSG_OTA_END         0x14
+#define MSG_OTA_DONE        0x15
+#define MSG_OTA_ERROR       0x1F
+
+#define ESPNOW_OTA_POOL_SIZE        8   // Chunk buffers, also the credits offered to the gateway
+#define ESPNOW_OTA_WRITER_STACK     4096
+#define ESPNOW_OTA_WRITER_PRIORITY  5
+
+/**
+ * Initialize (the writer task starts with the first transfer)
+ * @param gateway_mac Where responses go
+ */
+void espnow_ota_init(const uint8_t *gateway_mac);
+
+/**
+ * Feed a received message (call from the esp_now receive path)
+ * @return true if it was an OTA message and has been handled
+ */
+bool espnow_ota_handle_message(const uint8_t *data, int len);
+
+/**
+ * Whether a transfer is running
+ */
+bool espnow_ota_in_progress(void);
+
+#endif // ESPNOW_OTA_H
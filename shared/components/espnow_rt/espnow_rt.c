@@ -0,0 +1,417 @@
+#include "espnow_rt.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+
+static const char *TAG = "ESPNOW_RT";
+
+typedef struct {
+    bool     used;
+    bool     waiting_mac;           // Handed to esp_now_send, no send callback yet
+    uint16_t seq;
+    uint8_t  retries;
+    uint8_t  len;                   // Whole frame
+    int64_t  first_sent_us;
+    int64_t  deadline_us;           // Retransmit if not acknowledged by then
+    uint8_t  frame[ESP_NOW_MAX_DATA_LEN];
+} rt_slot_t;
+
+// A frame handed to esp_now_send, waiting for its send callback
+typedef struct {
+    bool     reliable;              // Data frame from a slot (else plain or ACK)
+    uint16_t seq;
+    int64_t  sent_us;
+} rt_tx_t;
+
+typedef struct {
+    bool      used;
+    uint8_t   mac[6];
+    int64_t   last_used_us;
+    bool      supported;            // Peer has sent reliable frames
+    // Transmit
+    uint16_t  next_seq;
+    rt_slot_t slots[ESPNOW_RT_WINDOW];
+    // Every unicast frame to the peer in send order, matched to send callbacks
+    rt_tx_t   tx_fifo[ESPNOW_RT_TX_FIFO];
+    uint8_t   tx_head;
+    uint8_t   tx_count;
+    // Receive: highest sequence seen and a bitmap of the 32 before it
+    bool      rx_valid;
+    uint8_t   rx_epoch;
+    uint16_t  rx_top;
+    uint32_t  rx_mask;
+} rt_peer_t;
+
+static rt_peer_t s_peers[ESPNOW_RT_MAX_PEERS];
+static SemaphoreHandle_t s_lock = NULL;
+static esp_timer_handle_t s_timer = NULL;
+static espnow_rt_deliver_cb_t s_deliver = NULL;
+static uint8_t s_epoch = 0;
+
+static espnow_rt_stats_t s_stats = {0};
+static uint16_t s_latency[ESPNOW_RT_LATENCY_BUCKETS];
+
+// ============== Helpers ==============
+
+static uint32_t rto_ms(uint8_t retries) {
+    uint32_t rto = ESPNOW_RT_RTO_MS << (retries < 8 ? retries : 8);
+    return rto < ESPNOW_RT_RTO_MAX_MS ? rto : ESPNOW_RT_RTO_MAX_MS;
+}
+
+static rt_peer_t *find_peer(const uint8_t *mac, bool create) {
+    rt_peer_t *free_slot = NULL;
+    rt_peer_t *oldest = NULL;
+
+    for (int i = 0; i < ESPNOW_RT_MAX_PEERS; i++) {
+        rt_peer_t *p = &s_peers[i];
+        if (p->used && memcmp(p->mac, mac, 6) == 0) return p;
+        if (!p->used) {
+            if (free_slot == NULL) free_slot = p;
+        } else if (oldest == NULL || p->last_used_us < oldest->last_used_us) {
+            oldest = p;
+        }
+    }
+    if (!create) return NULL;
+
+    // Evict the least recently used peer (its in-flight frames are lost)
+    rt_peer_t *p = free_slot ? free_slot : oldest;
+    memset(p, 0, sizeof(*p));
+    p->used = true;
+    memcpy(p->mac, mac, 6);
+    p->next_seq = (uint16_t)esp_random();
+    return p;
+}
+
+static bool has_in_flight(void) {
+    for (int i = 0; i < ESPNOW_RT_MAX_PEERS; i++) {
+        if (!s_peers[i].used) continue;
+        for (int j = 0; j < ESPNOW_RT_WINDOW; j++) {
+            if (s_peers[i].slots[j].used) return true;
+        }
+    }
+    return false;
+}
+
+static void record_latency(int64_t us) {
+    uint32_t bucket = (uint32_t)(us / 1000) / ESPNOW_RT_LATENCY_STEP_MS;
+    if (bucket >= ESPNOW_RT_LATENCY_BUCKETS) bucket = ESPNOW_RT_LATENCY_BUCKETS - 1;
+    if (s_latency[bucket] < UINT16_MAX) s_latency[bucket]++;
+}
+
+static uint32_t latency_percentile(uint32_t pct) {
+    uint32_t total = 0;
+    for (int i = 0; i < ESPNOW_RT_LATENCY_BUCKETS; i++) total += s_latency[i];
+    if (total == 0) return 0;
+
+    uint32_t target = (total * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < ESPNOW_RT_LATENCY_BUCKETS; i++) {
+        seen += s_latency[i];
+        if (seen >= target) return (i + 1) * ESPNOW_RT_LATENCY_STEP_MS;
+    }
+    return ESPNOW_RT_LATENCY_BUCKETS * ESPNOW_RT_LATENCY_STEP_MS;
+}
+
+/**
+ * Duplicate check, marks the sequence as seen
+ * @return true if the frame is new
+ */
+static bool rx_accept(rt_peer_t *p, uint8_t epoch, uint16_t seq) {
+    if (!p->rx_valid || p->rx_epoch != epoch) {
+        // First frame from this peer, or it restarted
+        p->rx_valid = true;
+        p->rx_epoch = epoch;
+        p->rx_top = seq;
+        p->rx_mask = 1;
+        return true;
+    }
+
+    int16_t diff = (int16_t)(seq - p->rx_top);
+    if (diff > 0) {
+        p->rx_mask = diff >= 32 ? 0 : p->rx_mask << diff;
+        p->rx_mask |= 1;
+        p->rx_top = seq;
+        return true;
+    }
+    if (-diff >= 32) return false;  // Older than the bitmap, treat as seen
+
+    uint32_t bit = 1u << -diff;
+    if (p->rx_mask & bit) return false;
+    p->rx_mask |= bit;
+    return true;
+}
+
+// Push before esp_now_send: the callback can fire before it returns
+static void tx_push(rt_peer_t *p, bool reliable, uint16_t seq) {
+    if (p->tx_count == ESPNOW_RT_TX_FIFO) {
+        // A callback went missing, forget the oldest frame
+        p->tx_head = (p->tx_head + 1) % ESPNOW_RT_TX_FIFO;
+        p->tx_count--;
+    }
+    rt_tx_t *tx = &p->tx_fifo[(p->tx_head + p->tx_count) % ESPNOW_RT_TX_FIFO];
+    tx->reliable = reliable;
+    tx->seq = seq;
+    tx->sent_us = esp_timer_get_time();
+    p->tx_count++;
+}
+
+// Undo the last push (esp_now_send refused the frame)
+static void tx_unpush(rt_peer_t *p) {
+    if (p->tx_count > 0) p->tx_count--;
+}
+
+/**
+ * Take the frame a send callback belongs to (callbacks come in send order)
+ * @return false if nothing is waiting
+ */
+static bool tx_pop(rt_peer_t *p, rt_tx_t *out) {
+    int64_t now = esp_timer_get_time();
+    while (p->tx_count > 0) {
+        *out = p->tx_fifo[p->tx_head];
+        p->tx_head = (p->tx_head + 1) % ESPNOW_RT_TX_FIFO;
+        p->tx_count--;
+        // Skip frames whose callback never came
+        if (now - out->sent_us <= ESPNOW_RT_RTO_MAX_MS * 1000) return true;
+    }
+    return false;
+}
+
+static void transmit(rt_peer_t *p, rt_slot_t *slot) {
+    slot->waiting_mac = true;
+    tx_push(p, true, slot->seq);
+    if (esp_now_send(p->mac, slot->frame, slot->len) != ESP_OK) {
+        // Not even queued, treat like a MAC failure
+        tx_unpush(p);
+        slot->waiting_mac = false;
+    }
+}
+
+static void start_timer(void) {
+    if (s_timer != NULL && !esp_timer_is_active(s_timer)) {
+        esp_timer_start_periodic(s_timer, ESPNOW_RT_TICK_MS * 1000);
+    }
+}
+
+// ============== Retransmission ==============
+
+static void rt_tick(void *arg) {
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < ESPNOW_RT_MAX_PEERS; i++) {
+        rt_peer_t *p = &s_peers[i];
+        if (!p->used) continue;
+
+        for (int j = 0; j < ESPNOW_RT_WINDOW; j++) {
+            rt_slot_t *slot = &p->slots[j];
+            if (!slot->used || now < slot->deadline_us) continue;
+            // Normally wait for the send callback, but don't hang on a lost one
+            if (slot->waiting_mac && now < slot->deadline_us + ESPNOW_RT_RTO_MAX_MS * 1000) continue;
+
+            if (slot->retries >= ESPNOW_RT_MAX_RETRIES) {
+                ESP_LOGW(TAG, "seq %u to " MACSTR " undelivered", slot->seq, MAC2STR(p->mac));
+                slot->used = false;
+                s_stats.failed++;
+                continue;
+            }
+            slot->retries++;
+            slot->deadline_us = now + rto_ms(slot->retries) * 1000;
+            s_stats.retransmits++;
+            transmit(p, slot);
+        }
+    }
+
+    if (!has_in_flight()) {
+        esp_timer_stop(s_timer);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// ============== Public API ==============
+
+esp_err_t espnow_rt_init(espnow_rt_deliver_cb_t deliver) {
+    s_deliver = deliver;
+    if (s_lock != NULL) return ESP_OK;
+
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) return ESP_ERR_NO_MEM;
+
+    const esp_timer_create_args_t args = {
+        .callback = rt_tick,
+        .name = "espnow_rt",
+    };
+    esp_err_t ret = esp_timer_create(&args, &s_timer);
+    if (ret != ESP_OK) return ret;
+
+    // Never 0, so a zeroed peer record can't match
+    do {
+        s_epoch = (uint8_t)esp_random();
+    } while (s_epoch == 0);
+
+    ESP_LOGI(TAG, "Reliable transport ready (epoch %u)", s_epoch);
+    return ESP_OK;
+}
+
+esp_err_t espnow_rt_send(const uint8_t *mac, const uint8_t *data, int len) {
+    if (mac == NULL || data == NULL || len <= 0 || len > ESPNOW_RT_MAX_PAYLOAD || (mac[0] & 0x01)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_lock == NULL) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    rt_peer_t *p = find_peer(mac, true);
+    p->last_used_us = esp_timer_get_time();
+
+    rt_slot_t *slot = NULL;
+    for (int j = 0; j < ESPNOW_RT_WINDOW; j++) {
+        if (!p->slots[j].used) {
+            slot = &p->slots[j];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        s_stats.window_full++;
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint16_t seq = p->next_seq++;
+    slot->used = true;
+    slot->seq = seq;
+    slot->retries = 0;
+    slot->len = len + ESPNOW_RT_HEADER_LEN;
+    slot->frame[0] = ESPNOW_RT_MSG_DATA;
+    slot->frame[1] = s_epoch;
+    slot->frame[2] = seq & 0xFF;
+    slot->frame[3] = seq >> 8;
+    memcpy(&slot->frame[ESPNOW_RT_HEADER_LEN], data, len);
+    slot->first_sent_us = p->last_used_us;
+    slot->deadline_us = p->last_used_us + rto_ms(0) * 1000;
+
+    s_stats.sent++;
+    transmit(p, slot);
+    start_timer();
+
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t espnow_rt_send_plain(const uint8_t *mac, const uint8_t *data, int len) {
+    if (mac == NULL || data == NULL || len <= 0) return ESP_ERR_INVALID_ARG;
+    // Broadcasts have no peer record to confuse
+    if (s_lock == NULL || (mac[0] & 0x01)) return esp_now_send(mac, data, len);
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return ESP_ERR_TIMEOUT;
+
+    rt_peer_t *p = find_peer(mac, true);
+    p->last_used_us = esp_timer_get_time();
+    tx_push(p, false, 0);
+    esp_err_t ret = esp_now_send(mac, data, len);
+    if (ret != ESP_OK) {
+        tx_unpush(p);
+    }
+
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+bool espnow_rt_handle_recv(const uint8_t *mac, const uint8_t *data, int len) {
+    if (len < ESPNOW_RT_HEADER_LEN) return false;
+    if (data[0] != ESPNOW_RT_MSG_DATA && data[0] != ESPNOW_RT_MSG_ACK) return false;
+    if (s_lock == NULL) return true;
+
+    uint8_t epoch = data[1];
+    uint16_t seq = data[2] | (data[3] << 8);
+
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return true;
+
+    if (data[0] == ESPNOW_RT_MSG_ACK) {
+        rt_peer_t *p = find_peer(mac, false);
+        if (p != NULL && epoch == s_epoch) {
+            for (int j = 0; j < ESPNOW_RT_WINDOW; j++) {
+                rt_slot_t *slot = &p->slots[j];
+                if (slot->used && slot->seq == seq) {
+                    record_latency(esp_timer_get_time() - slot->first_sent_us);
+                    slot->used = false;
+                    s_stats.acked++;
+                    break;
+                }
+            }
+        }
+        xSemaphoreGive(s_lock);
+        return true;
+    }
+
+    rt_peer_t *p = find_peer(mac, true);
+    p->last_used_us = esp_timer_get_time();
+    p->supported = true;
+    bool fresh = rx_accept(p, epoch, seq);
+    if (fresh) {
+        s_stats.received++;
+    } else {
+        s_stats.duplicates++;
+    }
+
+    // Always acknowledge: a duplicate means our previous ACK was lost
+    uint8_t ack[ESPNOW_RT_HEADER_LEN] = { ESPNOW_RT_MSG_ACK, epoch, data[2], data[3] };
+    tx_push(p, false, 0);
+    if (esp_now_send(mac, ack, sizeof(ack)) != ESP_OK) {
+        tx_unpush(p);
+    }
+    xSemaphoreGive(s_lock);
+
+    if (fresh && s_deliver != NULL && len > ESPNOW_RT_HEADER_LEN) {
+        s_deliver(mac, data + ESPNOW_RT_HEADER_LEN, len - ESPNOW_RT_HEADER_LEN);
+    }
+    return true;
+}
+
+void espnow_rt_handle_send_done(const uint8_t *mac, bool success) {
+    if (mac == NULL || s_lock == NULL) return;
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    rt_peer_t *p = find_peer(mac, false);
+    rt_tx_t tx;
+    if (p != NULL && tx_pop(p, &tx) && tx.reliable) {
+        for (int j = 0; j < ESPNOW_RT_WINDOW; j++) {
+            rt_slot_t *slot = &p->slots[j];
+            // Not waiting: acknowledged already, or a retransmit's earlier callback
+            if (!slot->used || !slot->waiting_mac || slot->seq != tx.seq) continue;
+
+            slot->waiting_mac = false;
+            if (!success) {
+                // Peer never got it: retry after the backoff, not the full wait for an ACK
+                slot->deadline_us = esp_timer_get_time() +
+                                    (rto_ms(slot->retries) * 1000) / 2;
+            }
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+bool espnow_rt_peer_supported(const uint8_t *mac) {
+    if (mac == NULL || s_lock == NULL) return false;
+    if (xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    rt_peer_t *p = find_peer(mac, false);
+    bool supported = p != NULL && p->supported;
+    xSemaphoreGive(s_lock);
+    return supported;
+}
+
+void espnow_rt_get_stats(espnow_rt_stats_t *stats) {
+    if (stats == NULL) return;
+    if (s_lock == NULL || xSemaphoreTake(s_lock, pdMS_TO_TICKS(100)) != pdTRUE) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = s_stats;
+    stats->latency_p50_ms = latency_percentile(50);
+    stats->latency_p90_ms = latency_percentile(90);
+    stats->latency_p99_ms = latency_percentile(99);
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,111 @@
+/**
+ * OmniaPi ESP-NOW Reliable Transport
+ *
+ * Reliable delivery for ESP-NOW unicast, shared by the node and LED strip
+ * firmwares: per-peer sequence numbers, duplicate suppression,
+ * retransmission with exponential backoff and a small in-flight window.
+ *
+ * Reliable frames carry their own message type, so plain messages keep
+ * working with peers that don't speak it:
+ *   Data: [ESPNOW_RT_MSG_DATA][epoch][seq lo][seq hi][message...]
+ *   Ack:  [ESPNOW_RT_MSG_ACK][epoch][seq lo][seq hi]
+ * The epoch is random per boot, so a restarted sender isn't mistaken for
+ * a stream of duplicates.
+ *
+ * Send callbacks carry only the destination, so they are matched to frames
+ * by send order. Every unicast frame to a peer must therefore go through
+ * this module: espnow_rt_send_plain() for the unacknowledged ones.
+ */
+
+#ifndef ESPNOW_RT_H
+#define ESPNOW_RT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_now.h"
+
+// Message types (outside the ranges used by the firmwares)
+#define ESPNOW_RT_MSG_DATA      0x60
+#define ESPNOW_RT_MSG_ACK       0x61
+
+#define ESPNOW_RT_HEADER_LEN    4
+#define ESPNOW_RT_MAX_PAYLOAD   (ESP_NOW_MAX_DATA_LEN - ESPNOW_RT_HEADER_LEN)
+
+#define ESPNOW_RT_MAX_PEERS     4
+#define ESPNOW_RT_WINDOW        4       // Unacknowledged frames per peer
+#define ESPNOW_RT_MAX_RETRIES   6
+#define ESPNOW_RT_RTO_MS        30      // First retransmit timeout, doubles per retry
+#define ESPNOW_RT_RTO_MAX_MS    1000
+#define ESPNOW_RT_TICK_MS       10
+#define ESPNOW_RT_TX_FIFO       16      // Frames per peer awaiting their send callback
+#define ESPNOW_RT_LATENCY_STEP_MS 5     // Latency histogram resolution
+#define ESPNOW_RT_LATENCY_BUCKETS 100   // Last bucket collects everything slower
+
+/**
+ * Called once per reliable message, with the inner message
+ */
+typedef void (*espnow_rt_deliver_cb_t)(const uint8_t *mac, const uint8_t *data, int len);
+
+typedef struct {
+    uint32_t sent;              // Messages accepted by espnow_rt_send
+    uint32_t retransmits;
+    uint32_t acked;
+    uint32_t failed;            // Gave up after ESPNOW_RT_MAX_RETRIES
+    uint32_t window_full;       // Refused, peer window full
+    uint32_t received;          // Delivered to the application
+    uint32_t duplicates;        // Suppressed (and acknowledged again)
+    uint32_t latency_p50_ms;    // Send to acknowledgement
+    uint32_t latency_p90_ms;
+    uint32_t latency_p99_ms;
+} espnow_rt_stats_t;
+
+/**
+ * Initialize (call after esp_now_init)
+ * @param deliver Receives the inner message of each new reliable frame
+ * @return ESP_OK on success
+ */
+esp_err_t espnow_rt_init(espnow_rt_deliver_cb_t deliver);
+
+/**
+ * Send a message reliably
+ * @param mac  Unicast peer (already added with esp_now_add_peer)
+ * @param data Message
+ * @param len  Length (max ESPNOW_RT_MAX_PAYLOAD)
+ * @return ESP_OK if queued, ESP_ERR_NO_MEM if the peer window is full
+ */
+esp_err_t espnow_rt_send(const uint8_t *mac, const uint8_t *data, int len);
+
+/**
+ * Send a message once, without acknowledgement. Use instead of
+ * esp_now_send for unicast so its send callback isn't credited to a
+ * reliable frame.
+ * @return esp_now_send result
+ */
+esp_err_t espnow_rt_send_plain(const uint8_t *mac, const uint8_t *data, int len);
+
+/**
+ * Feed a received frame (call first thing in the esp_now receive callback)
+ * @return true if it was a reliable-transport frame and has been handled
+ */
+bool espnow_rt_handle_recv(const uint8_t *mac, const uint8_t *data, int len);
+
+/**
+ * Feed the MAC-layer send result (call from the esp_now send callback)
+ * @param mac     Destination
+ * @param success ESP_NOW_SEND_SUCCESS
+ */
+void espnow_rt_handle_send_done(const uint8_t *mac, bool success);
+
+/**
+ * Whether a peer has sent us reliable frames (so it will acknowledge ours)
+ */
+bool espnow_rt_peer_supported(const uint8_t *mac);
+
+/**
+ * Get statistics
+ * @param stats Output
+ */
+void espnow_rt_get_stats(espnow_rt_stats_t *stats);
+
+#endif // ESPNOW_RT_H
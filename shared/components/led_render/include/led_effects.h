@@ -0,0 +1,94 @@
+/**
+ * OmniaPi LED Effects Library
+ *
+ * Effects render one frame at a time into an RGB buffer (3 bytes per LED,
+ * full scale). Brightness and the output hardware are handled by the
+ * caller; see led_render.h for the frame scheduler that drives them.
+ */
+
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "led_palette.h"
+#include "led_script.h"
+
+// ============================================
+// EFFECT TYPES
+// ============================================
+
+typedef enum {
+    EFFECT_TYPE_STATIC = 0,
+    EFFECT_TYPE_RAINBOW,
+    EFFECT_TYPE_BREATHING,
+    EFFECT_TYPE_CHASE,
+    EFFECT_TYPE_SPARKLE,
+    EFFECT_TYPE_FIRE,
+    EFFECT_TYPE_CUSTOM,     // Palette cycle (custom 3 colors or a palette)
+    EFFECT_TYPE_FLASH,      // Whole strip on/off
+    EFFECT_TYPE_GRADIENT,   // Palette stretched over the strip, static
+    EFFECT_TYPE_SCRIPT,     // User program (see led_script.h)
+    EFFECT_TYPE_MAX
+} effect_type_t;
+
+// ============================================
+// EFFECT CONTEXT
+// ============================================
+
+typedef struct {
+    effect_type_t type;
+    uint8_t speed;          // 0-255
+    uint8_t r, g, b;        // Base color
+
+    // Internal state for animations
+    uint32_t step;          // Animation step counter
+    uint32_t last_update;   // Last step timestamp (ms)
+
+    // Palette for the palette effects (custom, gradient), NULL = none
+    const led_palette_lut_t *palette;
+
+    // Program for the script effect, NULL = none
+    led_script_t *script;
+} effect_ctx_t;
+
+// ============================================
+// FUNCTION PROTOTYPES
+// ============================================
+
+/**
+ * Fill a context with the defaults (static white, speed 128, no palette
+ * or script)
+ */
+void effects_ctx_init(effect_ctx_t *ctx);
+
+/**
+ * Whether an effect changes over time
+ */
+bool effects_is_animated(effect_type_t type);
+
+/**
+ * Time between animation steps for the context's speed
+ * (255 = fast = 10 ms, 0 = slow = 200 ms)
+ */
+uint32_t effects_interval_ms(const effect_ctx_t *ctx);
+
+/**
+ * Render one frame and advance the animation
+ * @param ctx       Effect context
+ * @param rgb       Output, num_leds * 3 bytes
+ * @param num_leds  Number of LEDs
+ */
+void effects_render(effect_ctx_t *ctx, uint8_t *rgb, uint16_t num_leds);
+
+/**
+ * Reset animation state (step counter, fire heat, script variables)
+ */
+void effects_reset(effect_ctx_t *ctx);
+
+/**
+ * Convert HSV to RGB (hue 0-255)
+ */
+void effects_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+#endif // LED_EFFECTS_H
@@ -0,0 +1,77 @@
+/**
+ * OmniaPi LED Palettes
+ *
+ * A palette travels and is stored in a compact encoding:
+ *
+ *   [header][entries...]
+ *   header bits 0-4: entry count (1-16), bit 7: LED_PALETTE_GRADIENT
+ *   palette:  count x [r g b], spread evenly over the cycle and wrapping
+ *             back to the first entry
+ *   gradient: count x [pos r g b], positions ascending (0-255), held
+ *             flat before the first and after the last stop
+ *
+ * Effects never interpolate per pixel: the palette is expanded once into
+ * a 256-entry lookup table whenever it changes.
+ */
+
+#ifndef LED_PALETTE_H
+#define LED_PALETTE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define LED_PALETTE_MAX_ENTRIES     16
+#define LED_PALETTE_GRADIENT        0x80    // Header flag: entries carry a position
+#define LED_PALETTE_COUNT_MASK      0x1F
+#define LED_PALETTE_MAX_ENCODED     (1 + LED_PALETTE_MAX_ENTRIES * 4)
+#define LED_PALETTE_BANK_SIZE       8       // NVS slots, ids 0-7
+#define LED_PALETTE_NONE            0xFF    // No bank palette selected
+
+typedef struct {
+    uint8_t r, g, b;
+} led_rgb_t;
+
+typedef struct {
+    led_rgb_t color[256];
+} led_palette_lut_t;
+
+/**
+ * Check an encoded palette
+ * @return ESP_OK if well formed, ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t led_palette_validate(const uint8_t *encoded, size_t len);
+
+/**
+ * Expand an encoded palette into a lookup table
+ * @return ESP_OK on success (lut untouched on error)
+ */
+esp_err_t led_palette_build_lut(const uint8_t *encoded, size_t len, led_palette_lut_t *lut);
+
+/**
+ * Store an encoded palette in the NVS bank
+ * @param id  Slot (0 to LED_PALETTE_BANK_SIZE-1)
+ * @return ESP_OK on success
+ */
+esp_err_t led_palette_bank_store(uint8_t id, const uint8_t *encoded, size_t len);
+
+/**
+ * Load an encoded palette from the NVS bank
+ * @param encoded  At least LED_PALETTE_MAX_ENCODED bytes
+ * @param len      Encoded length
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t led_palette_bank_load(uint8_t id, uint8_t *encoded, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_PALETTE_H
@@ -0,0 +1,148 @@
+/**
+ * OmniaPi LED Render - Frame Scheduler
+ *
+ * Shared by the LED strip and node mesh firmwares. One task owns the frame
+ * buffer and runs on a fixed frame clock while an animated effect is
+ * active. A frame is only pushed to the strip when its pixels differ from
+ * the last one sent, and with a static color (or power off) the task
+ * blocks until a setter changes something, so it costs no CPU at all.
+ *
+ * The hardware stays with the firmware: each changed frame is handed to
+ * the flush callback, which writes it to the strip.
+ *
+ * Palette effects sample a 256-entry lookup table that is rebuilt only
+ * when the palette changes (see led_palette.h), so they cost one table
+ * load per pixel, the same as a solid color.
+ *
+ * While animating, the task logs its load per effect (frames rendered,
+ * pushed and skipped, render and flush time, and for scripts the most
+ * instructions used by a frame) every LED_RENDER_STATS_PERIOD_MS and
+ * whenever the effect changes.
+ */
+
+#ifndef LED_RENDER_H
+#define LED_RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "led_effects.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define LED_RENDER_FRAME_MS         20      // Default frame clock (50 Hz)
+#define LED_RENDER_STATS_PERIOD_MS  30000   // Load report while animating
+#define LED_RENDER_TASK_STACK       3072
+#define LED_RENDER_TASK_PRIORITY    5
+
+/**
+ * Push a frame to the strip (called from the render task)
+ * @param rgb    num_leds * 3 bytes, brightness already applied
+ * @param count  Number of LEDs
+ */
+typedef void (*led_render_flush_t)(const uint8_t *rgb, uint16_t count);
+
+typedef struct {
+    uint16_t max_leds;          // Frame buffer size
+    uint16_t num_leds;          // LEDs in use (<= max_leds)
+    uint16_t frame_ms;          // Frame clock (0 = LED_RENDER_FRAME_MS)
+    led_render_flush_t flush;
+} led_render_config_t;
+
+/**
+ * Allocate the frame buffers and start the render task
+ * @return ESP_OK on success
+ */
+esp_err_t led_render_init(const led_render_config_t *config);
+
+/**
+ * Power on/off (off pushes a black frame, then the task idles)
+ */
+void led_render_set_power(bool on);
+
+/**
+ * Set effect (restarts the animation)
+ */
+void led_render_set_effect(effect_type_t type);
+
+/**
+ * Set effect speed (0-255)
+ */
+void led_render_set_speed(uint8_t speed);
+
+/**
+ * Set base color for effects
+ */
+void led_render_set_color(uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * Set master brightness (applied to every frame)
+ */
+void led_render_set_brightness(uint8_t brightness);
+
+/**
+ * Set custom effect colors (3 RGB colors, replaces the palette)
+ */
+void led_render_set_custom_colors(uint8_t r1, uint8_t g1, uint8_t b1,
+                                  uint8_t r2, uint8_t g2, uint8_t b2,
+                                  uint8_t r3, uint8_t g3, uint8_t b3);
+
+/**
+ * Set the palette used by the palette effects (custom, gradient)
+ * @param encoded  Compact encoding (see led_palette.h)
+ * @return ESP_OK on success, error if the encoding is malformed
+ */
+esp_err_t led_render_set_palette(const uint8_t *encoded, size_t len);
+
+/**
+ * Set the palette from the NVS bank
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t led_render_select_palette(uint8_t id);
+
+/**
+ * Check a program before storing it: valid, and its worst case fits the
+ * frame budget on the current number of LEDs
+ * @return ESP_OK if led_render_set_script() would accept it
+ */
+esp_err_t led_render_check_script(const uint8_t *encoded, size_t len);
+
+/**
+ * Set the program run by the script effect (restarts the animation)
+ * @param encoded  Program (see led_script.h)
+ * @return ESP_OK on success, error if the program is rejected (invalid, or
+ *         too many instructions per frame for the number of LEDs)
+ */
+esp_err_t led_render_set_script(const uint8_t *encoded, size_t len);
+
+/**
+ * Set the script from the NVS bank
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t led_render_select_script(uint8_t id);
+
+/**
+ * Change the number of LEDs in use (<= max_leds)
+ * The next frame is pushed in full.
+ */
+void led_render_set_num_leds(uint16_t num);
+
+/**
+ * Pause/resume flushing, e.g. while the firmware recreates the strip.
+ * led_render_pause() returns once any flush in progress has finished;
+ * call both from the same task. The frame after resuming is pushed in full.
+ */
+void led_render_pause(void);
+void led_render_resume(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_RENDER_H
@@ -0,0 +1,194 @@
+/**
+ * OmniaPi LED Scripts - Effect Bytecode VM
+ *
+ * User-defined effects run as small stack programs, uploaded over the
+ * control channel and kept in an NVS bank, so a new effect needs no
+ * firmware release.
+ *
+ * A program travels as:
+ *
+ *   [version][frame_len][pixel_len][frame code][pixel code]
+ *
+ * The frame section runs once per frame and the pixel section once per
+ * LED. Both can use eight variables that persist between runs, so
+ * per-frame work (e.g. a phase) is done once and read by every pixel.
+ * Without a pixel section the frame section's output fills the strip.
+ * A section's output is set with OUT_RGB / OUT_HSV / OUT_PAL (black if
+ * none).
+ *
+ * Values are 32-bit integers; colors and the wave/noise ops work in
+ * 0-255. Jumps only go forward and must land on an instruction (or the
+ * section end), so a section runs each of its validated instructions at
+ * most once and a frame's worst case is
+ * frame + pixel x LEDs instructions. Programs whose worst case exceeds
+ * LED_SCRIPT_FRAME_BUDGET are refused when set (led_script_check_budget).
+ * If the strip is lengthened afterwards, a frame that runs out of budget
+ * shows the base color on the LEDs it did not reach. A program that
+ * faults (stack error) is stopped and the strip shows the base color until
+ * a new one is loaded; the render task can never be held up by a bad
+ * program.
+ *
+ * tools/led_script/ledsc.py compiles a small expression language to this
+ * format.
+ */
+
+#ifndef LED_SCRIPT_H
+#define LED_SCRIPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "led_palette.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Configuration
+// ============================================================================
+#define LED_SCRIPT_VERSION          1
+#define LED_SCRIPT_HEADER_LEN       3
+#define LED_SCRIPT_MAX_CODE         160     // Fits one mesh or ESP-NOW command
+#define LED_SCRIPT_MAX_ENCODED      (LED_SCRIPT_HEADER_LEN + LED_SCRIPT_MAX_CODE)
+#define LED_SCRIPT_STACK_DEPTH      16
+#define LED_SCRIPT_VARS             8
+#define LED_SCRIPT_FRAME_BUDGET     16384   // Instructions per frame, all sections
+#define LED_SCRIPT_BANK_SIZE        4       // NVS slots, ids 0-3
+#define LED_SCRIPT_NONE             0xFF    // No bank script selected
+
+// ============================================================================
+// Instruction Set
+// ============================================================================
+// Stack effect in brackets: [inputs -- outputs], top of stack last
+
+// Control
+#define LED_OP_END          0x00    // End of section
+#define LED_OP_JMP          0x01    // +imm8: skip imm8 bytes forward
+#define LED_OP_JZ           0x02    // +imm8 [a --]: skip if a == 0
+
+// Constants and inputs
+#define LED_OP_PUSH8        0x08    // +imm8 [-- imm8]
+#define LED_OP_PUSH16       0x09    // +imm16 (LE, signed) [-- imm16]
+#define LED_OP_TIME         0x0A    // [-- t] animation step
+#define LED_OP_INDEX        0x0B    // [-- i] LED index (0 in the frame section)
+#define LED_OP_COUNT        0x0C    // [-- n] number of LEDs
+#define LED_OP_COLOR_R      0x0D    // [-- r] base color
+#define LED_OP_COLOR_G      0x0E    // [-- g]
+#define LED_OP_COLOR_B      0x0F    // [-- b]
+#define LED_OP_SPEED        0x10    // [-- speed]
+
+// Stack and variables
+#define LED_OP_DUP          0x18    // [a -- a a]
+#define LED_OP_DROP         0x19    // [a --]
+#define LED_OP_SWAP         0x1A    // [a b -- b a]
+#define LED_OP_OVER         0x1B    // [a b -- a b a]
+#define LED_OP_LOAD         0x1C    // +imm8 [-- var[imm8]]
+#define LED_OP_STORE        0x1D    // +imm8 [a --] var[imm8] = a
+
+// Arithmetic (wraps on overflow; division and modulo by zero give 0)
+#define LED_OP_ADD          0x20    // [a b -- a+b]
+#define LED_OP_SUB          0x21    // [a b -- a-b]
+#define LED_OP_MUL          0x22    // [a b -- a*b]
+#define LED_OP_DIV          0x23    // [a b -- a/b]
+#define LED_OP_MOD          0x24    // [a b -- a%b]
+#define LED_OP_AND          0x25    // [a b -- a&b]
+#define LED_OP_OR           0x26    // [a b -- a|b]
+#define LED_OP_XOR          0x27    // [a b -- a^b]
+#define LED_OP_SHL          0x28    // [a b -- a<<b]
+#define LED_OP_SHR          0x29    // [a b -- a>>b]
+#define LED_OP_MIN          0x2A    // [a b -- min]
+#define LED_OP_MAX          0x2B    // [a b -- max]
+#define LED_OP_LT           0x2C    // [a b -- a<b]
+#define LED_OP_NEG          0x2D    // [a -- -a]
+
+// 8-bit helpers
+#define LED_OP_CLAMP8       0x30    // [a -- a clamped to 0-255]
+#define LED_OP_SCALE8       0x31    // [a b -- a*b/255]
+#define LED_OP_SIN8         0x32    // [x -- sine wave 0-255, period 256]
+#define LED_OP_TRI8         0x33    // [x -- triangle wave 0-255, period 256]
+#define LED_OP_NOISE8       0x34    // [x -- smooth noise 0-255, x in 8.8 fixed point]
+#define LED_OP_RAND8        0x35    // [-- random 0-255]
+
+// Output
+#define LED_OP_OUT_RGB      0x38    // [r g b --]
+#define LED_OP_OUT_HSV      0x39    // [h s v --] hue 0-255
+#define LED_OP_OUT_PAL      0x3A    // [x --] palette lookup (0-255)
+
+/**
+ * Loaded program with its run state (variables, fault)
+ */
+typedef struct {
+    uint8_t code[LED_SCRIPT_MAX_CODE];
+    uint8_t frame_len;
+    uint8_t pixel_len;
+    int32_t vars[LED_SCRIPT_VARS];
+    uint8_t frame_instr;        // Instructions per section (worst case of one run)
+    uint8_t pixel_instr;
+    bool faulted;
+    uint32_t max_frame_instr;   // Most instructions used by one frame
+    uint32_t budget_stops;      // Frames cut short by the budget
+} led_script_t;
+
+/**
+ * Inputs the program can read besides its own state
+ */
+typedef struct {
+    uint32_t time;
+    uint8_t r, g, b;
+    uint8_t speed;
+    const led_palette_lut_t *palette;   // NULL = OUT_PAL gives black
+} led_script_env_t;
+
+/**
+ * Check an encoded program (header, opcodes, immediates, variable
+ * indexes, jump targets on instruction starts)
+ * @return ESP_OK if it can be loaded
+ */
+esp_err_t led_script_validate(const uint8_t *encoded, size_t len);
+
+/**
+ * Check that a valid program's worst case fits LED_SCRIPT_FRAME_BUDGET
+ * @param num_leds  LEDs the pixel section runs for
+ * @return ESP_OK if it fits, ESP_ERR_INVALID_SIZE if not
+ */
+esp_err_t led_script_check_budget(const uint8_t *encoded, size_t len, uint16_t num_leds);
+
+/**
+ * Validate and load a program, clearing its variables
+ * @return ESP_OK on success (script untouched on error)
+ */
+esp_err_t led_script_load(led_script_t *script, const uint8_t *encoded, size_t len);
+
+/**
+ * Run one frame into an RGB buffer (3 bytes per LED)
+ * A faulted program fills the buffer with the base color.
+ */
+void led_script_run(led_script_t *script, const led_script_env_t *env,
+                    uint8_t *rgb, uint16_t num_leds);
+
+/**
+ * Restart the program (clear variables and fault)
+ */
+void led_script_reset(led_script_t *script);
+
+/**
+ * Store an encoded program in the NVS bank
+ * @param id  Slot (0 to LED_SCRIPT_BANK_SIZE-1)
+ * @return ESP_OK on success
+ */
+esp_err_t led_script_bank_store(uint8_t id, const uint8_t *encoded, size_t len);
+
+/**
+ * Load an encoded program from the NVS bank
+ * @param encoded  At least LED_SCRIPT_MAX_ENCODED bytes
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the slot is empty
+ */
+esp_err_t led_script_bank_load(uint8_t id, uint8_t *encoded, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LED_SCRIPT_H
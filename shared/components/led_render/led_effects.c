@@ -0,0 +1,319 @@
+#include "led_effects.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "esp_random.h"
+
+// ============================================
+// HELPER FUNCTIONS
+// ============================================
+
+static inline void set_px(uint8_t *rgb, uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t *px = &rgb[index * 3];
+    px[0] = r;
+    px[1] = g;
+    px[2] = b;
+}
+
+// Convert HSV to RGB
+void effects_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b) {
+    if (s == 0) {
+        *r = *g = *b = v;
+        return;
+    }
+
+    uint8_t region = h / 43;
+    uint8_t remainder = (h - (region * 43)) * 6;
+
+    uint8_t p = (v * (255 - s)) >> 8;
+    uint8_t q = (v * (255 - ((s * remainder) >> 8))) >> 8;
+    uint8_t t = (v * (255 - ((s * (255 - remainder)) >> 8))) >> 8;
+
+    switch (region) {
+        case 0:  *r = v; *g = t; *b = p; break;
+        case 1:  *r = q; *g = v; *b = p; break;
+        case 2:  *r = p; *g = v; *b = t; break;
+        case 3:  *r = p; *g = q; *b = v; break;
+        case 4:  *r = t; *g = p; *b = v; break;
+        default: *r = v; *g = p; *b = q; break;
+    }
+}
+
+// ============================================
+// EFFECT IMPLEMENTATIONS
+// ============================================
+
+// Static color - no animation
+static void effect_static(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    for (int i = 0; i < n; i++) {
+        set_px(rgb, i, ctx->r, ctx->g, ctx->b);
+    }
+}
+
+// Rainbow cycle
+static void effect_rainbow(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    for (int i = 0; i < n; i++) {
+        uint16_t hue = (ctx->step + (i * 256 / n)) % 256;
+        uint8_t r, g, b;
+        effects_hsv_to_rgb(hue, 255, 255, &r, &g, &b);
+        set_px(rgb, i, r, g, b);
+    }
+    // Speed-based step increment: speed 0 = +1, speed 255 = +8
+    uint8_t step_inc = 1 + (ctx->speed * 7 / 255);
+    ctx->step = (ctx->step + step_inc) % 256;
+}
+
+// Breathing/pulse effect
+static void effect_breathing(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    // Sine wave breathing (0-255-0)
+    float phase = (float)ctx->step / 128.0f * 3.14159f;
+    uint8_t breath = (uint8_t)(sinf(phase) * 127 + 128);
+
+    uint8_t r = (ctx->r * breath) / 255;
+    uint8_t g = (ctx->g * breath) / 255;
+    uint8_t b = (ctx->b * breath) / 255;
+
+    for (int i = 0; i < n; i++) {
+        set_px(rgb, i, r, g, b);
+    }
+
+    ctx->step = (ctx->step + 1) % 256;
+}
+
+// Chase/running light
+static void effect_chase(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    // Clear all
+    memset(rgb, 0, n * 3);
+
+    // Light up 3 consecutive LEDs
+    int pos = ctx->step % n;
+    for (int j = 0; j < 3; j++) {
+        int idx = (pos + j) % n;
+        // Fade effect for tail
+        uint8_t fade = 255 - (j * 80);
+        uint8_t r = (ctx->r * fade) / 255;
+        uint8_t g = (ctx->g * fade) / 255;
+        uint8_t b = (ctx->b * fade) / 255;
+        set_px(rgb, idx, r, g, b);
+    }
+
+    ctx->step = (ctx->step + 1) % n;
+}
+
+// Random sparkle
+static void effect_sparkle(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    // Dim all LEDs slightly
+    for (int i = 0; i < n; i++) {
+        set_px(rgb, i, ctx->r / 10, ctx->g / 10, ctx->b / 10);
+    }
+
+    // Light up 2-3 random LEDs brightly
+    for (int j = 0; j < 3; j++) {
+        int idx = esp_random() % n;
+        set_px(rgb, idx, ctx->r, ctx->g, ctx->b);
+    }
+}
+
+// Fire simulation - heat buffer (allocated dynamically)
+static uint8_t *fire_heat = NULL;
+static uint16_t fire_heat_size = 0;
+
+static void effect_fire(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    // Reallocate heat buffer if needed
+    if (fire_heat == NULL || fire_heat_size != n) {
+        if (fire_heat != NULL) {
+            free(fire_heat);
+        }
+        fire_heat = (uint8_t*)calloc(n, sizeof(uint8_t));
+        fire_heat_size = n;
+    }
+
+    if (fire_heat == NULL) return;  // Allocation failed
+
+    // Cool down every cell a little
+    for (int i = 0; i < n; i++) {
+        uint8_t cooldown = (esp_random() % 30) + 5;
+        if (fire_heat[i] > cooldown) {
+            fire_heat[i] -= cooldown;
+        } else {
+            fire_heat[i] = 0;
+        }
+    }
+
+    // Heat from bottom rises up
+    for (int i = n - 1; i >= 2; i--) {
+        fire_heat[i] = (fire_heat[i - 1] + fire_heat[i - 2] + fire_heat[i - 2]) / 3;
+    }
+
+    // Randomly ignite new sparks near bottom
+    if ((esp_random() % 10) < 5) {
+        int y = esp_random() % (n < 3 ? n : 3);
+        int heat = fire_heat[y] + (esp_random() % 64) + 160;
+        fire_heat[y] = heat > 255 ? 255 : heat;
+    }
+
+    // Map heat to LED colors
+    for (int i = 0; i < n; i++) {
+        uint8_t h = fire_heat[i];
+        uint8_t r, g, b;
+
+        // Heat to color mapping (black -> red -> yellow -> white)
+        if (h < 85) {
+            r = h * 3;
+            g = 0;
+            b = 0;
+        } else if (h < 170) {
+            r = 255;
+            g = (h - 85) * 3;
+            b = 0;
+        } else {
+            r = 255;
+            g = 255;
+            b = (h - 170) * 3;
+        }
+
+        set_px(rgb, i, r, g, b);
+    }
+}
+
+// Palette cycle - the palette scrolls along the strip (one cycle per strip)
+static void effect_palette_cycle(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    if (ctx->palette == NULL) {
+        effect_static(ctx, rgb, n);
+        return;
+    }
+
+    // 8.8 fixed point position in the palette, no per-pixel division
+    uint32_t pos = ctx->step;
+    uint32_t inc = (256 << 8) / n;
+    for (int i = 0; i < n; i++) {
+        const led_rgb_t *c = &ctx->palette->color[(pos >> 8) & 0xFF];
+        set_px(rgb, i, c->r, c->g, c->b);
+        pos += inc;
+    }
+
+    // Speed-based step increment: speed 0 = 2/3, speed 255 = 16/3 palette steps
+    uint32_t step_inc = (2 + (ctx->speed * 14 / 255)) * 256 / 3;
+    ctx->step = (ctx->step + step_inc) & 0xFFFF;
+}
+
+// Gradient - the palette stretched once over the strip, no animation
+static void effect_gradient(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    if (ctx->palette == NULL) {
+        effect_static(ctx, rgb, n);
+        return;
+    }
+
+    uint32_t pos = 0;
+    uint32_t inc = n > 1 ? (255 << 8) / (n - 1) : 0;
+    for (int i = 0; i < n; i++) {
+        const led_rgb_t *c = &ctx->palette->color[(pos >> 8) & 0xFF];
+        set_px(rgb, i, c->r, c->g, c->b);
+        pos += inc;
+    }
+}
+
+// Script - user program, bounded by the VM's instruction budget
+static void effect_script(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    if (ctx->script == NULL) {
+        effect_static(ctx, rgb, n);
+        return;
+    }
+
+    led_script_env_t env = {
+        .time = ctx->step,
+        .r = ctx->r,
+        .g = ctx->g,
+        .b = ctx->b,
+        .speed = ctx->speed,
+        .palette = ctx->palette,
+    };
+    led_script_run(ctx->script, &env, rgb, n);
+    ctx->step++;
+}
+
+// Flash - whole strip alternates between the base color and off
+static void effect_flash(effect_ctx_t* ctx, uint8_t *rgb, uint16_t n) {
+    if ((ctx->step % 2) == 0) {
+        effect_static(ctx, rgb, n);
+    } else {
+        memset(rgb, 0, n * 3);
+    }
+    ctx->step++;
+}
+
+// ============================================
+// PUBLIC FUNCTIONS
+// ============================================
+
+void effects_ctx_init(effect_ctx_t *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->type = EFFECT_TYPE_STATIC;
+    ctx->speed = 128;
+    ctx->r = 255;
+    ctx->g = 255;
+    ctx->b = 255;
+}
+
+bool effects_is_animated(effect_type_t type) {
+    return type != EFFECT_TYPE_STATIC && type != EFFECT_TYPE_GRADIENT &&
+           type < EFFECT_TYPE_MAX;
+}
+
+uint32_t effects_interval_ms(const effect_ctx_t *ctx) {
+    // Map speed 0-255 to interval 200-10ms
+    return 200 - (ctx->speed * 190 / 255);
+}
+
+void effects_render(effect_ctx_t *ctx, uint8_t *rgb, uint16_t num_leds) {
+    if (num_leds == 0) return;
+
+    switch (ctx->type) {
+        case EFFECT_TYPE_RAINBOW:
+            effect_rainbow(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_BREATHING:
+            effect_breathing(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_CHASE:
+            effect_chase(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_SPARKLE:
+            effect_sparkle(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_FIRE:
+            effect_fire(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_CUSTOM:
+            effect_palette_cycle(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_GRADIENT:
+            effect_gradient(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_FLASH:
+            effect_flash(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_SCRIPT:
+            effect_script(ctx, rgb, num_leds);
+            break;
+        case EFFECT_TYPE_STATIC:
+        default:
+            effect_static(ctx, rgb, num_leds);
+            break;
+    }
+}
+
+void effects_reset(effect_ctx_t *ctx) {
+    ctx->step = 0;
+    ctx->last_update = 0;
+    if (ctx->script != NULL) {
+        led_script_reset(ctx->script);
+    }
+    // Restart the fire from cold
+    if (fire_heat != NULL) {
+        free(fire_heat);
+        fire_heat = NULL;
+        fire_heat_size = 0;
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * OmniaPi LED Palettes - Implementation
+ */
+
+#include "led_palette.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "LED_PALETTE";
+
+#define NVS_NAMESPACE   "led_palette"
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+esp_err_t led_palette_validate(const uint8_t *encoded, size_t len)
+{
+    if (encoded == NULL || len < 1) return ESP_ERR_INVALID_SIZE;
+
+    uint8_t count = encoded[0] & LED_PALETTE_COUNT_MASK;
+    bool gradient = (encoded[0] & LED_PALETTE_GRADIENT) != 0;
+    size_t entry_len = gradient ? 4 : 3;
+
+    if (count < 1 || count > LED_PALETTE_MAX_ENTRIES) return ESP_ERR_INVALID_ARG;
+    if (len != 1 + count * entry_len) return ESP_ERR_INVALID_SIZE;
+
+    if (gradient) {
+        for (int i = 1; i < count; i++) {
+            if (encoded[1 + i * 4] < encoded[1 + (i - 1) * 4]) return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+static inline uint8_t lerp8(uint8_t a, uint8_t b, uint32_t t)
+{
+    // t in 0-255 (fraction of the way from a to b)
+    return (uint8_t)((a * (256 - t) + b * t) >> 8);
+}
+
+static void lerp_rgb(led_rgb_t *out, const uint8_t *a, const uint8_t *b, uint32_t t)
+{
+    out->r = lerp8(a[0], b[0], t);
+    out->g = lerp8(a[1], b[1], t);
+    out->b = lerp8(a[2], b[2], t);
+}
+
+esp_err_t led_palette_build_lut(const uint8_t *encoded, size_t len, led_palette_lut_t *lut)
+{
+    esp_err_t ret = led_palette_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+
+    uint8_t count = encoded[0] & LED_PALETTE_COUNT_MASK;
+    const uint8_t *e = encoded + 1;
+
+    if (!(encoded[0] & LED_PALETTE_GRADIENT)) {
+        // Evenly spread entries, cyclic
+        for (uint32_t x = 0; x < 256; x++) {
+            uint32_t f = x * count;
+            uint32_t k = f >> 8;
+            lerp_rgb(&lut->color[x], &e[k * 3], &e[((k + 1) % count) * 3], f & 0xFF);
+        }
+        return ESP_OK;
+    }
+
+    // Gradient stops: [pos r g b]
+    int stop = 0;
+    for (uint32_t x = 0; x < 256; x++) {
+        while (stop < count - 1 && x > e[(stop + 1) * 4]) {
+            stop++;
+        }
+        const uint8_t *s0 = &e[stop * 4];
+        if (x <= s0[0] || stop == count - 1) {
+            lut->color[x] = (led_rgb_t){ s0[1], s0[2], s0[3] };
+            continue;
+        }
+        const uint8_t *s1 = &e[(stop + 1) * 4];
+        uint32_t t = ((x - s0[0]) << 8) / (s1[0] - s0[0]);
+        lerp_rgb(&lut->color[x], &s0[1], &s1[1], t);
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// NVS Bank
+// ============================================================================
+
+esp_err_t led_palette_bank_store(uint8_t id, const uint8_t *encoded, size_t len)
+{
+    if (id >= LED_PALETTE_BANK_SIZE) return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = led_palette_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+
+    nvs_handle_t handle;
+    ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    char key[4];
+    snprintf(key, sizeof(key), "p%u", id);
+    ret = nvs_set_blob(handle, key, encoded, len);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Palette %u stored (%u %s, %u bytes)", id,
+                 encoded[0] & LED_PALETTE_COUNT_MASK,
+                 (encoded[0] & LED_PALETTE_GRADIENT) ? "stops" : "entries", (unsigned)len);
+    } else {
+        ESP_LOGW(TAG, "Failed to store palette %u: %s", id, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t led_palette_bank_load(uint8_t id, uint8_t *encoded, size_t *len)
+{
+    if (id >= LED_PALETTE_BANK_SIZE) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+    char key[4];
+    snprintf(key, sizeof(key), "p%u", id);
+    size_t size = LED_PALETTE_MAX_ENCODED;
+    ret = nvs_get_blob(handle, key, encoded, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND;
+    if (ret != ESP_OK) return ret;
+
+    *len = size;
+    return led_palette_validate(encoded, size);
+}
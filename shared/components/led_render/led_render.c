@@ -0,0 +1,385 @@
+/**
+ * OmniaPi LED Render - Frame Scheduler Implementation
+ *
+ * Setters only update the parameter block and wake the task; all
+ * rendering and flushing happens in the render task, at most once per
+ * frame tick.
+ */
+
+#include "led_render.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "LED_RENDER";
+
+// ============================================================================
+// Internal State
+// ============================================================================
+static SemaphoreHandle_t s_mutex = NULL;        // Parameter block
+static SemaphoreHandle_t s_frame_mutex = NULL;  // Held while a frame is built and pushed
+static TaskHandle_t s_task = NULL;
+static led_render_flush_t s_flush = NULL;
+static uint16_t s_max_leds = 0;
+static TickType_t s_frame_ticks = 1;
+
+// Parameters (setters)
+static effect_ctx_t s_params;
+static bool s_power = false;
+static uint8_t s_brightness = 255;
+static uint16_t s_num_leds = 0;
+static bool s_dirty = true;         // Parameters changed
+static bool s_restart = true;       // Effect changed, restart the animation
+static bool s_full = true;          // Push the next frame even if unchanged
+static led_palette_lut_t s_params_lut;  // Built by the palette setters
+static bool s_lut_dirty = false;
+static led_script_t s_params_script;    // Loaded by the script setters
+static bool s_script_dirty = false;
+
+// Render task
+static effect_ctx_t s_ctx;
+static led_palette_lut_t s_lut;     // Palette the effects sample
+static led_script_t s_script;       // Program the script effect runs
+static uint8_t *s_next = NULL;      // Frame being built
+static uint8_t *s_out = NULL;       // Last frame pushed
+
+// Load counters for the current effect
+static uint32_t s_frames = 0;
+static uint32_t s_flushes = 0;
+static uint32_t s_skipped = 0;
+static int64_t s_render_us = 0;
+static int64_t s_flush_us = 0;
+static int64_t s_window_start_us = 0;
+static bool s_window_animated = false;  // Counters belong to an animation
+static effect_type_t s_window_type = EFFECT_TYPE_STATIC;
+
+// ============================================================================
+// Render Task
+// ============================================================================
+
+/**
+ * Log the load of the current window (animations only) and start a new one
+ */
+static void report_load(int64_t now_us, bool animated)
+{
+    int64_t window_us = now_us - s_window_start_us;
+    if (s_window_animated && s_frames > 0 && window_us > 0) {
+        ESP_LOGI(TAG, "Effect %d: %lu frames, %lu pushed, %lu unchanged in %lu ms; "
+                 "render %lu us/frame (%lu.%02lu%% CPU), flush %lu us/push",
+                 s_window_type, (unsigned long)s_frames, (unsigned long)s_flushes,
+                 (unsigned long)s_skipped, (unsigned long)(window_us / 1000),
+                 (unsigned long)(s_render_us / s_frames),
+                 (unsigned long)(s_render_us * 100 / window_us),
+                 (unsigned long)(s_render_us * 10000 / window_us % 100),
+                 (unsigned long)(s_flushes ? s_flush_us / s_flushes : 0));
+        if (s_window_type == EFFECT_TYPE_SCRIPT) {
+            ESP_LOGI(TAG, "Script: max %lu of %d instructions per frame, %lu frames cut short%s",
+                     (unsigned long)s_script.max_frame_instr, LED_SCRIPT_FRAME_BUDGET,
+                     (unsigned long)s_script.budget_stops,
+                     s_script.faulted ? ", stopped" : "");
+        }
+    }
+    s_frames = 0;
+    s_flushes = 0;
+    s_skipped = 0;
+    s_render_us = 0;
+    s_flush_us = 0;
+    s_window_start_us = now_us;
+    s_window_animated = animated;
+    s_window_type = s_ctx.type;
+}
+
+static void apply_brightness(uint8_t *rgb, uint16_t n, uint8_t brightness)
+{
+    if (brightness == 255) return;
+    for (int i = 0; i < n * 3; i++) {
+        rgb[i] = (uint8_t)((rgb[i] * brightness) / 255);
+    }
+}
+
+static void render_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        xSemaphoreTake(s_frame_mutex, portMAX_DELAY);
+
+        // Snapshot parameters, keeping the animation state
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        bool dirty = s_dirty;
+        bool restart = s_restart;
+        bool full = s_full;
+        bool power = s_power;
+        uint8_t brightness = s_brightness;
+        uint16_t n = s_num_leds;
+        if (dirty) {
+            effect_type_t old_type = s_ctx.type;
+            uint32_t step = s_ctx.step;
+            uint32_t last_update = s_ctx.last_update;
+            s_ctx = s_params;
+            s_ctx.step = step;
+            s_ctx.last_update = last_update;
+            s_ctx.palette = &s_lut;
+            s_ctx.script = &s_script;
+            if (s_ctx.type != old_type) {
+                restart = true;
+            }
+        }
+        if (s_lut_dirty) {
+            s_lut = s_params_lut;
+            s_lut_dirty = false;
+        }
+        if (s_script_dirty) {
+            s_script = s_params_script;
+            s_script_dirty = false;
+        }
+        s_dirty = false;
+        s_restart = false;
+        s_full = false;
+        xSemaphoreGive(s_mutex);
+
+        int64_t now_us = esp_timer_get_time();
+        uint32_t now_ms = (uint32_t)(now_us / 1000);
+        bool animated = power && effects_is_animated(s_ctx.type);
+        if (restart || animated != s_window_animated) {
+            report_load(now_us, animated);
+        }
+        if (restart) {
+            effects_reset(&s_ctx);
+        }
+        bool due = animated && (now_ms - s_ctx.last_update) >= effects_interval_ms(&s_ctx);
+
+        if (dirty || due || full) {
+            if (power) {
+                effects_render(&s_ctx, s_next, n);
+                apply_brightness(s_next, n, brightness);
+                if (due) s_ctx.last_update = now_ms;
+            } else {
+                memset(s_next, 0, n * 3);
+            }
+            int64_t rendered_us = esp_timer_get_time();
+            s_render_us += rendered_us - now_us;
+            s_frames++;
+
+            // Dirty tracking: only changed frames go to the strip
+            if (full || memcmp(s_next, s_out, n * 3) != 0) {
+                s_flush(s_next, n);
+                s_flush_us += esp_timer_get_time() - rendered_us;
+                s_flushes++;
+
+                uint8_t *tmp = s_out;
+                s_out = s_next;
+                s_next = tmp;
+            } else {
+                s_skipped++;
+            }
+        }
+
+        xSemaphoreGive(s_frame_mutex);
+
+        if (animated) {
+            if (now_us - s_window_start_us >= (int64_t)LED_RENDER_STATS_PERIOD_MS * 1000) {
+                report_load(now_us, true);
+            }
+            vTaskDelayUntil(&last_wake, s_frame_ticks);
+        } else {
+            // Static or off: nothing to do until a setter runs
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last_wake = xTaskGetTickCount();
+        }
+    }
+}
+
+// ============================================================================
+// Parameter Updates
+// ============================================================================
+
+static bool params_lock(void)
+{
+    if (s_mutex == NULL) return false;
+    return xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+static void params_unlock_and_wake(void)
+{
+    s_dirty = true;
+    xSemaphoreGive(s_mutex);
+    xTaskNotifyGive(s_task);
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t led_render_init(const led_render_config_t *config)
+{
+    if (s_task != NULL) return ESP_OK;
+    if (config == NULL || config->flush == NULL || config->max_leds == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_mutex = xSemaphoreCreateMutex();
+    s_frame_mutex = xSemaphoreCreateMutex();
+    s_next = calloc(config->max_leds, 3);
+    s_out = calloc(config->max_leds, 3);
+    if (s_mutex == NULL || s_frame_mutex == NULL || s_next == NULL || s_out == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate frame buffers");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_flush = config->flush;
+    s_max_leds = config->max_leds;
+    s_num_leds = config->num_leds <= config->max_leds ? config->num_leds : config->max_leds;
+    uint16_t frame_ms = config->frame_ms ? config->frame_ms : LED_RENDER_FRAME_MS;
+    s_frame_ticks = pdMS_TO_TICKS(frame_ms) > 0 ? pdMS_TO_TICKS(frame_ms) : 1;
+
+    effects_ctx_init(&s_params);
+    s_params.palette = &s_lut;
+    s_params.script = &s_script;
+    s_ctx = s_params;
+
+    // Custom colors default (red, green, blue)
+    static const uint8_t default_palette[] = { 3, 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+    led_palette_build_lut(default_palette, sizeof(default_palette), &s_lut);
+    s_window_start_us = esp_timer_get_time();
+
+    if (xTaskCreate(render_task, "led_render", LED_RENDER_TASK_STACK, NULL,
+                    LED_RENDER_TASK_PRIORITY, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create render task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Renderer started: %d/%d LEDs, %d ms frames",
+             s_num_leds, s_max_leds, frame_ms);
+    return ESP_OK;
+}
+
+void led_render_set_power(bool on)
+{
+    if (!params_lock()) return;
+    s_power = on;
+    params_unlock_and_wake();
+}
+
+void led_render_set_effect(effect_type_t type)
+{
+    if (type >= EFFECT_TYPE_MAX) return;
+    if (!params_lock()) return;
+    s_params.type = type;
+    s_restart = true;
+    params_unlock_and_wake();
+}
+
+void led_render_set_speed(uint8_t speed)
+{
+    if (!params_lock()) return;
+    s_params.speed = speed;
+    params_unlock_and_wake();
+}
+
+void led_render_set_color(uint8_t r, uint8_t g, uint8_t b)
+{
+    if (!params_lock()) return;
+    s_params.r = r;
+    s_params.g = g;
+    s_params.b = b;
+    params_unlock_and_wake();
+}
+
+void led_render_set_brightness(uint8_t brightness)
+{
+    if (!params_lock()) return;
+    s_brightness = brightness;
+    params_unlock_and_wake();
+}
+
+void led_render_set_custom_colors(uint8_t r1, uint8_t g1, uint8_t b1,
+                                  uint8_t r2, uint8_t g2, uint8_t b2,
+                                  uint8_t r3, uint8_t g3, uint8_t b3)
+{
+    const uint8_t encoded[] = { 3, r1, g1, b1, r2, g2, b2, r3, g3, b3 };
+    led_render_set_palette(encoded, sizeof(encoded));
+}
+
+esp_err_t led_render_set_palette(const uint8_t *encoded, size_t len)
+{
+    esp_err_t ret = led_palette_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+    if (!params_lock()) return ESP_ERR_TIMEOUT;
+    // Expand once here; the effects then only index the table
+    led_palette_build_lut(encoded, len, &s_params_lut);
+    s_lut_dirty = true;
+    params_unlock_and_wake();
+    return ESP_OK;
+}
+
+esp_err_t led_render_select_palette(uint8_t id)
+{
+    uint8_t encoded[LED_PALETTE_MAX_ENCODED];
+    size_t len = 0;
+    esp_err_t ret = led_palette_bank_load(id, encoded, &len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Palette %d not available: %s", id, esp_err_to_name(ret));
+        return ret;
+    }
+    return led_render_set_palette(encoded, len);
+}
+
+esp_err_t led_render_check_script(const uint8_t *encoded, size_t len)
+{
+    return led_script_check_budget(encoded, len, s_num_leds);
+}
+
+esp_err_t led_render_set_script(const uint8_t *encoded, size_t len)
+{
+    esp_err_t ret = led_render_check_script(encoded, len);
+    if (ret != ESP_OK) return ret;
+    if (!params_lock()) return ESP_ERR_TIMEOUT;
+    led_script_load(&s_params_script, encoded, len);
+    s_script_dirty = true;
+    s_restart = true;
+    params_unlock_and_wake();
+    return ESP_OK;
+}
+
+esp_err_t led_render_select_script(uint8_t id)
+{
+    uint8_t encoded[LED_SCRIPT_MAX_ENCODED];
+    size_t len = 0;
+    esp_err_t ret = led_script_bank_load(id, encoded, &len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Script %d not available: %s", id, esp_err_to_name(ret));
+        return ret;
+    }
+    return led_render_set_script(encoded, len);
+}
+
+void led_render_set_num_leds(uint16_t num)
+{
+    if (!params_lock()) return;
+    s_num_leds = num <= s_max_leds ? num : s_max_leds;
+    s_restart = true;
+    s_full = true;
+    params_unlock_and_wake();
+}
+
+void led_render_pause(void)
+{
+    if (s_frame_mutex == NULL) return;
+    xSemaphoreTake(s_frame_mutex, portMAX_DELAY);
+}
+
+void led_render_resume(void)
+{
+    if (s_frame_mutex == NULL) return;
+    if (params_lock()) {
+        s_full = true;
+        params_unlock_and_wake();
+    }
+    xSemaphoreGive(s_frame_mutex);
+}
@@ -0,0 +1,502 @@
+/**
+ * OmniaPi LED Scripts - Implementation
+ */
+
+#include "led_script.h"
+#include "led_effects.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "LED_SCRIPT";
+
+#define NVS_NAMESPACE   "led_script"
+
+static uint8_t s_sin8[256];
+static bool s_sin8_ready = false;
+static uint32_t s_rand_state = 0x12345678;
+
+// ============================================================================
+// Validation
+// ============================================================================
+
+/**
+ * Immediate bytes following an opcode, -1 if the opcode is unknown
+ */
+static int op_imm_len(uint8_t op)
+{
+    switch (op) {
+        case LED_OP_JMP:
+        case LED_OP_JZ:
+        case LED_OP_PUSH8:
+        case LED_OP_LOAD:
+        case LED_OP_STORE:
+            return 1;
+        case LED_OP_PUSH16:
+            return 2;
+        case LED_OP_END:
+        case LED_OP_TIME: case LED_OP_INDEX: case LED_OP_COUNT:
+        case LED_OP_COLOR_R: case LED_OP_COLOR_G: case LED_OP_COLOR_B: case LED_OP_SPEED:
+        case LED_OP_DUP: case LED_OP_DROP: case LED_OP_SWAP: case LED_OP_OVER:
+        case LED_OP_ADD: case LED_OP_SUB: case LED_OP_MUL: case LED_OP_DIV:
+        case LED_OP_MOD: case LED_OP_AND: case LED_OP_OR: case LED_OP_XOR:
+        case LED_OP_SHL: case LED_OP_SHR: case LED_OP_MIN: case LED_OP_MAX:
+        case LED_OP_LT: case LED_OP_NEG:
+        case LED_OP_CLAMP8: case LED_OP_SCALE8: case LED_OP_SIN8: case LED_OP_TRI8:
+        case LED_OP_NOISE8: case LED_OP_RAND8:
+        case LED_OP_OUT_RGB: case LED_OP_OUT_HSV: case LED_OP_OUT_PAL:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static esp_err_t validate_section(const uint8_t *code, size_t len)
+{
+    // Instruction starts, plus the section end: the only valid jump targets
+    uint8_t starts[(LED_SCRIPT_MAX_CODE + 1 + 7) / 8] = { 0 };
+    if (len > LED_SCRIPT_MAX_CODE) return ESP_ERR_INVALID_SIZE;
+
+    size_t pc = 0;
+    while (pc < len) {
+        uint8_t op = code[pc];
+        int imm = op_imm_len(op);
+        if (imm < 0 || pc + 1 + imm > len) return ESP_ERR_INVALID_ARG;
+
+        if ((op == LED_OP_LOAD || op == LED_OP_STORE) && code[pc + 1] >= LED_SCRIPT_VARS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        starts[pc / 8] |= 1 << (pc % 8);
+        pc += 1 + imm;
+    }
+    starts[len / 8] |= 1 << (len % 8);
+
+    // A jump into an immediate would run bytes that were never checked
+    for (pc = 0; pc < len; pc += 1 + op_imm_len(code[pc])) {
+        if (code[pc] != LED_OP_JMP && code[pc] != LED_OP_JZ) continue;
+        size_t target = pc + 2 + code[pc + 1];
+        if (target > len || !(starts[target / 8] & (1 << (target % 8)))) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * Instructions in a valid section (the most one run can execute)
+ */
+static uint32_t count_instructions(const uint8_t *code, size_t len)
+{
+    uint32_t count = 0;
+    for (size_t pc = 0; pc < len; pc += 1 + op_imm_len(code[pc])) {
+        count++;
+    }
+    return count;
+}
+
+esp_err_t led_script_validate(const uint8_t *encoded, size_t len)
+{
+    if (encoded == NULL || len < LED_SCRIPT_HEADER_LEN || len > LED_SCRIPT_MAX_ENCODED) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (encoded[0] != LED_SCRIPT_VERSION) return ESP_ERR_NOT_SUPPORTED;
+
+    size_t frame_len = encoded[1];
+    size_t pixel_len = encoded[2];
+    if (frame_len + pixel_len == 0 || LED_SCRIPT_HEADER_LEN + frame_len + pixel_len != len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *code = encoded + LED_SCRIPT_HEADER_LEN;
+    esp_err_t ret = validate_section(code, frame_len);
+    if (ret != ESP_OK) return ret;
+    return validate_section(code + frame_len, pixel_len);
+}
+
+esp_err_t led_script_check_budget(const uint8_t *encoded, size_t len, uint16_t num_leds)
+{
+    esp_err_t ret = led_script_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+
+    const uint8_t *code = encoded + LED_SCRIPT_HEADER_LEN;
+    uint32_t worst = count_instructions(code, encoded[1]) +
+                     count_instructions(code + encoded[1], encoded[2]) * num_leds;
+    if (worst > LED_SCRIPT_FRAME_BUDGET) {
+        ESP_LOGW(TAG, "Script needs up to %lu instructions per frame on %u LEDs, budget is %d",
+                 (unsigned long)worst, num_leds, LED_SCRIPT_FRAME_BUDGET);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Interpreter
+// ============================================================================
+
+typedef enum {
+    RUN_OK,
+    RUN_FAULT,                  // Stack error, the program is stopped
+    RUN_OUT_OF_BUDGET,          // Frame budget used up
+} run_result_t;
+
+static void sin8_init(void)
+{
+    if (s_sin8_ready) return;
+    for (int i = 0; i < 256; i++) {
+        s_sin8[i] = (uint8_t)(128 + 127 * sinf((float)i * 6.2831853f / 256.0f));
+    }
+    s_sin8_ready = true;
+}
+
+static inline uint8_t hash8(uint32_t k)
+{
+    return (uint8_t)((k * 2654435761u) >> 24);
+}
+
+// Value noise: random lattice every 256 steps, smoothstep in between
+static uint8_t noise8(int32_t x)
+{
+    uint32_t k = (uint32_t)x >> 8;
+    uint32_t t = (uint32_t)x & 0xFF;
+    t = (t * t * (768 - 2 * t)) >> 16;
+    int32_t a = hash8(k);
+    int32_t b = hash8(k + 1);
+    return (uint8_t)(a + (((b - a) * (int32_t)t) >> 8));
+}
+
+// Division that cannot trap (x/0 = 0, INT32_MIN/-1 wraps)
+static inline int32_t div32(int32_t a, int32_t b)
+{
+    if (b == 0) return 0;
+    if (b == -1) return (int32_t)(0u - (uint32_t)a);
+    return a / b;
+}
+
+static inline uint8_t clamp8(int32_t v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+/**
+ * Run one section
+ * @param budget  Instructions left this frame, decremented
+ * @param out     RGB output (left untouched if the section sets none)
+ */
+static run_result_t run_section(led_script_t *script, const led_script_env_t *env,
+                        const uint8_t *code, uint8_t len, int32_t index, uint16_t count,
+                        uint32_t *budget, uint8_t *out)
+{
+    int32_t stack[LED_SCRIPT_STACK_DEPTH];
+    int sp = 0;
+    int pc = 0;                 // int: a jump can never wrap back into the section
+
+#define NEED(k)     do { if (sp < (k)) goto underflow; } while (0)
+#define PUSH(v)     do { if (sp >= LED_SCRIPT_STACK_DEPTH) goto overflow; \
+                         int32_t pv = (v); stack[sp++] = pv; } while (0)
+#define BINARY(expr) do { NEED(2); int32_t b = stack[--sp]; int32_t a = stack[sp - 1]; \
+                          stack[sp - 1] = (expr); (void)a; (void)b; } while (0)
+// Validation guarantees these; checked again so a bad program cannot
+// reach past the section or the variables
+#define IMM(k)      do { if (pc + (k) > len) goto bad_code; } while (0)
+#define VAR()       do { IMM(1); if (code[pc] >= LED_SCRIPT_VARS) goto bad_code; } while (0)
+
+    while (pc < len) {
+        if (*budget == 0) return RUN_OUT_OF_BUDGET;
+        (*budget)--;
+
+        uint8_t op = code[pc++];
+        switch (op) {
+            case LED_OP_END:
+                return RUN_OK;
+            case LED_OP_JMP:
+                IMM(1);
+                pc += 1 + code[pc];
+                break;
+            case LED_OP_JZ:
+                IMM(1);
+                NEED(1);
+                pc += (stack[--sp] == 0) ? 1 + code[pc] : 1;
+                break;
+
+            case LED_OP_PUSH8:
+                IMM(1);
+                PUSH(code[pc]);
+                pc++;
+                break;
+            case LED_OP_PUSH16:
+                IMM(2);
+                PUSH((int16_t)(code[pc] | (code[pc + 1] << 8)));
+                pc += 2;
+                break;
+            case LED_OP_TIME:    PUSH((int32_t)env->time); break;
+            case LED_OP_INDEX:   PUSH(index); break;
+            case LED_OP_COUNT:   PUSH(count); break;
+            case LED_OP_COLOR_R: PUSH(env->r); break;
+            case LED_OP_COLOR_G: PUSH(env->g); break;
+            case LED_OP_COLOR_B: PUSH(env->b); break;
+            case LED_OP_SPEED:   PUSH(env->speed); break;
+
+            case LED_OP_DUP:
+                NEED(1);
+                PUSH(stack[sp - 1]);
+                break;
+            case LED_OP_DROP:
+                NEED(1);
+                sp--;
+                break;
+            case LED_OP_SWAP: {
+                NEED(2);
+                int32_t t = stack[sp - 1];
+                stack[sp - 1] = stack[sp - 2];
+                stack[sp - 2] = t;
+                break;
+            }
+            case LED_OP_OVER:
+                NEED(2);
+                PUSH(stack[sp - 2]);
+                break;
+            case LED_OP_LOAD:
+                VAR();
+                PUSH(script->vars[code[pc]]);
+                pc++;
+                break;
+            case LED_OP_STORE:
+                VAR();
+                NEED(1);
+                script->vars[code[pc]] = stack[--sp];
+                pc++;
+                break;
+
+            case LED_OP_ADD: BINARY((int32_t)((uint32_t)a + (uint32_t)b)); break;
+            case LED_OP_SUB: BINARY((int32_t)((uint32_t)a - (uint32_t)b)); break;
+            case LED_OP_MUL: BINARY((int32_t)((uint32_t)a * (uint32_t)b)); break;
+            case LED_OP_DIV: BINARY(div32(a, b)); break;
+            case LED_OP_MOD: BINARY((b != 0 && b != -1) ? a % b : 0); break;
+            case LED_OP_AND: BINARY(a & b); break;
+            case LED_OP_OR:  BINARY(a | b); break;
+            case LED_OP_XOR: BINARY(a ^ b); break;
+            case LED_OP_SHL: BINARY((int32_t)((uint32_t)a << (b & 31))); break;
+            case LED_OP_SHR: BINARY(a >> (b & 31)); break;
+            case LED_OP_MIN: BINARY(a < b ? a : b); break;
+            case LED_OP_MAX: BINARY(a > b ? a : b); break;
+            case LED_OP_LT:  BINARY(a < b); break;
+            case LED_OP_NEG:
+                NEED(1);
+                stack[sp - 1] = (int32_t)(0u - (uint32_t)stack[sp - 1]);
+                break;
+
+            case LED_OP_CLAMP8:
+                NEED(1);
+                stack[sp - 1] = clamp8(stack[sp - 1]);
+                break;
+            case LED_OP_SCALE8: BINARY(clamp8(a) * clamp8(b) / 255); break;
+            case LED_OP_SIN8:
+                NEED(1);
+                stack[sp - 1] = s_sin8[stack[sp - 1] & 0xFF];
+                break;
+            case LED_OP_TRI8: {
+                NEED(1);
+                int32_t x = stack[sp - 1] & 0xFF;
+                stack[sp - 1] = x < 128 ? x * 2 : (255 - x) * 2;
+                break;
+            }
+            case LED_OP_NOISE8:
+                NEED(1);
+                stack[sp - 1] = noise8(stack[sp - 1]);
+                break;
+            case LED_OP_RAND8:
+                s_rand_state ^= s_rand_state << 13;
+                s_rand_state ^= s_rand_state >> 17;
+                s_rand_state ^= s_rand_state << 5;
+                PUSH(s_rand_state & 0xFF);
+                break;
+
+            case LED_OP_OUT_RGB:
+                NEED(3);
+                out[2] = clamp8(stack[--sp]);
+                out[1] = clamp8(stack[--sp]);
+                out[0] = clamp8(stack[--sp]);
+                break;
+            case LED_OP_OUT_HSV: {
+                NEED(3);
+                uint8_t v = clamp8(stack[--sp]);
+                uint8_t s = clamp8(stack[--sp]);
+                uint8_t h = (uint8_t)(stack[--sp] & 0xFF);
+                effects_hsv_to_rgb(h, s, v, &out[0], &out[1], &out[2]);
+                break;
+            }
+            case LED_OP_OUT_PAL: {
+                NEED(1);
+                uint8_t x = (uint8_t)(stack[--sp] & 0xFF);
+                if (env->palette != NULL) {
+                    const led_rgb_t *c = &env->palette->color[x];
+                    out[0] = c->r;
+                    out[1] = c->g;
+                    out[2] = c->b;
+                } else {
+                    out[0] = out[1] = out[2] = 0;
+                }
+                break;
+            }
+
+            default:
+                // Rejected by validation, never reached
+                return RUN_FAULT;
+        }
+    }
+    return RUN_OK;
+
+underflow:
+    ESP_LOGW(TAG, "Stack underflow at %d (op 0x%02X), script stopped", pc - 1, code[pc - 1]);
+    return RUN_FAULT;
+overflow:
+    ESP_LOGW(TAG, "Stack overflow at %d (op 0x%02X), script stopped", pc - 1, code[pc - 1]);
+    return RUN_FAULT;
+bad_code:
+    ESP_LOGW(TAG, "Invalid operand at %d (op 0x%02X), script stopped", pc - 1, code[pc - 1]);
+    return RUN_FAULT;
+
+#undef NEED
+#undef PUSH
+#undef BINARY
+#undef IMM
+#undef VAR
+}
+
+static void fill(uint8_t *rgb, uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (int i = 0; i < n; i++) {
+        rgb[i * 3] = r;
+        rgb[i * 3 + 1] = g;
+        rgb[i * 3 + 2] = b;
+    }
+}
+
+// ============================================================================
+// Public Functions
+// ============================================================================
+
+esp_err_t led_script_load(led_script_t *script, const uint8_t *encoded, size_t len)
+{
+    esp_err_t ret = led_script_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+
+    sin8_init();
+    memset(script, 0, sizeof(*script));
+    script->frame_len = encoded[1];
+    script->pixel_len = encoded[2];
+    memcpy(script->code, encoded + LED_SCRIPT_HEADER_LEN, len - LED_SCRIPT_HEADER_LEN);
+    script->frame_instr = (uint8_t)count_instructions(script->code, script->frame_len);
+    script->pixel_instr = (uint8_t)count_instructions(script->code + script->frame_len,
+                                                      script->pixel_len);
+    return ESP_OK;
+}
+
+void led_script_reset(led_script_t *script)
+{
+    memset(script->vars, 0, sizeof(script->vars));
+    script->faulted = false;
+    script->max_frame_instr = 0;
+    script->budget_stops = 0;
+}
+
+void led_script_run(led_script_t *script, const led_script_env_t *env,
+                    uint8_t *rgb, uint16_t num_leds)
+{
+    if (script->faulted || script->frame_len + script->pixel_len == 0) {
+        fill(rgb, num_leds, env->r, env->g, env->b);
+        return;
+    }
+
+    uint32_t budget = LED_SCRIPT_FRAME_BUDGET;
+    const uint8_t *pixel_code = script->code + script->frame_len;
+    uint8_t out[3] = { 0, 0, 0 };
+    run_result_t res = RUN_OK;
+
+    if (script->frame_len > 0) {
+        res = run_section(script, env, script->code, script->frame_len, 0, num_leds, &budget, out);
+    }
+
+    if (res == RUN_OK && script->pixel_len == 0) {
+        fill(rgb, num_leds, out[0], out[1], out[2]);
+    }
+    int done = 0;
+    while (res == RUN_OK && script->pixel_len > 0 && done < num_leds) {
+        uint8_t *px = &rgb[done * 3];
+        px[0] = px[1] = px[2] = 0;
+        res = run_section(script, env, pixel_code, script->pixel_len, done, num_leds, &budget, px);
+        if (res == RUN_OK) done++;
+    }
+
+    uint32_t used = LED_SCRIPT_FRAME_BUDGET - budget;
+    if (used > script->max_frame_instr) {
+        script->max_frame_instr = used;
+    }
+
+    if (res == RUN_FAULT) {
+        script->faulted = true;
+        fill(rgb, num_leds, env->r, env->g, env->b);
+    } else if (res == RUN_OUT_OF_BUDGET) {
+        // Strip lengthened since the budget check: keep running, the rest
+        // of this frame shows the base color
+        if (script->budget_stops++ == 0) {
+            ESP_LOGW(TAG, "Frame budget of %d instructions reached at LED %d of %u",
+                     LED_SCRIPT_FRAME_BUDGET, done, num_leds);
+        }
+        fill(&rgb[done * 3], num_leds - done, env->r, env->g, env->b);
+    }
+}
+
+// ============================================================================
+// NVS Bank
+// ============================================================================
+
+esp_err_t led_script_bank_store(uint8_t id, const uint8_t *encoded, size_t len)
+{
+    if (id >= LED_SCRIPT_BANK_SIZE) return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = led_script_validate(encoded, len);
+    if (ret != ESP_OK) return ret;
+
+    nvs_handle_t handle;
+    ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    char key[4];
+    snprintf(key, sizeof(key), "s%u", id);
+    ret = nvs_set_blob(handle, key, encoded, len);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Script %u stored (frame %u + pixel %u bytes)", id, encoded[1], encoded[2]);
+    } else {
+        ESP_LOGW(TAG, "Failed to store script %u: %s", id, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t led_script_bank_load(uint8_t id, uint8_t *encoded, size_t *len)
+{
+    if (id >= LED_SCRIPT_BANK_SIZE) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+    char key[4];
+    snprintf(key, sizeof(key), "s%u", id);
+    size_t size = LED_SCRIPT_MAX_ENCODED;
+    ret = nvs_get_blob(handle, key, encoded, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND;
+    if (ret != ESP_OK) return ret;
+
+    *len = size;
+    return led_script_validate(encoded, size);
+}
@@ -0,0 +1,649 @@
+#!/usr/bin/env python3
+"""
+OmniaPi Command Latency Bench
+
+Drives the gateway's MQTT command path from a local test broker and writes
+a machine-readable report, so runs against different firmware versions
+can be compared. The broker is built in (MQTT 3.1.1, no dependencies
+beyond the Python standard library): point the gateway at this machine,
+and no other client sends commands during the run.
+
+    # Once: aim the gateway at the bench broker, then reboot it
+    curl -X POST http://GATEWAY/api/provision/mqtt \\
+         -d '{"broker_uri": "mqtt://BENCH_HOST:1883"}'
+    curl -X POST http://GATEWAY/api/reboot
+
+    latency_bench.py --gateway GATEWAY > v1.6.0.json
+    latency_bench.py --gateway GATEWAY --baseline v1.6.0.json > v1.6.1.json
+
+Phases (in this order, pick with --phases):
+  single  one cmd/relay at a time, each waits for the node's .../state
+  burst   scenes: --scene-size nodes commanded back to back
+  ota     single commands while a node OTA runs (needs --ota-image; the
+          target node is not commanded, the transfer is aborted at the end
+          unless --ota-finish)
+  scan    single commands while a commissioning scan runs; the gateway
+          leaves the broker during a scan, so commands published then
+          count as undelivered
+
+Each phase resets GET /api/latency first and stores the gateway's report
+next to the bench's own numbers, which include the broker hops:
+  sent / undelivered (no gateway subscribed) / lost (no state within
+  --timeout-ms) / answered, p50/p95/p99/max in ms (nearest rank, as the
+  firmware), answered per second over the phase.
+
+Relays are switched: every node alternates on/off starting with on.
+
+With --baseline, p95/p99 and the unanswered share (lost + undelivered)
+of each phase are compared with an earlier report; the exit status is 2
+on a regression.
+"""
+
+import argparse
+import asyncio
+import json
+import random
+import struct
+import sys
+import time
+import urllib.parse
+import urllib.request
+from datetime import datetime, timezone
+
+# ============================================================================
+# Gateway Interface (must match omniapi_protocol.h / cmd_latency.h)
+# ============================================================================
+TOPIC_CMD_RELAY = 'omniapi/gateway/cmd/relay'
+TOPIC_SCAN = 'omniapi/gateway/scan'
+TOPIC_NODE_STATE = 'omniapi/gateway/nodes/+/state'
+DEVICE_TYPE_RELAY = 0x01
+CMD_LATENCY_TIMEOUT_MS = 5000
+
+PHASES = ['single', 'burst', 'ota', 'scan']
+REPORT_VERSION = 1
+
+# MQTT control packet types
+CONNECT, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL, PUBCOMP = 1, 2, 3, 4, 5, 6, 7
+SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 10, 11, 12, 13, 14
+
+
+def log(message):
+    print(f"[{time.strftime('%H:%M:%S')}] {message}", file=sys.stderr, flush=True)
+
+
+# ============================================================================
+# MQTT Wire Format
+# ============================================================================
+
+def packet(ptype, flags, body=b''):
+    header = bytearray([ptype << 4 | flags])
+    n = len(body)
+    while True:
+        byte, n = n % 128, n // 128
+        header.append(byte | 0x80 if n else byte)
+        if not n:
+            return bytes(header) + body
+
+
+def mqtt_str(data):
+    return struct.pack('!H', len(data)) + data
+
+
+def take_str(body, pos):
+    n = struct.unpack_from('!H', body, pos)[0]
+    return body[pos + 2:pos + 2 + n], pos + 2 + n
+
+
+async def read_packet(reader):
+    first = (await reader.readexactly(1))[0]
+    length, mult = 0, 1
+    while True:
+        byte = (await reader.readexactly(1))[0]
+        length += (byte & 0x7F) * mult
+        if not byte & 0x80:
+            break
+        mult *= 128
+    body = await reader.readexactly(length) if length else b''
+    return first >> 4, first & 0x0F, body
+
+
+def topic_matches(topic_filter, topic):
+    filter_parts, topic_parts = topic_filter.split('/'), topic.split('/')
+    for i, part in enumerate(filter_parts):
+        if part == '#':
+            return True
+        if i >= len(topic_parts) or (part != '+' and part != topic_parts[i]):
+            return False
+    return len(filter_parts) == len(topic_parts)
+
+
+# ============================================================================
+# Test Broker
+# ============================================================================
+
+class Session:
+    def __init__(self, writer):
+        self.writer = writer
+        self.client_id = ''
+        self.filters = []
+        self.will = None
+
+    def send(self, data):
+        if not self.writer.is_closing():
+            self.writer.write(data)
+
+
+class Broker:
+    """
+    Just enough of MQTT 3.1.1 for the gateway: clean sessions only, every
+    delivery at QoS 0 (incoming QoS 1/2 are acknowledged), retained
+    messages and wills. on_publish sees each client publish as it arrives.
+    """
+
+    def __init__(self, on_publish):
+        self.on_publish = on_publish
+        self.sessions = set()
+        self.retained = {}
+        self.gateway_down_at = None
+        self.gateway_offline_s = 0.0
+
+    async def start(self, host, port):
+        self.server = await asyncio.start_server(self.handle, host, port)
+
+    def stop(self):
+        self.server.close()
+        for session in self.sessions:
+            session.writer.close()
+
+    def gateway_online(self):
+        return any(topic_matches(f, TOPIC_CMD_RELAY) for s in self.sessions for f in s.filters)
+
+    def offline_s(self):
+        """Total time the gateway was not subscribed, including right now"""
+        ongoing = time.monotonic() - self.gateway_down_at if self.gateway_down_at else 0.0
+        return self.gateway_offline_s + ongoing
+
+    async def wait_gateway(self, timeout_s):
+        deadline = time.monotonic() + timeout_s
+        while not self.gateway_online():
+            if time.monotonic() > deadline:
+                return False
+            await asyncio.sleep(0.1)
+        return True
+
+    def publish(self, topic, payload, retain=False):
+        """Deliver to every matching subscriber, return how many there were"""
+        if retain:
+            if payload:
+                self.retained[topic] = payload
+            else:
+                self.retained.pop(topic, None)
+
+        data = packet(PUBLISH, 0, mqtt_str(topic.encode()) + payload)
+        delivered = 0
+        for session in list(self.sessions):
+            if any(topic_matches(f, topic) for f in session.filters):
+                session.send(data)
+                delivered += 1
+        return delivered
+
+    def track_gateway(self, was_online):
+        online = self.gateway_online()
+        if was_online and not online:
+            self.gateway_down_at = time.monotonic()
+            log("gateway left the broker")
+        elif online and not was_online:
+            if self.gateway_down_at:
+                self.gateway_offline_s += time.monotonic() - self.gateway_down_at
+                self.gateway_down_at = None
+            log("gateway subscribed")
+
+    async def handle(self, reader, writer):
+        session = Session(writer)
+        try:
+            ptype, _, body = await read_packet(reader)
+            if ptype != CONNECT:
+                return
+            _, pos = take_str(body, 0)                  # Protocol name
+            connect_flags = body[pos + 1]
+            pos += 4                                    # Level, flags, keepalive
+            client_id, pos = take_str(body, pos)
+            session.client_id = client_id.decode(errors='replace')
+            if connect_flags & 0x04:
+                will_topic, pos = take_str(body, pos)
+                will_message, pos = take_str(body, pos)
+                session.will = (will_topic.decode(), will_message, bool(connect_flags & 0x20))
+            self.sessions.add(session)
+            session.send(packet(CONNACK, 0, b'\x00\x00'))
+            log(f"client '{session.client_id}' connected from {writer.get_extra_info('peername')}")
+
+            while True:
+                ptype, flags, body = await read_packet(reader)
+                if ptype == PUBLISH:
+                    qos = (flags >> 1) & 0x03
+                    topic, pos = take_str(body, 0)
+                    if qos:
+                        packet_id, pos = body[pos:pos + 2], pos + 2
+                        session.send(packet(PUBACK if qos == 1 else PUBREC, 0, packet_id))
+                    topic = topic.decode(errors='replace')
+                    payload = body[pos:]
+                    self.on_publish(topic, payload)
+                    self.publish(topic, payload, retain=bool(flags & 0x01))
+                elif ptype == PUBREL:
+                    session.send(packet(PUBCOMP, 0, body[:2]))
+                elif ptype == SUBSCRIBE:
+                    was_online = self.gateway_online()
+                    pos, granted, added = 2, b'', []
+                    while pos < len(body):
+                        topic_filter, pos = take_str(body, pos)
+                        pos += 1                        # Requested QoS
+                        added.append(topic_filter.decode(errors='replace'))
+                        granted += b'\x00'
+                    session.filters.extend(added)
+                    session.send(packet(SUBACK, 0, body[:2] + granted))
+                    for topic, payload in self.retained.items():
+                        if any(topic_matches(f, topic) for f in added):
+                            session.send(packet(PUBLISH, 0x01, mqtt_str(topic.encode()) + payload))
+                    self.track_gateway(was_online)
+                elif ptype == UNSUBSCRIBE:
+                    was_online = self.gateway_online()
+                    pos = 2
+                    while pos < len(body):
+                        topic_filter, pos = take_str(body, pos)
+                        topic_filter = topic_filter.decode(errors='replace')
+                        if topic_filter in session.filters:
+                            session.filters.remove(topic_filter)
+                    session.send(packet(UNSUBACK, 0, body[:2]))
+                    self.track_gateway(was_online)
+                elif ptype == PINGREQ:
+                    session.send(packet(PINGRESP, 0))
+                elif ptype == DISCONNECT:
+                    session.will = None
+                    break
+                await writer.drain()
+        except (asyncio.IncompleteReadError, asyncio.CancelledError, ConnectionError,
+                IndexError, struct.error):
+            pass
+        finally:
+            was_online = self.gateway_online()
+            self.sessions.discard(session)
+            self.track_gateway(was_online)
+            if session.will:
+                self.publish(*session.will)
+            writer.close()
+            log(f"client '{session.client_id}' disconnected")
+
+
+# ============================================================================
+# Statistics
+# ============================================================================
+
+def percentile(sorted_ms, pct):
+    # Nearest rank, as cmd_latency.c
+    rank = max((pct * len(sorted_ms) + 99) // 100, 1)
+    return sorted_ms[rank - 1]
+
+
+class PhaseStats:
+    def __init__(self):
+        self.sent = 0
+        self.undelivered = 0
+        self.lost = 0
+        self.samples = []
+        self.started = time.monotonic()
+        self.offline_at_start = 0.0
+
+    def record(self, ms):
+        if ms is None:
+            self.lost += 1
+        else:
+            self.samples.append(ms)
+
+    def to_json(self, offline_s):
+        duration_s = time.monotonic() - self.started
+        result = {
+            'sent': self.sent,
+            'undelivered': self.undelivered,
+            'lost': self.lost,
+            'answered': len(self.samples),
+            'duration_ms': round(duration_s * 1000),
+            'per_sec': round(len(self.samples) / duration_s, 2) if duration_s > 0 else 0,
+            'gateway_offline_ms': round((offline_s - self.offline_at_start) * 1000),
+        }
+        if self.samples:
+            ordered = sorted(self.samples)
+            result.update({
+                'p50_ms': percentile(ordered, 50),
+                'p95_ms': percentile(ordered, 95),
+                'p99_ms': percentile(ordered, 99),
+                'max_ms': ordered[-1],
+            })
+        return result
+
+
+# ============================================================================
+# Bench
+# ============================================================================
+
+class Bench:
+    def __init__(self, args):
+        self.args = args
+        base = args.gateway if '://' in args.gateway else f"http://{args.gateway}"
+        self.base = base.rstrip('/')
+        self.broker = Broker(self.on_publish)
+        self.rng = random.Random(args.seed)
+        self.pending = {}           # 12-digit MAC -> future resolved by its state publish
+        self.next_action = {}
+        self.ota_active = False
+        self.firmware = None
+
+    # ----- Gateway HTTP API ------------------------------------------------
+
+    def http_sync(self, method, path, body, content_type, timeout):
+        request = urllib.request.Request(self.base + path, data=body, method=method)
+        if body is not None:
+            request.add_header('Content-Type', content_type)
+        with urllib.request.urlopen(request, timeout=timeout) as response:
+            return json.loads(response.read() or b'{}')
+
+    async def http(self, method, path, body=None, content_type='application/json', timeout=10):
+        if isinstance(body, dict):
+            body = json.dumps(body).encode()
+        return await asyncio.to_thread(self.http_sync, method, path, body, content_type, timeout)
+
+    async def gateway_report(self):
+        try:
+            report = await self.http('GET', '/api/latency')
+        except (OSError, ValueError) as e:
+            return {'error': str(e)}
+        self.firmware = self.firmware or report.get('firmware')
+        return report
+
+    async def reset_gateway(self):
+        try:
+            await self.http('POST', '/api/latency/reset', {})
+        except (OSError, ValueError) as e:
+            log(f"latency reset failed: {e}")
+
+    async def relay_nodes(self):
+        if self.args.macs:
+            return [m.strip().upper() for m in self.args.macs.split(',') if m.strip()]
+        nodes = (await self.http('GET', '/api/nodes')).get('nodes', [])
+        macs = sorted(n['mac'] for n in nodes
+                      if n.get('online') and n.get('device_type') == DEVICE_TYPE_RELAY)
+        return macs[:self.args.max_nodes] if self.args.max_nodes else macs
+
+    # ----- Commands --------------------------------------------------------
+
+    def on_publish(self, topic, payload):
+        if not topic_matches(TOPIC_NODE_STATE, topic):
+            return
+        future = self.pending.pop(topic.split('/')[3].upper(), None)
+        if future is not None and not future.done():
+            future.set_result(time.monotonic())
+
+    def send(self, stats, mac):
+        """Publish one relay command; None if the gateway was not subscribed"""
+        action = self.next_action.get(mac, 'on')
+        self.next_action[mac] = 'off' if action == 'on' else 'on'
+        payload = json.dumps({'mac': mac, 'channel': self.args.channel, 'action': action}).encode()
+
+        key = mac.replace(':', '')
+        future = asyncio.get_running_loop().create_future()
+        self.pending[key] = future
+        stats.sent += 1
+        sent_at = time.monotonic()
+        if self.broker.publish(TOPIC_CMD_RELAY, payload) == 0:
+            del self.pending[key]
+            stats.undelivered += 1
+            return None
+        return key, sent_at, future
+
+    async def wait(self, stats, command):
+        if command is None:
+            return
+        key, sent_at, future = command
+        try:
+            answered_at = await asyncio.wait_for(future, self.args.timeout_ms / 1000)
+            stats.record(round((answered_at - sent_at) * 1000))
+        except asyncio.TimeoutError:
+            if self.pending.get(key) is future:
+                del self.pending[key]
+            stats.record(None)
+
+    async def singles(self, stats, macs, until=None, count=None):
+        i = 0
+        while count is None or i < count:
+            if until is not None and until():
+                break
+            await self.wait(stats, self.send(stats, macs[i % len(macs)]))
+            await asyncio.sleep(self.args.gap_ms / 1000)
+            i += 1
+
+    def begin(self):
+        stats = PhaseStats()
+        stats.offline_at_start = self.broker.offline_s()
+        return stats
+
+    def end(self, stats, gateway):
+        result = stats.to_json(self.broker.offline_s())
+        result['gateway'] = gateway
+        return result
+
+    # ----- Phases ----------------------------------------------------------
+
+    async def phase_single(self, macs):
+        await self.reset_gateway()
+        stats = self.begin()
+        await self.singles(stats, macs, count=self.args.count)
+        return self.end(stats, await self.gateway_report())
+
+    async def phase_burst(self, macs):
+        await self.reset_gateway()
+        stats = self.begin()
+        size = min(self.args.scene_size, len(macs))
+        for _ in range(self.args.bursts):
+            scene = self.rng.sample(macs, size)
+            commands = [self.send(stats, mac) for mac in scene]
+            await asyncio.gather(*(self.wait(stats, c) for c in commands))
+            await asyncio.sleep(self.args.gap_ms / 1000)
+        result = self.end(stats, await self.gateway_report())
+        result['scene_size'] = size
+        return result
+
+    async def poll_ota(self):
+        while True:
+            try:
+                status = await self.http('GET', '/api/node/ota/status')
+                self.ota_active = status.get('state_desc') in ('starting', 'sending', 'finishing')
+            except (OSError, ValueError):
+                pass
+            await asyncio.sleep(1.0)
+
+    async def phase_ota(self, macs):
+        if not self.args.ota_image:
+            return {'skipped': 'no --ota-image given'}
+        target = (self.args.ota_mac or macs[-1]).upper()
+        commanded = [m for m in macs if m != target]
+        if not commanded:
+            return {'skipped': 'no node left to command besides the OTA target'}
+
+        with open(self.args.ota_image, 'rb') as f:
+            image = f.read()
+        log(f"uploading {len(image)} bytes for {target}")
+        try:
+            await self.http('POST', '/api/node/ota?mac=' + urllib.parse.quote(target), image,
+                            'application/octet-stream', timeout=600)
+        except (OSError, ValueError) as e:
+            return {'skipped': f"OTA upload failed: {e}"}
+
+        poller = asyncio.create_task(self.poll_ota())
+        try:
+            deadline = time.monotonic() + 30
+            while not self.ota_active and time.monotonic() < deadline:
+                await asyncio.sleep(0.2)
+            if not self.ota_active:
+                return {'skipped': 'OTA transfer did not start', 'target': target}
+
+            await self.reset_gateway()
+            stats = self.begin()
+            await self.singles(stats, commanded, until=lambda: not self.ota_active,
+                               count=self.args.count)
+            result = self.end(stats, await self.gateway_report())
+            result['target'] = target
+            result['ota_still_active'] = self.ota_active
+        finally:
+            poller.cancel()
+
+        if result['ota_still_active'] and not self.args.ota_finish:
+            log("aborting the node OTA")
+            try:
+                await self.http('POST', '/api/node/ota/abort', {})
+            except (OSError, ValueError) as e:
+                log(f"OTA abort failed: {e}")
+        return result
+
+    async def phase_scan(self, macs):
+        await self.reset_gateway()
+        stats = self.begin()
+        self.broker.publish(TOPIC_SCAN, b'{"action":"start"}')
+        scan_end = time.monotonic() + self.args.scan_window_s
+        await self.singles(stats, macs, until=lambda: time.monotonic() > scan_end)
+
+        log("waiting for the gateway to come back after the scan")
+        back = await self.broker.wait_gateway(self.args.connect_timeout_s)
+        result = self.end(stats, await self.gateway_report())
+        result['gateway_back'] = back
+        return result
+
+    # ----- Run -------------------------------------------------------------
+
+    async def run(self):
+        host, _, port = self.args.listen.rpartition(':')
+        await self.broker.start(host or '0.0.0.0', int(port))
+        try:
+            return await self.measure()
+        finally:
+            self.broker.stop()
+
+    async def measure(self):
+        log(f"broker listening on {self.args.listen}, waiting for the gateway")
+        if not await self.broker.wait_gateway(self.args.connect_timeout_s):
+            raise SystemExit("gateway did not subscribe to the command topics in time "
+                             "(is its broker_uri set to this machine?)")
+
+        macs = await self.relay_nodes()
+        if not macs:
+            raise SystemExit("no online relay node to command")
+        log(f"{len(macs)} relay nodes")
+
+        report = {
+            'report_version': REPORT_VERSION,
+            'started': datetime.now(timezone.utc).isoformat(timespec='seconds'),
+            'gateway': self.base,
+            'firmware': None,
+            'settings': {
+                'seed': self.args.seed,
+                'count': self.args.count,
+                'bursts': self.args.bursts,
+                'scene_size': self.args.scene_size,
+                'gap_ms': self.args.gap_ms,
+                'timeout_ms': self.args.timeout_ms,
+            },
+            'nodes': macs,
+            'phases': {},
+        }
+        for name in self.args.phases:
+            log(f"phase {name}")
+            report['phases'][name] = await getattr(self, f"phase_{name}")(macs)
+        report['firmware'] = self.firmware
+        return report
+
+
+# ============================================================================
+# Baseline Comparison
+# ============================================================================
+
+def compare(report, baseline, tolerance_pct, tolerance_ms):
+    """Return one line per phase metric that got worse than the baseline allows"""
+    regressions = []
+    for name, phase in report['phases'].items():
+        old = baseline.get('phases', {}).get(name, {})
+        for key in ('p95_ms', 'p99_ms'):
+            if key in phase and key in old:
+                limit = max(old[key] * (1 + tolerance_pct / 100), old[key] + tolerance_ms)
+                if phase[key] > limit:
+                    regressions.append(f"{name} {key}: {old[key]} -> {phase[key]}")
+        if phase.get('sent') and old.get('sent'):
+            # Undelivered counts too: a command the gateway never saw is lost to the user
+            old_loss = (old['lost'] + old['undelivered']) / old['sent']
+            new_loss = (phase['lost'] + phase['undelivered']) / phase['sent']
+            if new_loss > old_loss + tolerance_pct / 100:
+                regressions.append(f"{name} unanswered: {old_loss:.0%} -> {new_loss:.0%}")
+    return regressions
+
+
+def phase_list(text):
+    phases = [p.strip() for p in text.split(',') if p.strip()]
+    unknown = [p for p in phases if p not in PHASES]
+    if unknown:
+        raise argparse.ArgumentTypeError(f"unknown phase(s): {', '.join(unknown)}")
+    return phases
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the gateway's MQTT command latency")
+    parser.add_argument('--gateway', required=True, help="gateway address for the HTTP API")
+    parser.add_argument('--listen', default='0.0.0.0:1883', help="broker address (default %(default)s)")
+    parser.add_argument('--phases', type=phase_list, default=PHASES,
+                        help="comma separated, from " + ','.join(PHASES))
+    parser.add_argument('--macs', help="relay nodes to command (default: all online relays)")
+    parser.add_argument('--max-nodes', type=int, default=0, help="use at most this many nodes")
+    parser.add_argument('--channel', type=int, default=0, help="relay channel (default 0)")
+    parser.add_argument('--count', type=int, default=50, help="commands per single phase (default 50)")
+    parser.add_argument('--bursts', type=int, default=10, help="scenes in the burst phase (default 10)")
+    parser.add_argument('--scene-size', type=int, default=8, help="nodes per scene (default 8)")
+    parser.add_argument('--gap-ms', type=int, default=200, help="pause between commands (default 200)")
+    parser.add_argument('--timeout-ms', type=int, default=CMD_LATENCY_TIMEOUT_MS,
+                        help="no state after this = lost (default %(default)s, as the firmware)")
+    parser.add_argument('--seed', type=int, default=1, help="scene selection seed (default 1)")
+    parser.add_argument('--ota-image', help="node firmware for the ota phase")
+    parser.add_argument('--ota-mac', help="OTA target (default: last relay node)")
+    parser.add_argument('--ota-finish', action='store_true', help="let the OTA complete afterwards")
+    parser.add_argument('--scan-window-s', type=int, default=30,
+                        help="how long to send commands after starting the scan (default 30)")
+    parser.add_argument('--connect-timeout-s', type=int, default=120,
+                        help="wait for the gateway to subscribe (default 120)")
+    parser.add_argument('--baseline', help="earlier report to check for regressions")
+    parser.add_argument('--tolerance-pct', type=float, default=20,
+                        help="allowed p95/p99 increase, and unanswered increase in points (default 20)")
+    parser.add_argument('--tolerance-ms', type=int, default=20,
+                        help="latency increases below this never count (default 20)")
+    parser.add_argument('-o', '--output', help="write the report here instead of stdout")
+    args = parser.parse_args()
+
+    try:
+        report = asyncio.run(Bench(args).run())
+    except KeyboardInterrupt:
+        return 130
+
+    text = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print(text)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(report, json.load(f), args.tolerance_pct, args.tolerance_ms)
+        for line in regressions:
+            print(f"REGRESSION {line}", file=sys.stderr)
+        if regressions:
+            return 2
+        print(f"no regression against {args.baseline}", file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,155 @@
+/**
+ * OmniaPi LED Script Host Build - Per-Pixel Throughput Benchmark
+ *
+ * Renders the built-in C effects and the equivalent bytecode programs
+ * (compiled with tools/led_script/ledsc.py) through effects_render(), the
+ * path the strip's render task takes, and reports ns per pixel for each
+ * pair plus the VM's slowdown. Absolute numbers are the host's; the
+ * ratio is what carries over to the ESP32-C3.
+ *
+ *   led_script_bench [--leds N] [--frames N] > bench.json
+ */
+
+#include "led_effects.h"
+#include "led_palette.h"
+#include "led_script.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_LEDS    300     // LED_STRIP_MAX_LEDS
+#define DEFAULT_FRAMES  20000
+
+typedef struct {
+    const char *name;
+    effect_type_t builtin;          // EFFECT_TYPE_MAX = script only
+    const char *source;             // Script, for the report
+    const uint8_t *code;
+    size_t code_len;
+} bench_case_t;
+
+// ledsc.py output for the sources below
+static const uint8_t s_rainbow[] = {
+    0x01, 0x03, 0x0F, 0x0A, 0x1D, 0x00, 0x0B, 0x09, 0x00, 0x01, 0x22, 0x0C,
+    0x23, 0x1C, 0x00, 0x20, 0x08, 0xFF, 0x08, 0xFF, 0x39,
+};
+static const uint8_t s_breathing[] = {
+    0x01, 0x11, 0x00, 0x0A, 0x33, 0x1D, 0x00, 0x0D, 0x1C, 0x00, 0x31, 0x0E,
+    0x1C, 0x00, 0x31, 0x0F, 0x1C, 0x00, 0x31, 0x38,
+};
+static const uint8_t s_palette[] = {
+    0x01, 0x00, 0x0A, 0x0B, 0x09, 0x00, 0x01, 0x22, 0x0C, 0x23, 0x0A, 0x20, 0x3A,
+};
+static const uint8_t s_noise[] = {
+    0x01, 0x00, 0x16, 0x0B, 0x08, 0x40, 0x22, 0x0A, 0x08, 0x08, 0x22, 0x20,
+    0x34, 0x1D, 0x00, 0x1C, 0x00, 0x1C, 0x00, 0x08, 0x03, 0x23, 0x08, 0x00,
+    0x38,
+};
+
+static const bench_case_t s_cases[] = {
+    { "rainbow", EFFECT_TYPE_RAINBOW,
+      "frame { phase = time } pixel { hsv(index * 256 / count + phase, 255, 255) }",
+      s_rainbow, sizeof(s_rainbow) },
+    { "breathing", EFFECT_TYPE_BREATHING,
+      "frame { v = tri8(time); rgb(scale8(r, v), scale8(g, v), scale8(b, v)) }",
+      s_breathing, sizeof(s_breathing) },
+    { "palette", EFFECT_TYPE_CUSTOM,
+      "pixel { pal(index * 256 / count + time) }",
+      s_palette, sizeof(s_palette) },
+    { "noise", EFFECT_TYPE_MAX,
+      "pixel { v = noise8(index * 64 + time * 8); rgb(v, v / 3, 0) }",
+      s_noise, sizeof(s_noise) },
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * ns per pixel rendering frames of the context
+ */
+static double run(effect_ctx_t *ctx, uint8_t *rgb, uint16_t leds, int frames)
+{
+    effects_reset(ctx);
+    for (int i = 0; i < frames / 10; i++) {     // Warm up caches and tables
+        effects_render(ctx, rgb, leds);
+    }
+
+    double start = now_ns();
+    for (int i = 0; i < frames; i++) {
+        effects_render(ctx, rgb, leds);
+    }
+    return (now_ns() - start) / ((double)frames * leds);
+}
+
+int main(int argc, char **argv)
+{
+    int leds = DEFAULT_LEDS;
+    int frames = DEFAULT_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--leds") == 0 && i + 1 < argc) {
+            leds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--leds N] [--frames N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (leds < 1 || leds > 1000 || frames < 1) {
+        fprintf(stderr, "--leds 1-1000, --frames > 0\n");
+        return 2;
+    }
+
+    static const uint8_t pal[] = { 3, 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+    static led_palette_lut_t lut;
+    led_palette_build_lut(pal, sizeof(pal), &lut);
+
+    uint8_t *rgb = malloc(leds * 3);
+    static led_script_t script;
+    int n_cases = sizeof(s_cases) / sizeof(s_cases[0]);
+
+    printf("{\n  \"leds\": %d,\n  \"frames\": %d,\n  \"effects\": [\n", leds, frames);
+    for (int c = 0; c < n_cases; c++) {
+        const bench_case_t *bc = &s_cases[c];
+
+        if (led_script_load(&script, bc->code, bc->code_len) != ESP_OK ||
+            led_script_check_budget(bc->code, bc->code_len, leds) != ESP_OK) {
+            fprintf(stderr, "%s: program refused for %d LEDs\n", bc->name, leds);
+            return 1;
+        }
+
+        effect_ctx_t ctx;
+        effects_ctx_init(&ctx);
+        ctx.r = 255;
+        ctx.g = 120;
+        ctx.b = 40;
+        ctx.palette = &lut;
+        ctx.script = &script;
+
+        ctx.type = EFFECT_TYPE_SCRIPT;
+        double vm_ns = run(&ctx, rgb, leds, frames);
+        uint32_t instr = script.max_frame_instr;
+
+        printf("    {\n      \"name\": \"%s\",\n      \"script\": \"%s\",\n", bc->name, bc->source);
+        printf("      \"instructions_per_frame\": %lu,\n", (unsigned long)instr);
+        printf("      \"vm_ns_per_pixel\": %.2f,\n", vm_ns);
+        if (bc->builtin != EFFECT_TYPE_MAX) {
+            ctx.type = bc->builtin;
+            double c_ns = run(&ctx, rgb, leds, frames);
+            printf("      \"builtin_ns_per_pixel\": %.2f,\n", c_ns);
+            printf("      \"vm_slowdown\": %.1f,\n", vm_ns / c_ns);
+        }
+        printf("      \"vm_frame_us\": %.1f\n    }%s\n", vm_ns * leds / 1000.0,
+               c + 1 < n_cases ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    free(rgb);
+    return 0;
+}
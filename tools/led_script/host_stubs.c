@@ -0,0 +1,149 @@
+/**
+ * OmniaPi LED Script Host Build - ESP-IDF Stand-ins
+ *
+ * Logging to stderr, a seeded esp_random() so runs repeat, and an NVS
+ * that keeps blobs in memory for the bank functions.
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "nvs.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Errors and Logging
+// ============================================================================
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                return "ESP_OK";
+        case ESP_FAIL:              return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default:                    return "UNKNOWN_ERROR";
+    }
+}
+
+static bool s_quiet = false;
+
+void host_log_quiet(bool quiet)
+{
+    s_quiet = quiet;
+}
+
+void host_log_write(char level, const char *tag, const char *format, ...)
+{
+    if (s_quiet) return;
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", level, tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+// ============================================================================
+// Random
+// ============================================================================
+
+static uint32_t s_random = 0x2545F491;
+
+uint32_t esp_random(void)
+{
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
+
+// ============================================================================
+// NVS (blobs in memory, one handle per namespace)
+// ============================================================================
+
+#define NVS_MAX_NAMESPACES  4
+
+typedef struct blob {
+    struct blob *next;
+    nvs_handle_t ns;
+    char key[16];
+    size_t len;
+    uint8_t data[];
+} blob_t;
+
+static char s_namespaces[NVS_MAX_NAMESPACES][16];
+static blob_t *s_blobs = NULL;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out_handle)
+{
+    for (int i = 0; i < NVS_MAX_NAMESPACES; i++) {
+        if (s_namespaces[i][0] == '\0') {
+            if (mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+            snprintf(s_namespaces[i], sizeof(s_namespaces[i]), "%s", name);
+        }
+        if (strncmp(s_namespaces[i], name, sizeof(s_namespaces[i])) == 0) {
+            *out_handle = (nvs_handle_t)i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static blob_t **blob_find(nvs_handle_t handle, const char *key)
+{
+    blob_t **link = &s_blobs;
+    while (*link != NULL &&
+           ((*link)->ns != handle || strncmp((*link)->key, key, sizeof((*link)->key)) != 0)) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    blob_t **link = blob_find(handle, key);
+    if (*link != NULL) {
+        blob_t *old = *link;
+        *link = old->next;
+        free(old);
+    }
+
+    blob_t *blob = malloc(sizeof(blob_t) + length);
+    if (blob == NULL) return ESP_ERR_NO_MEM;
+    blob->ns = handle;
+    snprintf(blob->key, sizeof(blob->key), "%s", key);
+    blob->len = length;
+    memcpy(blob->data, value, length);
+    blob->next = s_blobs;
+    s_blobs = blob;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    blob_t *blob = *blob_find(handle, key);
+    if (blob == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (*length < blob->len) return ESP_ERR_INVALID_SIZE;
+    memcpy(out_value, blob->data, blob->len);
+    *length = blob->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
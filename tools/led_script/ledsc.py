@@ -0,0 +1,563 @@
+#!/usr/bin/env python3
+"""
+OmniaPi LED Script Compiler
+
+Compiles a small expression language to the LED effect bytecode run by
+shared/components/led_render (see include/led_script.h), so effects no
+longer have to be hand-assembled as hex.
+
+    # Rainbow that scrolls with the speed setting
+    frame {
+        phase = time * speed / 16
+    }
+    pixel {
+        hsv(index * 256 / count + phase, 255, 255)
+    }
+
+Language:
+  Sections   frame { ... } runs once per frame, pixel { ... } once per LED.
+             Without a pixel section the frame's output fills the strip.
+  Statements name = expr        variable (at most 8, shared by both sections,
+                                kept between frames, start at 0)
+             rgb(r, g, b)       set the output color (0-255 each)
+             hsv(h, s, v)       hue 0-255
+             pal(x)             palette lookup, 0-255
+             if expr { ... } [else { ... }]   (else if works too)
+             stop               end the section here
+  Inputs     time index count r g b speed   (r g b = base color)
+  Functions  sin8(x) tri8(x) noise8(x) rand8() clamp8(x) scale8(a, b)
+             min(a, b) max(a, b)
+  Operators  C precedence: * / %  + -  << >>  < <= > >=  == !=  &  ^  |
+             unary - and !  (comparisons and ! give 0 or 1)
+  Numbers    32-bit signed integers, decimal or 0x hex; constant
+             expressions are folded at compile time
+  Comments   # to end of line; statements may be separated by ; or newlines
+
+Usage:
+  ledsc.py effect.led                     print the program as hex
+  ledsc.py effect.led --leds 300          also check the frame budget
+  ledsc.py effect.led --mac AA:BB:... --id 1
+                                          print a POST /api/command body
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# ============================================================================
+# Format (must match led_script.h)
+# ============================================================================
+VERSION = 1
+MAX_CODE = 160
+STACK_DEPTH = 16
+VARS = 8
+FRAME_BUDGET = 16384
+BANK_SIZE = 4
+
+OP = {
+    'END': 0x00, 'JMP': 0x01, 'JZ': 0x02,
+    'PUSH8': 0x08, 'PUSH16': 0x09, 'TIME': 0x0A, 'INDEX': 0x0B, 'COUNT': 0x0C,
+    'COLOR_R': 0x0D, 'COLOR_G': 0x0E, 'COLOR_B': 0x0F, 'SPEED': 0x10,
+    'DUP': 0x18, 'DROP': 0x19, 'SWAP': 0x1A, 'OVER': 0x1B, 'LOAD': 0x1C, 'STORE': 0x1D,
+    'ADD': 0x20, 'SUB': 0x21, 'MUL': 0x22, 'DIV': 0x23, 'MOD': 0x24,
+    'AND': 0x25, 'OR': 0x26, 'XOR': 0x27, 'SHL': 0x28, 'SHR': 0x29,
+    'MIN': 0x2A, 'MAX': 0x2B, 'LT': 0x2C, 'NEG': 0x2D,
+    'CLAMP8': 0x30, 'SCALE8': 0x31, 'SIN8': 0x32, 'TRI8': 0x33,
+    'NOISE8': 0x34, 'RAND8': 0x35,
+    'OUT_RGB': 0x38, 'OUT_HSV': 0x39, 'OUT_PAL': 0x3A,
+}
+
+INPUTS = {
+    'time': 'TIME', 'index': 'INDEX', 'count': 'COUNT',
+    'r': 'COLOR_R', 'g': 'COLOR_G', 'b': 'COLOR_B', 'speed': 'SPEED',
+}
+
+# name: (opcode, arguments)
+FUNCTIONS = {
+    'sin8': ('SIN8', 1), 'tri8': ('TRI8', 1), 'noise8': ('NOISE8', 1),
+    'rand8': ('RAND8', 0), 'clamp8': ('CLAMP8', 1), 'scale8': ('SCALE8', 2),
+    'min': ('MIN', 2), 'max': ('MAX', 2),
+}
+
+OUTPUTS = {'rgb': ('OUT_RGB', 3), 'hsv': ('OUT_HSV', 3), 'pal': ('OUT_PAL', 1)}
+
+KEYWORDS = {'frame', 'pixel', 'if', 'else', 'stop'} | set(INPUTS) | set(FUNCTIONS) | set(OUTPUTS)
+
+# Binary operators by precedence, loosest first
+BINARY_LEVELS = [
+    ['|'], ['^'], ['&'], ['==', '!='], ['<', '<=', '>', '>='], ['<<', '>>'],
+    ['+', '-'], ['*', '/', '%'],
+]
+
+SIMPLE_BINARY = {
+    '+': 'ADD', '-': 'SUB', '*': 'MUL', '/': 'DIV', '%': 'MOD',
+    '&': 'AND', '|': 'OR', '^': 'XOR', '<<': 'SHL', '>>': 'SHR',
+}
+
+
+class CompileError(Exception):
+    def __init__(self, line, msg):
+        super().__init__(f"line {line}: {msg}")
+
+
+# ============================================================================
+# Lexer
+# ============================================================================
+TOKEN_RE = re.compile(r"""
+    (?P<space>[ \t\r]+) |
+    (?P<newline>\n) |
+    (?P<comment>\#[^\n]*) |
+    (?P<number>0[xX][0-9a-fA-F]+|\d+) |
+    (?P<name>[A-Za-z_][A-Za-z0-9_]*) |
+    (?P<op><<|>>|<=|>=|==|!=|[-+*/%&|^<>!=(){},;])
+""", re.VERBOSE)
+
+
+def tokenize(text):
+    tokens = []
+    line = 1
+    pos = 0
+    while pos < len(text):
+        m = TOKEN_RE.match(text, pos)
+        if m is None:
+            raise CompileError(line, f"unexpected character {text[pos]!r}")
+        kind = m.lastgroup
+        value = m.group()
+        pos = m.end()
+        if kind == 'newline':
+            line += 1
+        elif kind == 'number':
+            tokens.append(('number', int(value, 0), line))
+        elif kind in ('name', 'op'):
+            tokens.append((kind, value, line))
+    tokens.append(('eof', None, line))
+    return tokens
+
+
+# ============================================================================
+# Parser (AST as tuples)
+# ============================================================================
+class Parser:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.pos = 0
+
+    def peek(self):
+        return self.tokens[self.pos]
+
+    def line(self):
+        return self.peek()[2]
+
+    def next(self):
+        tok = self.tokens[self.pos]
+        self.pos += 1
+        return tok
+
+    def accept(self, value):
+        if self.peek()[1] == value and self.peek()[0] in ('op', 'name'):
+            self.pos += 1
+            return True
+        return False
+
+    def expect(self, value):
+        if not self.accept(value):
+            found = self.peek()[1] if self.peek()[0] != 'eof' else 'end of file'
+            raise CompileError(self.line(), f"expected {value!r}, found {found!r}")
+
+    def program(self):
+        sections = {}
+        while self.peek()[0] != 'eof':
+            line = self.line()
+            kind, name, _ = self.next()
+            if name not in ('frame', 'pixel'):
+                raise CompileError(line, "expected 'frame' or 'pixel' section")
+            if name in sections:
+                raise CompileError(line, f"second {name} section")
+            sections[name] = self.block()
+        if not sections:
+            raise CompileError(1, "no frame or pixel section")
+        return sections
+
+    def block(self):
+        self.expect('{')
+        stmts = []
+        while not self.accept('}'):
+            if self.peek()[0] == 'eof':
+                raise CompileError(self.line(), "missing '}'")
+            if self.accept(';'):
+                continue
+            stmts.append(self.statement())
+        return stmts
+
+    def statement(self):
+        line = self.line()
+        kind, name, _ = self.next()
+        if kind != 'name':
+            raise CompileError(line, f"expected a statement, found {name!r}")
+
+        if name == 'if':
+            cond = self.expr()
+            then = self.block()
+            other = []
+            if self.accept('else'):
+                if self.peek()[1] == 'if':
+                    other = [self.statement()]
+                else:
+                    other = self.block()
+            return ('if', line, cond, then, other)
+        if name == 'stop':
+            return ('stop', line)
+        if name in OUTPUTS:
+            op, argc = OUTPUTS[name]
+            return ('out', line, op, self.arguments(name, argc))
+        if name in KEYWORDS:
+            raise CompileError(line, f"cannot assign to {name!r}")
+        self.expect('=')
+        return ('store', line, name, self.expr())
+
+    def arguments(self, name, argc):
+        line = self.line()
+        self.expect('(')
+        args = []
+        if not self.accept(')'):
+            args.append(self.expr())
+            while self.accept(','):
+                args.append(self.expr())
+            self.expect(')')
+        if len(args) != argc:
+            raise CompileError(line, f"{name}() takes {argc} argument(s), got {len(args)}")
+        return args
+
+    def expr(self, level=0):
+        if level == len(BINARY_LEVELS):
+            return self.unary()
+        left = self.expr(level + 1)
+        while self.peek()[0] == 'op' and self.peek()[1] in BINARY_LEVELS[level]:
+            line = self.line()
+            op = self.next()[1]
+            left = ('bin', line, op, left, self.expr(level + 1))
+        return left
+
+    def unary(self):
+        line = self.line()
+        if self.accept('-'):
+            return ('neg', line, self.unary())
+        if self.accept('!'):
+            return ('not', line, self.unary())
+        return self.primary()
+
+    def primary(self):
+        line = self.line()
+        kind, value, _ = self.next()
+        if kind == 'number':
+            return ('num', line, value)
+        if kind == 'op' and value == '(':
+            e = self.expr()
+            self.expect(')')
+            return e
+        if kind == 'name':
+            if value in INPUTS:
+                return ('input', line, INPUTS[value])
+            if value in FUNCTIONS:
+                op, argc = FUNCTIONS[value]
+                return ('call', line, op, self.arguments(value, argc))
+            if value in KEYWORDS:
+                raise CompileError(line, f"{value!r} is not a value")
+            return ('load', line, value)
+        raise CompileError(line, f"expected a value, found {value!r}")
+
+
+# ============================================================================
+# Constant Folding (32-bit wrapping, same results as the VM)
+# ============================================================================
+def wrap32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def div32(a, b):
+    if b == 0:
+        return 0
+    q = abs(a) // abs(b)
+    return wrap32(q if (a < 0) == (b < 0) else -q)
+
+
+def mod32(a, b):
+    if b in (0, -1):
+        return 0
+    return wrap32(a - div32(a, b) * b)
+
+
+def fold(node):
+    kind = node[0]
+    if kind == 'neg':
+        inner = fold(node[2])
+        if inner[0] == 'num':
+            return ('num', node[1], wrap32(-inner[2]))
+        return ('neg', node[1], inner)
+    if kind == 'not':
+        inner = fold(node[2])
+        if inner[0] == 'num':
+            return ('num', node[1], int(inner[2] == 0))
+        return ('not', node[1], inner)
+    if kind == 'bin':
+        _, line, op, left, right = node
+        left, right = fold(left), fold(right)
+        if left[0] == 'num' and right[0] == 'num':
+            a, b = left[2], right[2]
+            value = {
+                '+': lambda: a + b, '-': lambda: a - b, '*': lambda: a * b,
+                '/': lambda: div32(a, b), '%': lambda: mod32(a, b),
+                '&': lambda: a & b, '|': lambda: a | b, '^': lambda: a ^ b,
+                '<<': lambda: a << (b & 31), '>>': lambda: a >> (b & 31),
+                '<': lambda: int(a < b), '<=': lambda: int(a <= b),
+                '>': lambda: int(a > b), '>=': lambda: int(a >= b),
+                '==': lambda: int(a == b), '!=': lambda: int(a != b),
+            }[op]()
+            return ('num', line, wrap32(value))
+        return ('bin', line, op, left, right)
+    if kind == 'call':
+        return ('call', node[1], node[2], [fold(a) for a in node[3]])
+    return node
+
+
+# ============================================================================
+# Code Generation
+# ============================================================================
+class Section:
+    def __init__(self, variables):
+        self.code = []
+        self.depth = 0
+        self.max_depth = 0
+        self.variables = variables
+
+    def emit(self, line, op, *imm, pops=0, pushes=0):
+        if self.depth < pops:
+            raise CompileError(line, "internal error: stack underflow")
+        self.depth += pushes - pops
+        if self.depth > STACK_DEPTH:
+            raise CompileError(line, f"expression too deep (VM stack is {STACK_DEPTH})")
+        self.max_depth = max(self.max_depth, self.depth)
+        self.code.append(OP[op])
+        self.code.extend(imm)
+
+    def push(self, line, value):
+        if 0 <= value <= 0xFF:
+            self.emit(line, 'PUSH8', value, pushes=1)
+        elif -0x8000 <= value <= 0x7FFF:
+            self.emit(line, 'PUSH16', value & 0xFF, (value >> 8) & 0xFF, pushes=1)
+        else:
+            # (high << 16) + low, with low in PUSH16's signed range
+            high, low = value >> 16, value & 0xFFFF
+            if low > 0x7FFF:
+                high, low = high + 1, low - 0x10000
+            self.push(line, high)
+            self.push(line, 16)
+            self.emit(line, 'SHL', pops=2, pushes=1)
+            if low != 0:
+                self.push(line, low)
+                self.emit(line, 'ADD', pops=2, pushes=1)
+
+    def nonzero(self, line):
+        # x != 0  ->  ((x | -x) >> 31) & 1, exact for every 32-bit x
+        self.emit(line, 'DUP', pops=1, pushes=2)
+        self.emit(line, 'NEG', pops=1, pushes=1)
+        self.emit(line, 'OR', pops=2, pushes=1)
+        self.push(line, 31)
+        self.emit(line, 'SHR', pops=2, pushes=1)
+        self.push(line, 1)
+        self.emit(line, 'AND', pops=2, pushes=1)
+
+    def invert(self, line):
+        # 0/1 -> 1/0
+        self.push(line, 1)
+        self.emit(line, 'XOR', pops=2, pushes=1)
+
+    def expr(self, node):
+        kind, line = node[0], node[1]
+        if kind == 'num':
+            self.push(line, node[2])
+        elif kind == 'input':
+            self.emit(line, node[2], pushes=1)
+        elif kind == 'load':
+            name = node[2]
+            if name not in self.variables:
+                raise CompileError(line, f"unknown name {name!r} (never assigned)")
+            self.emit(line, 'LOAD', self.variables[name], pushes=1)
+        elif kind == 'neg':
+            self.expr(node[2])
+            self.emit(line, 'NEG', pops=1, pushes=1)
+        elif kind == 'not':
+            self.expr(node[2])
+            self.nonzero(line)
+            self.invert(line)
+        elif kind == 'call':
+            for arg in node[3]:
+                self.expr(arg)
+            self.emit(line, node[2], pops=len(node[3]), pushes=1)
+        elif kind == 'bin':
+            _, _, op, left, right = node
+            self.expr(left)
+            self.expr(right)
+            if op in SIMPLE_BINARY:
+                self.emit(line, SIMPLE_BINARY[op], pops=2, pushes=1)
+            elif op == '<':
+                self.emit(line, 'LT', pops=2, pushes=1)
+            elif op == '>':
+                self.emit(line, 'SWAP', pops=2, pushes=2)
+                self.emit(line, 'LT', pops=2, pushes=1)
+            elif op == '>=':
+                self.emit(line, 'LT', pops=2, pushes=1)
+                self.invert(line)
+            elif op == '<=':
+                self.emit(line, 'SWAP', pops=2, pushes=2)
+                self.emit(line, 'LT', pops=2, pushes=1)
+                self.invert(line)
+            elif op in ('==', '!='):
+                self.emit(line, 'XOR', pops=2, pushes=1)
+                self.nonzero(line)
+                if op == '==':
+                    self.invert(line)
+        else:
+            raise CompileError(line, f"internal error: {kind}")
+
+    def jump(self, line, op, pops):
+        # Placeholder, patched once the target is known
+        self.emit(line, op, 0, pops=pops)
+        return len(self.code) - 1
+
+    def patch(self, line, at):
+        offset = len(self.code) - (at + 1)
+        if offset > 0xFF:
+            raise CompileError(line, "if/else body too long for a jump (255 bytes)")
+        self.code[at] = offset
+
+    def statements(self, stmts):
+        for stmt in stmts:
+            kind, line = stmt[0], stmt[1]
+            if kind == 'store':
+                self.expr(fold(stmt[3]))
+                self.emit(line, 'STORE', self.variables[stmt[2]], pops=1)
+            elif kind == 'out':
+                for arg in stmt[3]:
+                    self.expr(fold(arg))
+                self.emit(line, stmt[2], pops=len(stmt[3]))
+            elif kind == 'stop':
+                self.emit(line, 'END')
+            elif kind == 'if':
+                _, _, cond, then, other = stmt
+                cond = fold(cond)
+                if cond[0] == 'num':
+                    # Known at compile time, only one branch is kept
+                    self.statements(then if cond[2] != 0 else other)
+                    continue
+                self.expr(cond)
+                skip_then = self.jump(line, 'JZ', pops=1)
+                self.statements(then)
+                if other:
+                    skip_else = self.jump(line, 'JMP', pops=0)
+                    self.patch(line, skip_then)
+                    self.statements(other)
+                    self.patch(line, skip_else)
+                else:
+                    self.patch(line, skip_then)
+
+
+def collect_variables(stmts, variables):
+    for stmt in stmts:
+        if stmt[0] == 'store' and stmt[2] not in variables:
+            if len(variables) == VARS:
+                raise CompileError(stmt[1], f"more than {VARS} variables")
+            variables[stmt[2]] = len(variables)
+        elif stmt[0] == 'if':
+            collect_variables(stmt[3], variables)
+            collect_variables(stmt[4], variables)
+
+
+def count_instructions(code):
+    """Instructions in a section: the most one run can execute"""
+    imm = {OP['JMP']: 1, OP['JZ']: 1, OP['PUSH8']: 1, OP['LOAD']: 1, OP['STORE']: 1,
+           OP['PUSH16']: 2}
+    count = 0
+    pc = 0
+    while pc < len(code):
+        pc += 1 + imm.get(code[pc], 0)
+        count += 1
+    return count
+
+
+def compile_source(text):
+    """
+    Compile a program
+    @return (encoded bytes, frame instructions, pixel instructions, variables)
+    """
+    sections = Parser(tokenize(text)).program()
+
+    variables = {}
+    for name in ('frame', 'pixel'):
+        collect_variables(sections.get(name, []), variables)
+
+    code = {}
+    for name in ('frame', 'pixel'):
+        section = Section(variables)
+        section.statements(sections.get(name, []))
+        code[name] = bytes(section.code)
+
+    frame, pixel = code['frame'], code['pixel']
+    if not frame and not pixel:
+        raise CompileError(1, "program is empty")
+    if len(frame) + len(pixel) > MAX_CODE:
+        raise CompileError(1, f"program is {len(frame) + len(pixel)} bytes, max {MAX_CODE}")
+
+    encoded = bytes([VERSION, len(frame), len(pixel)]) + frame + pixel
+    return encoded, count_instructions(frame), count_instructions(pixel), variables
+
+
+# ============================================================================
+# Main
+# ============================================================================
+def main():
+    parser = argparse.ArgumentParser(description="Compile an LED effect script to bytecode")
+    parser.add_argument('source', help="script file ('-' for stdin)")
+    parser.add_argument('--leds', type=int,
+                        help="check the frame budget for this many LEDs (as the strip does)")
+    parser.add_argument('--mac', help="print a POST /api/command body for this node")
+    parser.add_argument('--id', type=int, default=0, help="bank slot (0-3, default 0)")
+    parser.add_argument('--no-store', action='store_true', help="run it without saving it")
+    args = parser.parse_args()
+
+    text = sys.stdin.read() if args.source == '-' else open(args.source).read()
+    try:
+        encoded, frame_instr, pixel_instr, variables = compile_source(text)
+    except CompileError as e:
+        print(f"{args.source}: {e}", file=sys.stderr)
+        return 1
+
+    print(f"{len(encoded)} bytes, frame {frame_instr} + pixel {pixel_instr} instructions, "
+          f"{len(variables)} variables", file=sys.stderr)
+
+    if args.leds is not None:
+        worst = frame_instr + pixel_instr * args.leds
+        print(f"worst case {worst} of {FRAME_BUDGET} instructions per frame on "
+              f"{args.leds} LEDs", file=sys.stderr)
+        if worst > FRAME_BUDGET:
+            print(f"{args.source}: too slow for {args.leds} LEDs, the strip would refuse it",
+                  file=sys.stderr)
+            return 1
+
+    if args.mac:
+        if not 0 <= args.id < BANK_SIZE:
+            print(f"--id must be 0-{BANK_SIZE - 1}", file=sys.stderr)
+            return 1
+        body = {'mac': args.mac, 'cmd': 'led_script', 'id': args.id, 'code': encoded.hex()}
+        if args.no_store:
+            body['store'] = False
+        print(json.dumps(body))
+    else:
+        print(encoded.hex())
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
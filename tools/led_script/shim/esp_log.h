@@ -0,0 +1,22 @@
+/**
+ * OmniaPi LED Script Host Build - esp_log.h shim
+ *
+ * Warnings and errors go to stderr (silenced with host_log_quiet), the
+ * rest is dropped.
+ */
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdbool.h>
+
+void host_log_write(char level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+void host_log_quiet(bool quiet);
+
+#define ESP_LOGE(tag, format, ...) host_log_write('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) host_log_write('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do { } while (0)
+#define ESP_LOGD(tag, format, ...) do { } while (0)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,12 @@
+/**
+ * OmniaPi LED Script Host Build - esp_random.h shim
+ */
+
+#ifndef ESP_RANDOM_H
+#define ESP_RANDOM_H
+
+#include <stdint.h>
+
+uint32_t esp_random(void);
+
+#endif // ESP_RANDOM_H
@@ -0,0 +1,429 @@
+/**
+ * OmniaPi LED Script Host Build - Validator and VM Tests
+ *
+ * Built with AddressSanitizer by default (see CMakeLists.txt), so a
+ * program that reaches outside its section or the variables fails the
+ * run even when the result looks right.
+ */
+
+#include "led_script.h"
+#include "led_effects.h"
+#include "led_palette.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int s_checks = 0;
+static int s_failures = 0;
+
+#define CHECK(cond) do {                                                    \
+        s_checks++;                                                         \
+        if (!(cond)) {                                                      \
+            s_failures++;                                                   \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_ERR(expr, err) do {                                           \
+        esp_err_t ret_ = (expr);                                            \
+        s_checks++;                                                         \
+        if (ret_ != (err)) {                                                \
+            s_failures++;                                                   \
+            fprintf(stderr, "FAIL %s:%d: %s = %s, expected %s\n", __FILE__, \
+                    __LINE__, #expr, esp_err_to_name(ret_), esp_err_to_name(err)); \
+        }                                                                   \
+    } while (0)
+
+static const led_script_env_t s_env = { .time = 0, .r = 10, .g = 20, .b = 30, .speed = 128 };
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+/**
+ * Load bypassing validation, as a corrupted or hostile program would run
+ * if the validator missed it. Heap allocated so ASan sees the bounds.
+ */
+static led_script_t *load_raw(const uint8_t *encoded, size_t len)
+{
+    led_script_t *script = calloc(1, sizeof(led_script_t));
+    script->frame_len = encoded[1];
+    script->pixel_len = encoded[2];
+    memcpy(script->code, encoded + LED_SCRIPT_HEADER_LEN, len - LED_SCRIPT_HEADER_LEN);
+    return script;
+}
+
+static led_script_t *load(const uint8_t *encoded, size_t len)
+{
+    led_script_t *script = calloc(1, sizeof(led_script_t));
+    if (led_script_load(script, encoded, len) != ESP_OK) {
+        free(script);
+        return NULL;
+    }
+    return script;
+}
+
+static bool all_pixels(const uint8_t *rgb, int n, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (int i = 0; i < n; i++) {
+        if (rgb[i * 3] != r || rgb[i * 3 + 1] != g || rgb[i * 3 + 2] != b) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Validator
+// ============================================================================
+
+static void test_jump_into_immediate(void)
+{
+    // PUSH8 0x55; JMP +1 lands on the PUSH8 immediate 0x1D = STORE 0x20,
+    // 24 words past vars[8]
+    static const uint8_t prog[] = { 0x01, 0x07, 0x00, 0x08, 0x55, 0x01, 0x01, 0x08, 0x1D, 0x20 };
+    CHECK_ERR(led_script_validate(prog, sizeof(prog)), ESP_ERR_INVALID_ARG);
+    CHECK_ERR(led_script_check_budget(prog, sizeof(prog), 1), ESP_ERR_INVALID_ARG);
+
+    led_script_t *script = calloc(1, sizeof(led_script_t));
+    CHECK_ERR(led_script_load(script, prog, sizeof(prog)), ESP_ERR_INVALID_ARG);
+    free(script);
+
+    // Had it been loaded anyway, the VM stops it instead of writing
+    script = load_raw(prog, sizeof(prog));
+    uint8_t rgb[3];
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(script->faulted);
+    CHECK(all_pixels(rgb, 1, 10, 20, 30));
+    free(script);
+}
+
+static void test_jump_targets(void)
+{
+    // JZ over PUSH8 lands on the next instruction
+    static const uint8_t skip[] = { 0x01, 0x05, 0x00, 0x0A, 0x02, 0x02, 0x08, 0x01 };
+    CHECK_ERR(led_script_validate(skip, sizeof(skip)), ESP_OK);
+
+    // JMP to the section end
+    static const uint8_t to_end[] = { 0x01, 0x04, 0x00, 0x01, 0x02, 0x08, 0x01 };
+    CHECK_ERR(led_script_validate(to_end, sizeof(to_end)), ESP_OK);
+
+    // JMP past the section end, and into the second byte of a PUSH16
+    static const uint8_t past_end[] = { 0x01, 0x04, 0x00, 0x01, 0x03, 0x08, 0x01 };
+    CHECK_ERR(led_script_validate(past_end, sizeof(past_end)), ESP_ERR_INVALID_ARG);
+    static const uint8_t into_push16[] = { 0x01, 0x05, 0x00, 0x01, 0x01, 0x09, 0x1D, 0x40 };
+    CHECK_ERR(led_script_validate(into_push16, sizeof(into_push16)), ESP_ERR_INVALID_ARG);
+
+    // The frame section cannot jump into the pixel section
+    static const uint8_t cross[] = { 0x01, 0x02, 0x02, 0x01, 0x01, 0x08, 0x01 };
+    CHECK_ERR(led_script_validate(cross, sizeof(cross)), ESP_ERR_INVALID_ARG);
+}
+
+static void test_malformed(void)
+{
+    static const uint8_t unknown_op[] = { 0x01, 0x01, 0x00, 0x7F };
+    CHECK_ERR(led_script_validate(unknown_op, sizeof(unknown_op)), ESP_ERR_INVALID_ARG);
+
+    static const uint8_t bad_var[] = { 0x01, 0x02, 0x00, 0x1C, LED_SCRIPT_VARS };
+    CHECK_ERR(led_script_validate(bad_var, sizeof(bad_var)), ESP_ERR_INVALID_ARG);
+
+    static const uint8_t cut_push16[] = { 0x01, 0x02, 0x00, 0x09, 0x01 };
+    CHECK_ERR(led_script_validate(cut_push16, sizeof(cut_push16)), ESP_ERR_INVALID_ARG);
+
+    static const uint8_t bad_version[] = { 0x02, 0x01, 0x00, 0x00 };
+    CHECK_ERR(led_script_validate(bad_version, sizeof(bad_version)), ESP_ERR_NOT_SUPPORTED);
+
+    static const uint8_t bad_len[] = { 0x01, 0x03, 0x00, 0x00 };
+    CHECK_ERR(led_script_validate(bad_len, sizeof(bad_len)), ESP_ERR_INVALID_SIZE);
+
+    static const uint8_t empty[] = { 0x01, 0x00, 0x00 };
+    CHECK_ERR(led_script_validate(empty, sizeof(empty)), ESP_ERR_INVALID_SIZE);
+}
+
+static void test_budget(void)
+{
+    // Pixel section of 54 instructions: 16 384 / 54 = 303 LEDs
+    uint8_t prog[LED_SCRIPT_HEADER_LEN + 54] = { 0x01, 0x00, 54 };
+    for (int i = 0; i < 54; i++) {
+        prog[LED_SCRIPT_HEADER_LEN + i] = 0x0B;     // INDEX (overflows, but fits the budget)
+    }
+    CHECK_ERR(led_script_check_budget(prog, sizeof(prog), 300), ESP_OK);
+    CHECK_ERR(led_script_check_budget(prog, sizeof(prog), 304), ESP_ERR_INVALID_SIZE);
+}
+
+// ============================================================================
+// Runtime Defense (programs the validator would refuse)
+// ============================================================================
+
+static void test_runtime_checks(void)
+{
+    uint8_t rgb[3];
+
+    // STORE to variable 200
+    static const uint8_t store[] = { 0x01, 0x04, 0x00, 0x08, 0x01, 0x1D, 0xC8 };
+    led_script_t *script = load_raw(store, sizeof(store));
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(script->faulted);
+    free(script);
+
+    // LOAD from variable 255
+    static const uint8_t load_var[] = { 0x01, 0x02, 0x00, 0x1C, 0xFF };
+    script = load_raw(load_var, sizeof(load_var));
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(script->faulted);
+    free(script);
+
+    // PUSH16 whose immediate runs past the frame section into the pixel one
+    static const uint8_t push16[] = { 0x01, 0x02, 0x01, 0x09, 0x01, 0x00 };
+    script = load_raw(push16, sizeof(push16));
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(script->faulted);
+    free(script);
+
+    // JMP +255 from the end of a full section: past the end, stops there
+    uint8_t far[LED_SCRIPT_HEADER_LEN + LED_SCRIPT_MAX_CODE] = { 0x01, LED_SCRIPT_MAX_CODE, 0x00 };
+    far[LED_SCRIPT_HEADER_LEN + LED_SCRIPT_MAX_CODE - 2] = 0x01;
+    far[LED_SCRIPT_HEADER_LEN + LED_SCRIPT_MAX_CODE - 1] = 0xFF;
+    for (int i = 0; i < LED_SCRIPT_MAX_CODE - 2; i++) {
+        far[LED_SCRIPT_HEADER_LEN + i] = 0x19;      // DROP: faults right away on an empty stack
+    }
+    far[LED_SCRIPT_HEADER_LEN] = 0x01;              // JMP over the DROPs to the last JMP
+    far[LED_SCRIPT_HEADER_LEN + 1] = LED_SCRIPT_MAX_CODE - 4;
+    script = load_raw(far, sizeof(far));
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(!script->faulted);
+    free(script);
+}
+
+// ============================================================================
+// Interpreter
+// ============================================================================
+
+static void test_rainbow(void)
+{
+    // ledsc.py: frame { phase = time }  pixel { hsv(index * 256 / count + phase, 255, 255) }
+    static const uint8_t prog[] = {
+        0x01, 0x03, 0x0F, 0x0A, 0x1D, 0x00, 0x0B, 0x09, 0x00, 0x01, 0x22, 0x0C,
+        0x23, 0x1C, 0x00, 0x20, 0x08, 0xFF, 0x08, 0xFF, 0x39,
+    };
+    led_script_t *script = load(prog, sizeof(prog));
+    CHECK(script != NULL);
+    if (script == NULL) return;
+    CHECK(script->frame_instr == 2 && script->pixel_instr == 10);
+
+    led_script_env_t env = s_env;
+    env.time = 7;
+    uint8_t rgb[30 * 3];
+    led_script_run(script, &env, rgb, 30);
+    CHECK(!script->faulted);
+
+    for (int i = 0; i < 30; i++) {
+        uint8_t r, g, b;
+        effects_hsv_to_rgb((i * 256 / 30 + 7) & 0xFF, 255, 255, &r, &g, &b);
+        CHECK(rgb[i * 3] == r && rgb[i * 3 + 1] == g && rgb[i * 3 + 2] == b);
+    }
+    CHECK(script->max_frame_instr == 2 + 10 * 30);
+    free(script);
+}
+
+static void test_variables_persist(void)
+{
+    // ledsc.py: frame { n = n + 1; rgb(n, 0, 0) }
+    static const uint8_t prog[] = {
+        0x01, 0x0E, 0x00, 0x1C, 0x00, 0x08, 0x01, 0x20, 0x1D, 0x00, 0x1C, 0x00,
+        0x08, 0x00, 0x08, 0x00, 0x38,
+    };
+    led_script_t *script = load(prog, sizeof(prog));
+    CHECK(script != NULL);
+    if (script == NULL) return;
+
+    uint8_t rgb[4 * 3];
+    for (int frame = 1; frame <= 3; frame++) {
+        led_script_run(script, &s_env, rgb, 4);
+        CHECK(all_pixels(rgb, 4, (uint8_t)frame, 0, 0));
+    }
+    led_script_reset(script);
+    led_script_run(script, &s_env, rgb, 4);
+    CHECK(all_pixels(rgb, 4, 1, 0, 0));
+    free(script);
+}
+
+static void test_arithmetic_edges(void)
+{
+    // ledsc.py: frame { z = 0; m = 0 - 1; rgb(5 / z + 1, 5 % z + 2, INT32_MIN / m) }
+    static const uint8_t prog[] = {
+        0x01, 0x23, 0x00, 0x08, 0x00, 0x1D, 0x00, 0x09, 0xFF, 0xFF, 0x1D, 0x01,
+        0x08, 0x05, 0x1C, 0x00, 0x23, 0x08, 0x01, 0x20, 0x08, 0x05, 0x1C, 0x00,
+        0x24, 0x08, 0x02, 0x20, 0x09, 0x00, 0x80, 0x08, 0x10, 0x28, 0x1C, 0x01,
+        0x23, 0x38,
+    };
+    led_script_t *script = load(prog, sizeof(prog));
+    CHECK(script != NULL);
+    if (script == NULL) return;
+
+    // x / 0 = 0, x % 0 = 0, INT32_MIN / -1 wraps (negative, clamps to 0)
+    uint8_t rgb[3];
+    led_script_run(script, &s_env, rgb, 1);
+    CHECK(!script->faulted);
+    CHECK(rgb[0] == 1 && rgb[1] == 2 && rgb[2] == 0);
+    free(script);
+}
+
+static void test_stack_fault(void)
+{
+    // ADD on an empty stack: stopped, base color, stays stopped
+    static const uint8_t prog[] = { 0x01, 0x01, 0x00, 0x20 };
+    led_script_t *script = load(prog, sizeof(prog));
+    CHECK(script != NULL);
+    if (script == NULL) return;
+
+    uint8_t rgb[5 * 3];
+    led_script_run(script, &s_env, rgb, 5);
+    CHECK(script->faulted);
+    CHECK(all_pixels(rgb, 5, 10, 20, 30));
+    led_script_reset(script);
+    CHECK(!script->faulted);
+    free(script);
+}
+
+static void test_palette(void)
+{
+    // pixel { pal(index * 256 / count + time) } over a red-green-blue palette
+    static const uint8_t prog[] = {
+        0x01, 0x00, 0x0A, 0x0B, 0x09, 0x00, 0x01, 0x22, 0x0C, 0x23, 0x0A, 0x20, 0x3A,
+    };
+    static const uint8_t pal[] = { 3, 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+    led_palette_lut_t *lut = malloc(sizeof(led_palette_lut_t));
+    CHECK_ERR(led_palette_build_lut(pal, sizeof(pal), lut), ESP_OK);
+
+    led_script_t *script = load(prog, sizeof(prog));
+    CHECK(script != NULL);
+    if (script == NULL) return;
+
+    led_script_env_t env = s_env;
+    env.palette = lut;
+    uint8_t rgb[16 * 3];
+    led_script_run(script, &env, rgb, 16);
+    for (int i = 0; i < 16; i++) {
+        const led_rgb_t *c = &lut->color[i * 256 / 16];
+        CHECK(rgb[i * 3] == c->r && rgb[i * 3 + 1] == c->g && rgb[i * 3 + 2] == c->b);
+    }
+
+    // Without a palette OUT_PAL gives black
+    env.palette = NULL;
+    led_script_run(script, &env, rgb, 16);
+    CHECK(all_pixels(rgb, 16, 0, 0, 0));
+    free(script);
+    free(lut);
+}
+
+static void test_bank(void)
+{
+    static const uint8_t prog[] = { 0x01, 0x01, 0x00, 0x00 };
+    uint8_t encoded[LED_SCRIPT_MAX_ENCODED];
+    size_t len = 0;
+
+    CHECK_ERR(led_script_bank_load(0, encoded, &len), ESP_ERR_NOT_FOUND);
+    CHECK_ERR(led_script_bank_store(0, prog, sizeof(prog)), ESP_OK);
+    CHECK_ERR(led_script_bank_load(0, encoded, &len), ESP_OK);
+    CHECK(len == sizeof(prog) && memcmp(encoded, prog, len) == 0);
+    CHECK_ERR(led_script_bank_store(LED_SCRIPT_BANK_SIZE, prog, sizeof(prog)), ESP_ERR_INVALID_ARG);
+
+    static const uint8_t bad[] = { 0x01, 0x07, 0x00, 0x08, 0x55, 0x01, 0x01, 0x08, 0x1D, 0x20 };
+    CHECK_ERR(led_script_bank_store(1, bad, sizeof(bad)), ESP_ERR_INVALID_ARG);
+}
+
+// ============================================================================
+// Random Programs
+// ============================================================================
+
+/**
+ * Every random program the validator accepts must run without faulting
+ * the sanitizer; the ones it accepts are biased towards real opcodes.
+ */
+static void test_random_programs(void)
+{
+    static const uint8_t ops[] = {
+        0x00, 0x01, 0x02, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x18, 0x19, 0x1A, 0x1B,
+        0x1C, 0x1D, 0x20, 0x21, 0x22, 0x23, 0x24, 0x28, 0x29, 0x2C, 0x2D, 0x30, 0x31,
+        0x32, 0x33, 0x34, 0x35, 0x38, 0x39, 0x3A,
+    };
+    static const led_palette_lut_t lut;
+    led_script_env_t env = s_env;
+    env.palette = &lut;
+
+    uint32_t seed = 1;
+    int accepted = 0;
+    uint8_t rgb[8 * 3];
+    for (int n = 0; n < 200000; n++) {
+        uint8_t prog[LED_SCRIPT_HEADER_LEN + 24];
+        seed = seed * 1103515245 + 12345;
+        uint8_t frame_len = (seed >> 16) % 13;
+        uint8_t pixel_len = (seed >> 24) % 12;
+        if (frame_len + pixel_len == 0) continue;
+        prog[0] = LED_SCRIPT_VERSION;
+        prog[1] = frame_len;
+        prog[2] = pixel_len;
+        for (int i = 0; i < frame_len + pixel_len; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t v = seed >> 16;
+            prog[LED_SCRIPT_HEADER_LEN + i] = (v & 1) ? ops[(v >> 1) % sizeof(ops)] : (v >> 4) % 8;
+        }
+        size_t len = LED_SCRIPT_HEADER_LEN + frame_len + pixel_len;
+
+        led_script_t *script = load(prog, len);
+        if (script == NULL) continue;
+        accepted++;
+        led_script_run(script, &env, rgb, 8);
+        free(script);
+
+        // The same bytes must never escape the VM when loaded unchecked
+        script = load_raw(prog, len);
+        led_script_run(script, &env, rgb, 8);
+        free(script);
+    }
+    CHECK(accepted > 1000);
+}
+
+static void test_random_unchecked(void)
+{
+    // Arbitrary bytes straight into the VM: faults are fine, escapes are not
+    uint32_t seed = 7;
+    uint8_t rgb[4 * 3];
+    for (int n = 0; n < 200000; n++) {
+        uint8_t prog[LED_SCRIPT_HEADER_LEN + 16] = { LED_SCRIPT_VERSION, 8, 8 };
+        for (int i = 0; i < 16; i++) {
+            seed = seed * 1103515245 + 12345;
+            prog[LED_SCRIPT_HEADER_LEN + i] = (seed >> 16) % 0x3C;
+        }
+        led_script_t *script = load_raw(prog, sizeof(prog));
+        led_script_run(script, &s_env, rgb, 4);
+        free(script);
+    }
+    CHECK(true);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void)
+{
+    test_jump_into_immediate();
+    test_jump_targets();
+    test_malformed();
+    test_budget();
+    test_bank();
+
+    host_log_quiet(true);           // Faults below are expected
+    test_runtime_checks();
+    test_rainbow();
+    test_variables_persist();
+    test_arithmetic_edges();
+    test_stack_fault();
+    test_palette();
+    test_random_programs();
+    test_random_unchecked();
+
+    printf("%d checks, %d failed\n", s_checks, s_failures);
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,488 @@
+/**
+ * OmniaPi ESP-NOW Reliable Transport Simulator - Harness
+ *
+ * Two devices talk over one lossy ESP-NOW link (sim_espnow.c) in virtual
+ * time, each with its own copy of shared/components/espnow_rt: espnow_rt.c
+ * is built as a module and loaded once per device, as sim_fw.c does for
+ * the node firmware, so both ends run the unchanged code. Device 0 plays
+ * the gateway and sends relay toggles in scene-sized bursts; device 1
+ * plays the node, applies each toggle and reports its state back, both
+ * through espnow_rt_send(). Callbacks and the state report fall back
+ * (plain when the window is full) are wired the way
+ * node/main/espnow_handler.c does it.
+ *
+ * The report gives delivery latency percentiles (first send attempt to
+ * the node applying it, waits for a window slot included), command round
+ * trips, and each side's espnow_rt statistics. The exit status is 1 if a
+ * toggle was applied or a state report delivered twice, or a toggle went
+ * missing while the sender believed it delivered.
+ */
+
+#include "sim.h"
+#include "espnow_rt.h"
+#include "esp_now.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <dlfcn.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char *TAG = "ESPNOW_RT_SIM";
+
+#define GATEWAY                 0
+#define NODE                    1
+#define DEVICES                 2
+
+#define MSG_TOGGLE              0x20    // [MSG_TOGGLE][id x4]
+#define MSG_STATE               0x21    // [MSG_STATE][id x4][relay]
+
+#define DRAIN_MS                5000    // After the last toggle: longer than every retry together
+
+typedef struct {
+    void *handle;
+    esp_err_t (*init)(espnow_rt_deliver_cb_t deliver);
+    esp_err_t (*send)(const uint8_t *mac, const uint8_t *data, int len);
+    esp_err_t (*send_plain)(const uint8_t *mac, const uint8_t *data, int len);
+    bool (*handle_recv)(const uint8_t *mac, const uint8_t *data, int len);
+    void (*handle_send_done)(const uint8_t *mac, bool success);
+    void (*get_stats)(espnow_rt_stats_t *stats);
+} rt_copy_t;
+
+typedef struct {
+    sim_espnow_config_t link;
+    uint64_t seed;
+    int messages;
+    int burst;
+    uint32_t interval_ms;
+    esp_log_level_t log_level;
+    const char *module;
+} options_t;
+
+static options_t s_opt;
+static rt_copy_t s_rt[DEVICES];
+static int s_failures = 0;
+
+// Per toggle: first send attempt, times the node applied it and the
+// gateway got its state report, latencies of the first of each
+static int64_t *s_sent_us = NULL;
+static uint8_t *s_applied = NULL;
+static uint8_t *s_reported = NULL;
+static int64_t *s_delivery_us = NULL;
+static size_t s_delivery_count = 0;
+static int64_t *s_round_trip_us = NULL;
+static size_t s_round_trip_count = 0;
+
+static bool s_relay = false;
+static uint32_t s_window_waits = 0;         // Gateway found the window full
+static uint32_t s_replies_plain = 0;        // Node found the window full, sent plain
+static uint32_t s_send_errors = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        s_failures++;
+        fprintf(stderr, "espnow_rt_sim: CHECK FAILED: %s\n", what);
+    }
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Add p50/p90/p99/max (ms) of count µs values to obj (sorts them)
+ */
+static void add_percentiles_ms(cJSON *obj, const char *prefix, int64_t *values, size_t count)
+{
+    static const int pcts[] = { 50, 90, 99 };
+    char key[48];
+    qsort(values, count, sizeof(int64_t), cmp_i64);
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        snprintf(key, sizeof(key), "%s_p%d_ms", prefix, pcts[i]);
+        cJSON_AddNumberToObject(obj, key, count ? values[(count - 1) * pcts[i] / 100] / 1000.0 : 0);
+    }
+    snprintf(key, sizeof(key), "%s_max_ms", prefix);
+    cJSON_AddNumberToObject(obj, key, count ? values[count - 1] / 1000.0 : 0);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+// ============================================================================
+// One espnow_rt per Device
+// ============================================================================
+
+static void *symbol(void *handle, const char *name)
+{
+    void *sym = dlsym(handle, name);
+    if (sym == NULL) {
+        fprintf(stderr, "espnow_rt_sim: %s: %s\n", name, dlerror());
+        exit(1);
+    }
+    return sym;
+}
+
+static void load_copies(const char *module_path)
+{
+    FILE *f = fopen(module_path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "espnow_rt_sim: cannot open %s\n", module_path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = malloc(size);
+    if (image == NULL || fread(image, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "espnow_rt_sim: cannot read %s\n", module_path);
+        exit(1);
+    }
+    fclose(f);
+
+    for (int i = 0; i < DEVICES; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "espnow_rt_%d", i);
+        int fd = memfd_create(name, MFD_CLOEXEC);
+        if (fd < 0 || write(fd, image, size) != size) {
+            fprintf(stderr, "espnow_rt_sim: cannot copy the module for device %d\n", i);
+            exit(1);
+        }
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        rt_copy_t *rt = &s_rt[i];
+        rt->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        if (rt->handle == NULL) {
+            fprintf(stderr, "espnow_rt_sim: device %d: %s\n", i, dlerror());
+            exit(1);
+        }
+        rt->init = symbol(rt->handle, "espnow_rt_init");
+        rt->send = symbol(rt->handle, "espnow_rt_send");
+        rt->send_plain = symbol(rt->handle, "espnow_rt_send_plain");
+        rt->handle_recv = symbol(rt->handle, "espnow_rt_handle_recv");
+        rt->handle_send_done = symbol(rt->handle, "espnow_rt_handle_send_done");
+        rt->get_stats = symbol(rt->handle, "espnow_rt_get_stats");
+    }
+    free(image);
+}
+
+// ============================================================================
+// Firmware Glue (as node/main/espnow_handler.c)
+// ============================================================================
+
+static void node_deliver(const uint8_t *mac, const uint8_t *data, int len)
+{
+    if (len < 5 || data[0] != MSG_TOGGLE) return;
+    uint32_t id = get_u32(data + 1);
+    if (id >= (uint32_t)s_opt.messages) return;
+
+    if (s_applied[id] < UINT8_MAX) s_applied[id]++;
+    if (s_applied[id] == 1) {
+        s_delivery_us[s_delivery_count++] = sim_now_us() - s_sent_us[id];
+    }
+    s_relay = !s_relay;
+
+    // As send_to_gateway(): plain when the window is full
+    uint8_t state[6] = { MSG_STATE };
+    put_u32(state + 1, id);
+    state[5] = s_relay;
+    if (s_rt[NODE].send(mac, state, sizeof(state)) == ESP_ERR_NO_MEM) {
+        s_replies_plain++;
+        s_rt[NODE].send_plain(mac, state, sizeof(state));
+    }
+}
+
+static void gateway_deliver(const uint8_t *mac, const uint8_t *data, int len)
+{
+    if (len < 6 || data[0] != MSG_STATE) return;
+    uint32_t id = get_u32(data + 1);
+    if (id >= (uint32_t)s_opt.messages) return;
+
+    if (s_reported[id] < UINT8_MAX) s_reported[id]++;
+    if (s_reported[id] == 1) {
+        s_round_trip_us[s_round_trip_count++] = sim_now_us() - s_sent_us[id];
+    }
+}
+
+static void recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+{
+    if (s_rt[sim_rtos_node()].handle_recv(info->src_addr, data, len)) return;
+    // Plain: only state reports the node sent with a full window
+    if (sim_rtos_node() == GATEWAY) gateway_deliver(info->src_addr, data, len);
+}
+
+static void send_cb(const wifi_tx_info_t *info, esp_now_send_status_t status)
+{
+    s_rt[sim_rtos_node()].handle_send_done(info->des_addr, status == ESP_NOW_SEND_SUCCESS);
+}
+
+static void start_device(int dev, espnow_rt_deliver_cb_t deliver, int peer)
+{
+    int prev = sim_rtos_enter(dev);
+    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(recv_cb));
+    ESP_ERROR_CHECK(esp_now_register_send_cb(send_cb));
+    ESP_ERROR_CHECK(s_rt[dev].init(deliver));
+    esp_now_peer_info_t info = { .channel = 0, .ifidx = WIFI_IF_STA, .encrypt = false };
+    memcpy(info.peer_addr, sim_mesh_node_mac(peer), ESP_NOW_ETH_ALEN);
+    ESP_ERROR_CHECK(esp_now_add_peer(&info));
+    sim_rtos_leave(prev);
+}
+
+// ============================================================================
+// Traffic
+// ============================================================================
+
+/**
+ * One toggle; waits for a window slot like a firmware retrying a send
+ */
+static void send_toggle(uint32_t id)
+{
+    uint8_t msg[5] = { MSG_TOGGLE };
+    put_u32(msg + 1, id);
+    s_sent_us[id] = sim_now_us();
+    for (;;) {
+        esp_err_t err = s_rt[GATEWAY].send(sim_mesh_node_mac(NODE), msg, sizeof(msg));
+        if (err == ESP_OK) return;
+        if (err != ESP_ERR_NO_MEM) {
+            s_send_errors++;
+            return;
+        }
+        s_window_waits++;
+        vTaskDelay(pdMS_TO_TICKS(ESPNOW_RT_TICK_MS));
+    }
+}
+
+static cJSON *rt_stats_json(int dev)
+{
+    espnow_rt_stats_t stats;
+    s_rt[dev].get_stats(&stats);
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "sent", stats.sent);
+    cJSON_AddNumberToObject(json, "retransmits", stats.retransmits);
+    cJSON_AddNumberToObject(json, "acked", stats.acked);
+    cJSON_AddNumberToObject(json, "failed", stats.failed);
+    cJSON_AddNumberToObject(json, "window_full", stats.window_full);
+    cJSON_AddNumberToObject(json, "received", stats.received);
+    cJSON_AddNumberToObject(json, "duplicates", stats.duplicates);
+    cJSON_AddNumberToObject(json, "ack_latency_p50_ms", stats.latency_p50_ms);
+    cJSON_AddNumberToObject(json, "ack_latency_p90_ms", stats.latency_p90_ms);
+    cJSON_AddNumberToObject(json, "ack_latency_p99_ms", stats.latency_p99_ms);
+    return json;
+}
+
+static cJSON *run(void)
+{
+    for (int id = 0; id < s_opt.messages; ) {
+        for (int i = 0; i < s_opt.burst && id < s_opt.messages; i++) {
+            send_toggle(id++);
+        }
+        vTaskDelay(pdMS_TO_TICKS(s_opt.interval_ms));
+    }
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_MS));
+
+    int missing = 0, twice = 0, reported_twice = 0;
+    for (int id = 0; id < s_opt.messages; id++) {
+        if (s_applied[id] == 0) missing++;
+        if (s_applied[id] > 1) twice++;
+        if (s_reported[id] > 1) reported_twice++;
+    }
+    espnow_rt_stats_t gateway;
+    s_rt[GATEWAY].get_stats(&gateway);
+    ESP_LOGI(TAG, "%d toggles: %d missing, %d applied twice, %lu retransmits",
+             s_opt.messages, missing, twice, (unsigned long)gateway.retransmits);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "toggles", s_opt.messages);
+    cJSON_AddNumberToObject(json, "applied", (double)s_delivery_count);
+    cJSON_AddNumberToObject(json, "missing", missing);
+    cJSON_AddNumberToObject(json, "applied_twice", twice);
+    cJSON_AddNumberToObject(json, "state_reports", (double)s_round_trip_count);
+    cJSON_AddNumberToObject(json, "state_reports_twice", reported_twice);
+    cJSON_AddNumberToObject(json, "window_waits", s_window_waits);
+    cJSON_AddNumberToObject(json, "state_reports_plain", s_replies_plain);
+    add_percentiles_ms(json, "delivery", s_delivery_us, s_delivery_count);
+    add_percentiles_ms(json, "round_trip", s_round_trip_us, s_round_trip_count);
+    cJSON_AddItemToObject(json, "gateway", rt_stats_json(GATEWAY));
+    cJSON_AddItemToObject(json, "node", rt_stats_json(NODE));
+
+    sim_espnow_stats_t link;
+    sim_espnow_get_stats(&link);
+    cJSON *radio = cJSON_CreateObject();
+    cJSON_AddNumberToObject(radio, "frames_sent", link.frames_sent);
+    cJSON_AddNumberToObject(radio, "frames_lost", link.frames_lost);
+    cJSON_AddNumberToObject(radio, "mac_acks_lost", link.mac_acks_lost);
+    cJSON_AddItemToObject(json, "link", radio);
+
+    check(twice == 0, "a toggle was applied more than once");
+    check(reported_twice == 0, "a state report was delivered more than once");
+    check((uint32_t)missing <= gateway.failed, "a toggle went missing without the sender giving up");
+    check(gateway.acked + gateway.failed == gateway.sent, "toggles still in flight after the drain");
+    check(s_send_errors == 0, "espnow_rt_send refused a toggle");
+    return json;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --seed N              random seed (default 1)\n"
+            "  --loss X              frame loss after MAC retries, also applied to MAC ACKs (default 0.1)\n"
+            "  --latency-ms X        after the frame is on air (default 0.5)\n"
+            "  --jitter-ms X         uniform (default 0.5)\n"
+            "  --rate-kbps N         air rate (default 1000)\n"
+            "  --messages N          toggles to send (default 1000)\n"
+            "  --burst N             toggles sent back to back (default 8)\n"
+            "  --interval-ms N       between bursts (default 250)\n"
+            "  --log L               none | error | warn | info | debug (default warn)\n"
+            "  --module PATH         espnow_rt module (default: the one built with this binary)\n",
+            prog);
+}
+
+static esp_log_level_t parse_level(const char *prog, const char *arg)
+{
+    static const char *names[] = { "none", "error", "warn", "info", "debug" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(arg, names[i]) == 0) return (esp_log_level_t)i;
+    }
+    usage(prog);
+    exit(1);
+}
+
+static void parse_options(int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        { "seed",           required_argument, NULL, 's' },
+        { "loss",           required_argument, NULL, 'p' },
+        { "latency-ms",     required_argument, NULL, 'l' },
+        { "jitter-ms",      required_argument, NULL, 'j' },
+        { "rate-kbps",      required_argument, NULL, 'r' },
+        { "messages",       required_argument, NULL, 'n' },
+        { "burst",          required_argument, NULL, 'b' },
+        { "interval-ms",    required_argument, NULL, 'i' },
+        { "log",            required_argument, NULL, 'v' },
+        { "module",         required_argument, NULL, 'M' },
+        { "help",           no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    s_opt = (options_t){
+        .link = {
+            .latency_us = 500,
+            .jitter_us = 500,
+            .loss = 0.1,
+            .rate_kbps = 1000,
+            .overhead_bytes = 50,
+        },
+        .seed = 1,
+        .messages = 1000,
+        .burst = 8,
+        .interval_ms = 250,
+        .log_level = ESP_LOG_WARN,
+        .module = ESPNOW_RT_SIM_MODULE,
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's': s_opt.seed = strtoull(optarg, NULL, 0); break;
+            case 'p': s_opt.link.loss = atof(optarg); break;
+            case 'l': s_opt.link.latency_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'j': s_opt.link.jitter_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'r': s_opt.link.rate_kbps = (uint32_t)atoi(optarg); break;
+            case 'n': s_opt.messages = atoi(optarg); break;
+            case 'b': s_opt.burst = atoi(optarg); break;
+            case 'i': s_opt.interval_ms = (uint32_t)atoi(optarg); break;
+            case 'v': s_opt.log_level = parse_level(argv[0], optarg); break;
+            case 'M': s_opt.module = optarg; break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (s_opt.messages < 1 || s_opt.burst < 1 || s_opt.link.rate_kbps == 0 ||
+        s_opt.link.loss < 0 || s_opt.link.loss >= 1) {
+        usage(argv[0]);
+        exit(1);
+    }
+}
+
+static cJSON *config_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "seed", (double)s_opt.seed);
+    cJSON_AddNumberToObject(json, "loss", s_opt.link.loss);
+    cJSON_AddNumberToObject(json, "latency_ms", s_opt.link.latency_us / 1000.0);
+    cJSON_AddNumberToObject(json, "jitter_ms", s_opt.link.jitter_us / 1000.0);
+    cJSON_AddNumberToObject(json, "rate_kbps", s_opt.link.rate_kbps);
+    cJSON_AddNumberToObject(json, "messages", s_opt.messages);
+    cJSON_AddNumberToObject(json, "burst", s_opt.burst);
+    cJSON_AddNumberToObject(json, "interval_ms", s_opt.interval_ms);
+    cJSON_AddNumberToObject(json, "window", ESPNOW_RT_WINDOW);
+    cJSON_AddNumberToObject(json, "max_retries", ESPNOW_RT_MAX_RETRIES);
+    return json;
+}
+
+int main(int argc, char **argv)
+{
+    parse_options(argc, argv);
+
+    sim_log_set_level(s_opt.log_level, s_opt.log_level);
+    sim_rand_seed(s_opt.seed);
+    sim_rtos_init();
+    sim_idf_init(DEVICES);
+
+    // Only for the station MACs
+    sim_mesh_config_t mesh = { .nodes = DEVICES - 1 };
+    sim_mesh_configure(&mesh);
+    sim_espnow_configure(&s_opt.link, DEVICES);
+    load_copies(s_opt.module);
+
+    s_sent_us = calloc(s_opt.messages, sizeof(int64_t));
+    s_applied = calloc(s_opt.messages, sizeof(uint8_t));
+    s_reported = calloc(s_opt.messages, sizeof(uint8_t));
+    s_delivery_us = calloc(s_opt.messages, sizeof(int64_t));
+    s_round_trip_us = calloc(s_opt.messages, sizeof(int64_t));
+    if (s_sent_us == NULL || s_applied == NULL || s_reported == NULL || s_delivery_us == NULL ||
+        s_round_trip_us == NULL) {
+        abort();
+    }
+
+    start_device(GATEWAY, gateway_deliver, NODE);
+    start_device(NODE, node_deliver, GATEWAY);
+
+    cJSON *report = cJSON_CreateObject();
+    cJSON_AddItemToObject(report, "config", config_json());
+    cJSON_AddItemToObject(report, "toggles", run());
+    cJSON_AddNumberToObject(report, "failures", s_failures);
+    cJSON_AddNumberToObject(report, "virtual_s", sim_now_us() / 1e6);
+
+    char *text = cJSON_Print(report);
+    printf("%s\n", text);
+    fflush(stdout);
+    cJSON_free(text);
+    cJSON_Delete(report);
+
+    // Timer callbacks may still be queued; leave without running them
+    _exit(s_failures ? 1 : 0);
+}
@@ -0,0 +1,24 @@
+/**
+ * OmniaPi Mesh Simulator - sdkconfig for the host build
+ *
+ * Values follow gateway_mesh/sdkconfig.defaults and the Kconfig defaults.
+ */
+
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ                      1000
+#define CONFIG_MESH_MAX_LAYER                   6
+#define CONFIG_MESH_AP_CONNECTIONS              6
+#define CONFIG_MESH_NON_MESH_AP_CONNECTIONS     0
+#define CONFIG_MESH_ROUTE_TABLE_SIZE            50
+#define CONFIG_MESH_AP_PASSWD                   "omniapi_mesh_2024"
+#define CONFIG_MESH_CHANNEL                     0
+#define CONFIG_GATEWAY_FIRMWARE_VERSION         "1.19.1"
+#define CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS    5000
+#define CONFIG_GATEWAY_NODE_TIMEOUT_MS          30000
+#define CONFIG_GATEWAY_BOOT_TARGET_MS           3000
+#define CONFIG_GATEWAY_MESH_OPTIMIZER           1
+#define CONFIG_LWIP_MAX_SOCKETS                 16
+
+#endif // SDKCONFIG_H
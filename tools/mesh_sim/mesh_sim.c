@@ -0,0 +1,1569 @@
+/**
+ * OmniaPi Mesh Simulator - Harness
+ *
+ * Boots the gateway the way main.c does (mesh_network, mesh_router,
+ * node_manager, mesh_topology, mesh_optimizer, commissioning, node_ota,
+ * fleet_ota, cmd_latency and mqtt_handler, against the in-process broker)
+ * and powers
+ * up N nodes, each running its own copy of the node_mesh firmware (main.c,
+ * mesh_node.c, device_relay.c, commissioning.c, ota_receiver.c). Then it
+ * plays the backend through MQTT and runs load scenarios in virtual time:
+ *
+ *   heartbeat  heartbeat rounds: ACKs per round, time to the last ACK, how
+ *              long frames wait in the gateway's receive queue
+ *   command    relay toggles over MQTT, one at a time and in scene-sized
+ *              bursts, from the backend's publish to the node's state
+ *              coming back, and whether the relay actually switched
+ *   ota        staged node OTA to the deepest node with commands running,
+ *              until the node has rebooted into the new image
+ *   fleet      fleet rollout of a staged image to every node, canaries
+ *              first, deepest layer first: total time and time per layer
+ *              (not part of "all")
+ *   scan       discovery scan over MQTT, batch commissioning of what it
+ *              found, and the production mesh coming back afterwards
+ *   churn      nodes losing and regaining power at random, then whether
+ *              the gateway's node table and topology map caught up and
+ *              every node still answers
+ *   restore    whole-house power cut and restore (gateway stays up): how
+ *              each node rejoined, boot to connected and boot to first
+ *              command as the nodes report them, time until every node
+ *              is controllable, announces and MQTT traffic on the way
+ *              (not part of "all")
+ *   optimize   hops, parent RSSI and command round trips to every node,
+ *              before and after OPTIMIZE_RUN_MS of the topology optimizer
+ *              (meant for --topology house; not part of "all")
+ *
+ * The report is one JSON object on stdout; logs go to stderr. A run only
+ * depends on its options and --seed. The exit status is 1 if a scenario
+ * missed one of its checks (ctest runs rely on this).
+ */
+
+#include "sim.h"
+#include "omniapi_protocol.h"
+#include "mesh_network.h"
+#include "mesh_router.h"
+#include "mesh_topology.h"
+#include "mesh_optimizer.h"
+#include "node_manager.h"
+#include "node_ota.h"
+#include "fleet_ota.h"
+#include "cmd_latency.h"
+#include "commissioning.h"
+#include "mqtt_handler.h"
+#include "nvs_flash.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "MESH_SIM";
+
+#define SCENARIO_HEARTBEAT      (1 << 0)
+#define SCENARIO_COMMAND        (1 << 1)
+#define SCENARIO_OTA            (1 << 2)
+#define SCENARIO_SCAN           (1 << 3)
+#define SCENARIO_CHURN          (1 << 4)
+#define SCENARIO_OPTIMIZE       (1 << 5)
+#define SCENARIO_FLEET          (1 << 6)
+#define SCENARIO_RESTORE        (1 << 7)
+#define SCENARIO_ALL            (SCENARIO_HEARTBEAT | SCENARIO_COMMAND | SCENARIO_OTA | SCENARIO_SCAN | \
+                                 SCENARIO_CHURN)
+
+#define FORM_TIMEOUT_MS         180000  // Mesh must have formed by then
+#define SETTLE_TIMEOUT_MS       180000  // After an OTA reboot or a scan
+#define SINGLE_INTERVAL_MS      500     // Between single commands
+#define BURST_INTERVAL_MS       5000    // Between scene bursts
+#define BURST_SIZE              20      // Commands per scene
+#define REPLY_WAIT_MS           3000    // Commands still in flight at the end
+#define SCAN_RESULT_TIMEOUT_MS  60000
+#define BATCH_RESULT_TIMEOUT_MS 180000
+#define CHURN_INTERVAL_MS       5000    // Between power cuts
+#define CHURN_PERCENT           10      // Powered nodes cut each time
+#define CHURN_OFF_MIN_MS        2000    // Time without power
+#define CHURN_OFF_MAX_MS        20000
+#define OPTIMIZE_RUN_MS         1800000 // Optimizer at work between the two measurements
+#define PROBE_INTERVAL_MS       200     // Between the commands of one measurement
+#define FLEET_CANARIES          2
+#define RESTORE_OFF_MS          10000   // Whole house without power
+#define RESTORE_TIMEOUT_MS      120000  // Every node answering again by then
+#define FLEET_TIMEOUT_MS        7200000 // Whole rollout
+
+#define OTA_VERSION             "1.2.0"
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct {
+    sim_mesh_config_t mesh;
+    uint64_t seed;
+    int scenarios;
+    int duration_s;
+    int ota_kb;
+    int uncommissioned;         // Last K nodes start factory-fresh
+    uint32_t mqtt_latency_us;
+    esp_log_level_t log_level;
+    esp_log_level_t node_log_level;
+    const char *module;
+} options_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t last_ack_ms;
+} hb_round_t;
+
+static options_t s_opt;
+static int s_failures = 0;
+
+// Heartbeat rounds, closed by the heartbeat task before the next one goes out
+static hb_round_t *s_rounds = NULL;
+static int s_round_count = 0;
+static int s_round_cap = 0;
+static bool s_track_rounds = false;
+
+// Backend view of the commands: publish time per node, and the round trips
+static int64_t *s_cmd_pending_us = NULL;
+static int64_t *s_cmd_latency_us = NULL;
+static size_t s_cmd_latency_count = 0;
+static size_t s_cmd_latency_cap = 0;
+static uint32_t s_state_messages = 0;
+
+// Backend view of scan and commissioning
+static bool s_scan_done = false;
+static int s_scan_found = 0;
+static int s_scan_fresh = 0;
+static char (*s_scan_fresh_macs)[18] = NULL;
+static bool s_batch_done = false;
+static int s_batch_ok = 0;
+static int s_batch_failed = 0;
+static int s_commissioned = 0;              // Nodes with production credentials
+
+// Backend view of nodes coming back
+static uint32_t s_online_batches = 0;
+static uint32_t s_online_batched = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        s_failures++;
+        fprintf(stderr, "mesh_sim: CHECK FAILED: %s\n", what);
+    }
+}
+
+// ============================================================================
+// Gateway Glue (same wiring as gateway_mesh/main/main.c)
+// ============================================================================
+
+void on_mqtt_connected(void)
+{
+    ESP_LOGI(TAG, "MQTT connected");
+    mqtt_publish_gateway_status(true);
+}
+
+void on_mqtt_disconnected(void)
+{
+    ESP_LOGW(TAG, "MQTT disconnected");
+}
+
+static void on_router_state_changed(bool connected)
+{
+    if (connected) {
+        mqtt_handler_on_uplink();
+    }
+}
+
+static void on_mesh_child_connected(const uint8_t *mac)
+{
+    // Discovery mode: nodes come in through scan responses instead
+    if (commissioning_get_mode() == COMMISSION_MODE_DISCOVERY) return;
+
+    node_manager_add_node(mac);
+    if (mqtt_handler_is_connected()) {
+        mqtt_queue_node_online(mac);
+    }
+}
+
+static void on_mesh_child_disconnected(const uint8_t *mac)
+{
+    node_manager_set_offline(mac);
+    if (mqtt_handler_is_connected()) {
+        mqtt_publish_node_disconnected(mac);
+    }
+}
+
+static void record_round(void)
+{
+    mesh_stats_t stats;
+    mesh_network_get_stats(&stats);
+    if (stats.hb_sent == 0) return;
+
+    if (s_round_count == s_round_cap) {
+        s_round_cap = s_round_cap ? s_round_cap * 2 : 64;
+        s_rounds = realloc(s_rounds, s_round_cap * sizeof(hb_round_t));
+        if (s_rounds == NULL) abort();
+    }
+    s_rounds[s_round_count++] = (hb_round_t){
+        .sent = stats.hb_sent,
+        .acked = stats.hb_acked,
+        .last_ack_ms = stats.hb_last_ack_ms,
+    };
+}
+
+static void gateway_task(void *param)
+{
+    (void)param;
+    while (1) {
+        mesh_network_process_rx();
+        mqtt_handler_process();
+        node_ota_check_timeout();
+        fleet_ota_process();
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+static void heartbeat_task(void *param)
+{
+    (void)param;
+    TickType_t last_wake = xTaskGetTickCount();
+    const TickType_t interval = pdMS_TO_TICKS(CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS);
+
+    while (1) {
+        if (mesh_network_is_started() && mesh_network_is_root()) {
+            // The gateway's round statistics cover the previous heartbeat until this one
+            if (s_track_rounds) record_round();
+            mesh_topology_on_heartbeat_sent();
+            mesh_network_broadcast_heartbeat();
+            mesh_optimizer_tick();
+        }
+        node_manager_check_timeouts();
+        vTaskDelayUntil(&last_wake, interval);
+    }
+}
+
+// ============================================================================
+// Backend (broker subscriptions)
+// ============================================================================
+
+static int index_of_mac_hex(const char *hex)
+{
+    uint8_t mac[6];
+    if (sscanf(hex, "%2hhx%2hhx%2hhx%2hhx%2hhx%2hhx",
+               &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6) {
+        return -1;
+    }
+    return sim_mesh_find(mac);
+}
+
+static void on_node_state(const char *topic, const char *data, int len)
+{
+    // omniapi/gateway/nodes/AABBCCDDEEFF/state
+    int index = index_of_mac_hex(topic + strlen(MQTT_TOPIC_NODES "/"));
+    s_state_messages++;
+    if (index < 1 || s_cmd_pending_us == NULL || s_cmd_pending_us[index] == 0) return;
+
+    if (s_cmd_latency_count == s_cmd_latency_cap) {
+        s_cmd_latency_cap = s_cmd_latency_cap ? s_cmd_latency_cap * 2 : 256;
+        s_cmd_latency_us = realloc(s_cmd_latency_us, s_cmd_latency_cap * sizeof(int64_t));
+        if (s_cmd_latency_us == NULL) abort();
+    }
+    s_cmd_latency_us[s_cmd_latency_count++] = sim_now_us() - s_cmd_pending_us[index];
+    s_cmd_pending_us[index] = 0;
+}
+
+static void on_nodes_online(const char *topic, const char *data, int len)
+{
+    cJSON *json = cJSON_ParseWithLength(data, len);
+    s_online_batches++;
+    s_online_batched += json ? cJSON_GetArraySize(cJSON_GetObjectItem(json, "nodes")) : 0;
+    cJSON_Delete(json);
+}
+
+static void on_scan_results(const char *topic, const char *data, int len)
+{
+    cJSON *json = cJSON_ParseWithLength(data, len);
+    cJSON *nodes = json ? cJSON_GetObjectItem(json, "nodes") : NULL;
+    s_scan_found = 0;
+    s_scan_fresh = 0;
+    int count = nodes ? cJSON_GetArraySize(nodes) : 0;
+    for (int i = 0; i < count; i++) {
+        cJSON *node = cJSON_GetArrayItem(nodes, i);
+        cJSON *mac = cJSON_GetObjectItem(node, "mac");
+        cJSON *commissioned = cJSON_GetObjectItem(node, "commissioned");
+        s_scan_found++;
+        if (cJSON_IsString(mac) && !cJSON_IsTrue(commissioned) && s_scan_fresh < s_opt.mesh.nodes) {
+            snprintf(s_scan_fresh_macs[s_scan_fresh++], sizeof(s_scan_fresh_macs[0]), "%s", mac->valuestring);
+        }
+    }
+    cJSON_Delete(json);
+    s_scan_done = true;
+}
+
+static void on_batch_result(const char *topic, const char *data, int len)
+{
+    cJSON *json = cJSON_ParseWithLength(data, len);
+    s_batch_ok = json ? cJSON_GetArraySize(cJSON_GetObjectItem(json, "ok")) : 0;
+    s_batch_failed = json ? cJSON_GetArraySize(cJSON_GetObjectItem(json, "failed")) : 0;
+    cJSON_Delete(json);
+    s_batch_done = true;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Add p50/p95/max (ms) of sorted µs values to obj
+ */
+static void add_percentiles_ms(cJSON *obj, const char *prefix, const int64_t *sorted, size_t count)
+{
+    char key[48];
+    double p50 = 0, p95 = 0, max = 0;
+    if (count > 0) {
+        p50 = sorted[(count - 1) * 50 / 100] / 1000.0;
+        p95 = sorted[(count - 1) * 95 / 100] / 1000.0;
+        max = sorted[count - 1] / 1000.0;
+    }
+    snprintf(key, sizeof(key), "%s_p50_ms", prefix);
+    cJSON_AddNumberToObject(obj, key, p50);
+    snprintf(key, sizeof(key), "%s_p95_ms", prefix);
+    cJSON_AddNumberToObject(obj, key, p95);
+    snprintf(key, sizeof(key), "%s_max_ms", prefix);
+    cJSON_AddNumberToObject(obj, key, max);
+}
+
+/**
+ * Receive queue waits of the frames taken since index first
+ */
+static void add_rx_waits(cJSON *obj, size_t first)
+{
+    size_t count = 0;
+    const uint32_t *waits = sim_mesh_rx_waits(&count);
+    size_t n = count > first ? count - first : 0;
+
+    int64_t *sorted = malloc((n ? n : 1) * sizeof(int64_t));
+    if (sorted == NULL) abort();
+    for (size_t i = 0; i < n; i++) sorted[i] = waits[first + i];
+    qsort(sorted, n, sizeof(int64_t), cmp_i64);
+
+    cJSON_AddNumberToObject(obj, "rx_frames", (double)n);
+    add_percentiles_ms(obj, "rx_wait", sorted, n);
+    free(sorted);
+}
+
+static size_t rx_wait_mark(void)
+{
+    size_t count = 0;
+    sim_mesh_rx_waits(&count);
+    return count;
+}
+
+static bool is_commissioned(int index)
+{
+    return index <= s_opt.mesh.nodes - s_opt.uncommissioned;
+}
+
+/**
+ * Nodes the production mesh can hold: commissioned ones, up to the routing
+ * table and the capacity the gateway sets
+ */
+static int expected_joined(int commissioned)
+{
+    int room = (s_opt.mesh.route_table < MAX_NODES + 1 ? s_opt.mesh.route_table : MAX_NODES + 1) - 1;
+    return commissioned < room ? commissioned : room;
+}
+
+static int gateway_online(void)
+{
+    int count = 0;
+    node_info_t *nodes = node_manager_get_all(&count);
+    int online = 0;
+    for (int i = 0; i < count; i++) {
+        if (nodes[i].status == NODE_STATUS_ONLINE) online++;
+    }
+    return online;
+}
+
+/**
+ * Wait until expected nodes have joined and the gateway lists them online
+ * (as far as its node table goes)
+ * @return true if it happened before timeout_ms
+ */
+static bool wait_settled(int expected, int64_t timeout_ms)
+{
+    int table = expected < MAX_NODES ? expected : MAX_NODES;
+    int64_t end = sim_now_us() + timeout_ms * 1000;
+    sim_mesh_stats_t stats;
+    do {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        sim_mesh_get_stats(&stats);
+        if (stats.joined >= expected && gateway_online() >= table) return true;
+    } while (sim_now_us() < end);
+    return false;
+}
+
+/**
+ * Nodes the backend can command: online in the gateway's table
+ */
+static int command_targets(int *out, int max)
+{
+    int count = 0;
+    node_info_t *nodes = node_manager_get_all(&count);
+    int n = 0;
+    for (int i = 0; i < count && n < max; i++) {
+        int index = sim_mesh_find(nodes[i].mac);
+        if (nodes[i].status == NODE_STATUS_ONLINE && index > 0) out[n++] = index;
+    }
+    return n;
+}
+
+static uint32_t total_actuations(void)
+{
+    uint32_t total = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        sim_idf_node_stats_t stats;
+        sim_idf_get_node_stats(i, &stats);
+        total += stats.actuations;
+    }
+    return total;
+}
+
+/**
+ * Toggle channel 0 of a node the way the backend does
+ */
+static void send_relay_cmd(int index)
+{
+    const uint8_t *mac = sim_mesh_node_mac(index);
+    char payload[96];
+    snprintf(payload, sizeof(payload),
+             "{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"channel\":0,\"action\":\"toggle\"}",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    if (s_cmd_pending_us[index] == 0) {
+        s_cmd_pending_us[index] = sim_now_us();
+    }
+    sim_mqtt_publish(MQTT_TOPIC_CMD "/relay", payload);
+}
+
+/**
+ * Singles every SINGLE_INTERVAL_MS and, if bursts, a scene every
+ * BURST_INTERVAL_MS, for duration_ms or until stop() says so
+ * @return Commands sent
+ */
+static uint32_t run_commands(int64_t duration_ms, bool bursts, const int *targets, int count,
+                             bool (*stop)(void))
+{
+    uint32_t sent = 0;
+    int64_t end = sim_now_us() + duration_ms * 1000;
+    int64_t next_burst = sim_now_us() + BURST_INTERVAL_MS * 1000;
+
+    if (count == 0) return 0;
+
+    while (sim_now_us() < end && (stop == NULL || !stop())) {
+        if (bursts && sim_now_us() >= next_burst) {
+            int size = count < BURST_SIZE ? count : BURST_SIZE;
+            int first = (int)(sim_rand_u32() % count);
+            for (int i = 0; i < size; i++) {
+                send_relay_cmd(targets[(first + i) % count]);
+                sent++;
+            }
+            next_burst += BURST_INTERVAL_MS * 1000;
+        } else {
+            send_relay_cmd(targets[sim_rand_u32() % count]);
+            sent++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(SINGLE_INTERVAL_MS));
+    }
+    return sent;
+}
+
+/**
+ * Backend round trips since the last reset, and the gateway's own recorder
+ */
+static void reset_commands(void)
+{
+    memset(s_cmd_pending_us, 0, (s_opt.mesh.nodes + 1) * sizeof(int64_t));
+    s_cmd_latency_count = 0;
+    cmd_latency_reset();
+}
+
+static void add_commands(cJSON *json, uint32_t sent, uint32_t actuations)
+{
+    qsort(s_cmd_latency_us, s_cmd_latency_count, sizeof(int64_t), cmp_i64);
+    cJSON_AddNumberToObject(json, "sent", sent);
+    cJSON_AddNumberToObject(json, "replies", (double)s_cmd_latency_count);
+    cJSON_AddNumberToObject(json, "actuations", actuations);
+    add_percentiles_ms(json, "mqtt_round_trip", s_cmd_latency_us, s_cmd_latency_count);
+    cJSON_AddItemToObject(json, "gateway_latency", cmd_latency_json());
+}
+
+// ============================================================================
+// Scenarios
+// ============================================================================
+
+static cJSON *scenario_heartbeat(void)
+{
+    int rounds = s_opt.duration_s * 1000 / CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS;
+    if (rounds < 1) rounds = 1;
+
+    size_t mark = rx_wait_mark();
+    sim_mesh_stats_t before;
+    sim_mesh_get_stats(&before);
+
+    // One more heartbeat than rounds: the first one recorded was sent before
+    s_round_count = 0;
+    s_track_rounds = true;
+    while (s_round_count < rounds + 1) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    s_track_rounds = false;
+
+    int64_t *spans = malloc(rounds * sizeof(int64_t));
+    if (spans == NULL) abort();
+    int min_acks = -1, max_acks = 0;
+    for (int i = 0; i < rounds; i++) {
+        hb_round_t *round = &s_rounds[i + 1];
+        spans[i] = (int64_t)round->last_ack_ms * 1000;
+        if (min_acks < 0 || (int)round->acked < min_acks) min_acks = round->acked;
+        if ((int)round->acked > max_acks) max_acks = round->acked;
+    }
+    qsort(spans, rounds, sizeof(int64_t), cmp_i64);
+
+    sim_mesh_stats_t after;
+    sim_mesh_get_stats(&after);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "rounds", rounds);
+    cJSON_AddNumberToObject(json, "sent_per_round", s_rounds[rounds].sent);
+    cJSON_AddNumberToObject(json, "acks_min", min_acks < 0 ? 0 : min_acks);
+    cJSON_AddNumberToObject(json, "acks_max", max_acks);
+    add_percentiles_ms(json, "last_ack", spans, rounds);
+    add_rx_waits(json, mark);
+    cJSON_AddNumberToObject(json, "rx_queue_peak", after.rx_queue_peak);
+    cJSON_AddNumberToObject(json, "routing_truncated", after.routing_truncated - before.routing_truncated);
+    cJSON_AddNumberToObject(json, "leaves", after.leaves - before.leaves);
+    free(spans);
+
+    check(max_acks > 0, "heartbeat: no node acknowledged a heartbeat");
+    check(after.leaves == before.leaves, "heartbeat: nodes left the mesh during the storm");
+    return json;
+}
+
+static cJSON *scenario_command(void)
+{
+    int *targets = malloc(sizeof(int) * (s_opt.mesh.nodes + 1));
+    if (targets == NULL) abort();
+    int count = command_targets(targets, s_opt.mesh.nodes);
+
+    size_t mark = rx_wait_mark();
+    uint32_t actuations = total_actuations();
+    reset_commands();
+    uint32_t sent = run_commands((int64_t)s_opt.duration_s * 1000, true, targets, count, NULL);
+    vTaskDelay(pdMS_TO_TICKS(REPLY_WAIT_MS));
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "targets", count);
+    add_commands(json, sent, total_actuations() - actuations);
+    add_rx_waits(json, mark);
+
+    // Toggles to a node already busy share one reply; every toggle switches the relay
+    check(count > 0, "command: no node to command");
+    check(total_actuations() - actuations == sent, "command: relays did not switch once per command");
+    free(targets);
+    return json;
+}
+
+static node_ota_session_info_t s_ota_info;
+static const uint8_t *s_ota_mac;
+
+static bool ota_done(void)
+{
+    if (node_ota_get_session_info(s_ota_mac, &s_ota_info) != ESP_OK) return true;
+    return !s_ota_info.running;
+}
+
+/**
+ * App image: the magic byte the bootloader checks, an esp_app_desc_t at its
+ * usual offset carrying the new version, random code after it
+ */
+static void ota_image_piece(uint8_t *piece, size_t offset, size_t len)
+{
+    for (size_t i = 0; i < len; i++) piece[i] = (uint8_t)sim_rand_u32();
+    if (offset == 0) {
+        piece[0] = 0xE9;
+        uint32_t magic = SIM_APP_DESC_MAGIC;
+        memcpy(piece + SIM_APP_DESC_OFFSET, &magic, sizeof(magic));
+        memset(piece + SIM_APP_DESC_OFFSET + 16, 0, 32);
+        memcpy(piece + SIM_APP_DESC_OFFSET + 16, OTA_VERSION, sizeof(OTA_VERSION));
+    }
+}
+
+/**
+ * Stage an image of size bytes through the same calls as the web upload
+ * handler (mac NULL: for a fleet rollout)
+ */
+static esp_err_t stage_image(const uint8_t *mac, size_t size)
+{
+    uint8_t piece[4096];
+    esp_err_t ret = node_ota_flash_begin(mac, size);
+    for (size_t done = 0; ret == ESP_OK && done < size; done += sizeof(piece)) {
+        size_t len = size - done < sizeof(piece) ? size - done : sizeof(piece);
+        ota_image_piece(piece, done, len);
+        ret = node_ota_flash_write(piece, len);
+    }
+    if (ret == ESP_OK) {
+        ret = node_ota_flash_finish();
+    }
+    return ret;
+}
+
+static cJSON *scenario_ota(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    int *others = malloc(sizeof(int) * (s_opt.mesh.nodes + 1));
+    if (others == NULL) abort();
+    int count = command_targets(others, s_opt.mesh.nodes);
+
+    // Deepest node the gateway knows, the longest path
+    int target = 0, slot = -1;
+    for (int i = 0; i < count; i++) {
+        if (target == 0 || sim_mesh_node_layer(others[i]) > sim_mesh_node_layer(target)) {
+            target = others[i];
+            slot = i;
+        }
+    }
+    if (target == 0) {
+        cJSON_AddStringToObject(json, "error", "no node online");
+        check(false, "ota: no node online");
+        free(others);
+        return json;
+    }
+    others[slot] = others[--count];     // The others get commands meanwhile
+    s_ota_mac = sim_mesh_node_mac(target);
+    int target_layer = sim_mesh_node_layer(target);
+    uint32_t boots = sim_fw_boots(target);
+
+    size_t size = (size_t)s_opt.ota_kb * 1024;
+    esp_err_t ret = stage_image(s_ota_mac, size);
+    if (ret != ESP_OK) {
+        cJSON_AddStringToObject(json, "error", esp_err_to_name(ret));
+        check(false, "ota: staging failed");
+        free(others);
+        return json;
+    }
+
+    size_t mark = rx_wait_mark();
+    uint32_t actuations = total_actuations();
+    reset_commands();
+    int64_t start = sim_now_us();
+    uint32_t sent = run_commands(INT64_MAX / 2000, false, others, count, ota_done);
+    while (!ota_done()) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    double seconds = (sim_now_us() - start) / 1e6;
+
+    // The node reboots into the image and comes back
+    int64_t reboot_start = sim_now_us();
+    bool back = false;
+    while (sim_now_us() - reboot_start < SETTLE_TIMEOUT_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        node_info_t *node = node_manager_get_node(s_ota_mac);
+        if (sim_fw_boots(target) > boots && sim_mesh_node_joined(target) &&
+            node != NULL && node->status == NODE_STATUS_ONLINE) {
+            back = true;
+            break;
+        }
+    }
+    double rejoin_s = (sim_now_us() - reboot_start) / 1e6;
+    vTaskDelay(pdMS_TO_TICKS(REPLY_WAIT_MS));
+
+    static const char *state_names[] = {
+        "idle", "starting", "sending", "finishing", "complete", "failed", "aborted"
+    };
+    sim_idf_node_stats_t node_stats;
+    sim_idf_get_node_stats(target, &node_stats);
+    const char *running = sim_idf_running_version(target, "factory");
+
+    cJSON_AddNumberToObject(json, "target_layer", target_layer);
+    cJSON_AddNumberToObject(json, "bytes", (double)size);
+    cJSON_AddStringToObject(json, "state", state_names[s_ota_info.state]);
+    cJSON_AddNumberToObject(json, "seconds", seconds);
+    cJSON_AddNumberToObject(json, "kbytes_per_s", seconds > 0 ? size / 1024.0 / seconds : 0);
+    cJSON_AddNumberToObject(json, "chunks", s_ota_info.total_chunks);
+    cJSON_AddNumberToObject(json, "chunk_retries", s_ota_info.chunk_retries);
+    cJSON_AddNumberToObject(json, "node_sectors_erased", node_stats.sectors_erased);
+    cJSON_AddStringToObject(json, "running_version", running);
+    cJSON_AddStringToObject(json, "running_slot", sim_idf_running_label(target));
+    node_info_t *node = node_manager_get_node(s_ota_mac);
+    cJSON_AddStringToObject(json, "reported_version", node ? node->firmware_version : "");
+    cJSON_AddNumberToObject(json, "rejoin_s", rejoin_s);
+    cJSON *commands = cJSON_CreateObject();
+    add_commands(commands, sent, total_actuations() - actuations);
+    cJSON_AddItemToObject(json, "commands", commands);
+    add_rx_waits(json, mark);
+
+    check(s_ota_info.state == NODE_OTA_STATE_COMPLETE, "ota: transfer did not complete");
+    check(strcmp(running, OTA_VERSION) == 0, "ota: node is not running the new image");
+    check(node != NULL && strcmp(node->firmware_version, OTA_VERSION) == 0,
+          "ota: gateway does not see the new version");
+    check(back, "ota: node did not come back after the reboot");
+    free(others);
+    return json;
+}
+
+static cJSON *scenario_fleet(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    size_t size = (size_t)s_opt.ota_kb * 1024;
+    esp_err_t ret = stage_image(NULL, size);
+    fleet_ota_config_t config = {
+        .canary_count = FLEET_CANARIES,
+        .max_concurrency = NODE_OTA_MAX_SESSIONS,
+    };
+    snprintf(config.version, sizeof(config.version), "%s", OTA_VERSION);
+    if (ret == ESP_OK) {
+        ret = fleet_ota_start(&config, NULL, 0);
+    }
+    if (ret != ESP_OK) {
+        cJSON_AddStringToObject(json, "error", esp_err_to_name(ret));
+        check(false, "fleet: rollout did not start");
+        return json;
+    }
+
+    sim_mesh_stats_t before;
+    sim_mesh_get_stats(&before);
+    int64_t start = sim_now_us();
+    uint8_t peak_concurrency = 0;
+    while (fleet_ota_is_active() && sim_now_us() - start < FLEET_TIMEOUT_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        uint8_t concurrency = fleet_ota_get_status()->concurrency;
+        if (concurrency > peak_concurrency) peak_concurrency = concurrency;
+    }
+    const fleet_ota_status_t *status = fleet_ota_get_status();
+    bool finished = !fleet_ota_is_active();
+    if (!finished) fleet_ota_abort();
+
+    // Time from the start to the last node of each layer, in the order the rollout went
+    int64_t layer_done_ms[TOPOLOGY_MAX_DEPTH + 1] = { 0 };
+    int layer_nodes[TOPOLOGY_MAX_DEPTH + 1] = { 0 };
+    int max_layer = 0;
+    for (int i = 0; i < status->target_count; i++) {
+        const fleet_target_t *t = &status->targets[i];
+        int layer = t->layer <= TOPOLOGY_MAX_DEPTH ? t->layer : 0;
+        layer_nodes[layer]++;
+        if (t->finished_at - status->start_time > layer_done_ms[layer]) {
+            layer_done_ms[layer] = t->finished_at - status->start_time;
+        }
+        if (layer > max_layer) max_layer = layer;
+    }
+    cJSON *layers = cJSON_CreateArray();
+    for (int layer = max_layer; layer >= 0; layer--) {
+        if (layer_nodes[layer] == 0) continue;
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "layer", layer);
+        cJSON_AddNumberToObject(entry, "nodes", layer_nodes[layer]);
+        cJSON_AddNumberToObject(entry, "done_s", layer_done_ms[layer] / 1e3);
+        cJSON_AddItemToArray(layers, entry);
+    }
+
+    int running = 0, reported = 0;
+    for (int i = 0; i < status->target_count; i++) {
+        int index = sim_mesh_find(status->targets[i].mac);
+        if (index > 0 && strcmp(sim_idf_running_version(index, "factory"), OTA_VERSION) == 0) running++;
+        node_info_t *node = node_manager_get_node(status->targets[i].mac);
+        if (node != NULL && strcmp(node->firmware_version, OTA_VERSION) == 0) reported++;
+    }
+    sim_mesh_stats_t after;
+    sim_mesh_get_stats(&after);
+
+    cJSON_AddNumberToObject(json, "bytes", (double)size);
+    cJSON_AddNumberToObject(json, "targets", status->target_count);
+    cJSON_AddNumberToObject(json, "mesh_layers", max_layer);
+    cJSON_AddNumberToObject(json, "total_s", (sim_now_us() - start) / 1e6);
+    cJSON_AddNumberToObject(json, "peak_concurrency", peak_concurrency);
+    cJSON_AddItemToObject(json, "layers", layers);
+    cJSON_AddNumberToObject(json, "running_new", running);
+    cJSON_AddNumberToObject(json, "reporting_new", reported);
+    cJSON_AddNumberToObject(json, "mesh_leaves", after.leaves - before.leaves);
+    cJSON_AddItemToObject(json, "status", fleet_ota_status_json(false));
+
+    check(finished, "fleet: rollout still running at the timeout");
+    check(status->state == FLEET_OTA_STATE_COMPLETE, "fleet: rollout did not complete");
+    check(status->target_count == expected_joined(s_commissioned), "fleet: nodes missing from the rollout");
+    check(running == status->target_count, "fleet: nodes not running the new image");
+    check(reported == status->target_count, "fleet: gateway does not see the new version everywhere");
+    return json;
+}
+
+static cJSON *scenario_scan(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    sim_mesh_stats_t before;
+    sim_mesh_get_stats(&before);
+
+    // Scan: the gateway moves to the discovery mesh and back, then publishes
+    s_scan_done = false;
+    int64_t start = sim_now_us();
+    sim_mqtt_publish(MQTT_TOPIC_SCAN, "{\"action\":\"start\"}");
+    while (!s_scan_done && sim_now_us() - start < SCAN_RESULT_TIMEOUT_MS * 1000LL) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    double scan_s = (sim_now_us() - start) / 1e6;
+    cJSON_AddBoolToObject(json, "results", s_scan_done);
+    cJSON_AddNumberToObject(json, "scan_s", scan_s);
+    cJSON_AddNumberToObject(json, "found", s_scan_found);
+    cJSON_AddNumberToObject(json, "found_uncommissioned", s_scan_fresh);
+    check(s_scan_done, "scan: no results published");
+    check(s_scan_fresh == s_opt.uncommissioned, "scan: did not find every uncommissioned node");
+
+    // Commission what the scan found, in one batch
+    if (s_scan_fresh > 0) {
+        cJSON *batch = cJSON_CreateObject();
+        cJSON *nodes = cJSON_CreateArray();
+        cJSON_AddItemToObject(batch, "nodes", nodes);
+        for (int i = 0; i < s_scan_fresh; i++) {
+            cJSON *node = cJSON_CreateObject();
+            char name[24];
+            snprintf(name, sizeof(name), "sim-%d", i + 1);
+            cJSON_AddStringToObject(node, "mac", s_scan_fresh_macs[i]);
+            cJSON_AddStringToObject(node, "name", name);
+            cJSON_AddItemToArray(nodes, node);
+        }
+        char *text = cJSON_PrintUnformatted(batch);
+        cJSON_Delete(batch);
+
+        s_batch_done = false;
+        int64_t batch_start = sim_now_us();
+        sim_mqtt_publish(MQTT_TOPIC_COMMISSION "/batch", text);
+        cJSON_free(text);
+        while (!s_batch_done && sim_now_us() - batch_start < BATCH_RESULT_TIMEOUT_MS * 1000LL) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        cJSON_AddNumberToObject(json, "batch_s", (sim_now_us() - batch_start) / 1e6);
+        cJSON_AddNumberToObject(json, "batch_ok", s_batch_ok);
+        cJSON_AddNumberToObject(json, "batch_failed", s_batch_failed);
+        // Nodes only count once they reach the production mesh, which may already be full
+        check(s_batch_done && s_batch_ok + s_batch_failed == s_scan_fresh, "scan: batch commissioning failed");
+        check(s_batch_ok == s_scan_fresh || s_commissioned >= expected_joined(s_opt.mesh.nodes),
+              "scan: batch commissioning failed with room in the mesh");
+        s_commissioned += s_batch_ok;
+    }
+
+    // Production nodes were dropped by the mesh switch; they (and the new ones) come back
+    int64_t settle_start = sim_now_us();
+    bool settled = wait_settled(expected_joined(s_commissioned), SETTLE_TIMEOUT_MS);
+    sim_mesh_stats_t after;
+    sim_mesh_get_stats(&after);
+    cJSON_AddNumberToObject(json, "recovered_s", (sim_now_us() - settle_start) / 1e6);
+    cJSON_AddNumberToObject(json, "total_s", (sim_now_us() - start) / 1e6);
+    cJSON_AddNumberToObject(json, "joined", after.joined);
+    cJSON_AddNumberToObject(json, "leaves", after.leaves - before.leaves);
+    cJSON_AddNumberToObject(json, "scans", after.scans - before.scans);
+    check(settled, "scan: production mesh did not come back");
+    return json;
+}
+
+/**
+ * Mesh nodes that are in the gateway's table and topology map, and online
+ * entries for nodes that have left
+ */
+static void add_gateway_view(cJSON *json, int *joined_out, int *known_out, int *stale_out)
+{
+    int count = 0;
+    node_info_t *nodes = node_manager_get_all(&count);
+    int joined = 0, known = 0, mapped = 0, stale = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        if (!sim_mesh_node_joined(i)) continue;
+        joined++;
+        node_info_t *node = node_manager_get_node(sim_mesh_node_mac(i));
+        if (node != NULL && node->status == NODE_STATUS_ONLINE) known++;
+        mesh_topology_node_t entry;
+        if (mesh_topology_get_node(sim_mesh_node_mac(i), &entry) == ESP_OK) mapped++;
+    }
+    for (int i = 0; i < count; i++) {
+        int index = sim_mesh_find(nodes[i].mac);
+        if (nodes[i].status == NODE_STATUS_ONLINE && (index <= 0 || !sim_mesh_node_joined(index))) stale++;
+    }
+    cJSON_AddNumberToObject(json, "joined", joined);
+    cJSON_AddNumberToObject(json, "gateway_nodes", count);
+    cJSON_AddNumberToObject(json, "gateway_online", known);
+    cJSON_AddNumberToObject(json, "gateway_stale", stale);
+    cJSON_AddNumberToObject(json, "topology_mapped", mapped);
+    *joined_out = joined;
+    *known_out = known < mapped ? known : mapped;
+    *stale_out = stale;
+}
+
+static cJSON *scenario_churn(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    sim_mesh_stats_t before;
+    sim_mesh_get_stats(&before);
+    mesh_topology_stats_t topo_before;
+    mesh_topology_get_stats(&topo_before);
+
+    // Every CHURN_INTERVAL_MS a random CHURN_PERCENT of the powered nodes lose power for a while
+    uint32_t cuts = 0;
+    int64_t end = sim_now_us() + (int64_t)s_opt.duration_s * 1000000;
+    while (sim_now_us() < end) {
+        for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+            if (!sim_fw_powered(i) || (int)(sim_rand_u32() % 100) >= CHURN_PERCENT) continue;
+            uint32_t off_ms = CHURN_OFF_MIN_MS + sim_rand_u32() % (CHURN_OFF_MAX_MS - CHURN_OFF_MIN_MS);
+            sim_fw_power_off(i);
+            sim_fw_power_on(i, sim_now_us() + (int64_t)off_ms * 1000);
+            cuts++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CHURN_INTERVAL_MS));
+    }
+
+    // Last nodes back on, then the gateway notices who is back and who left meanwhile
+    // (the offline timeout stretches with the path cost)
+    vTaskDelay(pdMS_TO_TICKS(CHURN_OFF_MAX_MS));
+    int64_t settle_start = sim_now_us();
+    bool settled = wait_settled(expected_joined(s_commissioned), SETTLE_TIMEOUT_MS);
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_GATEWAY_NODE_TIMEOUT_MS * TOPOLOGY_TIMEOUT_SCALE_MAX +
+                             2 * CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS));
+
+    sim_mesh_stats_t after;
+    sim_mesh_get_stats(&after);
+    mesh_topology_stats_t topo;
+    mesh_topology_get_stats(&topo);
+    cJSON_AddNumberToObject(json, "power_cuts", cuts);
+    cJSON_AddNumberToObject(json, "recovered_s", (sim_now_us() - settle_start) / 1e6);
+    cJSON_AddNumberToObject(json, "mesh_joins", after.joins - before.joins);
+    cJSON_AddNumberToObject(json, "mesh_leaves", after.leaves - before.leaves);
+    int joined, tracked, stale;
+    add_gateway_view(json, &joined, &tracked, &stale);
+    cJSON_AddNumberToObject(json, "topology_nodes", topo.node_count);
+    cJSON_AddNumberToObject(json, "topology_updates", topo.updates - topo_before.updates);
+
+    // Every node back in the mesh answers a command
+    int *targets = malloc(sizeof(int) * (s_opt.mesh.nodes + 1));
+    if (targets == NULL) abort();
+    int count = command_targets(targets, s_opt.mesh.nodes);
+    uint32_t actuations = total_actuations();
+    reset_commands();
+    for (int i = 0; i < count; i++) {
+        send_relay_cmd(targets[i]);
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    vTaskDelay(pdMS_TO_TICKS(REPLY_WAIT_MS));
+    cJSON *commands = cJSON_CreateObject();
+    add_commands(commands, count, total_actuations() - actuations);
+    cJSON_AddItemToObject(json, "command", commands);
+
+    int table = joined < MAX_NODES ? joined : MAX_NODES;
+    check(cuts > 0, "churn: no node lost power");
+    check(settled, "churn: mesh did not recover");
+    check(tracked >= table, "churn: gateway table or topology map missing nodes in the mesh");
+    check(stale == 0, "churn: gateway lists nodes that left as online");
+    check(total_actuations() - actuations == (uint32_t)count, "churn: relays did not switch once per command");
+    free(targets);
+    return json;
+}
+
+/**
+ * Boot reports the nodes sent in their heartbeat ACKs: how they joined,
+ * boot to connected, boot to first command
+ */
+static cJSON *boot_reports_json(void)
+{
+    int64_t *fast = malloc(sizeof(int64_t) * (s_opt.mesh.nodes + 1));
+    int64_t *scan = malloc(sizeof(int64_t) * (s_opt.mesh.nodes + 1));
+    int64_t *first_cmd = malloc(sizeof(int64_t) * (s_opt.mesh.nodes + 1));
+    if (fast == NULL || scan == NULL || first_cmd == NULL) abort();
+    size_t fast_count = 0, scan_count = 0, first_cmd_count = 0;
+    int fast_failed = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        node_info_t *node = node_manager_get_node(sim_mesh_node_mac(i));
+        if (node == NULL || !node->boot_reported || node->boot_connect_ms == 0) continue;
+        if (node->rejoin_mode == REJOIN_FAST) {
+            fast[fast_count++] = node->boot_connect_ms * 1000LL;
+        } else {
+            scan[scan_count++] = node->boot_connect_ms * 1000LL;
+            if (node->rejoin_mode == REJOIN_FAST_FAILED) fast_failed++;
+        }
+        if (node->boot_first_cmd_ms != 0) first_cmd[first_cmd_count++] = node->boot_first_cmd_ms * 1000LL;
+    }
+    qsort(fast, fast_count, sizeof(int64_t), cmp_i64);
+    qsort(scan, scan_count, sizeof(int64_t), cmp_i64);
+    qsort(first_cmd, first_cmd_count, sizeof(int64_t), cmp_i64);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "fast", (double)fast_count);
+    cJSON_AddNumberToObject(json, "scan", (double)scan_count);
+    cJSON_AddNumberToObject(json, "fast_failed", fast_failed);
+    cJSON_AddNumberToObject(json, "first_cmd", (double)first_cmd_count);
+    add_percentiles_ms(json, "fast_connect", fast, fast_count);
+    add_percentiles_ms(json, "scan_connect", scan, scan_count);
+    add_percentiles_ms(json, "first_cmd", first_cmd, first_cmd_count);
+    free(fast);
+    free(scan);
+    free(first_cmd);
+    return json;
+}
+
+static cJSON *scenario_restore(void)
+{
+    cJSON *json = cJSON_CreateObject();
+
+    // The nodes' last boot as their heartbeat ACKs report it: the first
+    // power-on, with nothing cached, unless an earlier scenario rebooted them
+    vTaskDelay(pdMS_TO_TICKS(2 * CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS));
+    cJSON_AddItemToObject(json, "before", boot_reports_json());
+
+    // The nodes in the mesh now are the ones to command afterwards
+    int *targets = malloc(sizeof(int) * (s_opt.mesh.nodes + 1));
+    uint32_t *actuations = malloc(sizeof(uint32_t) * (s_opt.mesh.nodes + 1));
+    if (targets == NULL || actuations == NULL) abort();
+    int count = 0, powered = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        if (sim_mesh_node_joined(i)) targets[count++] = i;
+        if (!sim_fw_powered(i)) continue;
+        sim_fw_power_off(i);
+        powered++;
+    }
+    vTaskDelay(pdMS_TO_TICKS(RESTORE_OFF_MS));
+
+    // Power back everywhere at once. The backend keeps toggling every node
+    // that has not switched yet, the way a user retries a dead switch. The
+    // relay driver sets its output on boot, so count from after that
+    int64_t start = sim_now_us();
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        sim_fw_power_on(i, start);
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+    for (int i = 0; i < count; i++) {
+        sim_idf_node_stats_t stats;
+        sim_idf_get_node_stats(targets[i], &stats);
+        actuations[targets[i]] = stats.actuations;
+    }
+    reset_commands();
+    uint32_t announces_before, matches_before;
+    node_manager_get_announce_stats(&announces_before, &matches_before, NULL);
+    uint32_t publishes_before = sim_mqtt_gateway_publishes();
+    uint32_t batches_before = s_online_batches, batched_before = s_online_batched;
+
+    // Controllable: the relay switched on a command, polled every 100 ms
+    int64_t *controllable = malloc(sizeof(int64_t) * (count + 1));
+    if (controllable == NULL) abort();
+    size_t controllable_count = 0;
+    int pending = count;
+    int64_t next_send = 0;
+    while (pending > 0 && sim_now_us() - start < RESTORE_TIMEOUT_MS * 1000LL) {
+        bool send = sim_now_us() >= next_send;
+        for (int i = 0; i < pending; i++) {
+            sim_idf_node_stats_t stats;
+            sim_idf_get_node_stats(targets[i], &stats);
+            if (stats.actuations != actuations[targets[i]]) {
+                controllable[controllable_count++] = sim_now_us() - start;
+                targets[i--] = targets[--pending];
+            } else if (send) {
+                send_relay_cmd(targets[i]);
+            }
+        }
+        if (send) next_send = sim_now_us() + SINGLE_INTERVAL_MS * 1000;
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    qsort(controllable, controllable_count, sizeof(int64_t), cmp_i64);
+
+    // Reports come with the next heartbeat ACK
+    bool settled = wait_settled(expected_joined(s_commissioned), SETTLE_TIMEOUT_MS);
+    vTaskDelay(pdMS_TO_TICKS(2 * CONFIG_GATEWAY_HEARTBEAT_INTERVAL_MS));
+    cJSON *restore = boot_reports_json();
+    int fast = cJSON_GetObjectItem(restore, "fast")->valueint;
+    int with_first_cmd = cJSON_GetObjectItem(restore, "first_cmd")->valueint;
+    cJSON_AddNumberToObject(json, "powered_off", powered);
+    cJSON_AddNumberToObject(json, "off_s", RESTORE_OFF_MS / 1e3);
+    cJSON_AddItemToObject(json, "restore", restore);
+    cJSON_AddNumberToObject(json, "unanswered", pending);
+    add_percentiles_ms(json, "controllable", controllable, controllable_count);
+    cJSON_AddNumberToObject(json, "fleet_controllable_s",
+                            pending == 0 && count > 0 ? controllable[count - 1] / 1e6 : -1);
+
+    // What the gateway made of the announces, and what reached the backend
+    uint32_t announces, matches, last_online_ms;
+    node_manager_get_announce_stats(&announces, &matches, &last_online_ms);
+    cJSON_AddNumberToObject(json, "announces", announces - announces_before);
+    cJSON_AddNumberToObject(json, "digest_matches", matches - matches_before);
+    cJSON_AddNumberToObject(json, "online_batches", s_online_batches - batches_before);
+    cJSON_AddNumberToObject(json, "online_batched_nodes", s_online_batched - batched_before);
+    cJSON_AddNumberToObject(json, "mqtt_publishes", sim_mqtt_gateway_publishes() - publishes_before);
+
+    check(settled, "restore: mesh did not come back");
+    check(pending == 0, "restore: nodes never switched after the restore");
+    check(fast > 0, "restore: no node rejoined through its cached parent");
+    check(with_first_cmd == count, "restore: nodes did not report their first command");
+    free(targets);
+    free(actuations);
+    free(controllable);
+    return json;
+}
+
+/**
+ * Mesh shape from the simulator's side, and one toggle to every node in
+ * turn for the round trips
+ */
+static cJSON *probe_mesh(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    int joined = 0, hops = 0, max_hops = 0, rssi_sum = 0, rssi_min = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        uint8_t bssid[6];
+        int8_t rssi;
+        if (!sim_mesh_node_link(i, bssid, &rssi)) continue;
+        int h = sim_mesh_node_layer(i) - 1;
+        joined++;
+        hops += h;
+        if (h > max_hops) max_hops = h;
+        rssi_sum += rssi;
+        if (joined == 1 || rssi < rssi_min) rssi_min = rssi;
+    }
+    cJSON_AddNumberToObject(json, "joined", joined);
+    cJSON_AddNumberToObject(json, "avg_hops", joined ? (double)hops / joined : 0);
+    cJSON_AddNumberToObject(json, "max_hops", max_hops);
+    cJSON_AddNumberToObject(json, "avg_parent_rssi", joined ? (double)rssi_sum / joined : 0);
+    cJSON_AddNumberToObject(json, "min_parent_rssi", rssi_min);
+
+    int *targets = malloc(sizeof(int) * (s_opt.mesh.nodes + 1));
+    if (targets == NULL) abort();
+    int count = command_targets(targets, s_opt.mesh.nodes);
+    uint32_t actuations = total_actuations();
+    reset_commands();
+    for (int i = 0; i < count; i++) {
+        send_relay_cmd(targets[i]);
+        vTaskDelay(pdMS_TO_TICKS(PROBE_INTERVAL_MS));
+    }
+    vTaskDelay(pdMS_TO_TICKS(REPLY_WAIT_MS));
+    qsort(s_cmd_latency_us, s_cmd_latency_count, sizeof(int64_t), cmp_i64);
+    cJSON_AddNumberToObject(json, "commands", count);
+    cJSON_AddNumberToObject(json, "replies", (double)s_cmd_latency_count);
+    cJSON_AddNumberToObject(json, "actuations", total_actuations() - actuations);
+    add_percentiles_ms(json, "round_trip", s_cmd_latency_us, s_cmd_latency_count);
+    cJSON_AddItemToObject(json, "gateway_latency", cmd_latency_json());
+    free(targets);
+    return json;
+}
+
+static cJSON *scenario_optimize(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    sim_mesh_stats_t before;
+    sim_mesh_get_stats(&before);
+
+    cJSON *first = probe_mesh();
+    double hops_before = cJSON_GetObjectItem(first, "avg_hops")->valuedouble;
+    int joined_before = cJSON_GetObjectItem(first, "joined")->valueint;
+    cJSON_AddItemToObject(json, "before", first);
+
+    vTaskDelay(pdMS_TO_TICKS(OPTIMIZE_RUN_MS));
+
+    cJSON *last = probe_mesh();
+    double hops_after = cJSON_GetObjectItem(last, "avg_hops")->valuedouble;
+    int joined_after = cJSON_GetObjectItem(last, "joined")->valueint;
+    cJSON_AddItemToObject(json, "after", last);
+
+    // A failed move leaves the node without a parent until it scans
+    sim_mesh_stats_t after;
+    sim_mesh_get_stats(&after);
+    mesh_optimizer_stats_t stats;
+    mesh_optimizer_get_stats(&stats);
+    cJSON_AddNumberToObject(json, "leaves", after.leaves - before.leaves);
+    cJSON_AddItemToObject(json, "optimizer", mesh_optimizer_json());
+
+    // Weak links lose commands, so the probes only compare
+    check(stats.moves_ok > 0, "optimize: no node was moved");
+    check(hops_after <= hops_before, "optimize: paths got longer");
+    check(joined_after >= joined_before, "optimize: nodes left the mesh");
+    return json;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --nodes N             virtual nodes (default 50, max %d)\n"
+            "  --seed N              random seed (default 1)\n"
+            "  --topology T          random | bfs | house (default random)\n"
+            "  --route-table N       devices the mesh admits, gateway included (default %d)\n"
+            "  --latency-ms X        per hop latency (default 2)\n"
+            "  --jitter-ms X         per hop jitter, uniform (default 1)\n"
+            "  --loss P              per hop loss probability (default 0)\n"
+            "  --bandwidth-kbps N    per hop air rate (default 2000)\n"
+            "  --node-ms X           node time per frame (default 1)\n"
+            "  --mqtt-ms X           broker one-way latency (default 20)\n"
+            "  --uncommissioned K    last K nodes start factory-fresh (default 0)\n"
+            "  --duration-s N        length of the heartbeat, command and churn scenarios (default 60)\n"
+            "  --scenario S[,S...]   heartbeat | command | ota | scan | churn | optimize |\n"
+            "                        fleet | restore | all (default, all but optimize,\n"
+            "                        fleet and restore)\n"
+            "  --ota-kb N            node image size for the ota and fleet scenarios (default 256)\n"
+            "  --log L               gateway log: none | error | warn | info | debug (default warn)\n"
+            "  --node-log L          node log (default error)\n"
+            "  --module PATH         node firmware module (default the one built alongside)\n",
+            prog, SIM_MAX_NODES, CONFIG_MESH_ROUTE_TABLE_SIZE);
+}
+
+static esp_log_level_t parse_level(const char *prog, const char *arg)
+{
+    static const char *levels[] = { "none", "error", "warn", "info", "debug" };
+    for (int i = 0; i < 5; i++) {
+        if (strcmp(arg, levels[i]) == 0) return (esp_log_level_t)i;
+    }
+    usage(prog);
+    exit(1);
+}
+
+static int parse_scenarios(const char *prog, const char *arg)
+{
+    static const struct { const char *name; int bits; } names[] = {
+        { "heartbeat", SCENARIO_HEARTBEAT },
+        { "command",   SCENARIO_COMMAND },
+        { "ota",       SCENARIO_OTA },
+        { "scan",      SCENARIO_SCAN },
+        { "churn",     SCENARIO_CHURN },
+        { "optimize",  SCENARIO_OPTIMIZE },
+        { "fleet",     SCENARIO_FLEET },
+        { "restore",   SCENARIO_RESTORE },
+        { "all",       SCENARIO_ALL },
+    };
+    char list[128];
+    snprintf(list, sizeof(list), "%s", arg);
+
+    int scenarios = 0;
+    for (char *save = NULL, *name = strtok_r(list, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        int bits = 0;
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strcmp(name, names[i].name) == 0) bits = names[i].bits;
+        }
+        if (bits == 0) {
+            usage(prog);
+            exit(1);
+        }
+        scenarios |= bits;
+    }
+    return scenarios;
+}
+
+static void parse_options(int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        { "nodes",          required_argument, NULL, 'n' },
+        { "seed",           required_argument, NULL, 's' },
+        { "topology",       required_argument, NULL, 't' },
+        { "route-table",    required_argument, NULL, 'r' },
+        { "latency-ms",     required_argument, NULL, 'l' },
+        { "jitter-ms",      required_argument, NULL, 'j' },
+        { "loss",           required_argument, NULL, 'p' },
+        { "bandwidth-kbps", required_argument, NULL, 'b' },
+        { "node-ms",        required_argument, NULL, 'm' },
+        { "mqtt-ms",        required_argument, NULL, 'q' },
+        { "uncommissioned", required_argument, NULL, 'u' },
+        { "duration-s",     required_argument, NULL, 'd' },
+        { "scenario",       required_argument, NULL, 'c' },
+        { "ota-kb",         required_argument, NULL, 'o' },
+        { "log",            required_argument, NULL, 'v' },
+        { "node-log",       required_argument, NULL, 'V' },
+        { "module",         required_argument, NULL, 'M' },
+        { "help",           no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    s_opt = (options_t){
+        .mesh = {
+            .nodes = 50,
+            .topology = SIM_TOPO_RANDOM,
+            .route_table = CONFIG_MESH_ROUTE_TABLE_SIZE,
+            .latency_us = 2000,
+            .jitter_us = 1000,
+            .loss = 0.0,
+            .bandwidth_kbps = 2000,
+            .overhead_bytes = 60,
+            .scan_us = 1500000,
+            .assoc_us = 300000,
+            .loss_detect_us = 6000000,
+            .node_us = 1000,
+        },
+        .seed = 1,
+        .scenarios = SCENARIO_ALL,
+        .duration_s = 60,
+        .ota_kb = 256,
+        .uncommissioned = 0,
+        .mqtt_latency_us = 20000,
+        .log_level = ESP_LOG_WARN,
+        .node_log_level = ESP_LOG_ERROR,
+        .module = MESH_SIM_NODE_MODULE,
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': s_opt.mesh.nodes = atoi(optarg); break;
+            case 's': s_opt.seed = strtoull(optarg, NULL, 0); break;
+            case 'r': s_opt.mesh.route_table = atoi(optarg); break;
+            case 'l': s_opt.mesh.latency_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'j': s_opt.mesh.jitter_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'p': s_opt.mesh.loss = atof(optarg); break;
+            case 'b': s_opt.mesh.bandwidth_kbps = (uint32_t)atoi(optarg); break;
+            case 'm': s_opt.mesh.node_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'q': s_opt.mqtt_latency_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'u': s_opt.uncommissioned = atoi(optarg); break;
+            case 'd': s_opt.duration_s = atoi(optarg); break;
+            case 'o': s_opt.ota_kb = atoi(optarg); break;
+            case 'c': s_opt.scenarios = parse_scenarios(argv[0], optarg); break;
+            case 'v': s_opt.log_level = parse_level(argv[0], optarg); break;
+            case 'V': s_opt.node_log_level = parse_level(argv[0], optarg); break;
+            case 'M': s_opt.module = optarg; break;
+            case 't':
+                if (strcmp(optarg, "random") == 0) {
+                    s_opt.mesh.topology = SIM_TOPO_RANDOM;
+                } else if (strcmp(optarg, "bfs") == 0) {
+                    s_opt.mesh.topology = SIM_TOPO_BFS;
+                } else if (strcmp(optarg, "house") == 0) {
+                    s_opt.mesh.topology = SIM_TOPO_HOUSE;
+                } else {
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if (s_opt.mesh.nodes < 1 || s_opt.mesh.nodes > SIM_MAX_NODES || s_opt.mesh.route_table < 2 ||
+        s_opt.mesh.bandwidth_kbps == 0 || s_opt.mesh.loss < 0 || s_opt.mesh.loss >= 1 ||
+        s_opt.uncommissioned < 0 || s_opt.uncommissioned > s_opt.mesh.nodes ||
+        s_opt.duration_s < 1 || s_opt.ota_kb < 1) {
+        usage(argv[0]);
+        exit(1);
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Commissioned nodes carry the production credentials, as after a scan
+ */
+static void seed_nodes(void)
+{
+    static const uint8_t network_id[6] = MESH_ID_PRODUCTION;
+    const uint8_t commissioned = 1;
+
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        if (!is_commissioned(i)) continue;
+        char name[24];
+        snprintf(name, sizeof(name), "node-%d", i);
+        sim_nvs_seed_blob(i, "omniapi_node", "commissioned", &commissioned, sizeof(commissioned));
+        sim_nvs_seed_blob(i, "omniapi_node", "network_id", network_id, sizeof(network_id));
+        sim_nvs_seed_str(i, "omniapi_node", "network_key", MESH_PASSWORD_PRODUCTION);
+        sim_nvs_seed_str(i, "omniapi_node", "plant_id", "sim-plant");
+        sim_nvs_seed_str(i, "omniapi_node", "node_name", name);
+    }
+}
+
+static void start_gateway(void)
+{
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    // Same order as app_main
+    ESP_ERROR_CHECK(node_manager_init());
+    ESP_ERROR_CHECK(mesh_topology_init());
+    ESP_ERROR_CHECK(mesh_optimizer_init());
+    ESP_ERROR_CHECK(cmd_latency_init());
+    ESP_ERROR_CHECK(commissioning_init());
+    ESP_ERROR_CHECK(fleet_ota_init());
+    ESP_ERROR_CHECK(mesh_network_init());
+    mesh_network_set_rx_cb(mesh_router_handle_rx);
+    mesh_network_set_child_connected_cb(on_mesh_child_connected);
+    mesh_network_set_child_disconnected_cb(on_mesh_child_disconnected);
+    mesh_network_set_router_cb(on_router_state_changed);
+    ESP_ERROR_CHECK(mesh_network_start());
+    ESP_ERROR_CHECK(node_ota_init());
+    ESP_ERROR_CHECK(mqtt_handler_init());
+    ESP_ERROR_CHECK(mqtt_handler_start());
+
+    xTaskCreate(gateway_task, "gateway_task", 8192, NULL, 5, NULL);
+    xTaskCreate(heartbeat_task, "heartbeat_task", 4096, NULL, 4, NULL);
+}
+
+static cJSON *config_json(void)
+{
+    const sim_mesh_config_t *mesh = &s_opt.mesh;
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "nodes", mesh->nodes);
+    cJSON_AddNumberToObject(json, "uncommissioned", s_opt.uncommissioned);
+    cJSON_AddNumberToObject(json, "seed", (double)s_opt.seed);
+    static const char *topologies[] = { "random", "bfs", "house" };
+    cJSON_AddStringToObject(json, "topology", topologies[mesh->topology]);
+    cJSON_AddNumberToObject(json, "route_table", mesh->route_table);
+    cJSON_AddNumberToObject(json, "latency_ms", mesh->latency_us / 1000.0);
+    cJSON_AddNumberToObject(json, "jitter_ms", mesh->jitter_us / 1000.0);
+    cJSON_AddNumberToObject(json, "loss", mesh->loss);
+    cJSON_AddNumberToObject(json, "bandwidth_kbps", mesh->bandwidth_kbps);
+    cJSON_AddNumberToObject(json, "node_ms", mesh->node_us / 1000.0);
+    cJSON_AddNumberToObject(json, "mqtt_ms", s_opt.mqtt_latency_us / 1000.0);
+    cJSON_AddNumberToObject(json, "duration_s", s_opt.duration_s);
+    return json;
+}
+
+static cJSON *mesh_json(int64_t formed_us)
+{
+    sim_mesh_stats_t stats;
+    sim_mesh_get_stats(&stats);
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "joined", stats.joined);
+    cJSON_AddNumberToObject(json, "max_layer", stats.max_layer);
+    cJSON_AddNumberToObject(json, "formed_ms", formed_us / 1000.0);
+    cJSON_AddNumberToObject(json, "gateway_nodes", node_manager_get_count());
+    cJSON_AddNumberToObject(json, "gateway_online", gateway_online());
+    cJSON_AddNumberToObject(json, "frames_sent", stats.frames_sent);
+    cJSON_AddNumberToObject(json, "frames_lost", stats.frames_lost);
+    cJSON_AddNumberToObject(json, "bytes_on_air", (double)stats.bytes_on_air);
+    cJSON_AddNumberToObject(json, "rx_frames", stats.rx_frames);
+    cJSON_AddNumberToObject(json, "rx_echo", stats.rx_echo);
+    cJSON_AddNumberToObject(json, "rx_queue_peak", stats.rx_queue_peak);
+    cJSON_AddNumberToObject(json, "routing_truncated", stats.routing_truncated);
+    cJSON_AddNumberToObject(json, "joins", stats.joins);
+    cJSON_AddNumberToObject(json, "leaves", stats.leaves);
+    cJSON_AddNumberToObject(json, "scans", stats.scans);
+    cJSON_AddNumberToObject(json, "scans_empty", stats.scans_empty);
+    cJSON_AddNumberToObject(json, "mqtt_publishes", sim_mqtt_gateway_publishes());
+    cJSON_AddNumberToObject(json, "state_messages", s_state_messages);
+
+    // The gateway's own view (GET /api/mesh)
+    mesh_stats_t gateway;
+    mesh_network_get_stats(&gateway);
+    cJSON_AddNumberToObject(json, "gateway_rx_batch_max", gateway.rx_batch_max);
+    cJSON_AddNumberToObject(json, "gateway_rx_backlog_max", gateway.rx_backlog_max);
+    return json;
+}
+
+/**
+ * What the nodes went through: reboots, relay outputs, NVS wear
+ */
+static cJSON *nodes_json(void)
+{
+    uint32_t boots = 0, nvs_writes = 0, nvs_writes_max = 0, actuations = 0, dropped = 0;
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        sim_idf_node_stats_t stats;
+        sim_idf_get_node_stats(i, &stats);
+        boots += sim_fw_boots(i);
+        actuations += stats.actuations;
+        dropped += stats.events_dropped;
+        uint32_t writes = sim_nvs_writes(i);
+        nvs_writes += writes;
+        if (writes > nvs_writes_max) nvs_writes_max = writes;
+    }
+
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "boots", boots);
+    cJSON_AddNumberToObject(json, "actuations", actuations);
+    cJSON_AddNumberToObject(json, "nvs_writes", nvs_writes);
+    cJSON_AddNumberToObject(json, "nvs_writes_max", nvs_writes_max);
+    cJSON_AddNumberToObject(json, "events_dropped", dropped);
+    return json;
+}
+
+int main(int argc, char **argv)
+{
+    parse_options(argc, argv);
+
+    sim_log_set_level(s_opt.log_level, s_opt.node_log_level);
+    sim_rand_seed(s_opt.seed);
+    sim_rtos_init();
+    sim_idf_init(s_opt.mesh.nodes + 1);
+    sim_nvs_init(s_opt.mesh.nodes + 1);
+    sim_mesh_configure(&s_opt.mesh);
+    sim_mqtt_configure(s_opt.mqtt_latency_us, 200000);
+    sim_fw_init(s_opt.module, s_opt.mesh.nodes);
+    seed_nodes();
+
+    s_cmd_pending_us = calloc(s_opt.mesh.nodes + 1, sizeof(int64_t));
+    s_scan_fresh_macs = calloc(s_opt.mesh.nodes + 1, sizeof(s_scan_fresh_macs[0]));
+    if (s_cmd_pending_us == NULL || s_scan_fresh_macs == NULL) abort();
+    sim_mqtt_subscribe(MQTT_TOPIC_NODES "/+/state", on_node_state);
+    sim_mqtt_subscribe(MQTT_TOPIC_NODES_ONLINE, on_nodes_online);
+    sim_mqtt_subscribe("omniapi/gateway/+/scan/results", on_scan_results);
+    sim_mqtt_subscribe("omniapi/gateway/+/commission/batch/result", on_batch_result);
+
+    start_gateway();
+
+    // Every node switched on at once, as after a power cut
+    for (int i = 1; i <= s_opt.mesh.nodes; i++) {
+        sim_fw_power_on(i, sim_now_us());
+    }
+    s_commissioned = s_opt.mesh.nodes - s_opt.uncommissioned;
+    bool formed = wait_settled(expected_joined(s_commissioned), FORM_TIMEOUT_MS);
+    int64_t formed_us = sim_now_us();
+    sim_mesh_stats_t stats;
+    sim_mesh_get_stats(&stats);
+    ESP_LOGI(TAG, "Mesh formed: %d joined, %d layers, %d online at the gateway",
+             stats.joined, stats.max_layer, gateway_online());
+    check(formed, "formation: nodes still missing at the timeout");
+
+    cJSON *report = cJSON_CreateObject();
+    cJSON_AddItemToObject(report, "config", config_json());
+
+    // First, while the mesh still has the shape it formed in
+    if (s_opt.scenarios & SCENARIO_OPTIMIZE) {
+        cJSON_AddItemToObject(report, "optimize", scenario_optimize());
+    }
+    if (s_opt.scenarios & SCENARIO_HEARTBEAT) {
+        cJSON_AddItemToObject(report, "heartbeat", scenario_heartbeat());
+    }
+    if (s_opt.scenarios & SCENARIO_COMMAND) {
+        cJSON_AddItemToObject(report, "command", scenario_command());
+    }
+    if (s_opt.scenarios & SCENARIO_OTA) {
+        cJSON_AddItemToObject(report, "ota", scenario_ota());
+    }
+    if (s_opt.scenarios & SCENARIO_FLEET) {
+        cJSON_AddItemToObject(report, "fleet", scenario_fleet());
+    }
+    if (s_opt.scenarios & SCENARIO_SCAN) {
+        cJSON_AddItemToObject(report, "scan", scenario_scan());
+    }
+    if (s_opt.scenarios & SCENARIO_CHURN) {
+        cJSON_AddItemToObject(report, "churn", scenario_churn());
+    }
+
+    if (s_opt.scenarios & SCENARIO_RESTORE) {
+        cJSON_AddItemToObject(report, "restore", scenario_restore());
+    }
+
+    cJSON_AddItemToObject(report, "mesh", mesh_json(formed_us));
+    cJSON_AddItemToObject(report, "nodes", nodes_json());
+    cJSON_AddNumberToObject(report, "failures", s_failures);
+    cJSON_AddNumberToObject(report, "virtual_s", sim_now_us() / 1e6);
+
+    char *text = cJSON_Print(report);
+    printf("%s\n", text);
+    fflush(stdout);
+    cJSON_free(text);
+    cJSON_Delete(report);
+
+    // Other tasks never return; leave without unwinding them
+    _exit(s_failures ? 1 : 0);
+}
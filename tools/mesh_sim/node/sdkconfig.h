@@ -0,0 +1,27 @@
+/**
+ * OmniaPi Mesh Simulator - sdkconfig for the node firmware host build
+ *
+ * Values follow the node_mesh Kconfig defaults (relay node, UART module).
+ */
+
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_FREERTOS_HZ                      1000
+#define CONFIG_MESH_ROUTER_SSID                 "Porte Di Durin"
+#define CONFIG_MESH_ROUTER_PASSWD               "Mellon!!!"
+#define CONFIG_MESH_CHANNEL                     0
+#define CONFIG_MESH_AP_PASSWD                   "omniapi_mesh_2024"
+#define CONFIG_MESH_MAX_LAYER                   6
+#define CONFIG_MESH_AP_CONNECTIONS              6
+#define CONFIG_NODE_REJOIN_JITTER_MS            2000
+#define CONFIG_NODE_DEVICE_TYPE_RELAY           1
+#define CONFIG_RELAY_COUNT                      1
+#define CONFIG_RELAY_CH1_GPIO                   2
+#define CONFIG_RELAY_ACTIVE_HIGH                1
+#define CONFIG_RELAY_UART_TX_GPIO               21
+#define CONFIG_RELAY_UART_BAUD                  9600
+#define CONFIG_NODE_FIRMWARE_VERSION            "1.1.3"
+#define CONFIG_NODE_HEARTBEAT_RESPONSE_TIMEOUT_MS 15000
+
+#endif // SDKCONFIG_H
@@ -0,0 +1,109 @@
+/**
+ * OmniaPi Mesh Simulator - Node Board Stand-ins
+ *
+ * Linked into the node firmware module next to the real node_mesh sources,
+ * in place of the parts that only talk to the board: the status LED, the
+ * button, and the ESP-NOW fast path (off, so every frame goes over the
+ * mesh). The app description reports the version of the image the node
+ * booted, so an OTA shows up the way it does on the chip.
+ */
+
+#include "sim.h"
+#include "mesh_fastpath.h"
+#include "status_led.h"
+#include "button_handler.h"
+#include "esp_app_desc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+// ============================================================================
+// ESP-NOW Fast Path (off)
+// ============================================================================
+
+esp_err_t mesh_fastpath_init(void)
+{
+    return ESP_OK;
+}
+
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password)
+{
+}
+
+void mesh_fastpath_set_root(const uint8_t *root_ap_mac)
+{
+}
+
+esp_err_t mesh_fastpath_send(const uint8_t *data, size_t len)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool mesh_fastpath_recv(uint8_t *buf, size_t *len)
+{
+    return false;
+}
+
+bool mesh_fastpath_take_fallback(uint8_t *buf, size_t *len)
+{
+    return false;
+}
+
+void mesh_fastpath_wait(TickType_t ticks)
+{
+    vTaskDelay(ticks);
+}
+
+// ============================================================================
+// Status LED and Button
+// ============================================================================
+
+static status_led_pattern_t s_pattern = STATUS_LED_OFF;
+
+esp_err_t status_led_init(void)
+{
+    s_pattern = STATUS_LED_BOOT;
+    return ESP_OK;
+}
+
+void status_led_set(status_led_pattern_t pattern)
+{
+    s_pattern = pattern;
+}
+
+status_led_pattern_t status_led_get(void)
+{
+    return s_pattern;
+}
+
+void status_led_deinit(void)
+{
+    s_pattern = STATUS_LED_OFF;
+}
+
+esp_err_t button_handler_init(void)
+{
+    return ESP_OK;
+}
+
+void button_handler_set_short_press_cb(void (*cb)(void))
+{
+}
+
+void button_handler_set_long_press_cb(void (*cb)(void))
+{
+}
+
+// ============================================================================
+// App Description
+// ============================================================================
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+    static esp_app_desc_t desc = {
+        .project_name = "omniapi_node_mesh",
+    };
+    const char *version = sim_idf_running_version(sim_rtos_node(), CONFIG_NODE_FIRMWARE_VERSION);
+    strncpy(desc.version, version, sizeof(desc.version) - 1);
+    return &desc;
+}
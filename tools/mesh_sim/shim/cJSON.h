@@ -0,0 +1,62 @@
+/**
+ * OmniaPi Mesh Simulator - cJSON shim
+ *
+ * The part of the cJSON API the linked gateway modules and the report use,
+ * implemented in sim_json.c.
+ */
+
+#ifndef CJSON_H
+#define CJSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define cJSON_Invalid   0
+#define cJSON_False     (1 << 0)
+#define cJSON_True      (1 << 1)
+#define cJSON_NULL      (1 << 2)
+#define cJSON_Number    (1 << 3)
+#define cJSON_String    (1 << 4)
+#define cJSON_Array     (1 << 5)
+#define cJSON_Object    (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON *next;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+cJSON *cJSON_CreateObject(void);
+cJSON *cJSON_CreateArray(void);
+cJSON *cJSON_CreateNumber(double num);
+cJSON *cJSON_CreateString(const char *string);
+cJSON *cJSON_CreateBool(bool boolean);
+cJSON *cJSON_CreateNull(void);
+bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
+bool cJSON_AddItemToArray(cJSON *array, cJSON *item);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, bool boolean);
+cJSON *cJSON_AddNullToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name);
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+int cJSON_GetArraySize(const cJSON *array);
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index);
+bool cJSON_IsString(const cJSON *item);
+bool cJSON_IsNumber(const cJSON *item);
+bool cJSON_IsArray(const cJSON *item);
+bool cJSON_IsObject(const cJSON *item);
+bool cJSON_IsBool(const cJSON *item);
+bool cJSON_IsTrue(const cJSON *item);
+cJSON *cJSON_Parse(const char *value);
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length);
+char *cJSON_Print(const cJSON *item);
+char *cJSON_PrintUnformatted(const cJSON *item);
+void cJSON_Delete(cJSON *item);
+void cJSON_free(void *object);
+
+#endif // CJSON_H
@@ -0,0 +1,27 @@
+/**
+ * OmniaPi Mesh Simulator - driver/gpio.h shim
+ *
+ * Output levels are recorded per device (sim_idf_actuations).
+ */
+
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_DISABLE,
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+    GPIO_MODE_INPUT_OUTPUT,
+} gpio_mode_t;
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num);
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+
+#endif // DRIVER_GPIO_H
@@ -0,0 +1,12 @@
+/**
+ * OmniaPi Mesh Simulator - esp_cpu.h shim
+ */
+
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#include <stdint.h>
+
+uint32_t esp_cpu_get_cycle_count(void);
+
+#endif // ESP_CPU_H
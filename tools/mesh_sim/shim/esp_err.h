@@ -0,0 +1,66 @@
+/**
+ * OmniaPi Mesh Simulator - esp_err.h shim
+ */
+
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+typedef int esp_err_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NO_MEM              0x101
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_STATE       0x103
+#define ESP_ERR_INVALID_SIZE        0x104
+#define ESP_ERR_NOT_FOUND           0x105
+#define ESP_ERR_NOT_SUPPORTED       0x106
+#define ESP_ERR_TIMEOUT             0x107
+#define ESP_ERR_INVALID_RESPONSE    0x108
+#define ESP_ERR_INVALID_CRC         0x109
+#define ESP_ERR_INVALID_VERSION     0x10A
+#define ESP_ERR_INVALID_MAC         0x10B
+#define ESP_ERR_NOT_FINISHED        0x10C
+
+#define ESP_ERR_NVS_BASE                0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED     (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND           (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_TYPE_MISMATCH       (ESP_ERR_NVS_BASE + 0x03)
+#define ESP_ERR_NVS_READ_ONLY           (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_INVALID_NAME        (ESP_ERR_NVS_BASE + 0x06)
+#define ESP_ERR_NVS_INVALID_HANDLE      (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_KEY_TOO_LONG        (ESP_ERR_NVS_BASE + 0x09)
+#define ESP_ERR_NVS_INVALID_LENGTH      (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES       (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND   (ESP_ERR_NVS_BASE + 0x10)
+
+#define ESP_ERR_OTA_BASE                0x1500
+#define ESP_ERR_OTA_SELECT_INFO_INVALID (ESP_ERR_OTA_BASE + 0x02)
+#define ESP_ERR_OTA_VALIDATE_FAILED     (ESP_ERR_OTA_BASE + 0x03)
+
+#define ESP_ERR_WIFI_BASE           0x3000
+#define ESP_ERR_WIFI_NOT_CONNECT    (ESP_ERR_WIFI_BASE + 15)
+#define ESP_ERR_MESH_BASE           0x4000
+#define ESP_ERR_MESH_NOT_START      (ESP_ERR_MESH_BASE + 8)
+#define ESP_ERR_MESH_ARGUMENT       (ESP_ERR_MESH_BASE + 9)
+#define ESP_ERR_MESH_DISCONNECTED   (ESP_ERR_MESH_BASE + 11)
+#define ESP_ERR_MESH_TIMEOUT        (ESP_ERR_MESH_BASE + 12)
+#define ESP_ERR_MESH_NO_ROUTE_FOUND (ESP_ERR_MESH_BASE + 16)
+
+const char *esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) do {                                             \
+        esp_err_t err_rc_ = (x);                                            \
+        if (err_rc_ != ESP_OK) {                                            \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: %s at %s:%d (%s)\n",   \
+                    esp_err_to_name(err_rc_), __FILE__, __LINE__, #x);      \
+            abort();                                                        \
+        }                                                                   \
+    } while (0)
+
+#endif // ESP_ERR_H
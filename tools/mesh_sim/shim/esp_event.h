@@ -0,0 +1,37 @@
+/**
+ * OmniaPi Mesh Simulator - esp_event.h shim
+ *
+ * Every device has its own default loop: a "sys_evt" task that runs the
+ * handlers the device registered, one posted event at a time, as the IDF
+ * default event loop does. Events posted before the loop exists are dropped.
+ */
+
+#ifndef ESP_EVENT_H
+#define ESP_EVENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *event_handler_arg, esp_event_base_t event_base,
+                                    int32_t event_id, void *event_data);
+
+#define ESP_EVENT_ANY_ID    -1
+
+extern esp_event_base_t const MESH_EVENT;
+extern esp_event_base_t const IP_EVENT;
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg);
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler);
+
+/**
+ * Queue an event on device node's loop; event_data is copied (simulator only)
+ */
+void sim_event_post(int node, esp_event_base_t event_base, int32_t event_id,
+                    const void *event_data, size_t event_data_size);
+
+#endif // ESP_EVENT_H
@@ -0,0 +1,129 @@
+/**
+ * OmniaPi Mesh Simulator - esp_http_server.h shim (see sim_httpd.c)
+ *
+ * The subset webserver.c uses, with the ESP-IDF names, defaults and
+ * limits. Handlers run in the server task, one at a time.
+ */
+
+#ifndef ESP_HTTP_SERVER_H
+#define ESP_HTTP_SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+#define ESP_ERR_HTTPD_BASE              0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_TASK              (ESP_ERR_HTTPD_BASE + 8)
+
+#define HTTPD_MAX_URI_LEN       512
+#define HTTPD_RESP_USE_STRLEN   -1
+
+typedef void *httpd_handle_t;
+
+// As http_parser's enum (HTTP_DELETE is 0)
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_OPTIONS = 6,
+} httpd_method_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    const char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;
+    void *user_ctx;
+    void *sess_ctx;
+} httpd_req_t;
+
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t hd, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match,
+                                       size_t match_upto);
+
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;
+    uint16_t recv_wait_timeout;
+    bool keep_alive_enable;
+    int keep_alive_idle;
+    int keep_alive_interval;
+    int keep_alive_count;
+    httpd_open_func_t open_fn;
+    httpd_close_func_t close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {        \
+        .task_priority      = 5,        \
+        .stack_size         = 4096,     \
+        .server_port        = 80,       \
+        .max_open_sockets   = 7,        \
+        .max_uri_handlers   = 8,        \
+        .backlog_conn       = 5,        \
+        .lru_purge_enable   = false,    \
+        .recv_wait_timeout  = 5,        \
+        .keep_alive_enable  = false,    \
+        .open_fn            = NULL,     \
+        .close_fn           = NULL,     \
+        .uri_match_fn       = NULL,     \
+}
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *r);
+    void *user_ctx;
+    bool is_websocket;
+    bool handle_ws_control_frames;
+    const char *supported_subprotocol;
+} httpd_uri_t;
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT     = 0x1,
+    HTTPD_WS_TYPE_BINARY   = 0x2,
+    HTTPD_WS_TYPE_CLOSE    = 0x8,
+    HTTPD_WS_TYPE_PING     = 0x9,
+    HTTPD_WS_TYPE_PONG     = 0xA,
+} httpd_ws_type_t;
+
+typedef struct {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto);
+
+int httpd_req_to_sockfd(httpd_req_t *r);
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int sockfd);
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
+
+#endif // ESP_HTTP_SERVER_H
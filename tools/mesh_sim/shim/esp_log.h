@@ -0,0 +1,32 @@
+/**
+ * OmniaPi Mesh Simulator - esp_log.h shim
+ *
+ * Log lines go to stderr stamped with virtual time; the level is set with
+ * mesh_sim --log.
+ */
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdint.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+#define ESP_LOGE(tag, format, ...) sim_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) sim_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) sim_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) sim_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) sim_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
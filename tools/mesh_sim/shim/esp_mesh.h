@@ -0,0 +1,218 @@
+/**
+ * OmniaPi Mesh Simulator - esp_mesh.h shim
+ *
+ * The subset of the ESP-WIFI-MESH API the gateway and the nodes use,
+ * implemented over the simulated radio in sim_mesh.c.
+ */
+
+#ifndef ESP_MESH_H
+#define ESP_MESH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+
+typedef union {
+    uint8_t addr[6];
+} mesh_addr_t;
+
+typedef enum {
+    MESH_PROTO_BIN,
+    MESH_PROTO_HTTP,
+    MESH_PROTO_JSON,
+} mesh_proto_t;
+
+typedef enum {
+    MESH_TOS_P2P,
+    MESH_TOS_E2E,
+    MESH_TOS_DEF,
+} mesh_tos_t;
+
+typedef struct {
+    uint8_t *data;
+    uint16_t size;
+    mesh_proto_t proto;
+    mesh_tos_t tos;
+} mesh_data_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint8_t *val;
+} mesh_opt_t;
+
+typedef enum {
+    MESH_IDLE,
+    MESH_ROOT,
+    MESH_NODE,
+    MESH_LEAF,
+} mesh_type_t;
+
+typedef enum {
+    MESH_TOPO_TREE,
+    MESH_TOPO_CHAIN,
+} esp_mesh_topology_t;
+
+#define MESH_DATA_P2P       0x02
+#define MESH_DATA_FROMDS    0x04
+#define MESH_DATA_TODS      0x08
+
+typedef enum {
+    MESH_EVENT_STARTED,
+    MESH_EVENT_STOPPED,
+    MESH_EVENT_CHANNEL_SWITCH,
+    MESH_EVENT_CHILD_CONNECTED,
+    MESH_EVENT_CHILD_DISCONNECTED,
+    MESH_EVENT_ROUTING_TABLE_ADD,
+    MESH_EVENT_ROUTING_TABLE_REMOVE,
+    MESH_EVENT_PARENT_CONNECTED,
+    MESH_EVENT_PARENT_DISCONNECTED,
+    MESH_EVENT_NO_PARENT_FOUND,
+    MESH_EVENT_LAYER_CHANGE,
+    MESH_EVENT_TODS_STATE,
+    MESH_EVENT_VOTE_STARTED,
+    MESH_EVENT_VOTE_STOPPED,
+    MESH_EVENT_ROOT_ADDRESS,
+    MESH_EVENT_ROOT_SWITCH_REQ,
+    MESH_EVENT_ROOT_SWITCH_ACK,
+    MESH_EVENT_ROOT_ASKED_YIELD,
+    MESH_EVENT_ROOT_FIXED,
+    MESH_EVENT_SCAN_DONE,
+    MESH_EVENT_NETWORK_STATE,
+    MESH_EVENT_STOP_RECONNECTION,
+    MESH_EVENT_FIND_NETWORK,
+    MESH_EVENT_ROUTER_SWITCH,
+} mesh_event_id_t;
+
+typedef struct {
+    uint8_t channel;
+} mesh_event_channel_switch_t;
+
+typedef struct {
+    uint8_t aid;
+    uint8_t mac[6];
+} mesh_event_child_connected_t;
+
+typedef mesh_event_child_connected_t mesh_event_child_disconnected_t;
+
+typedef struct {
+    uint16_t rt_size_new;
+    uint16_t rt_size_change;
+} mesh_event_routing_table_change_t;
+
+typedef struct {
+    struct {
+        uint8_t ssid[32];
+        uint8_t ssid_len;
+        uint8_t bssid[6];
+        uint8_t channel;
+    } connected;
+    uint16_t self_layer;
+    uint8_t duty;
+} mesh_event_connected_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+} mesh_event_disconnected_t;
+
+typedef struct {
+    int new_layer;
+} mesh_event_layer_change_t;
+
+typedef mesh_addr_t mesh_event_root_address_t;
+
+typedef int mesh_event_toDS_state_t;
+
+typedef struct {
+    bool is_fixed;
+} mesh_event_root_fixed_t;
+
+typedef struct {
+    int scan_times;
+} mesh_event_no_parent_found_t;
+
+typedef struct {
+    uint8_t number;
+} mesh_event_scan_done_t;
+
+typedef struct {
+    uint8_t channel;
+    uint8_t router_bssid[6];
+} mesh_event_find_network_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t password[64];
+    bool allow_router_switch;
+} mesh_router_t;
+
+typedef struct {
+    uint8_t password[64];
+    uint8_t max_connection;
+    uint8_t nonmesh_max_connection;
+} mesh_ap_cfg_t;
+
+typedef struct {
+    uint8_t channel;
+    bool allow_channel_switch;
+    mesh_addr_t mesh_id;
+    mesh_router_t router;
+    mesh_ap_cfg_t mesh_ap;
+} mesh_cfg_t;
+
+typedef struct {
+    int toDS;
+    int toSelf;
+} mesh_rx_pending_t;
+
+typedef struct {
+    int to_parent;
+    int to_parent_p2p;
+    int to_child;
+    int to_child_p2p;
+    int mgmt;
+    int broadcast;
+} mesh_tx_pending_t;
+
+#define MESH_INIT_CONFIG_DEFAULT() { 0 }
+
+esp_err_t esp_mesh_init(void);
+esp_err_t esp_mesh_deinit(void);
+esp_err_t esp_mesh_start(void);
+esp_err_t esp_mesh_stop(void);
+esp_err_t esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data, int flag,
+                        const mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms, int *flag,
+                        mesh_opt_t opt[], int opt_count);
+esp_err_t esp_mesh_set_config(const mesh_cfg_t *config);
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo);
+esp_err_t esp_mesh_set_max_layer(int max_layer);
+esp_err_t esp_mesh_set_capacity_num(int num);
+int esp_mesh_get_capacity_num(void);
+esp_err_t esp_mesh_set_vote_percentage(float percentage);
+esp_err_t esp_mesh_set_xon_qsize(int qsize);
+esp_err_t esp_mesh_disable_ps(void);
+esp_err_t esp_mesh_set_ap_assoc_expire(int seconds);
+esp_err_t esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode);
+esp_err_t esp_mesh_set_type(mesh_type_t type);
+esp_err_t esp_mesh_fix_root(bool enable);
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent);
+esp_err_t esp_mesh_set_parent(const wifi_config_t *parent, const mesh_addr_t *parent_mesh_id,
+                              mesh_type_t my_type, int my_layer);
+esp_err_t esp_mesh_get_id(mesh_addr_t *id);
+int esp_mesh_get_layer(void);
+bool esp_mesh_is_root(void);
+esp_err_t esp_mesh_post_toDS_state(bool reachable);
+esp_err_t esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size);
+int esp_mesh_get_routing_table_size(void);
+esp_err_t esp_mesh_get_rx_pending(mesh_rx_pending_t *pending);
+esp_err_t esp_mesh_get_tx_pending(mesh_tx_pending_t *pending);
+
+#endif // ESP_MESH_H
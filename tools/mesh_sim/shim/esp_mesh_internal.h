@@ -0,0 +1,10 @@
+/**
+ * OmniaPi Mesh Simulator - esp_mesh_internal.h shim
+ */
+
+#ifndef ESP_MESH_INTERNAL_H
+#define ESP_MESH_INTERNAL_H
+
+#include "esp_mesh.h"
+
+#endif // ESP_MESH_INTERNAL_H
@@ -0,0 +1,61 @@
+/**
+ * OmniaPi Mesh Simulator - esp_now.h shim (lossy one-hop link, see sim_espnow.c)
+ *
+ * Callbacks run as scheduler events under the receiving or sending device,
+ * where ESP-IDF runs them in the WiFi task.
+ */
+
+#ifndef ESP_NOW_H
+#define ESP_NOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN        6
+#define ESP_NOW_MAX_DATA_LEN    250
+
+#define ESP_ERR_ESPNOW_BASE         0x3000
+#define ESP_ERR_ESPNOW_NOT_INIT     (ESP_ERR_ESPNOW_BASE + 1)
+#define ESP_ERR_ESPNOW_ARG          (ESP_ERR_ESPNOW_BASE + 2)
+#define ESP_ERR_ESPNOW_NO_MEM       (ESP_ERR_ESPNOW_BASE + 3)
+#define ESP_ERR_ESPNOW_FULL         (ESP_ERR_ESPNOW_BASE + 4)
+#define ESP_ERR_ESPNOW_NOT_FOUND    (ESP_ERR_ESPNOW_BASE + 5)
+#define ESP_ERR_ESPNOW_EXIST        (ESP_ERR_ESPNOW_BASE + 7)
+
+typedef enum {
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL,
+} esp_now_send_status_t;
+
+typedef struct {
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+} esp_now_peer_info_t;
+
+typedef struct {
+    uint8_t *src_addr;
+    uint8_t *des_addr;
+    int8_t rssi;
+} esp_now_recv_info_t;
+
+typedef struct {
+    const uint8_t *src_addr;
+    const uint8_t *des_addr;
+} wifi_tx_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const esp_now_recv_info_t *info, const uint8_t *data, int len);
+typedef void (*esp_now_send_cb_t)(const wifi_tx_info_t *info, esp_now_send_status_t status);
+
+esp_err_t esp_now_init(void);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer);
+bool esp_now_is_peer_exist(const uint8_t *peer_addr);
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len);
+
+#endif // ESP_NOW_H
@@ -0,0 +1,28 @@
+/**
+ * OmniaPi Mesh Simulator - esp_ota_ops.h shim
+ *
+ * Gateway: its two app slots, nothing is ever booted. Nodes: factory, ota_0
+ * and ota_1 per device, with the boot slot switched by
+ * esp_ota_set_boot_partition() taking effect on the next boot.
+ */
+
+#ifndef ESP_OTA_OPS_H
+#define ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN            0xffffffff
+#define OTA_WITH_SEQUENTIAL_WRITES  0xfffffffe
+
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_boot_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from);
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+
+#endif // ESP_OTA_OPS_H
@@ -0,0 +1,26 @@
+/**
+ * OmniaPi Mesh Simulator - esp_partition.h shim (RAM backed)
+ */
+
+#ifndef ESP_PARTITION_H
+#define ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+#endif // ESP_PARTITION_H
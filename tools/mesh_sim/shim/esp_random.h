@@ -0,0 +1,14 @@
+/**
+ * OmniaPi Mesh Simulator - esp_random.h shim (seeded, see sim_rand_u32)
+ */
+
+#ifndef ESP_RANDOM_H
+#define ESP_RANDOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+
+#endif // ESP_RANDOM_H
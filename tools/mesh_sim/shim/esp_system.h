@@ -0,0 +1,33 @@
+/**
+ * OmniaPi Mesh Simulator - esp_system.h shim
+ */
+
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+/**
+ * Reboot the calling node: its tasks and timers stop where they are and the
+ * firmware boots again (sim_fw.c). The gateway cannot restart in a run.
+ */
+void esp_restart(void) __attribute__((noreturn));
+esp_reset_reason_t esp_reset_reason(void);
+uint32_t esp_get_free_heap_size(void);
+
+#endif // ESP_SYSTEM_H
@@ -0,0 +1,10 @@
+/**
+ * OmniaPi Mesh Simulator - esp_transport.h shim (types only)
+ */
+
+#ifndef ESP_TRANSPORT_H
+#define ESP_TRANSPORT_H
+
+typedef struct esp_transport_item_t *esp_transport_handle_t;
+
+#endif // ESP_TRANSPORT_H
@@ -0,0 +1,70 @@
+/**
+ * OmniaPi Mesh Simulator - esp_wifi.h shim
+ */
+
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum {
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP,
+} wifi_interface_t;
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+} wifi_auth_mode_t;
+
+typedef enum {
+    WIFI_STORAGE_FLASH,
+    WIFI_STORAGE_RAM,
+} wifi_storage_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    bool bssid_set;
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_sta_config_t;
+
+typedef struct {
+    uint8_t ssid[32];
+    uint8_t password[64];
+    uint8_t channel;
+    uint8_t max_connection;
+} wifi_ap_config_t;
+
+typedef union {
+    wifi_ap_config_t ap;
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t ssid[33];
+    uint8_t primary;
+    int8_t rssi;
+} wifi_ap_record_t;
+
+typedef struct {
+    int static_rx_buf_num;
+    int dynamic_rx_buf_num;
+    int dynamic_tx_buf_num;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { .static_rx_buf_num = 10, .dynamic_rx_buf_num = 32, .dynamic_tx_buf_num = 32 }
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]);
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info);
+
+#endif // ESP_WIFI_H
@@ -0,0 +1,30 @@
+/**
+ * OmniaPi Mesh Simulator - FreeRTOS shim
+ *
+ * Tasks are coroutines run one at a time by the deterministic scheduler
+ * in sim_rtos.c; they switch only where FreeRTOS code would block.
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_system.h"          // IDF's portmacro.h pulls it in
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#endif // FREERTOS_H
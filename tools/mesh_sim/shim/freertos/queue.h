@@ -0,0 +1,13 @@
+/**
+ * OmniaPi Mesh Simulator - FreeRTOS queue shim (handle type only)
+ */
+
+#ifndef FREERTOS_QUEUE_H
+#define FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"      // As in FreeRTOS
+
+typedef struct QueueDefinition *QueueHandle_t;
+
+#endif // FREERTOS_QUEUE_H
@@ -0,0 +1,26 @@
+/**
+ * OmniaPi Mesh Simulator - FreeRTOS software timer shim
+ *
+ * Callbacks run on the virtual clock like esp_timer ones (sim_rtos.c).
+ */
+
+#ifndef FREERTOS_TIMERS_H
+#define FREERTOS_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"      // As in FreeRTOS
+
+typedef struct sim_timer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *timer_id, TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+
+#endif // FREERTOS_TIMERS_H
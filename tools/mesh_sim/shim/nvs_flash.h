@@ -0,0 +1,13 @@
+/**
+ * OmniaPi Mesh Simulator - nvs_flash.h shim
+ */
+
+#ifndef NVS_FLASH_H
+#define NVS_FLASH_H
+
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif // NVS_FLASH_H
@@ -0,0 +1,356 @@
+/**
+ * OmniaPi Mesh Simulator - Internal API
+ *
+ * Shared by the scheduler (sim_rtos.c), the IDF services (sim_idf.c,
+ * sim_nvs.c), the radio and esp_mesh shim (sim_mesh.c), the ESP-NOW link
+ * (sim_espnow.c), the HTTP server (sim_httpd.c), the MQTT broker
+ * (sim_mqtt.c), the node firmware loader (sim_fw.c) and the harnesses
+ * (mesh_sim.c, espnow_rt_sim.c, webserver_load_sim.c). All of it
+ * runs under the scheduler, one task or event at a time, so none of this
+ * state needs a lock.
+ *
+ * Device 0 is the gateway, linked into the executable. Devices 1..N are
+ * nodes, each running its own copy of the node_mesh firmware.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "cJSON.h"
+
+#define SIM_GATEWAY             0
+#define SIM_MAX_NODES           1024
+
+// ============================================================================
+// Scheduler (sim_rtos.c)
+// ============================================================================
+
+typedef void (*sim_event_fn_t)(void *arg);
+
+/**
+ * Turn the calling thread into the gateway's first task ("main") and start
+ * the clock at 0
+ */
+void sim_rtos_init(void);
+
+/**
+ * Run fn(arg) at virtual time at_us, under the device scheduling it (events
+ * at the same time run in the order they were scheduled, and before any
+ * task due at that time)
+ */
+void sim_event_at(int64_t at_us, sim_event_fn_t fn, void *arg);
+
+int64_t sim_now_us(void);
+
+/**
+ * Device the running code belongs to, and a way to act for another one
+ * (sim_rtos_enter returns the previous device for sim_rtos_leave)
+ */
+int sim_rtos_node(void);
+int sim_rtos_enter(int node);
+void sim_rtos_leave(int prev);
+
+/**
+ * False inside event and timer callbacks, which must not block
+ */
+bool sim_rtos_in_task(void);
+
+/**
+ * Hold the calling task for us of virtual time (CPU or flash work); no-op
+ * from a callback
+ */
+void sim_rtos_consume_us(int64_t us);
+
+/**
+ * Device node boots now: esp_timer_get_time() and the tick count restart at 0
+ */
+void sim_rtos_boot_node(int node);
+
+/**
+ * Drop every task and timer of device node where they stand. Does not
+ * return if the calling task is one of them.
+ */
+void sim_rtos_kill_node(int node);
+
+// ============================================================================
+// Random Numbers and Logging (sim_idf.c)
+// ============================================================================
+
+void sim_rand_seed(uint64_t seed);
+uint32_t sim_rand_u32(void);
+double sim_rand_unit(void);             // [0, 1)
+
+/**
+ * Log level for the gateway and for the nodes (node lines are prefixed
+ * with the node index)
+ */
+void sim_log_set_level(esp_log_level_t gateway, esp_log_level_t nodes);
+
+// ============================================================================
+// Per-Device IDF Services (sim_idf.c)
+// ============================================================================
+
+typedef struct {
+    uint32_t actuations;        // GPIO level changes and UART writes (relay outputs)
+    uint32_t sectors_erased;
+    uint32_t events_dropped;    // Posted before the device had an event loop
+} sim_idf_node_stats_t;
+
+void sim_idf_init(int devices);
+
+/**
+ * Flash timing: charged to the calling task on esp_partition_erase_range()
+ */
+void sim_idf_set_erase_us(uint32_t us_per_sector);
+
+/**
+ * Device powers up: picks the boot slot, records the reset reason.
+ * Power-off drops its event loop, handlers and queued events.
+ */
+void sim_idf_power_on(int node, esp_reset_reason_t reason);
+void sim_idf_power_off(int node);
+
+/**
+ * Called by esp_restart() on a node; must not return
+ */
+void sim_idf_set_restart_hook(void (*hook)(void));
+
+/**
+ * Version of the image device node is running: the esp_app_desc_t of an
+ * OTA slot if it has one, fallback for the factory image
+ */
+const char *sim_idf_running_version(int node, const char *fallback);
+const char *sim_idf_running_label(int node);
+
+void sim_idf_get_node_stats(int node, sim_idf_node_stats_t *stats);
+
+/**
+ * Offset and magic of the esp_app_desc_t in an app image, for the harness
+ * to build OTA images the node can report the version of
+ */
+#define SIM_APP_DESC_OFFSET     32
+#define SIM_APP_DESC_MAGIC      0xABCD5432u
+
+// ============================================================================
+// NVS (sim_nvs.c)
+// ============================================================================
+
+void sim_nvs_init(int devices);
+
+/**
+ * Write straight into a device's flash (harness setup: commissioned nodes)
+ */
+void sim_nvs_seed_blob(int node, const char *ns, const char *key, const void *data, size_t len);
+void sim_nvs_seed_str(int node, const char *ns, const char *key, const char *value);
+
+uint32_t sim_nvs_writes(int node);
+
+/**
+ * Device node lost power: handles it left open are gone
+ */
+void sim_nvs_power_off(int node);
+
+// ============================================================================
+// Radio and Topology (sim_mesh.c)
+// ============================================================================
+
+typedef enum {
+    SIM_TOPO_RANDOM = 0,        // A joining node picks any parent it may connect to
+    SIM_TOPO_BFS,               // Shallowest parent first, then lowest index
+    SIM_TOPO_HOUSE,             // Positions in a house, RSSI from distance, walls and floors
+} sim_topology_t;
+
+typedef struct {
+    int nodes;                  // Nodes (gateway not included)
+    sim_topology_t topology;
+    int route_table;            // Devices the mesh admits, root included (CONFIG_MESH_ROUTE_TABLE_SIZE)
+    uint32_t latency_us;        // Per hop, after the frame is on air
+    uint32_t jitter_us;         // Uniform 0..jitter added per hop
+    double loss;                // Per hop loss after link-layer retries
+    uint32_t bandwidth_kbps;    // Per hop air rate; a radio sends or receives one frame at a time
+    uint32_t overhead_bytes;    // 802.11 + mesh header per frame
+    uint32_t scan_us;           // One parent scan, plus uniform 0..scan_us
+    uint32_t assoc_us;          // Association with a chosen parent
+    uint32_t loss_detect_us;    // Beacon timeout: a dead parent or child is noticed after this
+    uint32_t node_us;           // Node time to handle one received frame
+} sim_mesh_config_t;
+
+typedef struct {
+    uint32_t frames_sent;       // Handed to the radio (all directions)
+    uint32_t frames_lost;       // Dropped on some hop (loss, dead relay, receiver gone)
+    uint32_t frames_delivered;
+    uint64_t bytes_on_air;      // Per hop, headers included
+    uint32_t rx_queue_peak;     // Deepest root receive queue
+    uint32_t rx_frames;         // Frames the gateway took from the queue
+    uint32_t rx_echo;           // Of which its own broadcasts (root is in its routing table)
+    uint32_t routing_truncated; // Routing table reads that did not fit the caller's buffer
+    uint32_t joins;             // Parent associations
+    uint32_t leaves;            // Detachments (parent gone, stop, power loss)
+    uint32_t scans;             // Parent scans run
+    uint32_t scans_empty;       // Of which found no parent it could take
+    int joined;                 // Nodes connected now
+    int max_layer;              // Deepest layer now
+} sim_mesh_stats_t;
+
+void sim_mesh_configure(const sim_mesh_config_t *config);
+const sim_mesh_config_t *sim_mesh_get_config(void);
+void sim_mesh_get_stats(sim_mesh_stats_t *stats);
+
+/**
+ * Time each frame waited in the root receive queue, in µs (one entry per frame)
+ */
+const uint32_t *sim_mesh_rx_waits(size_t *count);
+
+/**
+ * Node address and position (index 0 is the gateway)
+ */
+const uint8_t *sim_mesh_node_mac(int index);
+int sim_mesh_node_layer(int index);
+int sim_mesh_node_parent(int index);
+bool sim_mesh_node_joined(int index);
+int sim_mesh_find(const uint8_t *mac);
+
+/**
+ * Link to the parent of a connected node: the parent's softAP address and
+ * the signal the node sees from it (esp_wifi_sta_get_ap_info)
+ */
+bool sim_mesh_node_link(int index, uint8_t bssid[6], int8_t *rssi);
+
+/**
+ * Device node lost power or rebooted: its radio goes silent. Neighbours
+ * notice after loss_detect_us.
+ */
+void sim_mesh_power_off(int node);
+
+/**
+ * Every frame the gateway's esp_mesh_recv() returns, seen before the caller
+ */
+void sim_mesh_set_rx_tap(void (*tap)(const uint8_t *src, const uint8_t *data, size_t len));
+
+// ============================================================================
+// ESP-NOW Link (sim_espnow.c)
+// ============================================================================
+
+typedef struct {
+    uint32_t latency_us;        // After the frame is on air
+    uint32_t jitter_us;         // Uniform 0..jitter added
+    double loss;                // Per frame after MAC retries, and per MAC ACK
+    uint32_t rate_kbps;         // One shared channel, one frame on air at a time
+    uint32_t overhead_bytes;    // 802.11 + ESP-NOW header per frame
+} sim_espnow_config_t;
+
+typedef struct {
+    uint32_t frames_sent;       // Handed to the radio (unicast and broadcast)
+    uint32_t frames_lost;       // Unicast frames the peer never got
+    uint32_t frames_delivered;  // Unicast frames the peer got
+    uint32_t mac_acks_lost;     // Of which the sender was told FAIL
+} sim_espnow_stats_t;
+
+void sim_espnow_configure(const sim_espnow_config_t *config, int devices);
+void sim_espnow_get_stats(sim_espnow_stats_t *stats);
+
+// ============================================================================
+// lwIP Sockets, HTTP Server and LAN Clients (sim_httpd.c)
+// ============================================================================
+
+/**
+ * The gateway's lwIP socket pool (CONFIG_LWIP_MAX_SOCKETS). httpd takes
+ * its listening, control and session sockets from it; the harness takes
+ * the ones the rest of the firmware holds (MQTT, captive DNS...).
+ * sim_lwip_socket returns -1 when the pool is empty.
+ */
+int sim_lwip_socket(void);
+int sim_lwip_close(int fd);
+
+typedef struct {
+    uint32_t latency_us;        // One way, client to gateway
+} sim_httpd_config_t;
+
+typedef struct {
+    uint32_t lwip_in_use;       // Sockets open now
+    uint32_t lwip_peak;         // Most open at once
+    uint32_t lwip_exhausted;    // socket()/accept() found the pool empty
+    uint32_t lwip_bad_close;    // close() of a socket that was not open
+    uint32_t sessions;          // httpd sessions open now
+    uint32_t sessions_peak;
+    uint32_t accepted;
+    uint32_t requests;          // Requests and WebSocket frames handled
+    uint32_t handler_errors;    // Sessions closed because a handler failed
+    uint32_t lru_purges;        // Sessions httpd closed to accept a new one
+    uint32_t lru_purged_ws;     // Of which WebSockets
+    uint32_t closes_skipped;    // httpd_sess_trigger_close ignored (no request served yet)
+    uint32_t syn_dropped;       // Connection attempts dropped on a full listen backlog
+    uint32_t backlog_peak;
+} sim_httpd_stats_t;
+
+void sim_httpd_configure(const sim_httpd_config_t *config);
+void sim_httpd_get_stats(sim_httpd_stats_t *stats);
+
+/**
+ * Client end of one browser or backend connection slot, for harness
+ * tasks. A TCP connection is set up on the first request (SYN retried
+ * after 1 s, 2 s... while the listen backlog is full) and reused while
+ * open. Requests block the calling task until the response, and return
+ * the status code or -1 if the connection closed first or timeout_ms ran
+ * out (the connection is then dropped).
+ */
+typedef struct sim_http_conn sim_http_conn_t;
+
+sim_http_conn_t *sim_http_conn_new(void);
+int sim_http_get(sim_http_conn_t *conn, const char *uri, bool keep_alive, uint32_t timeout_ms);
+
+/**
+ * GET uri with a WebSocket upgrade; true if the server answered 101 and
+ * kept the connection open
+ */
+bool sim_http_ws_open(sim_http_conn_t *conn, const char *uri, uint32_t timeout_ms);
+
+void sim_http_close(sim_http_conn_t *conn);
+bool sim_http_is_open(const sim_http_conn_t *conn);
+uint32_t sim_http_ws_frames(const sim_http_conn_t *conn);   // Data frames received
+
+// ============================================================================
+// MQTT Broker (sim_mqtt.c)
+// ============================================================================
+
+typedef void (*sim_mqtt_cb_t)(const char *topic, const char *data, int len);
+
+/**
+ * One-way broker latency and the client's connect time
+ */
+void sim_mqtt_configure(uint32_t latency_us, uint32_t connect_us);
+
+/**
+ * Backend side: subscribe (+ and # wildcards) and publish to the gateway.
+ * Callbacks run as events and must not block.
+ */
+void sim_mqtt_subscribe(const char *filter, sim_mqtt_cb_t cb);
+void sim_mqtt_publish(const char *topic, const char *data);
+
+bool sim_mqtt_connected(void);
+uint32_t sim_mqtt_gateway_publishes(void);
+
+// ============================================================================
+// Node Firmware (sim_fw.c)
+// ============================================================================
+
+/**
+ * Load the node firmware module; every node gets a private copy of it
+ */
+void sim_fw_init(const char *module_path, int nodes);
+
+/**
+ * Switch node on at at_us (power-on reset) or cut its power now
+ */
+void sim_fw_power_on(int node, int64_t at_us);
+void sim_fw_power_off(int node);
+
+bool sim_fw_powered(int node);
+uint32_t sim_fw_boots(int node);
+
+#endif // SIM_H
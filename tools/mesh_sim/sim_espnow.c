@@ -0,0 +1,210 @@
+/**
+ * OmniaPi Mesh Simulator - ESP-NOW Radio and esp_now Shim
+ *
+ * All devices share one channel and hear each other directly. A frame
+ * occupies the channel for its air time, so frames queue behind each
+ * other, then arrives after latency_us plus jitter. Loss is per frame,
+ * after the MAC-layer retries ESP-NOW does on its own: a unicast frame is
+ * lost with probability loss, and the MAC ACK of a delivered one too, in
+ * which case the sender's send callback says FAIL although the peer got
+ * it, as on the air. Broadcasts always report SUCCESS.
+ *
+ * Devices are addressed by the station MACs sim_mesh.c hands out.
+ */
+
+#include "sim.h"
+#include "esp_now.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ESPNOW_MAX_PEERS        20      // ESP_NOW_MAX_TOTAL_PEER_NUM
+
+typedef struct {
+    bool initialized;
+    esp_now_recv_cb_t recv_cb;
+    esp_now_send_cb_t send_cb;
+    uint8_t peers[ESPNOW_MAX_PEERS][ESP_NOW_ETH_ALEN];
+    int peer_count;
+} espnow_dev_t;
+
+typedef struct {
+    int from;
+    int to;
+    uint8_t des[ESP_NOW_ETH_ALEN];  // Address the sender used
+    bool success;               // Send callback status
+    size_t len;
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+} espnow_frame_t;
+
+static const uint8_t s_broadcast[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static sim_espnow_config_t s_cfg;
+static espnow_dev_t *s_devs = NULL;
+static int s_dev_count = 0;
+static int64_t s_channel_busy_us = 0;
+static sim_espnow_stats_t s_stats;
+
+void sim_espnow_configure(const sim_espnow_config_t *config, int devices)
+{
+    s_cfg = *config;
+    free(s_devs);
+    s_devs = calloc(devices, sizeof(espnow_dev_t));
+    if (s_devs == NULL) abort();
+    s_dev_count = devices;
+    s_channel_busy_us = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void sim_espnow_get_stats(sim_espnow_stats_t *stats)
+{
+    *stats = s_stats;
+}
+
+static espnow_dev_t *self(void)
+{
+    return &s_devs[sim_rtos_node()];
+}
+
+static bool has_peer(const espnow_dev_t *dev, const uint8_t *mac)
+{
+    for (int i = 0; i < dev->peer_count; i++) {
+        if (memcmp(dev->peers[i], mac, ESP_NOW_ETH_ALEN) == 0) return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// Radio
+// ============================================================================
+
+static void deliver(void *arg)
+{
+    espnow_frame_t *frame = arg;
+    espnow_dev_t *dev = &s_devs[frame->to];
+    if (dev->initialized && dev->recv_cb != NULL) {
+        uint8_t src[ESP_NOW_ETH_ALEN];
+        memcpy(src, sim_mesh_node_mac(frame->from), ESP_NOW_ETH_ALEN);
+        esp_now_recv_info_t info = { .src_addr = src, .des_addr = frame->des, .rssi = -60 };
+        dev->recv_cb(&info, frame->data, (int)frame->len);
+    }
+    free(frame);
+}
+
+static void send_done(void *arg)
+{
+    espnow_frame_t *frame = arg;
+    espnow_dev_t *dev = &s_devs[frame->from];
+    if (dev->initialized && dev->send_cb != NULL) {
+        wifi_tx_info_t info = { .src_addr = sim_mesh_node_mac(frame->from), .des_addr = frame->des };
+        dev->send_cb(&info, frame->success ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+    }
+    free(frame);
+}
+
+static espnow_frame_t *frame_new(int from, int to, const uint8_t *des, const uint8_t *data, size_t len)
+{
+    espnow_frame_t *frame = malloc(sizeof(espnow_frame_t));
+    if (frame == NULL) abort();
+    frame->from = from;
+    frame->to = to;
+    memcpy(frame->des, des, ESP_NOW_ETH_ALEN);
+    frame->success = true;
+    frame->len = len;
+    memcpy(frame->data, data, len);
+    return frame;
+}
+
+static int64_t arrival_us(int64_t end_us)
+{
+    int64_t t = end_us + s_cfg.latency_us;
+    if (s_cfg.jitter_us > 0) t += sim_rand_u32() % (s_cfg.jitter_us + 1);
+    return t;
+}
+
+static void schedule_for(int node, int64_t at_us, sim_event_fn_t fn, void *arg)
+{
+    int prev = sim_rtos_enter(node);
+    sim_event_at(at_us, fn, arg);
+    sim_rtos_leave(prev);
+}
+
+// ============================================================================
+// esp_now_* API
+// ============================================================================
+
+esp_err_t esp_now_init(void)
+{
+    self()->initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+    self()->recv_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    self()->send_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer)
+{
+    espnow_dev_t *dev = self();
+    if (!dev->initialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    if (peer == NULL) return ESP_ERR_ESPNOW_ARG;
+    if (has_peer(dev, peer->peer_addr)) return ESP_ERR_ESPNOW_EXIST;
+    if (dev->peer_count == ESPNOW_MAX_PEERS) return ESP_ERR_ESPNOW_FULL;
+    memcpy(dev->peers[dev->peer_count++], peer->peer_addr, ESP_NOW_ETH_ALEN);
+    return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *peer_addr)
+{
+    return peer_addr != NULL && has_peer(self(), peer_addr);
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len)
+{
+    int from = sim_rtos_node();
+    espnow_dev_t *dev = self();
+    if (!dev->initialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    if (peer_addr == NULL || data == NULL || len == 0 || len > ESP_NOW_MAX_DATA_LEN) {
+        return ESP_ERR_ESPNOW_ARG;
+    }
+    if (!has_peer(dev, peer_addr)) return ESP_ERR_ESPNOW_NOT_FOUND;
+
+    int64_t start = sim_now_us();
+    if (s_channel_busy_us > start) start = s_channel_busy_us;
+    int64_t end = start + (int64_t)(len + s_cfg.overhead_bytes) * 8 * 1000 / s_cfg.rate_kbps;
+    s_channel_busy_us = end;
+    s_stats.frames_sent++;
+
+    bool broadcast = memcmp(peer_addr, s_broadcast, ESP_NOW_ETH_ALEN) == 0;
+    if (broadcast) {
+        for (int i = 0; i < s_dev_count; i++) {
+            if (i == from || sim_rand_unit() < s_cfg.loss) continue;
+            schedule_for(i, arrival_us(end), deliver, frame_new(from, i, peer_addr, data, len));
+        }
+        schedule_for(from, end, send_done, frame_new(from, -1, peer_addr, data, 0));
+        return ESP_OK;
+    }
+
+    int to = sim_mesh_find(peer_addr);
+    bool delivered = to >= 0 && to < s_dev_count && sim_rand_unit() >= s_cfg.loss;
+    espnow_frame_t *done = frame_new(from, to, peer_addr, data, 0);
+    if (delivered) {
+        s_stats.frames_delivered++;
+        schedule_for(to, arrival_us(end), deliver, frame_new(from, to, peer_addr, data, len));
+        done->success = sim_rand_unit() >= s_cfg.loss;
+        if (!done->success) s_stats.mac_acks_lost++;
+    } else {
+        s_stats.frames_lost++;
+        done->success = false;
+    }
+    // The MAC ACK (or its timeout) comes back right after the frame
+    schedule_for(from, arrival_us(end), send_done, done);
+    return ESP_OK;
+}
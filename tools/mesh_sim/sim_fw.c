@@ -0,0 +1,173 @@
+/**
+ * OmniaPi Mesh Simulator - Node Firmware Loader
+ *
+ * The node firmware (node_mesh/main built as a shared module, see
+ * CMakeLists.txt) keeps its state in file-scope statics, one set per chip.
+ * Every node therefore loads its own copy of the module: the image is
+ * copied into an anonymous file per node and dlopen()ed from there, so the
+ * loader sees distinct objects. A reboot unloads the copy and loads it
+ * again, which gives the fresh statics a real reset does, while NVS and
+ * flash (sim_nvs.c, sim_idf.c) persist.
+ *
+ * app_main() runs in a "main" task under the node's device, as on the chip.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define REBOOT_US       300000  // esp_restart() to app_main() of the next boot
+
+typedef struct {
+    int fd;                     // Private copy of the module
+    void *handle;               // Loaded image, NULL while off
+    bool powered;
+    uint32_t boots;
+    uint32_t power_gen;         // Bumped on power-off: a pending boot is dropped
+} fw_node_t;
+
+typedef struct {
+    int node;
+    uint32_t power_gen;
+    esp_reset_reason_t reason;
+} boot_t;
+
+static fw_node_t *s_nodes = NULL;
+static int s_node_count = 0;
+
+static void restart_hook(void);
+
+void sim_fw_init(const char *module_path, int nodes)
+{
+    FILE *f = fopen(module_path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "mesh_sim: cannot open node firmware %s\n", module_path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = malloc(size);
+    if (image == NULL || fread(image, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "mesh_sim: cannot read node firmware %s\n", module_path);
+        exit(1);
+    }
+    fclose(f);
+
+    s_nodes = calloc(nodes + 1, sizeof(fw_node_t));
+    if (s_nodes == NULL) abort();
+    s_node_count = nodes + 1;
+    for (int i = 1; i <= nodes; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "node_fw_%d", i);
+        int fd = memfd_create(name, MFD_CLOEXEC);
+        if (fd < 0 || write(fd, image, size) != size) {
+            fprintf(stderr, "mesh_sim: cannot copy node firmware for node %d\n", i);
+            exit(1);
+        }
+        s_nodes[i].fd = fd;
+    }
+    free(image);
+
+    sim_idf_set_restart_hook(restart_hook);
+}
+
+static void main_task(void *arg)
+{
+    void (*app_main)(void) = (void (*)(void))arg;
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static void boot(void *arg)
+{
+    boot_t b = *(boot_t *)arg;
+    free(arg);
+    fw_node_t *fw = &s_nodes[b.node];
+    if (b.power_gen != fw->power_gen) return;
+
+    if (fw->handle != NULL) {
+        dlclose(fw->handle);
+        fw->handle = NULL;
+    }
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fw->fd);
+    fw->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    void *app_main = fw->handle != NULL ? dlsym(fw->handle, "app_main") : NULL;
+    if (app_main == NULL) {
+        fprintf(stderr, "mesh_sim: node %d firmware: %s\n", b.node, dlerror());
+        exit(1);
+    }
+
+    fw->powered = true;
+    fw->boots++;
+    sim_idf_power_on(b.node, b.reason);
+
+    int prev = sim_rtos_enter(b.node);
+    xTaskCreate(main_task, "main", 8192, app_main, 1, NULL);
+    sim_rtos_leave(prev);
+}
+
+static void schedule_boot(int node, int64_t at_us, esp_reset_reason_t reason)
+{
+    boot_t *b = malloc(sizeof(boot_t));
+    if (b == NULL) abort();
+    *b = (boot_t){ node, s_nodes[node].power_gen, reason };
+    sim_event_at(at_us, boot, b);
+}
+
+void sim_fw_power_on(int node, int64_t at_us)
+{
+    if (node < 1 || node >= s_node_count || s_nodes[node].powered) return;
+    s_nodes[node].power_gen++;      // A boot already pending is replaced
+    schedule_boot(node, at_us, ESP_RST_POWERON);
+}
+
+/**
+ * Everything the chip was doing stops: tasks, timers, radio, event loop
+ */
+static void halt(int node)
+{
+    sim_mesh_power_off(node);
+    sim_idf_power_off(node);
+    sim_nvs_power_off(node);
+    s_nodes[node].powered = false;
+    s_nodes[node].power_gen++;
+}
+
+void sim_fw_power_off(int node)
+{
+    if (node < 1 || node >= s_node_count) return;
+    halt(node);
+    sim_rtos_kill_node(node);
+}
+
+/**
+ * esp_restart() on a node: runs on one of its tasks and never returns
+ */
+static void restart_hook(void)
+{
+    int node = sim_rtos_node();
+    halt(node);
+    schedule_boot(node, sim_now_us() + REBOOT_US, ESP_RST_SW);
+    sim_rtos_kill_node(node);
+}
+
+bool sim_fw_powered(int node)
+{
+    return s_nodes[node].powered;
+}
+
+uint32_t sim_fw_boots(int node)
+{
+    return s_nodes[node].boots;
+}
@@ -0,0 +1,755 @@
+/**
+ * OmniaPi Mesh Simulator - lwIP Socket Pool, HTTP Server and LAN Clients
+ *
+ * esp_http_server as ESP-IDF 5.x runs it, for the gateway's real
+ * webserver.c. One server task; each pass handles the control messages
+ * first (httpd_sess_trigger_close), then one request or WebSocket frame
+ * from every session with input, then accepts one connection from the
+ * listen backlog. With no free session and lru_purge_enable it closes the
+ * session with the lowest LRU counter instead and accepts on a later
+ * pass. A session's counter is bumped after every request or frame it
+ * served and by httpd_sess_update_lru_counter; a fresh session has 0, and
+ * a close asked for before it served anything is skipped, as httpd does.
+ * Handlers run in the server task and may take virtual time. A failing
+ * handler gets its session closed, after the 101 for a WebSocket
+ * handshake.
+ *
+ * Every socket httpd opens comes from the CONFIG_LWIP_MAX_SOCKETS pool:
+ * the listening and control sockets, the sessions, and the one
+ * httpd_sess_trigger_close sends its control message from. With a
+ * close_fn installed, closing a session's socket is left to it.
+ *
+ * Clients are harness tasks on the LAN, latency_us away. A connection is
+ * established one round trip after its SYN finds room in the listen
+ * backlog (backlog_conn); a SYN that finds it full is dropped and resent
+ * after 1 s, 2 s, 4 s... A WebSocket client answers every PING with a PONG.
+ */
+
+#include "sim.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "SIM_HTTPD";
+
+#define LWIP_SOCKET_OFFSET      (64 - CONFIG_LWIP_MAX_SOCKETS)  // FD_SETSIZE - CONFIG_LWIP_MAX_SOCKETS
+#define HTTPD_INTERNAL_SOCKETS  3           // Listening, control, control message sender
+#define CTRL_QUEUE_LEN          32
+#define SYN_RETRY_US            1000000     // First SYN retransmission, doubled after each
+
+// One TCP connection, shared by both ends
+typedef struct sim_tcp {
+    int refs;                   // Client end, server end, events in flight
+    sim_http_conn_t *client;    // NULL once the client end is closed
+    bool server_closed;         // Closed or reset by the server
+    int syn_tries;
+    // Input waiting at the server
+    bool req_ready;
+    bool req_upgrade;
+    char req_uri[64];
+    uint32_t pongs;
+    bool eof;
+} sim_tcp_t;
+
+struct sim_http_conn {
+    sim_tcp_t *tcp;             // NULL when not connected
+    SemaphoreHandle_t signal;
+    bool done;                  // Established, answered or closed since the last request began
+    int status;
+    uint32_t ws_frames;
+};
+
+typedef struct {
+    int fd;                     // -1 = free
+    sim_tcp_t *tcp;
+    uint64_t lru_counter;
+    bool lru_socket;            // Picked by the LRU purge
+    bool websocket;
+    const httpd_uri_t *ws_uri;
+} sess_t;
+
+typedef struct {
+    sess_t *sess;
+    int fd;
+} ctrl_msg_t;
+
+struct httpd_data {
+    httpd_config_t config;
+    int listen_fd;
+    int ctrl_fd;
+    sess_t *sessions;
+    int active;
+    httpd_uri_t *uris;
+    int uri_count;
+    sim_tcp_t **backlog;
+    int backlog_count;
+    ctrl_msg_t ctrl[CTRL_QUEUE_LEN];
+    int ctrl_count;
+    SemaphoreHandle_t wake;
+    TaskHandle_t task;
+    bool stop;
+};
+
+// Request being handled
+typedef struct {
+    sess_t *sess;
+    int status;
+    httpd_ws_type_t frame;      // WebSocket frame type (WebSocket sessions)
+} req_aux_t;
+
+static sim_httpd_config_t s_cfg = { .latency_us = 1000 };
+static sim_httpd_stats_t s_stats;
+static bool s_lwip_open[CONFIG_LWIP_MAX_SOCKETS];
+static struct httpd_data *s_server = NULL;     // One server, as on the gateway
+static uint64_t s_lru_counter = 0;
+
+void sim_httpd_configure(const sim_httpd_config_t *config)
+{
+    s_cfg = *config;
+}
+
+void sim_httpd_get_stats(sim_httpd_stats_t *stats)
+{
+    *stats = s_stats;
+}
+
+// ============================================================================
+// lwIP Socket Pool
+// ============================================================================
+
+int sim_lwip_socket(void)
+{
+    for (int i = 0; i < CONFIG_LWIP_MAX_SOCKETS; i++) {
+        if (!s_lwip_open[i]) {
+            s_lwip_open[i] = true;
+            if (++s_stats.lwip_in_use > s_stats.lwip_peak) s_stats.lwip_peak = s_stats.lwip_in_use;
+            return LWIP_SOCKET_OFFSET + i;
+        }
+    }
+    s_stats.lwip_exhausted++;
+    return -1;
+}
+
+int sim_lwip_close(int fd)
+{
+    int i = fd - LWIP_SOCKET_OFFSET;
+    if (i < 0 || i >= CONFIG_LWIP_MAX_SOCKETS || !s_lwip_open[i]) {
+        s_stats.lwip_bad_close++;
+        return -1;
+    }
+    s_lwip_open[i] = false;
+    s_stats.lwip_in_use--;
+    return 0;
+}
+
+// ============================================================================
+// Segments in Flight
+// ============================================================================
+
+typedef void (*tcp_fn_t)(sim_tcp_t *tcp, int value);
+
+typedef struct {
+    tcp_fn_t fn;
+    sim_tcp_t *tcp;
+    int value;
+} tcp_event_t;
+
+static void tcp_unref(sim_tcp_t *tcp)
+{
+    if (--tcp->refs == 0) free(tcp);
+}
+
+static void tcp_event_run(void *arg)
+{
+    tcp_event_t *ev = arg;
+    ev->fn(ev->tcp, ev->value);
+    tcp_unref(ev->tcp);
+    free(ev);
+}
+
+/**
+ * Run fn(tcp, value) delay_us from now (latency_us: the other end gets it)
+ */
+static void tcp_after(sim_tcp_t *tcp, int64_t delay_us, tcp_fn_t fn, int value)
+{
+    tcp_event_t *ev = malloc(sizeof(tcp_event_t));
+    if (ev == NULL) abort();
+    ev->fn = fn;
+    ev->tcp = tcp;
+    ev->value = value;
+    tcp->refs++;
+    sim_event_at(sim_now_us() + delay_us, tcp_event_run, ev);
+}
+
+static void server_wake(void)
+{
+    if (s_server != NULL) xSemaphoreGive(s_server->wake);
+}
+
+// Client end
+
+/**
+ * status: 0 established, -1 closed, else the HTTP status of the response
+ */
+static void client_signal(sim_tcp_t *tcp, int status)
+{
+    sim_http_conn_t *conn = tcp->client;
+    if (conn == NULL) return;
+    if (!conn->done) {
+        conn->status = status;
+        conn->done = true;
+    }
+    xSemaphoreGive(conn->signal);
+}
+
+static void at_client_established(sim_tcp_t *tcp, int unused)
+{
+    client_signal(tcp, 0);
+}
+
+static void at_client_response(sim_tcp_t *tcp, int status)
+{
+    client_signal(tcp, status);
+}
+
+static void at_client_closed(sim_tcp_t *tcp, int unused)
+{
+    sim_http_conn_t *conn = tcp->client;
+    if (conn == NULL) return;
+    client_signal(tcp, -1);
+    conn->tcp = NULL;
+    tcp->client = NULL;
+    tcp_unref(tcp);
+}
+
+static void at_server_pong(sim_tcp_t *tcp, int unused);
+
+static void at_client_ws_frame(sim_tcp_t *tcp, int type)
+{
+    if (tcp->client == NULL) return;
+    if (type == HTTPD_WS_TYPE_PING) {
+        tcp_after(tcp, s_cfg.latency_us, at_server_pong, 0);
+    } else {
+        tcp->client->ws_frames++;
+    }
+}
+
+// Server end
+
+static void at_server_syn(sim_tcp_t *tcp, int unused)
+{
+    struct httpd_data *hd = s_server;
+    if (tcp->client == NULL) return;        // Client gave up
+    if (hd == NULL) {
+        tcp->server_closed = true;
+        tcp_after(tcp, s_cfg.latency_us, at_client_closed, 0);
+        return;
+    }
+    if (hd->backlog_count >= hd->config.backlog_conn) {
+        // lwIP drops it; the client's stack sends it again
+        s_stats.syn_dropped++;
+        int64_t rto_us = (int64_t)SYN_RETRY_US << tcp->syn_tries++;
+        tcp_after(tcp, rto_us, at_server_syn, 0);
+        return;
+    }
+    hd->backlog[hd->backlog_count++] = tcp;
+    tcp->refs++;
+    if ((uint32_t)hd->backlog_count > s_stats.backlog_peak) s_stats.backlog_peak = hd->backlog_count;
+    tcp_after(tcp, s_cfg.latency_us, at_client_established, 0);
+    server_wake();
+}
+
+static void at_server_request(sim_tcp_t *tcp, int unused)
+{
+    if (tcp->server_closed) {
+        tcp_after(tcp, s_cfg.latency_us, at_client_closed, 0);     // RST
+        return;
+    }
+    tcp->req_ready = true;
+    server_wake();
+}
+
+static void at_server_pong(sim_tcp_t *tcp, int unused)
+{
+    if (tcp->server_closed) return;
+    tcp->pongs++;
+    server_wake();
+}
+
+static void at_server_eof(sim_tcp_t *tcp, int unused)
+{
+    if (tcp->server_closed) return;
+    tcp->eof = true;
+    server_wake();
+}
+
+// ============================================================================
+// Sessions
+// ============================================================================
+
+static sess_t *sess_get(struct httpd_data *hd, int fd)
+{
+    if (fd < 0) return NULL;
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i].fd == fd) return &hd->sessions[i];
+    }
+    return NULL;
+}
+
+static void sess_delete(struct httpd_data *hd, sess_t *sess)
+{
+    if (hd->config.close_fn) {
+        hd->config.close_fn(hd, sess->fd);
+    } else {
+        sim_lwip_close(sess->fd);
+    }
+    sim_tcp_t *tcp = sess->tcp;
+    sess->fd = -1;
+    sess->tcp = NULL;
+    hd->active--;
+    s_stats.sessions = hd->active;
+
+    tcp->server_closed = true;
+    tcp_after(tcp, s_cfg.latency_us, at_client_closed, 0);          // FIN
+    tcp_unref(tcp);
+}
+
+/**
+ * httpd_queue_work(): one datagram to the control socket, sent from a
+ * socket of its own
+ */
+static esp_err_t queue_close(struct httpd_data *hd, sess_t *sess)
+{
+    int fd = sim_lwip_socket();
+    if (fd < 0) {
+        ESP_LOGW(TAG, "No socket for the control message, fd=%d stays open", sess->fd);
+        return ESP_FAIL;
+    }
+    sim_lwip_close(fd);
+    if (hd->ctrl_count == CTRL_QUEUE_LEN) return ESP_FAIL;
+    hd->ctrl[hd->ctrl_count++] = (ctrl_msg_t){ .sess = sess, .fd = sess->fd };
+    server_wake();
+    return ESP_OK;
+}
+
+static void close_lru(struct httpd_data *hd)
+{
+    sess_t *lru = NULL;
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        sess_t *sess = &hd->sessions[i];
+        if (sess->fd < 0) continue;
+        if (lru == NULL || sess->lru_counter < lru->lru_counter) lru = sess;
+    }
+    if (lru == NULL) return;
+    s_stats.lru_purges++;
+    if (lru->websocket) s_stats.lru_purged_ws++;
+    lru->lru_socket = true;
+    queue_close(hd, lru);
+}
+
+static void process_ctrl(struct httpd_data *hd)
+{
+    ctrl_msg_t msgs[CTRL_QUEUE_LEN];
+    int count = hd->ctrl_count;
+    memcpy(msgs, hd->ctrl, count * sizeof(ctrl_msg_t));
+    hd->ctrl_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        sess_t *sess = msgs[i].sess;
+        if (sess->fd < 0 || sess->fd != msgs[i].fd) continue;
+        // httpd_sess_close(): taken for a race with accept
+        if (sess->lru_counter == 0 && !sess->lru_socket) {
+            s_stats.closes_skipped++;
+            continue;
+        }
+        sess->lru_socket = false;
+        sess_delete(hd, sess);
+    }
+}
+
+static void accept_conn(struct httpd_data *hd)
+{
+    if (hd->active >= hd->config.max_open_sockets) {
+        if (hd->config.lru_purge_enable) close_lru(hd);
+        return;
+    }
+    sim_tcp_t *tcp = hd->backlog[0];
+    hd->backlog_count--;
+    memmove(hd->backlog, hd->backlog + 1, hd->backlog_count * sizeof(sim_tcp_t *));
+
+    int fd = sim_lwip_socket();
+    if (fd < 0) {
+        // accept() fails and lwIP aborts the connection
+        ESP_LOGW(TAG, "accept: no free socket");
+        tcp->server_closed = true;
+        tcp_after(tcp, s_cfg.latency_us, at_client_closed, 0);
+        tcp_unref(tcp);
+        return;
+    }
+
+    sess_t *sess = NULL;
+    for (int i = 0; sess == NULL && i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i].fd < 0) sess = &hd->sessions[i];
+    }
+    *sess = (sess_t){ .fd = fd, .tcp = tcp };
+    hd->active++;
+    s_stats.sessions = hd->active;
+    if (s_stats.sessions > s_stats.sessions_peak) s_stats.sessions_peak = s_stats.sessions;
+    s_stats.accepted++;
+
+    if (hd->config.open_fn && hd->config.open_fn(hd, fd) != ESP_OK) {
+        sess_delete(hd, sess);
+    }
+}
+
+static bool has_input(const sess_t *sess)
+{
+    const sim_tcp_t *tcp = sess->tcp;
+    return tcp->eof || (sess->websocket ? tcp->pongs > 0 : tcp->req_ready);
+}
+
+static bool uri_matches(struct httpd_data *hd, const httpd_uri_t *u, const char *uri)
+{
+    size_t len = strcspn(uri, "?");
+    if (hd->config.uri_match_fn) return hd->config.uri_match_fn(u->uri, uri, len);
+    return strlen(u->uri) == len && strncmp(u->uri, uri, len) == 0;
+}
+
+static void respond(sess_t *sess, int status)
+{
+    tcp_after(sess->tcp, s_cfg.latency_us, at_client_response, status);
+}
+
+/**
+ * One request or WebSocket frame, input before EOF
+ */
+static void sess_process(struct httpd_data *hd, sess_t *sess)
+{
+    sim_tcp_t *tcp = sess->tcp;
+    req_aux_t aux = { .sess = sess };
+    httpd_req_t req = { .handle = hd, .aux = &aux };
+    esp_err_t ret;
+
+    if (sess->websocket && tcp->pongs > 0) {
+        tcp->pongs--;
+        aux.frame = HTTPD_WS_TYPE_PONG;
+        req.user_ctx = sess->ws_uri->user_ctx;
+        ret = sess->ws_uri->handle_ws_control_frames ? sess->ws_uri->handler(&req) : ESP_OK;
+    } else if (!sess->websocket && tcp->req_ready) {
+        tcp->req_ready = false;
+        req.method = HTTP_GET;
+        snprintf((char *)req.uri, sizeof(req.uri), "%s", tcp->req_uri);
+
+        const httpd_uri_t *uri = NULL;
+        for (int i = 0; i < hd->uri_count && uri == NULL; i++) {
+            if (hd->uris[i].method == HTTP_GET && uri_matches(hd, &hd->uris[i], req.uri)) {
+                uri = &hd->uris[i];
+            }
+        }
+        if (uri == NULL) {
+            respond(sess, 404);
+            ret = ESP_FAIL;
+        } else {
+            req.user_ctx = uri->user_ctx;
+            if (uri->is_websocket && tcp->req_upgrade) {
+                respond(sess, 101);
+                sess->websocket = true;
+                sess->ws_uri = uri;
+            }
+            ret = uri->handler(&req);
+        }
+    } else {
+        sess_delete(hd, sess);      // EOF
+        return;
+    }
+
+    s_stats.requests++;
+    if (ret != ESP_OK) {
+        s_stats.handler_errors++;
+        sess_delete(hd, sess);
+        return;
+    }
+    sess->lru_counter = ++s_lru_counter;
+}
+
+static void httpd_task(void *arg)
+{
+    struct httpd_data *hd = arg;
+
+    while (!hd->stop) {
+        xSemaphoreTake(hd->wake, portMAX_DELAY);
+
+        process_ctrl(hd);
+
+        bool more = false;
+        for (int i = 0; i < hd->config.max_open_sockets; i++) {
+            sess_t *sess = &hd->sessions[i];
+            if (sess->fd >= 0 && has_input(sess)) sess_process(hd, sess);
+            if (sess->fd >= 0 && has_input(sess)) more = true;
+        }
+
+        if (hd->backlog_count > 0) {
+            accept_conn(hd);
+            if (hd->backlog_count > 0 && hd->active < hd->config.max_open_sockets) more = true;
+        }
+        if (more) server_wake();
+    }
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// esp_http_server API
+// ============================================================================
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (handle == NULL || config == NULL) return ESP_ERR_INVALID_ARG;
+    if (s_server != NULL) return ESP_ERR_INVALID_STATE;
+    if (config->max_open_sockets > CONFIG_LWIP_MAX_SOCKETS - HTTPD_INTERNAL_SOCKETS) {
+        ESP_LOGE(TAG, "Config option max_open_sockets is too large (max allowed %d, %d sockets used by HTTP server internally)",
+                 CONFIG_LWIP_MAX_SOCKETS - HTTPD_INTERNAL_SOCKETS, HTTPD_INTERNAL_SOCKETS);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_data *hd = calloc(1, sizeof(struct httpd_data));
+    if (hd == NULL) return ESP_ERR_NO_MEM;
+    hd->config = *config;
+    hd->sessions = calloc(config->max_open_sockets, sizeof(sess_t));
+    hd->uris = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    hd->backlog = calloc(config->backlog_conn, sizeof(sim_tcp_t *));
+    hd->wake = xSemaphoreCreateCounting(0x7FFFFFFF, 0);
+    if (hd->sessions == NULL || hd->uris == NULL || hd->backlog == NULL || hd->wake == NULL) abort();
+    for (int i = 0; i < config->max_open_sockets; i++) hd->sessions[i].fd = -1;
+
+    hd->listen_fd = sim_lwip_socket();
+    hd->ctrl_fd = sim_lwip_socket();
+    if (hd->listen_fd < 0 || hd->ctrl_fd < 0) {
+        ESP_LOGE(TAG, "Failed to create server sockets");
+        if (hd->listen_fd >= 0) sim_lwip_close(hd->listen_fd);
+        if (hd->ctrl_fd >= 0) sim_lwip_close(hd->ctrl_fd);
+        return ESP_FAIL;
+    }
+
+    s_server = hd;
+    if (xTaskCreate(httpd_task, "httpd", config->stack_size, hd, config->task_priority, &hd->task) != pdPASS) {
+        s_server = NULL;
+        return ESP_ERR_HTTPD_TASK;
+    }
+    *handle = hd;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    struct httpd_data *hd = handle;
+    if (hd == NULL || hd != s_server) return ESP_ERR_INVALID_ARG;
+
+    hd->stop = true;
+    vTaskDelete(hd->task);
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i].fd >= 0) sess_delete(hd, &hd->sessions[i]);
+    }
+    for (int i = 0; i < hd->backlog_count; i++) {
+        hd->backlog[i]->server_closed = true;
+        tcp_after(hd->backlog[i], s_cfg.latency_us, at_client_closed, 0);
+        tcp_unref(hd->backlog[i]);
+    }
+    hd->backlog_count = 0;
+    sim_lwip_close(hd->listen_fd);
+    sim_lwip_close(hd->ctrl_fd);
+    // hd stays allocated: other tasks may still hold the handle
+    s_server = NULL;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    struct httpd_data *hd = handle;
+    if (hd == NULL || uri_handler == NULL) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < hd->uri_count; i++) {
+        if (hd->uris[i].method == uri_handler->method && strcmp(hd->uris[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (hd->uri_count == hd->config.max_uri_handlers) return ESP_ERR_HTTPD_HANDLERS_FULL;
+    httpd_uri_t *u = &hd->uris[hd->uri_count++];
+    *u = *uri_handler;
+    u->uri = strdup(uri_handler->uri);
+    return ESP_OK;
+}
+
+/**
+ * Trailing '*' only, which is what the gateway's templates use
+ */
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    size_t len = strlen(uri_template);
+    if (len > 0 && uri_template[len - 1] == '*') {
+        return match_upto >= len - 1 && strncmp(uri_template, uri_to_match, len - 1) == 0;
+    }
+    return match_upto == len && strncmp(uri_template, uri_to_match, len) == 0;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    if (r == NULL || r->aux == NULL) return -1;
+    return ((req_aux_t *)r->aux)->sess->fd;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    ((req_aux_t *)r->aux)->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    req_aux_t *aux = r->aux;
+    respond(aux->sess, aux->status ? aux->status : 200);
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    struct httpd_data *hd = handle;
+    if (hd == NULL) return ESP_ERR_INVALID_ARG;
+    sess_t *sess = sess_get(hd, sockfd);
+    if (sess == NULL) return ESP_ERR_NOT_FOUND;
+    return queue_close(hd, sess);
+}
+
+esp_err_t httpd_sess_update_lru_counter(httpd_handle_t handle, int sockfd)
+{
+    struct httpd_data *hd = handle;
+    if (hd == NULL) return ESP_ERR_INVALID_ARG;
+    sess_t *sess = sess_get(hd, sockfd);
+    if (sess == NULL) return ESP_ERR_NOT_FOUND;
+    sess->lru_counter = ++s_lru_counter;
+    return ESP_OK;
+}
+
+/**
+ * Clients send only PONGs, which carry no payload
+ */
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    req_aux_t *aux = req->aux;
+    if (!aux->sess->websocket) return ESP_ERR_INVALID_STATE;
+    pkt->final = true;
+    pkt->fragmented = false;
+    pkt->type = aux->frame;
+    pkt->len = 0;
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (hd == NULL || frame == NULL) return ESP_ERR_INVALID_ARG;
+    sess_t *sess = sess_get(hd, fd);
+    if (sess == NULL) return ESP_ERR_INVALID_ARG;
+    if (!sess->websocket) return ESP_ERR_INVALID_STATE;
+    tcp_after(sess->tcp, s_cfg.latency_us, at_client_ws_frame, frame->type);
+    return ESP_OK;
+}
+
+// ============================================================================
+// Clients
+// ============================================================================
+
+sim_http_conn_t *sim_http_conn_new(void)
+{
+    sim_http_conn_t *conn = calloc(1, sizeof(sim_http_conn_t));
+    if (conn == NULL) abort();
+    conn->signal = xSemaphoreCreateBinary();
+    return conn;
+}
+
+static void client_begin(sim_http_conn_t *conn)
+{
+    conn->done = false;
+    conn->status = -1;
+    xSemaphoreTake(conn->signal, 0);        // Drop a stale wake-up
+}
+
+static int client_wait(sim_http_conn_t *conn, int64_t deadline_us)
+{
+    while (!conn->done) {
+        int64_t left_us = deadline_us - sim_now_us();
+        if (left_us <= 0) {
+            sim_http_close(conn);
+            return -1;
+        }
+        xSemaphoreTake(conn->signal, pdMS_TO_TICKS((left_us + 999) / 1000));
+    }
+    return conn->status;
+}
+
+static int client_request(sim_http_conn_t *conn, const char *uri, bool upgrade, uint32_t timeout_ms)
+{
+    int64_t deadline_us = sim_now_us() + (int64_t)timeout_ms * 1000;
+
+    if (conn->tcp == NULL) {
+        sim_tcp_t *tcp = calloc(1, sizeof(sim_tcp_t));
+        if (tcp == NULL) abort();
+        tcp->refs = 1;
+        tcp->client = conn;
+        conn->tcp = tcp;
+        client_begin(conn);
+        tcp_after(tcp, s_cfg.latency_us, at_server_syn, 0);
+        if (client_wait(conn, deadline_us) != 0 || conn->tcp == NULL) return -1;
+    }
+
+    sim_tcp_t *tcp = conn->tcp;
+    snprintf(tcp->req_uri, sizeof(tcp->req_uri), "%s", uri);
+    tcp->req_upgrade = upgrade;
+    client_begin(conn);
+    tcp_after(tcp, s_cfg.latency_us, at_server_request, 0);
+    return client_wait(conn, deadline_us);
+}
+
+int sim_http_get(sim_http_conn_t *conn, const char *uri, bool keep_alive, uint32_t timeout_ms)
+{
+    int status = client_request(conn, uri, false, timeout_ms);
+    if (!keep_alive) sim_http_close(conn);
+    return status;
+}
+
+bool sim_http_ws_open(sim_http_conn_t *conn, const char *uri, uint32_t timeout_ms)
+{
+    int status = client_request(conn, uri, true, timeout_ms);
+    return status == 101 && conn->tcp != NULL;
+}
+
+void sim_http_close(sim_http_conn_t *conn)
+{
+    sim_tcp_t *tcp = conn->tcp;
+    if (tcp == NULL) return;
+    conn->tcp = NULL;
+    tcp->client = NULL;
+    tcp_after(tcp, s_cfg.latency_us, at_server_eof, 0);
+    tcp_unref(tcp);
+}
+
+bool sim_http_is_open(const sim_http_conn_t *conn)
+{
+    return conn->tcp != NULL;
+}
+
+uint32_t sim_http_ws_frames(const sim_http_conn_t *conn)
+{
+    return conn->ws_frames;
+}
@@ -0,0 +1,928 @@
+/**
+ * OmniaPi Mesh Simulator - ESP-IDF Services
+ *
+ * Host versions of the IDF calls the gateway and node firmware make outside
+ * the mesh: logging, CRC/SHA-256, the seeded random generator every
+ * simulated effect draws from, and per-device state: flash partitions and
+ * the OTA boot slot, the default event loop, MAC addresses, reset reason,
+ * and the relay outputs (GPIO and UART) the harness counts.
+ */
+
+#include "sim.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_crc.h"
+#include "esp_cpu.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_app_desc.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mbedtls/sha256.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SECTOR_SIZE     4096
+#define MAX_HANDLERS    8
+#define MAX_SLOTS       3
+#define MAX_GPIO        40
+
+// ============================================================================
+// Devices
+// ============================================================================
+
+typedef struct posted_event {
+    struct posted_event *next;
+    esp_event_base_t base;
+    int32_t id;
+    uint8_t data[];
+} posted_event_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} handler_entry_t;
+
+typedef struct {
+    // Default event loop
+    bool loop;
+    SemaphoreHandle_t pending;
+    posted_event_t *head;
+    posted_event_t *tail;
+    handler_entry_t handlers[MAX_HANDLERS];
+
+    // Flash: app slots as lazily allocated 4KB sectors (NULL = erased)
+    uint8_t **sectors[MAX_SLOTS];
+    int running;
+    int boot;
+    esp_ota_handle_t ota_handle;        // Open esp_ota_begin() session, 0 = none
+    int ota_slot;
+    uint32_t ota_written;
+    bool ota_sequential;
+    char version[32];
+
+    esp_reset_reason_t reset_reason;
+    uint8_t gpio_level[MAX_GPIO];
+    sim_idf_node_stats_t stats;
+} device_t;
+
+static device_t *s_devices = NULL;
+static int s_device_count = 0;
+static uint32_t s_erase_us = 0;
+static void (*s_restart_hook)(void) = NULL;
+
+static device_t *device(int node)
+{
+    if (node < 0 || node >= s_device_count) {
+        fprintf(stderr, "mesh_sim: no device %d\n", node);
+        abort();
+    }
+    return &s_devices[node];
+}
+
+static device_t *self(void)
+{
+    return device(sim_rtos_node());
+}
+
+void sim_idf_init(int devices)
+{
+    s_devices = calloc(devices, sizeof(device_t));
+    if (s_devices == NULL) abort();
+    s_device_count = devices;
+    s_devices[SIM_GATEWAY].reset_reason = ESP_RST_POWERON;
+}
+
+void sim_idf_set_erase_us(uint32_t us_per_sector)
+{
+    s_erase_us = us_per_sector;
+}
+
+void sim_idf_set_restart_hook(void (*hook)(void))
+{
+    s_restart_hook = hook;
+}
+
+void sim_idf_get_node_stats(int node, sim_idf_node_stats_t *stats)
+{
+    *stats = device(node)->stats;
+}
+
+// ============================================================================
+// Errors and Logging
+// ============================================================================
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                        return "ESP_OK";
+        case ESP_FAIL:                      return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH:     return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY:         return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_INVALID_HANDLE:    return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_OTA_VALIDATE_FAILED:   return "ESP_ERR_OTA_VALIDATE_FAILED";
+        case ESP_ERR_WIFI_NOT_CONNECT:      return "ESP_ERR_WIFI_NOT_CONNECT";
+        case ESP_ERR_MESH_NOT_START:        return "ESP_ERR_MESH_NOT_START";
+        case ESP_ERR_MESH_ARGUMENT:         return "ESP_ERR_MESH_ARGUMENT";
+        case ESP_ERR_MESH_DISCONNECTED:     return "ESP_ERR_MESH_DISCONNECTED";
+        case ESP_ERR_MESH_NO_ROUTE_FOUND:   return "ESP_ERR_MESH_NO_ROUTE_FOUND";
+        case ESP_ERR_MESH_TIMEOUT:          return "ESP_ERR_MESH_TIMEOUT";
+        default:                            return "UNKNOWN ERROR";
+    }
+}
+
+static esp_log_level_t s_log_gateway = ESP_LOG_WARN;
+static esp_log_level_t s_log_nodes = ESP_LOG_ERROR;
+
+void sim_log_set_level(esp_log_level_t gateway, esp_log_level_t nodes)
+{
+    s_log_gateway = gateway;
+    s_log_nodes = nodes;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    (void)level;
+}
+
+void sim_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    int node = sim_rtos_node();
+    if (level > (node == SIM_GATEWAY ? s_log_gateway : s_log_nodes)) return;
+
+    if (node == SIM_GATEWAY) {
+        fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(sim_now_us() / 1000), tag);
+    } else {
+        fprintf(stderr, "%c (%lld) [node %d] %s: ", letters[level],
+                (long long)(sim_now_us() / 1000), node, tag);
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// ============================================================================
+// Random Numbers
+// ============================================================================
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ULL;
+
+void sim_rand_seed(uint64_t seed)
+{
+    // splitmix64 so that small seeds still give well-mixed state
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    s_rng = (z ^ (z >> 31)) | 1;
+}
+
+uint32_t sim_rand_u32(void)
+{
+    // xorshift64*
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+double sim_rand_unit(void)
+{
+    return sim_rand_u32() / 4294967296.0;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    // 240 MHz core; code takes no virtual time, so this only moves between blocking calls
+    return (uint32_t)(sim_now_us() * 240);
+}
+
+// ============================================================================
+// CRC32 and SHA-256
+// ============================================================================
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    // Same convention as the ROM function: pass the previous result to continue
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(mbedtls_sha256_context *ctx, const uint8_t *p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+               ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint32_t t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c; ctx->state[3] += d;
+    ctx->state[4] += e; ctx->state[5] += f; ctx->state[6] += g; ctx->state[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    if (is224) return -1;
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->total = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    size_t fill = ctx->total % 64;
+    ctx->total += ilen;
+
+    while (ilen > 0) {
+        size_t take = 64 - fill;
+        if (take > ilen) take = ilen;
+        memcpy(ctx->buffer + fill, input, take);
+        fill += take;
+        input += take;
+        ilen -= take;
+        if (fill == 64) {
+            sha256_block(ctx, ctx->buffer);
+            fill = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    uint64_t bits = ctx->total * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t fill = ctx->total % 64;
+    size_t pad_len = (fill < 56) ? 56 - fill : 120 - fill;
+
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    mbedtls_sha256_update(ctx, pad, pad_len + 8);
+
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+        output[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        output[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        output[4 * i + 3] = (uint8_t)ctx->state[i];
+    }
+    return 0;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32], int is224)
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    if (mbedtls_sha256_starts(&ctx, is224) != 0) return -1;
+    mbedtls_sha256_update(&ctx, input, ilen);
+    mbedtls_sha256_finish(&ctx, output);
+    mbedtls_sha256_free(&ctx);
+    return 0;
+}
+
+// ============================================================================
+// Partitions and OTA Slots
+// ============================================================================
+
+// gateway_mesh/partitions.csv app slots: ota_0 runs, ota_1 stages node images
+static const esp_partition_t s_gateway_slots[] = {
+    { .address = 0x20000, .size = 0x1E0000, .label = "ota_0" },
+    { .address = 0x200000, .size = 0x1E0000, .label = "ota_1" },
+};
+
+// node_mesh: factory image plus two OTA slots
+static const esp_partition_t s_node_slots[] = {
+    { .address = 0x20000, .size = 0x100000, .label = "factory" },
+    { .address = 0x120000, .size = 0x100000, .label = "ota_0" },
+    { .address = 0x220000, .size = 0x100000, .label = "ota_1" },
+};
+
+static const esp_partition_t *slots(int node, int *count)
+{
+    if (node == SIM_GATEWAY) {
+        *count = 2;
+        return s_gateway_slots;
+    }
+    *count = 3;
+    return s_node_slots;
+}
+
+static int slot_index(const esp_partition_t *partition)
+{
+    int count;
+    const esp_partition_t *table = slots(sim_rtos_node(), &count);
+    for (int i = 0; i < count; i++) {
+        if (partition == &table[i]) return i;
+    }
+    return -1;
+}
+
+static bool range_ok(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    return offset <= partition->size && size <= partition->size - offset;
+}
+
+static void flash_read(device_t *dev, int slot, size_t offset, uint8_t *dst, size_t size)
+{
+    while (size > 0) {
+        size_t sector = offset / SECTOR_SIZE;
+        size_t in = offset % SECTOR_SIZE;
+        size_t take = SECTOR_SIZE - in < size ? SECTOR_SIZE - in : size;
+        uint8_t *data = dev->sectors[slot] != NULL ? dev->sectors[slot][sector] : NULL;
+        if (data != NULL) {
+            memcpy(dst, data + in, take);
+        } else {
+            memset(dst, 0xFF, take);
+        }
+        dst += take;
+        offset += take;
+        size -= take;
+    }
+}
+
+static void flash_write(device_t *dev, int slot, size_t slot_size, size_t offset,
+                        const uint8_t *src, size_t size)
+{
+    if (dev->sectors[slot] == NULL) {
+        dev->sectors[slot] = calloc(slot_size / SECTOR_SIZE, sizeof(uint8_t *));
+        if (dev->sectors[slot] == NULL) abort();
+    }
+    while (size > 0) {
+        size_t sector = offset / SECTOR_SIZE;
+        size_t in = offset % SECTOR_SIZE;
+        size_t take = SECTOR_SIZE - in < size ? SECTOR_SIZE - in : size;
+        uint8_t **data = &dev->sectors[slot][sector];
+        if (*data == NULL) {
+            *data = malloc(SECTOR_SIZE);
+            if (*data == NULL) abort();
+            memset(*data, 0xFF, SECTOR_SIZE);
+        }
+        // NOR flash only clears bits
+        for (size_t i = 0; i < take; i++) {
+            (*data)[in + i] &= src[i];
+        }
+        src += take;
+        offset += take;
+        size -= take;
+    }
+}
+
+static void flash_erase(device_t *dev, int slot, size_t offset, size_t size)
+{
+    for (size_t sector = offset / SECTOR_SIZE; sector < (offset + size) / SECTOR_SIZE; sector++) {
+        if (dev->sectors[slot] != NULL) {
+            free(dev->sectors[slot][sector]);
+            dev->sectors[slot][sector] = NULL;
+        }
+        dev->stats.sectors_erased++;
+    }
+    sim_rtos_consume_us((int64_t)s_erase_us * (size / SECTOR_SIZE));
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset,
+                             void *dst, size_t size)
+{
+    int slot = slot_index(partition);
+    if (slot < 0 || !range_ok(partition, src_offset, size)) return ESP_ERR_INVALID_ARG;
+    flash_read(self(), slot, src_offset, dst, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset,
+                              const void *src, size_t size)
+{
+    int slot = slot_index(partition);
+    if (slot < 0 || !range_ok(partition, dst_offset, size)) return ESP_ERR_INVALID_ARG;
+    flash_write(self(), slot, partition->size, dst_offset, src, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (offset % SECTOR_SIZE != 0 || size % SECTOR_SIZE != 0) return ESP_ERR_INVALID_SIZE;
+    int slot = slot_index(partition);
+    if (slot < 0 || !range_ok(partition, offset, size)) return ESP_ERR_INVALID_ARG;
+    flash_erase(self(), slot, offset, size);
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    int count;
+    return &slots(sim_rtos_node(), &count)[self()->running];
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+    int count;
+    return &slots(sim_rtos_node(), &count)[self()->boot];
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    int count;
+    const esp_partition_t *table = slots(sim_rtos_node(), &count);
+    if (sim_rtos_node() == SIM_GATEWAY) return &table[1];
+
+    int from = start_from != NULL ? slot_index(start_from) : self()->running;
+    return &table[from == 1 ? 2 : 1];
+}
+
+/**
+ * What the bootloader checks before it boots a slot: the image magic byte
+ */
+static bool image_valid(device_t *dev, int slot)
+{
+    uint8_t magic;
+    flash_read(dev, slot, 0, &magic, 1);
+    return magic == 0xE9;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    device_t *dev = self();
+    int slot = slot_index(partition);
+    if (slot < 0 || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (slot == dev->running) return ESP_FAIL;
+    if (image_size != OTA_SIZE_UNKNOWN && image_size != OTA_WITH_SEQUENTIAL_WRITES &&
+        image_size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    dev->ota_sequential = (image_size == OTA_WITH_SEQUENTIAL_WRITES);
+    if (!dev->ota_sequential) {
+        size_t erase = (image_size == OTA_SIZE_UNKNOWN) ? partition->size
+                     : (image_size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        flash_erase(dev, slot, 0, erase);
+    }
+    dev->ota_slot = slot;
+    dev->ota_written = 0;
+    dev->ota_handle++;
+    if (dev->ota_handle == 0) dev->ota_handle = 1;
+    *out_handle = dev->ota_handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    device_t *dev = self();
+    int count;
+    const esp_partition_t *partition = &slots(sim_rtos_node(), &count)[dev->ota_slot];
+    if (handle == 0 || handle != dev->ota_handle) return ESP_ERR_INVALID_ARG;
+    if (!range_ok(partition, dev->ota_written, size)) return ESP_ERR_INVALID_SIZE;
+
+    if (dev->ota_sequential) {
+        size_t first = (dev->ota_written + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        size_t last = (dev->ota_written + size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (last > first) flash_erase(dev, dev->ota_slot, first * SECTOR_SIZE, (last - first) * SECTOR_SIZE);
+    }
+    flash_write(dev, dev->ota_slot, partition->size, dev->ota_written, data, size);
+    dev->ota_written += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    device_t *dev = self();
+    if (handle == 0 || handle != dev->ota_handle) return ESP_ERR_NOT_FOUND;
+    dev->ota_handle = 0;
+    if (dev->ota_written == 0 || !image_valid(dev, dev->ota_slot)) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    device_t *dev = self();
+    if (handle == 0 || handle != dev->ota_handle) return ESP_ERR_NOT_FOUND;
+    dev->ota_handle = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    device_t *dev = self();
+    int slot = slot_index(partition);
+    if (slot < 0) return ESP_ERR_INVALID_ARG;
+    if (!image_valid(dev, slot)) return ESP_ERR_OTA_VALIDATE_FAILED;
+    dev->boot = slot;
+    return ESP_OK;
+}
+
+const char *sim_idf_running_version(int node, const char *fallback)
+{
+    device_t *dev = device(node);
+    if (node == SIM_GATEWAY || dev->running == 0) return fallback;
+
+    uint8_t desc[48];
+    flash_read(dev, dev->running, SIM_APP_DESC_OFFSET, desc, sizeof(desc));
+    uint32_t magic = desc[0] | (desc[1] << 8) | (desc[2] << 16) | ((uint32_t)desc[3] << 24);
+    if (magic != SIM_APP_DESC_MAGIC) return fallback;
+
+    memcpy(dev->version, desc + 16, sizeof(dev->version));
+    dev->version[sizeof(dev->version) - 1] = '\0';
+    return dev->version;
+}
+
+const char *sim_idf_running_label(int node)
+{
+    int count;
+    return slots(node, &count)[device(node)->running].label;
+}
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+    // The gateway's; node firmware links its own (tools/mesh_sim/node)
+    static const esp_app_desc_t desc = {
+        .version = CONFIG_GATEWAY_FIRMWARE_VERSION "-sim",
+        .project_name = "omniapi_gateway_mesh",
+    };
+    return &desc;
+}
+
+// ============================================================================
+// Power and Reset
+// ============================================================================
+
+void sim_idf_power_on(int node, esp_reset_reason_t reason)
+{
+    device_t *dev = device(node);
+    dev->reset_reason = reason;
+    // Bootloader: the selected slot if it holds an image, else the factory app
+    dev->running = image_valid(dev, dev->boot) ? dev->boot : 0;
+    dev->boot = dev->running;
+    memset(dev->gpio_level, 0, sizeof(dev->gpio_level));
+    sim_rtos_boot_node(node);
+}
+
+void sim_idf_power_off(int node)
+{
+    device_t *dev = device(node);
+    dev->loop = false;
+    while (dev->head != NULL) {
+        posted_event_t *event = dev->head;
+        dev->head = event->next;
+        free(event);
+    }
+    dev->tail = NULL;
+    if (dev->pending != NULL) {
+        vSemaphoreDelete(dev->pending);
+        dev->pending = NULL;
+    }
+    memset(dev->handlers, 0, sizeof(dev->handlers));
+    dev->ota_handle = 0;
+}
+
+void esp_restart(void)
+{
+    if (sim_rtos_node() == SIM_GATEWAY || s_restart_hook == NULL || !sim_rtos_in_task()) {
+        fprintf(stderr, "mesh_sim: esp_restart() on device %d is not simulated\n", sim_rtos_node());
+        exit(3);
+    }
+    s_restart_hook();
+    abort();    // Not reached
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return self()->reset_reason;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 180 * 1024;
+}
+
+uint32_t esp_random(void)
+{
+    return sim_rand_u32();
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *bytes = buf;
+    for (size_t i = 0; i < len; i++) {
+        bytes[i] = (uint8_t)sim_rand_u32();
+    }
+}
+
+// ============================================================================
+// Default Event Loop
+// ============================================================================
+
+esp_event_base_t const MESH_EVENT = "MESH_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+static void event_task(void *arg)
+{
+    device_t *dev = self();
+    while (1) {
+        xSemaphoreTake(dev->pending, portMAX_DELAY);
+        posted_event_t *event = dev->head;
+        if (event == NULL) continue;
+        dev->head = event->next;
+        if (dev->head == NULL) dev->tail = NULL;
+
+        for (int i = 0; i < MAX_HANDLERS; i++) {
+            handler_entry_t entry = dev->handlers[i];
+            if (entry.handler != NULL && entry.base == event->base &&
+                (entry.id == ESP_EVENT_ANY_ID || entry.id == event->id)) {
+                entry.handler(entry.arg, event->base, event->id, event->data);
+            }
+        }
+        free(event);
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    device_t *dev = self();
+    if (dev->loop) return ESP_ERR_INVALID_STATE;
+
+    dev->pending = xSemaphoreCreateCounting(0x7FFFFFFF, 0);
+    if (dev->pending == NULL) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(event_task, "sys_evt", 4096, NULL, 20, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    dev->loop = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    device_t *dev = self();
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        handler_entry_t *entry = &dev->handlers[i];
+        if (entry->handler == event_handler && entry->base == event_base && entry->id == event_id) {
+            entry->arg = event_handler_arg;
+            return ESP_OK;
+        }
+    }
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        if (dev->handlers[i].handler == NULL) {
+            dev->handlers[i] = (handler_entry_t){ event_base, event_id, event_handler, event_handler_arg };
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler)
+{
+    device_t *dev = self();
+    for (int i = 0; i < MAX_HANDLERS; i++) {
+        handler_entry_t *entry = &dev->handlers[i];
+        if (entry->handler == event_handler && entry->base == event_base && entry->id == event_id) {
+            entry->handler = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+void sim_event_post(int node, esp_event_base_t event_base, int32_t event_id,
+                    const void *event_data, size_t event_data_size)
+{
+    device_t *dev = device(node);
+    if (!dev->loop) {
+        dev->stats.events_dropped++;
+        return;
+    }
+
+    posted_event_t *event = malloc(sizeof(posted_event_t) + event_data_size);
+    if (event == NULL) abort();
+    event->next = NULL;
+    event->base = event_base;
+    event->id = event_id;
+    if (event_data_size > 0) memcpy(event->data, event_data, event_data_size);
+
+    if (dev->tail != NULL) {
+        dev->tail->next = event;
+    } else {
+        dev->head = event;
+    }
+    dev->tail = event;
+    xSemaphoreGive(dev->pending);
+}
+
+// ============================================================================
+// WiFi, netif and MAC
+// ============================================================================
+
+struct esp_netif_obj {
+    int unused;
+};
+
+static struct esp_netif_obj s_netif_sta;
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_create_default_wifi_mesh_netifs(esp_netif_t **p_netif_sta, esp_netif_t **p_netif_ap)
+{
+    if (p_netif_sta) *p_netif_sta = &s_netif_sta;
+    if (p_netif_ap) *p_netif_ap = NULL;
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key)
+{
+    return strcmp(if_key, "WIFI_STA_DEF") == 0 ? &s_netif_sta : NULL;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info)
+{
+    memset(ip_info, 0, sizeof(*ip_info));
+    // Only the root has an address (DHCP from the router)
+    if (sim_rtos_node() == SIM_GATEWAY && sim_mesh_node_layer(SIM_GATEWAY) == 1) {
+        static const uint8_t ip[4] = { 192, 168, 1, 50 };
+        static const uint8_t gw[4] = { 192, 168, 1, 1 };
+        static const uint8_t mask[4] = { 255, 255, 255, 0 };
+        memcpy(&ip_info->ip.addr, ip, 4);
+        memcpy(&ip_info->gw.addr, gw, 4);
+        memcpy(&ip_info->netmask.addr, mask, 4);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *esp_netif)
+{
+    (void)esp_netif;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *esp_netif)
+{
+    (void)esp_netif;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    (void)storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    // Derived from the station MAC as on the ESP32: softAP +1, BT +2, Ethernet +3
+    memcpy(mac, sim_mesh_node_mac(sim_rtos_node()), 6);
+    mac[5] += (uint8_t)type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6])
+{
+    return esp_read_mac(mac, ifx == WIFI_IF_AP ? ESP_MAC_WIFI_SOFTAP : ESP_MAC_WIFI_STA);
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    memset(ap_info, 0, sizeof(*ap_info));
+    if (!sim_mesh_node_link(sim_rtos_node(), ap_info->bssid, &ap_info->rssi)) {
+        return ESP_ERR_WIFI_NOT_CONNECT;
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// Relay Outputs (GPIO and UART)
+// ============================================================================
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return (gpio_num >= 0 && gpio_num < MAX_GPIO) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)mode;
+    return gpio_reset_pin(gpio_num);
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= MAX_GPIO) return ESP_ERR_INVALID_ARG;
+    device_t *dev = self();
+    if (dev->gpio_level[gpio_num] != (level != 0)) {
+        dev->gpio_level[gpio_num] = (level != 0);
+        dev->stats.actuations++;
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= MAX_GPIO) return 0;
+    return self()->gpio_level[gpio_num];
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    // Each write is one command frame to the relay module
+    self()->stats.actuations++;
+    return (int)size;
+}
@@ -0,0 +1,485 @@
+/**
+ * OmniaPi Mesh Simulator - Minimal cJSON
+ *
+ * Builds, prints and parses trees with the cJSON API the gateway modules
+ * use, so their *_json() status functions go into the report unchanged and
+ * mqtt_handler.c can parse the commands the harness publishes. The parser
+ * takes strict JSON only (no comments, no trailing commas).
+ */
+
+#include "cJSON.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+static cJSON *item_new(int type)
+{
+    cJSON *item = calloc(1, sizeof(cJSON));
+    if (item == NULL) abort();
+    item->type = type;
+    return item;
+}
+
+static char *dup_string(const char *string)
+{
+    char *copy = strdup(string ? string : "");
+    if (copy == NULL) abort();
+    return copy;
+}
+
+cJSON *cJSON_CreateObject(void)
+{
+    return item_new(cJSON_Object);
+}
+
+cJSON *cJSON_CreateArray(void)
+{
+    return item_new(cJSON_Array);
+}
+
+cJSON *cJSON_CreateNumber(double num)
+{
+    cJSON *item = item_new(cJSON_Number);
+    item->valuedouble = num;
+    item->valueint = (num >= 2147483647.0) ? 2147483647 : (num <= -2147483648.0) ? (-2147483647 - 1) : (int)num;
+    return item;
+}
+
+cJSON *cJSON_CreateString(const char *string)
+{
+    cJSON *item = item_new(cJSON_String);
+    item->valuestring = dup_string(string);
+    return item;
+}
+
+cJSON *cJSON_CreateBool(bool boolean)
+{
+    return item_new(boolean ? cJSON_True : cJSON_False);
+}
+
+cJSON *cJSON_CreateNull(void)
+{
+    return item_new(cJSON_NULL);
+}
+
+bool cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    if (array == NULL || item == NULL) return false;
+
+    cJSON **tail = &array->child;
+    while (*tail != NULL) tail = &(*tail)->next;
+    *tail = item;
+    return true;
+}
+
+bool cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
+{
+    if (object == NULL || string == NULL || item == NULL) return false;
+
+    free(item->string);
+    item->string = dup_string(string);
+    return cJSON_AddItemToArray(object, item);
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    cJSON *item = cJSON_CreateNumber(number);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    cJSON *item = cJSON_CreateString(string);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON *cJSON_AddBoolToObject(cJSON *object, const char *name, bool boolean)
+{
+    cJSON *item = cJSON_CreateBool(boolean);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON *cJSON_AddNullToObject(cJSON *object, const char *name)
+{
+    cJSON *item = cJSON_CreateNull();
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name)
+{
+    cJSON *item = cJSON_CreateArray();
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string)
+{
+    if (object == NULL || string == NULL) return NULL;
+
+    for (cJSON *item = object->child; item != NULL; item = item->next) {
+        if (item->string != NULL && strcmp(item->string, string) == 0) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+int cJSON_GetArraySize(const cJSON *array)
+{
+    int count = 0;
+    if (array == NULL) return 0;
+    for (cJSON *item = array->child; item != NULL; item = item->next) count++;
+    return count;
+}
+
+cJSON *cJSON_GetArrayItem(const cJSON *array, int index)
+{
+    if (array == NULL || index < 0) return NULL;
+    cJSON *item = array->child;
+    while (item != NULL && index-- > 0) item = item->next;
+    return item;
+}
+
+bool cJSON_IsString(const cJSON *item) { return item != NULL && item->type == cJSON_String; }
+bool cJSON_IsNumber(const cJSON *item) { return item != NULL && item->type == cJSON_Number; }
+bool cJSON_IsArray(const cJSON *item)  { return item != NULL && item->type == cJSON_Array; }
+bool cJSON_IsObject(const cJSON *item) { return item != NULL && item->type == cJSON_Object; }
+bool cJSON_IsBool(const cJSON *item)   { return item != NULL && (item->type & (cJSON_True | cJSON_False)); }
+bool cJSON_IsTrue(const cJSON *item)   { return item != NULL && item->type == cJSON_True; }
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item != NULL) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void *object)
+{
+    free(object);
+}
+
+// ============================================================================
+// Printing
+// ============================================================================
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} out_t;
+
+static void out_printf(out_t *out, const char *fmt, ...)
+{
+    va_list args;
+    while (1) {
+        va_start(args, fmt);
+        int n = vsnprintf(out->buf + out->len, out->cap - out->len, fmt, args);
+        va_end(args);
+        if (n < 0) abort();
+        if (out->len + (size_t)n < out->cap) {
+            out->len += (size_t)n;
+            return;
+        }
+        out->cap = (out->cap + (size_t)n + 1) * 2;
+        out->buf = realloc(out->buf, out->cap);
+        if (out->buf == NULL) abort();
+    }
+}
+
+static void print_string(out_t *out, const char *string)
+{
+    out_printf(out, "\"");
+    for (const unsigned char *p = (const unsigned char *)string; *p; p++) {
+        switch (*p) {
+            case '"':  out_printf(out, "\\\""); break;
+            case '\\': out_printf(out, "\\\\"); break;
+            case '\n': out_printf(out, "\\n"); break;
+            case '\r': out_printf(out, "\\r"); break;
+            case '\t': out_printf(out, "\\t"); break;
+            default:
+                if (*p < 0x20) {
+                    out_printf(out, "\\u%04x", *p);
+                } else {
+                    out_printf(out, "%c", *p);
+                }
+                break;
+        }
+    }
+    out_printf(out, "\"");
+}
+
+static void print_number(out_t *out, double number)
+{
+    if (isnan(number) || isinf(number)) {
+        out_printf(out, "null");
+    } else if (number == floor(number) && fabs(number) < 1e15) {
+        out_printf(out, "%.0f", number);
+    } else {
+        out_printf(out, "%1.15g", number);
+    }
+}
+
+static void print_item(out_t *out, const cJSON *item, bool format, int depth)
+{
+    switch (item->type) {
+        case cJSON_False:  out_printf(out, "false"); return;
+        case cJSON_True:   out_printf(out, "true"); return;
+        case cJSON_NULL:   out_printf(out, "null"); return;
+        case cJSON_Number: print_number(out, item->valuedouble); return;
+        case cJSON_String: print_string(out, item->valuestring); return;
+        default: break;
+    }
+
+    bool object = (item->type == cJSON_Object);
+    out_printf(out, object ? "{" : "[");
+    for (const cJSON *child = item->child; child != NULL; child = child->next) {
+        if (format) out_printf(out, "\n%*s", (depth + 1) * 2, "");
+        if (object) {
+            print_string(out, child->string ? child->string : "");
+            out_printf(out, format ? ": " : ":");
+        }
+        print_item(out, child, format, depth + 1);
+        if (child->next != NULL) out_printf(out, ",");
+    }
+    if (format && item->child != NULL) out_printf(out, "\n%*s", depth * 2, "");
+    out_printf(out, object ? "}" : "]");
+}
+
+static char *print_root(const cJSON *item, bool format)
+{
+    if (item == NULL) return NULL;
+
+    out_t out = { .buf = NULL, .len = 0, .cap = 0 };
+    print_item(&out, item, format, 0);
+    return out.buf;
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    return print_root(item, true);
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item)
+{
+    return print_root(item, false);
+}
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+typedef struct {
+    const char *p;
+    const char *end;
+} in_t;
+
+static void skip_space(in_t *in)
+{
+    while (in->p < in->end && (*in->p == ' ' || *in->p == '\t' || *in->p == '\n' || *in->p == '\r')) {
+        in->p++;
+    }
+}
+
+static bool take_literal(in_t *in, const char *literal)
+{
+    size_t len = strlen(literal);
+    if ((size_t)(in->end - in->p) < len || memcmp(in->p, literal, len) != 0) return false;
+    in->p += len;
+    return true;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * String at in->p (opening quote included), UTF-8 encoded, NULL if malformed
+ */
+static char *parse_string(in_t *in)
+{
+    if (in->p >= in->end || *in->p != '"') return NULL;
+    in->p++;
+
+    out_t out = { .buf = NULL, .len = 0, .cap = 0 };
+    out_printf(&out, "%s", "");
+    while (in->p < in->end && *in->p != '"') {
+        char c = *in->p++;
+        if ((unsigned char)c < 0x20) goto fail;
+        if (c != '\\') {
+            out_printf(&out, "%c", c);
+            continue;
+        }
+        if (in->p >= in->end) goto fail;
+        c = *in->p++;
+        switch (c) {
+            case '"':  out_printf(&out, "\""); break;
+            case '\\': out_printf(&out, "\\"); break;
+            case '/':  out_printf(&out, "/"); break;
+            case 'b':  out_printf(&out, "\b"); break;
+            case 'f':  out_printf(&out, "\f"); break;
+            case 'n':  out_printf(&out, "\n"); break;
+            case 'r':  out_printf(&out, "\r"); break;
+            case 't':  out_printf(&out, "\t"); break;
+            case 'u': {
+                if (in->end - in->p < 4) goto fail;
+                unsigned code = 0;
+                for (int i = 0; i < 4; i++) {
+                    int digit = hex_digit(*in->p++);
+                    if (digit < 0) goto fail;
+                    code = (code << 4) | (unsigned)digit;
+                }
+                // Surrogate pairs are not needed by any command; keep the BMP
+                if (code < 0x80) {
+                    out_printf(&out, "%c", (char)code);
+                } else if (code < 0x800) {
+                    out_printf(&out, "%c%c", (char)(0xC0 | (code >> 6)), (char)(0x80 | (code & 0x3F)));
+                } else {
+                    out_printf(&out, "%c%c%c", (char)(0xE0 | (code >> 12)),
+                               (char)(0x80 | ((code >> 6) & 0x3F)), (char)(0x80 | (code & 0x3F)));
+                }
+                break;
+            }
+            default:
+                goto fail;
+        }
+    }
+    if (in->p >= in->end) goto fail;
+    in->p++;
+    return out.buf;
+
+fail:
+    free(out.buf);
+    return NULL;
+}
+
+static cJSON *parse_value(in_t *in, int depth);
+
+static cJSON *parse_container(in_t *in, int depth, bool object)
+{
+    cJSON *container = item_new(object ? cJSON_Object : cJSON_Array);
+    char close = object ? '}' : ']';
+    in->p++;
+
+    skip_space(in);
+    if (in->p < in->end && *in->p == close) {
+        in->p++;
+        return container;
+    }
+
+    while (1) {
+        char *name = NULL;
+        skip_space(in);
+        if (object) {
+            name = parse_string(in);
+            if (name == NULL) goto fail;
+            skip_space(in);
+            if (in->p >= in->end || *in->p != ':') {
+                free(name);
+                goto fail;
+            }
+            in->p++;
+        }
+
+        cJSON *item = parse_value(in, depth + 1);
+        if (item == NULL) {
+            free(name);
+            goto fail;
+        }
+        item->string = name;
+        cJSON_AddItemToArray(container, item);
+
+        skip_space(in);
+        if (in->p >= in->end) goto fail;
+        if (*in->p == ',') {
+            in->p++;
+            continue;
+        }
+        if (*in->p != close) goto fail;
+        in->p++;
+        return container;
+    }
+
+fail:
+    cJSON_Delete(container);
+    return NULL;
+}
+
+static cJSON *parse_value(in_t *in, int depth)
+{
+    if (depth > 32) return NULL;
+    skip_space(in);
+    if (in->p >= in->end) return NULL;
+
+    switch (*in->p) {
+        case '{': return parse_container(in, depth, true);
+        case '[': return parse_container(in, depth, false);
+        case '"': {
+            char *string = parse_string(in);
+            if (string == NULL) return NULL;
+            cJSON *item = item_new(cJSON_String);
+            item->valuestring = string;
+            return item;
+        }
+        case 't': return take_literal(in, "true") ? item_new(cJSON_True) : NULL;
+        case 'f': return take_literal(in, "false") ? item_new(cJSON_False) : NULL;
+        case 'n': return take_literal(in, "null") ? item_new(cJSON_NULL) : NULL;
+        default: break;
+    }
+
+    // Number: copy the candidate characters so strtod cannot run past the end
+    char number[64];
+    size_t len = 0;
+    while (in->p + len < in->end && len < sizeof(number) - 1 &&
+           strchr("+-0123456789.eE", in->p[len]) != NULL) {
+        number[len] = in->p[len];
+        len++;
+    }
+    number[len] = '\0';
+    char *stop = NULL;
+    double value = strtod(number, &stop);
+    if (len == 0 || stop != number + len) return NULL;
+    in->p += len;
+    return cJSON_CreateNumber(value);
+}
+
+cJSON *cJSON_ParseWithLength(const char *value, size_t buffer_length)
+{
+    if (value == NULL) return NULL;
+
+    in_t in = { .p = value, .end = value + buffer_length };
+    cJSON *item = parse_value(&in, 0);
+    if (item == NULL) return NULL;
+
+    // A NUL ends the text, as in cJSON; anything else after the value is an error
+    skip_space(&in);
+    if (in.p < in.end && *in.p != '\0') {
+        cJSON_Delete(item);
+        return NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_Parse(const char *value)
+{
+    return value != NULL ? cJSON_ParseWithLength(value, strlen(value)) : NULL;
+}
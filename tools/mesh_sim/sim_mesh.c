@@ -0,0 +1,1265 @@
+/**
+ * OmniaPi Mesh Simulator - Radio and esp_mesh_* Shim
+ *
+ * Every device runs its own esp_mesh_* state: the gateway's mesh_network.c
+ * as fixed root, each node's mesh_node.c as a non-root node. A started,
+ * self-organized node scans for a parent, associates and is placed in the
+ * tree the way ESP-WIFI-MESH does it: same mesh ID and password, a parent
+ * below the max layer with a free softAP slot, and room in the root's
+ * routing table. esp_mesh_set_parent() associates with a given parent
+ * instead (the node's fast rejoin and parent switch), retrying until it
+ * can be taken; a connected node lets go of its parent for it, so if the
+ * new one cannot be taken it is left without any until mesh_node.c gives
+ * up and scans.
+ *
+ * A node that leaves (mesh stopped, parent gone) takes its subtree with
+ * it: every node below gets PARENT_DISCONNECTED and scans again. A node
+ * that loses power goes silent at once, and its neighbours notice after
+ * the beacon timeout (loss_detect_us).
+ *
+ * Link model, per hop:
+ * - a radio sends or receives one frame at a time, so a hop waits until
+ *   both ends are free and then holds both for the frame's air time at the
+ *   configured bandwidth (the gateway's radio is shared by all its children);
+ * - after the air time the frame arrives latency + 0..jitter later;
+ * - it is lost with the configured probability (loss after link retries),
+ *   or if a relay on the way has lost power.
+ * A frame reserves every hop of its path when it is sent, which is close
+ * enough while a few frames compete but not a collision model.
+ *
+ * The random and bfs topologies have no geometry: every device hears every
+ * other one. The house topology places the devices on the floors of a
+ * house, gateway in a ground floor corner where the router is. RSSI then
+ * follows distance, walls (a 4 m room grid) and floors; links below
+ * HOUSE_RSSI_MIN do not exist, weaker links lose more frames and fall back
+ * to slower rates, and a joining node takes the shallowest parent it hears
+ * above HOUSE_RSSI_GOOD (ESP-WIFI-MESH's preference), else the strongest.
+ *
+ * Frames for the gateway wait in its receive queue until mesh_network.c
+ * calls esp_mesh_recv(). Past the XON queue size, senders are held back
+ * (the frame keeps its arrival time) instead of dropped, as mesh flow
+ * control does. A node's queue drops what does not fit.
+ */
+
+#include "sim.h"
+#include "esp_mesh.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_PARENT_REPORT_SCANS  15      // NO_PARENT_FOUND after this many empty scans
+#define REASON_LEAVE            8       // WIFI_REASON_ASSOC_LEAVE
+#define REASON_BEACON_TIMEOUT   200     // WIFI_REASON_BEACON_TIMEOUT
+#define REASON_NO_AP_FOUND      201     // WIFI_REASON_NO_AP_FOUND
+
+// House topology
+#define HOUSE_AREA_PER_NODE     12.0    // Floor area per device, m^2
+#define HOUSE_NODES_PER_FLOOR   20
+#define HOUSE_MAX_FLOORS        4
+#define HOUSE_ROOM_M            4.0     // Room grid; every boundary crossed is a wall
+#define HOUSE_RSSI_1M           (-38.0) // At 1 m, antennas included
+#define HOUSE_PATH_EXPONENT     2.8
+#define HOUSE_WALL_DB           4.0
+#define HOUSE_FLOOR_DB          14.0
+#define HOUSE_RSSI_GOOD         (-78)   // Parent preference threshold
+#define HOUSE_RSSI_RATE_HALF    (-72)   // Rate fallback below these
+#define HOUSE_RSSI_RATE_QUARTER (-80)
+#define HOUSE_RSSI_LOSSY        (-75)   // Frame loss rises from here...
+#define HOUSE_RSSI_MIN          (-88)   // ...to HOUSE_LOSS_MAX here; no link below
+#define HOUSE_LOSS_MAX          0.2
+
+// ============================================================================
+// State
+// ============================================================================
+
+typedef struct frame {
+    struct frame *next;
+    int src;                    // Sending device
+    int dst;                    // Receiving device
+    int64_t arrived_us;
+    uint16_t len;
+    uint8_t data[];
+} frame_t;
+
+typedef struct {
+    uint8_t mac[6];
+
+    // esp_mesh_* state of the device
+    bool initialized;
+    bool started;
+    mesh_cfg_t cfg;
+    int max_layer;
+    int capacity;
+    int xon_qsize;
+    bool self_organized;
+
+    // Place in the tree
+    bool connected;
+    int parent;
+    int layer;                  // Gateway = 1
+    int children;
+    bool dead;                  // Lost power, neighbours have not noticed yet
+    uint32_t dead_gen;
+
+    uint32_t epoch;             // Bumped on stop and power loss: frames in flight are dropped
+    uint32_t action;            // Bumped to cancel a pending scan or association
+    int assoc_target;
+    int scan_fails;
+    int64_t radio_busy_us;
+
+    // House topology
+    double x, y;
+    int floor;
+
+    // Receive queue (nodes; the gateway's is below)
+    frame_t *rx_head;
+    frame_t *rx_tail;
+    uint32_t rx_depth;
+} slot_t;
+
+static sim_mesh_config_t s_cfg;
+static slot_t s_slots[SIM_MAX_NODES + 1];
+static int s_slot_count = 1;
+
+// Routing table as seen by the gateway: itself first, then nodes in join order
+static int s_route[SIM_MAX_NODES + 1];
+static int s_route_count = 0;
+
+// Gateway receive queue, and frames held back by flow control
+static frame_t *s_rx_head = NULL;
+static frame_t *s_rx_tail = NULL;
+static uint32_t s_rx_depth = 0;
+static frame_t *s_held_head = NULL;
+static frame_t *s_held_tail = NULL;
+
+static uint32_t *s_rx_waits = NULL;
+static size_t s_rx_wait_count = 0;
+static size_t s_rx_wait_cap = 0;
+
+static void (*s_rx_tap)(const uint8_t *src, const uint8_t *data, size_t len) = NULL;
+
+static sim_mesh_stats_t s_stats = {0};
+
+static slot_t *self(void)
+{
+    return &s_slots[sim_rtos_node()];
+}
+
+static void reset_mesh_state(slot_t *slot)
+{
+    slot->initialized = false;
+    slot->started = false;
+    memset(&slot->cfg, 0, sizeof(slot->cfg));
+    slot->max_layer = CONFIG_MESH_MAX_LAYER;
+    slot->capacity = 300;           // ESP-IDF default
+    slot->xon_qsize = 32;
+    slot->self_organized = true;
+}
+
+// ============================================================================
+// House Layout
+// ============================================================================
+
+/**
+ * Square floors, stacked; the gateway at (1, 1) on the ground floor and
+ * the nodes spread at random over all floors
+ */
+static void place_house(void)
+{
+    int floors = 1 + (s_slot_count - 1) / HOUSE_NODES_PER_FLOOR;
+    if (floors > HOUSE_MAX_FLOORS) floors = HOUSE_MAX_FLOORS;
+    double side = sqrt(HOUSE_AREA_PER_NODE * s_slot_count / floors);
+
+    s_slots[0].x = 1.0;
+    s_slots[0].y = 1.0;
+    s_slots[0].floor = 0;
+    for (int i = 1; i < s_slot_count; i++) {
+        s_slots[i].x = sim_rand_unit() * side;
+        s_slots[i].y = sim_rand_unit() * side;
+        s_slots[i].floor = (int)(sim_rand_u32() % floors);
+    }
+}
+
+static int link_rssi(int a, int b)
+{
+    if (s_cfg.topology != SIM_TOPO_HOUSE) return -60;
+
+    const slot_t *p = &s_slots[a];
+    const slot_t *q = &s_slots[b];
+    double dx = p->x - q->x, dy = p->y - q->y, dz = (p->floor - q->floor) * 3.0;
+    double d = sqrt(dx * dx + dy * dy + dz * dz);
+    int walls = abs((int)(p->x / HOUSE_ROOM_M) - (int)(q->x / HOUSE_ROOM_M)) +
+                abs((int)(p->y / HOUSE_ROOM_M) - (int)(q->y / HOUSE_ROOM_M));
+    double rssi = HOUSE_RSSI_1M - 10.0 * HOUSE_PATH_EXPONENT * log10(d < 1.0 ? 1.0 : d) -
+                  HOUSE_WALL_DB * walls - HOUSE_FLOOR_DB * abs(p->floor - q->floor);
+    return (int)lround(rssi);
+}
+
+static bool in_range(int a, int b)
+{
+    return link_rssi(a, b) >= HOUSE_RSSI_MIN;
+}
+
+/**
+ * Frame loss after link retries on a hop: none on good links, rising
+ * linearly to HOUSE_LOSS_MAX at the edge of range
+ */
+static double link_loss(int rssi)
+{
+    if (rssi >= HOUSE_RSSI_LOSSY) return 0;
+    return HOUSE_LOSS_MAX * (HOUSE_RSSI_LOSSY - rssi) / (double)(HOUSE_RSSI_LOSSY - HOUSE_RSSI_MIN);
+}
+
+/**
+ * Air time at the configured rate, longer on links that fell back
+ */
+static int64_t link_air_us(int rssi, int64_t air_us)
+{
+    if (rssi < HOUSE_RSSI_RATE_QUARTER) return air_us * 4;
+    if (rssi < HOUSE_RSSI_RATE_HALF) return air_us * 2;
+    return air_us;
+}
+
+void sim_mesh_configure(const sim_mesh_config_t *config)
+{
+    s_cfg = *config;
+    if (s_cfg.nodes > SIM_MAX_NODES) s_cfg.nodes = SIM_MAX_NODES;
+    s_slot_count = s_cfg.nodes + 1;
+
+    memset(s_slots, 0, sizeof(s_slots));
+    for (int i = 0; i < s_slot_count; i++) {
+        slot_t *slot = &s_slots[i];
+        uint8_t *mac = slot->mac;
+        mac[0] = 0x24; mac[1] = 0x0A; mac[2] = 0xC4;
+        if (i == 0) {
+            mac[3] = 0x00; mac[4] = 0x00; mac[5] = 0x00;
+        } else {
+            // Even last byte: softAP MAC (+1) never collides with another node
+            mac[3] = 0x10; mac[4] = (uint8_t)(i >> 7); mac[5] = (uint8_t)((i & 0x7F) << 1);
+        }
+        reset_mesh_state(slot);
+        slot->parent = -1;
+        slot->layer = -1;
+        slot->assoc_target = -1;
+    }
+    if (s_cfg.topology == SIM_TOPO_HOUSE) place_house();
+}
+
+const sim_mesh_config_t *sim_mesh_get_config(void)
+{
+    return &s_cfg;
+}
+
+void sim_mesh_set_rx_tap(void (*tap)(const uint8_t *src, const uint8_t *data, size_t len))
+{
+    s_rx_tap = tap;
+}
+
+// ============================================================================
+// Frame Queues
+// ============================================================================
+
+static frame_t *frame_new(int src, int dst, const uint8_t *data, size_t len)
+{
+    frame_t *frame = malloc(sizeof(frame_t) + len);
+    if (frame == NULL) abort();
+    frame->next = NULL;
+    frame->src = src;
+    frame->dst = dst;
+    frame->arrived_us = 0;
+    frame->len = (uint16_t)len;
+    memcpy(frame->data, data, len);
+    return frame;
+}
+
+static void queue_append(frame_t **head, frame_t **tail, frame_t *frame)
+{
+    frame->next = NULL;
+    if (*tail) {
+        (*tail)->next = frame;
+    } else {
+        *head = frame;
+    }
+    *tail = frame;
+}
+
+static frame_t *queue_pop(frame_t **head, frame_t **tail)
+{
+    frame_t *frame = *head;
+    if (frame) {
+        *head = frame->next;
+        if (*head == NULL) *tail = NULL;
+    }
+    return frame;
+}
+
+static void queue_clear(frame_t **head, frame_t **tail)
+{
+    frame_t *frame;
+    while ((frame = queue_pop(head, tail)) != NULL) free(frame);
+}
+
+// ============================================================================
+// Tree
+// ============================================================================
+
+static void post(int node, int32_t id, const void *data, size_t size)
+{
+    // A device that lost power has no event loop to take it
+    if (s_slots[node].dead) return;
+    sim_event_post(node, MESH_EVENT, id, data, size);
+}
+
+static void softap_mac(int index, uint8_t *mac)
+{
+    memcpy(mac, s_slots[index].mac, 6);
+    mac[5] += 1;
+}
+
+static bool in_subtree(int node, int top)
+{
+    for (int n = node; n >= 0; n = (n == 0) ? -1 : s_slots[n].parent) {
+        if (n == top) return true;
+        if (!s_slots[n].connected) return false;
+    }
+    return false;
+}
+
+static int subtree_size(int top)
+{
+    int count = 0;
+    for (int i = 0; i < s_slot_count; i++) {
+        if (s_slots[i].connected && in_subtree(i, top)) count++;
+    }
+    return count;
+}
+
+/**
+ * Layers below top in its subtree (0 = a leaf)
+ */
+static int subtree_depth(int top)
+{
+    int depth = 0;
+    for (int i = 1; i < s_slot_count; i++) {
+        if (s_slots[i].connected && in_subtree(i, top) && s_slots[i].layer - s_slots[top].layer > depth) {
+            depth = s_slots[i].layer - s_slots[top].layer;
+        }
+    }
+    return depth;
+}
+
+static void route_add(int node)
+{
+    s_route[s_route_count++] = node;
+}
+
+static void route_remove(int node)
+{
+    for (int i = 1; i < s_route_count; i++) {
+        if (s_route[i] == node) {
+            memmove(&s_route[i], &s_route[i + 1], (s_route_count - i - 1) * sizeof(int));
+            s_route_count--;
+            return;
+        }
+    }
+}
+
+static void post_routing_change(int from, int32_t id, int change)
+{
+    for (int a = from; a >= 0; a = (a == 0) ? -1 : s_slots[a].parent) {
+        mesh_event_routing_table_change_t rt = {
+            .rt_size_new = (uint16_t)(a == 0 ? s_route_count : subtree_size(a)),
+            .rt_size_change = (uint16_t)change,
+        };
+        post(a, id, &rt, sizeof(rt));
+    }
+}
+
+static void post_parent_connected(int node)
+{
+    slot_t *slot = &s_slots[node];
+    mesh_event_connected_t connected = { .self_layer = (uint16_t)slot->layer };
+    softap_mac(slot->parent, connected.connected.bssid);
+    connected.connected.channel = s_slots[0].cfg.channel;
+    post(node, MESH_EVENT_PARENT_CONNECTED, &connected, sizeof(connected));
+}
+
+static void post_child(int parent, int32_t id, int child)
+{
+    mesh_event_child_connected_t event = { .aid = (uint8_t)s_slots[parent].children };
+    memcpy(event.mac, s_slots[child].mac, 6);
+    post(parent, id, &event, sizeof(event));
+}
+
+static void start_scan(int node);
+static void associate(int node, int target);
+
+static void attach(int node, int parent)
+{
+    slot_t *slot = &s_slots[node];
+    slot->connected = true;
+    slot->parent = parent;
+    slot->layer = s_slots[parent].layer + 1;
+    slot->scan_fails = 0;
+    s_slots[parent].children++;
+    route_add(node);
+    s_stats.joins++;
+
+    post_parent_connected(node);
+    mesh_event_root_address_t root;
+    memcpy(root.addr, s_slots[0].mac, 6);
+    post(node, MESH_EVENT_ROOT_ADDRESS, &root, sizeof(root));
+    mesh_event_toDS_state_t tods = 1;
+    post(node, MESH_EVENT_TODS_STATE, &tods, sizeof(tods));
+
+    post_child(parent, MESH_EVENT_CHILD_CONNECTED, node);
+    post_routing_change(parent, MESH_EVENT_ROUTING_TABLE_ADD, 1);
+}
+
+/**
+ * node leaves its parent with its whole subtree. Every node below is told
+ * and scans again; node itself only if tell_self.
+ */
+static void detach(int node, bool tell_self, uint8_t reason)
+{
+    int *members = malloc(sizeof(int) * s_slot_count);
+    if (members == NULL) abort();
+    int count = 0;
+    for (int i = 1; i < s_slot_count; i++) {
+        if (s_slots[i].connected && in_subtree(i, node)) members[count++] = i;
+    }
+
+    int parent = s_slots[node].parent;
+    s_slots[parent].children--;
+    for (int m = 0; m < count; m++) {
+        slot_t *slot = &s_slots[members[m]];
+        slot->connected = false;
+        route_remove(members[m]);
+        queue_clear(&slot->rx_head, &slot->rx_tail);
+        slot->rx_depth = 0;
+        s_stats.leaves++;
+    }
+    post_child(parent, MESH_EVENT_CHILD_DISCONNECTED, node);
+    post_routing_change(parent, MESH_EVENT_ROUTING_TABLE_REMOVE, count);
+
+    for (int m = 0; m < count; m++) {
+        int index = members[m];
+        slot_t *slot = &s_slots[index];
+        slot->parent = -1;
+        slot->layer = -1;
+        slot->children = 0;
+        if ((index != node || tell_self) && slot->started) {
+            mesh_event_disconnected_t disc = { .reason = reason };
+            softap_mac(parent, disc.bssid);
+            post(index, MESH_EVENT_PARENT_DISCONNECTED, &disc, sizeof(disc));
+            if (slot->self_organized) start_scan(index);
+        }
+    }
+    free(members);
+}
+
+/**
+ * Manual parent switch of a connected node: the subtree moves with it
+ */
+static void move(int node, int parent)
+{
+    slot_t *slot = &s_slots[node];
+    int old = slot->parent;
+    int size = subtree_size(node);
+
+    s_slots[old].children--;
+    post_child(old, MESH_EVENT_CHILD_DISCONNECTED, node);
+    slot->parent = -1;          // Outside the tree while the old branch is told
+    post_routing_change(old, MESH_EVENT_ROUTING_TABLE_REMOVE, size);
+
+    int shift = s_slots[parent].layer + 1 - slot->layer;
+    slot->parent = parent;
+    s_slots[parent].children++;
+    for (int i = 1; i < s_slot_count; i++) {
+        if (i != node && s_slots[i].connected && in_subtree(i, node)) {
+            s_slots[i].layer += shift;
+            if (shift != 0) {
+                mesh_event_layer_change_t change = { .new_layer = s_slots[i].layer };
+                post(i, MESH_EVENT_LAYER_CHANGE, &change, sizeof(change));
+            }
+        }
+    }
+    slot->layer += shift;
+    s_stats.joins++;
+
+    post_parent_connected(node);
+    post_child(parent, MESH_EVENT_CHILD_CONNECTED, node);
+    post_routing_change(parent, MESH_EVENT_ROUTING_TABLE_ADD, size);
+}
+
+/**
+ * May node take parent now?
+ */
+static bool can_attach(int node, int parent)
+{
+    slot_t *slot = &s_slots[node];
+    slot_t *p = &s_slots[parent];
+    if (parent < 0 || parent == node || !p->started || !p->connected || p->dead) return false;
+    if (memcmp(p->cfg.mesh_id.addr, slot->cfg.mesh_id.addr, 6) != 0) return false;
+    if (strncmp((const char *)p->cfg.mesh_ap.password, (const char *)slot->cfg.mesh_ap.password,
+                sizeof(p->cfg.mesh_ap.password)) != 0) {
+        return false;
+    }
+    if (p->children >= p->cfg.mesh_ap.max_connection) return false;
+    if (!in_range(node, parent)) return false;
+
+    int max_layer = slot->max_layer < s_slots[0].max_layer ? slot->max_layer : s_slots[0].max_layer;
+    if (slot->connected) {
+        // Moving with its subtree: all of it has to fit
+        if (in_subtree(parent, node)) return false;
+        return p->layer + 1 + subtree_depth(node) <= max_layer;
+    }
+    int capacity = s_cfg.route_table < s_slots[0].capacity ? s_cfg.route_table : s_slots[0].capacity;
+    return p->layer < max_layer && s_route_count < capacity;
+}
+
+static intptr_t pack(int node, uint32_t tag)
+{
+    return (intptr_t)(((uint64_t)tag << 16) | (uint64_t)node);
+}
+
+static void unpack(void *arg, int *node, uint32_t *tag)
+{
+    uint64_t value = (uint64_t)(intptr_t)arg;
+    *node = (int)(value & 0xFFFF);
+    *tag = (uint32_t)(value >> 16);
+}
+
+static void assoc_done(void *arg)
+{
+    int node;
+    uint32_t action;
+    unpack(arg, &node, &action);
+    slot_t *slot = &s_slots[node];
+    if (action != slot->action || !slot->started) return;
+
+    int target = slot->assoc_target;
+    slot->assoc_target = -1;
+    if (!can_attach(node, target)) {
+        // Manual association fails; mesh_node.c times out and scans. A node
+        // without a parent keeps retrying the one it was given meanwhile, as
+        // the station does (e.g. a parent still booting after a power cut)
+        if (slot->connected) {
+            detach(node, true, REASON_NO_AP_FOUND);
+        } else if (slot->self_organized) {
+            start_scan(node);
+        } else {
+            associate(node, target);
+        }
+        return;
+    }
+    if (slot->connected) {
+        move(node, target);
+    } else {
+        attach(node, target);
+    }
+}
+
+static void associate(int node, int target)
+{
+    slot_t *slot = &s_slots[node];
+    slot->action++;
+    slot->assoc_target = target;
+    sim_event_at(sim_now_us() + s_cfg.assoc_us, assoc_done, (void *)pack(node, slot->action));
+}
+
+/**
+ * Is candidate a better parent than chosen? Shallowest above the RSSI
+ * threshold, then fewest children; strongest if neither is above it
+ */
+static bool house_prefers(int node, int candidate, int chosen)
+{
+    int a = link_rssi(node, candidate);
+    int b = link_rssi(node, chosen);
+    bool a_good = a >= HOUSE_RSSI_GOOD;
+    bool b_good = b >= HOUSE_RSSI_GOOD;
+    if (a_good != b_good) return a_good;
+    if (!a_good) return a > b;
+    if (s_slots[candidate].layer != s_slots[chosen].layer) {
+        return s_slots[candidate].layer < s_slots[chosen].layer;
+    }
+    if (s_slots[candidate].children != s_slots[chosen].children) {
+        return s_slots[candidate].children < s_slots[chosen].children;
+    }
+    return a > b;
+}
+
+static void scan_done(void *arg)
+{
+    int node;
+    uint32_t action;
+    unpack(arg, &node, &action);
+    slot_t *slot = &s_slots[node];
+    if (action != slot->action || !slot->started || slot->connected) return;
+
+    s_stats.scans++;
+    int chosen = -1;
+    int count = 0;
+    for (int p = 0; p < s_slot_count; p++) {
+        if (!can_attach(node, p)) continue;
+        count++;
+        if (s_cfg.topology == SIM_TOPO_BFS) {
+            if (chosen < 0 || s_slots[p].layer < s_slots[chosen].layer) chosen = p;
+        } else if (s_cfg.topology == SIM_TOPO_HOUSE) {
+            if (chosen < 0 || house_prefers(node, p, chosen)) chosen = p;
+        } else if (sim_rand_u32() % count == 0) {
+            chosen = p;         // Reservoir sampling: uniform over the candidates
+        }
+    }
+
+    if (chosen < 0) {
+        s_stats.scans_empty++;
+        slot->scan_fails++;
+        if (slot->scan_fails % NO_PARENT_REPORT_SCANS == 0) {
+            mesh_event_no_parent_found_t np = { .scan_times = slot->scan_fails };
+            post(node, MESH_EVENT_NO_PARENT_FOUND, &np, sizeof(np));
+        }
+        start_scan(node);
+        return;
+    }
+    associate(node, chosen);
+}
+
+static void start_scan(int node)
+{
+    slot_t *slot = &s_slots[node];
+    slot->action++;
+    int64_t at = sim_now_us() + s_cfg.scan_us;
+    if (s_cfg.scan_us > 0) at += sim_rand_u32() % (s_cfg.scan_us + 1);
+    sim_event_at(at, scan_done, (void *)pack(node, slot->action));
+}
+
+static void loss_detected(void *arg)
+{
+    int node;
+    uint32_t gen;
+    unpack(arg, &node, &gen);
+    slot_t *slot = &s_slots[node];
+    if (!slot->dead || slot->dead_gen != gen) return;
+
+    slot->dead = false;
+    if (slot->connected) detach(node, false, REASON_BEACON_TIMEOUT);
+}
+
+/**
+ * The tree notices now that a node lost power (it restarted its mesh
+ * before the beacon timeout)
+ */
+static void settle_loss(int node)
+{
+    slot_t *slot = &s_slots[node];
+    if (!slot->dead) return;
+    slot->dead = false;
+    if (slot->connected) detach(node, false, REASON_BEACON_TIMEOUT);
+}
+
+void sim_mesh_power_off(int node)
+{
+    if (node <= 0 || node >= s_slot_count) return;
+    slot_t *slot = &s_slots[node];
+
+    reset_mesh_state(slot);
+    slot->epoch++;
+    slot->action++;
+    slot->assoc_target = -1;
+    queue_clear(&slot->rx_head, &slot->rx_tail);
+    slot->rx_depth = 0;
+
+    if (slot->connected) {
+        slot->dead = true;
+        slot->dead_gen++;
+        sim_event_at(sim_now_us() + s_cfg.loss_detect_us, loss_detected,
+                     (void *)pack(node, slot->dead_gen));
+    }
+}
+
+// ============================================================================
+// Radio
+// ============================================================================
+
+/**
+ * Put a frame on the air along path[0] -> path[1] -> ... -> path[hops]
+ * @return Arrival time at the last device, -1 if it was lost
+ */
+static int64_t transmit(const int *path, int hops, size_t len)
+{
+    uint64_t bits = (uint64_t)(len + s_cfg.overhead_bytes) * 8;
+    int64_t air_us = (int64_t)((bits * 1000 + s_cfg.bandwidth_kbps - 1) / s_cfg.bandwidth_kbps);
+    int64_t t = sim_now_us();
+
+    s_stats.frames_sent++;
+    for (int h = 0; h < hops; h++) {
+        slot_t *a = &s_slots[path[h]];
+        slot_t *b = &s_slots[path[h + 1]];
+        if (a->dead || b->dead) {
+            s_stats.frames_lost++;
+            return -1;
+        }
+        int rssi = link_rssi(path[h], path[h + 1]);
+        int64_t start = t;
+        if (a->radio_busy_us > start) start = a->radio_busy_us;
+        if (b->radio_busy_us > start) start = b->radio_busy_us;
+        int64_t end = start + link_air_us(rssi, air_us);
+        a->radio_busy_us = end;
+        b->radio_busy_us = end;
+        s_stats.bytes_on_air += len + s_cfg.overhead_bytes;
+
+        double loss = 1.0 - (1.0 - s_cfg.loss) * (1.0 - link_loss(rssi));
+        if (loss > 0 && sim_rand_unit() < loss) {
+            s_stats.frames_lost++;
+            return -1;
+        }
+        t = end + s_cfg.latency_us;
+        if (s_cfg.jitter_us > 0) t += sim_rand_u32() % (s_cfg.jitter_us + 1);
+    }
+    s_stats.frames_delivered++;
+    return t;
+}
+
+typedef struct {
+    frame_t *frame;
+    uint32_t epoch;
+} delivery_t;
+
+static void schedule(int64_t at_us, sim_event_fn_t fn, frame_t *frame)
+{
+    delivery_t *delivery = malloc(sizeof(delivery_t));
+    if (delivery == NULL) abort();
+    delivery->frame = frame;
+    delivery->epoch = s_slots[frame->dst].epoch;
+    sim_event_at(at_us, fn, delivery);
+}
+
+static void root_arrive(void *arg)
+{
+    delivery_t *delivery = arg;
+    frame_t *frame = delivery->frame;
+    bool current = delivery->epoch == s_slots[0].epoch && s_slots[0].started;
+    free(delivery);
+
+    if (!current) {
+        s_stats.frames_lost++;
+        free(frame);
+        return;
+    }
+
+    frame->arrived_us = sim_now_us();
+    if (s_rx_depth >= (uint32_t)s_slots[0].xon_qsize) {
+        queue_append(&s_held_head, &s_held_tail, frame);
+        return;
+    }
+    queue_append(&s_rx_head, &s_rx_tail, frame);
+    s_rx_depth++;
+    if (s_rx_depth > s_stats.rx_queue_peak) s_stats.rx_queue_peak = s_rx_depth;
+}
+
+static void node_arrive(void *arg)
+{
+    delivery_t *delivery = arg;
+    frame_t *frame = delivery->frame;
+    slot_t *slot = &s_slots[frame->dst];
+    bool current = delivery->epoch == slot->epoch && slot->started && slot->connected;
+    free(delivery);
+
+    if (!current || slot->rx_depth >= (uint32_t)slot->xon_qsize) {
+        s_stats.frames_lost++;
+        free(frame);
+        return;
+    }
+    frame->arrived_us = sim_now_us();
+    queue_append(&slot->rx_head, &slot->rx_tail, frame);
+    slot->rx_depth++;
+}
+
+/**
+ * Path from device 0 down to node, path[0] = 0
+ * @return Hops
+ */
+static int path_from_root(int node, int *path)
+{
+    int hops = 0;
+    for (int n = node; n != 0; n = s_slots[n].parent) hops++;
+    path[0] = 0;
+    int n = node;
+    for (int h = hops; h > 0; h--) {
+        path[h] = n;
+        n = s_slots[n].parent;
+    }
+    return hops;
+}
+
+static esp_err_t root_send(const mesh_addr_t *to, const mesh_data_t *data)
+{
+    int dst = sim_mesh_find(to->addr);
+    if (dst == 0) {
+        // Own address from the routing table: loops back to our receive queue
+        s_stats.rx_echo++;
+        schedule(sim_now_us(), root_arrive, frame_new(0, 0, data->data, data->size));
+        return ESP_OK;
+    }
+    if (dst < 0 || !s_slots[dst].connected) {
+        return ESP_ERR_MESH_NO_ROUTE_FOUND;
+    }
+
+    int path[SIM_MAX_NODES + 1];
+    int hops = path_from_root(dst, path);
+    int64_t at = transmit(path, hops, data->size);
+    if (at >= 0) {
+        schedule(at, node_arrive, frame_new(0, dst, data->data, data->size));
+    }
+    return ESP_OK;
+}
+
+static esp_err_t node_send(int node, const mesh_addr_t *to, const mesh_data_t *data)
+{
+    slot_t *slot = &s_slots[node];
+    if (!slot->connected) return ESP_ERR_MESH_DISCONNECTED;
+    if (to != NULL && sim_mesh_find(to->addr) != 0) return ESP_ERR_MESH_NO_ROUTE_FOUND;
+
+    int path[SIM_MAX_NODES + 1];
+    int hops = 0;
+    path[0] = node;
+    for (int n = node; n != 0; n = s_slots[n].parent) {
+        path[++hops] = s_slots[n].parent;
+    }
+
+    int64_t at = transmit(path, hops, data->size);
+    if (at >= 0) {
+        schedule(at, root_arrive, frame_new(node, 0, data->data, data->size));
+    }
+    return ESP_OK;
+}
+
+static void log_rx_wait(int64_t waited_us)
+{
+    if (s_rx_wait_count == s_rx_wait_cap) {
+        s_rx_wait_cap = s_rx_wait_cap ? s_rx_wait_cap * 2 : 4096;
+        s_rx_waits = realloc(s_rx_waits, s_rx_wait_cap * sizeof(uint32_t));
+        if (s_rx_waits == NULL) abort();
+    }
+    s_rx_waits[s_rx_wait_count++] = (uint32_t)waited_us;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+void sim_mesh_get_stats(sim_mesh_stats_t *stats)
+{
+    *stats = s_stats;
+    stats->joined = 0;
+    stats->max_layer = 1;
+    for (int i = 1; i < s_slot_count; i++) {
+        if (!s_slots[i].connected || s_slots[i].dead) continue;
+        stats->joined++;
+        if (s_slots[i].layer > stats->max_layer) stats->max_layer = s_slots[i].layer;
+    }
+}
+
+const uint32_t *sim_mesh_rx_waits(size_t *count)
+{
+    *count = s_rx_wait_count;
+    return s_rx_waits;
+}
+
+const uint8_t *sim_mesh_node_mac(int index)
+{
+    return s_slots[index].mac;
+}
+
+int sim_mesh_node_layer(int index)
+{
+    if (index == 0) return s_slots[0].started ? 1 : -1;
+    return sim_mesh_node_joined(index) ? s_slots[index].layer : -1;
+}
+
+int sim_mesh_node_parent(int index)
+{
+    return sim_mesh_node_joined(index) ? s_slots[index].parent : -1;
+}
+
+bool sim_mesh_node_joined(int index)
+{
+    return index > 0 && index < s_slot_count && s_slots[index].connected && !s_slots[index].dead;
+}
+
+bool sim_mesh_node_link(int index, uint8_t bssid[6], int8_t *rssi)
+{
+    if (!sim_mesh_node_joined(index)) return false;
+    softap_mac(s_slots[index].parent, bssid);
+    if (s_cfg.topology == SIM_TOPO_HOUSE) {
+        *rssi = (int8_t)link_rssi(index, s_slots[index].parent);
+    } else {
+        // No positions: a fixed per-node value in a usual indoor range
+        *rssi = (int8_t)(-50 - (index * 37) % 25);
+    }
+    return true;
+}
+
+int sim_mesh_find(const uint8_t *mac)
+{
+    // MACs are generated from the index
+    if (mac[0] != 0x24 || mac[1] != 0x0A || mac[2] != 0xC4) return -1;
+    if (mac[3] == 0x00 && mac[4] == 0x00 && mac[5] == 0x00) return 0;
+    if (mac[3] != 0x10 || (mac[5] & 1)) return -1;
+    int index = (mac[4] << 7) | (mac[5] >> 1);
+    return (index > 0 && index < s_slot_count) ? index : -1;
+}
+
+// ============================================================================
+// esp_mesh_* API
+// ============================================================================
+
+static void root_started(void *arg)
+{
+    if ((uint32_t)(uintptr_t)arg != s_slots[0].epoch) return;
+    sim_event_post(SIM_GATEWAY, MESH_EVENT, MESH_EVENT_STARTED, NULL, 0);
+}
+
+static void root_router_connected(void *arg)
+{
+    if ((uint32_t)(uintptr_t)arg != s_slots[0].epoch || !s_slots[0].started) return;
+
+    mesh_event_connected_t connected = { .self_layer = 1 };
+    memcpy(connected.connected.bssid, "\x02\x00\x00\x00\x00\x01", 6);
+    sim_event_post(SIM_GATEWAY, MESH_EVENT, MESH_EVENT_PARENT_CONNECTED, &connected, sizeof(connected));
+
+    ip_event_got_ip_t got_ip = {0};
+    esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"), &got_ip.ip_info);
+    sim_event_post(SIM_GATEWAY, IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip));
+}
+
+esp_err_t esp_mesh_init(void)
+{
+    self()->initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_deinit(void)
+{
+    self()->initialized = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_config(const mesh_cfg_t *config)
+{
+    self()->cfg = *config;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_start(void)
+{
+    int node = sim_rtos_node();
+    slot_t *slot = &s_slots[node];
+    if (!slot->initialized) return ESP_ERR_MESH_NOT_START;
+    if (slot->started) return ESP_OK;
+
+    slot->started = true;
+    slot->epoch++;
+
+    if (node == SIM_GATEWAY) {
+        slot->connected = true;
+        slot->layer = 1;
+        slot->children = 0;
+        s_route_count = 0;
+        route_add(0);
+        sim_event_at(sim_now_us(), root_started, (void *)(uintptr_t)slot->epoch);
+        sim_event_at(sim_now_us() + 200000, root_router_connected, (void *)(uintptr_t)slot->epoch);
+        return ESP_OK;
+    }
+
+    settle_loss(node);
+    slot->scan_fails = 0;
+    post(node, MESH_EVENT_STARTED, NULL, 0);
+    if (slot->self_organized) start_scan(node);
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_stop(void)
+{
+    int node = sim_rtos_node();
+    slot_t *slot = &s_slots[node];
+    if (!slot->started) return ESP_OK;
+
+    if (node == SIM_GATEWAY) {
+        // Every child leaves, and the whole mesh with them
+        for (int i = 1; i < s_slot_count; i++) {
+            if (s_slots[i].connected && s_slots[i].parent == 0) {
+                detach(i, true, REASON_LEAVE);
+            }
+        }
+        slot->connected = false;
+        slot->layer = -1;
+        s_route_count = 0;
+        queue_clear(&s_rx_head, &s_rx_tail);
+        queue_clear(&s_held_head, &s_held_tail);
+        s_rx_depth = 0;
+    } else if (slot->connected) {
+        detach(node, false, REASON_LEAVE);
+    }
+
+    slot->started = false;
+    slot->epoch++;
+    slot->action++;
+    slot->assoc_target = -1;
+    queue_clear(&slot->rx_head, &slot->rx_tail);
+    slot->rx_depth = 0;
+    post(node, MESH_EVENT_STOPPED, NULL, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_send(const mesh_addr_t *to, const mesh_data_t *data, int flag,
+                        const mesh_opt_t opt[], int opt_count)
+{
+    (void)flag;
+    (void)opt;
+    (void)opt_count;
+
+    int node = sim_rtos_node();
+    if (!s_slots[node].started) return ESP_ERR_MESH_NOT_START;
+    if (data == NULL || data->data == NULL || data->size == 0) return ESP_ERR_MESH_ARGUMENT;
+
+    if (node == SIM_GATEWAY) {
+        if (to == NULL) return ESP_ERR_MESH_ARGUMENT;
+        return root_send(to, data);
+    }
+    return node_send(node, to, data);
+}
+
+static esp_err_t root_recv(mesh_addr_t *from, mesh_data_t *data, int *flag)
+{
+    frame_t *frame = queue_pop(&s_rx_head, &s_rx_tail);
+    s_rx_depth--;
+
+    // Room again: let one held-back sender through
+    frame_t *held = queue_pop(&s_held_head, &s_held_tail);
+    if (held) {
+        queue_append(&s_rx_head, &s_rx_tail, held);
+        s_rx_depth++;
+    }
+
+    log_rx_wait(sim_now_us() - frame->arrived_us);
+    s_stats.rx_frames++;
+    if (s_rx_tap) s_rx_tap(s_slots[frame->src].mac, frame->data, frame->len);
+
+    memcpy(from->addr, s_slots[frame->src].mac, 6);
+    size_t len = frame->len < data->size ? frame->len : data->size;
+    memcpy(data->data, frame->data, len);
+    data->size = (uint16_t)len;
+    if (flag) *flag = (frame->src == 0) ? MESH_DATA_P2P : MESH_DATA_TODS;
+    free(frame);
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_recv(mesh_addr_t *from, mesh_data_t *data, int timeout_ms, int *flag,
+                        mesh_opt_t opt[], int opt_count)
+{
+    (void)opt;
+    (void)opt_count;
+
+    int node = sim_rtos_node();
+    slot_t *slot = &s_slots[node];
+    if (!slot->started) return ESP_ERR_MESH_NOT_START;
+
+    frame_t **head = (node == SIM_GATEWAY) ? &s_rx_head : &slot->rx_head;
+    int64_t deadline = sim_now_us() + (int64_t)timeout_ms * 1000;
+    while (*head == NULL) {
+        if (timeout_ms == 0 || sim_now_us() >= deadline) {
+            return ESP_ERR_MESH_TIMEOUT;
+        }
+        vTaskDelay(1);
+        if (!slot->started) return ESP_ERR_MESH_NOT_START;
+    }
+
+    if (node == SIM_GATEWAY) return root_recv(from, data, flag);
+
+    frame_t *frame = queue_pop(&slot->rx_head, &slot->rx_tail);
+    slot->rx_depth--;
+    memcpy(from->addr, s_slots[frame->src].mac, 6);
+    size_t len = frame->len < data->size ? frame->len : data->size;
+    memcpy(data->data, frame->data, len);
+    data->size = (uint16_t)len;
+    if (flag) *flag = MESH_DATA_P2P | MESH_DATA_FROMDS;
+    free(frame);
+
+    sim_rtos_consume_us(s_cfg.node_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_routing_table(mesh_addr_t *mac, int len, int *size)
+{
+    int node = sim_rtos_node();
+    int fit = len / 6;
+    int count = 0;
+
+    if (node == SIM_GATEWAY) {
+        count = s_route_count < fit ? s_route_count : fit;
+        // Assumption: a short buffer gets the first entries (IDF does not document this case)
+        if (count < s_route_count) s_stats.routing_truncated++;
+        for (int i = 0; i < count; i++) {
+            memcpy(mac[i].addr, s_slots[s_route[i]].mac, 6);
+        }
+    } else if (s_slots[node].connected) {
+        // A node's table is its own subtree, itself included
+        for (int i = 1; i < s_slot_count && count < fit; i++) {
+            if (s_slots[i].connected && in_subtree(i, node)) {
+                memcpy(mac[count++].addr, s_slots[i].mac, 6);
+            }
+        }
+    }
+    *size = count;
+    return ESP_OK;
+}
+
+int esp_mesh_get_routing_table_size(void)
+{
+    int node = sim_rtos_node();
+    if (node == SIM_GATEWAY) return s_route_count;
+    return s_slots[node].connected ? subtree_size(node) : 0;
+}
+
+esp_err_t esp_mesh_get_rx_pending(mesh_rx_pending_t *pending)
+{
+    int node = sim_rtos_node();
+    pending->toDS = 0;
+    pending->toSelf = (int)(node == SIM_GATEWAY ? s_rx_depth : s_slots[node].rx_depth);
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_tx_pending(mesh_tx_pending_t *pending)
+{
+    memset(pending, 0, sizeof(*pending));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_get_id(mesh_addr_t *id)
+{
+    *id = self()->cfg.mesh_id;
+    return ESP_OK;
+}
+
+int esp_mesh_get_layer(void)
+{
+    return sim_mesh_node_layer(sim_rtos_node());
+}
+
+bool esp_mesh_is_root(void)
+{
+    return sim_rtos_node() == SIM_GATEWAY && s_slots[0].started;
+}
+
+esp_err_t esp_mesh_set_max_layer(int max_layer)
+{
+    if (max_layer < 1) return ESP_ERR_MESH_ARGUMENT;
+    self()->max_layer = max_layer;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_capacity_num(int num)
+{
+    if (num < 1) return ESP_ERR_MESH_ARGUMENT;
+    self()->capacity = num;
+    return ESP_OK;
+}
+
+int esp_mesh_get_capacity_num(void)
+{
+    return self()->capacity;
+}
+
+esp_err_t esp_mesh_set_xon_qsize(int qsize)
+{
+    self()->xon_qsize = qsize;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_self_organized(bool enable, bool select_parent)
+{
+    (void)select_parent;
+    int node = sim_rtos_node();
+    slot_t *slot = &s_slots[node];
+    slot->self_organized = enable;
+
+    // Either way a pending scan or manual association is off
+    slot->action++;
+    slot->assoc_target = -1;
+    if (enable && node != SIM_GATEWAY && slot->started && !slot->connected) {
+        start_scan(node);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_parent(const wifi_config_t *parent, const mesh_addr_t *parent_mesh_id,
+                              mesh_type_t my_type, int my_layer)
+{
+    (void)my_type;
+    (void)my_layer;
+    int node = sim_rtos_node();
+    if (node == SIM_GATEWAY || parent == NULL || !parent->sta.bssid_set) return ESP_ERR_MESH_ARGUMENT;
+    if (parent_mesh_id != NULL && memcmp(parent_mesh_id->addr, s_slots[node].cfg.mesh_id.addr, 6) != 0) {
+        return ESP_ERR_MESH_ARGUMENT;
+    }
+
+    uint8_t sta[6];
+    memcpy(sta, parent->sta.bssid, 6);
+    sta[5] -= 1;
+    associate(node, sim_mesh_find(sta));
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_topology(esp_mesh_topology_t topo)
+{
+    (void)topo;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_vote_percentage(float percentage)
+{
+    (void)percentage;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_disable_ps(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_ap_assoc_expire(int seconds)
+{
+    (void)seconds;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_ap_authmode(wifi_auth_mode_t authmode)
+{
+    (void)authmode;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_set_type(mesh_type_t type)
+{
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_fix_root(bool enable)
+{
+    (void)enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_mesh_post_toDS_state(bool reachable)
+{
+    (void)reachable;
+    return ESP_OK;
+}
@@ -0,0 +1,362 @@
+/**
+ * OmniaPi Mesh Simulator - MQTT Client and Broker
+ *
+ * The esp-mqtt client API (mqtt_client.h) for the gateway's real
+ * mqtt_handler.c, against an in-process broker the harness plays the
+ * backend on. Messages take the configured one-way latency in each
+ * direction; the client connects connect_us after start and after every
+ * reconnect. As with esp-mqtt, events reach the registered handler from
+ * the client's own task (so a handler may block), sessions are clean
+ * (subscriptions go with the connection), QoS 0 publishes while
+ * disconnected fail and QoS 1/2 ones wait in the outbox.
+ */
+
+#include "sim.h"
+#include "mqtt_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FILTERS     32
+
+typedef struct mqtt_msg {
+    struct mqtt_msg *next;
+    esp_mqtt_event_id_t id;
+    int qos;
+    int msg_id;
+    int topic_len;
+    int data_len;
+    char *topic;
+    char *data;
+    char buf[];                 // topic\0 data\0
+} mqtt_msg_t;
+
+struct esp_mqtt_client {
+    esp_event_handler_t handler;
+    void *handler_arg;
+    int reconnect_ms;
+
+    bool started;
+    bool connected;
+    uint32_t epoch;             // Bumped on start/stop/disconnect: pending connects are dropped
+    int next_msg_id;
+    char filters[MAX_FILTERS][128];
+    int filter_count;
+
+    SemaphoreHandle_t pending;
+    mqtt_msg_t *head;           // Events for the handler
+    mqtt_msg_t *tail;
+    mqtt_msg_t *outbox_head;    // QoS > 0 publishes waiting for the connection
+    mqtt_msg_t *outbox_tail;
+};
+
+typedef struct {
+    char filter[128];
+    sim_mqtt_cb_t cb;
+} backend_sub_t;
+
+static uint32_t s_latency_us = 0;
+static uint32_t s_connect_us = 0;
+static esp_mqtt_client_handle_t s_client = NULL;
+static backend_sub_t s_backend[MAX_FILTERS];
+static int s_backend_count = 0;
+static uint32_t s_gateway_publishes = 0;
+
+void sim_mqtt_configure(uint32_t latency_us, uint32_t connect_us)
+{
+    s_latency_us = latency_us;
+    s_connect_us = connect_us;
+}
+
+bool sim_mqtt_connected(void)
+{
+    return s_client != NULL && s_client->connected;
+}
+
+uint32_t sim_mqtt_gateway_publishes(void)
+{
+    return s_gateway_publishes;
+}
+
+// ============================================================================
+// Messages
+// ============================================================================
+
+static mqtt_msg_t *msg_new(esp_mqtt_event_id_t id, const char *topic, const char *data, int data_len)
+{
+    int topic_len = topic ? (int)strlen(topic) : 0;
+    if (data != NULL && data_len <= 0) data_len = (int)strlen(data);
+    if (data == NULL) data_len = 0;
+
+    mqtt_msg_t *msg = calloc(1, sizeof(mqtt_msg_t) + topic_len + data_len + 2);
+    if (msg == NULL) abort();
+    msg->id = id;
+    msg->topic_len = topic_len;
+    msg->data_len = data_len;
+    msg->topic = msg->buf;
+    msg->data = msg->buf + topic_len + 1;
+    if (topic_len > 0) memcpy(msg->topic, topic, topic_len);
+    if (data_len > 0) memcpy(msg->data, data, data_len);
+    return msg;
+}
+
+static void msg_append(mqtt_msg_t **head, mqtt_msg_t **tail, mqtt_msg_t *msg)
+{
+    msg->next = NULL;
+    if (*tail) {
+        (*tail)->next = msg;
+    } else {
+        *head = msg;
+    }
+    *tail = msg;
+}
+
+static mqtt_msg_t *msg_pop(mqtt_msg_t **head, mqtt_msg_t **tail)
+{
+    mqtt_msg_t *msg = *head;
+    if (msg) {
+        *head = msg->next;
+        if (*head == NULL) *tail = NULL;
+    }
+    return msg;
+}
+
+/**
+ * MQTT topic filter match (+ one level, # the rest)
+ */
+static bool topic_matches(const char *filter, const char *topic)
+{
+    while (*filter != '\0') {
+        if (*filter == '#') return true;
+        if (*filter == '+') {
+            while (*topic != '\0' && *topic != '/') topic++;
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) return false;
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
+
+static void client_post(esp_mqtt_client_handle_t client, mqtt_msg_t *msg)
+{
+    msg_append(&client->head, &client->tail, msg);
+    xSemaphoreGive(client->pending);
+}
+
+static void client_task(void *arg)
+{
+    esp_mqtt_client_handle_t client = arg;
+    while (1) {
+        xSemaphoreTake(client->pending, portMAX_DELAY);
+        mqtt_msg_t *msg = msg_pop(&client->head, &client->tail);
+        if (msg == NULL) continue;
+
+        esp_mqtt_event_t event = {
+            .event_id = msg->id,
+            .client = client,
+            .data = msg->data,
+            .data_len = msg->data_len,
+            .total_data_len = msg->data_len,
+            .topic = msg->topic,
+            .topic_len = msg->topic_len,
+            .msg_id = msg->msg_id,
+            .qos = msg->qos,
+        };
+        if (client->handler != NULL) {
+            client->handler(client->handler_arg, "MQTT_EVENTS", msg->id, &event);
+        }
+        free(msg);
+    }
+}
+
+// ============================================================================
+// Broker
+// ============================================================================
+
+/**
+ * A gateway publish reaches the backend
+ */
+static void to_backend(void *arg)
+{
+    mqtt_msg_t *msg = arg;
+    for (int i = 0; i < s_backend_count; i++) {
+        if (topic_matches(s_backend[i].filter, msg->topic)) {
+            s_backend[i].cb(msg->topic, msg->data, msg->data_len);
+        }
+    }
+    free(msg);
+}
+
+/**
+ * A backend publish reaches the gateway, if it is connected and subscribed
+ */
+static void to_gateway(void *arg)
+{
+    mqtt_msg_t *msg = arg;
+    esp_mqtt_client_handle_t client = s_client;
+    if (client == NULL || !client->connected) {
+        free(msg);
+        return;
+    }
+    for (int i = 0; i < client->filter_count; i++) {
+        if (topic_matches(client->filters[i], msg->topic)) {
+            client_post(client, msg);
+            return;
+        }
+    }
+    free(msg);
+}
+
+static void send_to_backend(mqtt_msg_t *msg)
+{
+    s_gateway_publishes++;
+    sim_event_at(sim_now_us() + s_latency_us, to_backend, msg);
+}
+
+void sim_mqtt_subscribe(const char *filter, sim_mqtt_cb_t cb)
+{
+    if (s_backend_count == MAX_FILTERS) abort();
+    snprintf(s_backend[s_backend_count].filter, sizeof(s_backend[0].filter), "%s", filter);
+    s_backend[s_backend_count].cb = cb;
+    s_backend_count++;
+}
+
+void sim_mqtt_publish(const char *topic, const char *data)
+{
+    mqtt_msg_t *msg = msg_new(MQTT_EVENT_DATA, topic, data, 0);
+    sim_event_at(sim_now_us() + s_latency_us, to_gateway, msg);
+}
+
+// ============================================================================
+// Connection
+// ============================================================================
+
+static void connected(void *arg)
+{
+    esp_mqtt_client_handle_t client = s_client;
+    if (client == NULL || (uint32_t)(uintptr_t)arg != client->epoch || !client->started) return;
+
+    client->connected = true;
+    client->filter_count = 0;
+    client_post(client, msg_new(MQTT_EVENT_CONNECTED, NULL, NULL, 0));
+
+    mqtt_msg_t *msg;
+    while ((msg = msg_pop(&client->outbox_head, &client->outbox_tail)) != NULL) {
+        send_to_backend(msg);
+    }
+}
+
+static void connect_in(esp_mqtt_client_handle_t client, int64_t delay_us)
+{
+    client->epoch++;
+    sim_event_at(sim_now_us() + delay_us, connected, (void *)(uintptr_t)client->epoch);
+}
+
+static void drop_connection(esp_mqtt_client_handle_t client)
+{
+    client->epoch++;
+    if (client->connected) {
+        client->connected = false;
+        client_post(client, msg_new(MQTT_EVENT_DISCONNECTED, NULL, NULL, 0));
+    }
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    if (s_client != NULL) return NULL;     // One client per gateway here
+
+    esp_mqtt_client_handle_t client = calloc(1, sizeof(struct esp_mqtt_client));
+    if (client == NULL) return NULL;
+    client->reconnect_ms = config->network.reconnect_timeout_ms ? config->network.reconnect_timeout_ms
+                                                                : 10000;
+    client->pending = xSemaphoreCreateCounting(0x7FFFFFFF, 0);
+    if (client->pending == NULL ||
+        xTaskCreate(client_task, "mqtt_task", 6144, client, 5, NULL) != pdPASS) {
+        free(client);
+        return NULL;
+    }
+    s_client = client;
+    return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    (void)event;
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    client->handler = event_handler;
+    client->handler_arg = event_handler_arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    if (client->started) return ESP_FAIL;
+    client->started = true;
+    connect_in(client, s_connect_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    if (!client->started) return ESP_FAIL;
+    client->started = false;
+    drop_connection(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    if (!client->started) return ESP_FAIL;
+
+    // The client task reconnects after reconnect_timeout_ms
+    drop_connection(client);
+    connect_in(client, (int64_t)client->reconnect_ms * 1000 + s_connect_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+    if (!client->started || client->connected) return ESP_FAIL;
+    connect_in(client, s_connect_us);
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    (void)qos;
+    if (client == NULL || !client->connected) return -1;
+    if (client->filter_count < MAX_FILTERS) {
+        snprintf(client->filters[client->filter_count++], sizeof(client->filters[0]), "%s", topic);
+    }
+    return ++client->next_msg_id;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    (void)retain;
+    if (client == NULL) return -1;
+    if (!client->connected && qos == 0) return -1;
+
+    mqtt_msg_t *msg = msg_new(MQTT_EVENT_DATA, topic, data, len);
+    msg->qos = qos;
+    msg->msg_id = qos > 0 ? ++client->next_msg_id : 0;
+    int msg_id = msg->msg_id;
+    if (client->connected) {
+        send_to_backend(msg);
+    } else {
+        msg_append(&client->outbox_head, &client->outbox_tail, msg);
+    }
+    return msg_id;
+}
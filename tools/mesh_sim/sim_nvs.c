@@ -0,0 +1,313 @@
+/**
+ * OmniaPi Mesh Simulator - NVS
+ *
+ * Per-device key/value store behind the nvs.h API. Entries live as long as
+ * the process, so they survive a node's reboot the way its NVS partition
+ * does; handles do not. Writes take effect at once (nvs_commit() is a
+ * no-op) and are counted, since flash wear is what the firmware's write
+ * batching is about.
+ */
+
+#include "sim.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HANDLES     64
+#define NAME_MAX_LEN    15      // NVS_KEY_NAME_MAX_SIZE - 1
+
+typedef enum {
+    TYPE_U8, TYPE_I8, TYPE_U16, TYPE_I16, TYPE_U32, TYPE_I32, TYPE_U64, TYPE_I64,
+    TYPE_STR, TYPE_BLOB,
+} entry_type_t;
+
+typedef struct entry {
+    struct entry *next;
+    char ns[NAME_MAX_LEN + 1];
+    char key[NAME_MAX_LEN + 1];
+    entry_type_t type;
+    size_t len;
+    uint8_t data[];
+} entry_t;
+
+typedef struct {
+    entry_t *entries;
+    uint32_t writes;
+} store_t;
+
+typedef struct {
+    bool open;
+    int node;
+    bool readonly;
+    char ns[NAME_MAX_LEN + 1];
+} handle_t;
+
+static store_t *s_stores = NULL;
+static int s_store_count = 0;
+static handle_t s_handles[MAX_HANDLES];
+
+void sim_nvs_init(int devices)
+{
+    s_stores = calloc(devices, sizeof(store_t));
+    if (s_stores == NULL) abort();
+    s_store_count = devices;
+}
+
+uint32_t sim_nvs_writes(int node)
+{
+    return s_stores[node].writes;
+}
+
+void sim_nvs_power_off(int node)
+{
+    for (int i = 0; i < MAX_HANDLES; i++) {
+        if (s_handles[i].open && s_handles[i].node == node) s_handles[i].open = false;
+    }
+}
+
+// ============================================================================
+// Entries
+// ============================================================================
+
+static entry_t *find(int node, const char *ns, const char *key)
+{
+    for (entry_t *e = s_stores[node].entries; e != NULL; e = e->next) {
+        if (strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static bool namespace_exists(int node, const char *ns)
+{
+    for (entry_t *e = s_stores[node].entries; e != NULL; e = e->next) {
+        if (strcmp(e->ns, ns) == 0) return true;
+    }
+    return false;
+}
+
+static void remove_entry(int node, entry_t *target)
+{
+    for (entry_t **link = &s_stores[node].entries; *link != NULL; link = &(*link)->next) {
+        if (*link == target) {
+            *link = target->next;
+            free(target);
+            return;
+        }
+    }
+}
+
+static void store(int node, const char *ns, const char *key, entry_type_t type,
+                  const void *data, size_t len)
+{
+    entry_t *old = find(node, ns, key);
+    if (old != NULL) remove_entry(node, old);
+
+    entry_t *e = malloc(sizeof(entry_t) + len);
+    if (e == NULL) abort();
+    strncpy(e->ns, ns, NAME_MAX_LEN);
+    e->ns[NAME_MAX_LEN] = '\0';
+    strncpy(e->key, key, NAME_MAX_LEN);
+    e->key[NAME_MAX_LEN] = '\0';
+    e->type = type;
+    e->len = len;
+    memcpy(e->data, data, len);
+    e->next = s_stores[node].entries;
+    s_stores[node].entries = e;
+}
+
+void sim_nvs_seed_blob(int node, const char *ns, const char *key, const void *data, size_t len)
+{
+    store(node, ns, key, TYPE_BLOB, data, len);
+}
+
+void sim_nvs_seed_str(int node, const char *ns, const char *key, const char *value)
+{
+    store(node, ns, key, TYPE_STR, value, strlen(value) + 1);
+}
+
+// ============================================================================
+// Handles
+// ============================================================================
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    int node = sim_rtos_node();
+    while (s_stores[node].entries != NULL) {
+        remove_entry(node, s_stores[node].entries);
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (name == NULL || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (strlen(name) > NAME_MAX_LEN) return ESP_ERR_NVS_INVALID_NAME;
+
+    int node = sim_rtos_node();
+    if (open_mode == NVS_READONLY && !namespace_exists(node, name)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    for (int i = 0; i < MAX_HANDLES; i++) {
+        handle_t *h = &s_handles[i];
+        if (!h->open) {
+            h->open = true;
+            h->node = node;
+            h->readonly = (open_mode == NVS_READONLY);
+            strcpy(h->ns, name);
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static handle_t *lookup(nvs_handle_t handle)
+{
+    if (handle < 1 || handle > MAX_HANDLES) return NULL;
+    handle_t *h = &s_handles[handle - 1];
+    // A handle belongs to the device that opened it
+    return (h->open && h->node == sim_rtos_node()) ? h : NULL;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    handle_t *h = lookup(handle);
+    if (h != NULL) h->open = false;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return lookup(handle) != NULL ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    handle_t *h = lookup(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+
+    entry_t *e = find(h->node, h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    remove_entry(h->node, e);
+    s_stores[h->node].writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    handle_t *h = lookup(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+
+    entry_t *e = s_stores[h->node].entries;
+    while (e != NULL) {
+        entry_t *next = e->next;
+        if (strcmp(e->ns, h->ns) == 0) remove_entry(h->node, e);
+        e = next;
+    }
+    s_stores[h->node].writes++;
+    return ESP_OK;
+}
+
+// ============================================================================
+// Typed Access
+// ============================================================================
+
+static esp_err_t set_value(nvs_handle_t handle, const char *key, entry_type_t type,
+                           const void *data, size_t len)
+{
+    handle_t *h = lookup(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (h->readonly) return ESP_ERR_NVS_READ_ONLY;
+    if (key == NULL || strlen(key) > NAME_MAX_LEN) return ESP_ERR_NVS_KEY_TOO_LONG;
+
+    store(h->node, h->ns, key, type, data, len);
+    s_stores[h->node].writes++;
+    return ESP_OK;
+}
+
+static esp_err_t get_value(nvs_handle_t handle, const char *key, entry_type_t type,
+                           void *out, size_t len)
+{
+    handle_t *h = lookup(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    entry_t *e = find(h->node, h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (e->type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+    memcpy(out, e->data, len);
+    return ESP_OK;
+}
+
+#define NVS_INT_ACCESSORS(suffix, ctype, tag)                                           \
+    esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char *key, ctype value)       \
+    {                                                                                   \
+        return set_value(handle, key, tag, &value, sizeof(value));                      \
+    }                                                                                   \
+    esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char *key, ctype *out_value)  \
+    {                                                                                   \
+        return get_value(handle, key, tag, out_value, sizeof(*out_value));              \
+    }
+
+NVS_INT_ACCESSORS(u8, uint8_t, TYPE_U8)
+NVS_INT_ACCESSORS(i8, int8_t, TYPE_I8)
+NVS_INT_ACCESSORS(u16, uint16_t, TYPE_U16)
+NVS_INT_ACCESSORS(i16, int16_t, TYPE_I16)
+NVS_INT_ACCESSORS(u32, uint32_t, TYPE_U32)
+NVS_INT_ACCESSORS(i32, int32_t, TYPE_I32)
+NVS_INT_ACCESSORS(u64, uint64_t, TYPE_U64)
+NVS_INT_ACCESSORS(i64, int64_t, TYPE_I64)
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_value(handle, key, TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_value(handle, key, TYPE_BLOB, value, length);
+}
+
+/**
+ * Strings and blobs: a NULL out_value asks for the size only
+ */
+static esp_err_t get_sized(nvs_handle_t handle, const char *key, entry_type_t type,
+                           void *out_value, size_t *length)
+{
+    handle_t *h = lookup(handle);
+    if (h == NULL) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (length == NULL) return ESP_ERR_INVALID_ARG;
+
+    entry_t *e = find(h->node, h->ns, key);
+    if (e == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (e->type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+
+    if (out_value == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        *length = e->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, e->data, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_sized(handle, key, TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_sized(handle, key, TYPE_BLOB, out_value, length);
+}
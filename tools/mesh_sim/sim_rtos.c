@@ -0,0 +1,798 @@
+/**
+ * OmniaPi Mesh Simulator - Deterministic FreeRTOS Scheduler
+ *
+ * Every FreeRTOS task is a coroutine (ucontext) with its own stack, and
+ * only one runs at a time: the running task keeps the CPU until it blocks
+ * (vTaskDelay, a semaphore wait, vTaskDelete). Code takes no virtual time
+ * unless it says so (sim_rtos_consume_us). When a task blocks, the clock
+ * jumps to the next event or task wake-up, whichever is first; events win
+ * ties, and tasks due at the same time run in creation order. The same
+ * inputs and seed therefore always give the same run.
+ *
+ * Priorities are ignored: nothing is preempted, which is what the gateway
+ * and node tasks already assume between their blocking calls.
+ *
+ * Each task belongs to a device: 0 is the gateway, 1..N are the nodes.
+ * Tasks inherit the device of their creator, timers and events run under
+ * the device that set them up, and the shims use sim_rtos_node() to pick
+ * that device's radio, NVS, flash and event handlers. Killing a device
+ * (power loss, esp_restart) drops its tasks and timers where they stand,
+ * which coroutines allow without unwinding anything.
+ */
+
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAKE_NEVER      INT64_MAX
+#define STACK_SIZE      (256 * 1024)    // Reserved, pages are only committed when touched
+
+// ============================================================================
+// State
+// ============================================================================
+
+struct sim_task {
+    ucontext_t ctx;
+    void *stack;                    // mmap'd, NULL for the main task
+    TaskFunction_t fn;
+    void *param;
+    char name[16];
+    int id;
+    int node;
+    int64_t wake_us;                // WAKE_NEVER while blocked without timeout
+    bool done;
+    size_t heap_pos;                // Position in the ready heap + 1, 0 = not in it
+    struct QueueDefinition *waiting;
+    struct sim_task *wait_next;     // Next waiter on the same semaphore (by id)
+    struct sim_task *next;          // Live tasks
+};
+
+struct QueueDefinition {
+    UBaseType_t count;
+    UBaseType_t max;
+    struct sim_task *waiters;
+};
+
+typedef struct {
+    int64_t at_us;
+    uint64_t order;
+    sim_event_fn_t fn;
+    void *arg;
+    int node;
+} sim_event_t;
+
+static struct sim_task *s_tasks = NULL;
+static struct sim_task *s_current = NULL;
+static struct sim_task *s_reap = NULL;  // Done task whose stack is still in use
+static int s_next_id = 0;
+static int64_t s_now_us = 0;
+static int s_node = 0;                  // Device the running code belongs to
+static bool s_in_event = false;
+
+// Boot time per device, for esp_timer_get_time() and the tick count
+static int64_t *s_boot_us = NULL;
+static int s_boot_count = 0;
+
+// Binary min-heaps: events on (at_us, order), tasks on (wake_us, id)
+static sim_event_t *s_events = NULL;
+static size_t s_event_count = 0;
+static size_t s_event_cap = 0;
+static uint64_t s_event_order = 0;
+
+static struct sim_task **s_ready = NULL;
+static size_t s_ready_count = 0;
+static size_t s_ready_cap = 0;
+
+// ============================================================================
+// Event Queue
+// ============================================================================
+
+static bool event_before(const sim_event_t *a, const sim_event_t *b)
+{
+    return a->at_us < b->at_us || (a->at_us == b->at_us && a->order < b->order);
+}
+
+void sim_event_at(int64_t at_us, sim_event_fn_t fn, void *arg)
+{
+    if (at_us < s_now_us) at_us = s_now_us;
+
+    if (s_event_count == s_event_cap) {
+        s_event_cap = s_event_cap ? s_event_cap * 2 : 256;
+        s_events = realloc(s_events, s_event_cap * sizeof(sim_event_t));
+        if (s_events == NULL) abort();
+    }
+
+    size_t i = s_event_count++;
+    s_events[i] = (sim_event_t){
+        .at_us = at_us, .order = s_event_order++, .fn = fn, .arg = arg, .node = s_node,
+    };
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!event_before(&s_events[i], &s_events[parent])) break;
+        sim_event_t tmp = s_events[i];
+        s_events[i] = s_events[parent];
+        s_events[parent] = tmp;
+        i = parent;
+    }
+}
+
+static sim_event_t event_pop(void)
+{
+    sim_event_t top = s_events[0];
+    s_events[0] = s_events[--s_event_count];
+
+    size_t i = 0;
+    while (1) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t min = i;
+        if (left < s_event_count && event_before(&s_events[left], &s_events[min])) min = left;
+        if (right < s_event_count && event_before(&s_events[right], &s_events[min])) min = right;
+        if (min == i) break;
+        sim_event_t tmp = s_events[i];
+        s_events[i] = s_events[min];
+        s_events[min] = tmp;
+        i = min;
+    }
+    return top;
+}
+
+// ============================================================================
+// Ready Heap
+// ============================================================================
+
+static bool task_before(const struct sim_task *a, const struct sim_task *b)
+{
+    return a->wake_us < b->wake_us || (a->wake_us == b->wake_us && a->id < b->id);
+}
+
+static void ready_set(size_t i, struct sim_task *t)
+{
+    s_ready[i] = t;
+    t->heap_pos = i + 1;
+}
+
+static void ready_sift_up(size_t i)
+{
+    struct sim_task *t = s_ready[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!task_before(t, s_ready[parent])) break;
+        ready_set(i, s_ready[parent]);
+        i = parent;
+    }
+    ready_set(i, t);
+}
+
+static void ready_sift_down(size_t i)
+{
+    struct sim_task *t = s_ready[i];
+    while (1) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t min = i;
+        const struct sim_task *best = t;
+        if (left < s_ready_count && task_before(s_ready[left], best)) { min = left; best = s_ready[left]; }
+        if (right < s_ready_count && task_before(s_ready[right], best)) { min = right; }
+        if (min == i) break;
+        ready_set(i, s_ready[min]);
+        i = min;
+    }
+    ready_set(i, t);
+}
+
+static void ready_remove(struct sim_task *t)
+{
+    if (t->heap_pos == 0) return;
+    size_t i = t->heap_pos - 1;
+    t->heap_pos = 0;
+    struct sim_task *last = s_ready[--s_ready_count];
+    if (i == s_ready_count) return;
+    ready_set(i, last);
+    ready_sift_up(i);
+    ready_sift_down(last->heap_pos - 1);
+}
+
+/**
+ * Put t in the heap at its wake_us, or move it there if already in
+ */
+static void ready_update(struct sim_task *t)
+{
+    if (t->done || t->wake_us == WAKE_NEVER) {
+        ready_remove(t);
+        return;
+    }
+    if (t->heap_pos != 0) {
+        ready_sift_up(t->heap_pos - 1);
+        ready_sift_down(t->heap_pos - 1);
+        return;
+    }
+    if (s_ready_count == s_ready_cap) {
+        s_ready_cap = s_ready_cap ? s_ready_cap * 2 : 64;
+        s_ready = realloc(s_ready, s_ready_cap * sizeof(struct sim_task *));
+        if (s_ready == NULL) abort();
+    }
+    ready_set(s_ready_count++, t);
+    ready_sift_up(t->heap_pos - 1);
+}
+
+// ============================================================================
+// Scheduling
+// ============================================================================
+
+static void stack_free(struct sim_task *t)
+{
+    if (t->stack != NULL) {
+        munmap(t->stack, STACK_SIZE);
+        t->stack = NULL;
+    }
+}
+
+/**
+ * Free the stack of a task that ended itself, once we are off it
+ */
+static void reap(void)
+{
+    if (s_reap != NULL && s_reap != s_current) {
+        stack_free(s_reap);
+        s_reap = NULL;
+    }
+}
+
+static void unlink_task(struct sim_task *t)
+{
+    struct sim_task **link = &s_tasks;
+    while (*link != NULL && *link != t) link = &(*link)->next;
+    if (*link == t) *link = t->next;
+}
+
+static void wait_remove(struct sim_task *t)
+{
+    if (t->waiting == NULL) return;
+    struct sim_task **link = &t->waiting->waiters;
+    while (*link != NULL && *link != t) link = &(*link)->wait_next;
+    if (*link == t) *link = t->wait_next;
+    t->waiting = NULL;
+    t->wait_next = NULL;
+}
+
+/**
+ * Hand the CPU to whatever is due next; returns once self runs again
+ * (never, if self is done)
+ */
+static void switch_away(struct sim_task *self)
+{
+    if (s_in_event) {
+        fprintf(stderr, "mesh_sim: blocking call from a timer or event callback\n");
+        abort();
+    }
+    ready_update(self);
+
+    struct sim_task *next;
+    while (1) {
+        next = s_ready_count > 0 ? s_ready[0] : NULL;
+        if (s_event_count > 0 && (next == NULL || s_events[0].at_us <= next->wake_us)) {
+            sim_event_t ev = event_pop();
+            if (ev.at_us > s_now_us) s_now_us = ev.at_us;
+            s_in_event = true;
+            s_node = ev.node;
+            ev.fn(ev.arg);
+            s_in_event = false;
+            continue;
+        }
+        if (next == NULL) {
+            fprintf(stderr, "mesh_sim: every task is blocked and no event is pending\n");
+            exit(2);
+        }
+        break;
+    }
+
+    ready_remove(next);
+    if (next->wake_us > s_now_us) s_now_us = next->wake_us;
+    s_node = next->node;
+    if (next == self) return;
+
+    if (self->done) s_reap = self;
+    s_current = next;
+    swapcontext(&self->ctx, &next->ctx);
+    reap();
+}
+
+static void task_entry(void)
+{
+    reap();
+    struct sim_task *self = s_current;
+    self->fn(self->param);
+
+    // Returning from a task function is a bug on FreeRTOS; end it the same way
+    vTaskDelete(NULL);
+}
+
+static struct sim_task *task_new(const char *name)
+{
+    struct sim_task *t = calloc(1, sizeof(struct sim_task));
+    if (t == NULL) abort();
+
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->id = s_next_id++;
+    t->node = s_node;
+    t->wake_us = s_now_us;
+
+    t->next = s_tasks;
+    s_tasks = t;
+    return t;
+}
+
+/**
+ * Stop t for good: it is never resumed, its stack goes away
+ */
+static void task_kill(struct sim_task *t)
+{
+    if (t->done) return;
+    t->done = true;
+    ready_remove(t);
+    wait_remove(t);
+    unlink_task(t);
+    if (t != s_current) stack_free(t);
+}
+
+void sim_rtos_init(void)
+{
+    struct sim_task *main_task = task_new("main");
+    s_current = main_task;
+}
+
+int64_t sim_now_us(void)
+{
+    return s_now_us;
+}
+
+void sim_rtos_boot_node(int node)
+{
+    if (node >= s_boot_count) {
+        int count = node + 64;
+        s_boot_us = realloc(s_boot_us, count * sizeof(int64_t));
+        if (s_boot_us == NULL) abort();
+        memset(s_boot_us + s_boot_count, 0, (count - s_boot_count) * sizeof(int64_t));
+        s_boot_count = count;
+    }
+    s_boot_us[node] = s_now_us;
+}
+
+static int64_t boot_us(void)
+{
+    return s_node < s_boot_count ? s_boot_us[s_node] : 0;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us - boot_us();
+}
+
+int sim_rtos_node(void)
+{
+    return s_node;
+}
+
+int sim_rtos_enter(int node)
+{
+    int prev = s_node;
+    s_node = node;
+    return prev;
+}
+
+void sim_rtos_leave(int prev)
+{
+    s_node = prev;
+}
+
+bool sim_rtos_in_task(void)
+{
+    return !s_in_event;
+}
+
+void sim_rtos_consume_us(int64_t us)
+{
+    // Callbacks cannot be held up; their work is charged to nobody
+    if (s_in_event || us <= 0) return;
+    struct sim_task *self = s_current;
+    self->wake_us = s_now_us + us;
+    switch_away(self);
+}
+
+static void timers_kill_node(int node);
+
+void sim_rtos_kill_node(int node)
+{
+    struct sim_task *self = s_current;
+    struct sim_task *t = s_tasks;
+    while (t != NULL) {
+        struct sim_task *next = t->next;
+        if (t->node == node) task_kill(t);
+        t = next;
+    }
+    timers_kill_node(node);
+
+    // The caller was one of them: leave its stack for good
+    if (self->done && !s_in_event) {
+        switch_away(self);
+        abort();    // Not reached
+    }
+}
+
+// ============================================================================
+// Tasks
+// ============================================================================
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *param, UBaseType_t priority, TaskHandle_t *created_task)
+{
+    (void)stack_depth;
+    (void)priority;
+
+    void *stack = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        if (created_task != NULL) *created_task = NULL;
+        return pdFAIL;
+    }
+    mprotect(stack, (size_t)sysconf(_SC_PAGESIZE), PROT_NONE);  // Guard page
+
+    struct sim_task *t = task_new(name);
+    t->fn = fn;
+    t->param = param;
+    t->stack = stack;
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = stack;
+    t->ctx.uc_stack.ss_size = STACK_SIZE;
+    t->ctx.uc_link = NULL;
+    makecontext(&t->ctx, task_entry, 0);
+    ready_update(t);
+
+    if (created_task != NULL) *created_task = t;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    struct sim_task *self = s_current;
+    if (task != NULL && task != self) {
+        task_kill(task);
+        return;
+    }
+    task_kill(self);
+    switch_away(self);
+    abort();    // Not reached
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct sim_task *self = s_current;
+    self->wake_us = s_now_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+    switch_away(self);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    *previous_wake += increment;
+    struct sim_task *self = s_current;
+    int64_t wake = boot_us() + (int64_t)*previous_wake * portTICK_PERIOD_MS * 1000;
+    self->wake_us = wake > s_now_us ? wake : s_now_us;
+    switch_away(self);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)((s_now_us - boot_us()) / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_current;
+}
+
+// ============================================================================
+// Semaphores
+// ============================================================================
+
+static SemaphoreHandle_t sem_new(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t sem = calloc(1, sizeof(struct QueueDefinition));
+    if (sem == NULL) return NULL;
+    sem->max = max;
+    sem->count = initial;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_new(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_new(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return sem_new(max_count, initial_count);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    while (sem->waiters != NULL) wait_remove(sem->waiters);
+    free(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct sim_task *self = s_current;
+    int64_t deadline = (ticks == portMAX_DELAY) ? WAKE_NEVER
+                                                : s_now_us + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+
+    while (sem->count == 0) {
+        if (s_now_us >= deadline) {
+            return pdFALSE;
+        }
+        // Waiters queue in creation order
+        struct sim_task **link = &sem->waiters;
+        while (*link != NULL && (*link)->id < self->id) link = &(*link)->wait_next;
+        self->wait_next = *link;
+        *link = self;
+        self->waiting = sem;
+        self->wake_us = deadline;
+        switch_away(self);
+        wait_remove(self);
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (sem->count >= sem->max) {
+        return pdFALSE;
+    }
+    sem->count++;
+
+    // Wake the first waiter; it runs once the giver blocks
+    struct sim_task *t = sem->waiters;
+    if (t != NULL && t->wake_us != s_now_us) {
+        t->wake_us = s_now_us;
+        ready_update(t);
+    }
+    return pdTRUE;
+}
+
+// ============================================================================
+// Timers (esp_timer and FreeRTOS software timers)
+// ============================================================================
+
+/**
+ * Callbacks run as events under the owner's device, like the esp_timer and
+ * timer service tasks they stand in for they must not block
+ */
+typedef struct sim_timer {
+    void (*fn)(void *arg);
+    void *arg;
+    int node;
+    int64_t period_us;          // Periodic reload, 0 = one-shot
+    uint32_t gen;               // Bumped on every start/stop, stale firings are dropped
+    bool active;
+    bool dead;                  // Deleted, or its device was killed
+    struct sim_timer *next;
+    // FreeRTOS flavour
+    TimerCallbackFunction_t rtos_cb;
+    void *rtos_id;
+    TickType_t rtos_period;
+    bool rtos_reload;
+} sim_timer_t;
+
+typedef struct {
+    sim_timer_t *timer;
+    uint32_t gen;
+} timer_fire_t;
+
+static sim_timer_t *s_timers = NULL;
+
+static sim_timer_t *timer_new(void)
+{
+    sim_timer_t *timer = calloc(1, sizeof(sim_timer_t));
+    if (timer == NULL) return NULL;
+    timer->node = s_node;
+    timer->next = s_timers;
+    s_timers = timer;
+    return timer;
+}
+
+static void timer_fire(void *arg)
+{
+    timer_fire_t *fire = arg;
+    sim_timer_t *timer = fire->timer;
+    bool current = !timer->dead && timer->active && timer->gen == fire->gen;
+    free(fire);
+    if (!current) return;
+
+    if (timer->period_us > 0) {
+        fire = malloc(sizeof(timer_fire_t));
+        if (fire == NULL) abort();
+        *fire = (timer_fire_t){ timer, timer->gen };
+        sim_event_at(s_now_us + timer->period_us, timer_fire, fire);
+    } else {
+        timer->active = false;
+    }
+
+    int prev = sim_rtos_enter(timer->node);
+    timer->fn(timer->arg);
+    sim_rtos_leave(prev);
+}
+
+static void timer_arm(sim_timer_t *timer, int64_t delay_us, int64_t period_us)
+{
+    timer->gen++;
+    timer->active = true;
+    timer->period_us = period_us;
+
+    timer_fire_t *fire = malloc(sizeof(timer_fire_t));
+    if (fire == NULL) abort();
+    *fire = (timer_fire_t){ timer, timer->gen };
+    int prev = sim_rtos_enter(timer->node);
+    sim_event_at(s_now_us + delay_us, timer_fire, fire);
+    sim_rtos_leave(prev);
+}
+
+static void timer_disarm(sim_timer_t *timer)
+{
+    timer->gen++;
+    timer->active = false;
+}
+
+static void timers_kill_node(int node)
+{
+    sim_timer_t **link = &s_timers;
+    while (*link != NULL) {
+        sim_timer_t *timer = *link;
+        if (timer->node == node) {
+            // Pending firings still point at it: leave the memory, drop the link
+            timer_disarm(timer);
+            timer->dead = true;
+            *link = timer->next;
+        } else {
+            link = &timer->next;
+        }
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+    sim_timer_t *timer = timer_new();
+    if (timer == NULL) return ESP_ERR_NO_MEM;
+    timer->fn = args->callback;
+    timer->arg = args->arg;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == NULL || timer->dead) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer_arm(timer, (int64_t)timeout_us, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    if (timer == NULL || timer->dead || period_us == 0) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer_arm(timer, (int64_t)period_us, (int64_t)period_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (!timer->active) return ESP_ERR_INVALID_STATE;
+    timer_disarm(timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (timer->active) return ESP_ERR_INVALID_STATE;
+    timer->dead = true;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer != NULL && timer->active;
+}
+
+static void rtos_timer_trampoline(void *arg)
+{
+    sim_timer_t *timer = arg;
+    timer->rtos_cb(timer);
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *timer_id, TimerCallbackFunction_t callback)
+{
+    (void)name;
+    if (period == 0 || callback == NULL) return NULL;
+    sim_timer_t *timer = timer_new();
+    if (timer == NULL) return NULL;
+    timer->fn = rtos_timer_trampoline;
+    timer->arg = timer;
+    timer->rtos_cb = callback;
+    timer->rtos_id = timer_id;
+    timer->rtos_period = period;
+    timer->rtos_reload = auto_reload != pdFALSE;
+    return timer;
+}
+
+static int64_t rtos_period_us(const sim_timer_t *timer)
+{
+    return (int64_t)timer->rtos_period * portTICK_PERIOD_MS * 1000;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    if (timer == NULL || timer->dead) return pdFAIL;
+    // Starting a running timer restarts it, as xTimerReset does
+    int64_t period = rtos_period_us(timer);
+    timer_arm(timer, period, timer->rtos_reload ? period : 0);
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    if (timer == NULL) return pdFAIL;
+    timer_disarm(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks_to_wait)
+{
+    if (timer == NULL || period == 0) return pdFAIL;
+    timer->rtos_period = period;
+    return xTimerStart(timer, ticks_to_wait);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    if (timer == NULL) return pdFAIL;
+    timer_disarm(timer);
+    timer->dead = true;
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    return timer != NULL && timer->active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer != NULL ? timer->rtos_id : NULL;
+}
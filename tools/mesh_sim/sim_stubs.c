@@ -0,0 +1,198 @@
+/**
+ * OmniaPi Mesh Simulator - Stand-ins for Unlinked Gateway Modules
+ *
+ * The modules under test call into configuration, Ethernet, TLS, BLE
+ * provisioning, the ESP-NOW fast path, the web log and WebSocket and the
+ * pull-mode OTA manager. Here they behave as on a provisioned gateway on
+ * WiFi (no Ethernet link), with a plain mqtt:// broker, no OTA job of its
+ * own and the fast path off, so every frame goes over the mesh.
+ */
+
+#include "sim.h"
+#include "config_manager.h"
+#include "ble_prov.h"
+#include "mesh_fastpath.h"
+#include "webserver.h"
+#include "eth_manager.h"
+#include "mqtt_tls.h"
+#include "ota_manager.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Configuration and Radio Planning
+// ============================================================================
+
+const config_mqtt_t *config_get_mqtt(void)
+{
+    static const config_mqtt_t mqtt = {
+        .broker_uri = "mqtt://sim-broker:1883",
+        .client_id = "omniapi-gateway-sim",
+        .configured = true,
+    };
+    return &mqtt;
+}
+
+esp_err_t config_get_provision_code(char *buf, size_t buf_size)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t config_clear_provision_code(void)
+{
+    return ESP_OK;
+}
+
+const config_wifi_sta_t *config_get_wifi_sta(void)
+{
+    static const config_wifi_sta_t sta = {
+        .ssid = "sim-router",
+        .password = "sim-password",
+        .configured = true,
+    };
+    return &sta;
+}
+
+bool ble_prov_bt_memory_released(void)
+{
+    return true;
+}
+
+const config_mesh_t *config_get_mesh(void)
+{
+    static const config_mesh_t mesh = {
+        .ap_password = CONFIG_MESH_AP_PASSWD,
+        .channel = CONFIG_MESH_CHANNEL,
+        .max_layer = CONFIG_MESH_MAX_LAYER,
+        .max_connections = CONFIG_MESH_AP_CONNECTIONS,
+    };
+    return &mesh;
+}
+
+// ============================================================================
+// Ethernet (no link) and TLS (unused with mqtt://)
+// ============================================================================
+
+bool eth_manager_is_connected(void)
+{
+    return false;
+}
+
+void eth_manager_get_ip(char *ip_str, size_t len)
+{
+    snprintf(ip_str, len, "0.0.0.0");
+}
+
+esp_transport_handle_t mqtt_tls_transport_create(void)
+{
+    return NULL;
+}
+
+void mqtt_tls_get_stats(mqtt_tls_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+// ============================================================================
+// ESP-NOW Fast Path (off)
+// ============================================================================
+
+esp_err_t mesh_fastpath_init(void)
+{
+    return ESP_OK;
+}
+
+void mesh_fastpath_set_mesh(const uint8_t mesh_id[6], const char *password)
+{
+}
+
+void mesh_fastpath_add_peer(const uint8_t *mac)
+{
+}
+
+void mesh_fastpath_remove_peer(const uint8_t *mac)
+{
+}
+
+bool mesh_fastpath_is_fast_type(uint8_t msg_type)
+{
+    return false;
+}
+
+esp_err_t mesh_fastpath_send(const uint8_t *mac, const uint8_t *data, size_t len)
+{
+    return ESP_ERR_NOT_FOUND;
+}
+
+bool mesh_fastpath_recv(uint8_t *src_mac, uint8_t *buf, size_t *len)
+{
+    return false;
+}
+
+bool mesh_fastpath_take_fallback(uint8_t *dest_mac, uint8_t *buf, size_t *len)
+{
+    return false;
+}
+
+void mesh_fastpath_note_command(const uint8_t *mac, bool fast)
+{
+}
+
+void mesh_fastpath_note_reply(const uint8_t *mac)
+{
+}
+
+// ============================================================================
+// Web Log and WebSocket
+// ============================================================================
+
+void webserver_log(const char *format, ...)
+{
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    ESP_LOGD("WEBLOG", "%s", line);
+}
+
+void webserver_ws_broadcast(const char *message)
+{
+}
+
+// ============================================================================
+// Pull-Mode OTA (idle)
+// ============================================================================
+
+void ota_manager_handle_request(const uint8_t *src_mac, const payload_ota_request_t *request)
+{
+}
+
+void ota_manager_handle_complete(const uint8_t *src_mac, const payload_ota_complete_t *complete)
+{
+}
+
+void ota_manager_handle_failed(const uint8_t *src_mac, const payload_ota_failed_t *failed)
+{
+}
+
+esp_err_t ota_manager_start_job(const char *url, const char *version,
+                                const char *sha256_hex, uint32_t size,
+                                uint8_t device_type,
+                                const uint8_t target_macs[][6], uint8_t target_count)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t ota_manager_abort(void)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+const ota_job_t *ota_manager_get_job(void)
+{
+    static const ota_job_t idle = { 0 };
+    return &idle;
+}
@@ -0,0 +1,599 @@
+/**
+ * OmniaPi Web Server Load Simulator - Harness
+ *
+ * The gateway's real webserver.c, unchanged, on the esp_http_server of
+ * sim_httpd.c, with the lwIP socket pool it shares with the rest of the
+ * firmware (--other-sockets stand for MQTT, captive DNS and an OTA
+ * download, the most it holds at once). Clients on
+ * the LAN load it in virtual time:
+ *
+ *   dashboards   each holds a WebSocket and refreshes every --refresh-ms
+ *                with --burst API requests in parallel, one per kept-alive
+ *                connection, the way a browser does; a request that finds
+ *                its reused connection closed under it is retried once on
+ *                a new one, as browsers do
+ *   ws clients   WebSocket only (extra tabs, the app); refused ones try
+ *                again every WS_RETRY_MS
+ *   backend      one request per --backend-ms on a new connection, closed
+ *                after the response
+ *
+ * The gateway broadcasts a state frame to its WebSockets every
+ * BROADCAST_MS; the API handler holds the server task for --api-ms. After
+ * --duration-s the traffic stops and the run waits SETTLE_MS for the idle
+ * sweep.
+ *
+ * The report gives request latency percentiles, what the connection
+ * manager counted (webserver_get_conn_stats, as /api/connections shows
+ * it), and what httpd and lwIP did underneath. The exit status is 1 if an
+ * API request failed, an accepted WebSocket was closed or missed a
+ * broadcast, lwIP ran out of sockets, the connection table disagrees with
+ * httpd, idle keep-alive sockets outlived the sweep, or no request reused
+ * a connection although the dashboards' ones fit next to the WebSockets.
+ * Beyond that the pool is meant to churn: see "evicted".
+ */
+
+#include "sim.h"
+#include "webserver.h"
+#include "web_api.h"
+#include "log_ring.h"
+#include "ble_prov.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "WEBSERVER_LOAD_SIM";
+
+#define MAX_DASHBOARDS          16
+#define MAX_WS_CLIENTS          16
+#define MAX_BURST               6       // Connections a browser opens per host
+#define REQUEST_TIMEOUT_MS      10000
+#define WS_RETRY_MS             5000
+#define BROADCAST_MS            1000
+#define SETTLE_MS               (WEBSERVER_IDLE_TIMEOUT_MS + 2 * WEBSERVER_SWEEP_MS)
+
+typedef struct {
+    uint64_t seed;
+    uint32_t duration_s;
+    int dashboards;
+    int burst;
+    uint32_t refresh_ms;
+    uint32_t backend_ms;
+    int ws_clients;
+    uint32_t latency_us;
+    uint32_t api_us;
+    int other_sockets;
+    esp_log_level_t log_level;
+} options_t;
+
+typedef struct {
+    sim_http_conn_t *conn;
+    bool open;                  // Accepted by the server and still held
+    uint32_t opened;
+    uint32_t refused;
+    uint32_t broadcasts_at_open;
+    uint32_t frames_at_open;
+} ws_client_t;
+
+typedef struct {
+    ws_client_t ws;
+    sim_http_conn_t *slots[MAX_BURST];
+    SemaphoreHandle_t go[MAX_BURST];
+} dashboard_t;
+
+typedef struct {
+    dashboard_t *dash;
+    int slot;
+} worker_t;
+
+static const char *s_api_uris[MAX_BURST] = {
+    "/api/status", "/api/nodes", "/api/scenes", "/api/mesh/topology", "/api/logs", "/api/connections",
+};
+
+static options_t s_opt;
+static int s_failures = 0;
+static bool s_stop = false;
+
+static dashboard_t s_dashboards[MAX_DASHBOARDS];
+static worker_t s_workers[MAX_DASHBOARDS][MAX_BURST];
+static ws_client_t s_ws_clients[MAX_WS_CLIENTS];
+
+static uint32_t s_sent = 0;
+static uint32_t s_served = 0;
+static uint32_t s_failed = 0;
+static uint32_t s_retried = 0;             // Reused connection closed under the request
+static uint32_t s_ws_dropped = 0;          // Accepted WebSockets the server closed
+static uint32_t s_broadcasts = 0;
+static int64_t *s_latency_us = NULL;
+static size_t s_latency_count = 0;
+static size_t s_latency_cap = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        s_failures++;
+        fprintf(stderr, "webserver_load_sim: CHECK FAILED: %s\n", what);
+    }
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Add p50/p90/p99/max (ms) of count µs values to obj (sorts them)
+ */
+static void add_percentiles_ms(cJSON *obj, const char *prefix, int64_t *values, size_t count)
+{
+    static const int pcts[] = { 50, 90, 99 };
+    char key[48];
+    qsort(values, count, sizeof(int64_t), cmp_i64);
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        snprintf(key, sizeof(key), "%s_p%d_ms", prefix, pcts[i]);
+        cJSON_AddNumberToObject(obj, key, count ? values[(count - 1) * pcts[i] / 100] / 1000.0 : 0);
+    }
+    snprintf(key, sizeof(key), "%s_max_ms", prefix);
+    cJSON_AddNumberToObject(obj, key, count ? values[count - 1] / 1000.0 : 0);
+}
+
+// ============================================================================
+// Stand-ins for the Modules webserver.c Calls
+// ============================================================================
+
+void log_ring_vwrite(const char *format, va_list args)
+{
+}
+
+uint32_t log_ring_head(void)
+{
+    return 0;
+}
+
+int log_ring_read(uint32_t *cursor, log_entry_t *entries, int max, uint32_t *skipped)
+{
+    return 0;
+}
+
+int log_ring_read_last(log_entry_t *entries, int max)
+{
+    return 0;
+}
+
+bool ble_prov_bt_memory_released(void)
+{
+    return true;
+}
+
+/**
+ * Building the JSON (node table, topology...) holds the server task
+ */
+static esp_err_t api_handler(httpd_req_t *req)
+{
+    sim_rtos_consume_us(s_opt.api_us);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, "{}", HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * As web_api.c: one wildcard entry for the API, through webserver_dispatch
+ */
+esp_err_t web_api_register_handlers(httpd_handle_t server)
+{
+    httpd_uri_t uri = {
+        .uri = "/api/*",
+        .method = HTTP_GET,
+        .handler = webserver_dispatch,
+        .user_ctx = (void *)api_handler
+    };
+    return httpd_register_uri_handler(server, &uri);
+}
+
+// ============================================================================
+// Clients
+// ============================================================================
+
+static void record_latency(int64_t us)
+{
+    if (s_latency_count == s_latency_cap) {
+        s_latency_cap = s_latency_cap ? s_latency_cap * 2 : 1024;
+        s_latency_us = realloc(s_latency_us, s_latency_cap * sizeof(int64_t));
+        if (s_latency_us == NULL) abort();
+    }
+    s_latency_us[s_latency_count++] = us;
+}
+
+/**
+ * One API request the way a browser makes it
+ */
+static void fetch(sim_http_conn_t *conn, const char *uri, bool keep_alive)
+{
+    int64_t start = sim_now_us();
+    bool reused = sim_http_is_open(conn);
+    s_sent++;
+    int status = sim_http_get(conn, uri, keep_alive, REQUEST_TIMEOUT_MS);
+    if (status < 0 && reused) {
+        s_retried++;
+        status = sim_http_get(conn, uri, keep_alive, REQUEST_TIMEOUT_MS);
+    }
+    if (status == 200) {
+        s_served++;
+        record_latency(sim_now_us() - start);
+    } else {
+        s_failed++;
+        ESP_LOGW(TAG, "%s failed (%d)", uri, status);
+    }
+}
+
+static void ws_connect(ws_client_t *ws)
+{
+    if (sim_http_ws_open(ws->conn, "/ws", REQUEST_TIMEOUT_MS)) {
+        ws->open = true;
+        ws->opened++;
+        ws->broadcasts_at_open = s_broadcasts;
+        ws->frames_at_open = sim_http_ws_frames(ws->conn);
+    } else {
+        ws->refused++;
+        sim_http_close(ws->conn);
+    }
+}
+
+static void ws_check(ws_client_t *ws)
+{
+    if (ws->open && !sim_http_is_open(ws->conn)) {
+        ws->open = false;
+        s_ws_dropped++;
+        ESP_LOGW(TAG, "WebSocket closed by the server");
+    }
+}
+
+static void worker_task(void *arg)
+{
+    worker_t *w = arg;
+    for (;;) {
+        xSemaphoreTake(w->dash->go[w->slot], portMAX_DELAY);
+        fetch(w->dash->slots[w->slot], s_api_uris[w->slot], true);
+    }
+}
+
+static void dashboard_task(void *arg)
+{
+    dashboard_t *d = arg;
+    vTaskDelay(pdMS_TO_TICKS(sim_rand_u32() % 1000));     // Tabs opened at different times
+    ws_connect(&d->ws);
+    while (!s_stop) {
+        for (int i = 0; i < s_opt.burst; i++) {
+            xSemaphoreGive(d->go[i]);
+        }
+        vTaskDelay(pdMS_TO_TICKS(s_opt.refresh_ms));
+        ws_check(&d->ws);
+        if (!d->ws.open) ws_connect(&d->ws);
+    }
+    vTaskDelete(NULL);
+}
+
+static void ws_client_task(void *arg)
+{
+    ws_client_t *ws = arg;
+    vTaskDelay(pdMS_TO_TICKS(1000 + sim_rand_u32() % WS_RETRY_MS));
+    for (;;) {
+        ws_check(ws);
+        if (!ws->open && !s_stop) ws_connect(ws);
+        vTaskDelay(pdMS_TO_TICKS(WS_RETRY_MS));
+    }
+}
+
+static void backend_task(void *arg)
+{
+    sim_http_conn_t *conn = sim_http_conn_new();
+    vTaskDelay(pdMS_TO_TICKS(sim_rand_u32() % 1000));
+    while (!s_stop) {
+        fetch(conn, "/api/status", false);
+        vTaskDelay(pdMS_TO_TICKS(s_opt.backend_ms));
+    }
+    vTaskDelete(NULL);
+}
+
+static void broadcast_task(void *arg)
+{
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(BROADCAST_MS));
+        webserver_ws_broadcast("{\"type\":\"node_state\"}");
+        s_broadcasts++;
+    }
+}
+
+// ============================================================================
+// Run
+// ============================================================================
+
+static cJSON *conn_stats_json(const webserver_conn_stats_t *stats)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "open", stats->open);
+    cJSON_AddNumberToObject(json, "websockets", stats->websockets);
+    cJSON_AddNumberToObject(json, "accepted", stats->accepted);
+    cJSON_AddNumberToObject(json, "requests", stats->requests);
+    cJSON_AddNumberToObject(json, "reused", stats->reused);
+    cJSON_AddNumberToObject(json, "idle_closed", stats->idle_closed);
+    cJSON_AddNumberToObject(json, "evicted", stats->evicted);
+    cJSON_AddNumberToObject(json, "ws_rejected", stats->ws_rejected);
+    cJSON_AddNumberToObject(json, "avg_lifetime_ms", stats->avg_lifetime_ms);
+    return json;
+}
+
+static cJSON *run(void)
+{
+    for (int d = 0; d < s_opt.dashboards; d++) {
+        dashboard_t *dash = &s_dashboards[d];
+        dash->ws.conn = sim_http_conn_new();
+        for (int i = 0; i < s_opt.burst; i++) {
+            dash->slots[i] = sim_http_conn_new();
+            dash->go[i] = xSemaphoreCreateBinary();
+            s_workers[d][i] = (worker_t){ .dash = dash, .slot = i };
+            xTaskCreate(worker_task, "fetch", 4096, &s_workers[d][i], 5, NULL);
+        }
+        xTaskCreate(dashboard_task, "dashboard", 4096, dash, 5, NULL);
+    }
+    for (int i = 0; i < s_opt.ws_clients; i++) {
+        s_ws_clients[i].conn = sim_http_conn_new();
+        xTaskCreate(ws_client_task, "ws_client", 4096, &s_ws_clients[i], 5, NULL);
+    }
+    if (s_opt.backend_ms > 0) {
+        xTaskCreate(backend_task, "backend", 4096, NULL, 5, NULL);
+    }
+    xTaskCreate(broadcast_task, "broadcast", 4096, NULL, 5, NULL);
+
+    vTaskDelay(pdMS_TO_TICKS(s_opt.duration_s * 1000));
+    s_stop = true;
+    // Requests still in flight end within their timeout
+    vTaskDelay(pdMS_TO_TICKS(REQUEST_TIMEOUT_MS));
+
+    webserver_conn_stats_t busy;
+    webserver_get_conn_stats(&busy, NULL, 0);
+    sim_httpd_stats_t httpd;
+    sim_httpd_get_stats(&httpd);
+    check(busy.open == httpd.sessions, "connection table out of step with httpd's sessions");
+    check(busy.accepted == httpd.accepted, "connection table missed an accept");
+
+    vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+
+    webserver_conn_stats_t idle;
+    webserver_get_conn_stats(&idle, NULL, 0);
+    sim_httpd_get_stats(&httpd);
+
+    int ws_total = s_opt.dashboards + s_opt.ws_clients;
+    int ws_open = 0, ws_refused = 0, ws_missed = 0;
+    ws_client_t *all[MAX_DASHBOARDS + MAX_WS_CLIENTS];
+    for (int i = 0; i < s_opt.dashboards; i++) all[i] = &s_dashboards[i].ws;
+    for (int i = 0; i < s_opt.ws_clients; i++) all[s_opt.dashboards + i] = &s_ws_clients[i];
+    for (int i = 0; i < ws_total; i++) {
+        ws_client_t *ws = all[i];
+        ws_check(ws);
+        ws_refused += ws->refused;
+        if (!ws->open) continue;
+        ws_open++;
+        // The last broadcast may still be on its way
+        uint32_t expected = s_broadcasts - ws->broadcasts_at_open;
+        uint32_t got = sim_http_ws_frames(ws->conn) - ws->frames_at_open;
+        if (got + 1 < expected) ws_missed++;
+    }
+    int ws_expected = ws_total < WS_MAX_CLIENTS ? ws_total : WS_MAX_CLIENTS;
+    // Kept-alive connections fit next to the WebSockets and the free slot
+    bool keep_alive_fits = s_opt.dashboards * s_opt.burst <= WEBSERVER_MAX_SOCKETS - ws_expected - 1;
+
+    ESP_LOGI(TAG, "%lu requests: %lu failed, %lu retried; %d/%d WebSockets, %lu evicted, %lu idle closed",
+             (unsigned long)s_sent, (unsigned long)s_failed, (unsigned long)s_retried, ws_open, ws_total,
+             (unsigned long)idle.evicted, (unsigned long)idle.idle_closed);
+
+    cJSON *json = cJSON_CreateObject();
+
+    cJSON *requests = cJSON_CreateObject();
+    cJSON_AddNumberToObject(requests, "sent", s_sent);
+    cJSON_AddNumberToObject(requests, "served", s_served);
+    cJSON_AddNumberToObject(requests, "failed", s_failed);
+    cJSON_AddNumberToObject(requests, "retried", s_retried);
+    add_percentiles_ms(requests, "latency", s_latency_us, s_latency_count);
+    cJSON_AddItemToObject(json, "requests", requests);
+
+    cJSON *websockets = cJSON_CreateObject();
+    cJSON_AddNumberToObject(websockets, "clients", ws_total);
+    cJSON_AddNumberToObject(websockets, "open", ws_open);
+    cJSON_AddNumberToObject(websockets, "refused", ws_refused);
+    cJSON_AddNumberToObject(websockets, "dropped", s_ws_dropped);
+    cJSON_AddNumberToObject(websockets, "broadcasts", s_broadcasts);
+    cJSON_AddNumberToObject(websockets, "missed_broadcasts", ws_missed);
+    cJSON_AddItemToObject(json, "websockets", websockets);
+
+    cJSON_AddItemToObject(json, "webserver", conn_stats_json(&busy));
+    cJSON_AddItemToObject(json, "webserver_after_idle", conn_stats_json(&idle));
+
+    cJSON *server = cJSON_CreateObject();
+    cJSON_AddNumberToObject(server, "sessions_peak", httpd.sessions_peak);
+    cJSON_AddNumberToObject(server, "accepted", httpd.accepted);
+    cJSON_AddNumberToObject(server, "requests", httpd.requests);
+    cJSON_AddNumberToObject(server, "handler_errors", httpd.handler_errors);
+    cJSON_AddNumberToObject(server, "lru_purges", httpd.lru_purges);
+    cJSON_AddNumberToObject(server, "lru_purged_ws", httpd.lru_purged_ws);
+    cJSON_AddNumberToObject(server, "closes_skipped", httpd.closes_skipped);
+    cJSON_AddNumberToObject(server, "syn_dropped", httpd.syn_dropped);
+    cJSON_AddNumberToObject(server, "backlog_peak", httpd.backlog_peak);
+    cJSON_AddItemToObject(json, "httpd", server);
+
+    cJSON *lwip = cJSON_CreateObject();
+    cJSON_AddNumberToObject(lwip, "max_sockets", CONFIG_LWIP_MAX_SOCKETS);
+    cJSON_AddNumberToObject(lwip, "peak", httpd.lwip_peak);
+    cJSON_AddNumberToObject(lwip, "in_use", httpd.lwip_in_use);
+    cJSON_AddNumberToObject(lwip, "exhausted", httpd.lwip_exhausted);
+    cJSON_AddNumberToObject(lwip, "bad_close", httpd.lwip_bad_close);
+    cJSON_AddItemToObject(json, "lwip", lwip);
+
+    check(s_failed == 0, "an API request failed");
+    check(s_ws_dropped == 0 && httpd.lru_purged_ws == 0, "the server closed an accepted WebSocket");
+    check(ws_open == ws_expected, "WebSockets open at the end differ from the budget");
+    check(ws_missed == 0, "a WebSocket client missed broadcasts");
+    check(ws_total <= WS_MAX_CLIENTS || idle.ws_rejected > 0, "no WebSocket refused beyond the budget");
+    check(idle.websockets == ws_open, "connection table counts other WebSockets than the clients hold");
+    check(idle.open == httpd.sessions, "connection table out of step with httpd after the sweep");
+    check(idle.open == idle.websockets, "idle keep-alive sockets outlived the sweep");
+    check(!keep_alive_fits || busy.reused > 0, "no request reused a kept-alive connection");
+    check(httpd.lwip_exhausted == 0, "lwIP ran out of sockets");
+    check(httpd.lwip_bad_close == 0, "a socket was closed twice");
+    return json;
+}
+
+// ============================================================================
+// Options
+// ============================================================================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --seed N              random seed (default 1)\n"
+            "  --duration-s N        traffic time (default 120)\n"
+            "  --dashboards N        browser tabs with a WebSocket and API refreshes (default 2)\n"
+            "  --burst N             parallel API requests per refresh, up to %d (default 2)\n"
+            "  --refresh-ms N        between dashboard refreshes (default 2000)\n"
+            "  --backend-ms N        between backend requests, 0 = no backend (default 1000)\n"
+            "  --ws-clients N        WebSocket-only clients (default 2)\n"
+            "  --latency-ms X        one way, LAN (default 1)\n"
+            "  --api-ms X            API handler time (default 8)\n"
+            "  --other-sockets N     lwIP sockets held by the rest of the firmware (default 3)\n"
+            "  --log L               none | error | warn | info | debug (default warn)\n",
+            prog, MAX_BURST);
+}
+
+static esp_log_level_t parse_level(const char *prog, const char *arg)
+{
+    static const char *names[] = { "none", "error", "warn", "info", "debug" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(arg, names[i]) == 0) return (esp_log_level_t)i;
+    }
+    usage(prog);
+    exit(1);
+}
+
+static void parse_options(int argc, char **argv)
+{
+    static const struct option long_options[] = {
+        { "seed",           required_argument, NULL, 's' },
+        { "duration-s",     required_argument, NULL, 'd' },
+        { "dashboards",     required_argument, NULL, 'D' },
+        { "burst",          required_argument, NULL, 'b' },
+        { "refresh-ms",     required_argument, NULL, 'r' },
+        { "backend-ms",     required_argument, NULL, 'B' },
+        { "ws-clients",     required_argument, NULL, 'w' },
+        { "latency-ms",     required_argument, NULL, 'l' },
+        { "api-ms",         required_argument, NULL, 'a' },
+        { "other-sockets",  required_argument, NULL, 'o' },
+        { "log",            required_argument, NULL, 'v' },
+        { "help",           no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    s_opt = (options_t){
+        .seed = 1,
+        .duration_s = 120,
+        .dashboards = 2,
+        .burst = 2,
+        .refresh_ms = 2000,
+        .backend_ms = 1000,
+        .ws_clients = 2,
+        .latency_us = 1000,
+        .api_us = 8000,
+        .other_sockets = 3,
+        .log_level = ESP_LOG_WARN,
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's': s_opt.seed = strtoull(optarg, NULL, 0); break;
+            case 'd': s_opt.duration_s = (uint32_t)atoi(optarg); break;
+            case 'D': s_opt.dashboards = atoi(optarg); break;
+            case 'b': s_opt.burst = atoi(optarg); break;
+            case 'r': s_opt.refresh_ms = (uint32_t)atoi(optarg); break;
+            case 'B': s_opt.backend_ms = (uint32_t)atoi(optarg); break;
+            case 'w': s_opt.ws_clients = atoi(optarg); break;
+            case 'l': s_opt.latency_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'a': s_opt.api_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'o': s_opt.other_sockets = atoi(optarg); break;
+            case 'v': s_opt.log_level = parse_level(argv[0], optarg); break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (s_opt.dashboards < 0 || s_opt.dashboards > MAX_DASHBOARDS || s_opt.burst < 1 ||
+        s_opt.burst > MAX_BURST || s_opt.ws_clients < 0 || s_opt.ws_clients > MAX_WS_CLIENTS ||
+        s_opt.refresh_ms == 0 || s_opt.other_sockets < 0 || s_opt.duration_s == 0) {
+        usage(argv[0]);
+        exit(1);
+    }
+}
+
+static cJSON *config_json(void)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "seed", (double)s_opt.seed);
+    cJSON_AddNumberToObject(json, "duration_s", s_opt.duration_s);
+    cJSON_AddNumberToObject(json, "dashboards", s_opt.dashboards);
+    cJSON_AddNumberToObject(json, "burst", s_opt.burst);
+    cJSON_AddNumberToObject(json, "refresh_ms", s_opt.refresh_ms);
+    cJSON_AddNumberToObject(json, "backend_ms", s_opt.backend_ms);
+    cJSON_AddNumberToObject(json, "ws_clients", s_opt.ws_clients);
+    cJSON_AddNumberToObject(json, "latency_ms", s_opt.latency_us / 1000.0);
+    cJSON_AddNumberToObject(json, "api_ms", s_opt.api_us / 1000.0);
+    cJSON_AddNumberToObject(json, "other_sockets", s_opt.other_sockets);
+    cJSON_AddNumberToObject(json, "max_open_sockets", WEBSERVER_MAX_SOCKETS);
+    cJSON_AddNumberToObject(json, "ws_budget", WS_MAX_CLIENTS);
+    cJSON_AddNumberToObject(json, "api_reserved", WEBSERVER_API_RESERVED);
+    return json;
+}
+
+int main(int argc, char **argv)
+{
+    parse_options(argc, argv);
+
+    sim_log_set_level(s_opt.log_level, s_opt.log_level);
+    sim_rand_seed(s_opt.seed);
+    sim_rtos_init();
+    sim_idf_init(1);
+
+    sim_httpd_config_t httpd = { .latency_us = s_opt.latency_us };
+    sim_httpd_configure(&httpd);
+    for (int i = 0; i < s_opt.other_sockets; i++) {
+        if (sim_lwip_socket() < 0) {
+            fprintf(stderr, "webserver_load_sim: --other-sockets exceeds CONFIG_LWIP_MAX_SOCKETS\n");
+            exit(1);
+        }
+    }
+
+    cJSON *report = cJSON_CreateObject();
+    cJSON_AddItemToObject(report, "config", config_json());
+    esp_err_t ret = webserver_start();
+    check(ret == ESP_OK, "webserver_start failed");
+    if (ret == ESP_OK) {
+        cJSON_AddItemToObject(report, "load", run());
+    } else {
+        cJSON_AddStringToObject(report, "error", esp_err_to_name(ret));
+    }
+    cJSON_AddNumberToObject(report, "failures", s_failures);
+    cJSON_AddNumberToObject(report, "virtual_s", sim_now_us() / 1e6);
+
+    char *text = cJSON_Print(report);
+    printf("%s\n", text);
+    fflush(stdout);
+    cJSON_free(text);
+    cJSON_Delete(report);
+
+    // Tasks are still blocked; leave without unwinding them
+    _exit(s_failures ? 1 : 0);
+}